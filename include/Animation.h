@@ -1,6 +1,7 @@
 #ifndef ANIMATION_H
 #define ANIMATION_H
 
+#include <stddef.h>
 #include <vector>
 
 struct VerticalListAnimation {
@@ -16,6 +17,7 @@ struct VerticalListAnimation {
     static constexpr float introDuration = 500.0f;
     
     void resize(size_t size);
+    void grow(size_t size, int selIdx, float itemSpacing = itmSpc);
     void init();
     void startIntro(int selIdx, int total, float itemSpacing = itmSpc);
     void setTargets(int selIdx, int total, float itemSpacing = itmSpc);
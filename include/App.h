@@ -34,10 +34,13 @@
 #include "UsbDriveMenu.h"
 #include "MusicLibraryDataSource.h"
 #include "SongListDataSource.h"
+#include "SearchListDataSource.h"
 #include "NowPlayingMenu.h"
 #include "Logger.h"
 #include <HIDForge.h>
 #include "InfoMenu.h" 
+#include "StorageBenchmarkMenu.h"
+#include "TextViewerMenu.h"
 #include "ActionListDataSource.h"
 #include "SnakeGameMenu.h"
 #include "EventDispatcher.h"
@@ -50,6 +53,7 @@
 #include <memory>
 #include "StationSniffSaveMenu.h"
 #include "StationFileListDataSource.h"
+#include "TextFileListDataSource.h"
 #include "AirMouseActiveMenu.h"
 
 class HardwareManager;
@@ -75,6 +79,7 @@ class AssociationSleeper;
 class BadMsgAttacker;
 class RtcManager;
 class SystemDataProvider;
+class RetentionManager;
 
 class MPUManager;
 class AirMouseService;
@@ -115,6 +120,7 @@ public:
     MusicLibraryManager &getMusicLibraryManager();
     MusicLibraryDataSource& getMusicLibraryDataSource();
     SongListDataSource& getSongListDataSource();
+    SearchListDataSource& getSearchListDataSource() { return searchListDataSource_; }
     GameAudio &getGameAudio();
     StationSniffer &getStationSniffer();
     AssociationSleeper &getAssociationSleeper();
@@ -122,6 +128,7 @@ public:
     RtcManager& getRtcManager();
     TimezoneListDataSource& getTimezoneListDataSource();
     SystemDataProvider& getSystemDataProvider();
+    RetentionManager& getRetentionManager();
 
     const ConfigManager &getConfigManager() const;
     const HardwareManager &getHardwareManager() const;
@@ -134,6 +141,7 @@ public:
     std::vector<SecondaryWidgetType> getActiveSecondaryWidgets() const;
     DuckyScriptListDataSource &getDuckyScriptListDataSource() { return duckyScriptListDataSource_; }
     TextInputMenu &getTextInputMenu() { return textInputMenu_; }
+    TextViewerMenu &getTextViewerMenu() { return textViewerMenu_; }
     IMenu *getMenu(MenuType type);
     WifiListDataSource &getWifiListDataSource() { return wifiListDataSource_; }
     StationListDataSource &getStationListDataSource() { return stationListDataSource_; }
@@ -154,6 +162,7 @@ private:
     void returnToMenu(MenuType type);
 
     void drawSecondaryDisplay();
+    void drawPerfHud(U8G2& display);
 
     void updateAndDrawBootScreen(unsigned long bootStartTime, unsigned long totalBootDuration);
     void logToSmallDisplay(const char *message, const char *status = nullptr);
@@ -161,6 +170,8 @@ private:
     // --- NEW: Redraw optimization state ---
     bool redrawRequested_ = true;
     unsigned long lastDrawTime_ = 0;
+    static constexpr unsigned long PERF_HUD_REFRESH_MS = 250; // Redraw rate while the HUD is shown
+    static constexpr int PERF_HUD_HEIGHT = 32;
 
     // --- MODIFICATION START: Add pending navigation state variables ---
     MenuType pendingMenuChange_{MenuType::NONE};
@@ -199,6 +210,8 @@ private:
     CarouselMenu gamesMenu_;
     UsbDriveMenu usbDriveMenu_;
     InfoMenu infoMenu_;
+    StorageBenchmarkMenu storageBenchmarkMenu_;
+    TextViewerMenu textViewerMenu_;
     SnakeGameMenu snakeGameMenu_;
     StationSniffSaveMenu stationSniffSaveMenu_;
 
@@ -249,8 +262,10 @@ private:
     DuckyScriptListDataSource duckyScriptListDataSource_;
     MusicLibraryDataSource musicLibraryDataSource_;
     SongListDataSource songListDataSource_;
+    SearchListDataSource searchListDataSource_;
     TimezoneListDataSource timezoneDataSource_;
     StationFileListDataSource stationFileListDataSource_;
+    TextFileListDataSource textFileListDataSource_;
     
     // New Generic DataSources
     ActionListDataSource wifiAttacksDataSource_;
@@ -270,7 +285,9 @@ private:
     ListMenu duckyScriptListMenu_;
     ListMenu musicLibraryMenu_;
     ListMenu songListMenu_;
+    ListMenu searchListMenu_;
     ListMenu stationFileListMenu_;
+    ListMenu textFileListMenu_;
     
     // New ListMenus using the generic source
     ListMenu wifiAttacksMenu_;
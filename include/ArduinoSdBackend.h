@@ -0,0 +1,42 @@
+#ifndef ARDUINO_SD_BACKEND_H
+#define ARDUINO_SD_BACKEND_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include <SPI.h>
+#include "IStorageBackend.h"
+
+/**
+ * @brief IStorageBackend over the core's SD library (FatFs behind the VFS).
+ *
+ * The fallback for cards SdFat won't mount. Locking is left to the VFS, which
+ * already serialises access per volume. No preallocation.
+ */
+class ArduinoSdBackend : public IStorageBackend {
+public:
+    ArduinoSdBackend(uint8_t csPin, SPIClass& spi, uint32_t clockHz);
+
+    bool begin() override;
+    void end() override;
+    const char* name() const override { return "Arduino SD"; }
+
+    bool exists(const char* path) override;
+    bool mkdir(const char* path) override;
+    bool remove(const char* path) override;
+    bool rename(const char* pathFrom, const char* pathTo) override;
+    std::unique_ptr<IStorageFile> open(const char* path, StorageMode mode) override;
+
+    uint64_t totalBytes() override;
+    uint64_t usedBytes() override;
+    uint32_t clusterSize() override { return 0; } // Not exposed by the SD library
+
+    // Per-file stdio buffer. StorageBenchmark's "Read buffer" row suggests a size for this card.
+    static constexpr size_t STDIO_BUFFER_SIZE = 8192;
+
+private:
+    uint8_t csPin_;
+    SPIClass& spi_;
+    uint32_t clockHz_;
+};
+
+#endif // ARDUINO_SD_BACKEND_H
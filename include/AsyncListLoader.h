@@ -0,0 +1,141 @@
+#ifndef ASYNC_LIST_LOADER_H
+#define ASYNC_LIST_LOADER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Runs a list-producing job on a background FreeRTOS task.
+ *
+ * The job hands items over one at a time with push(); the UI thread collects
+ * them every frame with drain(). This lets a ListMenu draw the first entries
+ * of a large SD directory while the rest is still being walked.
+ *
+ * cancel() makes the next push() fail (the job should return when it does)
+ * and blocks until the task has exited, so the owner can safely restart or
+ * destroy the loader afterwards.
+ */
+template <typename T>
+class AsyncListLoader {
+public:
+    using Job = std::function<void(AsyncListLoader<T>& loader)>;
+
+    explicit AsyncListLoader(const char* taskName, uint32_t stackSize = 4096)
+        : taskName_(taskName),
+          stackSize_(stackSize),
+          mutex_(xSemaphoreCreateMutex()),
+          running_(false),
+          cancelRequested_(false)
+    {}
+
+    ~AsyncListLoader() {
+        cancel();
+        if (mutex_) vSemaphoreDelete(mutex_);
+    }
+
+    AsyncListLoader(const AsyncListLoader&) = delete;
+    AsyncListLoader& operator=(const AsyncListLoader&) = delete;
+
+    /**
+     * @brief Cancels any job in flight, then starts `job` on a fresh task.
+     * @return false if the task could not be created.
+     */
+    bool start(Job job) {
+        cancel();
+        job_ = std::move(job);
+        cancelRequested_ = false;
+        running_ = true;
+        if (xTaskCreatePinnedToCore(taskEntry, taskName_, stackSize_, this, TASK_PRIORITY, nullptr, TASK_CORE) != pdPASS) {
+            running_ = false;
+            job_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Stops the job at its next push() and waits for the task to exit.
+     * Any items that were produced but not yet drained are discarded.
+     */
+    void cancel() {
+        cancelRequested_ = true;
+        while (running_) {
+            vTaskDelay(pdMS_TO_TICKS(1));
+        }
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        pending_.clear();
+        xSemaphoreGive(mutex_);
+    }
+
+    /**
+     * @brief [Loader task] Publishes one item to the UI thread.
+     * @return false once cancel() has been requested; the job should return.
+     */
+    bool push(T item) {
+        if (cancelRequested_) return false;
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        pending_.push_back(std::move(item));
+        xSemaphoreGive(mutex_);
+        return true;
+    }
+
+    bool isCancelled() const { return cancelRequested_; }
+
+    /**
+     * @brief [UI thread] Moves every item produced since the last call onto the end of `out`.
+     * @return The number of items appended.
+     */
+    size_t drain(std::vector<T>& out) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        size_t count = pending_.size();
+        for (auto& item : pending_) {
+            out.push_back(std::move(item));
+        }
+        pending_.clear();
+        xSemaphoreGive(mutex_);
+        return count;
+    }
+
+    /**
+     * @brief True while the job is running or produced items are still waiting to be drained.
+     */
+    bool isLoading() const {
+        if (running_) return true;
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        bool hasPending = !pending_.empty();
+        xSemaphoreGive(mutex_);
+        return hasPending;
+    }
+
+private:
+    // Below the main loop's priority and on the protocol core, so walking a
+    // directory never competes with drawing or with the audio mixer (core 1).
+    static constexpr UBaseType_t TASK_PRIORITY = 1;
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    static void taskEntry(void* param) {
+        AsyncListLoader<T>* self = static_cast<AsyncListLoader<T>*>(param);
+        if (self->job_) {
+            self->job_(*self);
+        }
+        self->job_ = nullptr;
+        // Must be the last access to `self`: the owner may be destroyed right after.
+        self->running_ = false;
+        vTaskDelete(nullptr);
+    }
+
+    const char* taskName_;
+    uint32_t stackSize_;
+    SemaphoreHandle_t mutex_;
+    Job job_;
+    std::vector<T> pending_;
+    volatile bool running_;
+    volatile bool cancelRequested_;
+};
+
+#endif // ASYNC_LIST_LOADER_H
@@ -2,10 +2,11 @@
 #define AUDIOFILESOURCEKIVASD_H
 
 #include "AudioFileSource.h"
-#include <FS.h> // Required for the File object
+#include "ReadAheadStream.h"
 
 // A custom version of AudioFileSourceSD that uses our optimized SdCardManager
 // to open files, ensuring high-speed reads for audio streaming.
+// Reads are served from a PSRAM read-ahead window, so the decoder rarely waits on SPI.
 
 class AudioFileSourceKivaSD : public AudioFileSource {
 public:
@@ -22,7 +23,11 @@ public:
   uint32_t getPos() override;
 
 private:
-  File f;
+  // 4 x 16 KB: about four seconds of 320 kbps audio buffered ahead of the decoder.
+  static constexpr size_t READ_AHEAD_BLOCK_SIZE = 16 * 1024;
+  static constexpr size_t READ_AHEAD_BLOCKS = 4;
+
+  ReadAheadStream stream_;
 };
 
-#endif // AUDIOFILESOURCEKIVASD_H
\ No newline at end of file
+#endif // AUDIOFILESOURCEKIVASD_H
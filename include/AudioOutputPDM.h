@@ -3,28 +3,85 @@
 
 #include "AudioOutput.h" // From ESP8266Audio library
 #include <driver/i2s.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <memory>
+#include "PcmRing.h"
+#include "PcmOutputStage.h"
 
+/**
+ * @brief PDM output fed through a PSRAM PCM ring.
+ *
+ * writeBlock() (the decoder task, through AudioSlotMixer) appends whole mixed
+ * blocks to the ring; ConsumeSamples() and ConsumeSample() take stereo frames from a
+ * generator wired straight to the output. All of them refuse while the ring is full,
+ * which makes the caller retry later. An output task moves the ring into the I2S DMA
+ * buffers, so SD stalls and slot switches are covered by RING_SAMPLES of audio
+ * (~740 ms at 44.1 kHz) rather than heard.
+ */
 class AudioOutputPDM : public AudioOutput {
 public:
+    struct Stats {
+        PcmOutputStage::Stats output;
+        uint32_t ringFill;     // Samples buffered now
+        uint32_t ringCapacity;
+    };
+
     AudioOutputPDM(int pdm_pin, i2s_port_t i2s_port = I2S_NUM_0);
     virtual ~AudioOutputPDM();
 
     virtual bool SetRate(int hz) override;
     virtual bool ConsumeSample(int16_t sample[2]) override;
+    // Interleaved stereo frames, downmixed and amplified; returns how many fit before the ring filled.
+    size_t ConsumeSamples(const int16_t* frames, size_t count);
+    virtual uint16_t ConsumeSamples(int16_t* samples, uint16_t count) override {
+        return (uint16_t)ConsumeSamples(static_cast<const int16_t*>(samples), static_cast<size_t>(count));
+    }
+    // Mono samples already mixed and scaled (AudioSlotMixer): all `count` go into the ring, or none.
+    bool writeBlock(const int16_t* samples, size_t count);
+    virtual void flush() override;
     virtual bool stop() override;
     virtual bool begin() override;
 
+    // Decoder task: waits up to `timeout` while the ring has no room for more samples.
+    void waitForRoom(TickType_t timeout);
+    // Drops what is buffered but not yet played, e.g. on a skip.
+    void discardBuffered();
+    // Whether a dry ring is an underrun (playing) or expected (paused, stopped, track ended).
+    void setStreaming(bool streaming);
+    Stats getStats() const;
+    // Sample counts since the output was created; a sample written at `w` is heard once the play position passes it.
+    uint32_t getWritePosition() const { return m_ring.writePosition() + m_buffer_ptr; }
+    uint32_t getPlayPosition() const { return m_ring.readPosition(); }
+
 private:
-    void flushBuffer();
+    bool pushStaged();
     void install_i2s_driver(); // Helper function for installation
+    static void outputTaskEntry(void* param);
+
+    static constexpr uint32_t RING_SAMPLES = 32 * 1024;         // 64 KB of PSRAM
+    static constexpr uint32_t RING_FALLBACK_SAMPLES = 4 * 1024; // Internal RAM if PSRAM is short
+    static constexpr int STAGE_SAMPLES = 64;                    // Decoder side, appended to the ring at once
+    static constexpr uint32_t OUTPUT_TASK_STACK_SIZE = 3072;
+    static constexpr UBaseType_t OUTPUT_TASK_PRIORITY = 6;      // Above the decoder (AudioMixerTask, 5)
+    static constexpr BaseType_t OUTPUT_TASK_CORE = 1;
+    static constexpr TickType_t I2S_WRITE_TIMEOUT = pdMS_TO_TICKS(50); // Bounded, so SetRate() can't wait forever
 
     i2s_port_t m_i2s_port;
     gpio_num_t m_pdm_pin;
     bool m_driver_installed; // Flag to track driver state
 
-    int16_t* m_buffer;
+    int16_t* m_buffer; // Staged mono samples
     int m_buffer_ptr;
-    static const int BUFFER_FRAMES = 512;
+
+    PcmRing m_ring;
+    int16_t* m_ring_storage;
+    std::unique_ptr<PcmOutputStage::Sink> m_sink;
+    std::unique_ptr<PcmOutputStage> m_stage;
+    SemaphoreHandle_t m_i2s_mutex;  // The output task's writes vs. driver reinstalls
+    SemaphoreHandle_t m_room_signal; // Given by the output task after each block
+    TaskHandle_t m_output_task;
 };
 
-#endif // AUDIO_OUTPUT_PDM_H
\ No newline at end of file
+#endif // AUDIO_OUTPUT_PDM_H
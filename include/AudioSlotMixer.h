@@ -0,0 +1,112 @@
+#ifndef AUDIO_SLOT_MIXER_H
+#define AUDIO_SLOT_MIXER_H
+
+#include "AudioOutput.h" // From ESP8266Audio library
+#include "AudioOutputPDM.h"
+#include "PcmKernels.h"
+
+/**
+ * @brief Mixes the player's decoder slots into AudioOutputPDM a block at a time.
+ *
+ * Replaces ESP8266Audio's AudioOutputMixer and its stubs. A generator hands its
+ * Input whole runs of frames through ConsumeSamples(), or one per ConsumeSample()
+ * (the library's MP3 decoder works that way); either only appends to the input's
+ * block. Gain, mixing and the mono downmix then run once per BLOCK_FRAMES in
+ * PcmKernels::mixToMono(), and the block goes to the PCM ring in one
+ * AudioOutputPDM::writeBlock().
+ *
+ * Track changes: an input started after hold() pre-rolls one block and waits. follow()
+ * then splices it onto the end of another input with no frame lost or inserted, and
+ * crossfade() fades the two into each other along an equal-power curve.
+ *
+ * The inputs belong to the mixer and live as long as it does. loop(), follow(),
+ * crossfade() and the generators run on the decoder task; hold()/begin()/stop()/
+ * discard() may come from the UI.
+ */
+class AudioSlotMixer {
+public:
+    static constexpr size_t BLOCK_FRAMES = 128;
+
+    class Input : public AudioOutput {
+    public:
+        Input() { hertz = 0; }
+        bool SetRate(int hz) override; // Deferred while held
+        bool begin() override;
+        bool ConsumeSample(int16_t sample[2]) override;
+        // Interleaved frames; returns how many were taken. Fewer than `count` while the ring
+        // is full or the input is held: the generator keeps the rest and offers them again.
+        size_t ConsumeSamples(const int16_t* frames, size_t count);
+        uint16_t ConsumeSamples(int16_t* samples, uint16_t count) override {
+            return (uint16_t)ConsumeSamples(static_cast<const int16_t*>(samples), static_cast<size_t>(count));
+        }
+        bool stop() override; // What is buffered still plays out
+        // Drops what is buffered, e.g. when playback is stopped rather than finished.
+        void discard() { discardRequested_ = true; }
+        // The next begin() pre-rolls instead of playing, until follow() or crossfade().
+        void hold() { holdRequested_ = true; }
+        bool isActive() const { return active_; }
+        int getRate() const { return hertz; }
+        // The output's write position of this input's first frame, once it has been mixed.
+        bool hasStarted() const { return started_; }
+        uint32_t getStartPosition() const { return startPosition_; }
+
+    private:
+        friend class AudioSlotMixer;
+
+        AudioSlotMixer* mixer_ = nullptr;
+        alignas(16) int16_t frames_[2 * BLOCK_FRAMES]; // Aligned for the PIE path in PcmKernels
+        size_t count_ = 0;
+        Input* successor_ = nullptr;             // Spliced on once this input ends
+        int pendingRate_ = 0;                    // SetRate() while held, for the sink on release
+        volatile uint32_t startPosition_ = 0;
+        volatile bool started_ = false;
+        volatile bool active_ = false;           // From begin() until the last frame after stop() is mixed
+        volatile bool ending_ = false;
+        volatile bool held_ = false;
+        volatile bool holdRequested_ = false;
+        volatile bool discardRequested_ = false; // Acted on by loop(), on the decoder task
+    };
+
+    explicit AudioSlotMixer(AudioOutputPDM* sink);
+
+    Input* getInput(int slot) { return &inputs_[slot]; }
+
+    /**
+     * @brief Plays held input `next` from the frame after `prev`'s last one. `prev`
+     * should already be stopped; at a different sample rate the output is switched
+     * over once what `prev` left in the ring has played instead.
+     */
+    void follow(Input* prev, Input* next);
+
+    /**
+     * @brief Starts held input `to` now and fades `from` out under it over `frames`,
+     * with cos/sin gains so the summed power stays level.
+     * @return false (and nothing changes) if the inputs run at different rates.
+     */
+    bool crossfade(Input* from, Input* to, uint32_t frames);
+    bool isFading() const { return fadeTo_ != nullptr; }
+
+    /**
+     * @brief Sends the next block once every playing input has one (an ending input
+     * makes up the rest with silence).
+     * @return false if the ring had no room; the blocks wait for the next call.
+     */
+    bool loop();
+
+private:
+    void release(Input& input);
+    bool spliceSuccessors();
+    void endFade();
+
+    AudioOutputPDM* sink_;
+    Input inputs_[PcmKernels::MAX_INPUTS];
+    int16_t mono_[BLOCK_FRAMES];
+
+    Input* fadeFrom_ = nullptr;
+    Input* fadeTo_ = nullptr;
+    uint32_t fadeFrames_ = 0;
+    uint32_t fadePos_ = 0;
+    volatile bool cancelFadeRequested_ = false; // A track started directly: no fade applies
+};
+
+#endif // AUDIO_SLOT_MIXER_H
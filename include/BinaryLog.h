@@ -0,0 +1,284 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+/**
+ * @brief Binary log records: a format string id plus the raw arguments, formatted later.
+ *
+ * LOG() only copies its arguments, each behind a one-byte type tag (integers as
+ * varints), after a MessageHeader that points at the format and tag literals. The
+ * flusher numbers the literals per file and writes each one once as a FRAME_STRING,
+ * so .klog files decode without the firmware image (tools/klog_decode.py). render()
+ * is the same formatting, on the device, for Serial.
+ *
+ * File layout: FILE_MAGIC, FILE_VERSION, then frames of [u8 type][varint length][payload]:
+ *  - FRAME_STRING:  [varint index][bytes]
+ *  - FRAME_MESSAGE: [u8 level][varint millis since the previous message][varint format index]
+ *                   [varint tag index][args]
+ *  - FRAME_SYNC:    empty; the reader forgets all strings and restarts the clock at 0.
+ * Varints are unsigned LEB128; signed arguments are zigzag-coded first.
+ */
+namespace BinaryLog {
+
+    enum ArgType : uint8_t {
+        ARG_I32 = 1, ARG_I64, // Zigzag varint
+        ARG_U32, ARG_U64,     // Varint
+        ARG_F32, ARG_F64,     // Little-endian IEEE 754, 4 or 8 bytes
+        ARG_STR,              // [u8 length][bytes], copied at the call site
+        ARG_PTR               // Varint
+    };
+
+    // 0 is never a frame type, so the zeroed tail of a preallocated file ends the log.
+    enum FrameType : uint8_t { FRAME_STRING = 1, FRAME_MESSAGE = 2, FRAME_SYNC = 3 };
+
+    constexpr char FILE_MAGIC[4] = {'K', 'L', 'O', 'G'};
+    constexpr uint8_t FILE_VERSION = 1;
+    constexpr size_t MAX_VARINT_SIZE = 10;
+    constexpr size_t MAX_FRAME_HEADER_SIZE = 1 + 3;               // Payloads stay well under 2 MB
+    constexpr size_t MAX_MESSAGE_HEADER_SIZE = 1 + 3 * 5;          // Level and three 32-bit varints
+    constexpr size_t MAX_STRING_ARG = 96; // Longer string arguments are cut
+
+    // In-memory only: the literals are referenced, not copied.
+    struct MessageHeader {
+        uint8_t level;
+        uint32_t millis;
+        const char* format;
+        const char* tag;
+    };
+
+    inline size_t putVarint(uint8_t* out, uint64_t v) {
+        size_t n = 0;
+        while (v >= 0x80) {
+            out[n++] = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        out[n++] = (uint8_t)v;
+        return n;
+    }
+
+    inline size_t getVarint(const uint8_t* in, size_t len, uint64_t& v) {
+        v = 0;
+        for (size_t n = 0; n < len && n < MAX_VARINT_SIZE; n++) {
+            v |= (uint64_t)(in[n] & 0x7F) << (7 * n);
+            if (!(in[n] & 0x80)) return n + 1;
+        }
+        return 0; // Truncated or malformed
+    }
+
+    inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+    inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+    // --- Encoding ---
+    class Writer {
+    public:
+        Writer(uint8_t* out, size_t capacity) : out_(out), capacity_(capacity), len_(0), full_(false) {}
+
+        void put(const void* data, size_t len) {
+            if (full_ || len_ + len > capacity_) { full_ = true; return; }
+            memcpy(out_ + len_, data, len);
+            len_ += len;
+        }
+        // The tag and its value go in together or not at all, so a cut record stays parseable.
+        void putArg(uint8_t type, const void* data, size_t len) {
+            if (full_ || len_ + 1 + len > capacity_) { full_ = true; return; }
+            out_[len_++] = type;
+            memcpy(out_ + len_, data, len);
+            len_ += len;
+        }
+        void putVarintArg(uint8_t type, uint64_t v) {
+            uint8_t bytes[MAX_VARINT_SIZE];
+            putArg(type, bytes, putVarint(bytes, v));
+        }
+        void putString(const char* s) {
+            if (!s) s = "(null)";
+            // Not strnlen(): `s` is often a char array shorter than the bound (a name
+            // field in a struct), and the builtin is flagged for reading past it.
+            size_t n = 0;
+            while (n < MAX_STRING_ARG && s[n]) n++;
+            if (full_ || len_ + 2 + n > capacity_) { full_ = true; return; }
+            out_[len_++] = ARG_STR;
+            out_[len_++] = (uint8_t)n;
+            memcpy(out_ + len_, s, n);
+            len_ += n;
+        }
+        size_t length() const { return len_; }
+
+    private:
+        uint8_t* out_;
+        size_t capacity_;
+        size_t len_;
+        bool full_;
+    };
+
+    template<typename T> struct unsupported : std::false_type {};
+
+    template<typename T>
+    inline void encodeArg(Writer& w, T value) {
+        if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value) {
+            w.putString(value);
+        } else if constexpr (std::is_same<T, float>::value) {
+            w.putArg(ARG_F32, &value, sizeof(value)); // printf would print the promoted double; same digits
+        } else if constexpr (std::is_floating_point<T>::value) {
+            double v = value;
+            w.putArg(ARG_F64, &v, sizeof(v));
+        } else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+            constexpr bool isSigned = std::is_signed<T>::value;
+            if constexpr (sizeof(T) <= 4) {
+                if constexpr (isSigned) w.putVarintArg(ARG_I32, zigzag((int32_t)value));
+                else w.putVarintArg(ARG_U32, (uint32_t)value);
+            } else {
+                if constexpr (isSigned) w.putVarintArg(ARG_I64, zigzag((int64_t)value));
+                else w.putVarintArg(ARG_U64, (uint64_t)value);
+            }
+        } else if constexpr (std::is_pointer<T>::value) {
+            w.putVarintArg(ARG_PTR, (uint64_t)(uintptr_t)value);
+        } else {
+            static_assert(unsupported<T>::value, "LOG argument type cannot be recorded; pass a C type");
+        }
+    }
+
+    /**
+     * @brief Writes a MessageHeader and the arguments into `out`.
+     * Arguments that don't fit are left off; render() prints them as "<?>".
+     */
+    template<typename... Args>
+    size_t encode(uint8_t* out, size_t capacity, const MessageHeader& header, Args... args) {
+        Writer w(out, capacity);
+        w.put(&header, sizeof(header));
+        (encodeArg(w, args), ...);
+        return w.length();
+    }
+
+    // --- Decoding ---
+    class ArgReader {
+    public:
+        ArgReader(const uint8_t* data, size_t len) : data_(data), len_(len), pos_(0) {}
+
+        // Returns false once the arguments run out (or are malformed). Integer and pointer
+        // arguments come back decoded in `number`; the others point into the record.
+        bool next(uint8_t& type, uint64_t& number, const uint8_t*& value, size_t& valueLen) {
+            if (pos_ >= len_) return false;
+            type = data_[pos_];
+            size_t start = pos_ + 1;
+            switch (type) {
+                case ARG_I32: case ARG_I64: case ARG_U32: case ARG_U64: case ARG_PTR:
+                    valueLen = getVarint(data_ + start, len_ - start, number);
+                    if (valueLen == 0) return false;
+                    break;
+                case ARG_F32: valueLen = 4; break;
+                case ARG_F64: valueLen = 8; break;
+                case ARG_STR:
+                    if (start >= len_) return false;
+                    valueLen = data_[start];
+                    start++;
+                    break;
+                default: return false;
+            }
+            if (start + valueLen > len_) return false;
+            value = data_ + start;
+            pos_ = start + valueLen;
+            return true;
+        }
+
+    private:
+        const uint8_t* data_;
+        size_t len_;
+        size_t pos_;
+    };
+
+    /**
+     * @brief printf() with `args` from encode(). Conversions with no (or the wrong kind of)
+     * argument print "<?>"; `*` widths are not supported. Always NUL-terminates.
+     * @return The length written.
+     */
+    inline size_t render(char* out, size_t capacity, const char* format, const uint8_t* args, size_t argsLen) {
+        if (capacity == 0) return 0;
+        ArgReader reader(args, argsLen);
+        size_t len = 0;
+        auto append = [&](const char* s, size_t n) {
+            if (len + n >= capacity) n = capacity - 1 - len;
+            memcpy(out + len, s, n);
+            len += n;
+        };
+
+        for (const char* p = format; *p && len < capacity - 1;) {
+            if (*p != '%') {
+                const char* next = strchr(p, '%');
+                size_t n = next ? (size_t)(next - p) : strlen(p);
+                append(p, n);
+                p += n;
+                continue;
+            }
+            if (p[1] == '%') { append("%", 1); p += 2; continue; }
+
+            // Copy flags, width and precision; drop the length modifier, which is re-chosen
+            // below from the recorded type.
+            char spec[24];
+            size_t specLen = 0;
+            spec[specLen++] = *p++;
+            while (*p && strchr("-+ #0123456789.", *p) && specLen < sizeof(spec) - 4) spec[specLen++] = *p++;
+            while (*p && strchr("hlLqjzt", *p)) p++;
+            char conv = *p;
+            if (!conv) break;
+            p++;
+
+            uint8_t type;
+            uint64_t u = 0;
+            const uint8_t* value;
+            size_t valueLen;
+            char piece[128];
+            int n = -1;
+            if (reader.next(type, u, value, valueLen)) {
+                int64_t i = (int64_t)u;
+                double d = 0;
+                if (type == ARG_I32 || type == ARG_I64) { i = unzigzag(u); u = (uint64_t)i; }
+                else if (type == ARG_F32) { float f; memcpy(&f, value, 4); d = f; }
+                else if (type == ARG_F64) { memcpy(&d, value, 8); }
+                bool isFloat = type == ARG_F32 || type == ARG_F64;
+                bool isInt = !isFloat && type != ARG_STR;
+
+                if (strchr("di", conv) && isInt) {
+                    memcpy(spec + specLen, "lld", 4);
+                    n = snprintf(piece, sizeof(piece), spec, (long long)i);
+                } else if (strchr("uxXo", conv) && isInt) {
+                    spec[specLen] = 'l'; spec[specLen + 1] = 'l'; spec[specLen + 2] = conv; spec[specLen + 3] = '\0';
+                    // An unsigned conversion of a 32-bit value prints its 32-bit pattern, as printf does.
+                    n = snprintf(piece, sizeof(piece), spec, (unsigned long long)(type == ARG_I32 ? (uint32_t)i : u));
+                } else if (conv == 'c' && isInt) {
+                    spec[specLen] = 'c'; spec[specLen + 1] = '\0';
+                    n = snprintf(piece, sizeof(piece), spec, (int)i);
+                } else if (strchr("fFeEgGaA", conv) && isFloat) {
+                    spec[specLen] = conv; spec[specLen + 1] = '\0';
+                    n = snprintf(piece, sizeof(piece), spec, d);
+                } else if (conv == 's' && type == ARG_STR) {
+                    char text[MAX_STRING_ARG + 1];
+                    memcpy(text, value, valueLen);
+                    text[valueLen] = '\0';
+                    spec[specLen] = 's'; spec[specLen + 1] = '\0';
+                    n = snprintf(piece, sizeof(piece), spec, text);
+                } else if (conv == 'p' && isInt) {
+                    n = snprintf(piece, sizeof(piece), "0x%llx", (unsigned long long)u);
+                }
+            }
+            if (n < 0) append("<?>", 3);
+            else append(piece, (size_t)n < sizeof(piece) ? (size_t)n : sizeof(piece) - 1);
+        }
+        out[len] = '\0';
+        return len;
+    }
+
+    // --- File frames ---
+    // Writes [type][varint payloadLen]; returns its size (at most MAX_FRAME_HEADER_SIZE).
+    inline size_t putFrameHeader(uint8_t* out, FrameType type, size_t payloadLen) {
+        out[0] = type;
+        return 1 + putVarint(out + 1, payloadLen);
+    }
+
+} // namespace BinaryLog
+
+#endif // BINARY_LOG_H
@@ -26,6 +26,7 @@ private:
     std::vector<MenuItem> menuItems_;
     MenuType menuType_;
     int selectedIndex_;
+    int prefetchIndex_; // Selection last handed to Prefetcher, -1 if none
     CarouselAnimation animation_;
     
     // Marquee State
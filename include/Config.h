@@ -79,8 +79,12 @@ enum class MenuType
     WIFI_CONNECTION_STATUS,
     MUSIC_LIBRARY,
     SONG_LIST,
+    SEARCH_RESULTS,
     NOW_PLAYING,
     INFO_MENU,
+    SD_BENCHMARK,
+    TEXT_FILE_LIST,
+    TEXT_VIEWER,
 
     AIR_MOUSE_MODE_GRID,
     AIR_MOUSE_ACTIVE
@@ -326,11 +330,14 @@ namespace SD_ROOT
     // Second-level and specific file paths
     static constexpr const char *WIFI_KNOWN_NETWORKS = "/config/wifi_known_networks.txt";
     static constexpr const char *CONFIG_CURRENT_FIRMWARE = "/config/current_firmware.json";
+    static constexpr const char *CONFIG_MUSIC_RESUME = "/config/music_resume.txt";
 
     static constexpr const char *DATA_GAMES = "/data/games";
+    static constexpr const char *DATA_MUSIC_DB = "/data/music_library.kdb";
     static constexpr const char *DATA_LOGS = "/data/logs";
     static constexpr const char *DATA_CAPTURES = "/data/captures";
     static constexpr const char *DATA_CAPTURES_STATION_LISTS = "/data/captures/station_lists"; 
+    static constexpr const char *DATA_CAPTURES_HANDSHAKES = "/data/captures/handshakes";
     static constexpr const char *DATA_PROBES = "/data/captures/probes";
     static constexpr const char *DATA_PROBES_SSID_SESSION = "/data/captures/probes/probes_session.txt";
     static constexpr const char *DATA_PROBES_SSID_CUMULATIVE = "/data/captures/probes/probes_cumulative.txt";
@@ -19,6 +19,7 @@ struct DeviceSettings {
     int attackCooldownMs;  // Cooldown for broadcast attacks, in milliseconds
     uint32_t secondaryWidgetMask; // Bitmask for secondary display widgets
     char timezoneString[40];      // <-- MODIFIED: From int32_t to char array
+    uint8_t crossfadeSeconds;     // 0 = gapless, up to MusicPlayer::MAX_CROSSFADE_SECONDS
 };
 
 #include "Service.h"
@@ -0,0 +1,82 @@
+#ifndef CRC_TRAILER_H
+#define CRC_TRAILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief CRC32 trailer that closes every file written by SdCardManager::writeFileAtomic().
+ *
+ * The trailer is its own text line, "\n#crc32 xxxxxxxx\n", over everything before it,
+ * so a file stays readable by hand and line-based readers skip it like a comment. A file
+ * that ends without one was either written before the format existed or edited off-device.
+ */
+namespace CrcTrailer {
+
+    constexpr size_t SIZE = 17;
+
+    // Standard CRC32 (IEEE, reflected). Start with 0 and feed the data in as many pieces as needed.
+    inline uint32_t update(uint32_t crc, const void* data, size_t len) {
+        // Nibble table: 64 bytes of flash instead of 1 KB, fast enough for config-sized files.
+        static const uint32_t table[16] = {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+        };
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+        for (size_t i = 0; i < len; ++i) {
+            crc = table[(crc ^ p[i]) & 0x0F] ^ (crc >> 4);
+            crc = table[(crc ^ (p[i] >> 4)) & 0x0F] ^ (crc >> 4);
+        }
+        return ~crc;
+    }
+
+    // The same CRC with a 1 KB byte table (built on first use): for files of a megabyte or
+    // more, like the music library, where the nibble table above is the slow part of a load.
+    inline uint32_t updateLarge(uint32_t crc, const void* data, size_t len) {
+        static const struct Table {
+            uint32_t entries[256];
+            Table() {
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+                    entries[i] = c;
+                }
+            }
+        } table;
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+        for (size_t i = 0; i < len; ++i) {
+            crc = table.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    inline void format(uint32_t crc, char out[SIZE]) {
+        static const char hex[] = "0123456789abcdef";
+        memcpy(out, "\n#crc32 ", 8);
+        for (int i = 0; i < 8; ++i) {
+            out[8 + i] = hex[(crc >> (28 - 4 * i)) & 0x0F];
+        }
+        out[16] = '\n';
+    }
+
+    // Reads back a trailer written by format(). Returns false if `text` (SIZE bytes) is not one.
+    inline bool parse(const char* text, uint32_t& crc) {
+        if (memcmp(text, "\n#crc32 ", 8) != 0 || text[16] != '\n') return false;
+        crc = 0;
+        for (int i = 8; i < 16; ++i) {
+            char c = text[i];
+            uint32_t nibble;
+            if (c >= '0' && c <= '9') nibble = c - '0';
+            else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+            else return false;
+            crc = (crc << 4) | nibble;
+        }
+        return true;
+    }
+
+} // namespace CrcTrailer
+
+#endif // CRC_TRAILER_H
@@ -2,6 +2,7 @@
 #define DUCKY_SCRIPT_LIST_DATA_SOURCE_H
 
 #include "IListMenuDataSource.h"
+#include "AsyncListLoader.h"
 #include "DuckyScriptRunner.h" // Include the new header
 #include <vector>
 #include <string>
@@ -15,6 +16,9 @@ public:
     void onItemSelected(App* app, ListMenu* menu, int index) override;
     void onEnter(App* app, ListMenu* menu, bool isForwardNav) override;
     void onExit(App* app, ListMenu* menu) override;
+    void onUpdate(App* app, ListMenu* menu) override;
+    bool isLoading() const override;
+    std::string getPrefetchPath() const override { return SD_ROOT::USER_DUCKY; }
     
     const std::string& getSelectedScriptPath(int index);
 
@@ -22,8 +26,13 @@ public:
     void setExecutionMode(DuckyScriptRunner::Mode mode);
 
 private:
-    std::vector<std::string> fileNames_;
-    std::vector<std::string> filePaths_;
+    struct ScriptEntry {
+        std::string name;
+        std::string path;
+    };
+
+    AsyncListLoader<ScriptEntry> loader_;
+    std::vector<ScriptEntry> scripts_;
     DuckyScriptRunner::Mode modeToExecute_; // --- NEW MEMBER ---
 };
 
@@ -27,7 +27,11 @@ enum class EventType {
     JAMMER_STOPPED,
 
     // Song Playback
-    SONG_FINISHED
+    SONG_FINISHED,
+
+    // Music Library
+    MUSIC_INDEX_PROGRESS,
+    MUSIC_INDEX_FINISHED
 };
 
 // --- Base Event Struct ---
@@ -62,4 +66,15 @@ struct ReplaceMenuEvent : public Event {
     ReplaceMenuEvent(MenuType mt) : menuType(mt) { type = EventType::REPLACE_MENU; }
 };
 
+// Published from the UI loop while the library indexer runs in the background.
+struct MusicIndexProgressEvent : public Event {
+    uint8_t percent;
+    MusicIndexProgressEvent(uint8_t p) : percent(p) { type = EventType::MUSIC_INDEX_PROGRESS; }
+};
+
+struct MusicIndexFinishedEvent : public Event {
+    bool completed; // false if it was cancelled or failed; the library is then unchanged
+    MusicIndexFinishedEvent(bool c) : completed(c) { type = EventType::MUSIC_INDEX_FINISHED; }
+};
+
 #endif // EVENT_H
@@ -0,0 +1,92 @@
+#ifndef FAULT_INJECTING_BACKEND_H
+#define FAULT_INJECTING_BACKEND_H
+
+#ifndef ARDUINO // Host builds only, like PosixStorageBackend
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include "IStorageBackend.h"
+
+/**
+ * @brief IStorageBackend decorator that makes a healthy volume misbehave on purpose.
+ *
+ * Wraps the PosixStorageBackend sandbox of a native test so the storage layer's
+ * behaviour under a slow card, a full card and a power cut can be reproduced instead
+ * of waited for:
+ *  - latency:    every open (each directory entry included), read, write and flush
+ *                is delayed.
+ *  - disk full:  writes draw from a byte budget; once it runs out they come back short.
+ *  - bad seeks:  every seek fails while reads and writes carry on at the old position.
+ *  - power loss: after a set number of bytes, the write in flight is torn (only part of
+ *                it reaches the inner volume) and from then on every operation fails
+ *                until the backend is remounted with begin(). The cut can also come
+ *                after a set number of mutations (opens for writing, writes, flushes,
+ *                mkdirs, removes and renames), to land between the steps of a sequence.
+ *  - held walks: after a set number of directory entries, openNext() blocks until the
+ *                faults are replaced, to pin a background walk at a known point.
+ *
+ * The fault counters are shared by every handle and guarded by a mutex.
+ */
+class FaultInjectingBackend : public IStorageBackend {
+public:
+    static constexpr uint64_t UNLIMITED = UINT64_MAX;
+
+    struct Faults {
+        uint32_t latencyMicros = 0;             // Added to each open, entry, read, write and flush
+        uint64_t spaceLeftBytes = UNLIMITED;     // Bytes writes may still add before the disk is "full"
+        uint64_t powerLossAfterBytes = UNLIMITED; // Bytes written before the power is cut
+        uint64_t powerLossAfterOps = UNLIMITED;   // Mutations that complete before the power is cut
+        bool failSeeks = false;                   // Every seek fails; the cursor stays where it was
+        uint64_t holdAfterEntries = UNLIMITED;    // Directory entries handed out before openNext() blocks
+    };
+
+    explicit FaultInjectingBackend(IStorageBackend& inner) : inner_(inner) {}
+
+    // Replaces the active faults, restarts the write, mutation and entry counters and
+    // wakes any openNext() that was held.
+    void setFaults(const Faults& faults);
+    bool hasLostPower();
+    uint64_t getBytesWritten();
+    uint64_t getOpsDone(); // Mutations since setFaults(), e.g. to find every cut point of a sequence
+
+    bool begin() override; // Restores power; the faults stay armed
+    void end() override { inner_.end(); }
+    const char* name() const override { return inner_.name(); }
+
+    bool exists(const char* path) override;
+    bool mkdir(const char* path) override;
+    bool remove(const char* path) override;
+    bool rename(const char* pathFrom, const char* pathTo) override;
+    std::unique_ptr<IStorageFile> open(const char* path, StorageMode mode) override;
+
+    uint64_t totalBytes() override { return inner_.totalBytes(); }
+    uint64_t usedBytes() override { return inner_.usedBytes(); }
+    uint32_t clusterSize() override { return inner_.clusterSize(); }
+
+private:
+    friend class FaultInjectingFile;
+
+    void delay();
+    bool powered();
+    bool seekAllowed();
+    // How many of `len` bytes a write may pass on; cuts the power if the budget runs out.
+    size_t admitWrite(size_t len);
+    // Whether a mutation may go ahead; cuts the power instead once the op budget is spent.
+    bool admitOp();
+    // Blocks while the entry budget is spent; returns once this entry may be handed out.
+    void admitEntry();
+
+    IStorageBackend& inner_;
+    std::mutex mutex_;
+    Faults faults_;
+    uint64_t bytesWritten_ = 0;
+    uint64_t opsDone_ = 0;
+    uint64_t entriesDone_ = 0;
+    std::condition_variable entryGate_;
+    bool powerLost_ = false;
+};
+
+#endif // ARDUINO
+
+#endif // FAULT_INJECTING_BACKEND_H
@@ -30,7 +30,7 @@ struct FirmwareInfo {
 namespace FirmwareUtils {
     bool parseMetadataFile(const String& kfwFilePath, FirmwareInfo& info);
     bool saveMetadataFile(const String& kfwFilePath, const FirmwareInfo& info);
-    String calculateFileMD5(fs::FS &fs, const String& filePath);
+    String calculateFileMD5(const String& filePath);
 }
 
 #endif // FIRMWARE_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define FIRMWARE_LIST_DATA_SOURCE_H
 
 #include "IListMenuDataSource.h"
+#include "AsyncListLoader.h"
 #include "Firmware.h"
 #include <vector>
 #include <string>
@@ -16,6 +17,9 @@ public:
     void onItemSelected(App* app, ListMenu* menu, int index) override;
     void onEnter(App* app, ListMenu* menu, bool isForwardNav) override;
     void onExit(App* app, ListMenu* menu) override;
+    void onUpdate(App* app, ListMenu* menu) override;
+    bool isLoading() const override;
+    std::string getPrefetchPath() const override { return SD_ROOT::FIRMWARE; }
 
 private:
     void rebuildDisplayItems(App* app);
@@ -23,9 +27,12 @@ private:
     struct DisplayItem {
         std::string label;
         bool isBackButton;
-        int firmwareIndex; // Index into OtaManager's list
+        int firmwareIndex; // Index into firmwares_
     };
     
+    AsyncListLoader<FirmwareInfo> loader_;
+    std::vector<FirmwareInfo> firmwares_;
+    bool scanComplete_;
     std::vector<DisplayItem> displayItems_;
 };
 
@@ -27,6 +27,7 @@ private:
     std::vector<MenuItem> menuItems_;
     MenuType menuType_;
     int selectedIndex_;
+    int prefetchIndex_; // Selection last handed to Prefetcher, -1 if none
     int columns_;
 
     // Animation state is now encapsulated
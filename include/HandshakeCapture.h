@@ -65,7 +65,7 @@ private:
 
     bool isItEAPOL(const wifi_promiscuous_pkt_t *packet);
     void saveHandshake(const wifi_promiscuous_pkt_t *packet, bool beacon);
-    bool writeHeader(File file);
+    bool writeHeader(const char* path);
 
     void parsePMKID(const wifi_promiscuous_pkt_t *packet);
 
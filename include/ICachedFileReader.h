@@ -2,6 +2,7 @@
 #define I_CACHED_FILE_READER_H
 
 #include <cstddef>
+#include <string_view>
 #include <Arduino.h> // For String
 
 // An abstract interface for reading file-like data,
@@ -16,7 +17,30 @@ public:
     virtual size_t size() const = 0;
     virtual void close() = 0;
     virtual bool isOpen() const = 0;
-    virtual String readStringUntil(char terminator) = 0;
+
+    // --- NEW: Zero-copy access ---
+    // The returned views point into the PSRAM cache block or into the reader's own refill
+    // buffer, and stay valid only until the next call on this reader.
+
+    /**
+     * @brief Hands out the next run of up to `maxLen` bytes without copying.
+     * @return false at end of file.
+     */
+    virtual bool readSlice(std::string_view& out, size_t maxLen = SIZE_MAX) = 0;
+
+    /**
+     * @brief Hands out the bytes up to (not including) `terminator`, which is consumed.
+     * The last line of a file does not need a terminator. Streamed readers split lines
+     * longer than their refill buffer into several slices.
+     * @return false at end of file.
+     */
+    virtual bool readUntil(char terminator, std::string_view& out) = 0;
+
+    // Allocating convenience wrapper over readUntil().
+    virtual String readStringUntil(char terminator) {
+        std::string_view view;
+        return readUntil(terminator, view) ? String(view.data(), view.size()) : String();
+    }
 };
 
-#endif // I_CACHED_FILE_READER_H
\ No newline at end of file
+#endif // I_CACHED_FILE_READER_H
@@ -3,6 +3,7 @@
 
 #include <U8g2lib.h>
 #include "IMenu.h" // <-- ADD THIS INCLUDE
+#include <string>
 
 // Forward declarations to avoid circular dependencies
 class App;
@@ -82,6 +83,43 @@ public:
      * @brief [NEW] Allows the ListMenu to get the properties of an item.
      */
     virtual const MenuItem* getItem(int index) const { return nullptr; }
+
+    /**
+     * @brief [Optional] Reports that items are still streaming in from a background loader.
+     * 
+     * While this returns true, ListMenu re-reads getNumberOfItems() every frame, grows the
+     * list as results arrive and draws a loading row below the last item. Async data sources
+     * should move finished items into their list in onUpdate() and cancel the loader in onExit(),
+     * which ListMenu calls on back navigation.
+     */
+    virtual bool isLoading() const { return false; }
+
+    /**
+     * @brief [Optional] The SD path this data source reads in onEnter(), for Prefetcher.
+     */
+    virtual std::string getPrefetchPath() const { return ""; }
+
+    /**
+     * @brief [Optional] The SD path the item at `index` leads to, warmed while it is highlighted.
+     * If this returns an empty string, ListMenu falls back to getItem(index)'s prefetch target.
+     */
+    virtual std::string getItemPrefetchPath(int index) const { return ""; }
+
+    /**
+     * @brief [Optional] Opts the list into type-ahead search (BTN_A in ListMenu).
+     * 
+     * A searchable source must keep its items valid after onExit() until its next onEnter(),
+     * because the search results list draws and selects them through this source.
+     */
+    virtual bool isSearchable() const { return false; }
+
+    /**
+     * @brief [Optional] The text that search matches against for the item at `index`.
+     */
+    virtual std::string getItemLabel(int index) const {
+        const MenuItem* item = getItem(index);
+        return (item && item->label) ? item->label : "";
+    }
 };
 
 #endif // I_LIST_MENU_DATA_SOURCE_H
\ No newline at end of file
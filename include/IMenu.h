@@ -23,6 +23,10 @@ struct MenuItem {
     bool isInteractive = false;
     std::function<std::string(App*)> getValue = nullptr;
     std::function<void(App*, int)> adjustValue = nullptr;
+
+    // --- NEW: Optional SD path (file or directory) to warm while this item is highlighted ---
+    // Leave null to use the target menu's getPrefetchPath().
+    const char* prefetchPath = nullptr;
 };
 
 // A menu is now also an ISubscriber
@@ -53,6 +57,13 @@ public:
      * @note The default implementation requires no special resources.
      */
     virtual uint32_t getResourceRequirements() const { return (uint32_t)ResourceRequirement::NONE; }
+
+    /**
+     * @brief [NEW] The SD path (file or directory) this menu reads when it is entered.
+     * Prefetcher warms it while the user hovers an item that leads here.
+     * @return An empty string if there is nothing worth prefetching.
+     */
+    virtual std::string getPrefetchPath() const { return ""; }
     
     virtual const char* getTitle() const = 0;
     virtual MenuType getMenuType() const = 0;
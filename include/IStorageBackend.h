@@ -0,0 +1,88 @@
+#ifndef I_STORAGE_BACKEND_H
+#define I_STORAGE_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <memory>
+
+/**
+ * @brief How IStorageBackend::open() treats the file.
+ */
+enum class StorageMode : uint8_t {
+    READ,   // Existing file or directory, read-only
+    WRITE,  // Created or truncated, write-only
+    APPEND, // Created if missing, every write lands at the end
+    UPDATE  // Existing file, read and written in place at any position
+};
+
+/**
+ * @brief An open file or directory on a storage backend.
+ *
+ * Raw byte buffers rather than Arduino's File and String, so a host build can put
+ * PosixStorageBackend (or a fault-injecting wrapper) under SdCardManager.
+ * Not thread-safe per handle; backends serialise access to the volume itself.
+ */
+class IStorageFile {
+public:
+    virtual ~IStorageFile() = default;
+
+    virtual size_t read(uint8_t* buf, size_t len) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) = 0;
+    virtual bool seek(uint64_t pos) = 0;
+    virtual uint64_t position() const = 0;
+    virtual uint64_t size() const = 0;
+    virtual bool flush() = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+    virtual bool isDirectory() const = 0;
+
+    virtual const char* name() const = 0; // Last path component
+    virtual const char* path() const = 0;
+    virtual time_t lastWrite() { return 0; }
+
+    // --- Directory walking ---
+    // Returns the next entry of this directory, or nullptr once there are no more.
+    virtual std::unique_ptr<IStorageFile> openNext() = 0;
+    virtual void rewind() = 0;
+
+    /**
+     * @brief Reserves `bytes` of contiguous space on a freshly created, still empty file.
+     *
+     * Appends inside the reservation never search the allocation table, and sequential
+     * writes of whole sectors go out as multi-block transfers. Whatever is left unused
+     * is given back when the file is closed.
+     * @return false if the backend can't (the file is still usable, just not preallocated).
+     */
+    virtual bool preallocate(uint64_t bytes) { return false; }
+};
+
+/**
+ * @brief A mounted volume: the only layer that talks to a filesystem library.
+ *
+ * SdCardManager sits on top of this and owns caching and write coherence, so a
+ * backend only needs to do plain file and directory operations. Paths are
+ * absolute from the volume root ("/data/logs/...").
+ */
+class IStorageBackend {
+public:
+    virtual ~IStorageBackend() = default;
+
+    virtual bool begin() = 0;
+    virtual void end() = 0;
+    // Human readable backend and volume format, e.g. "SdFat exFAT". Valid after begin().
+    virtual const char* name() const = 0;
+
+    virtual bool exists(const char* path) = 0;
+    virtual bool mkdir(const char* path) = 0;
+    virtual bool remove(const char* path) = 0;
+    virtual bool rename(const char* pathFrom, const char* pathTo) = 0;
+    // Returns nullptr if the path can't be opened in `mode`.
+    virtual std::unique_ptr<IStorageFile> open(const char* path, StorageMode mode) = 0;
+
+    virtual uint64_t totalBytes() = 0;
+    virtual uint64_t usedBytes() = 0; // May walk the allocation table; slow on large cards
+    virtual uint32_t clusterSize() = 0; // Allocation unit in bytes, 0 if unknown
+};
+
+#endif // I_STORAGE_BACKEND_H
@@ -18,6 +18,7 @@ public:
 
     const char* getTitle() const override { return title_.c_str(); }
     MenuType getMenuType() const override { return menuType_; }
+    std::string getPrefetchPath() const override;
 
     void reloadData(App* app, bool resetSelection = true);
     int getSelectedIndex() const { return selectedIndex_; }
@@ -27,13 +28,18 @@ public:
 
 private:
     void scroll(int direction);
+    void syncItemCount(App* app);
+    void updatePrefetch(App* app);
+    void drawLoadingRow(U8G2& display, int y);
     
     std::string title_;
     MenuType menuType_;
     IListMenuDataSource* dataSource_;
     
     int selectedIndex_;
+    int prefetchIndex_; // Selection last handed to Prefetcher, -1 if none
     int totalItems_;
+    bool isLoading_; // Mirrors dataSource_->isLoading() as of the last update
     VerticalListAnimation animation_;
     
     // Marquee State - owned by the ListMenu
@@ -0,0 +1,52 @@
+#ifndef LOG_CONFIG_H
+#define LOG_CONFIG_H
+
+// Define a log level for filtering
+enum class LogLevel {
+    DEBUG,   // Verbose, for development
+    INFO,    // Standard operational messages
+    WARN,    // Potential issues
+    ERROR    // Critical errors
+};
+
+// --- Compile-time log filtering ---
+// A LOG() below the level set for its tag is compiled out entirely: its arguments are
+// never evaluated, so call sites may format MAC addresses or call DebugUtils freely.
+// Build with -DLOG_MIN_LEVEL=0 to get every DEBUG line back.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1 // 0 DEBUG, 1 INFO, 2 WARN, 3 ERROR
+#endif
+
+namespace LogFilter {
+
+    struct TagLevel {
+        const char* tag;
+        LogLevel minLevel;
+    };
+
+    // Per-tag overrides of LOG_MIN_LEVEL, either way.
+    constexpr TagLevel TAG_LEVELS[] = {
+        {"SD_CACHE", LogLevel::WARN}, // One line per admitted file; drowns everything else
+        // {"HW_MANAGER", LogLevel::DEBUG}, // PCF interrupt tracing
+        {nullptr, LogLevel::DEBUG}   // Terminator
+    };
+
+    constexpr bool tagEquals(const char* a, const char* b) {
+        while (*a && *a == *b) { ++a; ++b; }
+        return *a == *b;
+    }
+
+    constexpr LogLevel minLevelFor(const char* tag) {
+        for (const TagLevel& entry : TAG_LEVELS) {
+            if (entry.tag && tagEquals(entry.tag, tag)) return entry.minLevel;
+        }
+        return static_cast<LogLevel>(LOG_MIN_LEVEL);
+    }
+
+    constexpr bool isEnabled(LogLevel level, const char* tag) {
+        return level >= minLevelFor(tag);
+    }
+
+} // namespace LogFilter
+
+#endif // LOG_CONFIG_H
@@ -0,0 +1,127 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free multi-producer, single-consumer ring of variable-length records.
+ *
+ * Producers claim space with one compare-and-swap on the head cursor, copy their
+ * bytes in and publish the record by storing its header last; they never block or
+ * take a lock, so any task may log. A full ring drops the record and counts it.
+ * The consumer hands records out in claim order and stops at the first one still
+ * being written. Consumed space is zeroed, so an unpublished header always reads 0.
+ *
+ * The claim is a compare-and-swap and the drop count a fetch-add, which the S3 can't
+ * do on PSRAM, so the LogRing itself belongs in internal RAM; the record buffer it is
+ * handed (Logger's is ps_malloc'd) carries no atomics and may live anywhere.
+ */
+class LogRing {
+public:
+    static constexpr uint8_t MAX_USER_FLAGS = 0x3F; // Six bits per record for the owner
+
+    /**
+     * @param buffer 4-byte aligned storage of `capacity` bytes.
+     * @param capacity A power of two.
+     */
+    void init(uint8_t* buffer, uint32_t capacity) {
+        memset(buffer, 0, capacity);
+        capacity_ = capacity;
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        buffer_ = buffer;
+    }
+
+    bool isReady() const { return buffer_ != nullptr; }
+
+    /**
+     * @brief Copies `len` bytes in as one record. Safe from any number of tasks at once.
+     * @return false if it didn't fit (counted in takeDropped()).
+     */
+    bool push(const char* data, uint32_t len, uint8_t userFlags = 0) {
+        uint32_t size = recordSize(len);
+        if (!buffer_ || size > capacity_ / 2) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // Records never wrap: one that would straddle the end is preceded by padding to it.
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t pad, next;
+        do {
+            uint32_t pos = head & (capacity_ - 1);
+            pad = (pos + size > capacity_) ? capacity_ - pos : 0;
+            next = head + pad + size;
+            if (next - tail_.load(std::memory_order_acquire) > capacity_) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!head_.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        if (pad) {
+            publish(head & (capacity_ - 1), ((pad - HEADER_SIZE) << LEN_SHIFT) | FLAG_PADDING);
+        }
+        uint32_t pos = (head + pad) & (capacity_ - 1);
+        memcpy(buffer_ + pos + HEADER_SIZE, data, len);
+        publish(pos, (len << LEN_SHIFT) | ((uint32_t)(userFlags & MAX_USER_FLAGS) << 2));
+        return true;
+    }
+
+    /**
+     * @brief Single consumer: calls `onRecord(data, len, userFlags)` for each published record
+     * in order. Returning false from it leaves that record for the next call.
+     * @return The number of records consumed.
+     */
+    template<typename Fn>
+    size_t drain(Fn&& onRecord) {
+        if (!buffer_) return 0;
+        size_t consumed = 0;
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        while (tail != head) {
+            uint32_t pos = tail & (capacity_ - 1);
+            uint32_t header = __atomic_load_n(reinterpret_cast<uint32_t*>(buffer_ + pos), __ATOMIC_ACQUIRE);
+            if (!(header & FLAG_COMMITTED)) break; // Claimed, still being written
+            uint32_t len = header >> LEN_SHIFT;
+            if (!(header & FLAG_PADDING)) {
+                if (!onRecord((const char*)(buffer_ + pos + HEADER_SIZE), len, (uint8_t)((header >> 2) & MAX_USER_FLAGS))) break;
+                consumed++;
+            }
+            uint32_t size = recordSize(len);
+            memset(buffer_ + pos, 0, size);
+            tail += size;
+            tail_.store(tail, std::memory_order_release);
+        }
+        return consumed;
+    }
+
+    // Records dropped since the last call.
+    uint32_t takeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+    uint32_t usedBytes() const {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+    }
+    uint32_t capacity() const { return capacity_; }
+
+private:
+    static constexpr uint32_t HEADER_SIZE = 4;
+    static constexpr uint32_t FLAG_COMMITTED = 1u << 0;
+    static constexpr uint32_t FLAG_PADDING = 1u << 1;
+    static constexpr uint32_t LEN_SHIFT = 8;
+
+    static uint32_t recordSize(uint32_t len) { return (HEADER_SIZE + len + 3) & ~3u; }
+
+    void publish(uint32_t pos, uint32_t header) {
+        __atomic_store_n(reinterpret_cast<uint32_t*>(buffer_ + pos), header | FLAG_COMMITTED, __ATOMIC_RELEASE);
+    }
+
+    std::atomic<uint32_t> head_{0};    // Claimed up to here (free-running byte count)
+    std::atomic<uint32_t> tail_{0};    // Consumed up to here
+    std::atomic<uint32_t> dropped_{0};
+    uint8_t* buffer_ = nullptr;
+    uint32_t capacity_ = 0;
+};
+
+#endif // LOG_RING_H
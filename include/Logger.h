@@ -4,53 +4,42 @@
 #include <Arduino.h>
 #include "Config.h"
 #include <cstdarg>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <unordered_map>
+#include "BinaryLog.h"
+#include "LogConfig.h"
+#include "LogRing.h"
 #include "SdCardManager.h" // Include the API header
+#include "SdWriter.h"
 
-// Define a log level for filtering
-enum class LogLevel {
-    DEBUG,   // Verbose, for development
-    INFO,    // Standard operational messages
-    WARN,    // Potential issues
-    ERROR    // Critical errors
-};
-
+/**
+ * @brief Asynchronous binary logger: LOG() only copies the format string's address and
+ * the raw arguments (see BinaryLog.h) into a lock-free PSRAM ring, from any task,
+ * without ever waiting or formatting.
+ *
+ * A low-priority flusher task drains the ring every FLUSH_INTERVAL_MS (sooner once it
+ * is half full), rendering text for Serial and handing the binary records to SdWriter
+ * in batches. The session log is a .klog file; tools/klog_decode.py turns it back into
+ * text. It is archived every MAX_SESSION_LOG_BYTES and RetentionManager prunes the
+ * archives. Lines that find the ring full are dropped and reported by the flusher. flush()
+ * drains synchronously; it is registered as a shutdown handler so esp_restart()
+ * never loses the tail of the log.
+ */
 class Logger {
 public:
     static Logger& getInstance();
     void setup();
 
-    // Base implementation with the file flag
+    // Base implementation with the file flag.
+    // `component` and `format` must be string literals: records keep only their addresses.
     template<typename... Args>
     void log(LogLevel level, const char* component, bool toFile, const char* format, Args... args) {
-        char buffer[256];
-        char levelChar;
-
-        switch(level) {
-            case LogLevel::DEBUG: levelChar = 'D'; break;
-            case LogLevel::INFO:  levelChar = 'I'; break;
-            case LogLevel::WARN:  levelChar = 'W'; break;
-            case LogLevel::ERROR: levelChar = 'E'; break;
-            default:              levelChar = '?'; break;
-        }
-
-        int prefixLen = snprintf(buffer, sizeof(buffer), "%lu [%c] [%s] ", millis(), levelChar, component);
-        if (prefixLen >= 0 && prefixLen < sizeof(buffer)) {
-            snprintf(buffer + prefixLen, sizeof(buffer) - prefixLen, format, args...);
-        }
-
-        #ifdef ENABLE_DEBUG_PRINT
-        Serial.println(buffer);
-        #endif
-
-        if (toFile && isInitialized_ && !currentLogFile_.isEmpty()) {
-            // --- THIS IS THE FIX ---
-            // Use openFileUncached for direct, non-cached file access suitable for logging.
-            File logFile = SdCardManager::getInstance().openFileUncached(currentLogFile_.c_str(), FILE_APPEND);
-            if (logFile) {
-                logFile.println(buffer);
-                logFile.close();
-            }
-        }
+        alignas(4) uint8_t record[MAX_RECORD_LENGTH];
+        BinaryLog::MessageHeader header = {(uint8_t)level, (uint32_t)millis(), format, component};
+        size_t len = BinaryLog::encode(record, sizeof(record), header, args...);
+        push(record, len, toFile);
     }
 
     // Overload that defaults to file logging.
@@ -59,20 +48,62 @@ public:
         // Call the main implementation with toFile = true
         log(level, component, true, format, args...);
     }
+
+    // Drains everything logged so far and waits (up to `timeoutMs`) until it is on the card.
+    void flush(uint32_t timeoutMs = FLUSH_TIMEOUT_MS);
+    uint32_t getDroppedLines() const { return droppedLines_; }
     
     Logger(const Logger&) = delete;
     void operator=(const Logger&) = delete;
 
 private:
     Logger();
-    void manageLogFiles();
+    void archiveSessionLog();
+    void startSessionLog();
+    void push(const uint8_t* record, size_t len, bool toFile);
+    void drainRing();
+    void writeRecord(const uint8_t* record, uint32_t len, size_t& batchLen);
+    uint32_t defineString(const char* literal, size_t& batchLen);
+    void appendBatch(size_t& batchLen);
+    static void taskEntry(void* param);
+    static void onShutdown();
+
+    static const size_t LOG_PREALLOCATE_BYTES = 256 * 1024; // Contiguous space reserved per session log
+    static constexpr size_t MAX_SESSION_LOG_BYTES = LOG_PREALLOCATE_BYTES; // Then it is archived and a new one started
+    static constexpr const char* LATEST_LOG_NAME = "system_log_latest.klog";
+    static constexpr const char* LOG_EXTENSION = ".klog";
+    static constexpr size_t MAX_RECORD_LENGTH = 192;          // Header and arguments; longer ones lose trailing args
+    static constexpr size_t MAX_LINE_LENGTH = 256;            // Rendered for Serial
+    static constexpr uint32_t RING_BYTES = 32 * 1024;         // PSRAM
+    static constexpr uint32_t RING_FALLBACK_BYTES = 4 * 1024; // Internal RAM, if there is no PSRAM
+    static constexpr size_t BATCH_BYTES = 2048;               // One SdWriter append per this much
+    static constexpr uint32_t FLUSH_INTERVAL_MS = 100;
+    static constexpr uint32_t FLUSH_TIMEOUT_MS = 2000;
+    static constexpr uint8_t RECORD_TO_FILE = 1;
+    static constexpr uint32_t TASK_STACK_SIZE = 4096;
+    static constexpr UBaseType_t TASK_PRIORITY = 1; // Below the UI loop
+    static constexpr BaseType_t TASK_CORE = 0;
 
-    static const int MAX_LOG_FILES = 3;
-    bool isInitialized_ = false;
-    String currentLogFile_;
+    LogRing ring_;
+    SemaphoreHandle_t drainMutex_; // One consumer at a time: the flusher task or flush()
+    TaskHandle_t taskHandle_;
+    volatile bool isInitialized_ = false;
+    char currentLogFile_[64];
+    uint8_t batch_[BATCH_BYTES];
+    // Literals defined in currentLogFile_ since its last FRAME_SYNC; empty means one is due.
+    std::unordered_map<const char*, uint32_t> stringIndex_;
+    uint32_t lastMillis_; // Of the last message written, for the deltas
+    size_t sessionBytes_; // Appended to currentLogFile_ since it was started
+    volatile uint32_t droppedLines_;
 };
 
-// This macro works with the template overloads.
-#define LOG(level, component, ...) Logger::getInstance().log(level, component, ##__VA_ARGS__)
+// This macro works with the template overloads. Levels filtered out for `component` in
+// LogConfig.h compile to nothing, arguments included.
+#define LOG(level, component, ...) \
+    do { \
+        if constexpr (LogFilter::isEnabled(level, component)) { \
+            Logger::getInstance().log(level, component, ##__VA_ARGS__); \
+        } \
+    } while (0)
 
 #endif // LOGGER_H
\ No newline at end of file
@@ -0,0 +1,175 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @brief Byte-budgeted LRU cache with O(1) lookup, touch and eviction.
+ *
+ * Entries live in an unordered_map (node-based, so their addresses never move)
+ * and are threaded onto an intrusive doubly linked recency list: head is the most
+ * recently used entry, tail the next one to evict. Each entry carries a size in
+ * bytes; put() evicts from the tail until the new entry fits the budget.
+ *
+ * Not thread-safe; the owner serialises access.
+ */
+template <typename V>
+class LruCache {
+public:
+    struct Stats {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        uint32_t evictions = 0;
+        uint32_t bypasses = 0; // Lookups the owner chose not to admit (see noteBypass())
+    };
+
+    explicit LruCache(size_t capacityBytes) : capacity_(capacityBytes) {}
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    /**
+     * @brief Looks `key` up, counting a hit or miss. A hit becomes the most recently used entry.
+     * @return The cached value, or nullptr. Valid until the entry is evicted or erased.
+     */
+    V* get(const std::string& key) {
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            stats_.misses++;
+            return nullptr;
+        }
+        stats_.hits++;
+        moveToFront(&it->second);
+        return &it->second.value;
+    }
+
+    /**
+     * @brief Like get() but neither counts nor changes recency.
+     */
+    const V* peek(const std::string& key) const {
+        auto it = map_.find(key);
+        return it == map_.end() ? nullptr : &it->second.value;
+    }
+
+    /**
+     * @brief Inserts or replaces `key`, evicting least recently used entries until it fits.
+     * @return The stored value, or nullptr if `size` exceeds the whole budget (nothing is evicted then).
+     */
+    V* put(const std::string& key, V value, size_t size) {
+        if (size > capacity_) return nullptr;
+        erase(key);
+        while (bytes_ + size > capacity_ && tail_) {
+            evictTail();
+        }
+
+        auto result = map_.emplace(key, Node{std::move(value), size, nullptr, nullptr, nullptr});
+        Node* node = &result.first->second;
+        node->key = &result.first->first;
+        linkFront(node);
+        bytes_ += size;
+        return &node->value;
+    }
+
+    /**
+     * @brief Removes `key` without counting an eviction.
+     * @return true if it was cached.
+     */
+    bool erase(const std::string& key) {
+        auto it = map_.find(key);
+        if (it == map_.end()) return false;
+        unlink(&it->second);
+        bytes_ -= it->second.size;
+        map_.erase(it);
+        return true;
+    }
+
+    /**
+     * @brief Removes every entry whose key satisfies `pred` (O(n); meant for rare bulk invalidation).
+     * @return The number of entries removed.
+     */
+    template <typename Pred>
+    size_t eraseIf(Pred pred) {
+        size_t removed = 0;
+        for (auto it = map_.begin(); it != map_.end();) {
+            if (pred(it->first)) {
+                unlink(&it->second);
+                bytes_ -= it->second.size;
+                it = map_.erase(it);
+                removed++;
+            } else {
+                ++it;
+            }
+        }
+        return removed;
+    }
+
+    void clear() {
+        map_.clear();
+        head_ = tail_ = nullptr;
+        bytes_ = 0;
+    }
+
+    // Records a lookup that missed and was deliberately not admitted.
+    void noteBypass() { stats_.bypasses++; }
+    void resetStats() { stats_ = Stats(); }
+
+    // Least recently used key, or nullptr when empty.
+    const std::string* lruKey() const { return tail_ ? tail_->key : nullptr; }
+
+    size_t count() const { return map_.size(); }
+    size_t bytes() const { return bytes_; }
+    size_t capacity() const { return capacity_; }
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Node {
+        V value;
+        size_t size;
+        const std::string* key; // Points at the map's own key
+        Node* prev;             // Towards head (more recent)
+        Node* next;             // Towards tail (less recent)
+    };
+
+    void linkFront(Node* node) {
+        node->prev = nullptr;
+        node->next = head_;
+        if (head_) head_->prev = node;
+        head_ = node;
+        if (!tail_) tail_ = node;
+    }
+
+    void unlink(Node* node) {
+        if (node->prev) node->prev->next = node->next;
+        else head_ = node->next;
+        if (node->next) node->next->prev = node->prev;
+        else tail_ = node->prev;
+        node->prev = node->next = nullptr;
+    }
+
+    void moveToFront(Node* node) {
+        if (node == head_) return;
+        unlink(node);
+        linkFront(node);
+    }
+
+    void evictTail() {
+        Node* victim = tail_;
+        unlink(victim);
+        bytes_ -= victim->size;
+        stats_.evictions++;
+        map_.erase(map_.find(*victim->key)); // Erase by iterator: the key lives inside the victim
+    }
+
+    std::unordered_map<std::string, Node> map_;
+    Node* head_ = nullptr;
+    Node* tail_ = nullptr;
+    size_t bytes_ = 0;
+    size_t capacity_;
+    Stats stats_;
+};
+
+#endif // LRU_CACHE_H
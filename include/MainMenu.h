@@ -25,6 +25,7 @@ private:
     
     std::vector<MenuItem> menuItems_;
     int selectedIndex_;
+    int prefetchIndex_; // Selection last handed to Prefetcher, -1 if none
     VerticalListAnimation animation_;
     
     // State for continuous scrolling
@@ -0,0 +1,114 @@
+#ifndef MP3_SEEK_TABLE_H
+#define MP3_SEEK_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Maps playback time to byte offsets in an MP3 file, and back.
+ *
+ * Built once from the file: the Xing/Info TOC or VBRI table if the encoder wrote
+ * one, a linear map if every sampled frame has the same bitrate (CBR), and otherwise
+ * a walk over every frame header (headerless VBR). Either way it ends up as byte
+ * offsets at evenly spaced times, so a seek is one lookup plus a short read to
+ * resync on the next frame header (findFrame()), however long the file.
+ *
+ * A Xing TOC has 100 points of 8 bits: ~1 s out on a 4 minute track, but ~30 s on a
+ * two hour mix. VBR files longer than SCAN_ABOVE_MS are therefore walked too when
+ * allowed, keeping a point every POINT_SPACING_MS (MAX_POINTS at most).
+ *
+ * serialize()/parse() store it in a text field of the music library index, so a
+ * seek doesn't have to read the header (or walk the file) again.
+ */
+class Mp3SeekTable {
+public:
+    // The bytes of the file; the device reads an uncached File or the player's source.
+    class Source {
+    public:
+        virtual ~Source() = default;
+        virtual size_t readAt(uint64_t offset, uint8_t* buf, size_t len) = 0;
+        virtual uint64_t size() = 0;
+    };
+
+    enum class Kind : char { NONE = '-', XING = 'X', VBRI = 'V', CBR = 'C', SCANNED = 'S' };
+
+    struct FrameHeader {
+        uint32_t sampleRate;
+        uint16_t samplesPerFrame;
+        uint16_t bitrateKbps;
+        uint16_t bytes;     // The whole frame, header and padding included
+        uint8_t version;    // Header bits 19-20
+        uint8_t layer;      // Header bits 17-18
+        bool mono;
+    };
+
+    static constexpr size_t XING_POINTS = 100;
+    static constexpr size_t MAX_POINTS = 1024;
+    static constexpr uint32_t POINT_SPACING_MS = 10 * 1000;   // Of a walked table
+    static constexpr uint32_t SCAN_ABOVE_MS = 20 * 60 * 1000; // Header TOC ~5 s out from here
+    static constexpr size_t RESYNC_WINDOW = 8 * 1024;        // Frames are at most 2881 bytes
+
+    // Decodes a frame header; false for anything that isn't a valid one.
+    static bool parseHeader(const uint8_t* bytes, FrameHeader& out);
+
+    /**
+     * @brief Reads the file's tags and first frame, and the frames after it if needed.
+     * @param allowScan Walk every frame of a headerless or long VBR file (it reads the
+     * whole file). Without it a headerless file is mapped linearly from its first
+     * frame's bitrate, like CBR.
+     */
+    bool build(Source& source, bool allowScan = true);
+
+    /**
+     * @brief First frame at or after `offset` whose successor is also a frame of the
+     * same stream, searched up to RESYNC_WINDOW bytes on. A stray sync word in the
+     * audio data rarely passes both checks.
+     * @return The frame's offset, or -1 if there is none in the window.
+     */
+    int64_t findFrame(Source& source, uint64_t offset) const;
+
+    bool isValid() const { return kind_ != Kind::NONE; }
+    Kind getKind() const { return kind_; }
+    uint32_t getSampleRate() const { return sampleRate_; }
+    uint32_t getFrameCount() const { return frames_; }
+    uint32_t getDataStart() const { return dataStart_; }
+    uint32_t getDataEnd() const { return dataEnd_; }
+    uint32_t getDurationMs() const;
+
+    // Where to start reading for `ms` into the track (not yet on a frame boundary).
+    uint32_t byteForMs(uint32_t ms) const;
+    // The time at which the audio at `offset` plays; the inverse of byteForMs().
+    uint32_t msForByte(uint64_t offset) const;
+
+    // "kind,rate,samples per frame,frames,data start,data end[,hex points]"
+    std::string serialize() const;
+    bool parse(std::string_view text);
+
+private:
+    bool readXing(Source& source, uint32_t framePos, const FrameHeader& first);
+    bool readVbri(Source& source, uint32_t framePos);
+    bool checkConstantBitrate(Source& source, const FrameHeader& first);
+    bool scanFrames(Source& source);
+    size_t pointsFor(uint32_t durationMs) const;
+    // Point i: the stream fraction (of 65536) at which time fraction i/points starts.
+    // No points at all is a linear map.
+    uint32_t pointAt(size_t i) const {
+        if (i < points_.size()) return points_[i];
+        return (i == 0) ? 0 : 65536;
+    }
+    size_t pointCount() const { return points_.empty() ? 1 : points_.size(); }
+    int pointDigits() const { return kind_ == Kind::XING ? 2 : 4; } // Xing's TOC has 8 bits a point
+
+    Kind kind_ = Kind::NONE;
+    uint32_t sampleRate_ = 0;
+    uint16_t samplesPerFrame_ = 0;
+    uint32_t frames_ = 0;
+    uint32_t dataStart_ = 0; // First frame (the Xing/VBRI frame if there is one)
+    uint32_t dataEnd_ = 0;   // After the last frame
+    std::vector<uint16_t> points_;
+};
+
+#endif // MP3_SEEK_TABLE_H
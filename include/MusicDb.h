@@ -0,0 +1,152 @@
+#ifndef MUSIC_DB_H
+#define MUSIC_DB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The music library as one binary file, read into PSRAM whole and used in place.
+ *
+ * Layout (little-endian, as on the device and the hosts it is tested on):
+ *  - Header
+ *  - TrackRecord[trackCount]: grouped by directory, by name within one, so each
+ *    directory's tracks are a range [firstTrack, firstTrack + trackCount)
+ *  - DirRecord[dirCount]: breadth-first from the root (id 0), children by name, so
+ *    each directory's subdirectories are a range too
+ *  - uint16_t durationOrder[trackCount]: track ids, the same ranges sorted by duration
+ *  - The string pool: NUL-terminated names, paths and seek tables, each stored once
+ *    (offset 0 is "")
+ *
+ * Records hold pool offsets, not pointers, so load() only checks the file (magic,
+ * version, CRC32 over everything after the header, every offset and range) and keeps
+ * pointers into the buffer: no per-track allocation, and a copy of a MusicDb shares
+ * the buffer. Tracks are referred to by TrackId; ids are only valid for the MusicDb
+ * they came from, so whoever keeps ids keeps that MusicDb (a re-index builds a new one).
+ */
+class MusicDb {
+public:
+    using TrackId = uint16_t;
+    using DirId = uint16_t;
+
+    static constexpr char MAGIC[4] = {'K', 'M', 'D', 'B'};
+    static constexpr uint16_t FORMAT_VERSION = 2; // 2: file size and modification time per track
+    static constexpr size_t MAX_TRACKS = 65535;
+    static constexpr size_t MAX_DIRS = 65535;
+    static constexpr DirId NO_DIR = 0xFFFF;
+    static constexpr DirId ROOT = 0;
+
+    enum class Order : uint8_t { NAME, DURATION };
+
+    struct Header {
+        char magic[4];
+        uint16_t version;
+        uint16_t headerSize;
+        uint32_t trackCount;
+        uint32_t dirCount;
+        uint32_t poolSize;
+        uint32_t crc; // CRC32 of every byte after the header
+        uint32_t reserved[2];
+    };
+
+    struct TrackRecord {
+        uint32_t name;       // Pool offsets
+        uint32_t seekTable;  // Mp3SeekTable::serialize(), "" if the file couldn't be read
+        uint32_t durationMs;
+        uint32_t fileSize;   // As indexed: a file whose size or time differs is read again
+        uint32_t lastWrite;  // Seconds since the epoch, 0 if unknown
+        DirId dir;
+        uint16_t flags;      // None yet
+    };
+
+    struct DirRecord {
+        uint32_t name;
+        uint32_t path;
+        DirId parent;        // NO_DIR for the root
+        uint16_t childCount;
+        uint32_t firstChild;
+        uint32_t firstTrack;
+        uint32_t trackCount;
+    };
+
+    /**
+     * @brief Collects the library in any order and lays it out as a MusicDb file.
+     */
+    class Builder {
+    public:
+        // The first directory added is the root; its name is the last part of `path`.
+        DirId addDir(const std::string& path, DirId parent);
+        void addTrack(DirId dir, const std::string& name, uint32_t durationMs, const std::string& seekTable,
+                      uint32_t fileSize, uint32_t lastWrite);
+        size_t getTrackCount() const { return tracks_.size(); }
+        // The file's bytes; empty if there are more tracks or directories than ids.
+        std::vector<uint8_t> finish();
+
+    private:
+        struct PendingDir {
+            std::string path;
+            std::string name;
+            DirId parent;
+        };
+        struct PendingTrack {
+            std::string name;
+            std::string seekTable;
+            uint32_t durationMs;
+            uint32_t fileSize;
+            uint32_t lastWrite;
+            DirId dir;
+        };
+
+        uint32_t intern(const std::string& text);
+
+        std::vector<PendingDir> dirs_;
+        std::vector<PendingTrack> tracks_;
+        std::vector<char> pool_;
+        std::unordered_map<std::string, uint32_t> interned_;
+    };
+
+    /**
+     * @brief Checks `size` bytes of `data` and uses them in place; the MusicDb (and its
+     * copies) keep the buffer alive. Bytes past the end of the pool are ignored.
+     * @return false, leaving the MusicDb empty, if the data is not an intact MusicDb.
+     */
+    bool load(std::shared_ptr<const uint8_t> data, size_t size);
+    void clear();
+    bool isLoaded() const { return data_ != nullptr; }
+
+    size_t getTrackCount() const { return trackCount_; }
+    size_t getDirCount() const { return dirCount_; }
+
+    const char* getTrackName(TrackId id) const { return pool_ + tracks_[id].name; }
+    uint32_t getTrackDurationMs(TrackId id) const { return tracks_[id].durationMs; }
+    const char* getTrackSeekTable(TrackId id) const { return pool_ + tracks_[id].seekTable; }
+    DirId getTrackDir(TrackId id) const { return tracks_[id].dir; }
+    uint32_t getTrackFileSize(TrackId id) const { return tracks_[id].fileSize; }
+    uint32_t getTrackLastWrite(TrackId id) const { return tracks_[id].lastWrite; }
+    // Allocates: for playback, not for drawing lists.
+    std::string getTrackPath(TrackId id) const;
+
+    const char* getDirName(DirId id) const { return pool_ + dirs_[id].name; }
+    const char* getDirPath(DirId id) const { return pool_ + dirs_[id].path; }
+    size_t getChildDirCount(DirId id) const { return dirs_[id].childCount; }
+    DirId getChildDir(DirId id, size_t index) const { return (DirId)(dirs_[id].firstChild + index); }
+    size_t getDirTrackCount(DirId id) const { return dirs_[id].trackCount; }
+    TrackId getDirTrack(DirId id, size_t index, Order order = Order::NAME) const;
+
+    bool findDir(const std::string& path, DirId& id) const;
+    bool findTrack(const std::string& path, TrackId& id) const;
+
+private:
+    std::shared_ptr<const uint8_t> data_;
+    const TrackRecord* tracks_ = nullptr;
+    const DirRecord* dirs_ = nullptr;
+    const uint16_t* durationOrder_ = nullptr;
+    const char* pool_ = nullptr;
+    size_t trackCount_ = 0;
+    size_t dirCount_ = 0;
+};
+
+#endif // MUSIC_DB_H
@@ -2,35 +2,40 @@
 #define MUSIC_LIBRARY_DATA_SOURCE_H
 
 #include "IListMenuDataSource.h"
+#include "EventDispatcher.h"
+#include "MusicDb.h"
 #include <vector>
 #include <string>
 
 // Class name updated
-class MusicLibraryDataSource : public IListMenuDataSource {
+class MusicLibraryDataSource : public IListMenuDataSource, public ISubscriber {
 public:
     MusicLibraryDataSource();
 
     int getNumberOfItems(App* app) override;
-    bool drawCustomEmptyMessage(App* app, U8G2& display) override; 
     void drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int h, int w, bool isSelected) override;
     void onItemSelected(App* app, ListMenu* menu, int index) override;
     void onEnter(App* app, ListMenu* menu, bool isForwardNav) override;
     void onExit(App* app, ListMenu* menu) override;
     void onUpdate(App* app, ListMenu* menu) override;
+    // The background indexer's progress and completion, from MusicLibraryManager::loop().
+    void onEvent(const Event& event) override;
 
 private:
     enum class ItemType { PLAYLIST, REINDEX };
 
     struct PlaylistItem {
-        std::string name;
-        std::string path;
+        MusicDb::DirId dir; // Unused for REINDEX
         ItemType type;
     };
 
-    void loadPlaylists();
+    void loadPlaylists(App* app);
 
+    App* app_ = nullptr;
+    MusicDb db_;
     std::vector<PlaylistItem> items_;
-    bool isReindexing_ = false;
+    uint8_t indexProgress_ = 0;
+    char reindexLabel_[32];
     bool needsReload_ = false;
 };
 
@@ -3,6 +3,10 @@
 
 #include <string>
 #include "SdCardManager.h"
+#include "Mp3SeekTable.h"
+#include "MusicDb.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 class App;
 
@@ -10,20 +14,59 @@ class App;
 
 class MusicLibraryManager : public Service {
 public:
+    enum class IndexState { IDLE, RUNNING, DONE, CANCELLED, FAILED };
+
     MusicLibraryManager();
     void setup(App* app) override;
+    // Publishes the indexer's progress and, once it ends, swaps its database in.
+    void loop() override;
+
+    /**
+     * @brief Re-indexes the music folder on a low-priority task (MusicLibraryScan: only
+     * new and changed files are read). MusicIndexProgressEvent and MusicIndexFinishedEvent
+     * follow from loop(). Returns false if a run is already going or the task can't start.
+     */
+    bool startIndexing();
+    // Stops after the directory or file in hand; the library stays as it was.
+    void cancelIndexing();
+    bool isIndexing() const { return indexState_ != IndexState::IDLE; }
+    uint8_t getIndexProgress() const { return indexProgress_; } // 0-100 while indexing
+
+    // The same pass on the calling task, e.g. from a host harness. Returns true if the library was replaced.
+    bool buildIndex();
 
-    // Main indexing function to be called at boot
-    void buildIndex();
+    /**
+     * @brief The library as last indexed (empty if it never was), read from the card on
+     * first use. A copy: it stays valid, ids and all, across a re-index. A card indexed
+     * before the database existed (text indexes, no database) starts one re-index.
+     */
+    MusicDb getDb();
 
-    // The name of our index files
-    static constexpr const char* INDEX_FILENAME = "_index.txt";
+    // The track's seek table from the file's own headers, for one the library doesn't have.
+    static bool loadSeekTable(const std::string& trackPath, Mp3SeekTable& table);
 
 private:
-    // Recursive function to create index files in each directory
-    void createIndexForDirectory(const char* path);
+    static void indexTaskEntry(void* param);
+    IndexState runIndex(); // Leaves a new database in indexResult_ when it returns DONE
+    bool loadDb(MusicDb& out);
+    void loadDbOnce(); // Sets upgradePending_ if there is only a text-format library
+
+    static constexpr uint32_t INDEX_TASK_STACK_SIZE = 8192;
+    static constexpr UBaseType_t INDEX_TASK_PRIORITY = 1; // Below the UI loop
+    static constexpr BaseType_t INDEX_TASK_CORE = 0;
 
     App* app_;
+    MusicDb db_;
+    bool dbLoadAttempted_;
+    bool upgradePending_;
+
+    // --- Background indexing: the task owns these while indexState_ is RUNNING ---
+    MusicDb indexPrevious_;
+    MusicDb indexResult_;
+    volatile IndexState indexState_;
+    volatile uint8_t indexProgress_;
+    volatile bool cancelRequested_;
+    uint8_t publishedProgress_;
 };
 
-#endif // MUSIC_LIBRARY_MANAGER_H
\ No newline at end of file
+#endif // MUSIC_LIBRARY_MANAGER_H
@@ -0,0 +1,96 @@
+#ifndef MUSIC_LIBRARY_SCAN_H
+#define MUSIC_LIBRARY_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "MusicDb.h"
+
+/**
+ * @brief One incremental pass over the music folder, producing a new MusicDb.
+ *
+ * Done in small steps so the caller can stop between any two: first the directories,
+ * one listing per step, then the tracks that need reading, one file per step. A track
+ * the previous database has at the same path with the same size and modification time
+ * is carried over as it is; only new and changed files are read. Whatever the listings
+ * no longer show is simply not carried over.
+ */
+class MusicLibraryScan {
+public:
+    struct Entry {
+        std::string name;
+        uint32_t size;
+        uint32_t lastWrite; // 0 if unknown: then only the size tells a change
+        bool isDir;
+    };
+
+    // The card; SdCardManager and Mp3SeekTable on the device.
+    class Source {
+    public:
+        virtual ~Source() = default;
+        virtual bool listDir(const std::string& path, std::vector<Entry>& out) = 0;
+        // The track's length and Mp3SeekTable::serialize(); false if it can't be read.
+        virtual bool readTrack(const std::string& path, uint32_t& durationMs, std::string& seekTable) = 0;
+    };
+
+    struct Stats {
+        size_t dirs;
+        size_t kept;    // Unchanged, taken from the previous database
+        size_t added;   // New paths, read
+        size_t changed; // Size or time differed, read again
+        size_t removed; // In the previous database, gone from the card
+        size_t skipped; // Past MusicDb::MAX_TRACKS
+    };
+
+    static constexpr const char* TRACK_EXTENSION = ".mp3";
+    // The per-directory text index the library used before MusicDb; no longer read.
+    static constexpr const char* LEGACY_INDEX_NAME = "_index.txt";
+
+    MusicLibraryScan(Source& source, const MusicDb& previous, const std::string& root);
+
+    /**
+     * @brief Lists one directory or reads one track.
+     * @return false once there is nothing left to do; then call finish().
+     */
+    bool step();
+    // 0-99 while steps remain. Directories found later can hold it back, never move it down.
+    uint8_t getPercent() const { return percent_; }
+    const Stats& getStats() const { return stats_; }
+    // Every LEGACY_INDEX_NAME the listings showed, for the caller to delete once the new database is written.
+    const std::vector<std::string>& getLegacyIndexes() const { return legacyIndexes_; }
+    // The new database's bytes; empty if the root couldn't be listed.
+    std::vector<uint8_t> finish();
+
+private:
+    struct PendingDir {
+        std::string path;
+        MusicDb::DirId parent;
+    };
+    struct PendingTrack {
+        std::string path;
+        size_t nameOffset;
+        uint32_t size;
+        uint32_t lastWrite;
+        MusicDb::DirId dir;
+    };
+
+    void listNextDir();
+    void readNextTrack();
+    void updatePercent();
+
+    Source& source_;
+    MusicDb previous_;
+    MusicDb::Builder builder_;
+    std::deque<PendingDir> dirs_;
+    std::vector<PendingTrack> tracks_;
+    size_t nextTrack_ = 0;
+    size_t trackTotal_ = 0; // Kept plus pending, against MusicDb::MAX_TRACKS
+    std::vector<Entry> entries_;
+    std::vector<std::string> legacyIndexes_;
+    Stats stats_ = {};
+    uint8_t percent_ = 0;
+};
+
+#endif // MUSIC_LIBRARY_SCAN_H
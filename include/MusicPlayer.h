@@ -10,9 +10,11 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 
-#include "AudioOutputMixer.h"
+#include "AudioSlotMixer.h"
+#include "MusicDb.h"
 
 class AudioGeneratorMP3;
+class Mp3SeekTable;
 class AudioFileSource; 
 class App;
 
@@ -20,15 +22,10 @@ class App;
 
 class MusicPlayer : public Service {
 public:
-    struct PlaylistTrack {
-        std::string path;
-        int duration;
-    };
-
     using SongFinishedCallback = std::function<void()>;
     enum class State { STOPPED, LOADING, PLAYING, PAUSED };
     enum class RepeatMode { REPEAT_OFF, REPEAT_ALL, REPEAT_ONE };
-    enum class PlaybackAction { NONE, NEXT, PREV };
+    enum class PlaybackAction { NONE, NEXT, PREV, SEEK };
 
     MusicPlayer();
     ~MusicPlayer();
@@ -38,19 +35,25 @@ public:
     bool allocateResources();
     void releaseResources();
 
-    void queuePlaylist(const std::string& name, const std::vector<PlaylistTrack>& tracks, int startIndex);
+    // `tracks` are ids in `db`, which the player keeps (a copy) for as long as the queue lasts.
+    void queuePlaylist(const std::string& name, const MusicDb& db, std::vector<MusicDb::TrackId> tracks, int startIndex);
     void startQueuedPlayback();
     void pause();
     void resume();
     void stop();
     void nextTrack();
     void prevTrack();
+    // Relative to where playback is, or to a seek still pending; applied by serviceRequest().
+    void seekBy(int seconds);
     void serviceRequest();
     void toggleShuffle();
     void cycleRepeatMode();
     void setVolume(uint8_t volumePercent); 
+    void setCrossfade(uint8_t seconds); // 0 plays tracks back to back, gaplessly
     void setSongFinishedCallback(SongFinishedCallback cb);
     void songFinished();
+    // UI loop: catches up with a track change the mixer task made, and pre-opens the next track.
+    void serviceNextTrack();
 
     State getState() const;
     RepeatMode getRepeatMode() const;
@@ -62,28 +65,75 @@ public:
     float getPlaybackProgress() const;
     int getTotalDuration() const;
     int getCurrentTime() const;
+    // From the samples the output has played: pauses, underruns and VBR don't skew it.
+    uint32_t getPositionMs() const;
     bool isServiceRunning() const;
 
+    static constexpr uint8_t MAX_CROSSFADE_SECONDS = 12;
+    static constexpr int SEEK_STEP_SECONDS = 10;
+
 private:
+    // A queued track, resolved from the library when it is about to play.
+    struct PlaylistTrack {
+        std::string path;
+        int duration;
+        MusicDb::TrackId id;
+    };
+
+    static constexpr int PRELOAD_LEAD_SECONDS = 10; // Before the end (plus the crossfade) the next track opens
+    static constexpr uint32_t SEEK_END_GUARD_MS = 1000;  // A seek lands no closer to the end
+    static constexpr uint32_t RESUME_MIN_MS = 5000;      // Stopped earlier (or this close to the end): start over
+
     static void mixerTaskWrapper(void* param);
     void mixerTaskLoop();
 
-    void startPlayback(const PlaylistTrack& track);
+    void startPlayback(const PlaylistTrack& track, uint32_t startMs = 0);
     void stopPlayback();
+    void seekTo(uint32_t ms);
+    bool isSlotAudible(int slot) const;
+    void saveResumePoint();
+    void loadResumePoint();
+    uint32_t takeResumePoint(const std::string& path);
     void playNextInPlaylist(bool songFinishedNaturally = true);
     void generateShuffledIndices();
+    void setCurrentTrack(const PlaylistTrack& track);
+    PlaylistTrack getCurrentTrack() const;
+    PlaylistTrack resolveTrack(MusicDb::TrackId id) const;
+    bool loadSeekTable(const PlaylistTrack& track, Mp3SeekTable& table) const;
+    void releaseSlot(int slot); // Caller holds audioSlotMutex_
+
+    bool peekNextTrack(int& index, PlaylistTrack& track) const;
+    void prepareNextTrack();
+    void cancelPreparedTrack();
+    void commitHandoff();
+    void runPreparedSlot(int slot);
+    bool switchToPrepared(int fromSlot, bool crossfade);
+    uint32_t estimateRemainingMs(int slot);
 
     App* app_;
     bool resourcesAllocated_;
 
     AudioOutputPDM* out_;
-    AudioOutputMixer* mixer_;
+    AudioSlotMixer* mixer_;
     
     AudioFileSource* source_file_[2]; 
     AudioFileSource* id3_filter_[2]; 
     AudioGeneratorMP3* mp3_[2];
-    AudioOutputMixerStub* stub_[2];
+    AudioSlotMixer::Input* input_[2]; // Owned by mixer_
     volatile int currentSlot_;
+    int playingSlot_;             // The slot of the track on screen; trails currentSlot_ until it is heard
+    uint32_t audioStartPos_[2];
+    uint32_t startOffsetMs_[2];   // Where in its track each slot started decoding (after a seek)
+
+    // --- Gapless playback: the next track waits, pre-rolled, in the idle slot ---
+    volatile int preparedSlot_;     // -1 if none
+    volatile bool preparedReady_;   // Its decoder has begun; the mixer task may run it
+    volatile int fadingSlot_;       // The previous track while it fades out, or -1
+    volatile bool handoffPending_;  // The mixer task moved on to the prepared track
+    bool prepareAttempted_;         // Once per track, even if opening failed
+    PlaylistTrack preparedTrack_;
+    int preparedIndex_;
+    uint32_t crossfadeMs_;
 
     volatile State currentState_;
     RepeatMode repeatMode_;
@@ -92,18 +142,21 @@ private:
     bool _isLoadingTrack;
     float currentGain_; 
     
-    std::vector<PlaylistTrack> currentPlaylist_;
+    MusicDb playlistDb_;
+    std::vector<MusicDb::TrackId> currentPlaylist_;
     std::vector<int> shuffledIndices_;
     int playlistTrackIndex_;
     
+    MusicDb::TrackId currentTrackId_;
     std::string currentTrackPath_;
     std::string currentTrackName_;
     std::string playlistName_;
     int currentTrackDuration_;
-    
-    // Timer-based progress tracking state
-    unsigned long playbackStartTimeMs_;
-    unsigned long accumulatedPlayedTimeMs_;
+    uint32_t seekTargetMs_;
+
+    // Where the last session stopped, applied if the queue starts with that track
+    std::string resumePath_;
+    uint32_t resumeMs_;
 
     TaskHandle_t mixerTaskHandle_; 
     SongFinishedCallback songFinishedCallback_;
@@ -2,6 +2,7 @@
 #define OTA_MANAGER_H
 
 #include <vector>
+#include <functional>
 #include "Firmware.h"
 #include <ESPAsyncWebServer.h>
 #include <SD.h> // Include for File object
@@ -28,6 +29,7 @@ struct OtaProgress {
 
 
 #include "Service.h"
+#include "ReadAheadStream.h"
 
 class OtaManager : public Service {
 public:
@@ -41,6 +43,9 @@ public:
     void startSdUpdate(const FirmwareInfo& fwInfo);
     void stop();
     void scanSdForFirmware();
+    // Walks the SD firmware folder without touching OtaManager state, so it is safe to call
+    // from a loader task. `onFound` returns false to stop the walk early.
+    static void forEachSdFirmware(const std::function<bool(const FirmwareInfo&)>& onFound);
 
     // --- State Getters ---
     OtaState getState() const;
@@ -54,8 +59,14 @@ private:
     void saveCurrentFirmware(const FirmwareInfo& info);
     void resetState();
     void enterTerminalState();
+    // Closes the web upload and tells SdCardManager the write is over, so it may be cached again.
+    void closeUploadFile();
     void loopFlashing(); // <-- NEW FUNCTION FOR CHUNKED WRITING
 
+    // Read-ahead window for the image being flashed: 4 x 32 KB of PSRAM.
+    static constexpr size_t FLASH_BLOCK_SIZE = 32 * 1024;
+    static constexpr size_t FLASH_BLOCK_COUNT = 4;
+
     // --- Basic OTA ---
     void setupArduinoOta();
 
@@ -81,7 +92,8 @@ private:
     std::vector<FirmwareInfo> availableSdFirmwares_;
 
     // OTA process state
-    File uploadFile_;
+    File uploadFile_;           // Web upload being written to the card
+    ReadAheadStream flashStream_; // Image being flashed
     FirmwareInfo pendingFwInfo_; // Generic for SD or Web
     bool uploadError_;
 };
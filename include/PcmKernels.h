@@ -0,0 +1,42 @@
+#ifndef PCM_KERNELS_H
+#define PCM_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Whole-block PCM arithmetic for the audio path, in fixed point.
+ *
+ * Gains are Q2.14 (16384 is unity): a Q2.6 gain from ESP8266Audio's SetGain()
+ * shifted up 8 bits gives results bit-exact with the per-sample chain they replace
+ * (Amplify() on each mixer input, a saturating sum, then the PDM output's (L + R) / 2
+ * downmix), and the spare bits give crossfades a smooth curve.
+ *
+ * Built with USE_ESP_DSP_MIXER on an ESP32-S3 with esp-dsp available, the gains run
+ * on the PIE vector unit (dsps_mul_s16 with the shift taking the Q2.14 scale), and
+ * the scalar loop stays for whatever that can't apply exactly. The flag is off by
+ * default: that path has not yet been run on a device against the scalar output.
+ */
+namespace PcmKernels {
+
+    constexpr size_t MAX_INPUTS = 2;
+    constexpr int32_t SAMPLE_MAX = 32767; // Amplify() clips symmetrically
+    constexpr int GAIN_SHIFT = 14;
+
+    inline uint16_t gainFromQ6(uint8_t gainQ6) {
+        return (uint16_t)(gainQ6 << (GAIN_SHIFT - 6)); // 255 << 8 keeps 32768 * gain inside int32_t
+    }
+
+    inline int32_t clip(int32_t v) {
+        return v > SAMPLE_MAX ? SAMPLE_MAX : (v < -SAMPLE_MAX ? -SAMPLE_MAX : v);
+    }
+
+    /**
+     * @brief out[i] = downmix(sum over inputs of gain * frame i), for `frames` interleaved
+     * stereo frames per input. `out` may not alias an input.
+     */
+    void mixToMono(int16_t* out, const int16_t* const* inputs, const uint16_t* gainsQ14, size_t inputCount, size_t frames);
+
+} // namespace PcmKernels
+
+#endif // PCM_KERNELS_H
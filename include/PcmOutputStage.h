@@ -0,0 +1,107 @@
+#ifndef PCM_OUTPUT_STAGE_H
+#define PCM_OUTPUT_STAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include "PcmRing.h"
+
+/**
+ * @brief The last stage of the audio pipeline: mono samples from a PcmRing, out to a
+ * stereo Sink one DMA block at a time.
+ *
+ * On the device the sink is the I2S driver and pump() runs on its own task, so the
+ * DAC is fed from the ring however late the decoder is. A Sink may take fewer frames
+ * than offered (e.g. an I2S write timing out while paused); the rest go first on
+ * the next pump().
+ *
+ * A FileSink in place of I2S captures the exact samples a track would have sent
+ * to the DAC.
+ */
+class PcmOutputStage {
+public:
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        // Interleaved 16-bit stereo. Returns the frames taken; may block.
+        virtual size_t write(const int16_t* frames, size_t frameCount) = 0;
+    };
+
+    // Raw 16-bit little-endian stereo into an open stdio file.
+    class FileSink : public Sink {
+    public:
+        explicit FileSink(FILE* file) : file_(file) {}
+        size_t write(const int16_t* frames, size_t frameCount) override {
+            return fwrite(frames, 2 * sizeof(int16_t), frameCount, file_);
+        }
+
+    private:
+        FILE* file_;
+    };
+
+    struct Stats {
+        uint32_t framesOut;
+        uint32_t underruns; // Times the ring ran dry mid-stream and playback later resumed
+        uint32_t minFill;   // Samples in the ring, lowest seen while streaming
+        uint32_t maxFill;
+    };
+
+    static constexpr size_t BLOCK_FRAMES = 256; // One I2S DMA buffer
+
+    PcmOutputStage(PcmRing& ring, Sink& sink) : ring_(ring), sink_(sink) { resetStats(); }
+
+    /**
+     * @brief Sends one block, or what the ring holds if less, to the sink.
+     * @return The frames the sink took; 0 when there was nothing to send.
+     */
+    size_t pump() {
+        if (pendingFrames_ == 0) {
+            uint32_t fill = ring_.available();
+            bool streaming = streaming_.load(std::memory_order_relaxed);
+            if (streaming) {
+                if (fill < stats_.minFill) stats_.minFill = fill;
+                if (fill > stats_.maxFill) stats_.maxFill = fill;
+            } else {
+                starved_ = false;
+            }
+            uint32_t count = ring_.read(mono_, BLOCK_FRAMES);
+            if (count == 0) {
+                if (streaming) starved_ = true;
+                return 0;
+            }
+            if (starved_) stats_.underruns++; // The gap was heard
+            starved_ = false;
+            for (uint32_t i = 0; i < count; ++i) {
+                stereo_[2 * i] = mono_[i];
+                stereo_[2 * i + 1] = mono_[i];
+            }
+            pendingOffset_ = 0;
+            pendingFrames_ = count;
+        }
+        size_t sent = sink_.write(stereo_ + 2 * pendingOffset_, pendingFrames_);
+        pendingOffset_ += sent;
+        pendingFrames_ -= sent;
+        stats_.framesOut += sent;
+        return sent;
+    }
+
+    // Only while streaming (playing, not paused or between tracks) does a dry ring count.
+    void setStreaming(bool streaming) { streaming_.store(streaming, std::memory_order_relaxed); }
+
+    const Stats& getStats() const { return stats_; }
+    void resetStats() { stats_ = {0, 0, UINT32_MAX, 0}; }
+
+private:
+    PcmRing& ring_;
+    Sink& sink_;
+    std::atomic<bool> streaming_{false};
+    bool starved_ = false; // Output task only
+    Stats stats_;
+    int16_t mono_[BLOCK_FRAMES];
+    int16_t stereo_[2 * BLOCK_FRAMES];
+    size_t pendingOffset_ = 0;
+    size_t pendingFrames_ = 0;
+};
+
+#endif // PCM_OUTPUT_STAGE_H
@@ -0,0 +1,95 @@
+#ifndef PCM_RING_H
+#define PCM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free single-producer, single-consumer ring of 16-bit PCM samples.
+ *
+ * The decoder writes, the output stage reads; neither ever blocks on the other,
+ * so a slow SD read or a held slot mutex only drains the ring instead of reaching
+ * the DAC. Writes are all-or-nothing per call, so a producer can retry the same
+ * samples later.
+ *
+ * Each cursor has one writer, so they are only ever loaded and stored, never
+ * read-modify-written; the sample buffer is usually PSRAM, with a smaller
+ * internal-RAM fallback when that runs out.
+ */
+class PcmRing {
+public:
+    /**
+     * @param buffer Storage for `capacity` samples.
+     * @param capacity A power of two.
+     */
+    void init(int16_t* buffer, uint32_t capacity) {
+        capacity_ = capacity;
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        discardTo_.store(0, std::memory_order_relaxed);
+        buffer_ = buffer;
+    }
+
+    bool isReady() const { return buffer_ != nullptr; }
+
+    // Producer: copies all `count` samples in, or none if they don't fit.
+    bool write(const int16_t* samples, uint32_t count) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (!buffer_ || count > capacity_ - (head - tail_.load(std::memory_order_acquire))) return false;
+        uint32_t pos = head & (capacity_ - 1);
+        uint32_t first = (count < capacity_ - pos) ? count : capacity_ - pos;
+        memcpy(buffer_ + pos, samples, first * sizeof(int16_t));
+        memcpy(buffer_, samples + first, (count - first) * sizeof(int16_t));
+        head_.store(head + count, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: copies out up to `count` samples; returns how many.
+    uint32_t read(int16_t* out, uint32_t count) {
+        if (!buffer_) return 0;
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t discardTo = discardTo_.load(std::memory_order_acquire);
+        if ((int32_t)(discardTo - tail) > 0) tail = discardTo;
+
+        uint32_t available = head_.load(std::memory_order_acquire) - tail;
+        if (count > available) count = available;
+        uint32_t pos = tail & (capacity_ - 1);
+        uint32_t first = (count < capacity_ - pos) ? count : capacity_ - pos;
+        memcpy(out, buffer_ + pos, first * sizeof(int16_t));
+        memcpy(out + first, buffer_, (count - first) * sizeof(int16_t));
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Any task: the consumer skips everything written so far (e.g. the rest of a
+     * track the user skipped). Samples written after the call are kept.
+     */
+    void discard() { discardTo_.store(head_.load(std::memory_order_acquire), std::memory_order_release); }
+
+    uint32_t available() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    uint32_t space() const { return capacity_ - available(); }
+    uint32_t capacity() const { return capacity_; }
+
+    // Free-running sample counts (they wrap; compare differences). Everything written
+    // so far, and everything read or discarded: the latter is what has been played.
+    uint32_t writePosition() const { return head_.load(std::memory_order_acquire); }
+    uint32_t readPosition() const {
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t discardTo = discardTo_.load(std::memory_order_acquire);
+        return (int32_t)(discardTo - tail) > 0 ? discardTo : tail;
+    }
+
+private:
+    std::atomic<uint32_t> head_{0};      // Written up to here (free-running sample count)
+    std::atomic<uint32_t> tail_{0};      // Read up to here
+    std::atomic<uint32_t> discardTo_{0}; // Reads resume no earlier than this
+    int16_t* buffer_ = nullptr;
+    uint32_t capacity_ = 0;
+};
+
+#endif // PCM_RING_H
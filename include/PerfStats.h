@@ -0,0 +1,109 @@
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "RollingWindow.h"
+
+// Timed or sampled values, each kept as a rolling min/avg/max window.
+enum class PerfMetric : uint8_t {
+    LOOP_US,       // One pass of App::loop
+    SERVICES_US,   // ServiceManager::loop
+    MAIN_FLUSH_US, // Main display sendBuffer (I2C)
+    AUX_FLUSH_US,  // Secondary display draw + sendBuffer
+    FPS,
+    SD_READ_BPS,
+    SD_WRITE_BPS,
+    SNIFFER_PPS,
+    FREE_HEAP,
+    FREE_PSRAM,
+    COUNT
+};
+
+// Event counters, safe to bump from any task; rolled into per-second metrics by tick().
+enum class PerfCounter : uint8_t {
+    FRAMES,
+    SD_READ_BYTES,
+    SD_WRITE_BYTES,
+    SNIFFER_PACKETS,
+    COUNT
+};
+
+enum class PerfHudMode : uint8_t {
+    OFF,
+    MAIN, // Overlay on the main display
+    AUX   // Replaces the secondary display's widgets
+};
+
+/**
+ * @brief Lightweight counters behind the performance HUD.
+ *
+ * Collection is gated on isEnabled(), which is true only while the HUD is shown,
+ * so the hooks left in hot paths cost one load and a branch otherwise.
+ * record() and tick() belong to the main loop; count() may be called from any
+ * task, including Wi-Fi promiscuous callbacks.
+ */
+class PerfStats {
+public:
+    static constexpr size_t WINDOW_SIZE = 32;
+    using Window = RollingWindow<WINDOW_SIZE>;
+
+    static PerfStats& getInstance();
+
+    static bool isEnabled() { return enabled_; }
+
+    static void count(PerfCounter counter, uint32_t amount = 1) {
+        if (!enabled_) return;
+        getInstance().counters_[(size_t)counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    void record(PerfMetric metric, uint32_t value);
+
+    // Rolls counters into rates and samples heap/PSRAM once per second.
+    void tick();
+
+    void setHudMode(PerfHudMode mode);
+    PerfHudMode getHudMode() const { return hudMode_; }
+    void cycleHudMode(int direction);
+
+    const Window& get(PerfMetric metric) const { return metrics_[(size_t)metric]; }
+
+    // Counted since the last tick() and not yet rolled into a rate.
+    uint32_t pending(PerfCounter counter) const { return counters_[(size_t)counter].load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Records the lifetime of the scope into `metric` (microseconds).
+     */
+    class Scope {
+    public:
+        explicit Scope(PerfMetric metric) : metric_(metric), active_(enabled_), start_(active_ ? micros() : 0) {}
+        ~Scope() {
+            if (active_) getInstance().record(metric_, micros() - start_);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        PerfMetric metric_;
+        bool active_;
+        unsigned long start_;
+    };
+
+    // Disable copy/assignment
+    PerfStats(const PerfStats&) = delete;
+    void operator=(const PerfStats&) = delete;
+
+private:
+    PerfStats();
+    void resetAll();
+
+    static constexpr unsigned long ROLL_INTERVAL_MS = 1000;
+
+    static inline volatile bool enabled_ = false;
+
+    PerfHudMode hudMode_;
+    Window metrics_[(size_t)PerfMetric::COUNT];
+    std::atomic<uint32_t> counters_[(size_t)PerfCounter::COUNT];
+    unsigned long lastRollMs_;
+};
+
+#endif // PERF_STATS_H
@@ -2,18 +2,25 @@
 #define PORTAL_LIST_DATA_SOURCE_H
 
 #include "IListMenuDataSource.h"
+#include "AsyncListLoader.h"
 #include <vector>
 #include <string>
 
 class PortalListDataSource : public IListMenuDataSource {
 public:
+    PortalListDataSource();
+
     int getNumberOfItems(App* app) override;
     void drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) override;
     void onItemSelected(App* app, ListMenu* menu, int index) override;
     void onEnter(App* app, ListMenu* menu, bool isForwardNav) override;
     void onExit(App* app, ListMenu* menu) override;
+    void onUpdate(App* app, ListMenu* menu) override;
+    bool isLoading() const override;
+    std::string getPrefetchPath() const override { return SD_ROOT::USER_PORTALS; }
 
 private:
+    AsyncListLoader<std::string> loader_;
     std::vector<std::string> portalNames_;
 };
 
@@ -0,0 +1,57 @@
+#ifndef POSIX_STORAGE_BACKEND_H
+#define POSIX_STORAGE_BACKEND_H
+
+#ifndef ARDUINO // Host builds only; the device mounts through SdFatBackend/ArduinoSdBackend
+
+#include <stdint.h>
+#include <string>
+#include "IStorageBackend.h"
+
+/**
+ * @brief IStorageBackend over a directory on the host, standing in for the SD card.
+ *
+ * "/" maps onto `rootDir`, so SD_ROOT paths work unchanged and nothing outside the
+ * sandbox can be reached ("." and ".." components are refused). Space is reported
+ * for an emulated card of `capacityBytes`: used space is every file in the sandbox
+ * rounded up to `clusterSize`, plus one cluster per directory, the same model
+ * SpaceAccounting keeps, so the two can be checked against each other.
+ *
+ * Semantics follow the SD library where POSIX differs: remove() only deletes
+ * files and rename() never replaces an existing target.
+ */
+class PosixStorageBackend : public IStorageBackend {
+public:
+    explicit PosixStorageBackend(std::string rootDir,
+                                 uint64_t capacityBytes = 1ULL << 30,
+                                 uint32_t clusterSize = 32 * 1024);
+
+    bool begin() override;
+    void end() override { mounted_ = false; }
+    const char* name() const override { return "POSIX"; }
+
+    bool exists(const char* path) override;
+    bool mkdir(const char* path) override;
+    bool remove(const char* path) override;
+    bool rename(const char* pathFrom, const char* pathTo) override;
+    std::unique_ptr<IStorageFile> open(const char* path, StorageMode mode) override;
+
+    uint64_t totalBytes() override { return capacityBytes_; }
+    uint64_t usedBytes() override;
+    uint32_t clusterSize() override { return clusterSize_; }
+
+    const std::string& getRootDir() const { return rootDir_; }
+
+private:
+    // Maps a volume path onto the sandbox. Returns false for paths that would leave it.
+    bool hostPath(const char* path, std::string& out) const;
+    uint64_t usedBelow(const std::string& hostDir) const;
+
+    std::string rootDir_;
+    uint64_t capacityBytes_;
+    uint32_t clusterSize_;
+    bool mounted_;
+};
+
+#endif // ARDUINO
+
+#endif // POSIX_STORAGE_BACKEND_H
@@ -0,0 +1,52 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <string>
+
+class App;
+struct MenuItem;
+
+/**
+ * @brief Warms the SD caches for whatever the highlighted menu item leads to.
+ *
+ * Menus call hover() whenever their selection changes. If the cursor stays on the
+ * same item for DWELL_MS, a low-priority task loads the item's prefetch path into
+ * SdCardManager (directory listing or file contents), so the next menu's onEnter
+ * hits PSRAM instead of the card. Moving the cursor or leaving the menu cancels a
+ * prefetch that has not started yet.
+ */
+class Prefetcher {
+public:
+    static Prefetcher& getInstance();
+
+    // Resolves the item's explicit prefetchPath, falling back to its target menu's.
+    void hover(App* app, const MenuItem& item);
+    // Schedules `path` after the dwell time. An empty path just cancels.
+    void hover(const std::string& path);
+    void cancel();
+
+    // Disable copy/assignment
+    Prefetcher(const Prefetcher&) = delete;
+    void operator=(const Prefetcher&) = delete;
+
+private:
+    Prefetcher();
+    static void taskEntry(void* param);
+    void taskLoop();
+
+    static constexpr unsigned long DWELL_MS = 250;
+    static constexpr uint32_t TASK_STACK_SIZE = 4096;
+    static constexpr UBaseType_t TASK_PRIORITY = 1; // Below the UI loop
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    SemaphoreHandle_t mutex_;
+    TaskHandle_t taskHandle_;
+    std::string pendingPath_;
+    unsigned long armedAtMs_;
+};
+
+#endif // PREFETCHER_H
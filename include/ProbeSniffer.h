@@ -43,8 +43,8 @@ private:
     uint32_t packetCount_;
     
     // --- Data Storage ---
-    File pcapFile_;
-    char currentPcapFilename_[64];
+    static constexpr size_t PCAP_PREALLOCATE_BYTES = 1024 * 1024; // Contiguous space reserved per capture
+    char currentPcapFilename_[64]; // Empty while no capture file is open
     std::vector<std::string> uniqueSsids_; // To show the user what's been found
 
     // --- Channel Hopping ---
@@ -0,0 +1,107 @@
+#ifndef READ_AHEAD_STREAM_H
+#define READ_AHEAD_STREAM_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+/**
+ * @brief Sequential file reader that keeps a window of PSRAM blocks filled ahead of the consumer.
+ *
+ * A small per-stream task reads the file block by block into a ring of
+ * `blockCount` buffers of `blockSize` bytes, so the consumer (audio decoder,
+ * OTA flasher, MD5) copies from PSRAM instead of waiting on SPI for every read.
+ *
+ * Access pattern detection: the window starts fully open. A seek outside the
+ * buffered range restarts the filler at the new position with a depth of one
+ * block, and the depth doubles each time the consumer reads through a block, so
+ * random access (e.g. tag parsing) doesn't drag a whole window off the card.
+ *
+ * If PSRAM or the task can't be had, the stream falls back to plain File reads.
+ * One consumer per stream; the stream itself is not shared between tasks.
+ */
+class ReadAheadStream {
+public:
+    struct Stats {
+        uint32_t bytesRead;
+        uint32_t stalls;          // Reads that had to wait for the filler
+        uint32_t stallMicros;     // Total time spent waiting
+        uint32_t maxStallMicros;
+        uint32_t restarts;        // Non-sequential seeks that reset the window
+    };
+
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+    static constexpr size_t DEFAULT_BLOCK_COUNT = 4;
+    static constexpr size_t MAX_BLOCKS = 8;
+
+    ReadAheadStream();
+    ~ReadAheadStream();
+
+    ReadAheadStream(const ReadAheadStream&) = delete;
+    ReadAheadStream& operator=(const ReadAheadStream&) = delete;
+
+    bool open(const char* path, size_t blockSize = DEFAULT_BLOCK_SIZE, size_t blockCount = DEFAULT_BLOCK_COUNT);
+    void close();
+    bool isOpen() const { return isOpen_; }
+
+    // Blocks until `len` bytes are available or the file ends. Returns the number copied.
+    size_t read(uint8_t* buf, size_t len);
+    bool seek(uint32_t pos);
+    uint32_t position() const { return pos_; }
+    uint32_t size() const { return size_; }
+
+    Stats getStats();
+
+private:
+    enum class BlockState : uint8_t { EMPTY, FILLING, READY };
+
+    struct Block {
+        uint8_t* data;
+        uint32_t offset;
+        uint32_t length;
+        uint32_t generation; // Filled for this window; stale fills are dropped
+        BlockState state;
+    };
+
+    static void taskEntry(void* param);
+    void fillLoop();
+
+    // --- Helpers below expect mutex_ to be held ---
+    Block* readyBlockAtLocked(uint32_t pos);
+    bool isPendingLocked(uint32_t pos) const;
+    bool isReclaimableLocked(const Block& block) const;
+    size_t blocksInUseLocked() const;
+    void restartLocked(uint32_t pos);
+
+    static constexpr uint32_t READ_TIMEOUT_MS = 2000;
+    static constexpr uint32_t TASK_STACK_SIZE = 3072;
+    static constexpr UBaseType_t TASK_PRIORITY = 4; // Below the audio mixer, above the UI loop
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    File file_;
+    bool isOpen_;
+    bool readAhead_;  // false: direct File reads (no PSRAM or no task)
+    uint32_t size_;
+    uint32_t pos_;
+
+    uint8_t* pool_;   // PSRAM: blockCount_ * blockSize_
+    Block blocks_[MAX_BLOCKS];
+    size_t blockSize_;
+    size_t blockCount_;
+
+    // --- Shared with the filler task (guarded by mutex_) ---
+    SemaphoreHandle_t mutex_;
+    SemaphoreHandle_t dataReady_; // Given by the filler after every block
+    SemaphoreHandle_t stopped_;   // Given by the filler as it exits
+    TaskHandle_t taskHandle_;
+    uint32_t nextFetch_;          // File offset of the next block to fill
+    uint32_t generation_;
+    size_t depth_;                // Blocks the filler may hold ahead of the consumer
+    bool ioError_;
+    bool stopping_;
+    Stats stats_;
+};
+
+#endif // READ_AHEAD_STREAM_H
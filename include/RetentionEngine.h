@@ -0,0 +1,106 @@
+#ifndef RETENTION_ENGINE_H
+#define RETENTION_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "IStorageBackend.h"
+
+/**
+ * @brief Size and count budget for the files of one directory.
+ *
+ * Files are ordered oldest first by last write time (then name). Past `flatFiles`
+ * in `dir` itself, the oldest are rolled into dated subdirectories ("2026-10", or
+ * "undated" while the clock was never set) so no single FAT directory grows long.
+ * Past `maxFiles` or `maxBytes`, counted over `dir` and its dated subdirectories,
+ * the oldest are deleted. The newest `keepNewest` are never touched.
+ */
+struct RetentionPolicy {
+    const char* dir;
+    const char* prefix;   // Only names starting with this ("" for any)
+    const char* suffix;   // ...and ending with this ("" for any)
+    uint32_t maxFiles;    // 0: no count budget
+    uint64_t maxBytes;    // 0: no size budget
+    uint32_t flatFiles;   // 0: never roll into subdirectories
+    uint32_t keepNewest;  // E.g. the file a session may still be writing
+};
+
+/**
+ * @brief Applies RetentionPolicy budgets through a Storage.
+ *
+ * It never touches a volume itself: the device hands it a Storage over SdCardManager,
+ * so listings and cached files stay coherent, and BackendStorage runs it straight on
+ * a backend with no cache in between.
+ */
+class RetentionEngine {
+public:
+    struct Entry {
+        std::string name;
+        uint64_t size;
+        time_t lastWrite; // 0 if unknown
+        bool isDir;
+    };
+
+    // The operations the engine needs; the device implements them on SdCardManager.
+    class Storage {
+    public:
+        virtual ~Storage() = default;
+        virtual bool list(const char* dir, std::vector<Entry>& out) = 0; // false if `dir` is missing
+        virtual bool makeDir(const char* path) = 0;
+        virtual bool moveFile(const char* from, const char* to) = 0;
+        virtual bool removeFile(const char* path) = 0;
+    };
+
+    // Storage straight on a backend, with no cache to keep coherent.
+    class BackendStorage : public Storage {
+    public:
+        explicit BackendStorage(IStorageBackend& backend) : backend_(backend) {}
+        bool list(const char* dir, std::vector<Entry>& out) override;
+        bool makeDir(const char* path) override { return backend_.mkdir(path); }
+        bool moveFile(const char* from, const char* to) override { return backend_.rename(from, to); }
+        bool removeFile(const char* path) override { return backend_.remove(path); }
+
+    private:
+        IStorageBackend& backend_;
+    };
+
+    struct Report {
+        uint32_t moved;
+        uint32_t deleted;
+        uint64_t freedBytes;
+        uint32_t failed;
+    };
+
+    explicit RetentionEngine(Storage& storage) : storage_(storage) {}
+
+    /**
+     * @brief Enforces `policy` once, adding to `report`. `shouldStop` is polled between
+     * file operations; returning true abandons the pass (the next one picks up).
+     * @return false if the directory is missing or the pass was stopped.
+     */
+    bool apply(const RetentionPolicy& policy, Report& report, const std::function<bool()>& shouldStop = nullptr);
+
+    // Subdirectory a file last written at `lastWrite` rolls into.
+    static void bucketName(time_t lastWrite, char* out, size_t outSize);
+    static bool isBucketName(const std::string& name);
+
+    static constexpr time_t MIN_VALID_TIME = 1577836800; // 2020-01-01: older stamps mean the clock was unset
+    static constexpr const char* UNDATED_BUCKET = "undated";
+
+private:
+    struct Candidate {
+        std::string path;
+        uint64_t size;
+        time_t lastWrite;
+        bool inBucket; // Already rolled
+    };
+
+    bool collect(const RetentionPolicy& policy, std::vector<Candidate>& out);
+
+    Storage& storage_;
+};
+
+#endif // RETENTION_ENGINE_H
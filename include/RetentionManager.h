@@ -0,0 +1,52 @@
+#ifndef RETENTION_MANAGER_H
+#define RETENTION_MANAGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "RetentionEngine.h"
+#include "Service.h"
+
+class App;
+
+/**
+ * @brief Keeps logs and captures within their budgets (see POLICIES in the .cpp).
+ *
+ * Every PASS_INTERVAL_MS, once nothing has been capturing for IDLE_SETTLE_MS, a
+ * low-priority task runs RetentionEngine over each policy through SdCardManager,
+ * so its caches and space accounting stay right. A capture starting mid-pass stops
+ * it between two file operations; the next pass carries on.
+ */
+class RetentionManager : public Service {
+public:
+    RetentionManager();
+    void setup(App* app) override;
+    void loop() override;
+
+    // Runs a pass at the next idle moment instead of waiting out the interval.
+    void requestPass() { passRequested_ = true; }
+    bool isRunning() const { return running_; }
+    const RetentionEngine::Report& getLastReport() const { return lastReport_; } // Valid when not running
+
+private:
+    bool isIdle();
+    static void taskEntry(void* param);
+    void runPass();
+
+    static constexpr unsigned long FIRST_PASS_DELAY_MS = 60 * 1000; // Let boot-time logging and syncing settle
+    static constexpr unsigned long PASS_INTERVAL_MS = 15 * 60 * 1000;
+    static constexpr unsigned long IDLE_SETTLE_MS = 10 * 1000;
+    static constexpr uint32_t TASK_STACK_SIZE = 6144; // std::string paths and a directory listing
+    static constexpr UBaseType_t TASK_PRIORITY = 1;   // Below the UI loop
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    App* app_;
+    volatile bool running_;
+    volatile bool stopRequested_;
+    bool passRequested_;
+    unsigned long lastPassMs_;
+    unsigned long idleSinceMs_; // 0 while busy
+    RetentionEngine::Report lastReport_;
+};
+
+#endif // RETENTION_MANAGER_H
@@ -0,0 +1,68 @@
+#ifndef ROLLING_WINDOW_H
+#define ROLLING_WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Fixed-size window of the last N samples with min/avg/max.
+ *
+ * add() is O(1) and keeps a running sum for avg(); min()/max() scan the window
+ * and are meant to be called only when the values are displayed.
+ */
+template <size_t N>
+class RollingWindow {
+public:
+    static_assert(N > 0, "RollingWindow needs at least one slot");
+
+    RollingWindow() { reset(); }
+
+    void add(uint32_t value) {
+        if (count_ == N) {
+            sum_ -= samples_[head_];
+        } else {
+            count_++;
+        }
+        samples_[head_] = value;
+        sum_ += value;
+        head_ = (head_ + 1) % N;
+    }
+
+    void reset() {
+        head_ = 0;
+        count_ = 0;
+        sum_ = 0;
+    }
+
+    size_t count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    uint32_t last() const { return count_ ? samples_[(head_ + N - 1) % N] : 0; }
+    uint32_t avg() const { return count_ ? (uint32_t)(sum_ / count_) : 0; }
+
+    uint32_t min() const {
+        if (!count_) return 0;
+        uint32_t result = UINT32_MAX;
+        for (size_t i = 0; i < count_; ++i) {
+            if (samples_[i] < result) result = samples_[i];
+        }
+        return result;
+    }
+
+    uint32_t max() const {
+        uint32_t result = 0;
+        for (size_t i = 0; i < count_; ++i) {
+            if (samples_[i] > result) result = samples_[i];
+        }
+        return result;
+    }
+
+private:
+    // While the window is filling, samples occupy [0, count_); once full, all N slots are live.
+    uint32_t samples_[N];
+    size_t head_;
+    size_t count_;
+    uint64_t sum_;
+};
+
+#endif // ROLLING_WINDOW_H
@@ -2,14 +2,67 @@
 #define SD_CARD_MANAGER_H
 
 #include <Arduino.h>
-#include <SD.h>
+#include <FS.h>
 #include <map>
+#include <unordered_map>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <memory>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "ICachedFileReader.h"
+#include "IStorageBackend.h"
+#include "LruCache.h"
+#include "SpaceAccounting.h"
 
 namespace SdCardManager {
 
+    // --- NEW: One entry of a directory listing ---
+    struct DirEntry {
+        std::string name; // File name only, without the parent directory
+        size_t size;        // 0 for directories
+        uint32_t lastWrite; // Seconds since the epoch; 0 for directories or if the backend doesn't know
+        bool isDir;
+    };
+
+    // --- NEW: Snapshot of the PSRAM file cache counters, for InfoMenu ---
+    struct FileCacheStats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t evictions;
+        uint32_t bypasses; // Misses streamed from the card because the file was too large to admit
+        size_t entries;
+        size_t bytes;
+        size_t capacity;
+        size_t openWrites; // Files opened for writing whose finishWrite() hasn't come yet
+    };
+
+    // --- NEW: Field helpers for the ';'-separated list and index formats ---
+    // Moves everything before the next `sep` into `field` and advances `rest` past the separator.
+    // Returns false (leaving both untouched) if `rest` holds no `sep`.
+    inline bool splitField(std::string_view& rest, char sep, std::string_view& field) {
+        size_t pos = rest.find(sep);
+        if (pos == std::string_view::npos) return false;
+        field = rest.substr(0, pos);
+        rest.remove_prefix(pos + 1);
+        return true;
+    }
+
+    // String::toInt() for views: optional leading whitespace and sign, stops at the first non-digit.
+    inline long parseLong(std::string_view text) {
+        size_t i = 0;
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) i++;
+        bool negative = false;
+        if (i < text.size() && (text[i] == '-' || text[i] == '+')) negative = (text[i++] == '-');
+        long value = 0;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            value = value * 10 + (text[i] - '0');
+        }
+        return negative ? -value : value;
+    }
+
     // --- NEW: LineReader that uses the abstract reader interface ---
     class LineReader {
     public:
@@ -19,6 +72,8 @@ namespace SdCardManager {
         LineReader& operator=(LineReader&& other) noexcept;
 
         String readLine();
+        // Zero-copy variant: `line` is trimmed, never empty, and valid until the next call.
+        bool readLine(std::string_view& line);
         bool isOpen() const;
         void close();
 
@@ -31,17 +86,51 @@ namespace SdCardManager {
         std::unique_ptr<ICachedFileReader> reader_;
     };
     
+    class StorageFileImpl;
+
     // --- NEW: A class to hold all the public API and internal cache state ---
     class SdCardManagerAPI {
     public:
         SdCardManagerAPI();
 
+        // Mounts the card with SdFat, or the core SD library if SdFat can't. A host build has no
+        // card: it fails until setup(backend) has mounted one, and then remounts that.
         bool setup();
+        // Mounts `backend` in place of the card, e.g. a PosixStorageBackend sandbox or a
+        // FaultInjectingBackend, for host runs and fault testing. Call before any file is open.
+        bool setup(std::unique_ptr<IStorageBackend> backend);
+        // Unmounts the card so something else (USB mass storage) can own it; setup() remounts.
+        void end();
         bool isAvailable() const;
+        const char* getBackendName() const;
+
+        // --- NEW: Cached space accounting ---
+        // Used space is scanned once per mount in the background, then kept current from
+        // every write, truncate, delete and mkdir made through this API. Both are cheap.
+        uint64_t getTotalBytes();
+        uint64_t getUsedBytes(); // 0 until the first scan lands; see isUsedSpaceKnown()
+        bool isUsedSpaceKnown();
+        // Starts a background rescan (e.g. after the card changed behind our back). No-op if one is running.
+        void rescanUsedSpace();
         bool exists(const char* path);
         bool createDir(const char* path);
         String readFile(const char* path); // Now uses cache
-        bool writeFile(const char* path, const char* message);
+        // Copies the file into `buffer` and NUL-terminates it; no heap allocation.
+        // Returns the number of bytes copied (truncated to bufferSize - 1), or 0 if unreadable.
+        size_t readInto(const char* path, char* buffer, size_t bufferSize);
+        bool writeFile(const char* path, const char* message); // Writes through a cached copy
+
+        // --- NEW: Crash-safe replace for files that must never be seen half-written ---
+        // Writes `path`.tmp with a CRC32 trailer (see CrcTrailer.h) and syncs it, retires the
+        // current copy to `path`.bak and renames the new one into place. A power cut at any
+        // step leaves at least one intact copy for restoreAtomic() to find.
+        bool writeFileAtomic(const char* path, const char* data, size_t len);
+        // Makes sure `path` holds an intact copy, moving the newest good one (.tmp, then .bak)
+        // into place if it is missing or fails its CRC. A copy without a trailer (written before
+        // the format, or edited over USB) is taken as it is. Returns false if none is usable.
+        bool restoreAtomic(const char* path);
+        // restoreAtomic(), then the contents without the trailer.
+        bool readFileAtomic(const char* path, String& out);
         bool deleteFile(const char *path);
         bool renameFile(const char* pathFrom, const char* pathTo);
         void ensureStandardDirs();
@@ -51,14 +140,39 @@ namespace SdCardManager {
         LineReader openLineReader(const char* path);
 
         // --- UNCACHED: For binary streaming where caching is wasteful (OTA) ---
-        File openFileUncached(const char* path, const char* mode = FILE_READ);
+        // Opening for write/append drops any cached copy, and the file is not cached again
+        // until finishWrite() is called for it. Streams that are never "finished" (logs,
+        // captures) simply stay uncached. "r+" opens an existing file for in-place updates.
+        // `preallocateBytes` reserves contiguous space on a file opened with FILE_WRITE, for
+        // streams that will keep growing; the unused tail is freed on close. Best effort.
+        File openFileUncached(const char* path, const char* mode = FILE_READ, size_t preallocateBytes = 0);
+        // Call after closing a file opened for writing with openFileUncached().
+        void finishWrite(const char* path);
+
+        // --- NEW: Cached directory listings ---
+        // Listings are kept in PSRAM per directory and reused until something inside that
+        // directory is written, renamed, created or removed through this API. Both calls are
+        // safe to use from background loader tasks.
+        bool listDir(const char* path, std::vector<DirEntry>& out);
+        // Streams entries to `onEntry` as they are read; return false from it to stop early
+        // (a partial walk is not cached). Returns false if `path` is not a readable directory.
+        bool forEachDirEntry(const char* path, const std::function<bool(const DirEntry&)>& onEntry);
+        // Drops every cached listing and file. Needed whenever the card was modified behind our back (USB MSC).
+        void invalidateAll();
+
+        // --- NEW: Cache warm-up for Prefetcher ---
+        // Loads a directory's listing or a small file's contents into PSRAM ahead of use.
+        bool prefetch(const char* path);
+
+        FileCacheStats getFileCacheStats();
     
     private:
+        friend class StorageFileImpl; // Reports size changes of write handles
+
         // --- CACHE IMPLEMENTATION ---
         struct CachedFile {
             std::shared_ptr<char> data; // Use shared_ptr for automatic memory management
             size_t size;
-            unsigned long lastAccess;
 
             // Custom deleter for ps_malloc'd memory
             struct PsramDeleter {
@@ -68,21 +182,99 @@ namespace SdCardManager {
             };
 
             CachedFile(char* d, size_t s) 
-                : data(d, PsramDeleter()), size(s), lastAccess(millis()) {}
+                : data(d, PsramDeleter()), size(s) {}
+            CachedFile(std::shared_ptr<char> d, size_t s)
+                : data(std::move(d)), size(s) {}
         };
         
-        std::map<std::string, CachedFile> cache_;
-        size_t currentCacheSize_ = 0;
+        // Hash map + recency list: lookups, touches and evictions are all O(1).
+        // Readers hold their own shared_ptr, so evicting an entry never invalidates an open reader.
+        LruCache<CachedFile> cache_{MAX_TOTAL_CACHE_SIZE};
+        SemaphoreHandle_t cacheMutex_; // open() may now be called from the prefetch task
+
+        // --- WRITE COHERENCE (guarded by cacheMutex_) ---
+        // A file's generation is stamped from writeClock_ when a write to it starts and again when
+        // it ends. open() reads the card without holding the lock and only admits what it read if
+        // the generation (and fileEpoch_) still match, so a racing write can never leave stale
+        // bytes cached. Only files with writes open keep an entry; the others share
+        // drainedGeneration_, the stamp of the last write to drain, so the map stays small.
+        std::unordered_map<std::string, uint32_t> fileGenerations_;
+        uint32_t writeClock_ = 0;
+        uint32_t drainedGeneration_ = 0;
+        // Writers currently open on a path; such files are streamed, never admitted.
+        std::unordered_map<std::string, uint32_t> writesInFlight_;
+        uint32_t fileEpoch_ = 0; // Bumped when a whole directory's files change at once
 
-        void cacheFile(const std::string& path);
-        void evictLRU();
-        void touch(const std::string& path);
+        uint32_t fileGenerationLocked(const std::string& path) const;
+        // Returns true if the file was cached before the write (worth writing through).
+        bool beginWrite(const char* path);
+        // Drops or (given `contents`) replaces the cached copy, then invalidates parent listings.
+        void endWrite(const char* path, bool mayBeDir, const char* contents = nullptr, size_t size = 0);
+        void dropCachedTree(const char* dirPath);
+
+        // Reads the already-open `file` into PSRAM. Returns nullptr on failure.
+        std::shared_ptr<char> readIntoPsram(const std::string& path, File& file, size_t fileSize);
+        // Admits `data` unless a write touched the file since `generation`/`epoch` were sampled.
+        bool storeFile(const std::string& path, std::shared_ptr<char> data, size_t size, uint32_t generation, uint32_t epoch);
+
+        // --- DIRECTORY LISTING CACHE ---
+        struct CachedListing {
+            std::shared_ptr<char> data; // Packed entries in PSRAM: [u32 size][u32 lastWrite][u8 isDir][u8 nameLen][name]...
+            size_t size;
+            size_t count;
+        };
+
+        std::map<std::string, CachedListing> dirCache_;
+        // Bumped for a directory every time something inside it changes. A walk that started
+        // under an older generation is never stored, so a racing write cannot be masked.
+        std::map<std::string, uint32_t> dirGenerations_;
+        uint32_t listingEpoch_ = 0; // Bumped by invalidateAll() for the same reason
+        size_t currentListingCacheSize_ = 0;
+        SemaphoreHandle_t dirCacheMutex_;
+
+        void noteMutation(const char* path, bool mayBeDir);
+        void storeListing(const std::string& key, const std::vector<DirEntry>& entries, size_t packedSize, uint32_t generation, uint32_t epoch);
 
         bool sdCardInitialized_ = false;
 
+        // --- STORAGE BACKEND ---
+        std::unique_ptr<IStorageBackend> primaryBackend_;  // SdFat, or one handed to setup()
+        std::unique_ptr<IStorageBackend> fallbackBackend_; // Core SD library; null for a handed-in backend
+        IStorageBackend* backend_;                          // Whichever mounted; null on a host until setup(backend)
+
+        File openRaw(const char* path, StorageMode mode, size_t preallocateBytes = 0);
+
+        // --- ATOMIC REPLACE ---
+        enum class CopyState : uint8_t { INTACT, UNCHECKED, BAD }; // UNCHECKED: no trailer
+        CopyState checkCopy(const char* path);
+        static constexpr const char* ATOMIC_TMP_SUFFIX = ".tmp";
+        static constexpr const char* ATOMIC_BAK_SUFFIX = ".bak";
+
+        // --- SPACE ACCOUNTING (guarded by spaceMutex_) ---
+        SpaceAccounting space_;
+        SemaphoreHandle_t spaceMutex_;
+        uint32_t mountGeneration_ = 0;   // A scan result from an earlier mount is dropped
+        volatile bool scanRunning_ = false;
+
+        static void scanTaskEntry(void* param);
+        void noteResize(uint64_t oldSize, uint64_t newSize);
+        // Size of the file at `path` on the card; 0 if it doesn't exist or is a directory.
+        uint64_t sizeOnCard(const char* path);
+
+        static constexpr uint32_t SCAN_TASK_STACK_SIZE = 4096;
+        static constexpr UBaseType_t SCAN_TASK_PRIORITY = 1; // Below the UI loop
+        static constexpr BaseType_t SCAN_TASK_CORE = 0;
+
+        static constexpr uint32_t SPI_CLOCK_HZ = 40000000;
+
         // --- CACHE CONFIGURATION ---
-        static constexpr size_t MAX_CACHEABLE_FILE_SIZE = 6 * 1024 * 1024; // 6 MB
+        // Admission policy: only files up to 1/8 of the budget are cached. Anything larger
+        // (logs, captures, firmware) is streamed from the card so one big read cannot flush
+        // every small index and config file that is actually reused.
         static constexpr size_t MAX_TOTAL_CACHE_SIZE = 7 * 1024 * 1024;    // 7 MB
+        static constexpr size_t MAX_CACHEABLE_FILE_SIZE = MAX_TOTAL_CACHE_SIZE / 8;
+        static constexpr size_t MAX_LISTING_CACHE_SIZE = 256 * 1024;       // 256 KB
+        static constexpr size_t MAX_PREFETCH_FILE_SIZE = 256 * 1024;       // 256 KB
     };
 
     // --- Provide a single global instance of the API ---
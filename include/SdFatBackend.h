@@ -0,0 +1,56 @@
+#ifndef SD_FAT_BACKEND_H
+#define SD_FAT_BACKEND_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "IStorageBackend.h"
+
+class SdFs; // SdFat.h stays out of this header: its File/FILE_* names clash with FS.h
+
+/**
+ * @brief IStorageBackend on SdFat: FAT16/32 and exFAT, no VFS in between.
+ *
+ * Compared with the core SD library this drops the stdio layer, sends whole-sector
+ * writes straight to the card as multi-block transfers, and on exFAT preallocates
+ * contiguous files, so long-running captures and logs append without FAT walks.
+ * (FAT16/32 has no valid-length field: a preallocated file would show its whole
+ * reservation as garbage until closed, so preallocate() is refused there.)
+ *
+ * SdFat itself is not thread-safe; one mutex serialises every volume and file
+ * operation, as FatFs does for the SD library.
+ */
+class SdFatBackend : public IStorageBackend {
+public:
+    SdFatBackend(uint8_t csPin, SPIClass& spi, uint32_t clockHz);
+    ~SdFatBackend() override;
+
+    bool begin() override;
+    void end() override;
+    const char* name() const override { return name_; }
+
+    bool exists(const char* path) override;
+    bool mkdir(const char* path) override;
+    bool remove(const char* path) override;
+    bool rename(const char* pathFrom, const char* pathTo) override;
+    std::unique_ptr<IStorageFile> open(const char* path, StorageMode mode) override;
+
+    uint64_t totalBytes() override;
+    uint64_t usedBytes() override;
+    uint32_t clusterSize() override;
+
+    SdFatBackend(const SdFatBackend&) = delete;
+    SdFatBackend& operator=(const SdFatBackend&) = delete;
+
+private:
+    uint8_t csPin_;
+    SPIClass& spi_;
+    uint32_t clockHz_;
+    std::unique_ptr<SdFs> sd_; // Created on the first begin()
+    SemaphoreHandle_t mutex_;
+    bool mounted_;
+    char name_[16];
+};
+
+#endif // SD_FAT_BACKEND_H
@@ -0,0 +1,112 @@
+#ifndef SD_WRITER_H
+#define SD_WRITER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <string>
+#include <vector>
+#include "WriteCoalescer.h"
+
+/**
+ * @brief Write-behind worker for SD appends and small file rewrites.
+ *
+ * Callers only copy their bytes into a bounded, per-file coalescing queue and
+ * return; a low-priority task drains it, keeps recently used files open, and
+ * flushes them every FLUSH_INTERVAL_MS. Files idle for IDLE_CLOSE_MS are closed
+ * (and handed back to SdCardManager's cache via finishWrite()); preallocated
+ * streams stay open until released.
+ *
+ * Durability is explicit: sync() blocks until everything queued before it is on
+ * the card, and release() additionally closes the file so it can be read back,
+ * renamed or deleted. Readers of a queued path otherwise see the card's contents,
+ * which may lag the queue by up to FLUSH_INTERVAL_MS.
+ */
+class SdWriter {
+public:
+    static SdWriter& getInstance();
+
+    // Appends raw bytes. Returns false if the write was dropped (queue full, writer suspended).
+    bool append(const char* path, const void* data, size_t len);
+    // Appends `header` then `body` as one record; either both are queued or neither is.
+    bool appendRecord(const char* path, const void* header, size_t headerLen, const void* body, size_t bodyLen);
+    // Appends `text` plus "\r\n", matching Print::println().
+    bool appendLine(const char* path, const char* text);
+    // Replaces the file's contents (FILE_WRITE semantics) once drained.
+    // A non-zero `preallocateBytes` marks the start of a stream (capture, log): that much
+    // contiguous space is reserved for the appends that follow, and the file stays open
+    // until release() or suspend() instead of being closed when idle.
+    bool write(const char* path, const void* data, size_t len, size_t preallocateBytes = 0);
+    bool write(const char* path, const char* text) { return write(path, text, strlen(text)); }
+    // Like write(), but through SdCardManager::writeFileAtomic(): a power cut leaves either the
+    // old or the new contents, never a prefix. For small files that must stay parseable.
+    bool writeAtomic(const char* path, const void* data, size_t len);
+
+    // Durability barrier: waits until every write queued before the call is flushed to the card.
+    bool sync(uint32_t timeoutMs = SYNC_TIMEOUT_MS);
+    // sync() and close `path`, so other code may read, rename or delete it.
+    bool release(const char* path, uint32_t timeoutMs = SYNC_TIMEOUT_MS);
+
+    // Flushes and closes everything, then holds new writes in the queue until resume().
+    // Used while the card belongs to something else (USB mass storage).
+    void suspend();
+    void resume();
+
+    uint32_t getDroppedWrites() const { return droppedWrites_; }
+
+    // Disable copy/assignment
+    SdWriter(const SdWriter&) = delete;
+    void operator=(const SdWriter&) = delete;
+
+private:
+    SdWriter();
+
+    bool enqueue(const char* path, const void* first, size_t firstLen, const void* second, size_t secondLen,
+                 bool truncate, size_t reserve = 0, bool atomic = false);
+    bool ensureTask();
+    static void taskEntry(void* param);
+    void taskLoop();
+
+    struct OpenFile {
+        std::string path;
+        File file;
+        unsigned long lastUsedMs;
+        bool dirty;
+        bool stream; // Preallocated: never idle-closed, closing gives the reservation back
+    };
+    File* handleFor(const std::string& path, bool truncate, size_t reserve);
+    void closeHandle(size_t index);
+    void flushAll();
+
+    static constexpr size_t MAX_PENDING_BYTES = 32 * 1024;
+    static constexpr size_t MAX_PENDING_FILES = 16;
+    static constexpr size_t MAX_OPEN_FILES = 4;
+    static constexpr unsigned long FLUSH_INTERVAL_MS = 1000;
+    static constexpr unsigned long IDLE_CLOSE_MS = 5000;
+    static constexpr unsigned long FULL_WAIT_MS = 20;       // How long a producer may wait for room
+    static constexpr uint32_t SYNC_TIMEOUT_MS = 2000;
+    static constexpr uint32_t TASK_STACK_SIZE = 4096;
+    static constexpr UBaseType_t TASK_PRIORITY = 1; // Below the UI loop
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    // --- Shared state (guarded by mutex_) ---
+    SemaphoreHandle_t mutex_;
+    TaskHandle_t taskHandle_;
+    WriteCoalescer queue_;
+    std::vector<std::string> closeRequests_;
+    volatile bool closeAllRequested_; // Cleared by the worker once everything is closed
+    bool syncRequested_;
+    uint32_t submittedSeq_;         // Bumped for every accepted write
+    volatile uint32_t durableSeq_;  // Highest sequence known to be flushed
+    volatile bool suspended_;
+    volatile uint32_t droppedWrites_;
+
+    // --- Worker-only state ---
+    std::vector<OpenFile> openFiles_;
+    std::vector<WriteCoalescer::Batch> draining_; // Reused between drains
+    unsigned long lastFlushMs_;
+};
+
+#endif // SD_WRITER_H
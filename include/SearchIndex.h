@@ -0,0 +1,72 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <Arduino.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Case-insensitive substring index over a fixed set of labels.
+ *
+ * build() copies the labels (lowercased) into one PSRAM blob and hashes every
+ * trigram into a bucketed posting list, also in PSRAM. query() then answers
+ * "which labels contain this text" without touching most of the list:
+ *  - Queries of 3+ characters start from the smallest posting list among the
+ *    query's trigrams and verify each candidate.
+ *  - A query that extends the previous one (the user typed another character)
+ *    only re-checks the previous matches, so each keystroke narrows the set.
+ *
+ * Results are item indices in their original order.
+ */
+class SearchIndex {
+public:
+    static constexpr size_t MAX_ITEMS = 65535; // Item ids are stored as uint16_t
+
+    SearchIndex();
+    ~SearchIndex();
+
+    SearchIndex(const SearchIndex&) = delete;
+    SearchIndex& operator=(const SearchIndex&) = delete;
+
+    /**
+     * @brief Replaces the index contents with `count` labels fetched from `labelFor`.
+     * @return false if PSRAM could not be allocated; the index is left empty.
+     */
+    bool build(size_t count, const std::function<std::string(size_t)>& labelFor);
+
+    /**
+     * @brief Frees all PSRAM held by the index.
+     */
+    void clear();
+
+    /**
+     * @brief Filters the labels by `text` and returns the matching item indices.
+     * An empty query matches everything. The returned reference stays valid until the next call.
+     */
+    const std::vector<uint16_t>& query(const char* text);
+
+    const std::vector<uint16_t>& results() const { return results_; }
+    size_t size() const { return count_; }
+    uint32_t getLastQueryMicros() const { return lastQueryUs_; }
+
+private:
+    static constexpr size_t BUCKET_COUNT = 4096; // Must be a power of two
+
+    static uint32_t trigramBucket(const char* s);
+    const char* labelAt(size_t index) const { return text_ + offsets_[index]; }
+    bool matches(size_t index, const char* needle) const;
+    void selectAll();
+
+    size_t count_;
+    char* text_;            // PSRAM: lowercased, NUL-terminated labels back to back
+    uint32_t* offsets_;     // PSRAM: start of each label in text_
+    uint32_t* bucketStart_; // PSRAM: BUCKET_COUNT + 1 offsets into postings_
+    uint16_t* postings_;    // PSRAM: item ids per trigram bucket, ascending
+
+    std::string lastQuery_;
+    std::vector<uint16_t> results_;
+    uint32_t lastQueryUs_;
+};
+
+#endif // SEARCH_INDEX_H
@@ -0,0 +1,42 @@
+#ifndef SEARCH_LIST_DATA_SOURCE_H
+#define SEARCH_LIST_DATA_SOURCE_H
+
+#include "IListMenuDataSource.h"
+#include "SearchIndex.h"
+#include <string>
+
+/**
+ * @brief The filtered view behind MenuType::SEARCH_RESULTS.
+ *
+ * begin() indexes a searchable data source's labels and opens TextInputMenu in
+ * type-ahead mode: every keystroke narrows the match set and shows the count.
+ * Submitting replaces the keyboard with the results list, which draws and selects
+ * items through the original data source using their original indices.
+ */
+class SearchListDataSource : public IListMenuDataSource {
+public:
+    SearchListDataSource();
+
+    /**
+     * @brief Indexes `source` and navigates to the search keyboard.
+     * @return false if the index could not be built (a pop-up is shown).
+     */
+    bool begin(App* app, IListMenuDataSource* source, const std::string& title);
+
+    int getNumberOfItems(App* app) override;
+    void drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) override;
+    void onItemSelected(App* app, ListMenu* menu, int index) override;
+    void onEnter(App* app, ListMenu* menu, bool isForwardNav) override;
+    void onExit(App* app, ListMenu* menu) override;
+    bool drawCustomEmptyMessage(App* app, U8G2& display) override;
+    const MenuItem* getItem(int index) const override;
+    std::string getItemPrefetchPath(int index) const override;
+
+private:
+    int toSourceIndex(int index) const;
+
+    IListMenuDataSource* source_;
+    SearchIndex index_;
+};
+
+#endif // SEARCH_LIST_DATA_SOURCE_H
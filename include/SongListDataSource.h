@@ -2,7 +2,7 @@
 #define SONG_LIST_DATA_SOURCE_H
 
 #include "IListMenuDataSource.h"
-#include <vector>
+#include "MusicDb.h"
 #include <string>
 
 class SongListDataSource : public IListMenuDataSource {
@@ -14,22 +14,17 @@ public:
     void onItemSelected(App* app, ListMenu* menu, int index) override;
     void onEnter(App* app, ListMenu* menu, bool isForwardNav) override;
     void onExit(App* app, ListMenu* menu) override;
+    bool isSearchable() const override { return true; }
+    std::string getItemLabel(int index) const override;
 
-    void setPlaylistPath(const std::string& path);
+    // The directory's tracks, straight from the library's records (no copies).
+    void setPlaylist(const MusicDb& db, MusicDb::DirId dir);
     const std::string& getPlaylistName() const { return playlistName_; }
 
 private:
-    struct TrackItem {
-        std::string name;
-        std::string path;
-        int duration;
-    };
-
-    void loadTracksFromIndex();
-
-    std::vector<TrackItem> tracks_;
-    std::string playlistPath_;
+    MusicDb db_;
+    MusicDb::DirId dir_;
     std::string playlistName_;
 };
 
-#endif // SONG_LIST_DATA_SOURCE_H
\ No newline at end of file
+#endif // SONG_LIST_DATA_SOURCE_H
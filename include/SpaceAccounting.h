@@ -0,0 +1,81 @@
+#ifndef SPACE_ACCOUNTING_H
+#define SPACE_ACCOUNTING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Running total of the space used on a volume, kept without allocation-table scans.
+ *
+ * Seeded by one full scan (slow: it walks the FAT) and from then on adjusted for
+ * every size change the storage layer makes, rounded up to whole clusters the way
+ * the filesystem allocates them. Changes reported while a scan is in flight are
+ * applied on top of its result when it lands, so none are lost; one the scan had
+ * already seen is counted twice, which the next rescan corrects.
+ *
+ * Not thread-safe; the owner serialises access.
+ */
+class SpaceAccounting {
+public:
+    /**
+     * @brief Starts over for a (re)mounted volume. Used space is unknown until finishScan().
+     * @param clusterSize Allocation unit in bytes; 0 if the backend can't tell (sectors are assumed).
+     */
+    void reset(uint64_t totalBytes, uint32_t clusterSize) {
+        totalBytes_ = totalBytes;
+        clusterSize_ = clusterSize ? clusterSize : 512;
+        usedBytes_ = 0;
+        pendingDelta_ = 0;
+        known_ = false;
+        scanning_ = false;
+    }
+
+    void beginScan() {
+        scanning_ = true;
+        pendingDelta_ = 0;
+    }
+
+    void finishScan(uint64_t scannedBytes) {
+        usedBytes_ = clamp((int64_t)scannedBytes + pendingDelta_);
+        pendingDelta_ = 0;
+        scanning_ = false;
+        known_ = true;
+    }
+
+    /**
+     * @brief A file went from `oldSize` to `newSize` bytes (0 for created or removed).
+     */
+    void resize(uint64_t oldSize, uint64_t newSize) {
+        int64_t delta = (int64_t)allocated(newSize) - (int64_t)allocated(oldSize);
+        if (delta == 0) return;
+        if (scanning_ || !known_) pendingDelta_ += delta;
+        if (known_) usedBytes_ = clamp((int64_t)usedBytes_ + delta);
+    }
+
+    // A new directory takes one cluster for its entries.
+    void addDirectory() { resize(0, 1); }
+
+    bool isKnown() const { return known_; }
+    bool isScanning() const { return scanning_; }
+    uint64_t usedBytes() const { return known_ ? usedBytes_ : 0; }
+    uint64_t totalBytes() const { return totalBytes_; }
+
+private:
+    uint64_t allocated(uint64_t size) const {
+        return (size + clusterSize_ - 1) / clusterSize_ * clusterSize_;
+    }
+
+    uint64_t clamp(int64_t bytes) const {
+        if (bytes < 0) return 0;
+        return (uint64_t)bytes > totalBytes_ ? totalBytes_ : (uint64_t)bytes;
+    }
+
+    uint64_t totalBytes_ = 0;
+    uint64_t usedBytes_ = 0;
+    int64_t pendingDelta_ = 0; // Changes the running (or not yet started) scan can't account for
+    uint32_t clusterSize_ = 512;
+    bool known_ = false;
+    bool scanning_ = false;
+};
+
+#endif // SPACE_ACCOUNTING_H
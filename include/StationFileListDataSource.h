@@ -2,12 +2,15 @@
 #define STATION_FILE_LIST_DATA_SOURCE_H
 
 #include "IListMenuDataSource.h"
+#include "AsyncListLoader.h"
 #include "WifiManager.h" // For WifiNetworkInfo
 #include <vector>
 #include <string>
 
 class StationFileListDataSource : public IListMenuDataSource {
 public:
+    StationFileListDataSource();
+
     void setTargetAp(const WifiNetworkInfo& target);
 
     int getNumberOfItems(App* app) override;
@@ -15,10 +18,18 @@ public:
     void onItemSelected(App* app, ListMenu* menu, int index) override;
     void onEnter(App* app, ListMenu* menu, bool isForwardNav) override;
     void onExit(App* app, ListMenu* menu) override;
+    void onUpdate(App* app, ListMenu* menu) override;
+    bool isLoading() const override;
+    std::string getPrefetchPath() const override { return SD_ROOT::DATA_CAPTURES_STATION_LISTS; }
 
 private:
-    std::vector<std::string> fileNames_;
-    std::vector<std::string> filePaths_;
+    struct FileEntry {
+        std::string name;
+        std::string path;
+    };
+
+    AsyncListLoader<FileEntry> loader_;
+    std::vector<FileEntry> files_;
     WifiNetworkInfo targetAp_;
 };
 
@@ -0,0 +1,97 @@
+#ifndef STORAGE_BENCHMARK_H
+#define STORAGE_BENCHMARK_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @brief SD card benchmark and health check.
+ *
+ * Runs in its own low-priority task through SdCardManager, so it measures the
+ * backend that is actually mounted (SdFat, the SD library, or PosixStorageBackend
+ * in a host build) the way the rest of the firmware uses it:
+ *  - sequential write of SEQ_BYTES into a preallocated file, then a sequential read;
+ *  - RANDOM_OPS reads and in-place writes of RANDOM_BLOCK bytes at random offsets in it;
+ *  - a sweep of read and write sizes, to suggest the smallest buffer that gets
+ *    within SUGGEST_PERCENT of the best throughput;
+ *  - APPEND_COUNT small records, each flushed, as SdWriter does for a capture stream,
+ *    reported as latency percentiles;
+ *  - the same small file read through the PSRAM cache and straight off the card.
+ * The scratch files are deleted afterwards and every run is appended as a CSV row
+ * to RESULTS_FILENAME in the log directory.
+ */
+class StorageBenchmark {
+public:
+    enum class State { IDLE, RUNNING, DONE, FAILED };
+
+    struct Result {
+        float seqWriteMBps;
+        float seqReadMBps;
+        float randWriteMBps;
+        float randReadMBps;
+        float cachedReadMBps;
+        float uncachedReadMBps;
+        uint32_t appendAvgMicros;
+        uint32_t appendP50Micros;
+        uint32_t appendP95Micros;
+        uint32_t appendP99Micros;
+        uint32_t appendMaxMicros; // Worst single append + flush
+        uint32_t readBufferBytes;  // Suggested sizes from the sweep
+        uint32_t writeBufferBytes;
+        char backend[24];
+    };
+
+    static StorageBenchmark& getInstance();
+
+    // Returns false if a run is already going or the task can't be created.
+    bool start();
+    // Runs the whole suite on the calling task, e.g. from a host harness with SdCardManager
+    // mounted on PosixStorageBackend. Returns false on failure (see getError()).
+    bool runBlocking();
+    State getState() const { return state_; }
+    uint8_t getProgress() const { return progress_; } // 0-100 while RUNNING
+    const Result& getResult() const { return result_; } // Valid once DONE
+    const char* getError() const { return error_; }     // Set when FAILED
+
+    // Disable copy/assignment
+    StorageBenchmark(const StorageBenchmark&) = delete;
+    void operator=(const StorageBenchmark&) = delete;
+
+private:
+    StorageBenchmark();
+    static void taskEntry(void* param);
+    bool begin();
+    bool run();
+    bool finish(bool ok);
+    bool runSequential(uint8_t* buffer);
+    bool runRandom(uint8_t* buffer);
+    bool runSweep(uint8_t* buffer);
+    bool runAppends();
+    bool runCacheReads(uint8_t* buffer);
+    void saveResult();
+    bool fail(const char* error);
+
+    static constexpr size_t SEQ_BYTES = 4 * 1024 * 1024;
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+    static constexpr size_t RANDOM_OPS = 256;
+    static constexpr size_t RANDOM_BLOCK = 4 * 1024;
+    static constexpr size_t SWEEP_BYTES = 256 * 1024; // Per size; the largest size is CHUNK_SIZE
+    static constexpr uint32_t SUGGEST_PERCENT = 90;
+    static constexpr size_t APPEND_COUNT = 256;
+    static constexpr size_t APPEND_RECORD_SIZE = 64; // About one log line
+    static constexpr size_t CACHE_FILE_BYTES = 64 * 1024; // Well under the cache's per-file limit
+    static constexpr int CACHE_READ_PASSES = 8;
+    static constexpr const char* RESULTS_FILENAME = "sd_bench.csv"; // In SD_ROOT::DATA_LOGS
+    static constexpr uint32_t TASK_STACK_SIZE = 4096;
+    static constexpr UBaseType_t TASK_PRIORITY = 1; // Below the UI loop
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    volatile State state_;
+    volatile uint8_t progress_;
+    Result result_;
+    const char* error_;
+    uint32_t rng_; // Fixed seed: every run hits the same offsets, so runs are comparable
+};
+
+#endif // STORAGE_BENCHMARK_H
@@ -0,0 +1,25 @@
+#ifndef STORAGE_BENCHMARK_MENU_H
+#define STORAGE_BENCHMARK_MENU_H
+
+#include "IMenu.h"
+
+class StorageBenchmarkMenu : public IMenu {
+public:
+    StorageBenchmarkMenu();
+
+    void onEnter(App* app, bool isForwardNav) override;
+    void onUpdate(App* app) override;
+    void onExit(App* app) override;
+    void draw(App* app, U8G2& display) override;
+    void handleInput(InputEvent event, App* app) override;
+
+    const char* getTitle() const override { return "SD Benchmark"; }
+    MenuType getMenuType() const override { return MenuType::SD_BENCHMARK; }
+
+private:
+    static constexpr int RESULT_ROWS = 13;
+    static constexpr int VISIBLE_ROWS = 4;
+    int scrollOffset_; // First result row on screen
+};
+
+#endif // STORAGE_BENCHMARK_MENU_H
@@ -0,0 +1,34 @@
+#ifndef TEXT_FILE_LIST_DATA_SOURCE_H
+#define TEXT_FILE_LIST_DATA_SOURCE_H
+
+#include "IListMenuDataSource.h"
+#include "AsyncListLoader.h"
+#include <vector>
+#include <string>
+
+// Session logs and text captures, each opened in TextViewerMenu.
+class TextFileListDataSource : public IListMenuDataSource {
+public:
+    TextFileListDataSource();
+
+    int getNumberOfItems(App* app) override;
+    void drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) override;
+    void onItemSelected(App* app, ListMenu* menu, int index) override;
+    void onEnter(App* app, ListMenu* menu, bool isForwardNav) override;
+    void onExit(App* app, ListMenu* menu) override;
+    void onUpdate(App* app, ListMenu* menu) override;
+    bool isLoading() const override;
+    std::string getPrefetchPath() const override { return SD_ROOT::DATA_LOGS; }
+
+private:
+    struct FileEntry {
+        std::string name;
+        std::string path;
+        bool isLog;
+    };
+
+    AsyncListLoader<FileEntry> loader_;
+    std::vector<FileEntry> files_;
+};
+
+#endif // TEXT_FILE_LIST_DATA_SOURCE_H
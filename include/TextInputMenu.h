@@ -11,6 +11,8 @@ class TextInputMenu : public IMenu {
 public:
     // --- Type alias for the callback function ---
     using OnSubmitCallback = std::function<void(App*, const char*)>;
+    // --- NEW: Called after every edit; returns a hint line to show under the field (e.g. match count) ---
+    using OnChangeCallback = std::function<std::string(App*, const char*)>;
 
     TextInputMenu();
     void onEnter(App* app, bool isForwardNav) override;
@@ -24,15 +26,21 @@ public:
 
     // --- Configuration method to be called before changing to this menu ---
     void configure(std::string title, OnSubmitCallback callback, bool maskInput = false, const char* initial_text = "");
+    // --- NEW: Type-ahead mode. Call after configure(), which clears it ---
+    void setOnChange(OnChangeCallback callback);
+    bool hasOnChange() const { return onChange_ != nullptr; }
 
 private:
     void drawKeyboard(U8G2& display);
     void processKeyPress(int keyValue);
+    void notifyChange(App* app);
     void moveFocus(int dRow, int dCol);
     
     // --- State for the current input session ---
     std::string title_;
     OnSubmitCallback onSubmit_;
+    OnChangeCallback onChange_;
+    std::string hint_;
     bool maskInput_;
     
     char inputBuffer_[TEXT_INPUT_MAX_LEN + 1];
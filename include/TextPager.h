@@ -0,0 +1,110 @@
+#ifndef TEXT_PAGER_H
+#define TEXT_PAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "IStorageBackend.h"
+
+/**
+ * @brief Random access to the lines of a file too large to load: text, or a .klog
+ * session log rendered the way tools/klog_decode.py prints it.
+ *
+ * The line index is sparse: one checkpoint (byte offset, plus the clock and string
+ * table of a .klog) every STRIDE lines, built CHUNK_SIZE bytes per indexStep() so a
+ * background task can finish it while the first pages are already on screen.
+ * getLines() seeks to the checkpoint at or before the first line it wants and reads
+ * only as far as the last; if the index hasn't got there yet it is extended first,
+ * just far enough. A 5 MB log of ~60 byte lines needs ~1400 checkpoints (22 KB).
+ *
+ * Not thread-safe: the caller serialises indexStep() and getLines().
+ */
+class TextPager {
+public:
+    // The bytes of the file; the device reads an uncached File, the host an IStorageFile.
+    class Source {
+    public:
+        virtual ~Source() = default;
+        virtual size_t readAt(uint64_t offset, uint8_t* buf, size_t len) = 0;
+        virtual uint64_t size() = 0;
+    };
+
+    class StorageFileSource : public Source {
+    public:
+        explicit StorageFileSource(std::unique_ptr<IStorageFile> file) : file_(std::move(file)) {}
+        size_t readAt(uint64_t offset, uint8_t* buf, size_t len) override {
+            return file_->seek(offset) ? file_->read(buf, len) : 0;
+        }
+        uint64_t size() override { return file_->size(); }
+
+    private:
+        std::unique_ptr<IStorageFile> file_;
+    };
+
+    enum class Format : uint8_t { TEXT, KLOG };
+
+    struct Stats {
+        uint32_t reads;
+        uint64_t bytesRead;
+    };
+
+    static constexpr uint32_t STRIDE = 64;          // Lines per checkpoint
+    static constexpr size_t CHUNK_SIZE = 4096;      // One SD read
+    static constexpr size_t MAX_LINE_CHARS = 160;   // Longer lines are cut
+
+    explicit TextPager(std::unique_ptr<Source> source);
+
+    // Reads the file header to tell the format apart. False if the file can't be read.
+    bool open();
+    Format getFormat() const { return format_; }
+
+    // Indexes the next CHUNK_SIZE bytes. Returns false once the whole file is indexed.
+    bool indexStep();
+    // Indexes until at least `lineCount` lines are known or the file ends.
+    uint32_t ensureLines(uint32_t lineCount);
+    bool isIndexed() const { return indexed_; }
+    uint32_t getLineCount() const { return lines_; } // So far, unless isIndexed()
+    uint8_t getIndexPercent() const;
+
+    // Replaces `out` with up to `count` lines from `first` on, control characters shown as '.'.
+    size_t getLines(uint32_t first, size_t count, std::vector<std::string>& out);
+
+    const Stats& getStats() const { return stats_; }
+
+private:
+    struct Checkpoint {
+        uint64_t offset;
+        uint32_t millis; // .klog: the clock before this line's message
+        uint32_t epoch;  // .klog: string table in use (one per FRAME_SYNC)
+    };
+
+    // Frame at buf[0..avail): its total size, or 0 if it isn't all there.
+    static size_t frameSize(const uint8_t* buf, size_t avail, size_t& headerLen, uint64_t& payloadLen);
+
+    size_t read(uint64_t offset, uint8_t* buf, size_t len);
+    bool indexTextChunk(size_t n);
+    bool indexKlogChunk(size_t n);
+    void addCheckpoint(uint64_t offset);
+    size_t readTextLines(const Checkpoint& from, uint32_t skip, size_t count, std::vector<std::string>& out);
+    size_t readKlogLines(const Checkpoint& from, uint32_t skip, size_t count, std::vector<std::string>& out);
+    void renderMessage(const uint8_t* payload, size_t len, uint32_t& millis, uint32_t epoch, std::string& out);
+
+    std::unique_ptr<Source> source_;
+    std::vector<uint8_t> chunk_;
+    uint64_t size_;
+    Format format_;
+    Stats stats_;
+
+    // --- Index ---
+    std::vector<Checkpoint> checkpoints_; // checkpoints_[k] starts line k * STRIDE
+    uint64_t scanPos_;
+    uint32_t lines_;
+    bool indexed_;
+    bool lineOpen_;       // Text: bytes seen since the last newline
+    uint32_t scanMillis_; // .klog: clock at scanPos_
+    std::vector<std::vector<std::string>> epochs_; // .klog: string tables
+};
+
+#endif // TEXT_PAGER_H
@@ -0,0 +1,66 @@
+#ifndef TEXT_VIEWER_MENU_H
+#define TEXT_VIEWER_MENU_H
+
+#include "IMenu.h"
+#include "TextPager.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Pages through a log or text capture of any size (see TextPager).
+ *
+ * The file is opened uncached, so viewing it neither loads it into PSRAM nor evicts
+ * what the file cache holds. A low-priority task builds the line index in the
+ * background; scrolling only ever fetches the VISIBLE_ROWS lines on screen.
+ */
+class TextViewerMenu : public IMenu {
+public:
+    TextViewerMenu();
+
+    // Call before navigating to MenuType::TEXT_VIEWER.
+    void setFile(const std::string& path);
+
+    void onEnter(App* app, bool isForwardNav) override;
+    void onUpdate(App* app) override;
+    void onExit(App* app) override;
+    void draw(App* app, U8G2& display) override;
+    void handleInput(InputEvent event, App* app) override;
+
+    const char* getTitle() const override { return title_; }
+    MenuType getMenuType() const override { return MenuType::TEXT_VIEWER; }
+
+private:
+    bool openPager();
+    void closePager();
+    void showPage(int64_t firstLine);
+    void scrollColumns(int delta);
+    static void indexTaskEntry(void* param);
+
+    static constexpr int VISIBLE_ROWS = 5;
+    static constexpr int ROW_HEIGHT = 8;
+    static constexpr int VISIBLE_COLUMNS = 24;     // 5 px glyphs beside the scrollbar
+    static constexpr int COLUMN_STEP = 12;
+    static constexpr uint32_t TASK_STACK_SIZE = 4096;
+    static constexpr UBaseType_t TASK_PRIORITY = 1; // Below the UI loop
+    static constexpr BaseType_t TASK_CORE = 0;
+
+    std::string path_;
+    char title_[24];
+    std::unique_ptr<TextPager> pager_;
+    SemaphoreHandle_t pagerMutex_; // Between the UI and the index task
+    volatile bool indexRunning_;
+    volatile bool indexStopRequested_;
+    bool failed_;
+
+    uint32_t topLine_;
+    int column_;
+    std::vector<std::string> page_; // Only the lines on screen
+    uint32_t knownLines_;
+    uint8_t lastPercent_;
+};
+
+#endif // TEXT_VIEWER_MENU_H
@@ -0,0 +1,102 @@
+#ifndef WRITE_COALESCER_H
+#define WRITE_COALESCER_H
+
+#include <stddef.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bounded queue of pending file writes, merged per path.
+ *
+ * Every append to a path that already has pending bytes is concatenated onto
+ * them, so a burst of small appends (log lines, capture records) reaches the card
+ * as one write per file. replace() discards whatever was pending for the path and
+ * marks it for truncation. Both are refused once the byte or file budget is
+ * exhausted; nothing is ever partially queued.
+ *
+ * Not thread-safe; the owner serialises access.
+ */
+class WriteCoalescer {
+public:
+    struct Batch {
+        std::string path;
+        std::string data;
+        bool truncate; // Replace the file's contents instead of appending
+        size_t reserve; // With truncate: space to preallocate for the appends that follow
+        bool atomic;    // With truncate: replace crash-safely (temp file, sync, rename)
+    };
+
+    WriteCoalescer(size_t maxBytes, size_t maxFiles) : maxBytes_(maxBytes), maxFiles_(maxFiles) {}
+
+    /**
+     * @brief Queues `first` followed by `second` (optional) as one all-or-nothing append.
+     * @return false if it does not fit the budget.
+     */
+    bool append(const std::string& path, const void* first, size_t firstLen,
+                const void* second = nullptr, size_t secondLen = 0) {
+        size_t len = firstLen + secondLen;
+        if (bytes_ + len > maxBytes_) return false;
+        Batch* batch = find(path);
+        if (!batch) {
+            if (batches_.size() >= maxFiles_) return false;
+            batches_.push_back({path, std::string(), false, 0, false});
+            batch = &batches_.back();
+        }
+        batch->data.append(static_cast<const char*>(first), firstLen);
+        if (second) batch->data.append(static_cast<const char*>(second), secondLen);
+        bytes_ += len;
+        return true;
+    }
+
+    /**
+     * @brief Queues `data` as the file's new contents, superseding any pending appends.
+     * `reserve` and `atomic` are carried through to the Batch untouched.
+     * @return false if it does not fit the budget (the pending appends are kept then).
+     */
+    bool replace(const std::string& path, const void* data, size_t len, size_t reserve = 0, bool atomic = false) {
+        Batch* batch = find(path);
+        size_t freed = batch ? batch->data.size() : 0;
+        if (bytes_ - freed + len > maxBytes_) return false;
+        if (!batch) {
+            if (batches_.size() >= maxFiles_) return false;
+            batches_.push_back({path, std::string(), true, 0, false});
+            batch = &batches_.back();
+        }
+        batch->data.assign(static_cast<const char*>(data), len);
+        batch->truncate = true;
+        batch->reserve = reserve;
+        batch->atomic = atomic;
+        bytes_ = bytes_ - freed + len;
+        return true;
+    }
+
+    /**
+     * @brief Moves every pending batch into `out`, in the order their paths were first queued.
+     */
+    void takeAll(std::vector<Batch>& out) {
+        out.clear();
+        out.swap(batches_);
+        bytes_ = 0;
+    }
+
+    bool empty() const { return batches_.empty(); }
+    size_t pendingBytes() const { return bytes_; }
+    size_t pendingFiles() const { return batches_.size(); }
+
+private:
+    Batch* find(const std::string& path) {
+        // A handful of hot files at most; a linear scan beats hashing here.
+        for (auto& batch : batches_) {
+            if (batch.path == path) return &batch;
+        }
+        return nullptr;
+    }
+
+    std::vector<Batch> batches_;
+    size_t bytes_ = 0;
+    size_t maxBytes_;
+    size_t maxFiles_;
+};
+
+#endif // WRITE_COALESCER_H
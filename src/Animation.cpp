@@ -12,6 +12,25 @@ void VerticalListAnimation::resize(size_t size) {
     introStartSourceScale.assign(size, 0.0f);
 }
 
+// Appends items without disturbing the ones already on screen. New items start
+// at their resting position with zero scale so they pop in rather than fly in.
+void VerticalListAnimation::grow(size_t size, int selIdx, float itemSpacing) {
+    size_t oldSize = itemOffsetY.size();
+    if (size <= oldSize) return;
+    itemOffsetY.resize(size);
+    itemScale.resize(size, 0.0f);
+    targetOffsetY.resize(size);
+    targetScale.resize(size, 0.0f);
+    introStartSourceOffsetY.resize(size);
+    introStartSourceScale.resize(size, 0.0f);
+    for (size_t i = oldSize; i < size; i++) {
+        float restingOffsetY = ((int)i - selIdx) * itemSpacing;
+        itemOffsetY[i] = restingOffsetY;
+        targetOffsetY[i] = restingOffsetY;
+        introStartSourceOffsetY[i] = restingOffsetY;
+    }
+}
+
 void VerticalListAnimation::init() {
     std::fill(itemOffsetY.begin(), itemOffsetY.end(), 0.0f);
     std::fill(itemScale.begin(), itemScale.end(), 0.0f);
@@ -23,7 +42,7 @@ void VerticalListAnimation::init() {
 }
 
 void VerticalListAnimation::setTargets(int selIdx, int total, float itemSpacing) {
-    if (targetOffsetY.size() != total) resize(total);
+    if ((int)targetOffsetY.size() != total) resize(total);
     for (int i = 0; i < total; i++) {
         if (i < total) {
             int rP = i - selIdx;
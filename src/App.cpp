@@ -31,6 +31,8 @@
 #include "BadMsgAttacker.h"
 #include "RtcManager.h"
 #include "SystemDataProvider.h"
+#include "RetentionManager.h"
+#include "PerfStats.h"
 #include "MPUManager.h"
 #include "AirMouseService.h"
 
@@ -172,12 +174,13 @@ App::App() :
         {"Back", IconType::NAV_BACK, MenuType::BACK}
     }, 2),
     hostOtherMenu_("Host / Other Tools", MenuType::HOST_OTHER_GRID, {
-        {"USB Ducky", IconType::USB, MenuType::NONE, 
+        // targetMenu is only informational here (the action navigates), but lets Prefetcher warm the script list.
+        {"USB Ducky", IconType::USB, MenuType::DUCKY_SCRIPT_LIST, 
             [](App* app){
                 app->getDuckyScriptListDataSource().setExecutionMode(DuckyScriptRunner::Mode::USB);
                 EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::DUCKY_SCRIPT_LIST));
             }},
-        {"BLE Ducky", IconType::NET_BLUETOOTH, MenuType::NONE, 
+        {"BLE Ducky", IconType::NET_BLUETOOTH, MenuType::DUCKY_SCRIPT_LIST, 
             [](App* app){
                 app->getDuckyScriptListDataSource().setExecutionMode(DuckyScriptRunner::Mode::BLE);
                 EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::DUCKY_SCRIPT_LIST));
@@ -391,7 +394,7 @@ App::App() :
             wifiDS.setScanOnEnter(true);
             EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::WIFI_LIST));
         }},
-        {"From File", IconType::SD_CARD, MenuType::NONE, [](App* app){
+        {"From File", IconType::SD_CARD, MenuType::STATION_FILE_LIST, [](App* app){
             auto& wifiDS = app->getWifiListDataSource();
             wifiDS.setSelectionCallback([](App* app_cb, const WifiNetworkInfo& net){
                 auto& stationFileDS = static_cast<StationFileListDataSource&>(app_cb->stationFileListDataSource_);
@@ -427,6 +430,8 @@ App::App() :
     // --- Simple Menus (Default Constructed) ---
     usbDriveMenu_(),
     infoMenu_(),
+    storageBenchmarkMenu_(),
+    textViewerMenu_(),
     snakeGameMenu_(),
     brightnessMenu_(),
     textInputMenu_(), 
@@ -461,8 +466,10 @@ App::App() :
     duckyScriptListDataSource_(),
     musicLibraryDataSource_(),
     songListDataSource_(),
+    searchListDataSource_(),
     stationListDataSource_(),
     stationFileListDataSource_(),
+    textFileListDataSource_(),
     wifiAttacksDataSource_({
         {"Beacon Spam", IconType::BEACON, MenuType::BEACON_MODE_GRID},
         {"Deauth", IconType::DISCONNECT, MenuType::DEAUTH_MODE_GRID},
@@ -567,6 +574,21 @@ App::App() :
                 app->getConfigManager().saveSettings();
             }
         },
+        MenuItem{
+            "Crossfade", IconType::SETTING_SOUND, MenuType::NONE, nullptr, true,
+            [](App* app) -> std::string {
+                uint8_t seconds = app->getConfigManager().getSettings().crossfadeSeconds;
+                if (seconds == 0) return "< Gapless >";
+                char buf[16]; snprintf(buf, sizeof(buf), "< %us >", seconds); return std::string(buf);
+            },
+            [](App* app, int dir) {
+                auto& settings = app->getConfigManager().getSettings();
+                int seconds = settings.crossfadeSeconds + dir;
+                if (seconds < 0) seconds = 0; if (seconds > MusicPlayer::MAX_CROSSFADE_SECONDS) seconds = MusicPlayer::MAX_CROSSFADE_SECONDS;
+                settings.crossfadeSeconds = seconds;
+                app->getConfigManager().saveSettings();
+            }
+        },
         MenuItem{
             "Vibration", IconType::UI_VIBRATION, MenuType::NONE, nullptr, true,
             [](App* app) -> std::string { return app->getHardwareManager().isVibrationOn() ? "< ON >" : "< OFF >"; },
@@ -727,7 +749,23 @@ App::App() :
             if (app->getConfigManager().reloadFromSdCard()) app->showPopUp("Success", "Settings reloaded.", nullptr, "OK", "", true);
             else app->showPopUp("Error", "Load failed.", nullptr, "OK", "", true);
         }},
+        MenuItem{
+            "Perf HUD", IconType::INFO, MenuType::NONE, nullptr, true,
+            [](App* app) -> std::string {
+                switch (PerfStats::getInstance().getHudMode()) {
+                    case PerfHudMode::MAIN: return "< MAIN >";
+                    case PerfHudMode::AUX:  return "< AUX >";
+                    default:                return "< OFF >";
+                }
+            },
+            [](App* app, int dir) {
+                PerfStats::getInstance().cycleHudMode(dir);
+                app->requestRedraw();
+            }
+        },
         {"System Info", IconType::INFO, MenuType::INFO_MENU},
+        {"SD Benchmark", IconType::SD_CARD, MenuType::SD_BENCHMARK},
+        {"Logs & Captures", IconType::INFO, MenuType::TEXT_FILE_LIST},
         {"Back", IconType::NAV_BACK, MenuType::BACK}
     }),
     // --- ListMenu Instances ---
@@ -739,7 +777,9 @@ App::App() :
     duckyScriptListMenu_("Ducky Scripts", MenuType::DUCKY_SCRIPT_LIST, &duckyScriptListDataSource_),
     musicLibraryMenu_("Music Library", MenuType::MUSIC_LIBRARY, &musicLibraryDataSource_),
     songListMenu_("Songs", MenuType::SONG_LIST, &songListDataSource_),
+    searchListMenu_("Search Results", MenuType::SEARCH_RESULTS, &searchListDataSource_),
     stationFileListMenu_("Select Station List", MenuType::STATION_FILE_LIST, &stationFileListDataSource_),
+    textFileListMenu_("Logs & Captures", MenuType::TEXT_FILE_LIST, &textFileListDataSource_),
     
     // New ListMenus using the generic source
     wifiAttacksMenu_("WiFi Attacks", MenuType::WIFI_ATTACKS_LIST, &wifiAttacksDataSource_),
@@ -786,6 +826,7 @@ void App::setup()
         {"RTC Manager",      [&](){ getRtcManager().setup(this); return true; }},
         {"System Data",      [&](){ getSystemDataProvider().setup(this); return true; }},
         {"Logger",           [&](){ Logger::getInstance().setup(); return true; }},
+        {"Retention",        [&](){ getRetentionManager().setup(this); return true; }},
     };
 
     int totalTasks = bootTasks.size();
@@ -891,6 +932,9 @@ void App::setup()
     // Utilities / Misc
     menuRegistry_[MenuType::USB_DRIVE_MODE] = &usbDriveMenu_;
     menuRegistry_[MenuType::INFO_MENU] = &infoMenu_;
+    menuRegistry_[MenuType::SD_BENCHMARK] = &storageBenchmarkMenu_;
+    menuRegistry_[MenuType::TEXT_FILE_LIST] = &textFileListMenu_;
+    menuRegistry_[MenuType::TEXT_VIEWER] = &textViewerMenu_;
     menuRegistry_[MenuType::TEXT_INPUT] = &textInputMenu_;
     menuRegistry_[MenuType::POPUP] = &popUpMenu_;
     menuRegistry_[MenuType::FIRMWARE_UPDATE_GRID] = &firmwareUpdateGrid_;
@@ -900,6 +944,7 @@ void App::setup()
     // Music Player
     menuRegistry_[MenuType::MUSIC_LIBRARY] = &musicLibraryMenu_;
     menuRegistry_[MenuType::SONG_LIST] = &songListMenu_;
+    menuRegistry_[MenuType::SEARCH_RESULTS] = &searchListMenu_;
     menuRegistry_[MenuType::NOW_PLAYING] = &nowPlayingMenu_;
 
     // Subscribe to the events the App cares about
@@ -915,6 +960,9 @@ void App::setup()
 
 void App::loop()
 {
+    PerfStats::Scope loopPerfScope(PerfMetric::LOOP_US);
+    PerfStats::getInstance().tick();
+
     // 1. Update hardware and background services
     getHardwareManager().update();
 
@@ -958,6 +1006,11 @@ void App::loop()
         requestRedraw();
     }
 
+    // --- NEW: Keep the performance HUD's numbers moving ---
+    if (PerfStats::isEnabled() && millis() - lastDrawTime_ > PERF_HUD_REFRESH_MS) {
+        requestRedraw();
+    }
+
     // 4. The core optimization: only draw if requested
     if (redrawRequested_) {
         redrawRequested_ = false;
@@ -991,8 +1044,19 @@ void App::loop()
             currentMenu_->draw(this, mainDisplay);
         }
 
-        mainDisplay.sendBuffer();
-        drawSecondaryDisplay();
+        if (PerfStats::getInstance().getHudMode() == PerfHudMode::MAIN) {
+            drawPerfHud(mainDisplay);
+        }
+
+        {
+            PerfStats::Scope flushPerfScope(PerfMetric::MAIN_FLUSH_US);
+            mainDisplay.sendBuffer();
+        }
+        {
+            PerfStats::Scope auxPerfScope(PerfMetric::AUX_FLUSH_US);
+            drawSecondaryDisplay();
+        }
+        PerfStats::count(PerfCounter::FRAMES);
     } else {
         // --- Idle State ---
         // delay(10); // Yield CPU time
@@ -1066,6 +1130,7 @@ AssociationSleeper& App::getAssociationSleeper() { return *serviceManager_->getS
 BadMsgAttacker& App::getBadMsgAttacker() { return *serviceManager_->getService<BadMsgAttacker>(); }
 RtcManager& App::getRtcManager() { return *serviceManager_->getService<RtcManager>(); }
 SystemDataProvider& App::getSystemDataProvider() { return *serviceManager_->getService<SystemDataProvider>(); }
+RetentionManager& App::getRetentionManager() { return *serviceManager_->getService<RetentionManager>(); }
 
 TimezoneListDataSource& App::getTimezoneListDataSource() { return timezoneDataSource_; }
 SongListDataSource& App::getSongListDataSource() { return songListDataSource_; }
@@ -1142,8 +1207,9 @@ void App::changeMenu(MenuType type, bool isForwardNav) {
     }
 
     // Check if the DESTINATION menu requires Wi-Fi.
+    // A type-ahead search keyboard has nothing to do with Wi-Fi; only credential entry does.
     bool destinationRequiresWifi = (type == MenuType::WIFI_LIST ||
-                                    type == MenuType::TEXT_INPUT ||
+                                    (type == MenuType::TEXT_INPUT && !textInputMenu_.hasOnChange()) ||
                                     type == MenuType::WIFI_CONNECTION_STATUS);
 
     // If the destination requires Wi-Fi and it's currently off, turn it on NOW.
@@ -1314,6 +1380,12 @@ void App::drawSecondaryDisplay()
     display.clearBuffer();
     display.setDrawColor(1);
 
+    if (PerfStats::getInstance().getHudMode() == PerfHudMode::AUX) {
+        drawPerfHud(display);
+        display.sendBuffer();
+        return;
+    }
+
     // --- Top Bar ---
     display.setFont(u8g2_font_5x7_tf);
     // Time
@@ -1391,6 +1463,65 @@ void App::drawSecondaryDisplay()
     display.sendBuffer();
 }
 
+// --- NEW: Performance HUD helpers ---
+static void formatMicros(char* buf, size_t len, uint32_t us) {
+    if (us < 1000) snprintf(buf, len, "%luu", (unsigned long)us);
+    else if (us < 10000) snprintf(buf, len, "%.1fm", us / 1000.0f);
+    else snprintf(buf, len, "%lum", (unsigned long)(us / 1000));
+}
+
+static void formatBytes(char* buf, size_t len, uint32_t bytes) {
+    if (bytes < 1024) snprintf(buf, len, "%lu", (unsigned long)bytes);
+    else if (bytes < 1024 * 1024) snprintf(buf, len, "%luk", (unsigned long)(bytes / 1024));
+    else snprintf(buf, len, "%.1fM", bytes / (1024.0f * 1024.0f));
+}
+
+// Draws the HUD into the bottom PERF_HUD_HEIGHT rows of `display` (all of the 32px secondary display).
+void App::drawPerfHud(U8G2& display)
+{
+    const PerfStats& stats = PerfStats::getInstance();
+    const int top = display.getDisplayHeight() - PERF_HUD_HEIGHT;
+    char a[8], b[8], c[8], line[32];
+
+    display.setDrawColor(0);
+    display.drawBox(0, top, display.getDisplayWidth(), PERF_HUD_HEIGHT);
+    display.setDrawColor(1);
+    if (top > 0) {
+        display.drawHLine(0, top, display.getDisplayWidth());
+    }
+    display.setFont(u8g2_font_5x7_tf);
+
+    // Loop time min/avg/max and frames per second
+    const auto& loop = stats.get(PerfMetric::LOOP_US);
+    formatMicros(a, sizeof(a), loop.min());
+    formatMicros(b, sizeof(b), loop.avg());
+    formatMicros(c, sizeof(c), loop.max());
+    snprintf(line, sizeof(line), "LP %s/%s/%s %luf", a, b, c, (unsigned long)stats.get(PerfMetric::FPS).last());
+    display.drawStr(1, top + 8, line);
+
+    // Services avg/max, then main and secondary display flush (I2C) averages
+    formatMicros(a, sizeof(a), stats.get(PerfMetric::SERVICES_US).avg());
+    formatMicros(b, sizeof(b), stats.get(PerfMetric::SERVICES_US).max());
+    snprintf(line, sizeof(line), "SV %s/%s ", a, b);
+    formatMicros(a, sizeof(a), stats.get(PerfMetric::MAIN_FLUSH_US).avg());
+    formatMicros(b, sizeof(b), stats.get(PerfMetric::AUX_FLUSH_US).avg());
+    snprintf(line + strlen(line), sizeof(line) - strlen(line), "FL %s/%s", a, b);
+    display.drawStr(1, top + 16, line);
+
+    // Free heap (now/lowest) and free PSRAM
+    formatBytes(a, sizeof(a), stats.get(PerfMetric::FREE_HEAP).last());
+    formatBytes(b, sizeof(b), stats.get(PerfMetric::FREE_HEAP).min());
+    formatBytes(c, sizeof(c), stats.get(PerfMetric::FREE_PSRAM).last());
+    snprintf(line, sizeof(line), "HEAP %s/%s PS %s", a, b, c);
+    display.drawStr(1, top + 24, line);
+
+    // SD throughput through SdCardManager and sniffer packet rate
+    formatBytes(a, sizeof(a), stats.get(PerfMetric::SD_READ_BPS).last());
+    formatBytes(b, sizeof(b), stats.get(PerfMetric::SD_WRITE_BPS).last());
+    snprintf(line, sizeof(line), "SD r%s w%s PKT %lu/s", a, b, (unsigned long)stats.get(PerfMetric::SNIFFER_PPS).last());
+    display.drawStr(1, top + 32, line);
+}
+
 void App::drawStatusBar()
 {
     U8G2 &display = getHardwareManager().getMainDisplay();
@@ -0,0 +1,75 @@
+#include "ArduinoSdBackend.h"
+
+namespace {
+
+    class ArduinoSdFile : public IStorageFile {
+    public:
+        explicit ArduinoSdFile(File file) : file_(file) {}
+        ~ArduinoSdFile() override { close(); }
+
+        size_t read(uint8_t* buf, size_t len) override { return file_.read(buf, len); }
+        size_t write(const uint8_t* buf, size_t len) override { return file_.write(buf, len); }
+        bool seek(uint64_t pos) override { return file_.seek((uint32_t)pos); }
+        uint64_t position() const override { return file_.position(); }
+        uint64_t size() const override { return file_.size(); }
+        bool flush() override {
+            file_.flush();
+            return true;
+        }
+        void close() override {
+            if (file_) file_.close();
+        }
+        bool isOpen() const override { return (bool)file_; }
+        bool isDirectory() const override { return const_cast<File&>(file_).isDirectory(); }
+
+        const char* name() const override { return file_.name(); }
+        const char* path() const override { return file_.path(); }
+        time_t lastWrite() override { return file_.getLastWrite(); }
+
+        std::unique_ptr<IStorageFile> openNext() override {
+            File next = file_.openNextFile();
+            if (!next) return nullptr;
+            return std::make_unique<ArduinoSdFile>(next);
+        }
+        void rewind() override { file_.rewindDirectory(); }
+
+    private:
+        File file_;
+    };
+
+} // namespace
+
+ArduinoSdBackend::ArduinoSdBackend(uint8_t csPin, SPIClass& spi, uint32_t clockHz) :
+    csPin_(csPin),
+    spi_(spi),
+    clockHz_(clockHz)
+{}
+
+bool ArduinoSdBackend::begin() {
+    return SD.begin(csPin_, spi_, clockHz_);
+}
+
+void ArduinoSdBackend::end() {
+    SD.end();
+}
+
+bool ArduinoSdBackend::exists(const char* path) { return SD.exists(path); }
+bool ArduinoSdBackend::mkdir(const char* path) { return SD.mkdir(path); }
+bool ArduinoSdBackend::remove(const char* path) { return SD.remove(path); }
+bool ArduinoSdBackend::rename(const char* pathFrom, const char* pathTo) { return SD.rename(pathFrom, pathTo); }
+
+std::unique_ptr<IStorageFile> ArduinoSdBackend::open(const char* path, StorageMode mode) {
+    const char* fsMode = FILE_READ;
+    if (mode == StorageMode::WRITE) fsMode = FILE_WRITE;
+    else if (mode == StorageMode::APPEND) fsMode = FILE_APPEND;
+    else if (mode == StorageMode::UPDATE) fsMode = "r+";
+
+    File file = SD.open(path, fsMode);
+    if (!file) return nullptr;
+    // Big stdio buffer: the VFS otherwise turns every small read into its own SPI transaction.
+    file.setBufferSize(STDIO_BUFFER_SIZE);
+    return std::make_unique<ArduinoSdFile>(file);
+}
+
+uint64_t ArduinoSdBackend::totalBytes() { return SD.totalBytes(); }
+uint64_t ArduinoSdBackend::usedBytes() { return SD.usedBytes(); }
@@ -1,5 +1,4 @@
 #include "AudioFileSourceKivaSD.h"
-#include "SdCardManager.h" // The key include for our optimized manager
 
 AudioFileSourceKivaSD::AudioFileSourceKivaSD()
 {
@@ -12,35 +11,33 @@ AudioFileSourceKivaSD::AudioFileSourceKivaSD(const char *filename)
 
 bool AudioFileSourceKivaSD::open(const char *filename)
 {
-  // MODIFICATION: Use our optimized file opener instead of the global SD.open()
-  f = SdCardManager::getInstance().openFileUncached(filename, FILE_READ);
-  return f;
+  // Opens through SdCardManager (uncached) and starts filling the read-ahead window.
+  return stream_.open(filename, READ_AHEAD_BLOCK_SIZE, READ_AHEAD_BLOCKS);
 }
 
 AudioFileSourceKivaSD::~AudioFileSourceKivaSD()
 {
-  if (f) f.close();
+  stream_.close();
 }
 
 uint32_t AudioFileSourceKivaSD::read(void *data, uint32_t len)
 {
-  if (!f) return 0;
-  return f.read(reinterpret_cast<uint8_t*>(data), len);
+  return stream_.read(reinterpret_cast<uint8_t*>(data), len);
 }
 
 bool AudioFileSourceKivaSD::seek(int32_t pos, int dir)
 {
-  if (!f) return false;
-  if (dir==SEEK_SET) return f.seek(pos);
-  else if (dir==SEEK_CUR) return f.seek(f.position() + pos);
-  else if (dir==SEEK_END) return f.seek(f.size() + pos);
+  if (!stream_.isOpen()) return false;
+  if (dir==SEEK_SET) return stream_.seek(pos);
+  else if (dir==SEEK_CUR) return stream_.seek(stream_.position() + pos);
+  else if (dir==SEEK_END) return stream_.seek(stream_.size() + pos);
   return false;
 }
 
 bool AudioFileSourceKivaSD::close()
 {
-  if (f) {
-    f.close();
+  if (stream_.isOpen()) {
+    stream_.close();
     return true;
   }
   return false;
@@ -48,17 +45,15 @@ bool AudioFileSourceKivaSD::close()
 
 bool AudioFileSourceKivaSD::isOpen()
 {
-  return f ? true : false;
+  return stream_.isOpen();
 }
 
 uint32_t AudioFileSourceKivaSD::getSize()
 {
-  if (!f) return 0;
-  return f.size();
+  return stream_.size();
 }
 
 uint32_t AudioFileSourceKivaSD::getPos()
 {
-  if (!f) return 0;
-  return f.position();
-}
\ No newline at end of file
+  return stream_.position();
+}
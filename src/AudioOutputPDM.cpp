@@ -1,22 +1,98 @@
 #include "AudioOutputPDM.h"
 #include "Logger.h"
 
+namespace {
+
+    // The output stage's sink: the I2S DMA buffers, written under the driver mutex.
+    class I2sSink : public PcmOutputStage::Sink {
+    public:
+        I2sSink(i2s_port_t port, const bool& installed, SemaphoreHandle_t mutex, TickType_t timeout)
+            : port_(port), installed_(installed), mutex_(mutex), timeout_(timeout) {}
+
+        size_t write(const int16_t* frames, size_t frameCount) override {
+            size_t bytesWritten = 0;
+            xSemaphoreTake(mutex_, portMAX_DELAY);
+            if (installed_) {
+                i2s_write(port_, frames, frameCount * 2 * sizeof(int16_t), &bytesWritten, timeout_);
+            }
+            xSemaphoreGive(mutex_);
+            return bytesWritten / (2 * sizeof(int16_t));
+        }
+
+    private:
+        i2s_port_t port_;
+        const bool& installed_;
+        SemaphoreHandle_t mutex_;
+        TickType_t timeout_;
+    };
+
+} // namespace
+
 AudioOutputPDM::AudioOutputPDM(int pdm_pin, i2s_port_t i2s_port)
     : m_i2s_port(i2s_port),
       m_pdm_pin((gpio_num_t)pdm_pin),
       m_driver_installed(false),
       m_buffer(nullptr),
-      m_buffer_ptr(0) {
+      m_buffer_ptr(0),
+      m_ring_storage(nullptr),
+      m_i2s_mutex(xSemaphoreCreateMutex()),
+      m_room_signal(xSemaphoreCreateBinary()),
+      m_output_task(nullptr) {
+    uint32_t capacity = RING_SAMPLES;
+    m_ring_storage = (int16_t*)ps_malloc(capacity * sizeof(int16_t));
+    if (!m_ring_storage) {
+        capacity = RING_FALLBACK_SAMPLES;
+        m_ring_storage = (int16_t*)malloc(capacity * sizeof(int16_t));
+    }
+    if (!m_ring_storage) {
+        LOG(LogLevel::ERROR, "PDM", "Failed to allocate PCM ring");
+        return;
+    }
+    m_ring.init(m_ring_storage, capacity);
+    m_sink.reset(new I2sSink(m_i2s_port, m_driver_installed, m_i2s_mutex, I2S_WRITE_TIMEOUT));
+    m_stage.reset(new PcmOutputStage(m_ring, *m_sink));
+
+    if (xTaskCreatePinnedToCore(outputTaskEntry, "AudioOutTask", OUTPUT_TASK_STACK_SIZE, this,
+                                OUTPUT_TASK_PRIORITY, &m_output_task, OUTPUT_TASK_CORE) != pdPASS) {
+        m_output_task = nullptr;
+        LOG(LogLevel::ERROR, "PDM", "Failed to create output task");
+    }
 }
 
 AudioOutputPDM::~AudioOutputPDM() {
+    // Holding the driver mutex, the output task is never stopped mid-write.
+    xSemaphoreTake(m_i2s_mutex, portMAX_DELAY);
+    if (m_output_task) {
+        vTaskDelete(m_output_task);
+        m_output_task = nullptr;
+    }
     if (m_driver_installed) {
         i2s_driver_uninstall(m_i2s_port);
+        m_driver_installed = false;
     }
+    xSemaphoreGive(m_i2s_mutex);
+
+    m_stage.reset();
+    m_sink.reset();
+    free(m_ring_storage);
+    m_ring_storage = nullptr;
     if (m_buffer) {
         free(m_buffer);
         m_buffer = nullptr;
     }
+    vSemaphoreDelete(m_room_signal);
+    vSemaphoreDelete(m_i2s_mutex);
+}
+
+void AudioOutputPDM::outputTaskEntry(void* param) {
+    AudioOutputPDM* self = static_cast<AudioOutputPDM*>(param);
+    for (;;) {
+        size_t sent = self->m_stage->pump();
+        xSemaphoreGive(self->m_room_signal);
+        if (sent == 0) {
+            vTaskDelay(pdMS_TO_TICKS(2)); // Ring empty, or paused: the DMA plays silence meanwhile
+        }
+    }
 }
 
 bool AudioOutputPDM::begin() {
@@ -25,13 +101,13 @@ bool AudioOutputPDM::begin() {
     // and ensures the stream is started if it was previously stopped.
     // It does NOT install the driver with a default rate anymore.
     if (m_buffer == nullptr) {
-        m_buffer = (int16_t*)malloc(BUFFER_FRAMES * sizeof(int16_t) * 2);
+        m_buffer = (int16_t*)malloc(STAGE_SAMPLES * sizeof(int16_t));
+        m_buffer_ptr = 0;
     }
-    if (m_buffer == nullptr) {
+    if (m_buffer == nullptr || !m_ring.isReady()) {
         LOG(LogLevel::ERROR, "PDM", "Failed to allocate buffer");
         return false;
     }
-    m_buffer_ptr = 0;
 
     if (m_driver_installed) {
         i2s_start(m_i2s_port);
@@ -53,6 +129,7 @@ bool AudioOutputPDM::SetRate(int hz) {
         return true; // No change needed
     }
 
+    xSemaphoreTake(m_i2s_mutex, portMAX_DELAY);
     if (m_driver_installed) {
         i2s_driver_uninstall(m_i2s_port);
         m_driver_installed = false;
@@ -61,6 +138,7 @@ bool AudioOutputPDM::SetRate(int hz) {
     LOG(LogLevel::INFO, "PDM", "Configuring I2S driver for %d Hz.", hz);
     this->hertz = hz;
     install_i2s_driver();
+    xSemaphoreGive(m_i2s_mutex);
     return m_driver_installed;
 }
 
@@ -73,9 +151,9 @@ void AudioOutputPDM::install_i2s_driver() {
         .communication_format = I2S_COMM_FORMAT_STAND_MSB,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
         .dma_buf_count = 8,
-        .dma_buf_len = 256,
+        .dma_buf_len = PcmOutputStage::BLOCK_FRAMES,
         .use_apll = false,
-        .tx_desc_auto_clear = true,
+        .tx_desc_auto_clear = true, // Silence, not a repeated buffer, if the ring ever runs dry
         .fixed_mclk = 0
     };
     if (i2s_driver_install(m_i2s_port, &i2s_config, 0, NULL) != ESP_OK) {
@@ -96,25 +174,59 @@ void AudioOutputPDM::install_i2s_driver() {
 }
 
 bool AudioOutputPDM::ConsumeSample(int16_t sample[2]) {
-    if (!m_buffer || !m_driver_installed) return false;
-    int32_t mono_sample32 = (int32_t)sample[0] + (int32_t)sample[1];
-    int16_t mono_sample = mono_sample32 / 2;
-    int16_t final_sample = Amplify(mono_sample);
-
-    m_buffer[m_buffer_ptr * 2] = final_sample;
-    m_buffer[m_buffer_ptr * 2 + 1] = final_sample;
-    m_buffer_ptr++;
+    return ConsumeSamples(static_cast<const int16_t*>(sample), (size_t)1) == 1;
+}
 
-    if (m_buffer_ptr >= BUFFER_FRAMES) {
-        flushBuffer();
+size_t AudioOutputPDM::ConsumeSamples(const int16_t* frames, size_t count) {
+    if (!m_buffer || !m_driver_installed) return 0;
+    size_t taken = 0;
+    while (taken < count) {
+        // Ring full: refusing the rest makes the generator hold it and try again.
+        if (m_buffer_ptr >= STAGE_SAMPLES && !pushStaged()) break;
+        size_t n = count - taken;
+        if (n > (size_t)(STAGE_SAMPLES - m_buffer_ptr)) n = STAGE_SAMPLES - m_buffer_ptr;
+        for (const int16_t* sample = frames + 2 * taken; n > 0; --n, sample += 2, ++taken) {
+            int32_t mono_sample32 = (int32_t)sample[0] + (int32_t)sample[1];
+            int16_t mono_sample = mono_sample32 / 2;
+            m_buffer[m_buffer_ptr++] = Amplify(mono_sample);
+        }
     }
+    return taken;
+}
+
+bool AudioOutputPDM::writeBlock(const int16_t* samples, size_t count) {
+    if (!m_driver_installed || !pushStaged()) return false;
+    return m_ring.write(samples, count);
+}
+
+void AudioOutputPDM::flush() {
+    pushStaged();
+}
+
+bool AudioOutputPDM::pushStaged() {
+    if (m_buffer_ptr == 0) return true;
+    if (!m_ring.write(m_buffer, m_buffer_ptr)) return false;
+    m_buffer_ptr = 0;
     return true;
 }
 
-void AudioOutputPDM::flushBuffer() {
-    if (m_buffer_ptr > 0) {
-        size_t bytes_written = 0;
-        i2s_write(m_i2s_port, m_buffer, m_buffer_ptr * sizeof(int16_t) * 2, &bytes_written, portMAX_DELAY);
-        m_buffer_ptr = 0;
-    }
-}
\ No newline at end of file
+void AudioOutputPDM::waitForRoom(TickType_t timeout) {
+    if (m_ring.space() >= (uint32_t)STAGE_SAMPLES) return;
+    xSemaphoreTake(m_room_signal, timeout);
+}
+
+void AudioOutputPDM::discardBuffered() {
+    m_ring.discard();
+}
+
+void AudioOutputPDM::setStreaming(bool streaming) {
+    if (m_stage) m_stage->setStreaming(streaming);
+}
+
+AudioOutputPDM::Stats AudioOutputPDM::getStats() const {
+    Stats stats = {};
+    if (m_stage) stats.output = m_stage->getStats();
+    stats.ringFill = m_ring.available();
+    stats.ringCapacity = m_ring.capacity();
+    return stats;
+}
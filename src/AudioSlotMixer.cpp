@@ -0,0 +1,220 @@
+#include "AudioSlotMixer.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+AudioSlotMixer::AudioSlotMixer(AudioOutputPDM* sink) : sink_(sink) {
+    for (Input& input : inputs_) input.mixer_ = this;
+}
+
+bool AudioSlotMixer::Input::SetRate(int hz) {
+    hertz = hz;
+    if (held_) {
+        pendingRate_ = hz; // The track before it still plays at the old rate
+        return true;
+    }
+    return mixer_->sink_->SetRate(hz); // One rate for every slot
+}
+
+bool AudioSlotMixer::Input::begin() {
+    discardRequested_ = false;
+    count_ = 0;
+    ending_ = false;
+    successor_ = nullptr;
+    pendingRate_ = 0;
+    started_ = false;
+    held_ = holdRequested_;
+    holdRequested_ = false;
+    active_ = true;
+    if (held_) return true;
+    mixer_->cancelFadeRequested_ = true;
+    return mixer_->sink_->begin();
+}
+
+bool AudioSlotMixer::Input::ConsumeSample(int16_t sample[2]) {
+    return ConsumeSamples(static_cast<const int16_t*>(sample), (size_t)1) == 1;
+}
+
+size_t AudioSlotMixer::Input::ConsumeSamples(const int16_t* frames, size_t count) {
+    size_t taken = 0;
+    while (taken < count && active_ && !ending_) {
+        if (count_ == BLOCK_FRAMES) {
+            if (held_) break; // Pre-rolled; waits for follow() or crossfade()
+            mixer_->loop();
+            if (count_ == BLOCK_FRAMES) break; // Ring full
+        }
+        size_t n = std::min(count - taken, BLOCK_FRAMES - count_);
+        int16_t* to = frames_ + 2 * count_;
+        const int16_t* from = frames + 2 * taken;
+        if (channels == 2 && bps == 16) {
+            memcpy(to, from, n * 2 * sizeof(int16_t));
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                int16_t frame[2] = {from[2 * i], from[2 * i + 1]};
+                MakeSampleStereo16(frame); // Mono and 8-bit sources, as the library's stubs did
+                to[2 * i] = frame[0];
+                to[2 * i + 1] = frame[1];
+            }
+        }
+        count_ += n;
+        taken += n;
+    }
+    return taken;
+}
+
+bool AudioSlotMixer::Input::stop() {
+    if (active_) ending_ = true;
+    return true;
+}
+
+void AudioSlotMixer::follow(Input* prev, Input* next) {
+    if (next->held_) prev->successor_ = next;
+}
+
+bool AudioSlotMixer::crossfade(Input* from, Input* to, uint32_t frames) {
+    if (!to->held_ || fadeTo_) return false;
+    int toRate = to->pendingRate_ ? to->pendingRate_ : to->hertz;
+    if (toRate != from->hertz) return false;
+    fadeFrom_ = from;
+    fadeTo_ = to;
+    fadeFrames_ = std::max<uint32_t>(frames, 1);
+    fadePos_ = 0;
+    release(*to);
+    return true;
+}
+
+void AudioSlotMixer::release(Input& input) {
+    if (!input.held_) return;
+    input.held_ = false;
+    if (input.pendingRate_) sink_->SetRate(input.pendingRate_);
+    input.pendingRate_ = 0;
+}
+
+void AudioSlotMixer::endFade() {
+    fadeFrom_ = nullptr;
+    fadeTo_ = nullptr;
+}
+
+bool AudioSlotMixer::spliceSuccessors() {
+    for (Input& input : inputs_) {
+        Input* next = input.successor_;
+        if (!next) continue;
+        if (!next->active_) { // Dropped before its turn
+            input.successor_ = nullptr;
+            continue;
+        }
+        if (!input.active_) { // Drained: the successor carries on from here
+            // At another rate, only once the ring has played out what is left at this one.
+            bool rateChange = next->pendingRate_ && next->pendingRate_ != input.hertz;
+            if (rateChange && (int32_t)(sink_->getWritePosition() - sink_->getPlayPosition()) > 0) continue;
+            input.successor_ = nullptr;
+            release(*next);
+            continue;
+        }
+        if (!input.ending_ || input.count_ >= BLOCK_FRAMES) continue;
+        if (next->pendingRate_ && next->pendingRate_ != input.hertz) continue; // Drains first, then the rate changes
+
+        // Top the last block up with the successor's first frames, so it plays straight on.
+        size_t need = BLOCK_FRAMES - input.count_;
+        if (next->count_ < need && !next->ending_) return false; // Still pre-rolling
+        size_t take = std::min(need, next->count_);
+        if (take > 0 && !next->started_) {
+            next->startPosition_ = sink_->getWritePosition() + input.count_;
+            next->started_ = true;
+        }
+        memcpy(input.frames_ + 2 * input.count_, next->frames_, take * 2 * sizeof(int16_t));
+        memmove(next->frames_, next->frames_ + 2 * take, (next->count_ - take) * 2 * sizeof(int16_t));
+        input.count_ += take;
+        next->count_ -= take;
+    }
+    return true;
+}
+
+bool AudioSlotMixer::loop() {
+    const int16_t* blocks[PcmKernels::MAX_INPUTS];
+    uint16_t gains[PcmKernels::MAX_INPUTS];
+    Input* mixed[PcmKernels::MAX_INPUTS];
+    size_t inputCount = 0;
+    size_t frames = BLOCK_FRAMES;
+    size_t endingFrames = 0;
+    bool anyPlaying = false;
+
+    for (Input& input : inputs_) {
+        if (input.discardRequested_) {
+            input.discardRequested_ = false;
+            input.active_ = false;
+            input.held_ = false;
+            input.count_ = 0;
+            input.successor_ = nullptr;
+            input.pendingRate_ = 0;
+        }
+    }
+    if (cancelFadeRequested_) {
+        cancelFadeRequested_ = false;
+        endFade();
+    }
+    if (fadeTo_ && !fadeTo_->active_) endFade();
+    if (!spliceSuccessors()) return true;
+
+    for (Input& input : inputs_) {
+        if (!input.active_ || input.held_) continue;
+        if (input.ending_) {
+            if (input.count_ == 0) {
+                input.active_ = false;
+                continue;
+            }
+            endingFrames = std::max(endingFrames, input.count_);
+        } else {
+            frames = std::min(frames, input.count_);
+            anyPlaying = true;
+        }
+        mixed[inputCount++] = &input;
+    }
+    if (!anyPlaying) frames = endingFrames; // Only tails left: flush them
+    else if (frames < BLOCK_FRAMES) return true;
+    if (frames == 0) return true;
+
+    float fadeIn = 1.0f, fadeOut = 1.0f;
+    if (fadeTo_) {
+        // One step per block (~3 ms), taken at its midpoint.
+        float progress = std::min(1.0f, (fadePos_ + frames / 2.0f) / fadeFrames_);
+        fadeIn = sinf(progress * (float)M_PI_2);
+        fadeOut = cosf(progress * (float)M_PI_2);
+    }
+    for (size_t k = 0; k < inputCount; ++k) {
+        Input& input = *mixed[k];
+        if (input.count_ < frames) {
+            memset(input.frames_ + 2 * input.count_, 0, (frames - input.count_) * 2 * sizeof(int16_t));
+        }
+        blocks[k] = input.frames_;
+        gains[k] = PcmKernels::gainFromQ6(input.gainF2P6);
+        if (&input == fadeTo_) gains[k] = (uint16_t)(gains[k] * fadeIn + 0.5f);
+        else if (&input == fadeFrom_) gains[k] = (uint16_t)(gains[k] * fadeOut + 0.5f);
+    }
+    PcmKernels::mixToMono(mono_, blocks, gains, inputCount, frames);
+    uint32_t position = sink_->getWritePosition();
+    if (!sink_->writeBlock(mono_, frames)) return false;
+
+    for (size_t k = 0; k < inputCount; ++k) {
+        Input& input = *mixed[k];
+        if (!input.started_) {
+            input.startPosition_ = position;
+            input.started_ = true;
+        }
+        size_t used = std::min(input.count_, frames);
+        memmove(input.frames_, input.frames_ + 2 * used, (input.count_ - used) * 2 * sizeof(int16_t));
+        input.count_ -= used;
+        if (input.ending_ && input.count_ == 0) input.active_ = false;
+    }
+
+    if (fadeTo_) {
+        fadePos_ += frames;
+        if (fadePos_ >= fadeFrames_) {
+            // Faded out: what is left of the old track is silent, so it goes now.
+            fadeFrom_->active_ = false;
+            fadeFrom_->count_ = 0;
+            endFade();
+        }
+    }
+    return true;
+}
@@ -5,6 +5,7 @@
 #include <esp_wifi.h>
 #include "Config.h" 
 #include "SdCardManager.h"
+#include <algorithm>
 
 static const uint32_t SNIFF_DURATION_MS = 2500; 
 static const uint32_t ATTACK_DURATION_MS = 750;
@@ -99,12 +100,15 @@ bool BadMsgAttacker::start(const std::string& filePath, const WifiNetworkInfo& t
         return false;
     }
 
-    while(true) {
-        String line = reader.readLine();
-        if (line.isEmpty()) break;
-        
+    std::string_view line;
+    while (reader.readLine(line)) {
+        char macText[18]; // "aa:bb:cc:dd:ee:ff" + NUL; sscanf needs a terminated copy
+        size_t len = std::min(line.size(), sizeof(macText) - 1);
+        memcpy(macText, line.data(), len);
+        macText[len] = '\0';
+
         uint8_t mac[6];
-        if (sscanf(line.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) == 6) {
+        if (sscanf(macText, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) == 6) {
             StationInfo client;
             memcpy(client.mac, mac, 6);
             memcpy(client.ap_bssid, targetAp.bssid, 6);
@@ -7,28 +7,34 @@
 #include "Event.h"
 #include "EventDispatcher.h"
 
+BeaconFileListDataSource::BeaconFileListDataSource() : loader_("BeaconListLoad") {}
+
 void BeaconFileListDataSource::onEnter(App* app, ListMenu* menu, bool isForwardNav) {
     fileNames_.clear();
-    const char* dirPath = SD_ROOT::USER_BEACON_LISTS;
-    
-    // The directory is created at boot by SdCardManager::getInstance().ensureStandardDirs()
-    File root = SdCardManager::getInstance().openFileUncached(dirPath);
-    if (!root || !root.isDirectory()) return;
-
-    File file = root.openNextFile();
-    while(file) {
-        if (!file.isDirectory() && String(file.name()).endsWith(".txt")) {
-            fileNames_.push_back(file.name());
-        }
-        file.close();
-        file = root.openNextFile();
-    }
-    root.close();
 
-    fileNames_.push_back("Back");
+    // --- NEW: Walk the directory on a loader task; entries are picked up in onUpdate ---
+    loader_.start([](AsyncListLoader<std::string>& loader) {
+        // The directory is created at boot by SdCardManager::getInstance().ensureStandardDirs()
+        bool found = SdCardManager::getInstance().forEachDirEntry(SD_ROOT::USER_BEACON_LISTS, [&loader](const SdCardManager::DirEntry& entry) {
+            if (entry.isDir || !String(entry.name.c_str()).endsWith(".txt")) return true;
+            return loader.push(entry.name);
+        });
+        if (!found) return;
+
+        loader.push("Back"); // No-op if cancelled
+    });
+}
+
+void BeaconFileListDataSource::onUpdate(App* app, ListMenu* menu) {
+    loader_.drain(fileNames_);
+}
+
+bool BeaconFileListDataSource::isLoading() const {
+    return loader_.isLoading();
 }
 
 void BeaconFileListDataSource::onExit(App* app, ListMenu* menu) {
+    loader_.cancel();
 }
 
 int BeaconFileListDataSource::getNumberOfItems(App* app) {
@@ -1,6 +1,7 @@
 #include "BeaconSpammer.h"
 #include "App.h"
 #include <WiFi.h>
+#include <algorithm>
 #include <esp_wifi.h>
 #include "Config.h"
 #include "Logger.h"
@@ -49,7 +50,8 @@ bool BeaconSpammer::start(std::unique_ptr<HardwareManager::RfLock> rfLock, Beaco
         // --- VALIDATION LOGIC ---
         // Try to read one line. If it's empty, our new readLine() implementation
         // has determined the file has no valid content.
-        if (!ssidReader_.isOpen() || ssidReader_.readLine().isEmpty()) {
+        std::string_view firstSsid;
+        if (!ssidReader_.isOpen() || !ssidReader_.readLine(firstSsid)) {
             LOG(LogLevel::WARN, "BEACON", "SSID file is invalid or contains no valid SSIDs: %s", ssidFilePath.c_str());
             if (ssidReader_.isOpen()) ssidReader_.close(); // Clean up the reader.
             rfLock_.reset(); // Release the hardware lock since we are failing.
@@ -119,9 +121,10 @@ BeaconSpammer::FakeAP BeaconSpammer::getNextFakeAP() {
     ap.bssid[0] = (ap.bssid[0] & 0xFE) | 0x02;
 
     if (currentMode_ == BeaconSsidMode::FILE_BASED && ssidReader_.isOpen()) {
-        String ssid = ssidReader_.readLine(); // This is now robust
-        if (ssid.length() > 32) ssid = ssid.substring(0, 32);
-        ap.ssid = ssid.c_str(); // Will be empty if file ends, handled in loop()
+        std::string_view ssid;
+        if (ssidReader_.readLine(ssid)) {
+            ap.ssid.assign(ssid.data(), std::min<size_t>(ssid.size(), 32));
+        } // Otherwise empty: the file has ended, handled in loop()
     } else { // RANDOM mode
         char random_buffer[33];
         const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
@@ -190,9 +193,10 @@ bool BeaconSpammer::isSsidFileValid(const std::string& ssidFilePath) {
     if (!reader.isOpen()) {
         return false;
     }
-    // readLine() now correctly returns an empty string if the file is empty or only has whitespace.
+    // readLine() returns false if the file is empty or only has whitespace.
     // The reader's destructor will close the file automatically when it goes out of scope.
-    return !reader.readLine().isEmpty();
+    std::string_view firstSsid;
+    return reader.readLine(firstSsid);
 }
 
 
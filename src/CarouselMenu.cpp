@@ -3,6 +3,7 @@
 #include "UI_Utils.h"
 #include "Event.h"
 #include "EventDispatcher.h"
+#include "Prefetcher.h"
 #include <Arduino.h>
 
 CarouselMenu::CarouselMenu(std::string title, MenuType menuType, std::vector<MenuItem> items) :
@@ -10,6 +11,7 @@ CarouselMenu::CarouselMenu(std::string title, MenuType menuType, std::vector<Men
     menuItems_(items),
     menuType_(menuType),
     selectedIndex_(0),
+    prefetchIndex_(-1),
     marqueeActive_(false),
     marqueeScrollLeft_(true),
     isScrolling_(false), // Initialize new members
@@ -22,6 +24,7 @@ CarouselMenu::CarouselMenu(std::string title, MenuType menuType, std::vector<Men
 void CarouselMenu::onEnter(App* app, bool isForwardNav) {
     EventDispatcher::getInstance().subscribe(EventType::APP_INPUT, this);
     isScrolling_ = false; // Reset state
+    prefetchIndex_ = -1;
 
     if (isForwardNav) {
         selectedIndex_ = 0;
@@ -37,6 +40,12 @@ void CarouselMenu::onUpdate(App* app) {
         app->requestRedraw();
     }
 
+    // --- NEW: Warm whatever the highlighted item leads to ---
+    if (!menuItems_.empty() && selectedIndex_ != prefetchIndex_) {
+        prefetchIndex_ = selectedIndex_;
+        Prefetcher::getInstance().hover(app, menuItems_[selectedIndex_]);
+    }
+
     // Continuous scrolling
     if (isScrolling_) {
         unsigned long currentTime = millis();
@@ -53,6 +62,7 @@ void CarouselMenu::onUpdate(App* app) {
 
 void CarouselMenu::onExit(App* app) {
     EventDispatcher::getInstance().unsubscribe(EventType::APP_INPUT, this);
+    Prefetcher::getInstance().cancel();
     marqueeActive_ = false;
     isScrolling_ = false; // Reset state
 }
@@ -111,6 +111,9 @@ void ConfigManager::applySettings() {
         LOG(LogLevel::INFO, "CONFIG", "Applying new Volume: %d%%", settings_.volume);
         app_->getMusicPlayer().setVolume(settings_.volume);
     }
+    if (settings_.crossfadeSeconds != lastAppliedSettings_.crossfadeSeconds) {
+        app_->getMusicPlayer().setCrossfade(settings_.crossfadeSeconds);
+    }
 
     // Settings like keyboard layout, passwords, and hop delay don't need an explicit "apply" function
     // as they are read by other modules when needed. No action is required here for them.
@@ -129,6 +132,9 @@ void ConfigManager::loadFromEEPROM() {
     EEPROM.get(sizeof(uint32_t), settings_);
     settings_.otaPassword[sizeof(settings_.otaPassword) - 1] = '\0';
     settings_.timezoneString[sizeof(settings_.timezoneString) - 1] = '\0'; // Ensure null termination
+    if (settings_.crossfadeSeconds > MusicPlayer::MAX_CROSSFADE_SECONDS) {
+        settings_.crossfadeSeconds = 0; // Saved before the field existed
+    }
     isEepromValid_ = true;
 }
 
@@ -141,12 +147,13 @@ void ConfigManager::saveToEEPROM() {
 
 void ConfigManager::loadFromSdCard() {
     const char* path = "/config/settings.json";
-    if (!SdCardManager::getInstance().exists(path)) {
+    // Falls back to the previous good copy if the last save was cut short.
+    String jsonStr;
+    if (!SdCardManager::getInstance().readFileAtomic(path, jsonStr)) {
         isEepromValid_ = false;
         return;
     }
 
-    String jsonStr = SdCardManager::getInstance().readFile(path);
     JsonDocument doc;
     if (deserializeJson(doc, jsonStr)) {
         isEepromValid_ = false;
@@ -162,6 +169,8 @@ void ConfigManager::loadFromSdCard() {
     settings_.attackCooldownMs = doc["attack_cooldown_ms"] | 30000; // Default to 30 seconds
     settings_.secondaryWidgetMask = doc["widget_mask"] | 9; // Default to RAM (bit 0) and CPU (bit 3)
     strlcpy(settings_.timezoneString, doc["timezone_string"] | "UTC0", sizeof(settings_.timezoneString)); // <-- MODIFIED
+    int crossfadeSeconds = doc["crossfade_s"] | 0;
+    settings_.crossfadeSeconds = (crossfadeSeconds < 0 || crossfadeSeconds > MusicPlayer::MAX_CROSSFADE_SECONDS) ? 0 : crossfadeSeconds;
     
     if ((size_t)settings_.keyboardLayoutIndex >= keyboardLayouts_.size()) {
         settings_.keyboardLayoutIndex = 0;
@@ -182,10 +191,11 @@ void ConfigManager::saveToSdCard() {
     doc["attack_cooldown_ms"] = settings_.attackCooldownMs;
     doc["widget_mask"] = settings_.secondaryWidgetMask;
     doc["timezone_string"] = settings_.timezoneString; // <-- MODIFIED
+    doc["crossfade_s"] = settings_.crossfadeSeconds;
 
     String jsonStr;
     serializeJson(doc, jsonStr);
-    SdCardManager::getInstance().writeFile(path, jsonStr.c_str());
+    SdCardManager::getInstance().writeFileAtomic(path, jsonStr.c_str(), jsonStr.length());
 }
 
 void ConfigManager::useDefaultSettings() {
@@ -198,6 +208,7 @@ void ConfigManager::useDefaultSettings() {
     settings_.attackCooldownMs = 1; // 1 seconds
     settings_.secondaryWidgetMask = 9; // Default to RAM (bit 0) and CPU (bit 3)
     strcpy(settings_.timezoneString, "UTC0"); // <-- MODIFIED
+    settings_.crossfadeSeconds = 0;
 }
 
 bool ConfigManager::reloadFromSdCard() {
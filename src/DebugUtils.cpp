@@ -75,8 +75,10 @@ const char* menuTypeToString(MenuType type) {
         case MenuType::WIFI_CONNECTION_STATUS: return "WIFI_CONNECTION_STATUS";
         case MenuType::MUSIC_LIBRARY: return "MUSIC_LIBRARY";
         case MenuType::SONG_LIST: return "SONG_LIST";
+        case MenuType::SEARCH_RESULTS: return "SEARCH_RESULTS";
         case MenuType::NOW_PLAYING: return "NOW_PLAYING";
         case MenuType::INFO_MENU: return "INFO_MENU";
+        case MenuType::SD_BENCHMARK: return "SD_BENCHMARK";
 
         case MenuType::AIR_MOUSE_MODE_GRID: return "AIR_MOUSE_MODE_GRID";
         case MenuType::AIR_MOUSE_ACTIVE: return "AIR_MOUSE_ACTIVE";
@@ -6,46 +6,48 @@
 #include "Event.h"
 #include "EventDispatcher.h"
 
-DuckyScriptListDataSource::DuckyScriptListDataSource() : modeToExecute_(DuckyScriptRunner::Mode::USB) {}
+DuckyScriptListDataSource::DuckyScriptListDataSource() : loader_("DuckyListLoad"), modeToExecute_(DuckyScriptRunner::Mode::USB) {}
 
 void DuckyScriptListDataSource::setExecutionMode(DuckyScriptRunner::Mode mode) {
     modeToExecute_ = mode;
 }
 
 void DuckyScriptListDataSource::onEnter(App* app, ListMenu* menu, bool isForwardNav) {
-    fileNames_.clear();
-    filePaths_.clear();
-    const char* dirPath = SD_ROOT::USER_DUCKY;
-    
-    // --- THIS IS THE FIX ---
-    File root = SdCardManager::getInstance().openFileUncached(dirPath);
-    if (!root || !root.isDirectory()) return;
+    scripts_.clear();
 
-    File file = root.openNextFile();
-    while(file) {
-        if (!file.isDirectory() && String(file.name()).endsWith(".txt")) {
-            filePaths_.push_back(file.path());
-            fileNames_.push_back(file.name());
-        }
-        file.close();
-        file = root.openNextFile();
-    }
-    root.close();
+    // --- NEW: Walk the directory on a loader task; entries are picked up in onUpdate ---
+    loader_.start([](AsyncListLoader<ScriptEntry>& loader) {
+        const char* dirPath = SD_ROOT::USER_DUCKY;
+        SdCardManager::getInstance().forEachDirEntry(dirPath, [&loader, dirPath](const SdCardManager::DirEntry& entry) {
+            if (entry.isDir || !String(entry.name.c_str()).endsWith(".txt")) return true;
+            return loader.push({entry.name, std::string(dirPath) + "/" + entry.name});
+        });
+    });
+}
+
+void DuckyScriptListDataSource::onUpdate(App* app, ListMenu* menu) {
+    loader_.drain(scripts_);
 }
 
-void DuckyScriptListDataSource::onExit(App* app, ListMenu* menu) {}
+bool DuckyScriptListDataSource::isLoading() const {
+    return loader_.isLoading();
+}
+
+void DuckyScriptListDataSource::onExit(App* app, ListMenu* menu) {
+    loader_.cancel();
+}
 
 int DuckyScriptListDataSource::getNumberOfItems(App* app) {
-    return fileNames_.size();
+    return scripts_.size();
 }
 
 const std::string& DuckyScriptListDataSource::getSelectedScriptPath(int index) {
-    return filePaths_[index];
+    return scripts_[index].path;
 }
 
 void DuckyScriptListDataSource::onItemSelected(App* app, ListMenu* menu, int index) {
-    if (index >= filePaths_.size()) return;
-    const std::string& path = filePaths_[index];
+    if (index >= scripts_.size()) return;
+    const std::string& path = scripts_[index].path;
     if (app->getDuckyRunner().startScript(path, modeToExecute_)) {
         EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::DUCKY_SCRIPT_ACTIVE));
     } else {
@@ -57,9 +59,9 @@ void DuckyScriptListDataSource::onItemSelected(App* app, ListMenu* menu, int ind
 }
 
 void DuckyScriptListDataSource::drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) {
-    if (index >= fileNames_.size()) return;
+    if (index >= scripts_.size()) return;
 
-    const std::string& label = fileNames_[index];
+    const std::string& label = scripts_[index].name;
     display.setDrawColor(isSelected ? 0 : 1);
 
     drawCustomIcon(display, x + 4, y + (h - IconSize::LARGE_HEIGHT) / 2, IconType::TOOL_INJECTION);
@@ -175,7 +175,10 @@ void DuckyScriptRunner::loop() {
         activeHid_->releaseAll();
         delay(defaultDelay_);
         
-        currentLine_ = scriptReader_.readLine().c_str(); 
+        // Reuses currentLine_'s capacity instead of building a String per line.
+        std::string_view line;
+        if (scriptReader_.readLine(line)) currentLine_.assign(line.data(), line.size());
+        else currentLine_.clear();
 
         if (currentLine_.empty()) {
             state_ = State::FINISHED;
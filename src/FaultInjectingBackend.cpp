@@ -0,0 +1,165 @@
+#ifndef ARDUINO
+
+#include "FaultInjectingBackend.h"
+#include <chrono>
+#include <thread>
+
+class FaultInjectingFile : public IStorageFile {
+public:
+    FaultInjectingFile(std::unique_ptr<IStorageFile> inner, FaultInjectingBackend& owner) :
+        inner_(std::move(inner)), owner_(owner) {}
+
+    size_t read(uint8_t* buf, size_t len) override {
+        owner_.delay();
+        return owner_.powered() ? inner_->read(buf, len) : 0;
+    }
+
+    size_t write(const uint8_t* buf, size_t len) override {
+        owner_.delay();
+        if (!owner_.admitOp()) return 0;
+        size_t admitted = owner_.admitWrite(len);
+        if (admitted == 0) return 0;
+        size_t written = inner_->write(buf, admitted);
+        // A torn write still reaches the media: push it past any buffering so the
+        // next mount sees exactly what a real power cut would have left behind.
+        if (admitted < len) inner_->flush();
+        return written;
+    }
+
+    bool seek(uint64_t pos) override { return owner_.seekAllowed() && inner_->seek(pos); }
+    uint64_t position() const override { return inner_->position(); }
+    uint64_t size() const override { return inner_->size(); }
+
+    bool flush() override {
+        owner_.delay();
+        return owner_.admitOp() && inner_->flush();
+    }
+
+    void close() override { inner_->close(); }
+    bool isOpen() const override { return inner_->isOpen(); }
+    bool isDirectory() const override { return inner_->isDirectory(); }
+    const char* name() const override { return inner_->name(); }
+    const char* path() const override { return inner_->path(); }
+    time_t lastWrite() override { return inner_->lastWrite(); }
+
+    std::unique_ptr<IStorageFile> openNext() override {
+        owner_.delay(); // Each directory entry costs a read of the card
+        owner_.admitEntry();
+        if (!owner_.powered()) return nullptr;
+        auto next = inner_->openNext();
+        return next ? std::make_unique<FaultInjectingFile>(std::move(next), owner_) : nullptr;
+    }
+    void rewind() override { inner_->rewind(); }
+
+    bool preallocate(uint64_t bytes) override { return owner_.powered() && inner_->preallocate(bytes); }
+
+private:
+    std::unique_ptr<IStorageFile> inner_;
+    FaultInjectingBackend& owner_;
+};
+
+void FaultInjectingBackend::setFaults(const Faults& faults) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    faults_ = faults;
+    bytesWritten_ = 0;
+    opsDone_ = 0;
+    entriesDone_ = 0;
+    entryGate_.notify_all();
+}
+
+bool FaultInjectingBackend::hasLostPower() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return powerLost_;
+}
+
+uint64_t FaultInjectingBackend::getBytesWritten() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytesWritten_;
+}
+
+uint64_t FaultInjectingBackend::getOpsDone() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return opsDone_;
+}
+
+bool FaultInjectingBackend::begin() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        powerLost_ = false;
+    }
+    return inner_.begin();
+}
+
+void FaultInjectingBackend::delay() {
+    uint32_t micros;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        micros = faults_.latencyMicros;
+    }
+    if (micros) std::this_thread::sleep_for(std::chrono::microseconds(micros));
+}
+
+bool FaultInjectingBackend::powered() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !powerLost_;
+}
+
+bool FaultInjectingBackend::seekAllowed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !powerLost_ && !faults_.failSeeks;
+}
+
+size_t FaultInjectingBackend::admitWrite(size_t len) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (powerLost_) return 0;
+
+    uint64_t admitted = len;
+    if (faults_.spaceLeftBytes != UNLIMITED) {
+        if (admitted > faults_.spaceLeftBytes) admitted = faults_.spaceLeftBytes;
+        faults_.spaceLeftBytes -= admitted;
+    }
+    if (faults_.powerLossAfterBytes != UNLIMITED) {
+        uint64_t remaining = faults_.powerLossAfterBytes - bytesWritten_;
+        if (admitted >= remaining) {
+            admitted = remaining;
+            powerLost_ = true;
+        }
+    }
+    bytesWritten_ += admitted;
+    return (size_t)admitted;
+}
+
+bool FaultInjectingBackend::admitOp() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (powerLost_) return false;
+    if (faults_.powerLossAfterOps != UNLIMITED && opsDone_ >= faults_.powerLossAfterOps) {
+        powerLost_ = true;
+        return false;
+    }
+    opsDone_++;
+    return true;
+}
+
+void FaultInjectingBackend::admitEntry() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    entryGate_.wait(lock, [this] {
+        return faults_.holdAfterEntries == UNLIMITED || entriesDone_ < faults_.holdAfterEntries;
+    });
+    entriesDone_++;
+}
+
+std::unique_ptr<IStorageFile> FaultInjectingBackend::open(const char* path, StorageMode mode) {
+    delay();
+    if (!(mode == StorageMode::READ ? powered() : admitOp())) return nullptr;
+    auto file = inner_.open(path, mode);
+    return file ? std::make_unique<FaultInjectingFile>(std::move(file), *this) : nullptr;
+}
+
+bool FaultInjectingBackend::exists(const char* path) { return powered() && inner_.exists(path); }
+bool FaultInjectingBackend::mkdir(const char* path) { return admitOp() && inner_.mkdir(path); }
+bool FaultInjectingBackend::remove(const char* path) { return admitOp() && inner_.remove(path); }
+bool FaultInjectingBackend::rename(const char* pathFrom, const char* pathTo) {
+    return admitOp() && inner_.rename(pathFrom, pathTo);
+}
+
+#endif // ARDUINO
@@ -2,22 +2,24 @@
 #include <ArduinoJson.h>
 #include <MD5Builder.h>
 #include <SD.h>
+#include "SdCardManager.h"
+#include "ReadAheadStream.h"
+#include <algorithm>
 
 namespace FirmwareUtils {
 
+static constexpr size_t MD5_BLOCK_SIZE = 32 * 1024;
+static constexpr size_t MD5_BLOCK_COUNT = 4;
+
 bool parseMetadataFile(const String& kfwFilePath, FirmwareInfo& info) {
-    if (!SD.exists(kfwFilePath)) {
-        info.isValid = false;
-        return false;
-    }
-    File metaFile = SD.open(kfwFilePath, FILE_READ);
-    if (!metaFile) {
+    // Cached: .kfw files are tiny and every write to them goes through SdCardManager.
+    String content = SdCardManager::getInstance().readFile(kfwFilePath.c_str());
+    if (content.isEmpty()) {
         info.isValid = false;
         return false;
     }
     JsonDocument doc; // <-- CORRECTED
-    DeserializationError error = deserializeJson(doc, metaFile);
-    metaFile.close();
+    DeserializationError error = deserializeJson(doc, content);
     if (error) {
         info.isValid = false;
         return false;
@@ -36,7 +38,8 @@ bool parseMetadataFile(const String& kfwFilePath, FirmwareInfo& info) {
 }
 
 bool saveMetadataFile(const String& kfwFilePath, const FirmwareInfo& info) {
-    File metaFile = SD.open(kfwFilePath, FILE_WRITE);
+    // Go through SdCardManager so the firmware folder's cached listing is invalidated.
+    File metaFile = SdCardManager::getInstance().openFileUncached(kfwFilePath.c_str(), FILE_WRITE);
     if (!metaFile) return false;
     JsonDocument doc; // <-- CORRECTED
     doc["version"] = info.version;
@@ -46,18 +49,29 @@ bool saveMetadataFile(const String& kfwFilePath, const FirmwareInfo& info) {
     doc["description"] = info.description;
     bool success = serializeJson(doc, metaFile) > 0;
     metaFile.close();
+    SdCardManager::getInstance().finishWrite(kfwFilePath.c_str());
     return success;
 }
 
-String calculateFileMD5(fs::FS &fs, const String& filePath) {
-    File file = fs.open(filePath, FILE_READ);
-    if (!file || file.isDirectory()) {
+String calculateFileMD5(const String& filePath) {
+    // Hashing overlaps with the card reads instead of waiting on each one.
+    ReadAheadStream stream;
+    if (!stream.open(filePath.c_str(), MD5_BLOCK_SIZE, MD5_BLOCK_COUNT)) {
         return "";
     }
     MD5Builder md5;
     md5.begin();
-    md5.addStream(file, file.size());
-    file.close();
+    uint8_t buffer[1024];
+    size_t remaining = stream.size();
+    while (remaining > 0) {
+        size_t bytesRead = stream.read(buffer, std::min(sizeof(buffer), remaining));
+        if (bytesRead == 0) {
+            return ""; // Read error: a partial hash would only mislead
+        }
+        md5.add(buffer, bytesRead);
+        remaining -= bytesRead;
+    }
+    stream.close();
     md5.calculate();
     return md5.toString();
 }
@@ -6,28 +6,52 @@
 #include "UI_Utils.h"
 #include "ListMenu.h" // For getting marquee text
 
-FirmwareListDataSource::FirmwareListDataSource() {}
+// Parsing .kfw metadata goes through ArduinoJson, so give the loader a bit more stack.
+FirmwareListDataSource::FirmwareListDataSource() : loader_("FwListLoad", 6144), scanComplete_(false) {}
 
 void FirmwareListDataSource::onEnter(App* app, ListMenu* menu, bool isForwardNav) {
-    rebuildDisplayItems(app);
+    firmwares_.clear();
+    displayItems_.clear();
+    scanComplete_ = false;
+
+    // --- NEW: Parse metadata on a loader task; entries are picked up in onUpdate ---
+    loader_.start([](AsyncListLoader<FirmwareInfo>& loader) {
+        OtaManager::forEachSdFirmware([&loader](const FirmwareInfo& info) {
+            return loader.push(info);
+        });
+    });
+}
+
+void FirmwareListDataSource::onUpdate(App* app, ListMenu* menu) {
+    // Sample the loading state before draining so the final batch is never missed.
+    bool loading = loader_.isLoading();
+    size_t added = loader_.drain(firmwares_);
+    if (added > 0 || (!loading && !scanComplete_)) {
+        scanComplete_ = !loading;
+        rebuildDisplayItems(app);
+    }
+}
+
+bool FirmwareListDataSource::isLoading() const {
+    return loader_.isLoading();
 }
 
 void FirmwareListDataSource::onExit(App* app, ListMenu* menu) {
+    loader_.cancel();
     displayItems_.clear();
 }
 
 void FirmwareListDataSource::rebuildDisplayItems(App* app) {
-    OtaManager& ota = app->getOtaManager();
-    ota.scanSdForFirmware();
-    
     displayItems_.clear();
-    const auto& firmwares = ota.getAvailableFirmwares();
 
-    for(size_t i = 0; i < firmwares.size(); ++i) {
-        displayItems_.push_back({firmwares[i].version, false, (int)i});
+    for(size_t i = 0; i < firmwares_.size(); ++i) {
+        displayItems_.push_back({firmwares_[i].version, false, (int)i});
     }
 
-    if (firmwares.empty()) {
+    // The trailing entries only make sense once the whole folder has been read.
+    if (!scanComplete_) return;
+
+    if (firmwares_.empty()) {
         displayItems_.push_back({"No firmware found", true, -1});
     }
     displayItems_.push_back({"Back", true, -1});
@@ -38,6 +62,7 @@ int FirmwareListDataSource::getNumberOfItems(App* app) {
 }
 
 void FirmwareListDataSource::onItemSelected(App* app, ListMenu* menu, int index) {
+    if (index >= displayItems_.size()) return;
     const auto& selected = displayItems_[index];
     if (selected.isBackButton) {
         if (selected.label == "Back") {
@@ -45,15 +70,15 @@ void FirmwareListDataSource::onItemSelected(App* app, ListMenu* menu, int index)
         }
         // "No firmware" item is also a back button, but does nothing on click.
     } else {
-        const auto& firmwares = app->getOtaManager().getAvailableFirmwares();
-        if(selected.firmwareIndex >= 0 && (size_t)selected.firmwareIndex < firmwares.size()) {
-            app->getOtaManager().startSdUpdate(firmwares[selected.firmwareIndex]);
+        if(selected.firmwareIndex >= 0 && (size_t)selected.firmwareIndex < firmwares_.size()) {
+            app->getOtaManager().startSdUpdate(firmwares_[selected.firmwareIndex]);
             EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::OTA_STATUS));
         }
     }
 }
 
 void FirmwareListDataSource::drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) {
+    if (index >= displayItems_.size()) return;
     const auto& item = displayItems_[index];
 
     display.setDrawColor(isSelected ? 0 : 1);
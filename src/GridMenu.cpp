@@ -3,6 +3,7 @@
 #include "UI_Utils.h"
 #include "Event.h"
 #include "EventDispatcher.h"
+#include "Prefetcher.h"
 #include <Arduino.h>
 #include <algorithm> // For std::min
 
@@ -12,6 +13,7 @@ GridMenu::GridMenu(std::string title, MenuType menuType, std::vector<MenuItem> i
     menuType_(menuType),
     columns_(columns),
     selectedIndex_(0),
+    prefetchIndex_(-1),
     animation_(),
     marqueeActive_(false),
     marqueeScrollLeft_(true),
@@ -25,6 +27,7 @@ void GridMenu::onEnter(App *app, bool isForwardNav)
 {
     EventDispatcher::getInstance().subscribe(EventType::APP_INPUT, this);
     isScrolling_ = false;
+    prefetchIndex_ = -1;
 
     animation_.resize(menuItems_.size()); // Always ensure vectors are sized correctly.
 
@@ -70,6 +73,12 @@ void GridMenu::onUpdate(App *app)
     if (animation_.update()) {
         app->requestRedraw();
     }
+
+    // --- NEW: Warm whatever the highlighted item leads to ---
+    if (!menuItems_.empty() && selectedIndex_ != prefetchIndex_) {
+        prefetchIndex_ = selectedIndex_;
+        Prefetcher::getInstance().hover(app, menuItems_[selectedIndex_]);
+    }
     
     // Continuous scrolling
     if (isScrolling_) {
@@ -89,6 +98,7 @@ void GridMenu::onUpdate(App *app)
 void GridMenu::onExit(App *app)
 {
     EventDispatcher::getInstance().unsubscribe(EventType::APP_INPUT, this);
+    Prefetcher::getInstance().cancel();
     marqueeActive_ = false;
     isScrolling_ = false; // Reset state on exit
 }
@@ -2,7 +2,9 @@
 #include "App.h"
 #include "ConfigManager.h"
 #include "Logger.h"
+#include "PerfStats.h"
 #include "SdCardManager.h"
+#include "SdWriter.h"
 #include <WiFi.h>
 #include <esp_wifi.h>
 #include "Deauther.h"
@@ -115,6 +117,8 @@ void HandshakeCapture::stop() {
     isAttackPending_ = false;
     esp_wifi_set_promiscuous(false);
     rfLock_.reset();
+    // Captures are queued while sniffing; make sure they are on the card once the user stops.
+    SdWriter::getInstance().sync();
     // app_->getHardwareManager().setPerformanceMode(false);
 }
 
@@ -150,6 +154,7 @@ void HandshakeCapture::loop() {
 }
 
 void HandshakeCapture::packetHandlerCallback(void* buf, wifi_promiscuous_pkt_type_t type) {
+    PerfStats::count(PerfCounter::SNIFFER_PACKETS);
     if (instance_ != nullptr) {
         instance_->handlePacket(static_cast<wifi_promiscuous_pkt_t*>(buf));
     }
@@ -227,18 +232,16 @@ void HandshakeCapture::saveHandshake(const wifi_promiscuous_pkt_t *packet, bool
     if (beacon && !fileExists) return;
 
     char filename[64];
-    sprintf(filename, "/data/captures/handshakes/HS_%02X%02X%02X%02X%02X%02X.pcap", apAddr[0], apAddr[1], apAddr[2], apAddr[3], apAddr[4], apAddr[5]);
-
-    File pcapFile = SdCardManager::getInstance().openFileUncached(filename, fileExists ? FILE_APPEND : FILE_WRITE);
-    if (!pcapFile) {
-        LOG(LogLevel::ERROR, "HS_CAPTURE", "Failed to open pcap file: %s", filename);
-        return;
-    }
+    sprintf(filename, "%s/HS_%02X%02X%02X%02X%02X%02X.pcap", SD_ROOT::DATA_CAPTURES_HANDSHAKES, apAddr[0], apAddr[1], apAddr[2], apAddr[3], apAddr[4], apAddr[5]);
 
+    // Both writes below only queue for SdWriter; this runs on the Wi-Fi task.
     if (!beacon && !fileExists) {
+        if (!writeHeader(filename)) {
+            LOG(LogLevel::ERROR, "HS_CAPTURE", "Failed to queue pcap file: %s", filename);
+            return;
+        }
         savedHandshakes.push_back(bssid_str);
         handshakeCount_++;
-        writeHeader(pcapFile);
         if (currentConfig_.type == HandshakeCaptureType::TARGETED) {
             targetedState_ = TargetedAttackState::COOLDOWN;
             handshakeCapturedTime_ = millis();
@@ -250,15 +253,14 @@ void HandshakeCapture::saveHandshake(const wifi_promiscuous_pkt_t *packet, bool
     uint32_t timestamp_usec = packet->rx_ctrl.timestamp % 1000000;
     uint32_t payload_len = packet->rx_ctrl.sig_len;
 
-    pcapFile.write((uint8_t*)&timestamp_sec, 4);
-    pcapFile.write((uint8_t*)&timestamp_usec, 4);
-    pcapFile.write((uint8_t*)&payload_len, 4);
-    pcapFile.write((uint8_t*)&payload_len, 4);
-    pcapFile.write(packet->payload, payload_len);
-    pcapFile.close();
+    uint32_t recordHeader[4] = { timestamp_sec, timestamp_usec, payload_len, payload_len };
+    if (!SdWriter::getInstance().appendRecord(filename, recordHeader, sizeof(recordHeader), packet->payload, payload_len)) {
+        LOG(LogLevel::WARN, "HS_CAPTURE", false, "Write queue full, dropped a frame for %s", filename);
+    }
 }
 
-bool HandshakeCapture::writeHeader(File file) {
+// Starts (or restarts) a capture file with the pcap global header.
+bool HandshakeCapture::writeHeader(const char* path) {
     uint8_t header[] = {
         0xd4, 0xc3, 0xb2, 0xa1,
         0x02, 0x00, 0x04, 0x00,
@@ -269,11 +271,7 @@ bool HandshakeCapture::writeHeader(File file) {
         // Change Link-layer type to 105 (DLT_IEEE802_11)
         0x69, 0x00, 0x00, 0x00
     };
-    if (file) {
-        file.write(header, sizeof(header));
-        return true;
-    }
-    return false;
+    return SdWriter::getInstance().write(path, header, sizeof(header));
 }
 
 #define EAPOL_KEY_INFO_KEY_TYPE_BIT (1 << 3)
@@ -313,10 +311,7 @@ void HandshakeCapture::parsePMKID(const wifi_promiscuous_pkt_t *packet) {
             for (size_t i = 0; i < ssid.length(); i++) sprintf(&ssid_hex[i*2], "%02x", ssid[i]);
             char output_str[200];
             sprintf(output_str, "%s*%s*%s*%s", pmkid_str, bssid_str, station_mac_str, ssid_hex);
-            File pmkid_file = SdCardManager::getInstance().openFileUncached("/data/captures/pmkid.txt", FILE_APPEND);
-            if (pmkid_file) {
-                pmkid_file.println(output_str);
-                pmkid_file.close();
+            if (SdWriter::getInstance().appendLine("/data/captures/pmkid.txt", output_str)) {
                 pmkidCount_++;
                 LOG(LogLevel::INFO, "HS_CAPTURE", "Captured PMKID: %s", output_str);
             }
@@ -3,6 +3,7 @@
 #include "InfoMenu.h"
 #include "App.h"
 #include "SystemDataProvider.h"
+#include "SdCardManager.h"
 #include "UI_Utils.h"
 #include <vector>
 #include <string>
@@ -95,13 +96,27 @@ void InfoMenu::buildInfoItems(App* app) {
 
     // SD Card
     const auto& sd = data.getSdCardUsage();
-    if (sd.total > 0) {
+    if (sd.total > 0 && !SdCardManager::getInstance().isUsedSpaceKnown()) {
+        infoItems_.push_back({"SD Card", "Scanning...", true, SecondaryWidgetType::WIDGET_SD});
+    } else if (sd.total > 0) {
         std::string sdStr = SystemDataProvider::formatBytes(sd.used) + "/" + SystemDataProvider::formatBytes(sd.total);
         infoItems_.push_back({"SD Card", sdStr, true, SecondaryWidgetType::WIDGET_SD});
     } else {
         infoItems_.push_back({"SD Card", "Not Mounted", false, {}});
     }
 
+    // --- NEW: PSRAM file cache ---
+    SdCardManager::FileCacheStats cache = SdCardManager::getInstance().getFileCacheStats();
+    std::string cacheStr = SystemDataProvider::formatBytes(cache.bytes) + "/" + SystemDataProvider::formatBytes(cache.capacity);
+    infoItems_.push_back({"File Cache", cacheStr, false, {}});
+
+    uint32_t lookups = cache.hits + cache.misses;
+    snprintf(buffer, sizeof(buffer), "%u%% of %lu", lookups ? (unsigned)((uint64_t)cache.hits * 100 / lookups) : 0u, (unsigned long)lookups);
+    infoItems_.push_back({"Cache Hits", buffer, false, {}});
+
+    snprintf(buffer, sizeof(buffer), "%lu/%lu", (unsigned long)cache.evictions, (unsigned long)cache.bypasses);
+    infoItems_.push_back({"Evict/Skip", buffer, false, {}});
+
     // CPU Freq
     snprintf(buffer, sizeof(buffer), "%d MHz", data.getCpuFrequency());
     infoItems_.push_back({"CPU Freq", buffer, true, SecondaryWidgetType::WIDGET_CPU});
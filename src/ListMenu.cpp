@@ -3,13 +3,16 @@
 #include "UI_Utils.h"
 #include "Event.h"
 #include "EventDispatcher.h"
+#include "Prefetcher.h"
 
 ListMenu::ListMenu(std::string title, MenuType menuType, IListMenuDataSource* dataSource) : 
     title_(title),
     menuType_(menuType),
     dataSource_(dataSource),
     selectedIndex_(0),
+    prefetchIndex_(-1),
     totalItems_(0),
+    isLoading_(false),
     marqueeActive_(false),
     marqueeScrollLeft_(true),
     isScrolling_(false), // Initialize new members
@@ -36,13 +39,39 @@ void ListMenu::reloadData(App* app, bool resetSelection) {
 
     marqueeActive_ = false;
     marqueeScrollLeft_ = true;
+    isLoading_ = dataSource_->isLoading();
     animation_.startIntro(selectedIndex_, totalItems_);
 }
 
+// --- NEW: Picks up items that an async data source produced since the last frame ---
+void ListMenu::syncItemCount(App* app) {
+    int count = dataSource_->getNumberOfItems(app);
+    bool loading = dataSource_->isLoading();
+
+    if (count != totalItems_) {
+        if (totalItems_ == 0 || count < totalItems_) {
+            // First results (or a reset): play the normal intro, keep the cursor where it was.
+            reloadData(app, false);
+        } else {
+            // More results: extend the list in place so the user can keep scrolling.
+            animation_.grow(count, selectedIndex_);
+            totalItems_ = count;
+            animation_.setTargets(selectedIndex_, totalItems_);
+        }
+        app->requestRedraw();
+    }
+
+    if (loading || loading != isLoading_) {
+        app->requestRedraw(); // Keeps the loading row's dots moving
+    }
+    isLoading_ = loading;
+}
+
 void ListMenu::onEnter(App* app, bool isForwardNav) {
     EventDispatcher::getInstance().subscribe(EventType::APP_INPUT, this);
     if (!dataSource_) return;
     isScrolling_ = false; // Reset state on enter
+    prefetchIndex_ = -1;
     dataSource_->onEnter(app, this, isForwardNav);
     reloadData(app, isForwardNav);
 }
@@ -53,6 +82,8 @@ void ListMenu::onUpdate(App* app) {
     }
     if (dataSource_) {
         dataSource_->onUpdate(app, this);
+        syncItemCount(app);
+        updatePrefetch(app);
     }
     
     if (isScrolling_) {
@@ -71,6 +102,7 @@ void ListMenu::onUpdate(App* app) {
 
 void ListMenu::onExit(App* app) {
     EventDispatcher::getInstance().unsubscribe(EventType::APP_INPUT, this);
+    Prefetcher::getInstance().cancel();
     if (dataSource_) {
         dataSource_->onExit(app, this);
     }
@@ -78,6 +110,24 @@ void ListMenu::onExit(App* app) {
     isScrolling_ = false; // Reset state on exit
 }
 
+// --- NEW: Hand the highlighted item's target to Prefetcher whenever the selection moves ---
+void ListMenu::updatePrefetch(App* app) {
+    if (totalItems_ == 0 || selectedIndex_ == prefetchIndex_) return;
+    prefetchIndex_ = selectedIndex_;
+
+    std::string path = dataSource_->getItemPrefetchPath(selectedIndex_);
+    const MenuItem* item = dataSource_->getItem(selectedIndex_);
+    if (path.empty() && item) {
+        Prefetcher::getInstance().hover(app, *item);
+    } else {
+        Prefetcher::getInstance().hover(path);
+    }
+}
+
+std::string ListMenu::getPrefetchPath() const {
+    return dataSource_ ? dataSource_->getPrefetchPath() : "";
+}
+
 void ListMenu::handleInput(InputEvent event, App* app) {
     if (!dataSource_) return;
 
@@ -139,6 +189,13 @@ void ListMenu::handleInput(InputEvent event, App* app) {
             dataSource_->onItemSelected(app, this, selectedIndex_);
             break;
 
+        // --- NEW: Type-ahead search over the list's labels ---
+        case InputEvent::BTN_A_PRESS:
+            if (dataSource_->isSearchable() && !isLoading_) {
+                app->getSearchListDataSource().begin(app, dataSource_, title_);
+            }
+            break;
+
         // Back Navigation
         case InputEvent::BTN_BACK_PRESS:
             if (!dataSource_->onBackPress(app, this)) {
@@ -167,7 +224,9 @@ void ListMenu::draw(App* app, U8G2& display) {
     if (!dataSource_) return;
 
     if (totalItems_ == 0) {
-        if (!dataSource_->drawCustomEmptyMessage(app, display)) {
+        if (isLoading_) {
+            drawLoadingRow(display, 38);
+        } else if (!dataSource_->drawCustomEmptyMessage(app, display)) {
             const char *msg = "No items";
             display.setFont(u8g2_font_6x10_tf);
             display.drawStr((display.getDisplayWidth() - display.getStrWidth(msg)) / 2, 38, msg);
@@ -200,10 +259,29 @@ void ListMenu::draw(App* app, U8G2& display) {
         dataSource_->drawItem(app, display, this, i, 2, item_top_y, 124, item_h, isSelected);
     }
 
+    // --- NEW: Placeholder row under the last item while results are still arriving ---
+    if (isLoading_) {
+        int last_center_y_rel = (int)animation_.itemOffsetY[totalItems_ - 1] + item_h;
+        int loading_center_y_abs = (list_start_y + (63 - list_start_y) / 2) + last_center_y_rel;
+        if (loading_center_y_abs - item_h / 2 <= 63) {
+            display.setDrawColor(1);
+            drawLoadingRow(display, loading_center_y_abs + 4);
+        }
+    }
+
     display.setDrawColor(1);
     display.setMaxClipWindow();
 }
 
+void ListMenu::drawLoadingRow(U8G2& display, int y) {
+    static const char* const frames[] = {"Loading", "Loading.", "Loading..", "Loading..."};
+    const char* msg = frames[(millis() / 300) % 4];
+    display.setFont(u8g2_font_6x10_tf);
+    // Anchor on the widest frame so the text does not jitter as the dots change
+    int x = (display.getDisplayWidth() - display.getStrWidth(frames[3])) / 2;
+    display.drawStr(x, y, msg);
+}
+
 void ListMenu::updateAndDrawText(U8G2& display, const char* text, int x, int y, int availableWidth, bool isSelected) {
     if (isSelected) {
         updateMarquee(marqueeActive_, marqueePaused_, marqueeScrollLeft_, 
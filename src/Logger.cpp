@@ -1,8 +1,41 @@
 #include "Logger.h"
 #include "SdCardManager.h"
-#include <vector>
-#include <algorithm>
 #include <time.h>
+#include <esp_system.h>
+
+namespace {
+    constexpr size_t MAX_DEFINED_STRING = 240; // Longer literals are cut in the file
+    constexpr size_t MAX_INDEX_SIZE = 5;       // A 32-bit varint
+
+#ifdef ENABLE_DEBUG_PRINT
+    char levelChar(uint8_t level) {
+        switch (static_cast<LogLevel>(level)) {
+            case LogLevel::DEBUG: return 'D';
+            case LogLevel::INFO:  return 'I';
+            case LogLevel::WARN:  return 'W';
+            case LogLevel::ERROR: return 'E';
+            default:              return '?';
+        }
+    }
+
+    // Text form of a ring record, as the log used to store it: "<millis> [I] [TAG] message\r\n".
+    size_t renderRecord(char* out, size_t capacity, const uint8_t* record, uint32_t len) {
+        BinaryLog::MessageHeader header;
+        memcpy(&header, record, sizeof(header));
+        // Two bytes are kept back for the "\r\n".
+        const size_t room = capacity - 2;
+        int prefix = snprintf(out, room, "%lu [%c] [%s] ", (unsigned long)header.millis, levelChar(header.level), header.tag);
+        size_t lineLen = (prefix < 0) ? 0 : ((size_t)prefix < room ? (size_t)prefix : room - 1);
+        lineLen += BinaryLog::render(out + lineLen, room - lineLen, header.format,
+                                     record + sizeof(header), len - sizeof(header));
+        out[lineLen++] = '\r';
+        out[lineLen++] = '\n';
+        return lineLen;
+    }
+#endif
+
+    size_t definedLength(const char* literal) { return strnlen(literal, MAX_DEFINED_STRING); }
+}
 
 // Singleton instance definition
 Logger& Logger::getInstance() {
@@ -10,12 +43,40 @@ Logger& Logger::getInstance() {
     return instance;
 }
 
-Logger::Logger() : isInitialized_(false) {}
+Logger::Logger() :
+    drainMutex_(xSemaphoreCreateMutex()),
+    taskHandle_(nullptr),
+    isInitialized_(false),
+    currentLogFile_(""),
+    lastMillis_(0),
+    sessionBytes_(0),
+    droppedLines_(0)
+{
+    uint32_t capacity = RING_BYTES;
+    uint8_t* storage = (uint8_t*)ps_malloc(capacity);
+    if (!storage) {
+        capacity = RING_FALLBACK_BYTES;
+        storage = (uint8_t*)malloc(capacity);
+    }
+    if (storage) ring_.init(storage, capacity);
+
+    // Lines logged before setup() wait in the ring and still reach the file once it is open.
+    if (xTaskCreatePinnedToCore(taskEntry, "LogFlush", TASK_STACK_SIZE, this, TASK_PRIORITY, &taskHandle_, TASK_CORE) != pdPASS) {
+        taskHandle_ = nullptr;
+        Serial.println("[LOGGER] Failed to create flusher task; lines are only written by flush().");
+    }
+    esp_register_shutdown_handler(&Logger::onShutdown);
+}
 
 void Logger::setup() {
+    // Stop file output first: the previous session log is about to be archived.
+    xSemaphoreTake(drainMutex_, portMAX_DELAY);
+    isInitialized_ = false;
+    stringIndex_.clear();
+    xSemaphoreGive(drainMutex_);
+
     if (!SdCardManager::getInstance().isAvailable()) {
         Serial.println("[LOGGER] SD Card not available. File logging disabled.");
-        isInitialized_ = false;
         return;
     }
 
@@ -24,69 +85,168 @@ void Logger::setup() {
         SdCardManager::getInstance().createDir(logDir);
     }
 
-    manageLogFiles();
-
-    char latestLogPath[64];
-    snprintf(latestLogPath, sizeof(latestLogPath), "%s/system_log_latest.txt", logDir);
-    currentLogFile_ = latestLogPath;
+    snprintf(currentLogFile_, sizeof(currentLogFile_), "%s/%s", logDir, LATEST_LOG_NAME);
+    archiveSessionLog();
+    startSessionLog();
 
     isInitialized_ = true;
-    Serial.printf("[LOGGER] Logging to new file: %s\n", currentLogFile_.c_str());
+    Serial.printf("[LOGGER] Logging to new file: %s\n", currentLogFile_);
     log(LogLevel::INFO, "LOGGER", "--- System Boot ---");
 }
 
-void Logger::manageLogFiles() {
-    const char* logDir = SD_ROOT::DATA_LOGS;
-    const char* logPrefix = "system_log_";
-    const char* latestLogName = "system_log_latest.txt";
-    const char* logExtension = ".txt";
-
-    char previousLatestPath[64];
-    snprintf(previousLatestPath, sizeof(previousLatestPath), "%s/%s", logDir, latestLogName);
-
-    if (SdCardManager::getInstance().exists(previousLatestPath)) {
-        time_t now;
-        time(&now);
-        struct tm timeinfo;
-        localtime_r(&now, &timeinfo);
-
-        char timestamp[20];
-        strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &timeinfo);
-
-        char archivePath[64];
-        snprintf(archivePath, sizeof(archivePath), "%s/%s%s%s", logDir, logPrefix, timestamp, logExtension);
-        
-        if (SdCardManager::getInstance().renameFile(previousLatestPath, archivePath)) {
-            Serial.printf("[LOGGER] Archived previous log to: %s\n", archivePath);
-        } else {
-            Serial.printf("[LOGGER] ERROR: Failed to archive %s\n", previousLatestPath);
+void Logger::push(const uint8_t* record, size_t len, bool toFile) {
+    ring_.push((const char*)record, len, toFile ? RECORD_TO_FILE : 0);
+    // Past half full the flusher is woken early rather than risking drops.
+    if (taskHandle_ && ring_.usedBytes() > ring_.capacity() / 2) {
+        xTaskNotifyGive(taskHandle_);
+    }
+}
+
+void Logger::flush(uint32_t timeoutMs) {
+    drainRing();
+    if (isInitialized_) SdWriter::getInstance().sync(timeoutMs);
+}
+
+void Logger::onShutdown() {
+    getInstance().flush();
+}
+
+void Logger::taskEntry(void* param) {
+    Logger* self = static_cast<Logger*>(param);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FLUSH_INTERVAL_MS));
+        self->drainRing();
+    }
+}
+
+void Logger::drainRing() {
+    xSemaphoreTake(drainMutex_, portMAX_DELAY);
+    bool toFile = isInitialized_;
+    size_t batchLen = 0;
+
+    ring_.drain([&](const char* data, uint32_t len, uint8_t flags) {
+        const uint8_t* record = (const uint8_t*)data;
+        if (len < sizeof(BinaryLog::MessageHeader)) return true;
+        #ifdef ENABLE_DEBUG_PRINT
+        char line[MAX_LINE_LENGTH];
+        Serial.write((const uint8_t*)line, renderRecord(line, sizeof(line), record, len));
+        #endif
+        if (toFile && (flags & RECORD_TO_FILE)) writeRecord(record, len, batchLen);
+        return true;
+    });
+    if (toFile) {
+        appendBatch(batchLen);
+        // Rotated by size rather than only at boot; RetentionManager prunes the archives.
+        if (sessionBytes_ >= MAX_SESSION_LOG_BYTES) {
+            archiveSessionLog();
+            startSessionLog();
         }
     }
 
-    std::vector<String> archivedLogs;
-    // --- THIS IS THE FIX ---
-    File root = SdCardManager::getInstance().openFileUncached(logDir);
-    if (!root || !root.isDirectory()) {
-        if (root) root.close();
-        return;
+    uint32_t dropped = ring_.takeDropped();
+    if (dropped > 0) {
+        droppedLines_ += dropped;
+        // Goes through the ring like any other line and is written on the next pass.
+        log(LogLevel::WARN, "LOGGER", "%lu lines dropped: log ring full", (unsigned long)dropped);
     }
+    xSemaphoreGive(drainMutex_);
+}
 
-    File file = root.openNextFile();
-    while(file) {
-        String fileName = file.name();
-        if (!file.isDirectory() && fileName.startsWith(logPrefix) && fileName != latestLogName) {
-            archivedLogs.push_back(String(logDir) + "/" + fileName);
+void Logger::writeRecord(const uint8_t* record, uint32_t len, size_t& batchLen) {
+    BinaryLog::MessageHeader header;
+    memcpy(&header, record, sizeof(header));
+    size_t argsLen = len - sizeof(header);
+
+    // The message and the sync and string definitions it needs go into the same batch, so a
+    // failed append can't leave a message whose strings never reached the file.
+    size_t needed = 2 * BinaryLog::MAX_FRAME_HEADER_SIZE + BinaryLog::MAX_MESSAGE_HEADER_SIZE + argsLen;
+    for (const char* literal : {header.format, header.tag}) {
+        if (!stringIndex_.count(literal)) {
+            needed += BinaryLog::MAX_FRAME_HEADER_SIZE + MAX_INDEX_SIZE + definedLength(literal);
         }
-        file.close();
-        file = root.openNextFile();
     }
-    root.close();
+    if (batchLen + needed > sizeof(batch_)) appendBatch(batchLen);
+
+    if (stringIndex_.empty()) {
+        batchLen += BinaryLog::putFrameHeader(batch_ + batchLen, BinaryLog::FRAME_SYNC, 0);
+        lastMillis_ = 0;
+    }
+    uint32_t formatIndex = defineString(header.format, batchLen);
+    uint32_t tagIndex = defineString(header.tag, batchLen);
+
+    uint8_t messageHeader[BinaryLog::MAX_MESSAGE_HEADER_SIZE];
+    size_t headerLen = 0;
+    messageHeader[headerLen++] = header.level;
+    // Tasks can publish a millisecond out of order; the reader adds deltas modulo 2^32.
+    headerLen += BinaryLog::putVarint(messageHeader + headerLen, (uint32_t)(header.millis - lastMillis_));
+    headerLen += BinaryLog::putVarint(messageHeader + headerLen, formatIndex);
+    headerLen += BinaryLog::putVarint(messageHeader + headerLen, tagIndex);
+    lastMillis_ = header.millis;
+
+    batchLen += BinaryLog::putFrameHeader(batch_ + batchLen, BinaryLog::FRAME_MESSAGE, headerLen + argsLen);
+    memcpy(batch_ + batchLen, messageHeader, headerLen);
+    memcpy(batch_ + batchLen + headerLen, record + sizeof(header), argsLen);
+    batchLen += headerLen + argsLen;
+}
+
+uint32_t Logger::defineString(const char* literal, size_t& batchLen) {
+    auto it = stringIndex_.find(literal);
+    if (it != stringIndex_.end()) return it->second;
+
+    uint32_t index = stringIndex_.size();
+    stringIndex_.emplace(literal, index);
+    uint8_t indexBytes[MAX_INDEX_SIZE];
+    size_t indexLen = BinaryLog::putVarint(indexBytes, index);
+    size_t textLen = definedLength(literal);
+    batchLen += BinaryLog::putFrameHeader(batch_ + batchLen, BinaryLog::FRAME_STRING, indexLen + textLen);
+    memcpy(batch_ + batchLen, indexBytes, indexLen);
+    memcpy(batch_ + batchLen + indexLen, literal, textLen);
+    batchLen += indexLen + textLen;
+    return index;
+}
+
+void Logger::appendBatch(size_t& batchLen) {
+    if (batchLen == 0) return;
+    if (SdWriter::getInstance().append(currentLogFile_, batch_, batchLen)) {
+        sessionBytes_ += batchLen;
+    } else {
+        stringIndex_.clear(); // What this batch defined never reached the file: start over with a sync
+    }
+    batchLen = 0;
+}
+
+void Logger::archiveSessionLog() {
+    if (!SdCardManager::getInstance().exists(currentLogFile_)) return;
+    // The writer may still hold the log open (e.g. when re-initialised after USB mode).
+    SdWriter::getInstance().release(currentLogFile_);
+
+    time_t now;
+    time(&now);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
 
-    std::sort(archivedLogs.begin(), archivedLogs.end());
+    char timestamp[20];
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &timeinfo);
 
-    while (!archivedLogs.empty() && archivedLogs.size() >= MAX_LOG_FILES) {
-        Serial.printf("[LOGGER] Max log files reached. Deleting oldest archive: %s\n", archivedLogs[0].c_str());
-        SdCardManager::getInstance().deleteFile(archivedLogs[0].c_str());
-        archivedLogs.erase(archivedLogs.begin());
+    char archivePath[64];
+    snprintf(archivePath, sizeof(archivePath), "%s/%s%s%s", SD_ROOT::DATA_LOGS, SD_ROOT::LOG_BASE_NAME, timestamp, LOG_EXTENSION);
+
+    if (SdCardManager::getInstance().renameFile(currentLogFile_, archivePath)) {
+        Serial.printf("[LOGGER] Archived previous log to: %s\n", archivePath);
+    } else {
+        Serial.printf("[LOGGER] ERROR: Failed to archive %s\n", currentLogFile_);
     }
-}
\ No newline at end of file
+}
+
+void Logger::startSessionLog() {
+    // A fresh session log starts as a preallocated stream; one that failed to archive is appended to
+    // (after a FRAME_SYNC, so its strings are simply defined again).
+    if (!SdCardManager::getInstance().exists(currentLogFile_)) {
+        uint8_t fileHeader[sizeof(BinaryLog::FILE_MAGIC) + 1];
+        memcpy(fileHeader, BinaryLog::FILE_MAGIC, sizeof(BinaryLog::FILE_MAGIC));
+        fileHeader[sizeof(BinaryLog::FILE_MAGIC)] = BinaryLog::FILE_VERSION;
+        SdWriter::getInstance().write(currentLogFile_, fileHeader, sizeof(fileHeader), LOG_PREALLOCATE_BYTES);
+    }
+    stringIndex_.clear();
+    sessionBytes_ = 0; // A log we failed to archive gets another MAX_SESSION_LOG_BYTES before the next try
+}
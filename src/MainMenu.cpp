@@ -3,10 +3,12 @@
 #include "UI_Utils.h"
 #include "Event.h"           // For event types
 #include "EventDispatcher.h" // For subscribing
+#include "Prefetcher.h"
 #include <algorithm> // For std::max
 
 MainMenu::MainMenu() : 
     selectedIndex_(0),
+    prefetchIndex_(-1),
     isScrolling_(false), // Initialize new members
     scrollDirection_(0),
     pressStartTime_(0),
@@ -21,6 +23,7 @@ MainMenu::MainMenu() :
 void MainMenu::onEnter(App* app, bool isForwardNav) {
     EventDispatcher::getInstance().subscribe(EventType::APP_INPUT, this);
     isScrolling_ = false; // Reset state
+    prefetchIndex_ = -1;
 
     if (isForwardNav) {
         selectedIndex_ = 0;
@@ -34,6 +37,12 @@ void MainMenu::onUpdate(App* app) {
     if (animation_.update()) {
         app->requestRedraw();
     }
+
+    // --- NEW: Warm whatever the highlighted item leads to ---
+    if (!menuItems_.empty() && selectedIndex_ != prefetchIndex_) {
+        prefetchIndex_ = selectedIndex_;
+        Prefetcher::getInstance().hover(app, menuItems_[selectedIndex_]);
+    }
     
     // Continuous scrolling
     if (isScrolling_) {
@@ -51,6 +60,7 @@ void MainMenu::onUpdate(App* app) {
 
 void MainMenu::onExit(App* app) {
     EventDispatcher::getInstance().unsubscribe(EventType::APP_INPUT, this);
+    Prefetcher::getInstance().cancel();
     isScrolling_ = false; // Reset state
 }
 
@@ -0,0 +1,412 @@
+#include "Mp3SeekTable.h"
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+    // Bitrates in kbps, by table (below) and the header's 4-bit index; 0 is free format.
+    const uint16_t BITRATES[5][15] = {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448}, // MPEG1 Layer I
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},    // MPEG1 Layer II
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},     // MPEG1 Layer III
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},    // MPEG2/2.5 Layer I
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}          // MPEG2/2.5 Layer II & III
+    };
+    const uint32_t SAMPLE_RATES[3] = {44100, 48000, 32000}; // MPEG1; halved for MPEG2, quartered for 2.5
+
+    constexpr size_t SEARCH_CHUNK = 1024;
+    constexpr size_t FIRST_FRAME_WINDOW = 64 * 1024; // Encoders may pad after the ID3 tag
+    constexpr size_t CBR_PROBES = 8;                 // Frames sampled across the file
+    constexpr size_t SCAN_CHUNK = 16 * 1024;
+    constexpr uint32_t SCAN_STRIDE = 32;             // Frames between the offsets a scan keeps
+
+    uint32_t readBE32(const uint8_t* p) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+    uint16_t readBE16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+    bool sameStream(const Mp3SeekTable::FrameHeader& h, uint32_t sampleRate, uint16_t samplesPerFrame) {
+        return sampleRate == 0 || (h.sampleRate == sampleRate && h.samplesPerFrame == samplesPerFrame);
+    }
+
+    /**
+     * First frame in [offset, offset + window) that is followed by another of the same
+     * stream (or by the end of the data). sampleRate 0 accepts any stream.
+     */
+    int64_t searchFrame(Mp3SeekTable::Source& source, uint64_t offset, uint64_t end, size_t window,
+                        uint32_t sampleRate, uint16_t samplesPerFrame, Mp3SeekTable::FrameHeader& out) {
+        uint8_t chunk[SEARCH_CHUNK + 3];
+        uint64_t stop = std::min<uint64_t>(end, offset + window);
+        for (uint64_t base = offset; base < stop; base += SEARCH_CHUNK) {
+            size_t got = source.readAt(base, chunk, (size_t)std::min<uint64_t>(sizeof(chunk), end - base));
+            if (got < 4) break;
+            for (size_t i = 0; i + 4 <= got && base + i < stop; ++i) {
+                if (chunk[i] != 0xFF) continue;
+                Mp3SeekTable::FrameHeader h;
+                if (!Mp3SeekTable::parseHeader(chunk + i, h) || !sameStream(h, sampleRate, samplesPerFrame)) continue;
+
+                uint64_t next = base + i + h.bytes;
+                if (next + 4 > end) {
+                    if (next != end) continue;
+                } else {
+                    uint8_t nextBytes[4];
+                    const uint8_t* nextHeader = nextBytes;
+                    if (next + 4 <= base + got) {
+                        nextHeader = chunk + (next - base);
+                    } else if (source.readAt(next, nextBytes, 4) != 4) {
+                        continue;
+                    }
+                    Mp3SeekTable::FrameHeader n;
+                    if (!Mp3SeekTable::parseHeader(nextHeader, n) || !sameStream(n, h.sampleRate, h.samplesPerFrame)) continue;
+                }
+                out = h;
+                return (int64_t)(base + i);
+            }
+        }
+        return -1;
+    }
+
+    int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool nextField(std::string_view& rest, std::string_view& field) {
+        if (rest.empty()) return false;
+        size_t comma = rest.find(',');
+        field = rest.substr(0, comma);
+        rest = (comma == std::string_view::npos) ? std::string_view() : rest.substr(comma + 1);
+        return true;
+    }
+
+    bool parseNumber(std::string_view text, uint32_t& out) {
+        if (text.empty() || text.size() > 10) return false;
+        uint64_t value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return false;
+            value = value * 10 + (c - '0');
+        }
+        if (value > UINT32_MAX) return false;
+        out = (uint32_t)value;
+        return true;
+    }
+
+} // namespace
+
+bool Mp3SeekTable::parseHeader(const uint8_t* b, FrameHeader& out) {
+    if (b[0] != 0xFF || (b[1] & 0xE0) != 0xE0) return false;
+    uint8_t version = (b[1] >> 3) & 3; // 3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+    uint8_t layer = (b[1] >> 1) & 3;   // 3 = Layer I, 2 = II, 1 = III
+    uint8_t bitrateIdx = b[2] >> 4;
+    uint8_t rateIdx = (b[2] >> 2) & 3;
+    if (version == 1 || layer == 0 || bitrateIdx == 0 || bitrateIdx == 15 || rateIdx == 3) return false;
+
+    bool mpeg1 = (version == 3);
+    int table = mpeg1 ? 3 - layer : (layer == 3 ? 3 : 4);
+    out.version = version;
+    out.layer = layer;
+    out.bitrateKbps = BITRATES[table][bitrateIdx];
+    out.sampleRate = SAMPLE_RATES[rateIdx] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    out.samplesPerFrame = (layer == 3) ? 384 : ((layer == 1 && !mpeg1) ? 576 : 1152);
+    out.mono = ((b[3] >> 6) == 3);
+    uint32_t padding = (b[2] >> 1) & 1;
+    if (layer == 3) {
+        out.bytes = (uint16_t)((12 * out.bitrateKbps * 1000 / out.sampleRate + padding) * 4);
+    } else {
+        out.bytes = (uint16_t)(out.samplesPerFrame / 8 * out.bitrateKbps * 1000 / out.sampleRate + padding);
+    }
+    return true;
+}
+
+bool Mp3SeekTable::build(Source& source, bool allowScan) {
+    kind_ = Kind::NONE;
+    points_.clear();
+    uint64_t size = source.size();
+    if (size < 4 || size > UINT32_MAX) return false;
+
+    uint32_t start = 0;
+    uint8_t tag[10];
+    if (source.readAt(0, tag, sizeof(tag)) == sizeof(tag) && memcmp(tag, "ID3", 3) == 0) {
+        start = 10 + (((tag[6] & 0x7F) << 21) | ((tag[7] & 0x7F) << 14) | ((tag[8] & 0x7F) << 7) | (tag[9] & 0x7F));
+        if (tag[5] & 0x10) start += 10; // Footer
+    }
+    uint32_t end = (uint32_t)size;
+    if (size >= 128 + start && source.readAt(size - 128, tag, 3) == 3 && memcmp(tag, "TAG", 3) == 0) {
+        end -= 128; // ID3v1
+    }
+
+    FrameHeader first;
+    int64_t framePos = searchFrame(source, start, end, FIRST_FRAME_WINDOW, 0, 0, first);
+    if (framePos < 0) return false;
+
+    sampleRate_ = first.sampleRate;
+    samplesPerFrame_ = first.samplesPerFrame;
+    dataStart_ = (uint32_t)framePos;
+    dataEnd_ = end;
+
+    if (readXing(source, dataStart_, first) || readVbri(source, dataStart_)) {
+        if (!allowScan || points_.empty() || getDurationMs() <= SCAN_ABOVE_MS) return true;
+        Mp3SeekTable fromHeader = *this;
+        if (!scanFrames(source)) *this = fromHeader;
+        return true;
+    }
+    if (checkConstantBitrate(source, first)) return true;
+    if (allowScan && scanFrames(source)) return true;
+
+    // Not walked: estimated from the first frame's bitrate, as if it were CBR.
+    kind_ = Kind::CBR;
+    frames_ = (uint32_t)((uint64_t)(dataEnd_ - dataStart_) * 8 * sampleRate_ /
+                         ((uint64_t)first.bitrateKbps * 1000 * samplesPerFrame_));
+    return frames_ > 0;
+}
+
+bool Mp3SeekTable::readXing(Source& source, uint32_t framePos, const FrameHeader& first) {
+    // The tag sits after the side information, whose size depends on version and channels.
+    uint32_t sideInfo = (first.version == 3) ? (first.mono ? 17 : 32) : (first.mono ? 9 : 17);
+    uint8_t xing[4 + 4 + 4 + 4 + XING_POINTS];
+    size_t got = source.readAt(framePos + 4 + sideInfo, xing, sizeof(xing));
+    if (got < 8 || (memcmp(xing, "Xing", 4) != 0 && memcmp(xing, "Info", 4) != 0)) return false;
+
+    uint32_t flags = readBE32(xing + 4);
+    size_t at = 8;
+    uint32_t frames = 0, bytes = 0;
+    if (flags & 0x01) { if (got < at + 4) return false; frames = readBE32(xing + at); at += 4; }
+    if (flags & 0x02) { if (got < at + 4) return false; bytes = readBE32(xing + at); at += 4; }
+    if (frames == 0) return false;
+
+    kind_ = Kind::XING;
+    frames_ = frames;
+    if (bytes > 0 && (uint64_t)framePos + bytes <= dataEnd_) dataEnd_ = framePos + bytes;
+    if (memcmp(xing, "Info", 4) == 0) return true; // LAME's tag for CBR: linear is exact
+    points_.assign(XING_POINTS, 0);
+    if ((flags & 0x04) && got >= at + XING_POINTS) {
+        uint16_t last = 0;
+        for (size_t i = 0; i < XING_POINTS; ++i) {
+            last = std::max<uint16_t>(last, (uint16_t)(xing[at + i] << 8)); // Some encoders write dips
+            points_[i] = last;
+        }
+    } else {
+        for (size_t i = 0; i < XING_POINTS; ++i) points_[i] = (uint16_t)(i * 65536 / XING_POINTS);
+    }
+    return true;
+}
+
+bool Mp3SeekTable::readVbri(Source& source, uint32_t framePos) {
+    uint8_t vbri[26];
+    if (source.readAt(framePos + 36, vbri, sizeof(vbri)) != sizeof(vbri) || memcmp(vbri, "VBRI", 4) != 0) {
+        return false;
+    }
+    uint32_t bytes = readBE32(vbri + 10);
+    uint32_t frames = readBE32(vbri + 14);
+    uint16_t entries = readBE16(vbri + 18);
+    uint16_t scale = readBE16(vbri + 20);
+    uint16_t entrySize = readBE16(vbri + 22);
+    uint16_t framesPerEntry = readBE16(vbri + 24);
+    if (frames == 0) return false;
+
+    kind_ = Kind::VBRI;
+    frames_ = frames;
+    if (bytes > 0 && (uint64_t)framePos + bytes <= dataEnd_) dataEnd_ = framePos + bytes;
+    uint64_t span = dataEnd_ - dataStart_;
+
+    // Entries are the bytes in each run of framesPerEntry frames; resampled onto the time grid.
+    std::vector<uint8_t> table;
+    if (entries > 0 && entrySize >= 1 && entrySize <= 4 && framesPerEntry > 0) {
+        table.resize((size_t)entries * entrySize);
+        if (source.readAt(framePos + 36 + sizeof(vbri), table.data(), table.size()) != table.size()) table.clear();
+    }
+    if (table.empty()) return true; // Linear
+
+    points_.resize(pointsFor(getDurationMs()));
+    uint64_t runStart = 0; // Bytes before the current entry
+    size_t entry = 0;
+    for (size_t i = 0; i < points_.size(); ++i) {
+        uint64_t frame = (uint64_t)i * frames_ / points_.size();
+        uint64_t entryBytes = 0;
+        while (true) {
+            entryBytes = 0;
+            if (entry < entries) {
+                for (size_t k = 0; k < entrySize; ++k) entryBytes = (entryBytes << 8) | table[entry * entrySize + k];
+                entryBytes *= scale;
+            }
+            if (entry >= entries || frame < (uint64_t)(entry + 1) * framesPerEntry) break;
+            runStart += entryBytes;
+            entry++;
+        }
+        uint64_t within = frame - std::min<uint64_t>(frame, (uint64_t)entry * framesPerEntry);
+        uint64_t offset = runStart + entryBytes * within / framesPerEntry;
+        points_[i] = (uint16_t)std::min<uint64_t>(65535, span ? offset * 65536 / span : 0);
+    }
+    return true;
+}
+
+bool Mp3SeekTable::checkConstantBitrate(Source& source, const FrameHeader& first) {
+    uint64_t span = dataEnd_ - dataStart_;
+    for (size_t probe = 1; probe <= CBR_PROBES; ++probe) {
+        FrameHeader h;
+        uint64_t at = dataStart_ + span * probe / (CBR_PROBES + 1);
+        if (searchFrame(source, at, dataEnd_, RESYNC_WINDOW, sampleRate_, samplesPerFrame_, h) < 0) return false;
+        if (h.bitrateKbps != first.bitrateKbps) return false;
+    }
+    kind_ = Kind::CBR;
+    frames_ = (uint32_t)(span * 8 * sampleRate_ / ((uint64_t)first.bitrateKbps * 1000 * samplesPerFrame_));
+    return frames_ > 0;
+}
+
+bool Mp3SeekTable::scanFrames(Source& source) {
+    std::vector<uint8_t> chunk(SCAN_CHUNK);
+    std::vector<uint32_t> offsets; // Of every SCAN_STRIDE-th frame
+    uint64_t chunkStart = 0;
+    size_t chunkLen = 0;
+    uint64_t pos = dataStart_;
+    uint32_t frames = 0;
+
+    while (pos + 4 <= dataEnd_) {
+        if (pos < chunkStart || pos + 4 > chunkStart + chunkLen) {
+            chunkStart = pos;
+            chunkLen = source.readAt(pos, chunk.data(), (size_t)std::min<uint64_t>(SCAN_CHUNK, dataEnd_ - pos));
+            if (chunkLen < 4) break;
+        }
+        FrameHeader h;
+        if (!parseHeader(chunk.data() + (pos - chunkStart), h) || !sameStream(h, sampleRate_, samplesPerFrame_)) {
+            int64_t next = searchFrame(source, pos + 1, dataEnd_, RESYNC_WINDOW, sampleRate_, samplesPerFrame_, h);
+            if (next < 0) break; // Junk to the end: the audio ends here
+            pos = (uint64_t)next;
+            continue;
+        }
+        if (frames % SCAN_STRIDE == 0) offsets.push_back((uint32_t)pos);
+        frames++;
+        pos += h.bytes;
+    }
+    if (frames == 0) return false;
+
+    kind_ = Kind::SCANNED;
+    frames_ = frames;
+    dataEnd_ = (uint32_t)std::min<uint64_t>(pos, dataEnd_);
+    uint64_t span = dataEnd_ - dataStart_;
+    points_.resize(pointsFor(getDurationMs()));
+    for (size_t i = 0; i < points_.size(); ++i) {
+        // Between two kept offsets the frames are taken as equal in size.
+        uint64_t frame = (uint64_t)i * frames_ / points_.size();
+        size_t k = frame / SCAN_STRIDE;
+        uint64_t a = offsets[k];
+        uint64_t b = (k + 1 < offsets.size()) ? offsets[k + 1] : dataEnd_;
+        uint64_t runFrames = (k + 1 < offsets.size()) ? SCAN_STRIDE : frames_ - k * SCAN_STRIDE;
+        uint64_t offset = a + (b - a) * (frame - k * SCAN_STRIDE) / runFrames - dataStart_;
+        points_[i] = (uint16_t)std::min<uint64_t>(65535, span ? offset * 65536 / span : 0);
+    }
+    return true;
+}
+
+size_t Mp3SeekTable::pointsFor(uint32_t durationMs) const {
+    size_t points = (durationMs + POINT_SPACING_MS - 1) / POINT_SPACING_MS;
+    return std::max<size_t>(1, std::min(points, MAX_POINTS));
+}
+
+int64_t Mp3SeekTable::findFrame(Source& source, uint64_t offset) const {
+    if (!isValid()) return -1;
+    FrameHeader h;
+    return searchFrame(source, std::max<uint64_t>(offset, dataStart_), dataEnd_, RESYNC_WINDOW,
+                       sampleRate_, samplesPerFrame_, h);
+}
+
+uint32_t Mp3SeekTable::getDurationMs() const {
+    if (!isValid() || sampleRate_ == 0) return 0;
+    return (uint32_t)((uint64_t)frames_ * samplesPerFrame_ * 1000 / sampleRate_);
+}
+
+uint32_t Mp3SeekTable::byteForMs(uint32_t ms) const {
+    uint32_t duration = getDurationMs();
+    if (duration == 0) return dataStart_;
+    if (ms >= duration) return dataEnd_;
+
+    // The time in points as 16.16 fixed point, then the stream fraction between two points.
+    uint64_t scaled = (uint64_t)ms * pointCount() * 65536 / duration;
+    size_t i = (size_t)(scaled >> 16);
+    uint64_t a = pointAt(i), b = pointAt(i + 1);
+    uint64_t fraction = a + (((b - a) * (scaled & 0xFFFF)) >> 16);
+    return dataStart_ + (uint32_t)(((uint64_t)(dataEnd_ - dataStart_) * fraction) >> 16);
+}
+
+uint32_t Mp3SeekTable::msForByte(uint64_t offset) const {
+    uint32_t duration = getDurationMs();
+    if (duration == 0 || offset <= dataStart_) return 0;
+    if (offset >= dataEnd_) return duration;
+
+    uint64_t fraction = (offset - dataStart_) * 65536 / (dataEnd_ - dataStart_);
+    size_t i = 0;
+    if (!points_.empty()) {
+        i = std::upper_bound(points_.begin(), points_.end(), (uint16_t)std::min<uint64_t>(fraction, 65535)) - points_.begin();
+        i = (i > 0) ? i - 1 : 0;
+    }
+    uint64_t a = pointAt(i), b = pointAt(i + 1);
+    uint64_t scaled = ((uint64_t)i << 16) + (b > a ? (fraction - std::min(fraction, a)) * 65536 / (b - a) : 0);
+    return (uint32_t)std::min<uint64_t>(duration, scaled * duration / ((uint64_t)pointCount() << 16));
+}
+
+std::string Mp3SeekTable::serialize() const {
+    if (!isValid()) return std::string();
+    char head[64];
+    snprintf(head, sizeof(head), "%c,%u,%u,%u,%u,%u", (char)kind_, (unsigned)sampleRate_,
+             (unsigned)samplesPerFrame_, (unsigned)frames_, (unsigned)dataStart_, (unsigned)dataEnd_);
+    std::string text = head;
+    if (points_.empty()) return text; // Linear
+
+    static const char HEX[] = "0123456789abcdef";
+    int digits = pointDigits();
+    text += ',';
+    text.reserve(text.size() + points_.size() * digits);
+    for (uint16_t point : points_) {
+        uint16_t value = (digits == 2) ? (uint16_t)(point >> 8) : point;
+        for (int d = digits - 1; d >= 0; --d) text += HEX[(value >> (4 * d)) & 0xF];
+    }
+    return text;
+}
+
+bool Mp3SeekTable::parse(std::string_view text) {
+    kind_ = Kind::NONE;
+    points_.clear();
+    std::string_view rest = text, field;
+    if (!nextField(rest, field) || field.size() != 1) return false;
+    Kind kind = (Kind)field[0];
+    if (kind != Kind::XING && kind != Kind::VBRI && kind != Kind::CBR && kind != Kind::SCANNED) return false;
+
+    uint32_t values[5];
+    for (uint32_t& value : values) {
+        if (!nextField(rest, field) || !parseNumber(field, value)) return false;
+    }
+    if (values[0] == 0 || values[1] == 0 || values[1] > 1152 || values[3] >= values[4]) return false;
+
+    kind_ = kind;
+    if (nextField(rest, field)) {
+        size_t digits = pointDigits();
+        if (field.empty() || field.size() % digits != 0 || field.size() / digits > MAX_POINTS) {
+            kind_ = Kind::NONE;
+            return false;
+        }
+        points_.resize(field.size() / digits);
+        for (size_t i = 0; i < points_.size(); ++i) {
+            uint32_t value = 0;
+            for (size_t d = 0; d < digits; ++d) {
+                int v = hexDigit(field[i * digits + d]);
+                if (v < 0) {
+                    kind_ = Kind::NONE;
+                    points_.clear();
+                    return false;
+                }
+                value = (value << 4) | v;
+            }
+            points_[i] = (uint16_t)(digits == 2 ? value << 8 : value);
+        }
+    }
+    sampleRate_ = values[0];
+    samplesPerFrame_ = (uint16_t)values[1];
+    frames_ = values[2];
+    dataStart_ = values[3];
+    dataEnd_ = values[4];
+    return true;
+}
@@ -0,0 +1,256 @@
+#include "MusicDb.h"
+#include "CrcTrailer.h"
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+#include <string.h>
+
+static_assert(sizeof(MusicDb::Header) == 32, "MusicDb::Header is part of the file format");
+static_assert(sizeof(MusicDb::TrackRecord) == 24, "MusicDb::TrackRecord is part of the file format");
+static_assert(sizeof(MusicDb::DirRecord) == 24, "MusicDb::DirRecord is part of the file format");
+
+constexpr char MusicDb::MAGIC[4];
+
+MusicDb::DirId MusicDb::Builder::addDir(const std::string& path, DirId parent) {
+    size_t slash = path.find_last_of('/');
+    dirs_.push_back({path, slash == std::string::npos ? path : path.substr(slash + 1),
+                     dirs_.empty() ? NO_DIR : parent});
+    return (DirId)(dirs_.size() - 1);
+}
+
+void MusicDb::Builder::addTrack(DirId dir, const std::string& name, uint32_t durationMs, const std::string& seekTable,
+                                uint32_t fileSize, uint32_t lastWrite) {
+    tracks_.push_back({name, seekTable, durationMs, fileSize, lastWrite, dir});
+}
+
+uint32_t MusicDb::Builder::intern(const std::string& text) {
+    if (text.empty()) return 0;
+    auto it = interned_.find(text);
+    if (it != interned_.end()) return it->second;
+    uint32_t offset = (uint32_t)pool_.size();
+    pool_.insert(pool_.end(), text.begin(), text.end());
+    pool_.push_back('\0');
+    interned_.emplace(text, offset);
+    return offset;
+}
+
+std::vector<uint8_t> MusicDb::Builder::finish() {
+    if (dirs_.empty() || dirs_.size() > MAX_DIRS || tracks_.size() > MAX_TRACKS) return {};
+    const size_t dirCount = dirs_.size();
+    const size_t trackCount = tracks_.size();
+
+    // Breadth-first from the root, children by name: each directory's children get consecutive ids.
+    std::vector<std::vector<size_t>> children(dirCount);
+    for (size_t i = 1; i < dirCount; ++i) {
+        if (dirs_[i].parent < dirCount) children[dirs_[i].parent].push_back(i);
+    }
+    std::vector<size_t> order{0};        // New id -> added index
+    std::vector<DirId> newId(dirCount, NO_DIR);
+    newId[0] = 0;
+    for (size_t head = 0; head < order.size(); ++head) {
+        std::vector<size_t>& kids = children[order[head]];
+        std::sort(kids.begin(), kids.end(), [this](size_t a, size_t b) { return dirs_[a].name < dirs_[b].name; });
+        for (size_t kid : kids) {
+            newId[kid] = (DirId)order.size();
+            order.push_back(kid);
+        }
+    }
+    const size_t reachable = order.size(); // Directories whose parent never made it in are dropped
+
+    // Tracks by directory, then name.
+    std::vector<size_t> trackOrder;
+    trackOrder.reserve(trackCount);
+    for (size_t i = 0; i < trackCount; ++i) {
+        if (tracks_[i].dir < dirCount && newId[tracks_[i].dir] != NO_DIR) trackOrder.push_back(i);
+    }
+    std::sort(trackOrder.begin(), trackOrder.end(), [this, &newId](size_t a, size_t b) {
+        DirId dirA = newId[tracks_[a].dir], dirB = newId[tracks_[b].dir];
+        if (dirA != dirB) return dirA < dirB;
+        return tracks_[a].name < tracks_[b].name;
+    });
+
+    pool_.assign(1, '\0');
+    interned_.clear();
+
+    std::vector<TrackRecord> tracks(trackOrder.size());
+    std::vector<DirRecord> dirs(reachable);
+    for (size_t id = 0; id < reachable; ++id) {
+        const PendingDir& dir = dirs_[order[id]];
+        DirRecord& record = dirs[id];
+        record.name = intern(dir.name);
+        record.path = intern(dir.path);
+        record.parent = id == 0 ? NO_DIR : newId[dir.parent];
+        record.childCount = 0;
+        record.firstChild = 0;
+        record.firstTrack = 0;
+        record.trackCount = 0;
+    }
+    for (size_t id = 1; id < reachable; ++id) {
+        DirRecord& parent = dirs[dirs[id].parent];
+        if (parent.childCount++ == 0) parent.firstChild = (uint32_t)id;
+    }
+    for (size_t id = 0; id < trackOrder.size(); ++id) {
+        const PendingTrack& track = tracks_[trackOrder[id]];
+        TrackRecord& record = tracks[id];
+        record.name = intern(track.name);
+        record.seekTable = intern(track.seekTable);
+        record.durationMs = track.durationMs;
+        record.fileSize = track.fileSize;
+        record.lastWrite = track.lastWrite;
+        record.dir = newId[track.dir];
+        record.flags = 0;
+        DirRecord& dir = dirs[record.dir];
+        if (dir.trackCount++ == 0) dir.firstTrack = (uint32_t)id;
+    }
+
+    // The same ranges by duration; name order breaks ties.
+    std::vector<uint16_t> durationOrder(tracks.size());
+    std::iota(durationOrder.begin(), durationOrder.end(), 0);
+    for (const DirRecord& dir : dirs) {
+        auto first = durationOrder.begin() + dir.firstTrack;
+        std::stable_sort(first, first + dir.trackCount, [&tracks](uint16_t a, uint16_t b) {
+            return tracks[a].durationMs < tracks[b].durationMs;
+        });
+    }
+
+    Header header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.headerSize = sizeof(Header);
+    header.trackCount = (uint32_t)tracks.size();
+    header.dirCount = (uint32_t)dirs.size();
+    header.poolSize = (uint32_t)pool_.size();
+
+    std::vector<uint8_t> out(sizeof(Header));
+    auto append = [&out](const void* data, size_t len) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + len);
+    };
+    append(tracks.data(), tracks.size() * sizeof(TrackRecord));
+    append(dirs.data(), dirs.size() * sizeof(DirRecord));
+    append(durationOrder.data(), durationOrder.size() * sizeof(uint16_t));
+    append(pool_.data(), pool_.size());
+    header.crc = CrcTrailer::updateLarge(0, out.data() + sizeof(Header), out.size() - sizeof(Header));
+    memcpy(out.data(), &header, sizeof(Header));
+    return out;
+}
+
+bool MusicDb::load(std::shared_ptr<const uint8_t> data, size_t size) {
+    clear();
+    if (!data || size < sizeof(Header)) return false;
+    Header header;
+    memcpy(&header, data.get(), sizeof(Header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION ||
+        header.headerSize != sizeof(Header)) {
+        return false;
+    }
+    const uint64_t trackCount = header.trackCount, dirCount = header.dirCount, poolSize = header.poolSize;
+    if (trackCount > MAX_TRACKS || dirCount == 0 || dirCount > MAX_DIRS || poolSize == 0) return false;
+    const uint64_t tracksAt = sizeof(Header);
+    const uint64_t dirsAt = tracksAt + trackCount * sizeof(TrackRecord);
+    const uint64_t orderAt = dirsAt + dirCount * sizeof(DirRecord);
+    const uint64_t poolAt = orderAt + trackCount * sizeof(uint16_t);
+    const uint64_t end = poolAt + poolSize;
+    if (end > size) return false;
+
+    const uint8_t* base = data.get();
+    if (CrcTrailer::updateLarge(0, base + sizeof(Header), end - sizeof(Header)) != header.crc) return false;
+
+    const TrackRecord* tracks = reinterpret_cast<const TrackRecord*>(base + tracksAt);
+    const DirRecord* dirs = reinterpret_cast<const DirRecord*>(base + dirsAt);
+    const uint16_t* durationOrder = reinterpret_cast<const uint16_t*>(base + orderAt);
+    const char* pool = reinterpret_cast<const char*>(base + poolAt);
+
+    // Every offset and range, once, so the accessors don't have to.
+    if (pool[0] != '\0' || pool[poolSize - 1] != '\0') return false;
+    for (uint64_t id = 0; id < dirCount; ++id) {
+        const DirRecord& dir = dirs[id];
+        if (dir.name >= poolSize || dir.path >= poolSize) return false;
+        if ((id == 0) != (dir.parent == NO_DIR) || (id != 0 && dir.parent >= id)) return false;
+        if (dir.childCount > 0 && (dir.firstChild <= id || dir.firstChild + (uint64_t)dir.childCount > dirCount)) return false;
+        if ((uint64_t)dir.firstTrack + dir.trackCount > trackCount) return false;
+        for (uint32_t i = 0; i < dir.trackCount; ++i) {
+            if (tracks[dir.firstTrack + i].dir != id) return false;
+        }
+    }
+    for (uint64_t id = 0; id < trackCount; ++id) {
+        const TrackRecord& track = tracks[id];
+        if (track.name >= poolSize || track.seekTable >= poolSize || track.dir >= dirCount) return false;
+        if (durationOrder[id] >= trackCount || tracks[durationOrder[id]].dir != track.dir) return false;
+    }
+
+    data_ = std::move(data);
+    tracks_ = tracks;
+    dirs_ = dirs;
+    durationOrder_ = durationOrder;
+    pool_ = pool;
+    trackCount_ = (size_t)trackCount;
+    dirCount_ = (size_t)dirCount;
+    return true;
+}
+
+void MusicDb::clear() {
+    data_.reset();
+    tracks_ = nullptr;
+    dirs_ = nullptr;
+    durationOrder_ = nullptr;
+    pool_ = nullptr;
+    trackCount_ = 0;
+    dirCount_ = 0;
+}
+
+std::string MusicDb::getTrackPath(TrackId id) const {
+    std::string path = getDirPath(tracks_[id].dir);
+    if (path.empty() || path.back() != '/') path += '/';
+    path += getTrackName(id);
+    return path;
+}
+
+MusicDb::TrackId MusicDb::getDirTrack(DirId id, size_t index, Order order) const {
+    size_t at = dirs_[id].firstTrack + index;
+    return order == Order::DURATION ? durationOrder_[at] : (TrackId)at;
+}
+
+bool MusicDb::findDir(const std::string& path, DirId& id) const {
+    if (!isLoaded()) return false;
+    std::string_view rest = path;
+    std::string_view root = getDirPath(ROOT);
+    if (rest.substr(0, root.size()) != root) return false;
+    rest.remove_prefix(root.size());
+    DirId dir = ROOT;
+    while (!rest.empty()) {
+        if (rest.front() != '/') return false;
+        rest.remove_prefix(1);
+        size_t slash = rest.find('/');
+        std::string_view name = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash);
+        if (name.empty()) continue; // A trailing or doubled slash
+
+        // Children are in name order.
+        size_t lo = 0, hi = getChildDirCount(dir);
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (std::string_view(getDirName(getChildDir(dir, mid))) < name) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == getChildDirCount(dir) || name != getDirName(getChildDir(dir, lo))) return false;
+        dir = getChildDir(dir, lo);
+    }
+    id = dir;
+    return true;
+}
+
+bool MusicDb::findTrack(const std::string& path, TrackId& id) const {
+    size_t slash = path.find_last_of('/');
+    DirId dir;
+    if (slash == std::string::npos || !findDir(path.substr(0, slash), dir)) return false;
+    std::string_view name = std::string_view(path).substr(slash + 1);
+    const TrackRecord* first = tracks_ + dirs_[dir].firstTrack;
+    const TrackRecord* last = first + dirs_[dir].trackCount;
+    const TrackRecord* found = std::lower_bound(first, last, name, [this](const TrackRecord& track, std::string_view key) {
+        return std::string_view(pool_ + track.name) < key;
+    });
+    if (found == last || name != pool_ + found->name) return false;
+    id = (TrackId)(found - tracks_);
+    return true;
+}
@@ -1,6 +1,5 @@
 #include "MusicLibraryDataSource.h" // Renamed header
 #include "App.h"
-#include "SdCardManager.h"
 #include "MusicLibraryManager.h"
 #include "ListMenu.h"
 #include "UI_Utils.h"
@@ -9,16 +8,38 @@
 #include "EventDispatcher.h"
 #include "SongListDataSource.h" // Include the correctly named header
 
-MusicLibraryDataSource::MusicLibraryDataSource() : isReindexing_(false), needsReload_(false) {}
+MusicLibraryDataSource::MusicLibraryDataSource() : app_(nullptr), indexProgress_(0), needsReload_(false) {
+    reindexLabel_[0] = '\0';
+}
 
 void MusicLibraryDataSource::onEnter(App* app, ListMenu* menu, bool isForwardNav) {
-    isReindexing_ = false;
+    app_ = app;
     needsReload_ = false;
-    loadPlaylists();
+    indexProgress_ = app->getMusicLibraryManager().getIndexProgress(); // It may have run on while we were away
+    EventDispatcher::getInstance().subscribe(EventType::MUSIC_INDEX_PROGRESS, this);
+    EventDispatcher::getInstance().subscribe(EventType::MUSIC_INDEX_FINISHED, this);
+    loadPlaylists(app);
 }
 
 void MusicLibraryDataSource::onExit(App* app, ListMenu* menu) {
+    EventDispatcher::getInstance().unsubscribe(EventType::MUSIC_INDEX_PROGRESS, this);
+    EventDispatcher::getInstance().unsubscribe(EventType::MUSIC_INDEX_FINISHED, this);
     items_.clear();
+    db_.clear();
+}
+
+void MusicLibraryDataSource::onEvent(const Event& event) {
+    if (event.type == EventType::MUSIC_INDEX_PROGRESS) {
+        indexProgress_ = static_cast<const MusicIndexProgressEvent&>(event).percent; // Drawn on the next frame
+        return;
+    }
+    if (event.type != EventType::MUSIC_INDEX_FINISHED) return;
+    indexProgress_ = 0;
+    loadPlaylists(app_);
+    needsReload_ = true;
+    if (static_cast<const MusicIndexFinishedEvent&>(event).completed) {
+        app_->showPopUp("Success", "Library re-indexed.", nullptr, "OK", "", true);
+    }
 }
 
 void MusicLibraryDataSource::onUpdate(App* app, ListMenu* menu) {
@@ -28,78 +49,21 @@ void MusicLibraryDataSource::onUpdate(App* app, ListMenu* menu) {
     }
 }
 
-void MusicLibraryDataSource::loadPlaylists() {
+void MusicLibraryDataSource::loadPlaylists(App* app) {
     items_.clear();
-    
-    // This now only loads PLAYLISTS (directories) from the root music folder
-    std::string indexPath = std::string(SD_ROOT::USER_MUSIC) + "/" + MusicLibraryManager::INDEX_FILENAME;
-    auto reader = SdCardManager::getInstance().openLineReader(indexPath.c_str());
-    if (reader.isOpen()) {
-        while(true) {
-            String line = reader.readLine();
-            if (line.isEmpty()) break;
-            
-            // Only parse lines for Playlists ('P')
-            if (line.startsWith("P;")) {
-                 int firstSep = line.indexOf(';');
-                 int secondSep = line.indexOf(';', firstSep + 1);
-                 items_.push_back({
-                     line.substring(firstSep + 1, secondSep).c_str(),
-                     line.substring(secondSep + 1).c_str(),
-                     ItemType::PLAYLIST
-                 });
-            }
+
+    // Playlists are the music folder's subdirectories, already in name order.
+    db_ = app->getMusicLibraryManager().getDb();
+    if (db_.isLoaded()) {
+        for (size_t i = 0; i < db_.getChildDirCount(MusicDb::ROOT); ++i) {
+            items_.push_back({db_.getChildDir(MusicDb::ROOT, i), ItemType::PLAYLIST});
         }
-        reader.close();
     }
-    items_.push_back({"Re-index Library", "", ItemType::REINDEX});
+    items_.push_back({MusicDb::NO_DIR, ItemType::REINDEX});
 }
 
 int MusicLibraryDataSource::getNumberOfItems(App* app) {
-    return isReindexing_ ? 0 : items_.size();
-}
-
-bool MusicLibraryDataSource::drawCustomEmptyMessage(App* app, U8G2& display) {
-    if (isReindexing_) {
-        // Use the original, non-bold font for a cleaner look
-        display.setFont(u8g2_font_6x10_tf);
-
-        const char* line1 = "Re-indexing";
-        const char* line2 = "Library...";
-        const char* line3 = "Please wait";
-        
-        // Define layout constants
-        const int fontHeight = 10;
-        const int lineSpacing = 2;
-        const int totalLines = 3;
-        
-        // Calculate the total height of the entire text block
-        const int totalBlockHeight = (totalLines * fontHeight) + ((totalLines - 1) * lineSpacing);
-        
-        // Calculate the dimensions of the area *below* the status bar
-        const int drawableAreaY = STATUS_BAR_H;
-        const int drawableAreaHeight = display.getDisplayHeight() - drawableAreaY;
-
-        // Calculate the starting Y position to perfectly center the block within the drawable area
-        const int startY = drawableAreaY + (drawableAreaHeight - totalBlockHeight) / 2;
-
-        // Calculate the baseline Y position for the first line
-        // The baseline is where the bottom of the characters sit. For u8g2, it's relative to the top.
-        int baselineY = startY + display.getAscent();
-
-        // Calculate X positions for each line to center them horizontally
-        int x1 = (display.getDisplayWidth() - display.getStrWidth(line1)) / 2;
-        int x2 = (display.getDisplayWidth() - display.getStrWidth(line2)) / 2;
-        int x3 = (display.getDisplayWidth() - display.getStrWidth(line3)) / 2;
-
-        // Draw the three centered lines at their calculated positions
-        display.drawStr(x1, baselineY, line1);
-        display.drawStr(x2, baselineY + fontHeight + lineSpacing, line2);
-        display.drawStr(x3, baselineY + 2 * (fontHeight + lineSpacing), line3);
-
-        return true;
-    }
-    return false;
+    return items_.size();
 }
 
 void MusicLibraryDataSource::onItemSelected(App* app, ListMenu* menu, int index) {
@@ -110,29 +74,20 @@ void MusicLibraryDataSource::onItemSelected(App* app, ListMenu* menu, int index)
     switch(item_copy.type) {
         case ItemType::PLAYLIST: {
             auto& songListDataSource = app->getSongListDataSource();
-            songListDataSource.setPlaylistPath(item_copy.path);
+            songListDataSource.setPlaylist(db_, item_copy.dir);
             EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::SONG_LIST));
             break;
         }
         case ItemType::REINDEX: {
-            isReindexing_ = true;
-            menu->reloadData(app, true);
-            
-            U8G2& display = app->getHardwareManager().getMainDisplay();
-            display.clearBuffer();
-            app->drawStatusBar();
-            menu->draw(app, display); 
-            display.sendBuffer();
-            
-            app->getMusicLibraryManager().buildIndex();
-            isReindexing_ = false;
-            
-            app->showPopUp("Success", "Library re-indexed.", 
-                [this](App* cb_app) {
-                    this->loadPlaylists();
-                    this->needsReload_ = true;
-                }, 
-                "OK", "", true);
+            // Runs in the background; the library stays browsable and playable meanwhile.
+            MusicLibraryManager& library = app->getMusicLibraryManager();
+            if (library.isIndexing()) {
+                library.cancelIndexing();
+            } else if (library.startIndexing()) {
+                indexProgress_ = 0;
+            } else {
+                app->showPopUp("Error", "Could not start re-indexing.", nullptr, "OK", "", true);
+            }
             break;
         }
     }
@@ -156,5 +111,12 @@ void MusicLibraryDataSource::drawItem(App* app, U8G2& display, ListMenu* menu, i
     int text_y = y + h / 2 + 4;
     int text_w = w - (text_x - x) - 4;
     
-    menu->updateAndDrawText(display, item.name.c_str(), text_x, text_y, text_w, isSelected);
+    const char* name = "Re-index Library";
+    if (item.type == ItemType::PLAYLIST) {
+        name = db_.getDirName(item.dir);
+    } else if (app->getMusicLibraryManager().isIndexing()) {
+        snprintf(reindexLabel_, sizeof(reindexLabel_), "Indexing %u%% (cancel)", (unsigned)indexProgress_);
+        name = reindexLabel_;
+    }
+    menu->updateAndDrawText(display, name, text_x, text_y, text_w, isSelected);
 }
\ No newline at end of file
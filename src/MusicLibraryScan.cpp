@@ -0,0 +1,89 @@
+#include "MusicLibraryScan.h"
+#include <string.h>
+
+MusicLibraryScan::MusicLibraryScan(Source& source, const MusicDb& previous, const std::string& root)
+    : source_(source), previous_(previous) {
+    dirs_.push_back({root, MusicDb::NO_DIR});
+}
+
+bool MusicLibraryScan::step() {
+    if (!dirs_.empty()) listNextDir();
+    else if (nextTrack_ < tracks_.size()) readNextTrack();
+    else return false;
+    updatePercent();
+    return !dirs_.empty() || nextTrack_ < tracks_.size();
+}
+
+void MusicLibraryScan::listNextDir() {
+    PendingDir pending = std::move(dirs_.front());
+    dirs_.pop_front();
+    if (!source_.listDir(pending.path, entries_)) return; // Unreadable: left out, with everything under it
+    MusicDb::DirId dir = builder_.addDir(pending.path, pending.parent);
+    stats_.dirs++;
+
+    const size_t extensionLength = strlen(TRACK_EXTENSION);
+    for (const Entry& entry : entries_) {
+        if (entry.name == "." || entry.name == "..") continue;
+        std::string path = pending.path + "/" + entry.name;
+        if (entry.isDir) {
+            dirs_.push_back({std::move(path), dir});
+            continue;
+        }
+        if (entry.name == LEGACY_INDEX_NAME) {
+            legacyIndexes_.push_back(std::move(path));
+            continue;
+        }
+        if (entry.name.size() < extensionLength ||
+            entry.name.compare(entry.name.size() - extensionLength, extensionLength, TRACK_EXTENSION) != 0) {
+            continue;
+        }
+        if (trackTotal_ >= MusicDb::MAX_TRACKS) {
+            stats_.skipped++;
+            continue;
+        }
+        trackTotal_++;
+
+        MusicDb::TrackId known;
+        if (previous_.findTrack(path, known)) {
+            if (previous_.getTrackFileSize(known) == entry.size && previous_.getTrackLastWrite(known) == entry.lastWrite) {
+                builder_.addTrack(dir, entry.name, previous_.getTrackDurationMs(known), previous_.getTrackSeekTable(known),
+                                  entry.size, entry.lastWrite);
+                stats_.kept++;
+                continue;
+            }
+            stats_.changed++;
+        } else {
+            stats_.added++;
+        }
+        size_t nameOffset = path.size() - entry.name.size();
+        tracks_.push_back({std::move(path), nameOffset, entry.size, entry.lastWrite, dir});
+    }
+}
+
+void MusicLibraryScan::readNextTrack() {
+    const PendingTrack& track = tracks_[nextTrack_++];
+    uint32_t durationMs = 0;
+    std::string seekTable;
+    if (!source_.readTrack(track.path, durationMs, seekTable)) {
+        durationMs = 0;
+        seekTable.clear(); // Listed anyway; it plays if the decoder can make sense of it
+    }
+    builder_.addTrack(track.dir, track.path.substr(track.nameOffset), durationMs, seekTable, track.size, track.lastWrite);
+}
+
+void MusicLibraryScan::updatePercent() {
+    // A listing is cheap next to reading a file, but the number of files to read is
+    // only known once every directory has been listed; both count as one unit.
+    size_t done = stats_.dirs + nextTrack_;
+    size_t total = done + dirs_.size() + (tracks_.size() - nextTrack_);
+    uint8_t percent = total ? (uint8_t)(done * 100 / total) : 0;
+    if (percent > 99) percent = 99;
+    if (percent > percent_) percent_ = percent;
+}
+
+std::vector<uint8_t> MusicLibraryScan::finish() {
+    size_t matched = stats_.kept + stats_.changed;
+    stats_.removed = previous_.getTrackCount() > matched ? previous_.getTrackCount() - matched : 0;
+    percent_ = 100;
+    return builder_.finish();
+}
@@ -1,6 +1,8 @@
 #include "MusicPlayer.h"
 #include "App.h"
 #include "SdCardManager.h"
+#include "MusicLibraryManager.h"
+#include "Mp3SeekTable.h"
 #include <algorithm>
 #include <random>
 #include <chrono>
@@ -10,20 +12,42 @@
 #include "AudioFileSourceID3.h"
 #include "AudioGeneratorMP3.h"
 
+namespace {
+
+    // Mp3SeekTable::Source over a slot's file: the resync read also primes its read-ahead.
+    class AudioSourceAdapter : public Mp3SeekTable::Source {
+    public:
+        explicit AudioSourceAdapter(AudioFileSource* source) : source_(source) {}
+
+        size_t readAt(uint64_t offset, uint8_t* buf, size_t len) override {
+            if (!source_->seek((int32_t)offset, SEEK_SET)) return 0;
+            return source_->read(buf, len);
+        }
+        uint64_t size() override { return source_->getSize(); }
+
+    private:
+        AudioFileSource* source_;
+    };
+
+} // namespace
+
 MusicPlayer::MusicPlayer() : 
     app_(nullptr), resourcesAllocated_(false),
-    out_(nullptr), mixer_(nullptr), currentSlot_(-1),
+    out_(nullptr), mixer_(nullptr), currentSlot_(-1), playingSlot_(-1),
+    preparedSlot_(-1), preparedReady_(false), fadingSlot_(-1), handoffPending_(false),
+    prepareAttempted_(false), preparedIndex_(-1), crossfadeMs_(0),
     currentState_(State::STOPPED), repeatMode_(RepeatMode::REPEAT_OFF), requestedAction_(PlaybackAction::NONE), isShuffle_(false),
     _isLoadingTrack(false), currentGain_(1.75f),
-    playlistTrackIndex_(-1), currentTrackDuration_(0),
-    playbackStartTimeMs_(0), accumulatedPlayedTimeMs_(0),
+    playlistTrackIndex_(-1), currentTrackId_(0), currentTrackDuration_(0), seekTargetMs_(0), resumeMs_(0),
     mixerTaskHandle_(nullptr)
 {
     for (int i = 0; i < 2; ++i) {
         source_file_[i] = nullptr;
         id3_filter_[i] = nullptr;
         mp3_[i] = nullptr;
-        stub_[i] = nullptr;
+        input_[i] = nullptr;
+        audioStartPos_[i] = 0;
+        startOffsetMs_[i] = 0;
     }
     audioSlotMutex_ = xSemaphoreCreateMutex();
 }
@@ -42,19 +66,32 @@ int MusicPlayer::getTotalDuration() const {
 }
 
 int MusicPlayer::getCurrentTime() const {
+    int seconds = getPositionMs() / 1000;
+    return std::min(seconds, currentTrackDuration_);
+}
+
+uint32_t MusicPlayer::getPositionMs() const {
     if (currentState_ == State::STOPPED || currentState_ == State::LOADING) {
         return 0;
     }
-
-    unsigned long totalPlayedMs = accumulatedPlayedTimeMs_;
-
-    if (currentState_ == State::PLAYING) {
-        totalPlayedMs += (millis() - playbackStartTimeMs_);
+    int slot = playingSlot_;
+    if (slot == -1 || out_ == nullptr || mixer_ == nullptr) return 0;
+
+    // Samples the output has taken since the slot's first one, at the slot's rate.
+    AudioSlotMixer::Input* input = mixer_->getInput(slot);
+    uint32_t positionMs = startOffsetMs_[slot];
+    int rate = input->getRate();
+    if (input->hasStarted() && rate > 0) {
+        int32_t played = (int32_t)(out_->getPlayPosition() - input->getStartPosition());
+        if (played > 0) positionMs += (uint32_t)((uint64_t)played * 1000 / rate);
     }
+    return positionMs;
+}
 
-    int seconds = totalPlayedMs / 1000;
-    
-    return std::min(seconds, currentTrackDuration_);
+bool MusicPlayer::isSlotAudible(int slot) const {
+    if (slot == -1 || out_ == nullptr || mixer_ == nullptr) return false;
+    AudioSlotMixer::Input* input = mixer_->getInput(slot);
+    return input->hasStarted() && (int32_t)(out_->getPlayPosition() - input->getStartPosition()) >= 0;
 }
 
 
@@ -71,7 +108,7 @@ bool MusicPlayer::allocateResources() {
     LOG(LogLevel::INFO, "PLAYER", "Allocating audio resources (Mixer)...");
     app_->getHardwareManager().setAmplifier(true);
     out_ = new AudioOutputPDM(Pins::AMPLIFIER_PIN);
-    mixer_ = new AudioOutputMixer(32, out_);
+    mixer_ = new AudioSlotMixer(out_);
     BaseType_t result = xTaskCreatePinnedToCore(
         mixerTaskWrapper, "AudioMixerTask", 8192, this, 5, &mixerTaskHandle_, 1
     );
@@ -122,12 +159,36 @@ void MusicPlayer::mixerTaskLoop() {
                 if (currentState_ == State::PLAYING && mp3_[i]->isRunning()) {
                     if (!mp3_[i]->loop()) {
                         mp3_[i]->stop();
-                        if (songFinishedCallback_) {
-                            songFinishedCallback_();
+                        // With the next track pre-rolled, it carries straight on from the last frame.
+                        if (!switchToPrepared(i, false)) {
+                            mixer_->loop(); // The last, partial block
+                            // The ring still holds the end of the track; from here a dry ring is expected.
+                            out_->flush();
+                            out_->setStreaming(false);
+                            if (songFinishedCallback_) {
+                                songFinishedCallback_();
+                            }
                         }
+                    } else if (crossfadeMs_ > 0 && preparedReady_ && fadingSlot_ == -1 &&
+                               estimateRemainingMs(i) <= crossfadeMs_) {
+                        switchToPrepared(i, true); // Tracks at different rates wait for the gapless switch
                     }
                     any_running = true;
                 }
+            } else if (i == preparedSlot_) {
+                runPreparedSlot(i); // One block of pre-roll, then it idles until the handoff
+            } else if (i == fadingSlot_) {
+                if (xSemaphoreTake(audioSlotMutex_, 0) == pdTRUE) {
+                    if (i == fadingSlot_ && mp3_[i] != nullptr) {
+                        // Decodes on under the new track until faded out (or out of audio).
+                        if (!mp3_[i]->isRunning() || !mixer_->isFading() || !mp3_[i]->loop()) {
+                            mp3_[i]->stop();
+                            fadingSlot_ = -1;
+                        }
+                    }
+                    xSemaphoreGive(audioSlotMutex_);
+                }
+                any_running = true;
             } else { 
                 if (mp3_[i]->isRunning()) {
                     mp3_[i]->stop();
@@ -137,7 +198,7 @@ void MusicPlayer::mixerTaskLoop() {
                         if (i != currentSlot_ && mp3_[i] != nullptr) {
                             LOG(LogLevel::INFO, "PLAYER_TASK", "Cleaning up old slot %d", i);
                             delete mp3_[i]; mp3_[i] = nullptr;
-                            delete stub_[i]; stub_[i] = nullptr;
+                            input_[i] = nullptr; // Its tail is still mixed out by the mixer
                             delete id3_filter_[i]; id3_filter_[i] = nullptr;
                             delete source_file_[i]; source_file_[i] = nullptr;
                         }
@@ -147,31 +208,42 @@ void MusicPlayer::mixerTaskLoop() {
             }
         }
 
+        // Whole blocks go to the ring here, or from ConsumeSample()/ConsumeSamples() once an input's block fills.
+        mixer_->loop();
+
         if (!any_running) {
             vTaskDelay(pdMS_TO_TICKS(10));
+        } else {
+            // Decoded ahead as far as the PCM ring goes; sleep until the output task makes room.
+            out_->waitForRoom(pdMS_TO_TICKS(20));
         }
     }
 }
 
 void MusicPlayer::pause() {
     if (currentState_ == State::PLAYING) {
-        accumulatedPlayedTimeMs_ += (millis() - playbackStartTimeMs_);
         currentState_ = State::PAUSED;
-        if (out_) out_->stop();
+        if (out_) {
+            out_->setStreaming(false);
+            out_->stop(); // What is in the ring plays on resume
+        }
         LOG(LogLevel::INFO, "PLAYER", "Playback paused.");
     }
 }
 
 void MusicPlayer::resume() {
     if (currentState_ == State::PAUSED) {
-        playbackStartTimeMs_ = millis();
         currentState_ = State::PLAYING;
-        if (out_) out_->begin();
+        if (out_) {
+            out_->begin();
+            out_->setStreaming(true);
+        }
         LOG(LogLevel::INFO, "PLAYER", "Playback resumed.");
     }
 }
 
 void MusicPlayer::stop() {
+    saveResumePoint();
     if (currentState_ == State::PAUSED && out_) {
         out_->begin();
     }
@@ -180,23 +252,62 @@ void MusicPlayer::stop() {
     currentTrackPath_ = "";
     currentTrackName_ = "";
     currentTrackDuration_ = 0;
-    accumulatedPlayedTimeMs_ = 0;
-    playbackStartTimeMs_ = 0;
 }
 
-void MusicPlayer::queuePlaylist(const std::string& name, const std::vector<PlaylistTrack>& tracks, int startIndex) {
+void MusicPlayer::saveResumePoint() {
+    if (currentState_ != State::PLAYING && currentState_ != State::PAUSED) return;
+    if (currentTrackPath_.empty() || playingSlot_ == -1) return;
+
+    uint32_t positionMs = getPositionMs();
+    bool resumable = positionMs >= RESUME_MIN_MS &&
+                     (currentTrackDuration_ <= 0 || positionMs + RESUME_MIN_MS < (uint32_t)currentTrackDuration_ * 1000);
+    // Written empty rather than deleted, so restoreAtomic() can't bring an old point back.
+    std::string contents;
+    if (resumable) {
+        char positionText[16];
+        snprintf(positionText, sizeof(positionText), ";%lu\n", (unsigned long)positionMs);
+        contents = currentTrackPath_ + positionText;
+        LOG(LogLevel::INFO, "PLAYER", "Resume point: '%s' at %lu ms", currentTrackName_.c_str(), (unsigned long)positionMs);
+    }
+    SdCardManager::getInstance().writeFileAtomic(SD_ROOT::CONFIG_MUSIC_RESUME, contents.data(), contents.size());
+}
+
+void MusicPlayer::loadResumePoint() {
+    resumePath_.clear();
+    resumeMs_ = 0;
+    String text;
+    if (!SdCardManager::getInstance().readFileAtomic(SD_ROOT::CONFIG_MUSIC_RESUME, text)) return;
+
+    std::string_view rest(text.c_str(), text.length()), path;
+    if (!SdCardManager::splitField(rest, ';', path) || path.empty()) return;
+    long positionMs = SdCardManager::parseLong(rest);
+    if (positionMs <= 0) return;
+    resumePath_.assign(path.data(), path.size());
+    resumeMs_ = (uint32_t)positionMs;
+}
+
+uint32_t MusicPlayer::takeResumePoint(const std::string& path) {
+    uint32_t positionMs = (!resumePath_.empty() && resumePath_ == path) ? resumeMs_ : 0;
+    resumePath_.clear(); // Only ever for the first track played
+    return positionMs;
+}
+
+void MusicPlayer::queuePlaylist(const std::string& name, const MusicDb& db, std::vector<MusicDb::TrackId> tracks, int startIndex) {
     if (tracks.empty() || startIndex >= (int)tracks.size()) return;
+    cancelPreparedTrack();
+    handoffPending_ = false; // Whatever switched in belongs to the old queue
     _isLoadingTrack = true;
     currentState_ = State::LOADING;
     playlistName_ = name;
-    currentPlaylist_ = tracks;
+    playlistDb_ = db;
+    currentPlaylist_ = std::move(tracks);
     playlistTrackIndex_ = startIndex - 1; 
 
     if (isShuffle_) {
         generateShuffledIndices();
-        std::string targetPath = currentPlaylist_[startIndex].path;
+        MusicDb::TrackId target = currentPlaylist_[startIndex];
         for(size_t i = 0; i < shuffledIndices_.size(); ++i) {
-            if (currentPlaylist_[shuffledIndices_[i]].path == targetPath) {
+            if (currentPlaylist_[shuffledIndices_[i]] == target) {
                 playlistTrackIndex_ = i - 1;
                 break;
             }
@@ -206,6 +317,7 @@ void MusicPlayer::queuePlaylist(const std::string& name, const std::vector<Playl
 
 void MusicPlayer::startQueuedPlayback() {
     if (currentState_ == State::LOADING) {
+        loadResumePoint();
         playNextInPlaylist(false);
     }
 }
@@ -224,6 +336,20 @@ void MusicPlayer::prevTrack() {
     }
 }
 
+void MusicPlayer::seekBy(int seconds) {
+    if (currentState_ != State::PLAYING || currentTrackPath_.empty()) return;
+    if (requestedAction_ != PlaybackAction::NONE && requestedAction_ != PlaybackAction::SEEK) return; // A skip wins
+
+    // Steps taken before the UI loop services them add up.
+    int64_t target = (requestedAction_ == PlaybackAction::SEEK) ? seekTargetMs_ : getPositionMs();
+    target += (int64_t)seconds * 1000;
+    int64_t last = (int64_t)currentTrackDuration_ * 1000 - SEEK_END_GUARD_MS;
+    if (target > last) target = last;
+    if (target < 0) target = 0;
+    seekTargetMs_ = (uint32_t)target;
+    requestedAction_ = PlaybackAction::SEEK;
+}
+
 void MusicPlayer::setVolume(uint8_t volumePercent) {
     if (volumePercent > 200) volumePercent = 200;
 
@@ -235,34 +361,61 @@ void MusicPlayer::setVolume(uint8_t volumePercent) {
 
     LOG(LogLevel::INFO, "PLAYER", "Volume set to %u%%, gain is now %.2f", volumePercent, currentGain_);
     
-    if (currentState_ == State::PLAYING && currentSlot_ != -1 && stub_[currentSlot_]) {
-        stub_[currentSlot_]->SetGain(currentGain_);
+    if (currentState_ == State::PLAYING && currentSlot_ != -1 && input_[currentSlot_]) {
+        input_[currentSlot_]->SetGain(currentGain_);
+    }
+    int prepared = preparedSlot_;
+    if (prepared != -1 && input_[prepared]) {
+        input_[prepared]->SetGain(currentGain_);
     }
 }
 
 void MusicPlayer::stopPlayback() {
     LOG(LogLevel::INFO, "PLAYER", "Stopping all playback and cleaning up both slots.");
+    if (out_) {
+        out_->setStreaming(false);
+        out_->discardBuffered();
+        AudioOutputPDM::Stats stats = out_->getStats();
+        LOG(LogLevel::INFO, "PLAYER", "Output: %lu frames, %lu underruns, ring fill %lu-%lu of %lu samples",
+            (unsigned long)stats.output.framesOut, (unsigned long)stats.output.underruns,
+            (unsigned long)(stats.output.minFill == UINT32_MAX ? 0 : stats.output.minFill),
+            (unsigned long)stats.output.maxFill, (unsigned long)stats.ringCapacity);
+    }
     if (xSemaphoreTake(audioSlotMutex_, portMAX_DELAY) == pdTRUE) {
         for (int i = 0; i < 2; ++i) {
-            if (mp3_[i] && mp3_[i]->isRunning()) {
-                mp3_[i]->stop();
-            }
-            delete mp3_[i]; mp3_[i] = nullptr;
-            delete stub_[i]; stub_[i] = nullptr;
-            delete id3_filter_[i]; id3_filter_[i] = nullptr;
-            delete source_file_[i]; source_file_[i] = nullptr;
+            releaseSlot(i);
         }
         currentSlot_ = -1;
+        playingSlot_ = -1;
+        preparedSlot_ = -1;
+        preparedReady_ = false;
+        fadingSlot_ = -1;
+        handoffPending_ = false;
+        prepareAttempted_ = false;
         xSemaphoreGive(audioSlotMutex_);
     }
 }
 
-void MusicPlayer::startPlayback(const PlaylistTrack& track) {
+void MusicPlayer::releaseSlot(int slot) {
+    if (mp3_[slot] && mp3_[slot]->isRunning()) {
+        mp3_[slot]->stop();
+    }
+    delete mp3_[slot]; mp3_[slot] = nullptr;
+    if (input_[slot]) input_[slot]->discard();
+    input_[slot] = nullptr;
+    delete id3_filter_[slot]; id3_filter_[slot] = nullptr;
+    delete source_file_[slot]; source_file_[slot] = nullptr;
+}
+
+void MusicPlayer::startPlayback(const PlaylistTrack& track, uint32_t startMs) {
     currentState_ = State::LOADING;
-    
-    accumulatedPlayedTimeMs_ = 0;
-    playbackStartTimeMs_ = 0;
-    
+
+    // Read before the slots are locked: the index lookup (or the file's header) takes a while.
+    Mp3SeekTable seekTable;
+    if (startMs > 0 && !loadSeekTable(track, seekTable)) {
+        LOG(LogLevel::WARN, "PLAYER", "No seek table for '%s'; starting from the top", track.path.c_str());
+    }
+
     int prevSlot;
     int nextSlot;
 
@@ -275,8 +428,14 @@ void MusicPlayer::startPlayback(const PlaylistTrack& track) {
     nextSlot = (currentSlot_ == -1) ? 0 : (currentSlot_ + 1) % 2;
     LOG(LogLevel::INFO, "PLAYER", "Preparing to start '%s' in slot %d", track.path.c_str(), nextSlot);
 
+    // Started directly: whatever was pre-rolled or fading out in that slot goes.
+    preparedSlot_ = -1;
+    preparedReady_ = false;
+    prepareAttempted_ = false;
+    if (fadingSlot_ == nextSlot) fadingSlot_ = -1;
+
     delete mp3_[nextSlot]; mp3_[nextSlot] = nullptr;
-    delete stub_[nextSlot]; stub_[nextSlot] = nullptr;
+    input_[nextSlot] = nullptr; // begin() below starts the slot's input afresh
     delete id3_filter_[nextSlot]; id3_filter_[nextSlot] = nullptr;
     delete source_file_[nextSlot]; source_file_[nextSlot] = nullptr;
     
@@ -289,19 +448,37 @@ void MusicPlayer::startPlayback(const PlaylistTrack& track) {
         playNextInPlaylist(false); 
         return;
     }
+    startOffsetMs_[nextSlot] = 0;
+    if (seekTable.isValid()) {
+        // Jump to the table's byte for the time, then on to the next whole frame.
+        AudioSourceAdapter adapter(source_file_[nextSlot]);
+        int64_t frame = seekTable.findFrame(adapter, seekTable.byteForMs(startMs));
+        if (frame >= 0 && source_file_[nextSlot]->seek((int32_t)frame, SEEK_SET)) {
+            startOffsetMs_[nextSlot] = seekTable.msForByte(frame);
+            LOG(LogLevel::INFO, "PLAYER", "Seek to %lu ms: frame at byte %ld (%lu ms)", (unsigned long)startMs,
+                (long)frame, (unsigned long)startOffsetMs_[nextSlot]);
+        } else {
+            LOG(LogLevel::WARN, "PLAYER", "No frame near %lu ms; starting from the top", (unsigned long)startMs);
+            source_file_[nextSlot]->seek(0, SEEK_SET);
+        }
+    }
+    // From mid-file there is no tag to find, and the filter passes the frames straight through.
     id3_filter_[nextSlot] = new AudioFileSourceID3(source_file_[nextSlot]);
     
-    stub_[nextSlot] = mixer_->NewInput();
-    stub_[nextSlot]->SetGain(currentGain_);
+    input_[nextSlot] = mixer_->getInput(nextSlot);
+    input_[nextSlot]->SetGain(currentGain_);
     mp3_[nextSlot] = new AudioGeneratorMP3();
     currentSlot_ = nextSlot;
 
     xSemaphoreGive(audioSlotMutex_);
 
-    bool success = mp3_[nextSlot]->begin(id3_filter_[nextSlot], stub_[nextSlot]);
+    bool success = mp3_[nextSlot]->begin(id3_filter_[nextSlot], input_[nextSlot]);
     
-    if (success) {
+    if (success && startOffsetMs_[nextSlot] > 0) {
+        audioStartPos_[nextSlot] = seekTable.getDataStart();
+    } else if (success) {
         uint32_t audioStartPos = id3_filter_[nextSlot]->getPos();
+        audioStartPos_[nextSlot] = audioStartPos;
         LOG(LogLevel::DEBUG, "PLAYER", "Audio data starts at position: %u", audioStartPos);
         
         if (id3_filter_[nextSlot]->seek(audioStartPos, SEEK_SET)) {
@@ -314,10 +491,7 @@ void MusicPlayer::startPlayback(const PlaylistTrack& track) {
     if (!success) {
         LOG(LogLevel::ERROR, "PLAYER", "MP3 begin failed for slot %d", nextSlot);
         if (xSemaphoreTake(audioSlotMutex_, portMAX_DELAY) == pdTRUE) {
-            delete mp3_[nextSlot]; mp3_[nextSlot] = nullptr;
-            delete stub_[nextSlot]; stub_[nextSlot] = nullptr;
-            delete id3_filter_[nextSlot]; id3_filter_[nextSlot] = nullptr;
-            delete source_file_[nextSlot]; source_file_[nextSlot] = nullptr;
+            releaseSlot(nextSlot);
             currentSlot_ = prevSlot;
             xSemaphoreGive(audioSlotMutex_);
         }
@@ -325,33 +499,64 @@ void MusicPlayer::startPlayback(const PlaylistTrack& track) {
         return;
     }
 
-    currentTrackPath_ = track.path;
-    currentTrackDuration_ = track.duration;
-    size_t last_slash = track.path.find_last_of('/');
-    currentTrackName_ = (last_slash == std::string::npos) ? track.path : track.path.substr(last_slash + 1);
+    setCurrentTrack(track);
+    playingSlot_ = nextSlot;
     
     _isLoadingTrack = false;
 
     // This happens *after* all blocking setup calls are finished.
     currentState_ = State::PLAYING;
-    playbackStartTimeMs_ = millis();
+    out_->setStreaming(true);
     
-    int startTimeSeconds = getCurrentTime();
+    int startTimeSeconds = startOffsetMs_[nextSlot] / 1000;
     char timeStr[8];
     snprintf(timeStr, sizeof(timeStr), "%d:%02d", startTimeSeconds / 60, startTimeSeconds % 60);
 
-    LOG(LogLevel::INFO, "PLAYER", "Playback initiated for '%s'. Initial calculated time: %s (%d seconds).", 
+    LOG(LogLevel::INFO, "PLAYER", "Playback initiated for '%s' at %s (%d seconds).", 
         currentTrackName_.c_str(), timeStr, startTimeSeconds);
 
 }
 
+void MusicPlayer::seekTo(uint32_t ms) {
+    if (handoffPending_) commitHandoff();
+    if (currentState_ != State::PLAYING || currentTrackPath_.empty()) return;
+    LOG(LogLevel::INFO, "PLAYER", "Seeking '%s' to %lu ms", currentTrackName_.c_str(), (unsigned long)ms);
+    // The track restarts in the other slot, where the next one may be waiting.
+    cancelPreparedTrack();
+    if (out_) out_->discardBuffered();
+    startPlayback(getCurrentTrack(), ms);
+}
+
+void MusicPlayer::setCurrentTrack(const PlaylistTrack& track) {
+    currentTrackId_ = track.id;
+    currentTrackPath_ = track.path;
+    currentTrackDuration_ = track.duration;
+    size_t last_slash = track.path.find_last_of('/');
+    currentTrackName_ = (last_slash == std::string::npos) ? track.path : track.path.substr(last_slash + 1);
+}
+
+MusicPlayer::PlaylistTrack MusicPlayer::getCurrentTrack() const {
+    return {currentTrackPath_, currentTrackDuration_, currentTrackId_};
+}
+
+MusicPlayer::PlaylistTrack MusicPlayer::resolveTrack(MusicDb::TrackId id) const {
+    return {playlistDb_.getTrackPath(id), (int)(playlistDb_.getTrackDurationMs(id) / 1000), id};
+}
+
+bool MusicPlayer::loadSeekTable(const PlaylistTrack& track, Mp3SeekTable& table) const {
+    // Indexed with the library; a file it couldn't read then is tried once more from its headers.
+    if (table.parse(playlistDb_.getTrackSeekTable(track.id))) return true;
+    return MusicLibraryManager::loadSeekTable(track.path, table);
+}
+
 void MusicPlayer::playNextInPlaylist(bool songFinishedNaturally) {
+    if (handoffPending_) commitHandoff(); // A skip counts from the track now playing
     if (currentPlaylist_.empty()) {
         stop();
         return;
     }
     if (songFinishedNaturally && repeatMode_ == RepeatMode::REPEAT_ONE) {
-        startPlayback({currentTrackPath_, currentTrackDuration_});
+        startPlayback(getCurrentTrack());
         return;
     }
     
@@ -367,18 +572,183 @@ void MusicPlayer::playNextInPlaylist(bool songFinishedNaturally) {
         }
     }
     
-    const auto& track = isShuffle_ ? currentPlaylist_[shuffledIndices_[playlistTrackIndex_]] : currentPlaylist_[playlistTrackIndex_];
-    startPlayback(track);
+    PlaylistTrack track = resolveTrack(isShuffle_ ? currentPlaylist_[shuffledIndices_[playlistTrackIndex_]] : currentPlaylist_[playlistTrackIndex_]);
+    startPlayback(track, takeResumePoint(track.path));
 }
 
 void MusicPlayer::songFinished() {
     playNextInPlaylist(true);
 }
 
+void MusicPlayer::setCrossfade(uint8_t seconds) {
+    if (seconds > MAX_CROSSFADE_SECONDS) seconds = MAX_CROSSFADE_SECONDS;
+    crossfadeMs_ = seconds * 1000u;
+    LOG(LogLevel::INFO, "PLAYER", "Crossfade set to %us", seconds);
+}
+
+void MusicPlayer::serviceNextTrack() {
+    // The switch shows once the new track is heard, not when it was decoded (the ring holds ~0.7 s).
+    if (handoffPending_ && isSlotAudible(currentSlot_)) commitHandoff();
+    if (!resourcesAllocated_ || currentState_ != State::PLAYING || prepareAttempted_) return;
+    if (currentSlot_ == -1 || preparedSlot_ != -1) return;
+    if (currentTrackDuration_ > 0 &&
+        currentTrackDuration_ - getCurrentTime() > PRELOAD_LEAD_SECONDS + (int)(crossfadeMs_ / 1000)) {
+        return;
+    }
+    prepareNextTrack();
+}
+
+bool MusicPlayer::peekNextTrack(int& index, PlaylistTrack& track) const {
+    // Mirrors playNextInPlaylist(true), without moving anything.
+    if (currentPlaylist_.empty()) return false;
+    if (repeatMode_ == RepeatMode::REPEAT_ONE) {
+        index = playlistTrackIndex_;
+        track = getCurrentTrack();
+        return true;
+    }
+    index = playlistTrackIndex_ + 1;
+    if (index >= (int)currentPlaylist_.size()) {
+        // Shuffle deals a new order at the wrap, so that track isn't known yet.
+        if (repeatMode_ != RepeatMode::REPEAT_ALL || isShuffle_) return false;
+        index = 0;
+    }
+    track = resolveTrack(isShuffle_ ? currentPlaylist_[shuffledIndices_[index]] : currentPlaylist_[index]);
+    return true;
+}
+
+void MusicPlayer::prepareNextTrack() {
+    int index;
+    PlaylistTrack track;
+    if (!peekNextTrack(index, track)) {
+        prepareAttempted_ = true;
+        return;
+    }
+
+    int slot = (currentSlot_ + 1) % 2;
+    if (xSemaphoreTake(audioSlotMutex_, portMAX_DELAY) != pdTRUE) return;
+    if (mp3_[slot] != nullptr || mixer_->getInput(slot)->isActive()) {
+        xSemaphoreGive(audioSlotMutex_); // The previous track is still going out of it
+        return;
+    }
+    prepareAttempted_ = true;
+    preparedSlot_ = slot; // Before mp3_ is set, so the mixer task leaves the slot to us
+    startOffsetMs_[slot] = 0;
+
+    source_file_[slot] = new AudioFileSourceKivaSD(track.path.c_str());
+    if (!source_file_[slot]->isOpen()) {
+        LOG(LogLevel::WARN, "PLAYER", "Could not pre-open '%s'", track.path.c_str());
+        delete source_file_[slot]; source_file_[slot] = nullptr;
+        preparedSlot_ = -1;
+        xSemaphoreGive(audioSlotMutex_);
+        return;
+    }
+    id3_filter_[slot] = new AudioFileSourceID3(source_file_[slot]);
+    input_[slot] = mixer_->getInput(slot);
+    input_[slot]->SetGain(currentGain_);
+    input_[slot]->hold();
+    mp3_[slot] = new AudioGeneratorMP3();
+    xSemaphoreGive(audioSlotMutex_);
+
+    // ID3 parsing and the first frame happen here, while the current track plays on.
+    bool success = mp3_[slot]->begin(id3_filter_[slot], input_[slot]);
+
+    if (xSemaphoreTake(audioSlotMutex_, portMAX_DELAY) != pdTRUE) return;
+    if (success) {
+        audioStartPos_[slot] = id3_filter_[slot]->getPos();
+        preparedTrack_ = track;
+        preparedIndex_ = index;
+        preparedReady_ = true;
+        LOG(LogLevel::INFO, "PLAYER", "Pre-rolled '%s' in slot %d", track.path.c_str(), slot);
+    } else {
+        LOG(LogLevel::WARN, "PLAYER", "MP3 begin failed pre-rolling slot %d", slot);
+        releaseSlot(slot);
+        preparedSlot_ = -1;
+    }
+    xSemaphoreGive(audioSlotMutex_);
+}
+
+void MusicPlayer::cancelPreparedTrack() {
+    prepareAttempted_ = false;
+    if (preparedSlot_ == -1) return;
+    if (xSemaphoreTake(audioSlotMutex_, portMAX_DELAY) == pdTRUE) {
+        if (preparedSlot_ != -1) {
+            releaseSlot(preparedSlot_);
+            preparedSlot_ = -1;
+            preparedReady_ = false;
+        }
+        xSemaphoreGive(audioSlotMutex_);
+    }
+}
+
+void MusicPlayer::commitHandoff() {
+    handoffPending_ = false;
+    playlistTrackIndex_ = preparedIndex_;
+    setCurrentTrack(preparedTrack_);
+    playingSlot_ = currentSlot_;
+    prepareAttempted_ = false;
+    LOG(LogLevel::INFO, "PLAYER", "%s into '%s'", fadingSlot_ != -1 ? "Crossfading" : "Gapless switch",
+        currentTrackName_.c_str());
+}
+
+void MusicPlayer::runPreparedSlot(int slot) {
+    if (!preparedReady_) return; // Still being opened on the UI task
+    if (xSemaphoreTake(audioSlotMutex_, 0) != pdTRUE) return;
+    if (slot == preparedSlot_ && mp3_[slot] != nullptr) {
+        if (!mp3_[slot]->isRunning() || !mp3_[slot]->loop()) {
+            LOG(LogLevel::WARN, "PLAYER_TASK", "Slot %d ended while pre-rolling; it will start normally", slot);
+            releaseSlot(slot);
+            preparedSlot_ = -1;
+            preparedReady_ = false;
+        }
+    }
+    xSemaphoreGive(audioSlotMutex_);
+}
+
+bool MusicPlayer::switchToPrepared(int fromSlot, bool crossfade) {
+    if (!preparedReady_) return false;
+    if (xSemaphoreTake(audioSlotMutex_, pdMS_TO_TICKS(10)) != pdTRUE) return false;
+    bool switched = false;
+    int to = preparedSlot_;
+    if (to != -1 && preparedReady_ && currentSlot_ == fromSlot) {
+        if (crossfade) {
+            uint32_t frames = (uint32_t)((uint64_t)crossfadeMs_ * input_[fromSlot]->getRate() / 1000);
+            switched = mixer_->crossfade(input_[fromSlot], input_[to], frames);
+            if (switched) fadingSlot_ = fromSlot;
+        } else {
+            mixer_->follow(input_[fromSlot], input_[to]);
+            switched = true;
+        }
+    }
+    if (switched) {
+        currentSlot_ = to;
+        preparedSlot_ = -1;
+        preparedReady_ = false;
+        handoffPending_ = true; // The UI picks up the new track in serviceNextTrack()
+    }
+    xSemaphoreGive(audioSlotMutex_);
+    return switched;
+}
+
+uint32_t MusicPlayer::estimateRemainingMs(int slot) {
+    // Bytes left of the audio, scaled by the indexed duration: exact for CBR, close for VBR.
+    if (currentTrackDuration_ <= 0 || id3_filter_[slot] == nullptr) return UINT32_MAX;
+    uint32_t size = id3_filter_[slot]->getSize();
+    uint32_t pos = id3_filter_[slot]->getPos();
+    uint32_t start = audioStartPos_[slot];
+    if (size <= start || pos < start) return UINT32_MAX;
+    uint32_t left = size - std::min(pos, size);
+    return (uint32_t)((uint64_t)left * currentTrackDuration_ * 1000 / (size - start));
+}
+
 void MusicPlayer::serviceRequest() {
     if (requestedAction_ == PlaybackAction::NONE) {
         return;
     }
+    if (requestedAction_ == PlaybackAction::SEEK) {
+        requestedAction_ = PlaybackAction::NONE;
+        seekTo(seekTargetMs_);
+        return;
+    }
 
     if (requestedAction_ == PlaybackAction::NEXT) {
         // Handled by playNextInPlaylist
@@ -390,23 +760,25 @@ void MusicPlayer::serviceRequest() {
     }
 
     requestedAction_ = PlaybackAction::NONE;
+    if (out_) out_->discardBuffered(); // Skip now, not after the buffered audio
     playNextInPlaylist(false);
 }
 
 float MusicPlayer::getPlaybackProgress() const {
     if (currentTrackDuration_ > 0) {
-        float progress = (float)getCurrentTime() / (float)currentTrackDuration_;
+        float progress = (float)getPositionMs() / (currentTrackDuration_ * 1000.0f);
         return std::min(progress, 1.0f);
     }
     return 0.0f;
 }
 
 void MusicPlayer::toggleShuffle() {
+    cancelPreparedTrack(); // The next track changes
     isShuffle_ = !isShuffle_;
     if (isShuffle_ && !currentPlaylist_.empty()) {
         generateShuffledIndices();
         for(size_t i = 0; i < shuffledIndices_.size(); ++i) {
-            if (currentPlaylist_[shuffledIndices_[i]].path == currentTrackPath_) {
+            if (currentPlaylist_[shuffledIndices_[i]] == currentTrackId_) {
                 playlistTrackIndex_ = i;
                 break;
             }
@@ -416,6 +788,7 @@ void MusicPlayer::toggleShuffle() {
 }
 
 void MusicPlayer::cycleRepeatMode() {
+    cancelPreparedTrack();
     repeatMode_ = static_cast<RepeatMode>((static_cast<int>(repeatMode_) + 1) % 3);
     LOG(LogLevel::INFO, "PLAYER", "Repeat mode %s", repeatMode_ == RepeatMode::REPEAT_OFF ? "off" : repeatMode_ == RepeatMode::REPEAT_ALL ? "all" : "one");
 }
@@ -62,6 +62,8 @@ void NowPlayingMenu::onUpdate(App* app) {
         _songFinished = false;
         player.songFinished();
     }
+
+    player.serviceNextTrack();
 }
 
 void NowPlayingMenu::onExit(App* app) {
@@ -80,13 +82,17 @@ void NowPlayingMenu::handleInput(InputEvent event, App* app) {
             else player.resume();
             break;
         case InputEvent::BTN_LEFT_PRESS:
-        case InputEvent::ENCODER_CCW:
             player.prevTrack();
             break;
         case InputEvent::BTN_RIGHT_PRESS:
-        case InputEvent::ENCODER_CW:
             player.nextTrack();
             break;
+        case InputEvent::ENCODER_CCW:
+            player.seekBy(-MusicPlayer::SEEK_STEP_SECONDS);
+            break;
+        case InputEvent::ENCODER_CW:
+            player.seekBy(MusicPlayer::SEEK_STEP_SECONDS);
+            break;
         case InputEvent::BTN_UP_PRESS:
         case InputEvent::BTN_DOWN_PRESS: {
             auto& settings = app->getConfigManager().getSettings();
@@ -5,6 +5,7 @@
 #include "ConfigManager.h"
 #include "WifiManager.h"
 #include "SdCardManager.h"
+#include "SdWriter.h"
 #include "Config.h"
 #include <ArduinoOTA.h>
 #include <Update.h>
@@ -41,26 +42,33 @@ void OtaManager::loop() {
 }
 
 void OtaManager::loopFlashing() {
-    if (!uploadFile_) {
+    if (!flashStream_.isOpen()) {
         statusMessage_ = "Flashing file error";
         state_ = OtaState::ERROR;
         return;
     }
+    // The read-ahead task keeps the next blocks coming while this one is written to flash.
     const size_t chunkSize = 4096;
     uint8_t buffer[chunkSize];
-    size_t bytesRead = uploadFile_.read(buffer, chunkSize);
+    size_t bytesRead = flashStream_.read(buffer, chunkSize);
     if (bytesRead > 0) {
         if (Update.write(buffer, bytesRead) != bytesRead) {
             statusMessage_ = "Flash write failed";
             state_ = OtaState::ERROR;
-            uploadFile_.close();
+            flashStream_.close();
             Update.abort();
             return;
         }
         progress_.receivedBytes += bytesRead;
+    } else if (progress_.receivedBytes < progress_.totalBytes) {
+        statusMessage_ = "Firmware read failed";
+        state_ = OtaState::ERROR;
+        flashStream_.close();
+        Update.abort();
+        return;
     }
     if (progress_.receivedBytes == progress_.totalBytes) {
-        uploadFile_.close();
+        flashStream_.close();
         if (!Update.end()) {
             statusMessage_ = "Finalization failed";
             state_ = OtaState::ERROR;
@@ -85,9 +93,8 @@ void OtaManager::stop() {
     if (state_ == OtaState::WEB_ACTIVE) {
         webServer_.end();
     }
-    if (uploadFile_) {
-        uploadFile_.close();
-    }
+    closeUploadFile();
+    flashStream_.close();
     if (state_ == OtaState::FLASHING) {
         Update.abort();
     }
@@ -101,9 +108,14 @@ void OtaManager::resetState() {
     statusMessage_ = "";
     displayIpAddress_ = "";
     uploadError_ = false;
-    if (uploadFile_) {
-        uploadFile_.close();
-    }
+    closeUploadFile();
+    flashStream_.close();
+}
+
+void OtaManager::closeUploadFile() {
+    if (!uploadFile_) return;
+    uploadFile_.close();
+    SdCardManager::getInstance().finishWrite((String(SD_ROOT::FIRMWARE) + "/web_upload.bin").c_str());
 }
 
 void OtaManager::enterTerminalState() {
@@ -126,6 +138,7 @@ void OtaManager::enterTerminalState() {
     display.sendBuffer();
     delay(1500);
     
+    SdWriter::getInstance().sync(); // Don't lose queued log lines to the reboot
     ESP.restart();
 }
 
@@ -150,30 +163,32 @@ void OtaManager::saveCurrentFirmware(const FirmwareInfo& info) {
 
 void OtaManager::scanSdForFirmware() {
     availableSdFirmwares_.clear();
-    if (!SdCardManager::getInstance().isAvailable() || !SdCardManager::getInstance().exists(SD_ROOT::FIRMWARE)) {
-        return;
-    }
-    File root = SD.open(SD_ROOT::FIRMWARE);
-    if (!root || !root.isDirectory()) {
-        if(root) root.close();
+    forEachSdFirmware([this](const FirmwareInfo& info) {
+        availableSdFirmwares_.push_back(info);
+        return true;
+    });
+}
+
+void OtaManager::forEachSdFirmware(const std::function<bool(const FirmwareInfo&)>& onFound) {
+    if (!SdCardManager::getInstance().isAvailable()) {
         return;
     }
-    File file = root.openNextFile();
-    while(file && availableSdFirmwares_.size() < Firmware::MAX_FIRMWARES_ON_SD) {
-        String fileName = file.name();
-        if(!file.isDirectory() && fileName.endsWith(Firmware::METADATA_EXTENSION)) {
-            FirmwareInfo info;
-            if(FirmwareUtils::parseMetadataFile(file.path(), info)) {
-                String binPath = String(SD_ROOT::FIRMWARE) + "/" + info.binary_filename;
-                if(SD.exists(binPath)) {
-                    availableSdFirmwares_.push_back(info);
-                }
+    size_t found = 0;
+    SdCardManager::getInstance().forEachDirEntry(SD_ROOT::FIRMWARE, [&](const SdCardManager::DirEntry& entry) {
+        String fileName = entry.name.c_str();
+        if(entry.isDir || !fileName.endsWith(Firmware::METADATA_EXTENSION)) {
+            return true;
+        }
+        FirmwareInfo info;
+        if(FirmwareUtils::parseMetadataFile(String(SD_ROOT::FIRMWARE) + "/" + fileName, info)) {
+            String binPath = String(SD_ROOT::FIRMWARE) + "/" + info.binary_filename;
+            if(SdCardManager::getInstance().exists(binPath.c_str())) {
+                found++;
+                if (!onFound(info)) return false;
             }
         }
-        file.close();
-        file = root.openNextFile();
-    }
-    root.close();
+        return found < Firmware::MAX_FIRMWARES_ON_SD;
+    });
 }
 
 const char* OtaManager::getEffectiveOtaPassword() {
@@ -263,25 +278,24 @@ void OtaManager::startSdUpdate(const FirmwareInfo& fwInfo) {
     }
 
     String binPath = String(SD_ROOT::FIRMWARE) + "/" + fwInfo.binary_filename;
-    uploadFile_ = SD.open(binPath, FILE_READ);
-    if (!uploadFile_) {
+    if (!flashStream_.open(binPath.c_str(), FLASH_BLOCK_SIZE, FLASH_BLOCK_COUNT)) {
         statusMessage_ = "Firmware file error";
         state_ = OtaState::ERROR;
         return;
     }
 
-    size_t updateSize = uploadFile_.size();
+    size_t updateSize = flashStream_.size();
     if (updateSize == 0) {
         statusMessage_ = "Firmware file empty";
         state_ = OtaState::ERROR;
-        uploadFile_.close();
+        flashStream_.close();
         return;
     }
     
     if (!Update.begin(updateSize)) {
         statusMessage_ = "Update begin failed";
         state_ = OtaState::ERROR;
-        uploadFile_.close();
+        flashStream_.close();
         return;
     }
 
@@ -345,8 +359,8 @@ void OtaManager::onUpload(AsyncWebServerRequest *request, String filename, size_
         progress_.receivedBytes = 0;
         
         String tempPath = String(SD_ROOT::FIRMWARE) + "/web_upload.bin";
-        if (SD.exists(tempPath)) SD.remove(tempPath);
-        uploadFile_ = SD.open(tempPath, FILE_WRITE);
+        if (SdCardManager::getInstance().exists(tempPath.c_str())) SdCardManager::getInstance().deleteFile(tempPath.c_str());
+        uploadFile_ = SdCardManager::getInstance().openFileUncached(tempPath.c_str(), FILE_WRITE);
         if (!uploadFile_) {
             uploadError_ = true;
             statusMessage_ = "SD: Cannot create temp file.";
@@ -363,7 +377,7 @@ void OtaManager::onUpload(AsyncWebServerRequest *request, String filename, size_
     }
 
     if (final) {
-        if (uploadFile_) uploadFile_.close();
+        closeUploadFile();
         LOG(LogLevel::INFO, "OTA", "Web Upload finished.");
     }
 }
@@ -377,7 +391,7 @@ void OtaManager::onUpdateEnd(AsyncWebServerRequest *request) {
 
     statusMessage_ = "Verifying...";
     String tempPath = String(SD_ROOT::FIRMWARE) + "/web_upload.bin";
-    String md5 = FirmwareUtils::calculateFileMD5(SD, tempPath);
+    String md5 = FirmwareUtils::calculateFileMD5(tempPath);
 
     if (md5.isEmpty()) {
         SdCardManager::getInstance().deleteFile(tempPath.c_str());
@@ -421,19 +435,18 @@ void OtaManager::onUpdateEnd(AsyncWebServerRequest *request) {
         LOG(LogLevel::ERROR, "OTA", "Failed to rename temp file. Will flash from temp path without saving.");
     }
 
-    uploadFile_ = SD.open(pathToFlash, FILE_READ);
-    if (!uploadFile_) {
+    if (!flashStream_.open(pathToFlash.c_str(), FLASH_BLOCK_SIZE, FLASH_BLOCK_COUNT)) {
         state_ = OtaState::ERROR;
         statusMessage_ = "Failed to open file for flashing";
         request->send(500, "text/plain", statusMessage_);
         return;
     }
     
-    size_t updateSize = uploadFile_.size();
+    size_t updateSize = flashStream_.size();
     if (!Update.begin(updateSize)) {
         statusMessage_ = "Update begin failed";
         state_ = OtaState::ERROR;
-        uploadFile_.close();
+        flashStream_.close();
         request->send(500, "text/plain", statusMessage_);
         return;
     }
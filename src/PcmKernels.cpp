@@ -0,0 +1,121 @@
+#include "PcmKernels.h"
+
+#if defined(ARDUINO) && __has_include(<sdkconfig.h>)
+#include <sdkconfig.h>
+#endif
+// Opt-in until it has been measured and checked bit-exact on an S3: see PcmKernels.h.
+#if defined(USE_ESP_DSP_MIXER) && defined(CONFIG_IDF_TARGET_ESP32S3) && __has_include(<esp_dsp.h>)
+#include <esp_dsp.h>
+#define PCM_KERNELS_PIE 1
+#endif
+
+namespace PcmKernels {
+
+    namespace {
+
+        void mixScalar(int16_t* out, const int16_t* const* inputs, const uint16_t* gainsQ14, size_t inputCount, size_t frames) {
+            if (inputCount == 1) {
+                // The usual case: each channel is clipped on its own, so their sum can't overflow.
+                const int16_t* in = inputs[0];
+                const int32_t gain = gainsQ14[0];
+                for (size_t i = 0; i < frames; ++i) {
+                    int32_t left = clip((in[2 * i] * gain) >> GAIN_SHIFT);
+                    int32_t right = clip((in[2 * i + 1] * gain) >> GAIN_SHIFT);
+                    out[i] = (int16_t)((left + right) / 2);
+                }
+                return;
+            }
+            for (size_t i = 0; i < frames; ++i) {
+                int32_t left = 0, right = 0;
+                for (size_t k = 0; k < inputCount; ++k) {
+                    const int32_t gain = gainsQ14[k];
+                    left += clip((inputs[k][2 * i] * gain) >> GAIN_SHIFT);
+                    right += clip((inputs[k][2 * i + 1] * gain) >> GAIN_SHIFT);
+                }
+                out[i] = (int16_t)((clip(left) + clip(right)) / 2);
+            }
+        }
+
+#ifdef PCM_KERNELS_PIE
+        constexpr size_t VECTOR_FRAMES = 128; // Per dsps_mul_s16() pass, one mixer block
+
+        // Decoder task only. dsps_mul_s16() multiplies two vectors, so each gain is a vector too.
+        alignas(16) int16_t gainVectors[MAX_INPUTS][2 * VECTOR_FRAMES];
+        int32_t gainVectorValues[MAX_INPUTS] = {-1, -1};
+        alignas(16) int16_t scaled[MAX_INPUTS][2 * VECTOR_FRAMES];
+        int8_t vectorExact = -1; // Unknown until probed
+
+        // Whether the vector multiply truncates as `>>` does and saturates where clip() would; checked once.
+        bool multiplyMatchesScalar() {
+            if (vectorExact < 0) {
+                alignas(16) int16_t in[8] = {32767, -32768, 30000, -30000, 1, -1, 0, 12345};
+                alignas(16) int16_t gain[8] = {32766, 32766, 32766, 32766, 32766, 32766, 32766, 32766};
+                alignas(16) int16_t out[8];
+                dsps_mul_s16(in, gain, out, 8, 1, 1, 1, GAIN_SHIFT - 1);
+                vectorExact = 1;
+                for (int i = 0; i < 8; ++i) {
+                    int32_t exact = ((int32_t)in[i] * gain[i]) >> (GAIN_SHIFT - 1);
+                    int32_t expected = exact > 32767 ? 32767 : (exact < -32768 ? -32768 : exact);
+                    if (out[i] != expected) vectorExact = 0;
+                }
+            }
+            return vectorExact == 1;
+        }
+
+        // gainQ14 as an int16 factor and a shift with the same product, if the PIE multiplier can apply it exactly.
+        bool vectorGain(uint16_t gainQ14, int16_t& factor, int& shift) {
+            int drop = gainQ14 > INT16_MAX ? 1 : 0;
+            if (gainQ14 & ((1 << drop) - 1)) return false; // An odd fade step above 2.0
+            factor = (int16_t)(gainQ14 >> drop);
+            shift = GAIN_SHIFT - drop;
+            return true;
+        }
+
+        /**
+         * The gains on the S3's PIE vector unit, then the clip, sum and downmix as mixScalar()
+         * does them; the vector multiply gives the same products, so the result is bit-exact.
+         * False (and nothing written) if a gain can't be applied exactly.
+         */
+        bool mixVector(int16_t* out, const int16_t* const* inputs, const uint16_t* gainsQ14, size_t inputCount, size_t frames) {
+            if (!multiplyMatchesScalar()) return false;
+            int16_t factors[MAX_INPUTS];
+            int shifts[MAX_INPUTS];
+            for (size_t k = 0; k < inputCount; ++k) {
+                if (!vectorGain(gainsQ14[k], factors[k], shifts[k])) return false;
+                if (gainVectorValues[k] != factors[k]) {
+                    for (int16_t& g : gainVectors[k]) g = factors[k];
+                    gainVectorValues[k] = factors[k];
+                }
+            }
+            for (size_t done = 0; done < frames; done += VECTOR_FRAMES) {
+                size_t n = frames - done < VECTOR_FRAMES ? frames - done : VECTOR_FRAMES;
+                for (size_t k = 0; k < inputCount; ++k) {
+                    dsps_mul_s16(inputs[k] + 2 * done, gainVectors[k], scaled[k], 2 * n, 1, 1, 1, shifts[k]);
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    int32_t left = 0, right = 0;
+                    for (size_t k = 0; k < inputCount; ++k) {
+                        left += clip(scaled[k][2 * i]);
+                        right += clip(scaled[k][2 * i + 1]);
+                    }
+                    out[done + i] = (int16_t)((clip(left) + clip(right)) / 2);
+                }
+            }
+            return true;
+        }
+#endif
+
+    } // namespace
+
+    void mixToMono(int16_t* out, const int16_t* const* inputs, const uint16_t* gainsQ14, size_t inputCount, size_t frames) {
+        if (inputCount == 0) {
+            for (size_t i = 0; i < frames; ++i) out[i] = 0;
+            return;
+        }
+#ifdef PCM_KERNELS_PIE
+        if (inputCount <= MAX_INPUTS && mixVector(out, inputs, gainsQ14, inputCount, frames)) return;
+#endif
+        mixScalar(out, inputs, gainsQ14, inputCount, frames);
+    }
+
+} // namespace PcmKernels
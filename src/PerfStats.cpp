@@ -0,0 +1,63 @@
+#include "PerfStats.h"
+
+PerfStats& PerfStats::getInstance() {
+    static PerfStats instance;
+    return instance;
+}
+
+PerfStats::PerfStats() :
+    hudMode_(PerfHudMode::OFF),
+    lastRollMs_(0)
+{
+    for (auto& counter : counters_) counter.store(0);
+}
+
+void PerfStats::record(PerfMetric metric, uint32_t value) {
+    if (!enabled_) return;
+    metrics_[(size_t)metric].add(value);
+}
+
+void PerfStats::tick() {
+    if (!enabled_) return;
+
+    unsigned long now = millis();
+    unsigned long elapsed = now - lastRollMs_;
+    if (elapsed < ROLL_INTERVAL_MS) return;
+    lastRollMs_ = now;
+
+    // Scale to a per-second rate in case the loop was late.
+    auto rollRate = [&](PerfCounter counter, PerfMetric metric) {
+        uint32_t amount = counters_[(size_t)counter].exchange(0, std::memory_order_relaxed);
+        metrics_[(size_t)metric].add((uint32_t)((uint64_t)amount * 1000 / elapsed));
+    };
+    rollRate(PerfCounter::FRAMES, PerfMetric::FPS);
+    rollRate(PerfCounter::SD_READ_BYTES, PerfMetric::SD_READ_BPS);
+    rollRate(PerfCounter::SD_WRITE_BYTES, PerfMetric::SD_WRITE_BPS);
+    rollRate(PerfCounter::SNIFFER_PACKETS, PerfMetric::SNIFFER_PPS);
+
+    metrics_[(size_t)PerfMetric::FREE_HEAP].add(ESP.getFreeHeap());
+    metrics_[(size_t)PerfMetric::FREE_PSRAM].add(ESP.getFreePsram());
+}
+
+void PerfStats::setHudMode(PerfHudMode mode) {
+    if (mode == hudMode_) return;
+    bool wasEnabled = enabled_;
+    hudMode_ = mode;
+    enabled_ = (mode != PerfHudMode::OFF);
+    if (enabled_ && !wasEnabled) {
+        // Start from a clean slate; counts from a previous session would skew the first rates.
+        resetAll();
+    }
+}
+
+void PerfStats::cycleHudMode(int direction) {
+    const int modeCount = 3;
+    int next = ((int)hudMode_ + direction + modeCount) % modeCount;
+    setHudMode((PerfHudMode)next);
+}
+
+void PerfStats::resetAll() {
+    for (auto& window : metrics_) window.reset();
+    for (auto& counter : counters_) counter.store(0, std::memory_order_relaxed);
+    lastRollMs_ = millis();
+}
@@ -7,31 +7,37 @@
 #include "ListMenu.h"
 #include "UI_Utils.h"
 
+PortalListDataSource::PortalListDataSource() : loader_("PortalListLoad") {}
+
 void PortalListDataSource::onEnter(App* app, ListMenu* menu, bool isForwardNav) {
     portalNames_.clear();
-    const char* dirPath = SD_ROOT::USER_PORTALS;
     if (!SdCardManager::getInstance().isAvailable()) {
         app->showPopUp("Error", "SD Card not found.", nullptr, "OK", "", true);
         return;
     }
-    
-    File root = SdCardManager::getInstance().openFileUncached(dirPath);
-    if (!root || !root.isDirectory()) return;
 
-    File file = root.openNextFile();
-    while(file) {
-        if (file.isDirectory()) {
-            portalNames_.push_back(file.name());
-        }
-        file.close();
-        file = root.openNextFile();
-    }
-    root.close();
+    // --- NEW: Walk the directory on a loader task; entries are picked up in onUpdate ---
+    loader_.start([](AsyncListLoader<std::string>& loader) {
+        bool found = SdCardManager::getInstance().forEachDirEntry(SD_ROOT::USER_PORTALS, [&loader](const SdCardManager::DirEntry& entry) {
+            if (!entry.isDir) return true;
+            return loader.push(entry.name);
+        });
+        if (!found) return;
+
+        loader.push("Back"); // No-op if cancelled
+    });
+}
+
+void PortalListDataSource::onUpdate(App* app, ListMenu* menu) {
+    loader_.drain(portalNames_);
+}
 
-    portalNames_.push_back("Back");
+bool PortalListDataSource::isLoading() const {
+    return loader_.isLoading();
 }
 
 void PortalListDataSource::onExit(App* app, ListMenu* menu) {
+    loader_.cancel();
 }
 
 int PortalListDataSource::getNumberOfItems(App* app) {
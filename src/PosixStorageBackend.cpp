@@ -0,0 +1,185 @@
+#ifndef ARDUINO
+
+#include "PosixStorageBackend.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+    class PosixFile : public IStorageFile {
+    public:
+        PosixFile(std::string volumePath, std::string hostPath, FILE* file, DIR* dir) :
+            volumePath_(std::move(volumePath)), hostPath_(std::move(hostPath)), file_(file), dir_(dir) {
+            size_t slash = volumePath_.find_last_of('/');
+            nameOffset_ = (slash == std::string::npos || volumePath_.size() == 1) ? 0 : slash + 1;
+        }
+        ~PosixFile() override { close(); }
+
+        size_t read(uint8_t* buf, size_t len) override { return file_ ? fread(buf, 1, len, file_) : 0; }
+        size_t write(const uint8_t* buf, size_t len) override { return file_ ? fwrite(buf, 1, len, file_) : 0; }
+        bool seek(uint64_t pos) override { return file_ && fseeko(file_, (off_t)pos, SEEK_SET) == 0; }
+        uint64_t position() const override {
+            off_t pos = file_ ? ftello(file_) : -1;
+            return pos < 0 ? 0 : (uint64_t)pos;
+        }
+        uint64_t size() const override {
+            if (!file_) return 0;
+            fflush(file_); // Count what is still in the stdio buffer, as SD's File::size() does
+            struct stat st;
+            return fstat(fileno(file_), &st) == 0 ? (uint64_t)st.st_size : 0;
+        }
+        bool flush() override { return file_ && fflush(file_) == 0; }
+        void close() override {
+            if (file_) fclose(file_);
+            if (dir_) closedir(dir_);
+            file_ = nullptr;
+            dir_ = nullptr;
+        }
+        bool isOpen() const override { return file_ || dir_; }
+        bool isDirectory() const override { return dir_ != nullptr; }
+
+        const char* name() const override { return volumePath_.c_str() + nameOffset_; }
+        const char* path() const override { return volumePath_.c_str(); }
+        time_t lastWrite() override {
+            struct stat st;
+            return stat(hostPath_.c_str(), &st) == 0 ? st.st_mtime : 0;
+        }
+
+        std::unique_ptr<IStorageFile> openNext() override {
+            if (!dir_) return nullptr;
+            while (struct dirent* entry = readdir(dir_)) {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+                std::string childVolume = volumePath_;
+                if (childVolume.back() != '/') childVolume += '/';
+                childVolume += entry->d_name;
+                std::string childHost = hostPath_ + "/" + entry->d_name;
+
+                struct stat st;
+                if (stat(childHost.c_str(), &st) != 0) continue; // Removed since readdir()
+                if (S_ISDIR(st.st_mode)) {
+                    DIR* dir = opendir(childHost.c_str());
+                    if (dir) return std::make_unique<PosixFile>(childVolume, childHost, nullptr, dir);
+                } else {
+                    FILE* file = fopen(childHost.c_str(), "rb");
+                    if (file) return std::make_unique<PosixFile>(childVolume, childHost, file, nullptr);
+                }
+            }
+            return nullptr;
+        }
+        void rewind() override { if (dir_) rewinddir(dir_); }
+
+    private:
+        std::string volumePath_;
+        std::string hostPath_;
+        FILE* file_;
+        DIR* dir_;
+        size_t nameOffset_;
+    };
+
+    bool isDirectoryAt(const std::string& hostPath) {
+        struct stat st;
+        return stat(hostPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+} // namespace
+
+PosixStorageBackend::PosixStorageBackend(std::string rootDir, uint64_t capacityBytes, uint32_t clusterSize) :
+    rootDir_(std::move(rootDir)),
+    capacityBytes_(capacityBytes),
+    clusterSize_(clusterSize ? clusterSize : 512),
+    mounted_(false)
+{
+    while (rootDir_.size() > 1 && rootDir_.back() == '/') rootDir_.pop_back();
+}
+
+bool PosixStorageBackend::begin() {
+    if (!isDirectoryAt(rootDir_) && ::mkdir(rootDir_.c_str(), 0755) != 0) return false;
+    mounted_ = true;
+    return true;
+}
+
+bool PosixStorageBackend::hostPath(const char* path, std::string& out) const {
+    if (!path || path[0] != '/') return false;
+    // Walk the components so no "." or ".." can climb out of the sandbox.
+    const char* p = path;
+    while (*p) {
+        while (*p == '/') p++;
+        const char* end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if ((len == 1 && p[0] == '.') || (len == 2 && p[0] == '.' && p[1] == '.')) return false;
+        p += len;
+    }
+    out = rootDir_;
+    if (strcmp(path, "/") != 0) out += path;
+    while (out.size() > rootDir_.size() && out.back() == '/') out.pop_back();
+    return true;
+}
+
+bool PosixStorageBackend::exists(const char* path) {
+    std::string host;
+    struct stat st;
+    return mounted_ && hostPath(path, host) && stat(host.c_str(), &st) == 0;
+}
+
+bool PosixStorageBackend::mkdir(const char* path) {
+    std::string host;
+    return mounted_ && hostPath(path, host) && ::mkdir(host.c_str(), 0755) == 0;
+}
+
+bool PosixStorageBackend::remove(const char* path) {
+    std::string host;
+    if (!mounted_ || !hostPath(path, host) || isDirectoryAt(host)) return false;
+    return unlink(host.c_str()) == 0;
+}
+
+bool PosixStorageBackend::rename(const char* pathFrom, const char* pathTo) {
+    std::string from, to;
+    if (!mounted_ || !hostPath(pathFrom, from) || !hostPath(pathTo, to)) return false;
+    struct stat st;
+    if (stat(to.c_str(), &st) == 0) return false; // FAT rename never overwrites
+    return ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+std::unique_ptr<IStorageFile> PosixStorageBackend::open(const char* path, StorageMode mode) {
+    std::string host;
+    if (!mounted_ || !hostPath(path, host)) return nullptr;
+
+    if (mode == StorageMode::READ && isDirectoryAt(host)) {
+        DIR* dir = opendir(host.c_str());
+        return dir ? std::make_unique<PosixFile>(path, host, nullptr, dir) : nullptr;
+    }
+    const char* fsMode = "rb";
+    if (mode == StorageMode::WRITE) fsMode = "wb";
+    else if (mode == StorageMode::APPEND) fsMode = "ab";
+    else if (mode == StorageMode::UPDATE) fsMode = "r+b";
+    FILE* file = fopen(host.c_str(), fsMode);
+    return file ? std::make_unique<PosixFile>(path, host, file, nullptr) : nullptr;
+}
+
+uint64_t PosixStorageBackend::usedBytes() {
+    return mounted_ ? usedBelow(rootDir_) : 0;
+}
+
+uint64_t PosixStorageBackend::usedBelow(const std::string& hostDir) const {
+    DIR* dir = opendir(hostDir.c_str());
+    if (!dir) return 0;
+    uint64_t used = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        std::string child = hostDir + "/" + entry->d_name;
+        struct stat st;
+        if (stat(child.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            used += clusterSize_ + usedBelow(child);
+        } else {
+            used += ((uint64_t)st.st_size + clusterSize_ - 1) / clusterSize_ * clusterSize_;
+        }
+    }
+    closedir(dir);
+    return used;
+}
+
+#endif // ARDUINO
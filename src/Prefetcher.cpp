@@ -0,0 +1,91 @@
+#include "Prefetcher.h"
+#include "SdCardManager.h"
+#include "Logger.h"
+#include "App.h"
+#include "IMenu.h"
+
+Prefetcher& Prefetcher::getInstance() {
+    static Prefetcher instance;
+    return instance;
+}
+
+Prefetcher::Prefetcher() :
+    mutex_(xSemaphoreCreateMutex()),
+    taskHandle_(nullptr),
+    armedAtMs_(0)
+{}
+
+void Prefetcher::hover(App* app, const MenuItem& item) {
+    if (item.prefetchPath) {
+        hover(std::string(item.prefetchPath));
+        return;
+    }
+    IMenu* target = app->getMenu(item.targetMenu);
+    hover(target ? target->getPrefetchPath() : std::string());
+}
+
+void Prefetcher::hover(const std::string& path) {
+    if (path.empty()) {
+        cancel();
+        return;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (pendingPath_ == path) {
+        xSemaphoreGive(mutex_);
+        return; // Already waiting on this one; keep the original dwell start
+    }
+    pendingPath_ = path;
+    armedAtMs_ = millis();
+    xSemaphoreGive(mutex_);
+
+    // The task is only created once something is actually worth prefetching.
+    if (!taskHandle_) {
+        if (xTaskCreatePinnedToCore(taskEntry, "Prefetcher", TASK_STACK_SIZE, this, TASK_PRIORITY, &taskHandle_, TASK_CORE) != pdPASS) {
+            LOG(LogLevel::ERROR, "PREFETCH", "Failed to create prefetch task.");
+            taskHandle_ = nullptr;
+            return;
+        }
+    }
+    xTaskNotifyGive(taskHandle_);
+}
+
+void Prefetcher::cancel() {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    pendingPath_.clear();
+    xSemaphoreGive(mutex_);
+}
+
+void Prefetcher::taskEntry(void* param) {
+    static_cast<Prefetcher*>(param)->taskLoop();
+}
+
+void Prefetcher::taskLoop() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Wait out the dwell. A new hover() restarts it; cancel() empties the slot.
+        std::string path;
+        for (;;) {
+            xSemaphoreTake(mutex_, portMAX_DELAY);
+            if (pendingPath_.empty()) {
+                xSemaphoreGive(mutex_);
+                break;
+            }
+            unsigned long elapsed = millis() - armedAtMs_;
+            if (elapsed >= DWELL_MS) {
+                path.swap(pendingPath_);
+                xSemaphoreGive(mutex_);
+                break;
+            }
+            xSemaphoreGive(mutex_);
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DWELL_MS - elapsed));
+        }
+
+        if (!path.empty()) {
+            unsigned long startMs = millis();
+            bool warmed = SdCardManager::getInstance().prefetch(path.c_str());
+            LOG(LogLevel::DEBUG, "PREFETCH", false, "%s %s in %lu ms", warmed ? "Warmed" : "Skipped", path.c_str(), millis() - startMs);
+        }
+    }
+}
@@ -55,10 +55,9 @@ bool ProbeFlooder::start(std::unique_ptr<HardwareManager::RfLock> rfLock, ProbeF
         }
         auto reader = SdCardManager::getInstance().openLineReader(SD_ROOT::DATA_PROBES_SSID_SESSION);
         sniffedSsids_.clear();
-        while(reader.isOpen()) {
-            String line = reader.readLine();
-            if (line.isEmpty()) break;
-            sniffedSsids_.push_back(line.c_str());
+        std::string_view line;
+        while (reader.readLine(line)) {
+            sniffedSsids_.emplace_back(line);
         }
         if (sniffedSsids_.empty()) {
              LOG(LogLevel::ERROR, "PROBE_FLOOD", "Sniffed SSID file is empty.");
@@ -197,7 +196,8 @@ void ProbeFlooder::loop() {
 
 std::string ProbeFlooder::getNextSsid() {
     if (currentMode_ == ProbeFloodMode::FILE_BASED) {
-        return fileSsidReader_.readLine().c_str();
+        std::string_view line;
+        return fileSsidReader_.readLine(line) ? std::string(line) : std::string();
     } else if (currentMode_ == ProbeFloodMode::AUTO_SNIFFED_PINPOINT) {
         if (sniffedSsids_.empty()) return "";
         std::string ssid = sniffedSsids_[sniffedSsidIndex_];
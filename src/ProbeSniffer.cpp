@@ -1,7 +1,9 @@
 #include "ProbeSniffer.h"
 #include "App.h" // For logging and SD manager access
 #include "Logger.h"
+#include "PerfStats.h"
 #include "SdCardManager.h"
+#include "SdWriter.h"
 
 // Channel hopping configuration
 static const int CHANNELS_TO_SNIFF[] = {1, 6, 11, 2, 7, 3, 8, 4, 9, 5, 10, 12, 13};
@@ -18,6 +20,7 @@ ProbeSniffer::ProbeSniffer() :
     lastChannelHopTime_(0)
 {
     instance_ = this;
+    currentPcapFilename_[0] = '\0';
 }
 
 void ProbeSniffer::setup(App* app) {
@@ -27,11 +30,6 @@ void ProbeSniffer::setup(App* app) {
 void ProbeSniffer::openPcapFile() {
     snprintf(currentPcapFilename_, sizeof(currentPcapFilename_), "%s/probes_%lu.pcap", SD_ROOT::DATA_PROBES, millis());
 
-    pcapFile_ = SdCardManager::getInstance().openFileUncached(currentPcapFilename_, FILE_WRITE);
-    if (!pcapFile_) {
-        LOG(LogLevel::ERROR, "PROBE", "Failed to create PCAP file: %s", currentPcapFilename_);
-        return;
-    }
 
     // Write the PCAP Global Header (24 bytes) for 802.11 frames
     uint8_t header[] = {
@@ -42,17 +40,26 @@ void ProbeSniffer::openPcapFile() {
         0xff, 0xff, 0x00, 0x00, // Snapshot length
         0x69, 0x00, 0x00, 0x00  // Link-layer header type (105 for 802.11)
     };
-    pcapFile_.write(header, sizeof(header));
+    // All capture output is queued for SdWriter; the packet callback never touches the card.
+    if (!SdWriter::getInstance().write(currentPcapFilename_, header, sizeof(header), PCAP_PREALLOCATE_BYTES)) {
+        LOG(LogLevel::ERROR, "PROBE", "Failed to create PCAP file: %s", currentPcapFilename_);
+        currentPcapFilename_[0] = '\0';
+        return;
+    }
     
     // Clear the session SSID list file for this new session
+    SdWriter::getInstance().release(SD_ROOT::DATA_PROBES_SSID_SESSION);
     SdCardManager::getInstance().deleteFile(SD_ROOT::DATA_PROBES_SSID_SESSION);
 
     LOG(LogLevel::INFO, "PROBE", "PCAP file created: %s", currentPcapFilename_);
 }
 
 void ProbeSniffer::closePcapFile() {
-    if (pcapFile_) {
-        pcapFile_.close();
+    if (currentPcapFilename_[0] != '\0') {
+        // Durable and closed before the capture is reported as done.
+        SdWriter::getInstance().release(currentPcapFilename_);
+        SdWriter::getInstance().release(SD_ROOT::DATA_PROBES_SSID_SESSION);
+        currentPcapFilename_[0] = '\0';
         LOG(LogLevel::INFO, "PROBE", "PCAP file closed. Captured %u probe packets.", packetCount_);
         // --- REMOVED THE POPUP ---
     }
@@ -113,6 +120,7 @@ void ProbeSniffer::loop() {
 
 // Static callback that redirects to the instance method
 void ProbeSniffer::packetHandlerCallback(void* buf, wifi_promiscuous_pkt_type_t type) {
+    PerfStats::count(PerfCounter::SNIFFER_PACKETS);
     if (instance_ != nullptr && type == WIFI_PKT_MGMT) {
         instance_->handlePacket(static_cast<wifi_promiscuous_pkt_t*>(buf));
     }
@@ -139,14 +147,10 @@ void ProbeSniffer::handlePacket(wifi_promiscuous_pkt_t *packet) {
         uint32_t timestamp_usec = packet->rx_ctrl.timestamp % 1000000;
         uint32_t captured_len = packet->rx_ctrl.sig_len;
 
-        pcapFile_.write((uint8_t*)&timestamp_sec, 4);
-        pcapFile_.write((uint8_t*)&timestamp_usec, 4);
-        pcapFile_.write((uint8_t*)&captured_len, 4);
-        pcapFile_.write((uint8_t*)&captured_len, 4); // Original length is same as captured
-        pcapFile_.write(packet->payload, captured_len);
-
-        if (packetCount_ % 10 == 0) {
-            pcapFile_.flush();
+        // Original length is same as captured
+        uint32_t recordHeader[4] = { timestamp_sec, timestamp_usec, captured_len, captured_len };
+        if (currentPcapFilename_[0] != '\0') {
+            SdWriter::getInstance().appendRecord(currentPcapFilename_, recordHeader, sizeof(recordHeader), packet->payload, captured_len);
         }
 
         // --- Update UI List & Save to Files (de-duplicated) ---
@@ -161,20 +165,15 @@ void ProbeSniffer::handlePacket(wifi_promiscuous_pkt_t *packet) {
             uniqueSsids_.push_back(ssid);
 
             // 1. Write to the session file
-            File sessionFile = SdCardManager::getInstance().openFileUncached(SD_ROOT::DATA_PROBES_SSID_SESSION, FILE_APPEND);
-            if (sessionFile) {
-                sessionFile.println(ssid);
-                sessionFile.close();
-            }
+            SdWriter::getInstance().appendLine(SD_ROOT::DATA_PROBES_SSID_SESSION, ssid);
 
             // 2. Check cumulative file and append if not present
             bool alreadyInCumulative = false;
             auto reader = SdCardManager::getInstance().openLineReader(SD_ROOT::DATA_PROBES_SSID_CUMULATIVE);
             if(reader.isOpen()) {
-                while(true) {
-                    String line = reader.readLine();
-                    if (line.isEmpty()) break;
-                    if (line == ssid) {
+                std::string_view line;
+                while (reader.readLine(line)) {
+                    if (line == std::string_view(ssid)) {
                         alreadyInCumulative = true;
                         break;
                     }
@@ -183,11 +182,7 @@ void ProbeSniffer::handlePacket(wifi_promiscuous_pkt_t *packet) {
             }
 
             if (!alreadyInCumulative) {
-                File cumulativeFile = SdCardManager::getInstance().openFileUncached(SD_ROOT::DATA_PROBES_SSID_CUMULATIVE, FILE_APPEND);
-                if (cumulativeFile) {
-                    cumulativeFile.println(ssid);
-                    cumulativeFile.close();
-                }
+                SdWriter::getInstance().appendLine(SD_ROOT::DATA_PROBES_SSID_CUMULATIVE, ssid);
             }
         }
     }
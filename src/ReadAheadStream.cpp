@@ -0,0 +1,296 @@
+#include "ReadAheadStream.h"
+#include "SdCardManager.h"
+#include "Logger.h"
+#include "PerfStats.h"
+#include <algorithm>
+
+ReadAheadStream::ReadAheadStream() :
+    isOpen_(false),
+    readAhead_(false),
+    size_(0),
+    pos_(0),
+    pool_(nullptr),
+    blocks_(),
+    blockSize_(0),
+    blockCount_(0),
+    mutex_(xSemaphoreCreateMutex()),
+    dataReady_(xSemaphoreCreateBinary()),
+    stopped_(xSemaphoreCreateBinary()),
+    taskHandle_(nullptr),
+    nextFetch_(0),
+    generation_(0),
+    depth_(0),
+    ioError_(false),
+    stopping_(false),
+    stats_()
+{}
+
+ReadAheadStream::~ReadAheadStream() {
+    close();
+    vSemaphoreDelete(mutex_);
+    vSemaphoreDelete(dataReady_);
+    vSemaphoreDelete(stopped_);
+}
+
+bool ReadAheadStream::open(const char* path, size_t blockSize, size_t blockCount) {
+    close();
+
+    file_ = SdCardManager::getInstance().openFileUncached(path, FILE_READ);
+    if (!file_ || file_.isDirectory()) {
+        if (file_) file_.close();
+        return false;
+    }
+    size_ = file_.size();
+    pos_ = 0;
+    isOpen_ = true;
+    stats_ = Stats();
+
+    blockSize_ = std::max<size_t>(blockSize, 512);
+    blockCount_ = std::min(std::max<size_t>(blockCount, 1), MAX_BLOCKS);
+    // Small files fit in fewer blocks than asked for; don't reserve PSRAM they can't use.
+    blockCount_ = std::min<size_t>(blockCount_, std::max<size_t>((size_ + blockSize_ - 1) / blockSize_, 1));
+
+    pool_ = (uint8_t*)ps_malloc(blockSize_ * blockCount_);
+    if (!pool_) {
+        LOG(LogLevel::WARN, "READAHEAD", "ps_malloc(%u) failed, reading %s directly.", (unsigned)(blockSize_ * blockCount_), path);
+        readAhead_ = false;
+        return true;
+    }
+    for (size_t i = 0; i < blockCount_; ++i) {
+        blocks_[i] = Block{pool_ + i * blockSize_, 0, 0, 0, BlockState::EMPTY};
+    }
+
+    nextFetch_ = 0;
+    depth_ = blockCount_; // Assume a front-to-back read until a seek says otherwise
+    ioError_ = false;
+    stopping_ = false;
+    xSemaphoreTake(dataReady_, 0);
+    xSemaphoreTake(stopped_, 0);
+
+    if (xTaskCreatePinnedToCore(taskEntry, "ReadAhead", TASK_STACK_SIZE, this, TASK_PRIORITY, &taskHandle_, TASK_CORE) != pdPASS) {
+        LOG(LogLevel::WARN, "READAHEAD", "Failed to create filler task, reading %s directly.", path);
+        taskHandle_ = nullptr;
+        free(pool_);
+        pool_ = nullptr;
+        readAhead_ = false;
+        return true;
+    }
+    readAhead_ = true;
+    return true;
+}
+
+void ReadAheadStream::close() {
+    if (taskHandle_) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        stopping_ = true;
+        xSemaphoreGive(mutex_);
+        xTaskNotifyGive(taskHandle_);
+        // The filler finishes the block it is reading (if any) before it exits.
+        xSemaphoreTake(stopped_, portMAX_DELAY);
+        taskHandle_ = nullptr;
+    }
+    free(pool_);
+    pool_ = nullptr;
+    if (file_) file_.close();
+    isOpen_ = false;
+    readAhead_ = false;
+    size_ = 0;
+    pos_ = 0;
+}
+
+size_t ReadAheadStream::read(uint8_t* buf, size_t len) {
+    if (!isOpen_) return 0;
+
+    if (!readAhead_) {
+        size_t bytesRead = file_.read(buf, len);
+        PerfStats::count(PerfCounter::SD_READ_BYTES, bytesRead);
+        pos_ += bytesRead;
+        stats_.bytesRead += bytesRead;
+        return bytesRead;
+    }
+
+    size_t total = 0;
+    while (total < len && pos_ < size_) {
+        bool copied = false;
+        bool failed = false;
+
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        Block* block = readyBlockAtLocked(pos_);
+        if (block) {
+            size_t inBlock = pos_ - block->offset;
+            size_t n = std::min(len - total, (size_t)(block->length - inBlock));
+            memcpy(buf + total, block->data + inBlock, n);
+            total += n;
+            pos_ += n;
+            copied = true;
+            if (pos_ >= block->offset + block->length) {
+                // Read straight through a block: the access is sequential, widen the window.
+                block->state = BlockState::EMPTY;
+                depth_ = std::min(depth_ * 2, blockCount_);
+                xTaskNotifyGive(taskHandle_);
+            }
+        } else if (ioError_) {
+            failed = true;
+        } else if (!isPendingLocked(pos_)) {
+            restartLocked(pos_);
+            xTaskNotifyGive(taskHandle_);
+        }
+        xSemaphoreGive(mutex_);
+
+        if (failed) break;
+        if (!copied) {
+            unsigned long waitStart = micros();
+            bool woke = xSemaphoreTake(dataReady_, pdMS_TO_TICKS(READ_TIMEOUT_MS)) == pdTRUE;
+            uint32_t waited = micros() - waitStart;
+            stats_.stalls++;
+            stats_.stallMicros += waited;
+            stats_.maxStallMicros = std::max(stats_.maxStallMicros, waited);
+            if (!woke) {
+                LOG(LogLevel::WARN, "READAHEAD", "Read stalled for %u ms at offset %u.", (unsigned)READ_TIMEOUT_MS, (unsigned)pos_);
+                break;
+            }
+        }
+    }
+    stats_.bytesRead += total;
+    return total;
+}
+
+bool ReadAheadStream::seek(uint32_t pos) {
+    if (!isOpen_ || pos > size_) return false;
+    if (!readAhead_) {
+        if (!file_.seek(pos)) return false;
+        pos_ = pos;
+        return true;
+    }
+
+    // The next read() sorts out the rest: a hit, a wait, or a restart. Blocks the seek
+    // skipped over are reclaimed by the filler (see isReclaimableLocked()).
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    pos_ = pos;
+    xSemaphoreGive(mutex_);
+    xTaskNotifyGive(taskHandle_);
+    return true;
+}
+
+ReadAheadStream::Stats ReadAheadStream::getStats() {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    Stats snapshot = stats_;
+    xSemaphoreGive(mutex_);
+    return snapshot;
+}
+
+// --- Window bookkeeping (mutex_ held) ---
+
+ReadAheadStream::Block* ReadAheadStream::readyBlockAtLocked(uint32_t pos) {
+    for (size_t i = 0; i < blockCount_; ++i) {
+        Block& b = blocks_[i];
+        if (b.state == BlockState::READY && pos >= b.offset && pos < b.offset + b.length) return &b;
+    }
+    return nullptr;
+}
+
+bool ReadAheadStream::isPendingLocked(uint32_t pos) const {
+    uint32_t blockStart = pos - (pos % blockSize_);
+    if (blockStart == nextFetch_) return true; // Next in line for the filler
+    for (size_t i = 0; i < blockCount_; ++i) {
+        const Block& b = blocks_[i];
+        if (b.state == BlockState::FILLING && b.generation == generation_ && b.offset == blockStart) return true;
+    }
+    return false;
+}
+
+// A ready block wholly behind the consumer will never be read again.
+bool ReadAheadStream::isReclaimableLocked(const Block& block) const {
+    return block.state == BlockState::EMPTY ||
+           (block.state == BlockState::READY && block.offset + block.length <= pos_);
+}
+
+size_t ReadAheadStream::blocksInUseLocked() const {
+    size_t inUse = 0;
+    for (size_t i = 0; i < blockCount_; ++i) {
+        if (!isReclaimableLocked(blocks_[i])) inUse++;
+    }
+    return inUse;
+}
+
+void ReadAheadStream::restartLocked(uint32_t pos) {
+    generation_++; // A fill still in flight lands in the old generation and is discarded
+    for (size_t i = 0; i < blockCount_; ++i) {
+        if (blocks_[i].state == BlockState::READY) blocks_[i].state = BlockState::EMPTY;
+    }
+    nextFetch_ = pos - (pos % blockSize_);
+    depth_ = 1;
+    stats_.restarts++;
+}
+
+// --- Filler task ---
+
+void ReadAheadStream::taskEntry(void* param) {
+    static_cast<ReadAheadStream*>(param)->fillLoop();
+}
+
+void ReadAheadStream::fillLoop() {
+    uint32_t filePos = 0; // Where the File's own cursor is, to skip needless seeks
+
+    for (;;) {
+        Block* target = nullptr;
+        uint32_t offset = 0;
+        uint32_t generation = 0;
+
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        if (stopping_) {
+            xSemaphoreGive(mutex_);
+            break;
+        }
+        if (!ioError_ && nextFetch_ < size_ && blocksInUseLocked() < depth_) {
+            for (size_t i = 0; i < blockCount_; ++i) {
+                if (isReclaimableLocked(blocks_[i])) {
+                    target = &blocks_[i];
+                    break;
+                }
+            }
+            if (target) {
+                offset = nextFetch_;
+                generation = generation_;
+                target->state = BlockState::FILLING;
+                target->offset = offset;
+                target->generation = generation;
+                nextFetch_ += blockSize_;
+            }
+        }
+        xSemaphoreGive(mutex_);
+
+        if (!target) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        size_t want = std::min<size_t>(blockSize_, size_ - offset);
+        size_t got = 0;
+        // A failed seek must not read whatever is under the cursor into this block: it
+        // counts as a short read, which ends the stream below.
+        if (filePos == offset || file_.seek(offset)) {
+            got = file_.read(target->data, want);
+            filePos = offset + got;
+        } else {
+            filePos = UINT32_MAX; // Cursor unknown; the next fill seeks again
+        }
+        PerfStats::count(PerfCounter::SD_READ_BYTES, got);
+
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        bool current = target->generation == generation_;
+        if (current && got > 0) {
+            target->length = got;
+            target->state = BlockState::READY;
+        } else {
+            target->state = BlockState::EMPTY;
+        }
+        // A short read before EOF leaves a hole; the consumer gets what arrived, then stops.
+        if (current && got < want) ioError_ = true;
+        xSemaphoreGive(mutex_);
+        xSemaphoreGive(dataReady_);
+    }
+
+    xSemaphoreGive(stopped_);
+    vTaskDelete(nullptr);
+}
@@ -0,0 +1,136 @@
+#include "RetentionEngine.h"
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+    bool matches(const std::string& name, const RetentionPolicy& policy) {
+        size_t prefixLen = strlen(policy.prefix);
+        size_t suffixLen = strlen(policy.suffix);
+        return name.size() >= prefixLen + suffixLen &&
+               name.compare(0, prefixLen, policy.prefix) == 0 &&
+               name.compare(name.size() - suffixLen, suffixLen, policy.suffix) == 0;
+    }
+
+    // Unknown stamps (0, or from an unset clock) sort as older than any real one.
+    time_t sortTime(time_t lastWrite) {
+        return lastWrite >= RetentionEngine::MIN_VALID_TIME ? lastWrite : 0;
+    }
+
+} // namespace
+
+bool RetentionEngine::BackendStorage::list(const char* dir, std::vector<Entry>& out) {
+    auto root = backend_.open(dir, StorageMode::READ);
+    if (!root || !root->isDirectory()) return false;
+    while (auto file = root->openNext()) {
+        out.push_back({file->name(), file->isDirectory() ? 0 : file->size(), file->lastWrite(), file->isDirectory()});
+    }
+    return true;
+}
+
+void RetentionEngine::bucketName(time_t lastWrite, char* out, size_t outSize) {
+    if (lastWrite < MIN_VALID_TIME) {
+        snprintf(out, outSize, "%s", UNDATED_BUCKET);
+        return;
+    }
+    struct tm tm;
+    localtime_r(&lastWrite, &tm);
+    strftime(out, outSize, "%Y-%m", &tm);
+}
+
+bool RetentionEngine::isBucketName(const std::string& name) {
+    if (name == UNDATED_BUCKET) return true;
+    if (name.size() != 7 || name[4] != '-') return false;
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (i != 4 && (name[i] < '0' || name[i] > '9')) return false;
+    }
+    return true;
+}
+
+bool RetentionEngine::collect(const RetentionPolicy& policy, std::vector<Candidate>& out) {
+    std::vector<Entry> entries;
+    if (!storage_.list(policy.dir, entries)) return false;
+
+    std::string dir = policy.dir;
+    std::vector<Entry> bucketEntries;
+    for (const Entry& entry : entries) {
+        if (!entry.isDir) {
+            if (matches(entry.name, policy)) out.push_back({dir + "/" + entry.name, entry.size, entry.lastWrite, false});
+            continue;
+        }
+        if (!isBucketName(entry.name)) continue;
+
+        std::string bucket = dir + "/" + entry.name;
+        bucketEntries.clear();
+        if (!storage_.list(bucket.c_str(), bucketEntries)) continue;
+        for (const Entry& file : bucketEntries) {
+            if (!file.isDir && matches(file.name, policy)) {
+                out.push_back({bucket + "/" + file.name, file.size, file.lastWrite, true});
+            }
+        }
+    }
+
+    std::sort(out.begin(), out.end(), [](const Candidate& a, const Candidate& b) {
+        time_t ta = sortTime(a.lastWrite), tb = sortTime(b.lastWrite);
+        if (ta != tb) return ta < tb;
+        return a.path < b.path;
+    });
+    return true;
+}
+
+bool RetentionEngine::apply(const RetentionPolicy& policy, Report& report, const std::function<bool()>& shouldStop) {
+    std::vector<Candidate> files;
+    if (!collect(policy, files)) return false;
+
+    size_t protectedFrom = files.size() > policy.keepNewest ? files.size() - policy.keepNewest : 0;
+    uint64_t totalBytes = 0;
+    for (const Candidate& file : files) totalBytes += file.size;
+    size_t count = files.size();
+    size_t flatCount = std::count_if(files.begin(), files.end(), [](const Candidate& f) { return !f.inBucket; });
+
+    // --- Prune, oldest first ---
+    for (size_t i = 0; i < protectedFrom; ++i) {
+        bool overCount = policy.maxFiles && count > policy.maxFiles;
+        bool overBytes = policy.maxBytes && totalBytes > policy.maxBytes;
+        if (!overCount && !overBytes) break;
+        if (shouldStop && shouldStop()) return false;
+
+        Candidate& file = files[i];
+        if (storage_.removeFile(file.path.c_str())) {
+            report.deleted++;
+            report.freedBytes += file.size;
+        } else {
+            report.failed++; // Still counted against the budget; retried next pass
+            continue;
+        }
+        count--;
+        totalBytes -= file.size;
+        if (!file.inBucket) flatCount--;
+        file.path.clear(); // Gone
+    }
+
+    // --- Roll the oldest of what is left out of the top directory ---
+    if (policy.flatFiles == 0) return true;
+    std::set<std::string> madeBuckets;
+    for (size_t i = 0; i < protectedFrom && flatCount > policy.flatFiles; ++i) {
+        Candidate& file = files[i];
+        if (file.path.empty() || file.inBucket) continue;
+        if (shouldStop && shouldStop()) return false;
+
+        char name[16];
+        bucketName(file.lastWrite, name, sizeof(name));
+        std::string bucket = std::string(policy.dir) + "/" + name;
+        if (madeBuckets.insert(bucket).second) storage_.makeDir(bucket.c_str()); // Fails harmlessly if it exists
+
+        std::string target = bucket + file.path.substr(file.path.find_last_of('/'));
+        if (storage_.moveFile(file.path.c_str(), target.c_str())) {
+            report.moved++;
+            flatCount--;
+        } else {
+            report.failed++; // E.g. a file of that name was already rolled; left where it is
+        }
+    }
+    return true;
+}
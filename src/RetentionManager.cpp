@@ -0,0 +1,134 @@
+#include "RetentionManager.h"
+#include "App.h"
+#include "Config.h"
+#include "HandshakeCapture.h"
+#include "Logger.h"
+#include "ProbeSniffer.h"
+#include "SdCardManager.h"
+#include "SdWriter.h"
+#include "StationSniffer.h"
+#include "StorageBenchmark.h"
+
+namespace {
+
+    // Each `keepNewest` covers the files a session may still be appending to.
+    constexpr RetentionPolicy POLICIES[] = {
+        // Session logs: system_log_latest.* is always the newest; archives come from Logger rotation.
+        {SD_ROOT::DATA_LOGS, SD_ROOT::LOG_BASE_NAME, "", 12, 8ULL * 1024 * 1024, 0, 1},
+        // One pcap per AP, all kept open while a capture runs.
+        {SD_ROOT::DATA_CAPTURES_HANDSHAKES, "HS_", ".pcap", 1000, 128ULL * 1024 * 1024, 64, 4},
+        // One pcap per sniffing session; probes_session/_cumulative.txt are not matched.
+        {SD_ROOT::DATA_PROBES, "probes_", ".pcap", 200, 64ULL * 1024 * 1024, 32, 1},
+        // Read back by StationFileListDataSource from the top directory only, so never rolled.
+        {SD_ROOT::DATA_CAPTURES_STATION_LISTS, "", ".txt", 200, 0, 0, 1},
+    };
+
+    // RetentionEngine on top of SdCardManager, so the caches and used-space total follow along.
+    class SdCardStorage : public RetentionEngine::Storage {
+    public:
+        bool list(const char* dir, std::vector<RetentionEngine::Entry>& out) override {
+            // Uncached: the listing cache has no timestamps, and a one-off walk shouldn't fill it.
+            File root = SdCardManager::getInstance().openFileUncached(dir);
+            if (!root || !root.isDirectory()) {
+                if (root) root.close();
+                return false;
+            }
+            File file = root.openNextFile();
+            while (file) {
+                bool isDir = file.isDirectory();
+                out.push_back({file.name(), isDir ? 0 : (uint64_t)file.size(), file.getLastWrite(), isDir});
+                file.close();
+                file = root.openNextFile();
+            }
+            root.close();
+            return true;
+        }
+        bool makeDir(const char* path) override {
+            return SdCardManager::getInstance().createDir(path);
+        }
+        bool moveFile(const char* from, const char* to) override {
+            SdWriter::getInstance().release(from); // In case the writer still holds it open
+            return SdCardManager::getInstance().renameFile(from, to);
+        }
+        bool removeFile(const char* path) override {
+            SdWriter::getInstance().release(path);
+            return SdCardManager::getInstance().deleteFile(path);
+        }
+    };
+
+} // namespace
+
+RetentionManager::RetentionManager() :
+    app_(nullptr),
+    running_(false),
+    stopRequested_(false),
+    passRequested_(false),
+    lastPassMs_(0),
+    idleSinceMs_(0),
+    lastReport_{}
+{}
+
+void RetentionManager::setup(App* app) {
+    app_ = app;
+    // The first pass waits FIRST_PASS_DELAY_MS rather than a whole interval.
+    lastPassMs_ = millis() - PASS_INTERVAL_MS + FIRST_PASS_DELAY_MS;
+}
+
+void RetentionManager::loop() {
+    if (!isIdle()) {
+        idleSinceMs_ = 0;
+        if (running_) stopRequested_ = true;
+        return;
+    }
+    unsigned long now = millis();
+    if (idleSinceMs_ == 0) idleSinceMs_ = now;
+    if (running_ || now - idleSinceMs_ < IDLE_SETTLE_MS) return;
+    if (!passRequested_ && now - lastPassMs_ < PASS_INTERVAL_MS) return;
+
+    passRequested_ = false;
+    lastPassMs_ = now;
+    stopRequested_ = false;
+    running_ = true;
+    if (xTaskCreatePinnedToCore(taskEntry, "Retention", TASK_STACK_SIZE, this, TASK_PRIORITY, nullptr, TASK_CORE) != pdPASS) {
+        running_ = false;
+        LOG(LogLevel::ERROR, "RETENTION", "Failed to create task.");
+    }
+}
+
+bool RetentionManager::isIdle() {
+    if (!app_ || !SdCardManager::getInstance().isAvailable()) return false;
+    return !app_->getHandshakeCapture().isActive() &&
+           !app_->getProbeSniffer().isActive() &&
+           !app_->getStationSniffer().isActive() &&
+           StorageBenchmark::getInstance().getState() != StorageBenchmark::State::RUNNING;
+}
+
+void RetentionManager::taskEntry(void* param) {
+    RetentionManager* self = static_cast<RetentionManager*>(param);
+    self->runPass();
+    self->running_ = false;
+    vTaskDelete(nullptr);
+}
+
+void RetentionManager::runPass() {
+    SdCardStorage storage;
+    RetentionEngine engine(storage);
+    RetentionEngine::Report report = {};
+    auto shouldStop = [this]() { return (bool)stopRequested_; };
+
+    unsigned long startMs = millis();
+    bool completed = true;
+    for (const RetentionPolicy& policy : POLICIES) {
+        if (!engine.apply(policy, report, shouldStop) && stopRequested_) {
+            completed = false;
+            break;
+        }
+    }
+    lastReport_ = report;
+
+    if (report.moved || report.deleted || report.failed || !completed) {
+        LOG(LogLevel::INFO, "RETENTION", "%s in %lu ms: %lu rolled, %lu deleted (%llu KB freed), %lu failed",
+            completed ? "Pass done" : "Pass interrupted", millis() - startMs, (unsigned long)report.moved,
+            (unsigned long)report.deleted, (unsigned long long)(report.freedBytes / 1024), (unsigned long)report.failed);
+    }
+}
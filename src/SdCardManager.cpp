@@ -1,6 +1,13 @@
 #include "SdCardManager.h"
 #include "Config.h"
 #include "Logger.h"
+#include "PerfStats.h"
+#include "CrcTrailer.h"
+#ifdef ARDUINO
+#include "SdFatBackend.h"
+#include "ArduinoSdBackend.h"
+#endif
+#include <FSImpl.h>
 #include <vector>
 #include <algorithm>
 
@@ -32,17 +39,26 @@ namespace SdCardManager {
         void close() override { data_.reset(); }
         bool isOpen() const override { return (bool)data_; }
 
-        String readStringUntil(char terminator) override {
-            if (!available()) return "";
+        // Views point straight into the cached block; the shared_ptr keeps it alive past eviction.
+        bool readSlice(std::string_view& out, size_t maxLen) override {
+            if (!available() || maxLen == 0) return false;
+            size_t len = std::min(maxLen, available());
+            out = std::string_view(data_.get() + position_, len);
+            position_ += len;
+            return true;
+        }
+
+        bool readUntil(char terminator, std::string_view& out) override {
+            if (!available()) return false;
             const char* start = data_.get() + position_;
             const char* end = (const char*)memchr(start, terminator, available());
             size_t len = (end == nullptr) ? available() : (end - start);
-            String result(start, len);
+            out = std::string_view(start, len);
             position_ += len;
             if (end != nullptr) {
                 position_++; // Skip terminator
             }
-            return result;
+            return true;
         }
 
     private:
@@ -52,21 +68,164 @@ namespace SdCardManager {
     };
 
     // --- SdFileReader Implementation (wraps a real SD File) ---
+    // Line and slice reads go through a small refill buffer so they can hand out views
+    // instead of building a String per line. Plain read()s drain that buffer first.
     class SdFileReader : public ICachedFileReader {
     public:
-        SdFileReader(File file) : file_(file) {}
+        SdFileReader(File file) : file_(file), bufPos_(0), bufLen_(0) {}
         ~SdFileReader() override { close(); }
 
-        size_t read(uint8_t* buf, size_t size) override { return file_ ? file_.read(buf, size) : 0; }
-        bool seek(uint32_t pos) override { return file_ ? file_.seek(pos) : false; }
-        size_t available() override { return file_ ? file_.available() : 0; }
+        size_t read(uint8_t* buf, size_t size) override {
+            size_t fromBuffer = std::min(size, bufLen_ - bufPos_);
+            if (fromBuffer > 0) {
+                memcpy(buf, buffer_.get() + bufPos_, fromBuffer);
+                bufPos_ += fromBuffer;
+            }
+            if (fromBuffer == size || !file_) return fromBuffer;
+            return fromBuffer + readFromFile(buf + fromBuffer, size - fromBuffer);
+        }
+        bool seek(uint32_t pos) override {
+            bufPos_ = bufLen_ = 0;
+            return file_ ? file_.seek(pos) : false;
+        }
+        size_t available() override { return (bufLen_ - bufPos_) + (file_ ? file_.available() : 0); }
         size_t size() const override { return file_ ? file_.size() : 0; }
-        void close() override { if (file_) file_.close(); }
+        void close() override {
+            if (file_) file_.close();
+            bufPos_ = bufLen_ = 0;
+        }
         bool isOpen() const override { return (bool)file_; }
-        String readStringUntil(char terminator) override { return file_ ? file_.readStringUntil(terminator) : ""; }
+
+        bool readSlice(std::string_view& out, size_t maxLen) override {
+            if (maxLen == 0) return false;
+            if (bufPos_ == bufLen_ && !refill()) return false;
+            size_t len = std::min(maxLen, bufLen_ - bufPos_);
+            out = std::string_view(buffer_.get() + bufPos_, len);
+            bufPos_ += len;
+            return true;
+        }
+
+        bool readUntil(char terminator, std::string_view& out) override {
+            if (bufPos_ == bufLen_ && !refill()) return false;
+
+            size_t scanned = 0; // Bytes after bufPos_ already known not to hold the terminator
+            while (true) {
+                const char* start = buffer_.get() + bufPos_;
+                const char* end = (const char*)memchr(start + scanned, terminator, bufLen_ - bufPos_ - scanned);
+                if (end != nullptr) {
+                    out = std::string_view(start, end - start);
+                    bufPos_ += (end - start) + 1;
+                    return true;
+                }
+                scanned = bufLen_ - bufPos_;
+                // No terminator buffered: top up behind what we have, unless the buffer is
+                // already full (overlong line, returned in pieces) or the file is exhausted.
+                if (scanned == LINE_BUFFER_SIZE || !refill()) {
+                    out = std::string_view(buffer_.get() + bufPos_, scanned);
+                    bufPos_ = bufLen_;
+                    return true;
+                }
+            }
+        }
 
     private:
+        static constexpr size_t LINE_BUFFER_SIZE = 1024;
+
+        size_t readFromFile(uint8_t* buf, size_t size) {
+            size_t bytesRead = file_.read(buf, size);
+            PerfStats::count(PerfCounter::SD_READ_BYTES, bytesRead);
+            return bytesRead;
+        }
+
+        // Moves unread bytes to the front and appends more from the file.
+        // Returns false if nothing could be added.
+        bool refill() {
+            if (!file_) return false;
+            if (!buffer_) buffer_.reset(new (std::nothrow) char[LINE_BUFFER_SIZE]);
+            if (!buffer_) return false;
+            size_t pending = bufLen_ - bufPos_;
+            if (pending > 0 && bufPos_ > 0) memmove(buffer_.get(), buffer_.get() + bufPos_, pending);
+            bufPos_ = 0;
+            bufLen_ = pending;
+            size_t added = readFromFile((uint8_t*)buffer_.get() + bufLen_, LINE_BUFFER_SIZE - bufLen_);
+            bufLen_ += added;
+            return added > 0;
+        }
+
         File file_;
+        std::unique_ptr<char[]> buffer_; // Allocated on the first line/slice read
+        size_t bufPos_;
+        size_t bufLen_;
+    };
+
+    // --- StorageFileImpl: an IStorageFile behind the core's fs::File ---
+    // Everything above the backend (readers, SdWriter, ReadAheadStream, OTA) keeps using
+    // File, whichever library actually mounted the card. Write handles report how much the
+    // file grew on every flush and on close, which keeps the used-space total current.
+    class StorageFileImpl : public fs::FileImpl {
+    public:
+        StorageFileImpl(std::unique_ptr<IStorageFile> file, SdCardManagerAPI* owner, uint64_t accountedSize)
+            : file_(std::move(file)), owner_(owner), accountedSize_(accountedSize) {}
+        ~StorageFileImpl() override { close(); }
+
+        size_t write(const uint8_t* buf, size_t size) override { return file_ ? file_->write(buf, size) : 0; }
+        size_t read(uint8_t* buf, size_t size) override { return file_ ? file_->read(buf, size) : 0; }
+        void flush() override {
+            if (!file_) return;
+            file_->flush();
+            account();
+        }
+        bool seek(uint32_t pos, SeekMode mode) override {
+            if (!file_) return false;
+            uint64_t target = pos;
+            if (mode == SeekCur) target += file_->position();
+            else if (mode == SeekEnd) target += file_->size(); // Same as fseek(SEEK_END) in the VFS
+            return file_->seek(target);
+        }
+        size_t position() const override { return file_ ? (size_t)file_->position() : 0; }
+        size_t size() const override { return file_ ? (size_t)file_->size() : 0; }
+        bool setBufferSize(size_t size) override { return true; } // Backends buffer for themselves
+        void close() override {
+            if (!file_) return;
+            account(); // While the size can still be asked for
+            file_->close();
+            file_.reset();
+        }
+        time_t getLastWrite() override { return file_ ? file_->lastWrite() : 0; }
+        const char* path() const override { return file_ ? file_->path() : ""; }
+        const char* name() const override { return file_ ? file_->name() : ""; }
+        boolean isDirectory() override { return file_ && file_->isDirectory(); }
+        fs::FileImplPtr openNextFile(const char* mode) override {
+            std::unique_ptr<IStorageFile> next = file_ ? file_->openNext() : nullptr;
+            if (!next) return fs::FileImplPtr();
+            return std::make_shared<StorageFileImpl>(std::move(next), nullptr, 0);
+        }
+        boolean seekDir(long position) override { return false; }
+        String getNextFileName() override {
+            bool isDir;
+            return getNextFileName(&isDir);
+        }
+        String getNextFileName(bool* isDir) override {
+            std::unique_ptr<IStorageFile> next = file_ ? file_->openNext() : nullptr;
+            if (!next) return String();
+            if (isDir) *isDir = next->isDirectory();
+            return String(next->path());
+        }
+        void rewindDirectory() override { if (file_) file_->rewind(); }
+        operator bool() override { return file_ && file_->isOpen(); }
+
+    private:
+        void account() {
+            if (!owner_) return;
+            uint64_t size = file_->size();
+            if (size == accountedSize_) return;
+            owner_->noteResize(accountedSize_, size);
+            accountedSize_ = size;
+        }
+
+        std::unique_ptr<IStorageFile> file_;
+        SdCardManagerAPI* owner_; // Null for read handles
+        uint64_t accountedSize_;  // Size last reported to owner_
     };
 
     // --- LineReader Implementation ---
@@ -84,18 +243,48 @@ namespace SdCardManager {
     bool LineReader::isOpen() const { return reader_ && reader_->isOpen(); }
     void LineReader::close() { if (reader_) reader_->close(); }
 
-    String LineReader::readLine() {
-        if (!isOpen()) return "";
-        while (isOpen() && reader_->available()) {
-            String line = reader_->readStringUntil('\n');
-            line.trim();
-            if (!line.isEmpty()) {
-                return line;
+    static inline bool isLineSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+    }
+
+    bool LineReader::readLine(std::string_view& line) {
+        if (!isOpen()) return false;
+        std::string_view raw;
+        while (reader_->readUntil('\n', raw)) {
+            size_t begin = 0;
+            size_t end = raw.size();
+            while (begin < end && isLineSpace(raw[begin])) begin++;
+            while (end > begin && isLineSpace(raw[end - 1])) end--;
+            if (end > begin) {
+                line = raw.substr(begin, end - begin);
+                return true;
             }
         }
-        return "";
+        return false;
+    }
+
+    String LineReader::readLine() {
+        std::string_view line;
+        return readLine(line) ? String(line.data(), line.size()) : String();
     }
     
+    // --- Directory listing helpers ---
+    static const size_t LISTING_RECORD_HEADER = 10; // u32 size + u32 lastWrite + u8 isDir + u8 nameLen
+    static const size_t LISTING_MAX_NAME_LEN = 255;
+
+    static std::string normalizeDirPath(const char* path) {
+        std::string p(path ? path : "");
+        while (p.size() > 1 && p.back() == '/') p.pop_back();
+        if (p.empty()) p = "/";
+        return p;
+    }
+
+    static std::string parentDirOf(const std::string& path) {
+        size_t slash = path.find_last_of('/');
+        if (slash == std::string::npos || slash == 0) return "/";
+        return path.substr(0, slash);
+    }
+
     // --- SdCardManagerAPI Implementation ---
     
     SdCardManagerAPI& getInstance() {
@@ -103,71 +292,414 @@ namespace SdCardManager {
         return instance;
     }
 
-    SdCardManagerAPI::SdCardManagerAPI() {}
+    SdCardManagerAPI::SdCardManagerAPI() :
+        cacheMutex_(xSemaphoreCreateMutex()),
+        dirCacheMutex_(xSemaphoreCreateMutex()),
+#ifdef ARDUINO
+        primaryBackend_(new SdFatBackend(Pins::SD_CS_PIN, SPI, SPI_CLOCK_HZ)),
+        fallbackBackend_(new ArduinoSdBackend(Pins::SD_CS_PIN, SPI, SPI_CLOCK_HZ)),
+#endif // On a host there is no card until setup(backend) hands one over
+        backend_(primaryBackend_.get()),
+        spaceMutex_(xSemaphoreCreateMutex())
+    {}
     
     bool SdCardManagerAPI::setup() {
-        // MODIFICATION: Use the high-speed begin() overload.
-        if (!SD.begin(Pins::SD_CS_PIN, SPI, 40000000)) {
+        // A remount (after USB mode) starts over with the primary backend, whichever had the card before.
+        if (!backend_) return false;
+        backend_->end();
+        sdCardInitialized_ = false;
+
+        if (primaryBackend_->begin()) {
+            backend_ = primaryBackend_.get();
+        } else if (fallbackBackend_ && fallbackBackend_->begin()) {
+            backend_ = fallbackBackend_.get();
+            LOG(LogLevel::WARN, "SD_MGR", "%s could not mount the card, using %s instead.", primaryBackend_->name(), backend_->name());
+        } else {
             LOG(LogLevel::ERROR, "SD_MGR", "SD Card Mount Failed.");
-            sdCardInitialized_ = false;
             return false;
         }
         sdCardInitialized_ = true;
-        LOG(LogLevel::INFO, "SD_MGR", "SD Card Mounted at 40MHz.");
+        LOG(LogLevel::INFO, "SD_MGR", "SD Card Mounted at %lu MHz via %s.", (unsigned long)(SPI_CLOCK_HZ / 1000000), backend_->name());
+
+        // Whatever was counted for the last mount is void (the card may have been swapped or
+        // written over USB); used space is unknown until the scan below lands.
+        xSemaphoreTake(spaceMutex_, portMAX_DELAY);
+        space_.reset(backend_->totalBytes(), backend_->clusterSize());
+        mountGeneration_++;
+        xSemaphoreGive(spaceMutex_);
+
         ensureStandardDirs();
+        rescanUsedSpace();
         return true;
     }
 
+    bool SdCardManagerAPI::setup(std::unique_ptr<IStorageBackend> backend) {
+        if (!backend) return false;
+        if (backend_) backend_->end();
+        sdCardInitialized_ = false;
+        primaryBackend_ = std::move(backend);
+        fallbackBackend_.reset();
+        backend_ = primaryBackend_.get();
+        return setup();
+    }
+
+    void SdCardManagerAPI::end() {
+        // The backend object stays: a task that raced past isAvailable() just sees failed opens.
+        sdCardInitialized_ = false;
+        if (backend_) backend_->end();
+    }
+
     bool SdCardManagerAPI::isAvailable() const { return sdCardInitialized_; }
-    bool SdCardManagerAPI::exists(const char* path) { return sdCardInitialized_ && SD.exists(path); }
+    bool SdCardManagerAPI::exists(const char* path) { return sdCardInitialized_ && backend_->exists(path); }
+    const char* SdCardManagerAPI::getBackendName() const { return sdCardInitialized_ ? backend_->name() : "None"; }
+
+    // --- Space accounting ---
+    uint64_t SdCardManagerAPI::getTotalBytes() {
+        if (!sdCardInitialized_) return 0;
+        xSemaphoreTake(spaceMutex_, portMAX_DELAY);
+        uint64_t total = space_.totalBytes();
+        xSemaphoreGive(spaceMutex_);
+        return total;
+    }
+
+    uint64_t SdCardManagerAPI::getUsedBytes() {
+        if (!sdCardInitialized_) return 0;
+        xSemaphoreTake(spaceMutex_, portMAX_DELAY);
+        uint64_t used = space_.usedBytes();
+        xSemaphoreGive(spaceMutex_);
+        return used;
+    }
+
+    bool SdCardManagerAPI::isUsedSpaceKnown() {
+        xSemaphoreTake(spaceMutex_, portMAX_DELAY);
+        bool known = space_.isKnown();
+        xSemaphoreGive(spaceMutex_);
+        return sdCardInitialized_ && known;
+    }
+
+    void SdCardManagerAPI::rescanUsedSpace() {
+        if (!sdCardInitialized_) return;
+        xSemaphoreTake(spaceMutex_, portMAX_DELAY);
+        bool alreadyRunning = scanRunning_; // It notices a remount by itself and goes round again
+        scanRunning_ = true;
+        xSemaphoreGive(spaceMutex_);
+        if (alreadyRunning) return;
+
+        if (xTaskCreatePinnedToCore(scanTaskEntry, "SdSpaceScan", SCAN_TASK_STACK_SIZE, this, SCAN_TASK_PRIORITY, nullptr, SCAN_TASK_CORE) != pdPASS) {
+            scanRunning_ = false;
+            LOG(LogLevel::ERROR, "SD_MGR", "Failed to create used-space scan task.");
+        }
+    }
+
+    void SdCardManagerAPI::scanTaskEntry(void* param) {
+        SdCardManagerAPI* self = static_cast<SdCardManagerAPI*>(param);
+        for (;;) {
+            xSemaphoreTake(self->spaceMutex_, portMAX_DELAY);
+            uint32_t generation = self->mountGeneration_;
+            self->space_.beginScan();
+            xSemaphoreGive(self->spaceMutex_);
+
+            // The slow part: walks the whole allocation table, with no lock of ours held.
+            unsigned long start = millis();
+            uint64_t used = self->sdCardInitialized_ ? self->backend_->usedBytes() : 0;
+            unsigned long elapsed = millis() - start;
+
+            xSemaphoreTake(self->spaceMutex_, portMAX_DELAY);
+            bool current = generation == self->mountGeneration_ && self->sdCardInitialized_;
+            if (current) self->space_.finishScan(used);
+            bool again = !current && self->sdCardInitialized_; // Remounted mid-scan
+            if (!again) self->scanRunning_ = false;
+            xSemaphoreGive(self->spaceMutex_);
+
+            if (current) {
+                LOG(LogLevel::INFO, "SD_MGR", "Used space: %lu KB (scanned in %lu ms).", (unsigned long)(used / 1024), elapsed);
+            }
+            if (!again) break;
+        }
+        vTaskDelete(nullptr);
+    }
+
+    void SdCardManagerAPI::noteResize(uint64_t oldSize, uint64_t newSize) {
+        xSemaphoreTake(spaceMutex_, portMAX_DELAY);
+        space_.resize(oldSize, newSize);
+        xSemaphoreGive(spaceMutex_);
+    }
+
+    uint64_t SdCardManagerAPI::sizeOnCard(const char* path) {
+        std::unique_ptr<IStorageFile> file = backend_->open(path, StorageMode::READ);
+        if (!file || file->isDirectory()) return 0;
+        return file->size();
+    }
+
+    static StorageMode toStorageMode(const char* mode) {
+        if (mode && mode[0] == 'r' && mode[1] == '+') return StorageMode::UPDATE;
+        if (mode && mode[0] == 'w') return StorageMode::WRITE;
+        if (mode && mode[0] == 'a') return StorageMode::APPEND;
+        return StorageMode::READ;
+    }
+
+    File SdCardManagerAPI::openRaw(const char* path, StorageMode mode, size_t preallocateBytes) {
+        // FILE_WRITE truncates, so whatever the file held is freed the moment it opens.
+        uint64_t truncatedSize = (mode == StorageMode::WRITE) ? sizeOnCard(path) : 0;
+
+        std::unique_ptr<IStorageFile> file = backend_->open(path, mode);
+        if (!file) return File();
+        if (preallocateBytes > 0 && mode == StorageMode::WRITE && !file->preallocate(preallocateBytes)) {
+            LOG(LogLevel::DEBUG, "SD_MGR", false, "No preallocation for %s on %s.", path, backend_->name());
+        }
+
+        if (mode == StorageMode::READ) {
+            return File(std::make_shared<StorageFileImpl>(std::move(file), nullptr, 0));
+        }
+        if (truncatedSize > 0) noteResize(truncatedSize, 0);
+        uint64_t startSize = (mode == StorageMode::APPEND || mode == StorageMode::UPDATE) ? file->size() : 0;
+        return File(std::make_shared<StorageFileImpl>(std::move(file), this, startSize));
+    }
 
-    File SdCardManagerAPI::openFileUncached(const char* path, const char* mode) {
+    File SdCardManagerAPI::openFileUncached(const char* path, const char* mode, size_t preallocateBytes) {
         if (!sdCardInitialized_) return File();
-        File f = SD.open(path, mode);
-        // MODIFICATION: Set the larger buffer size on the newly opened file.
-        if (f) {
-            f.setBufferSize(8192);
+        StorageMode storageMode = toStorageMode(mode);
+        File f = openRaw(path, storageMode, preallocateBytes);
+        // Opening for write/append may create the file, so the parent listing is stale now.
+        // A failed open changed nothing and gets no finishWrite(), so it must not count as a writer.
+        if (f && storageMode != StorageMode::READ) {
+            beginWrite(path);
+            noteMutation(path, false);
         }
         return f;
     }
 
+    void SdCardManagerAPI::finishWrite(const char* path) {
+        endWrite(path, false);
+    }
+
+    bool SdCardManagerAPI::listDir(const char* path, std::vector<DirEntry>& out) {
+        out.clear();
+        return forEachDirEntry(path, [&out](const DirEntry& entry) {
+            out.push_back(entry);
+            return true;
+        });
+    }
+
+    bool SdCardManagerAPI::forEachDirEntry(const char* path, const std::function<bool(const DirEntry&)>& onEntry) {
+        if (!sdCardInitialized_) return false;
+        std::string key = normalizeDirPath(path);
+
+        xSemaphoreTake(dirCacheMutex_, portMAX_DELAY);
+        auto it = dirCache_.find(key);
+
+        // --- LISTING HIT ---
+        if (it != dirCache_.end()) {
+            CachedListing listing = it->second; // Keeps the PSRAM block alive once we unlock
+            xSemaphoreGive(dirCacheMutex_);
+            LOG(LogLevel::DEBUG, "SD_CACHE", false, "LISTING HIT for: %s", key.c_str());
+
+            const char* cursor = listing.data.get();
+            DirEntry entry;
+            for (size_t i = 0; i < listing.count; ++i) {
+                uint32_t size;
+                memcpy(&size, cursor, sizeof(size));
+                entry.size = size;
+                memcpy(&entry.lastWrite, cursor + 4, sizeof(entry.lastWrite));
+                entry.isDir = cursor[8] != 0;
+                uint8_t nameLen = (uint8_t)cursor[9];
+                entry.name.assign(cursor + LISTING_RECORD_HEADER, nameLen);
+                cursor += LISTING_RECORD_HEADER + nameLen;
+                if (!onEntry(entry)) break;
+            }
+            return true;
+        }
+
+        auto genIt = dirGenerations_.find(key);
+        uint32_t startGeneration = (genIt != dirGenerations_.end()) ? genIt->second : 0;
+        uint32_t startEpoch = listingEpoch_;
+        xSemaphoreGive(dirCacheMutex_);
+
+        // --- LISTING MISS: walk the card, handing entries out as they arrive ---
+        File root = openRaw(key.c_str(), StorageMode::READ);
+        if (!root || !root.isDirectory()) {
+            if (root) root.close();
+            return false;
+        }
+
+        std::vector<DirEntry> entries;
+        size_t packedSize = 0;
+        bool cacheable = true;
+        File file = root.openNextFile();
+        while (file) {
+            bool isDir = file.isDirectory();
+            entries.push_back({file.name(), isDir ? 0 : (size_t)file.size(), isDir ? 0 : (uint32_t)file.getLastWrite(), isDir});
+            file.close();
+
+            const DirEntry& entry = entries.back();
+            if (entry.name.size() > LISTING_MAX_NAME_LEN) cacheable = false;
+            packedSize += LISTING_RECORD_HEADER + entry.name.size();
+
+            if (!onEntry(entry)) {
+                cacheable = false; // Partial walk
+                break;
+            }
+            file = root.openNextFile();
+        }
+        root.close();
+
+        if (cacheable) {
+            storeListing(key, entries, packedSize, startGeneration, startEpoch);
+        }
+        return true;
+    }
+
+    void SdCardManagerAPI::storeListing(const std::string& key, const std::vector<DirEntry>& entries, size_t packedSize, uint32_t generation, uint32_t epoch) {
+        if (packedSize > MAX_LISTING_CACHE_SIZE) return;
+
+        char* buffer = nullptr;
+        if (packedSize > 0) {
+            buffer = (char*)ps_malloc(packedSize);
+            if (!buffer) {
+                LOG(LogLevel::ERROR, "SD_CACHE", "ps_malloc failed for %d byte listing!", packedSize);
+                return;
+            }
+            char* cursor = buffer;
+            for (const auto& entry : entries) {
+                uint32_t size = entry.size;
+                memcpy(cursor, &size, sizeof(size));
+                memcpy(cursor + 4, &entry.lastWrite, sizeof(entry.lastWrite));
+                cursor[8] = entry.isDir ? 1 : 0;
+                cursor[9] = (char)(uint8_t)entry.name.size();
+                memcpy(cursor + LISTING_RECORD_HEADER, entry.name.data(), entry.name.size());
+                cursor += LISTING_RECORD_HEADER + entry.name.size();
+            }
+        }
+        CachedListing listing{std::shared_ptr<char>(buffer, CachedFile::PsramDeleter()), packedSize, entries.size()};
+
+        xSemaphoreTake(dirCacheMutex_, portMAX_DELAY);
+        auto genIt = dirGenerations_.find(key);
+        uint32_t currentGeneration = (genIt != dirGenerations_.end()) ? genIt->second : 0;
+        if (currentGeneration == generation && listingEpoch_ == epoch) {
+            auto existing = dirCache_.find(key);
+            if (existing != dirCache_.end()) {
+                currentListingCacheSize_ -= existing->second.size;
+                dirCache_.erase(existing);
+            }
+            if (currentListingCacheSize_ + packedSize > MAX_LISTING_CACHE_SIZE) {
+                // Listings are cheap to rebuild, so just start over instead of tracking LRU order.
+                dirCache_.clear();
+                currentListingCacheSize_ = 0;
+            }
+            dirCache_.emplace(key, listing);
+            currentListingCacheSize_ += packedSize;
+        }
+        xSemaphoreGive(dirCacheMutex_);
+    }
+
+    void SdCardManagerAPI::noteMutation(const char* path, bool mayBeDir) {
+        std::string target = normalizeDirPath(path);
+        std::string parent = parentDirOf(target);
+
+        xSemaphoreTake(dirCacheMutex_, portMAX_DELAY);
+        ++dirGenerations_[parent];
+        auto it = dirCache_.find(parent);
+        if (it != dirCache_.end()) {
+            currentListingCacheSize_ -= it->second.size;
+            dirCache_.erase(it);
+        }
+
+        if (mayBeDir) {
+            // A created, renamed or removed directory invalidates its own listing and its subtree.
+            ++dirGenerations_[target];
+            it = dirCache_.find(target);
+            if (it != dirCache_.end()) {
+                currentListingCacheSize_ -= it->second.size;
+                dirCache_.erase(it);
+            }
+            std::string prefix = target + "/";
+            it = dirCache_.lower_bound(prefix);
+            while (it != dirCache_.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+                currentListingCacheSize_ -= it->second.size;
+                it = dirCache_.erase(it);
+            }
+        }
+        xSemaphoreGive(dirCacheMutex_);
+    }
+
+    bool SdCardManagerAPI::prefetch(const char* path) {
+        if (!sdCardInitialized_) return false;
+
+        // Directories: a full walk lands in the listing cache.
+        if (forEachDirEntry(path, [](const DirEntry&) { return true; })) {
+            return true;
+        }
+
+        // Files: only small ones, so a stray hover never streams megabytes into PSRAM.
+        File f = openRaw(path, StorageMode::READ);
+        if (!f) return false;
+        size_t fileSize = f.size();
+        f.close();
+        if (fileSize == 0 || fileSize > MAX_PREFETCH_FILE_SIZE) return false;
+
+        return open(path) != nullptr;
+    }
+
+    void SdCardManagerAPI::invalidateAll() {
+        xSemaphoreTake(cacheMutex_, portMAX_DELAY);
+        cache_.clear();
+        ++fileEpoch_;
+        xSemaphoreGive(cacheMutex_);
+
+        xSemaphoreTake(dirCacheMutex_, portMAX_DELAY);
+        dirCache_.clear();
+        currentListingCacheSize_ = 0;
+        ++listingEpoch_;
+        xSemaphoreGive(dirCacheMutex_);
+        LOG(LogLevel::INFO, "SD_CACHE", false, "All cached files and directory listings invalidated.");
+    }
+
 
     std::unique_ptr<ICachedFileReader> SdCardManagerAPI::open(const char* path) {
         if (!sdCardInitialized_) return nullptr;
 
         std::string path_str(path);
-        auto it = cache_.find(path_str);
+        xSemaphoreTake(cacheMutex_, portMAX_DELAY);
 
         // --- CACHE HIT ---
-        if (it != cache_.end()) {
+        if (CachedFile* cached = cache_.get(path_str)) {
+            auto reader = std::make_unique<PsramFileReader>(cached->data, cached->size);
+            xSemaphoreGive(cacheMutex_);
             LOG(LogLevel::DEBUG, "SD_CACHE", false, "CACHE HIT for: %s", path);
-            touch(path_str);
-            return std::make_unique<PsramFileReader>(it->second.data, it->second.size);
+            return reader;
         }
 
-        // --- CACHE MISS ---
-        File f = SD.open(path, FILE_READ);
+        // --- CACHE MISS: read the card without holding the lock, admit only if no write raced us ---
+        uint32_t startGeneration = fileGenerationLocked(path_str);
+        uint32_t startEpoch = fileEpoch_;
+        bool beingWritten = writesInFlight_.count(path_str) > 0;
+        xSemaphoreGive(cacheMutex_);
+
+        File f = openRaw(path, StorageMode::READ);
         if (!f || f.isDirectory()) {
             if (f) f.close();
             return nullptr;
         }
 
         size_t fileSize = f.size();
-        if (fileSize > 0 && fileSize < MAX_CACHEABLE_FILE_SIZE) {
-            f.close(); // Close before caching
+        if (fileSize > MAX_CACHEABLE_FILE_SIZE) {
+            xSemaphoreTake(cacheMutex_, portMAX_DELAY);
+            cache_.noteBypass();
+            xSemaphoreGive(cacheMutex_);
+            LOG(LogLevel::DEBUG, "SD_CACHE", false, "CACHE SKIP (too large) for: %s", path);
+        } else if (fileSize > 0 && !beingWritten) {
             LOG(LogLevel::DEBUG, "SD_CACHE", false, "CACHE MISS for: %s. Caching it.", path);
-            cacheFile(path_str);
-            // Try to read from cache again
-            it = cache_.find(path_str);
-            if (it != cache_.end()) {
-                touch(path_str);
-                return std::make_unique<PsramFileReader>(it->second.data, it->second.size);
+            std::shared_ptr<char> data = readIntoPsram(path_str, f, fileSize);
+            if (data) {
+                f.close();
+                storeFile(path_str, data, fileSize, startGeneration, startEpoch);
+                return std::make_unique<PsramFileReader>(data, fileSize);
             }
+            // Caching failed; rewind for a direct read below
+            f.seek(0);
         }
         
-        // File is too large or caching failed, return direct SD reader with large buffer
-        LOG(LogLevel::DEBUG, "SD_CACHE", false, "CACHE SKIP (too large) for: %s", path);
-        f.setBufferSize(8192); // Also set buffer for direct reads
+        // File is too large, being written or caching failed: read it straight off the card
         return std::make_unique<SdFileReader>(f);
     }
 
@@ -179,85 +711,283 @@ namespace SdCardManager {
         auto reader = open(path);
         if (!reader || !reader->isOpen()) return "";
 
-        size_t size = reader->size();
         String content;
-        content.reserve(size);
-        char buffer[256];
-        size_t bytesRead;
-        while ((bytesRead = reader->read((uint8_t*)buffer, sizeof(buffer))) > 0) {
-            content.concat(buffer, bytesRead);
+        content.reserve(reader->size());
+        std::string_view slice;
+        while (reader->readSlice(slice)) {
+            content.concat(slice.data(), slice.size());
         }
         return content;
     }
 
-    void SdCardManagerAPI::cacheFile(const std::string& path) {
-        File f = SD.open(path.c_str(), FILE_READ);
-        if (!f || f.isDirectory()) {
-            if (f) f.close();
-            return;
-        }
-
-        size_t fileSize = f.size();
-        if (fileSize == 0 || fileSize >= MAX_CACHEABLE_FILE_SIZE) {
-            f.close();
-            return;
-        }
+    size_t SdCardManagerAPI::readInto(const char* path, char* buffer, size_t bufferSize) {
+        if (!buffer || bufferSize == 0) return 0;
+        buffer[0] = '\0';
+        auto reader = open(path);
+        if (!reader || !reader->isOpen()) return 0;
 
-        while (currentCacheSize_ + fileSize > MAX_TOTAL_CACHE_SIZE) {
-            evictLRU();
+        size_t total = 0;
+        std::string_view slice;
+        while (total < bufferSize - 1 && reader->readSlice(slice, bufferSize - 1 - total)) {
+            memcpy(buffer + total, slice.data(), slice.size());
+            total += slice.size();
         }
+        buffer[total] = '\0';
+        return total;
+    }
 
+    std::shared_ptr<char> SdCardManagerAPI::readIntoPsram(const std::string& path, File& file, size_t fileSize) {
         char* buffer = (char*)ps_malloc(fileSize);
         if (!buffer) {
             LOG(LogLevel::ERROR, "SD_CACHE", "ps_malloc failed for %d bytes!", fileSize);
-            f.close();
-            return;
+            return nullptr;
+        }
+        std::shared_ptr<char> data(buffer, CachedFile::PsramDeleter());
+
+        size_t bytesRead = file.read((uint8_t*)buffer, fileSize);
+        PerfStats::count(PerfCounter::SD_READ_BYTES, bytesRead);
+        if (bytesRead != fileSize) {
+            LOG(LogLevel::ERROR, "SD_CACHE", "Short read caching %s (%d of %d bytes).", path.c_str(), bytesRead, fileSize);
+            return nullptr;
+        }
+        return data;
+    }
+
+    bool SdCardManagerAPI::storeFile(const std::string& path, std::shared_ptr<char> data, size_t size, uint32_t generation, uint32_t epoch) {
+        xSemaphoreTake(cacheMutex_, portMAX_DELAY);
+        bool unchanged = fileGenerationLocked(path) == generation && fileEpoch_ == epoch &&
+                         writesInFlight_.count(path) == 0;
+        uint32_t evictionsBefore = cache_.stats().evictions;
+        bool stored = unchanged && cache_.put(path, CachedFile(std::move(data), size), size) != nullptr;
+        uint32_t evicted = cache_.stats().evictions - evictionsBefore;
+        size_t totalSize = cache_.bytes();
+        xSemaphoreGive(cacheMutex_);
+
+        // Logged after unlocking: the SD writer task takes cacheMutex_ when it opens the log file.
+        if (stored) {
+            LOG(LogLevel::INFO, "SD_CACHE", "Cached %s (%d bytes, %u evicted). Total cache size: %d / %d bytes.",
+                path.c_str(), size, (unsigned)evicted, totalSize, MAX_TOTAL_CACHE_SIZE);
+        } else if (!unchanged) {
+            LOG(LogLevel::DEBUG, "SD_CACHE", false, "Not caching %s: written while it was being read.", path.c_str());
         }
+        return stored;
+    }
+
+    // --- Write coherence ---
+    uint32_t SdCardManagerAPI::fileGenerationLocked(const std::string& path) const {
+        auto it = fileGenerations_.find(path);
+        return it != fileGenerations_.end() ? it->second : drainedGeneration_;
+    }
+
+    bool SdCardManagerAPI::beginWrite(const char* path) {
+        std::string key(path);
+        xSemaphoreTake(cacheMutex_, portMAX_DELAY);
+        fileGenerations_[key] = ++writeClock_;
+        ++writesInFlight_[key];
+        bool wasCached = cache_.erase(key);
+        xSemaphoreGive(cacheMutex_);
+        return wasCached;
+    }
+
+    void SdCardManagerAPI::endWrite(const char* path, bool mayBeDir, const char* contents, size_t size) {
+        std::string key(path);
+
+        // Copy the new contents before taking the lock so readers are not held up by it.
+        std::shared_ptr<char> copy;
+        if (contents && size > 0 && size <= MAX_CACHEABLE_FILE_SIZE) {
+            if (char* buffer = (char*)ps_malloc(size)) {
+                memcpy(buffer, contents, size);
+                copy.reset(buffer, CachedFile::PsramDeleter());
+            }
+        }
+
+        xSemaphoreTake(cacheMutex_, portMAX_DELAY);
+        uint32_t generation = ++writeClock_;
+        auto inFlight = writesInFlight_.find(key);
+        if (inFlight != writesInFlight_.end() && --inFlight->second > 0) {
+            fileGenerations_[key] = generation;
+        } else {
+            // Drained: the entry goes, and every path without one reads as this generation from
+            // now on, so a read that sampled this file before the write still can't be admitted.
+            if (inFlight != writesInFlight_.end()) writesInFlight_.erase(inFlight);
+            fileGenerations_.erase(key);
+            drainedGeneration_ = generation;
+        }
+        cache_.erase(key);
+        if (copy && writesInFlight_.count(key) == 0) {
+            cache_.put(key, CachedFile(std::move(copy), size), size);
+        }
+        xSemaphoreGive(cacheMutex_);
 
-        f.read((uint8_t*)buffer, fileSize);
+        if (mayBeDir) {
+            dropCachedTree(path);
+        }
+        noteMutation(path, mayBeDir);
+    }
+
+    void SdCardManagerAPI::dropCachedTree(const char* dirPath) {
+        std::string prefix = normalizeDirPath(dirPath) + "/";
+        xSemaphoreTake(cacheMutex_, portMAX_DELAY);
+        cache_.eraseIf([&prefix](const std::string& key) { return key.compare(0, prefix.size(), prefix) == 0; });
+        ++fileEpoch_; // Any read of a file below here that is still in flight must not be stored
+        xSemaphoreGive(cacheMutex_);
+    }
+
+    FileCacheStats SdCardManagerAPI::getFileCacheStats() {
+        xSemaphoreTake(cacheMutex_, portMAX_DELAY);
+        const auto& stats = cache_.stats();
+        FileCacheStats snapshot{stats.hits, stats.misses, stats.evictions, stats.bypasses,
+                                cache_.count(), cache_.bytes(), cache_.capacity(), writesInFlight_.size()};
+        xSemaphoreGive(cacheMutex_);
+        return snapshot;
+    }
+
+    // --- Mutations: each is bracketed by beginWrite()/endWrite() so caches never serve stale data ---
+    bool SdCardManagerAPI::writeFile(const char *path, const char *message) {
+        if (!sdCardInitialized_) return false;
+        bool wasCached = beginWrite(path);
+        File f = openRaw(path, StorageMode::WRITE);
+        if (!f) {
+            endWrite(path, false);
+            return false;
+        }
+        size_t length = strlen(message);
+        size_t written = f.print(message);
+        PerfStats::count(PerfCounter::SD_WRITE_BYTES, written);
+        bool success = written > 0;
         f.close();
+        // A file that was hot before the write is replaced with the new bytes rather than dropped.
+        bool writeThrough = success && wasCached && written == length;
+        endWrite(path, false, writeThrough ? message : nullptr, length);
+        return success;
+    }
 
-        cache_.emplace(path, CachedFile(buffer, fileSize));
-        currentCacheSize_ += fileSize;
-        LOG(LogLevel::INFO, "SD_CACHE", "Cached %s (%d bytes). Total cache size: %d / %d bytes.", path.c_str(), fileSize, currentCacheSize_, MAX_TOTAL_CACHE_SIZE);
+    bool SdCardManagerAPI::deleteFile(const char* path) {
+        if (!sdCardInitialized_) return false;
+        beginWrite(path);
+        uint64_t size = sizeOnCard(path);
+        bool success = backend_->remove(path);
+        if (success) noteResize(size, 0);
+        endWrite(path, true);
+        return success;
     }
-    
-    void SdCardManagerAPI::evictLRU() {
-        if (cache_.empty()) return;
 
-        std::string lru_path;
-        unsigned long oldest_time = -1;
+    bool SdCardManagerAPI::renameFile(const char* pathFrom, const char* pathTo) {
+        if (!sdCardInitialized_) return false;
+        beginWrite(pathFrom);
+        beginWrite(pathTo);
+        bool success = backend_->rename(pathFrom, pathTo);
+        endWrite(pathFrom, true);
+        endWrite(pathTo, true);
+        return success;
+    }
+
+    // --- Atomic replace ---
+    bool SdCardManagerAPI::writeFileAtomic(const char* path, const char* data, size_t len) {
+        if (!sdCardInitialized_) return false;
+        std::string tmpPath = std::string(path) + ATOMIC_TMP_SUFFIX;
+        std::string bakPath = std::string(path) + ATOMIC_BAK_SUFFIX;
+
+        char trailer[CrcTrailer::SIZE];
+        CrcTrailer::format(CrcTrailer::update(0, data, len), trailer);
+
+        beginWrite(tmpPath.c_str());
+        File f = openRaw(tmpPath.c_str(), StorageMode::WRITE);
+        bool written = false;
+        if (f) {
+            written = f.write((const uint8_t*)data, len) == len &&
+                      f.write((const uint8_t*)trailer, CrcTrailer::SIZE) == CrcTrailer::SIZE;
+            f.flush(); // Syncs the data and directory entry before anything is renamed over it
+            f.close();
+            PerfStats::count(PerfCounter::SD_WRITE_BYTES, len + CrcTrailer::SIZE);
+        }
+        endWrite(tmpPath.c_str(), false);
+        if (!written) {
+            LOG(LogLevel::ERROR, "SD_MGR", "Atomic write of %s failed; previous copy kept.", path);
+            deleteFile(tmpPath.c_str());
+            return false;
+        }
 
-        for (const auto& pair : cache_) {
-            if (pair.second.lastAccess < oldest_time) {
-                oldest_time = pair.second.lastAccess;
-                lru_path = pair.first;
+        // Rename never replaces on FAT, so each target is cleared first. Between any two of
+        // these steps either `path` or `path`.tmp is complete.
+        if (exists(path)) {
+            if (exists(bakPath.c_str())) deleteFile(bakPath.c_str());
+            if (!renameFile(path, bakPath.c_str())) {
+                LOG(LogLevel::ERROR, "SD_MGR", "Atomic write of %s: cannot retire the old copy.", path);
+                return false;
             }
         }
-        
-        if (!lru_path.empty()) {
-            auto it = cache_.find(lru_path);
-            if (it != cache_.end()) {
-                size_t fileSize = it->second.size;
-                LOG(LogLevel::INFO, "SD_CACHE", "Evicting %s to free %d bytes.", lru_path.c_str(), fileSize);
-                currentCacheSize_ -= fileSize;
-                cache_.erase(it);
+        if (!renameFile(tmpPath.c_str(), path)) {
+            LOG(LogLevel::ERROR, "SD_MGR", "Atomic write of %s: cannot move the new copy into place.", path);
+            return false;
+        }
+        return true;
+    }
+
+    SdCardManagerAPI::CopyState SdCardManagerAPI::checkCopy(const char* path) {
+        auto reader = open(path);
+        if (!reader || !reader->isOpen() || reader->size() == 0) return CopyState::BAD;
+        size_t size = reader->size();
+        if (size < CrcTrailer::SIZE) return CopyState::UNCHECKED;
+
+        // Stream the CRC (the file may be a large index) and stop exactly where the trailer starts.
+        size_t payload = size - CrcTrailer::SIZE;
+        uint32_t crc = 0;
+        std::string_view slice;
+        for (size_t done = 0; done < payload; done += slice.size()) {
+            if (!reader->readSlice(slice, payload - done)) return CopyState::BAD;
+            crc = CrcTrailer::update(crc, slice.data(), slice.size());
+        }
+        char trailer[CrcTrailer::SIZE];
+        if (reader->read((uint8_t*)trailer, CrcTrailer::SIZE) != CrcTrailer::SIZE) return CopyState::BAD;
+
+        uint32_t expected;
+        if (!CrcTrailer::parse(trailer, expected)) return CopyState::UNCHECKED;
+        if (expected != crc) return CopyState::BAD;
+        return CopyState::INTACT;
+    }
+
+    bool SdCardManagerAPI::restoreAtomic(const char* path) {
+        if (!sdCardInitialized_) return false;
+        if (checkCopy(path) != CopyState::BAD) return true;
+
+        // The .tmp is only complete if the cut came after it was synced, so it is the newer copy.
+        const char* suffixes[] = { ATOMIC_TMP_SUFFIX, ATOMIC_BAK_SUFFIX };
+        for (const char* suffix : suffixes) {
+            std::string candidate = std::string(path) + suffix;
+            if (checkCopy(candidate.c_str()) != CopyState::INTACT) continue;
+            if (exists(path)) deleteFile(path);
+            if (renameFile(candidate.c_str(), path)) {
+                LOG(LogLevel::WARN, "SD_MGR", "%s was missing or damaged; restored it from %s.", path, candidate.c_str());
+                return true;
             }
         }
+        return false;
+    }
+
+    bool SdCardManagerAPI::readFileAtomic(const char* path, String& out) {
+        out = "";
+        if (!restoreAtomic(path)) return false;
+        out = readFile(path); // Served from the PSRAM cache restoreAtomic() just warmed
+        uint32_t crc;
+        if (out.length() >= CrcTrailer::SIZE && CrcTrailer::parse(out.c_str() + out.length() - CrcTrailer::SIZE, crc)) {
+            out.remove(out.length() - CrcTrailer::SIZE);
+        }
+        return true;
     }
 
-    void SdCardManagerAPI::touch(const std::string& path) {
-        auto it = cache_.find(path);
-        if (it != cache_.end()) {
-            it->second.lastAccess = millis();
+    bool SdCardManagerAPI::createDir(const char *path) {
+        if (!sdCardInitialized_) return false;
+        bool success = backend_->mkdir(path);
+        if (success) {
+            xSemaphoreTake(spaceMutex_, portMAX_DELAY);
+            space_.addDirectory();
+            xSemaphoreGive(spaceMutex_);
         }
+        noteMutation(path, true);
+        return success;
     }
 
-    // --- Passthrough functions that don't need caching logic ---
-    bool SdCardManagerAPI::writeFile(const char *path, const char *message) { if (!sdCardInitialized_) return false; File f = SD.open(path, FILE_WRITE); if (!f) return false; bool success = f.print(message); f.close(); return success; }
-    bool SdCardManagerAPI::deleteFile(const char* path) { if (!sdCardInitialized_) return false; return SD.remove(path); }
-    bool SdCardManagerAPI::renameFile(const char* pathFrom, const char* pathTo) { if (!sdCardInitialized_) return false; return SD.rename(pathFrom, pathTo); }
-    bool SdCardManagerAPI::createDir(const char *path) { if (!sdCardInitialized_) return false; return SD.mkdir(path); }
     void SdCardManagerAPI::ensureStandardDirs() {
         if (!sdCardInitialized_) return;
         const char* dirs[] = {
@@ -0,0 +1,240 @@
+#define DISABLE_FS_H_WARNING // We never want SdFat's global File typedef
+#include <SdFat.h>
+#include "SdFatBackend.h"
+#include <algorithm>
+#include <string>
+#include <time.h>
+
+namespace {
+
+    // Recursive: a handle that fails to open is destroyed (and closed) with the lock held.
+    class VolumeLock {
+    public:
+        explicit VolumeLock(SemaphoreHandle_t mutex) : mutex_(mutex) { xSemaphoreTakeRecursive(mutex_, portMAX_DELAY); }
+        ~VolumeLock() { xSemaphoreGiveRecursive(mutex_); }
+
+        VolumeLock(const VolumeLock&) = delete;
+        VolumeLock& operator=(const VolumeLock&) = delete;
+
+    private:
+        SemaphoreHandle_t mutex_;
+    };
+
+    class SdFatFile : public IStorageFile {
+    public:
+        SdFatFile(SemaphoreHandle_t mutex, bool exFat, const char* path) :
+            mutex_(mutex), exFat_(exFat), preallocated_(false), highWater_(0), nameOffset_(0) {
+            setPath(path);
+        }
+        ~SdFatFile() override { close(); }
+
+        FsFile& handle() { return file_; } // Opened in place; FsFile copies duplicate the whole handle
+
+        void setPath(std::string path) {
+            path_ = std::move(path);
+            size_t slash = path_.find_last_of('/');
+            nameOffset_ = (slash == std::string::npos || path_.size() == 1) ? 0 : slash + 1;
+        }
+
+        size_t read(uint8_t* buf, size_t len) override {
+            VolumeLock lock(mutex_);
+            int got = file_.read(buf, len);
+            return got > 0 ? (size_t)got : 0;
+        }
+        size_t write(const uint8_t* buf, size_t len) override {
+            VolumeLock lock(mutex_);
+            size_t written = file_.write(buf, len);
+            if (preallocated_) highWater_ = std::max(highWater_, (uint64_t)file_.curPosition());
+            return written;
+        }
+        bool seek(uint64_t pos) override {
+            VolumeLock lock(mutex_);
+            return file_.seekSet(pos);
+        }
+        uint64_t position() const override {
+            VolumeLock lock(mutex_);
+            return const_cast<FsFile&>(file_).curPosition();
+        }
+        uint64_t size() const override {
+            VolumeLock lock(mutex_);
+            // A preallocated file's length is its reservation until it is closed.
+            return preallocated_ ? highWater_ : const_cast<FsFile&>(file_).fileSize();
+        }
+        bool flush() override {
+            VolumeLock lock(mutex_);
+            return file_.sync();
+        }
+        void close() override {
+            VolumeLock lock(mutex_);
+            if (!file_.isOpen()) return;
+            if (preallocated_) {
+                file_.truncate(highWater_); // Give back the part of the reservation we never used
+                preallocated_ = false;
+            }
+            file_.close();
+        }
+        bool isOpen() const override {
+            VolumeLock lock(mutex_);
+            return const_cast<FsFile&>(file_).isOpen();
+        }
+        bool isDirectory() const override {
+            VolumeLock lock(mutex_);
+            return const_cast<FsFile&>(file_).isDir();
+        }
+
+        const char* name() const override { return path_.c_str() + nameOffset_; }
+        const char* path() const override { return path_.c_str(); }
+
+        time_t lastWrite() override {
+            VolumeLock lock(mutex_);
+            uint16_t date, time;
+            if (!file_.getModifyDateTime(&date, &time)) return 0;
+            struct tm tm = {};
+            tm.tm_year = FS_YEAR(date) - 1900;
+            tm.tm_mon = FS_MONTH(date) - 1;
+            tm.tm_mday = FS_DAY(date);
+            tm.tm_hour = FS_HOUR(time);
+            tm.tm_min = FS_MINUTE(time);
+            tm.tm_sec = FS_SECOND(time);
+            return mktime(&tm);
+        }
+
+        std::unique_ptr<IStorageFile> openNext() override {
+            VolumeLock lock(mutex_);
+            std::string prefix = path_;
+            if (prefix.empty() || prefix.back() != '/') prefix += '/';
+
+            auto entry = std::make_unique<SdFatFile>(mutex_, exFat_, "");
+            if (!entry->file_.openNext(&file_, O_RDONLY)) return nullptr;
+            char entryName[256];
+            entry->file_.getName(entryName, sizeof(entryName));
+            entry->setPath(prefix + entryName);
+            return entry;
+        }
+        void rewind() override {
+            VolumeLock lock(mutex_);
+            file_.rewind();
+        }
+
+        bool preallocate(uint64_t bytes) override {
+            if (!exFat_ || bytes == 0) return false; // See SdFatBackend: FAT has no valid length
+            VolumeLock lock(mutex_);
+            if (!file_.isWritable() || file_.fileSize() != 0) return false;
+            if (!file_.preAllocate(bytes)) return false;
+            preallocated_ = true;
+            highWater_ = 0;
+            return true;
+        }
+
+    private:
+        SemaphoreHandle_t mutex_;
+        FsFile file_;
+        bool exFat_;
+        bool preallocated_;
+        uint64_t highWater_; // Logical end of a preallocated file
+        std::string path_;
+        size_t nameOffset_;
+    };
+
+    // Stamps created and modified files with the system clock (set from the RTC or NTP), as the
+    // SD library does; without it SdFat writes one fixed date and every file looks the same age.
+    void stampFromClock(uint16_t* date, uint16_t* time, uint8_t* ms10) {
+        time_t now = ::time(nullptr);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        if (tm.tm_year + 1900 < 1980) tm = {0, 0, 0, 1, 0, 80}; // Clock never set: the FAT epoch
+        *date = FS_DATE(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+        *time = FS_TIME(tm.tm_hour, tm.tm_min, tm.tm_sec);
+        *ms10 = (tm.tm_sec & 1) ? 100 : 0;
+    }
+
+} // namespace
+
+SdFatBackend::SdFatBackend(uint8_t csPin, SPIClass& spi, uint32_t clockHz) :
+    csPin_(csPin),
+    spi_(spi),
+    clockHz_(clockHz),
+    mutex_(xSemaphoreCreateRecursiveMutex()),
+    mounted_(false),
+    name_{"SdFat"}
+{}
+
+SdFatBackend::~SdFatBackend() {
+    end();
+    vSemaphoreDelete(mutex_);
+}
+
+bool SdFatBackend::begin() {
+    VolumeLock lock(mutex_);
+    if (!sd_) sd_.reset(new SdFs());
+    if (mounted_) sd_->end();
+    FsDateTime::setCallback(stampFromClock);
+
+    // SHARED_SPI: the radios sit on the same bus, so SdFat must release it between transfers.
+    mounted_ = sd_->begin(SdSpiConfig(csPin_, SHARED_SPI, clockHz_, &spi_));
+    if (!mounted_) return false;
+
+    const char* format = "FAT16";
+    if (sd_->fatType() == FAT_TYPE_EXFAT) format = "exFAT";
+    else if (sd_->fatType() == FAT_TYPE_FAT32) format = "FAT32";
+    snprintf(name_, sizeof(name_), "SdFat %s", format);
+    return true;
+}
+
+void SdFatBackend::end() {
+    VolumeLock lock(mutex_);
+    if (mounted_) sd_->end();
+    mounted_ = false;
+}
+
+bool SdFatBackend::exists(const char* path) {
+    VolumeLock lock(mutex_);
+    return mounted_ && sd_->exists(path);
+}
+
+bool SdFatBackend::mkdir(const char* path) {
+    VolumeLock lock(mutex_);
+    return mounted_ && sd_->mkdir(path, false); // Like SD.mkdir(): parents must exist
+}
+
+bool SdFatBackend::remove(const char* path) {
+    VolumeLock lock(mutex_);
+    return mounted_ && sd_->remove(path);
+}
+
+bool SdFatBackend::rename(const char* pathFrom, const char* pathTo) {
+    VolumeLock lock(mutex_);
+    return mounted_ && sd_->rename(pathFrom, pathTo);
+}
+
+std::unique_ptr<IStorageFile> SdFatBackend::open(const char* path, StorageMode mode) {
+    oflag_t flags = O_RDONLY;
+    if (mode == StorageMode::WRITE) flags = O_WRONLY | O_CREAT | O_TRUNC;
+    else if (mode == StorageMode::APPEND) flags = O_WRONLY | O_CREAT | O_APPEND;
+    else if (mode == StorageMode::UPDATE) flags = O_RDWR;
+
+    VolumeLock lock(mutex_);
+    if (!mounted_) return nullptr;
+    auto file = std::make_unique<SdFatFile>(mutex_, sd_->fatType() == FAT_TYPE_EXFAT, path);
+    if (!file->handle().open(sd_.get(), path, flags)) return nullptr;
+    return file;
+}
+
+uint64_t SdFatBackend::totalBytes() {
+    VolumeLock lock(mutex_);
+    if (!mounted_) return 0;
+    return (uint64_t)sd_->clusterCount() * sd_->bytesPerCluster();
+}
+
+uint64_t SdFatBackend::usedBytes() {
+    VolumeLock lock(mutex_);
+    if (!mounted_) return 0;
+    int32_t freeClusters = sd_->freeClusterCount();
+    if (freeClusters < 0) return 0;
+    return (uint64_t)(sd_->clusterCount() - (uint32_t)freeClusters) * sd_->bytesPerCluster();
+}
+
+uint32_t SdFatBackend::clusterSize() {
+    VolumeLock lock(mutex_);
+    return mounted_ ? sd_->bytesPerCluster() : 0;
+}
@@ -0,0 +1,294 @@
+#include "SdWriter.h"
+#include "SdCardManager.h"
+#include "Logger.h"
+#include "PerfStats.h"
+#include <algorithm>
+
+// Everything logged from here stays off the card (toFile = false): the log file is
+// itself written by this task, so a file log would only queue behind the failure.
+
+SdWriter& SdWriter::getInstance() {
+    static SdWriter instance;
+    return instance;
+}
+
+SdWriter::SdWriter() :
+    mutex_(xSemaphoreCreateMutex()),
+    taskHandle_(nullptr),
+    queue_(MAX_PENDING_BYTES, MAX_PENDING_FILES),
+    closeAllRequested_(false),
+    syncRequested_(false),
+    submittedSeq_(0),
+    durableSeq_(0),
+    suspended_(false),
+    droppedWrites_(0),
+    lastFlushMs_(0)
+{}
+
+bool SdWriter::append(const char* path, const void* data, size_t len) {
+    return enqueue(path, data, len, nullptr, 0, false);
+}
+
+bool SdWriter::appendRecord(const char* path, const void* header, size_t headerLen, const void* body, size_t bodyLen) {
+    return enqueue(path, header, headerLen, body, bodyLen, false);
+}
+
+bool SdWriter::appendLine(const char* path, const char* text) {
+    return enqueue(path, text, strlen(text), "\r\n", 2, false);
+}
+
+bool SdWriter::write(const char* path, const void* data, size_t len, size_t preallocateBytes) {
+    return enqueue(path, data, len, nullptr, 0, true, preallocateBytes);
+}
+
+bool SdWriter::writeAtomic(const char* path, const void* data, size_t len) {
+    return enqueue(path, data, len, nullptr, 0, true, 0, true);
+}
+
+bool SdWriter::enqueue(const char* path, const void* first, size_t firstLen, const void* second, size_t secondLen,
+                       bool truncate, size_t reserve, bool atomic) {
+    if (!path || !*path || !ensureTask()) {
+        droppedWrites_++;
+        return false;
+    }
+
+    std::string key(path);
+    unsigned long waitStart = millis();
+    for (;;) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        bool wasEmpty = queue_.empty();
+        bool queued = truncate ? queue_.replace(key, first, firstLen, reserve, atomic)
+                               : queue_.append(key, first, firstLen, second, secondLen);
+        if (queued) submittedSeq_++;
+        xSemaphoreGive(mutex_);
+
+        if (queued) {
+            // Only the first write into an empty queue wakes the worker; later ones ride along
+            // with it, which is what turns a burst of appends into one write per file.
+            if (wasEmpty) xTaskNotifyGive(taskHandle_);
+            return true;
+        }
+
+        // Full: give the worker a moment to drain, unless it can't (suspended) or we are it.
+        if (suspended_ || xTaskGetCurrentTaskHandle() == taskHandle_ || millis() - waitStart >= FULL_WAIT_MS) {
+            break;
+        }
+        xTaskNotifyGive(taskHandle_);
+        vTaskDelay(1);
+    }
+    droppedWrites_++;
+    return false;
+}
+
+bool SdWriter::sync(uint32_t timeoutMs) {
+    if (!taskHandle_) return true; // Nothing was ever queued
+    if (suspended_ || xTaskGetCurrentTaskHandle() == taskHandle_) return false;
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    uint32_t target = submittedSeq_;
+    syncRequested_ = true;
+    xSemaphoreGive(mutex_);
+    xTaskNotifyGive(taskHandle_);
+
+    unsigned long start = millis();
+    while ((int32_t)(durableSeq_ - target) < 0) {
+        if (millis() - start >= timeoutMs) {
+            LOG(LogLevel::WARN, "SD_WRITER", false, "sync() timed out after %lu ms.", (unsigned long)timeoutMs);
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    return true;
+}
+
+bool SdWriter::release(const char* path, uint32_t timeoutMs) {
+    if (!taskHandle_ || !path) return true;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    closeRequests_.push_back(path);
+    submittedSeq_++; // The close itself is what sync() below waits for
+    xSemaphoreGive(mutex_);
+    return sync(timeoutMs);
+}
+
+void SdWriter::suspend() {
+    if (!taskHandle_) {
+        suspended_ = true;
+        return;
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    suspended_ = true;
+    closeAllRequested_ = true;
+    xSemaphoreGive(mutex_);
+    xTaskNotifyGive(taskHandle_);
+
+    // The worker clears the flag once every handle is flushed and closed.
+    unsigned long start = millis();
+    while (closeAllRequested_ && millis() - start < SYNC_TIMEOUT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    if (closeAllRequested_) {
+        LOG(LogLevel::WARN, "SD_WRITER", false, "Suspend timed out with files still open.");
+    }
+}
+
+void SdWriter::resume() {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    suspended_ = false;
+    bool pending = !queue_.empty();
+    xSemaphoreGive(mutex_);
+    if (pending && taskHandle_) xTaskNotifyGive(taskHandle_);
+}
+
+bool SdWriter::ensureTask() {
+    if (taskHandle_) return true;
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (!taskHandle_ &&
+        xTaskCreatePinnedToCore(taskEntry, "SdWriter", TASK_STACK_SIZE, this, TASK_PRIORITY, &taskHandle_, TASK_CORE) != pdPASS) {
+        taskHandle_ = nullptr;
+    }
+    bool created = taskHandle_ != nullptr;
+    xSemaphoreGive(mutex_);
+
+    if (!created) {
+        LOG(LogLevel::ERROR, "SD_WRITER", false, "Failed to create SD writer task.");
+    }
+    return created;
+}
+
+void SdWriter::taskEntry(void* param) {
+    static_cast<SdWriter*>(param)->taskLoop();
+}
+
+void SdWriter::taskLoop() {
+    std::vector<std::string> closes;
+    uint32_t writtenSeq = 0; // Highest sequence written (not necessarily flushed)
+
+    for (;;) {
+        // Open handles need their periodic flush and idle close; otherwise sleep until woken.
+        ulTaskNotifyTake(pdTRUE, openFiles_.empty() ? portMAX_DELAY : pdMS_TO_TICKS(FLUSH_INTERVAL_MS));
+
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        bool suspended = suspended_;
+        bool closeAll = closeAllRequested_;
+        bool syncNow = syncRequested_;
+        uint32_t seq = submittedSeq_;
+        if (!suspended) {
+            queue_.takeAll(draining_);
+            closes.swap(closeRequests_);
+            syncRequested_ = false;
+        }
+        xSemaphoreGive(mutex_);
+
+        if (suspended) {
+            // Leave the queue alone; only honour the request to let go of the card.
+            if (closeAll) {
+                while (!openFiles_.empty()) closeHandle(openFiles_.size() - 1);
+                closeAllRequested_ = false;
+            }
+            continue;
+        }
+
+        // --- Drain: one write per file, however many appends were coalesced into it ---
+        for (auto& batch : draining_) {
+            if (batch.atomic) {
+                // Goes out as a whole new file, so any handle on the old one has to go first.
+                for (size_t i = 0; i < openFiles_.size(); ++i) {
+                    if (openFiles_[i].path == batch.path) { closeHandle(i); break; }
+                }
+                if (!SdCardManager::getInstance().writeFileAtomic(batch.path.c_str(), batch.data.data(), batch.data.size())) {
+                    droppedWrites_++;
+                }
+                continue;
+            }
+            File* file = handleFor(batch.path, batch.truncate, batch.reserve);
+            if (!file) {
+                LOG(LogLevel::ERROR, "SD_WRITER", false, "Dropping %u bytes: cannot open %s",
+                    (unsigned)batch.data.size(), batch.path.c_str());
+                droppedWrites_++;
+                continue;
+            }
+            size_t written = file->write((const uint8_t*)batch.data.data(), batch.data.size());
+            PerfStats::count(PerfCounter::SD_WRITE_BYTES, written);
+            openFiles_.back().dirty = true; // handleFor() always leaves the file it returns last
+            if (written != batch.data.size()) {
+                LOG(LogLevel::ERROR, "SD_WRITER", false, "Short write to %s (%u of %u bytes).",
+                    batch.path.c_str(), (unsigned)written, (unsigned)batch.data.size());
+                droppedWrites_++;
+            }
+            // A rewrite is a complete file: close it now so readers see all of it, not a prefix.
+            // A preallocated one is the head of a stream and stays open for what follows.
+            if (batch.truncate && !openFiles_.back().stream) closeHandle(openFiles_.size() - 1);
+        }
+        draining_.clear();
+        writtenSeq = seq;
+
+        unsigned long now = millis();
+        bool flushDue = syncNow || closeAll || !closes.empty() || now - lastFlushMs_ >= FLUSH_INTERVAL_MS;
+        if (flushDue) {
+            flushAll();
+            lastFlushMs_ = now;
+        }
+
+        // --- Close what was asked for, and whatever has gone quiet ---
+        for (size_t i = openFiles_.size(); i-- > 0;) {
+            bool requested = closeAll ||
+                std::find(closes.begin(), closes.end(), openFiles_[i].path) != closes.end();
+            bool idle = !openFiles_[i].stream && now - openFiles_[i].lastUsedMs >= IDLE_CLOSE_MS;
+            if (requested || idle) closeHandle(i);
+        }
+        closes.clear();
+        if (closeAll) closeAllRequested_ = false;
+
+        if (flushDue) durableSeq_ = writtenSeq;
+    }
+}
+
+File* SdWriter::handleFor(const std::string& path, bool truncate, size_t reserve) {
+    unsigned long now = millis();
+    for (size_t i = 0; i < openFiles_.size(); ++i) {
+        if (openFiles_[i].path != path) continue;
+        if (truncate) {
+            closeHandle(i); // Reopened below with FILE_WRITE
+            break;
+        }
+        // Keep the returned handle last so the caller can find it without a second lookup.
+        if (i != openFiles_.size() - 1) std::swap(openFiles_[i], openFiles_.back());
+        openFiles_.back().lastUsedMs = now;
+        return &openFiles_.back().file;
+    }
+
+    if (openFiles_.size() >= MAX_OPEN_FILES) {
+        // Oldest first, but a preallocated stream only if every handle is one.
+        size_t oldest = 0;
+        for (size_t i = 1; i < openFiles_.size(); ++i) {
+            const OpenFile& a = openFiles_[i];
+            const OpenFile& b = openFiles_[oldest];
+            if (a.stream != b.stream ? !a.stream : a.lastUsedMs < b.lastUsedMs) oldest = i;
+        }
+        closeHandle(oldest);
+    }
+
+    File file = truncate ? SdCardManager::getInstance().openFileUncached(path.c_str(), FILE_WRITE, reserve)
+                         : SdCardManager::getInstance().openFileUncached(path.c_str(), FILE_APPEND);
+    if (!file) return nullptr;
+    openFiles_.push_back({path, file, now, false, truncate && reserve > 0});
+    return &openFiles_.back().file;
+}
+
+void SdWriter::closeHandle(size_t index) {
+    OpenFile& entry = openFiles_[index];
+    entry.file.close();
+    // Lets SdCardManager cache the file again now that no writer holds it.
+    SdCardManager::getInstance().finishWrite(entry.path.c_str());
+    openFiles_.erase(openFiles_.begin() + index);
+}
+
+void SdWriter::flushAll() {
+    for (auto& entry : openFiles_) {
+        if (entry.dirty) {
+            entry.file.flush();
+            entry.dirty = false;
+        }
+    }
+}
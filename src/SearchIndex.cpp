@@ -0,0 +1,178 @@
+#include "SearchIndex.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring>
+
+static inline char foldCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+SearchIndex::SearchIndex() :
+    count_(0),
+    text_(nullptr),
+    offsets_(nullptr),
+    bucketStart_(nullptr),
+    postings_(nullptr),
+    lastQueryUs_(0)
+{}
+
+SearchIndex::~SearchIndex() {
+    clear();
+}
+
+void SearchIndex::clear() {
+    free(text_);
+    free(offsets_);
+    free(bucketStart_);
+    free(postings_);
+    text_ = nullptr;
+    offsets_ = nullptr;
+    bucketStart_ = nullptr;
+    postings_ = nullptr;
+    count_ = 0;
+    lastQuery_.clear();
+    results_.clear();
+    results_.shrink_to_fit();
+}
+
+uint32_t SearchIndex::trigramBucket(const char* s) {
+    uint32_t h = ((uint8_t)s[0] * 961u) + ((uint8_t)s[1] * 31u) + (uint8_t)s[2];
+    h ^= h >> 7;
+    return h & (BUCKET_COUNT - 1);
+}
+
+bool SearchIndex::build(size_t count, const std::function<std::string(size_t)>& labelFor) {
+    clear();
+    if (count > MAX_ITEMS) {
+        LOG(LogLevel::WARN, "SEARCH", "Indexing only the first %u of %u items.", (unsigned)MAX_ITEMS, (unsigned)count);
+        count = MAX_ITEMS;
+    }
+    if (count == 0) return true;
+
+    unsigned long startTime = millis();
+
+    // --- Pass 1: size the text blob ---
+    size_t textSize = 0;
+    for (size_t i = 0; i < count; ++i) {
+        textSize += labelFor(i).size() + 1;
+    }
+
+    text_ = (char*)ps_malloc(textSize);
+    offsets_ = (uint32_t*)ps_malloc(count * sizeof(uint32_t));
+    bucketStart_ = (uint32_t*)ps_malloc((BUCKET_COUNT + 1) * sizeof(uint32_t));
+    uint32_t* lastSeen = (uint32_t*)ps_malloc(BUCKET_COUNT * sizeof(uint32_t));
+    if (!text_ || !offsets_ || !bucketStart_ || !lastSeen) {
+        LOG(LogLevel::ERROR, "SEARCH", "ps_malloc failed indexing %u labels (%u bytes).", (unsigned)count, (unsigned)textSize);
+        free(lastSeen);
+        clear();
+        return false;
+    }
+
+    // --- Pass 2: copy lowercased labels and count distinct trigrams per item ---
+    memset(bucketStart_, 0, (BUCKET_COUNT + 1) * sizeof(uint32_t));
+    memset(lastSeen, 0xFF, BUCKET_COUNT * sizeof(uint32_t));
+    size_t pos = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::string label = labelFor(i);
+        if (pos + label.size() + 1 > textSize) break; // Label changed under us; stop rather than overrun
+        offsets_[i] = pos;
+        for (char c : label) text_[pos++] = foldCase(c);
+        text_[pos++] = '\0';
+        count_ = i + 1;
+
+        const char* s = text_ + offsets_[i];
+        for (size_t j = 0; j + 2 < label.size(); ++j) {
+            uint32_t b = trigramBucket(s + j);
+            if (lastSeen[b] != i) {
+                lastSeen[b] = i;
+                bucketStart_[b + 1]++;
+            }
+        }
+    }
+
+    for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+        bucketStart_[b + 1] += bucketStart_[b];
+    }
+
+    // --- Pass 3: fill the posting lists (item ids come out ascending) ---
+    size_t postingCount = bucketStart_[BUCKET_COUNT];
+    postings_ = (uint16_t*)ps_malloc(std::max<size_t>(postingCount, 1) * sizeof(uint16_t));
+    if (!postings_) {
+        LOG(LogLevel::ERROR, "SEARCH", "ps_malloc failed for %u postings.", (unsigned)postingCount);
+        free(lastSeen);
+        clear();
+        return false;
+    }
+
+    uint32_t* cursor = lastSeen; // Reused: dedupe is done, each bucket now needs a write position
+    memcpy(cursor, bucketStart_, BUCKET_COUNT * sizeof(uint32_t));
+    for (size_t i = 0; i < count_; ++i) {
+        const char* s = labelAt(i);
+        size_t len = strlen(s);
+        for (size_t j = 0; j + 2 < len; ++j) {
+            uint32_t b = trigramBucket(s + j);
+            // The list is ascending, so a repeat within this item is always the last entry written.
+            if (cursor[b] > bucketStart_[b] && postings_[cursor[b] - 1] == i) continue;
+            postings_[cursor[b]++] = (uint16_t)i;
+        }
+    }
+    free(lastSeen);
+
+    selectAll();
+    LOG(LogLevel::INFO, "SEARCH", "Indexed %u labels (%u text bytes, %u postings) in %lu ms.",
+        (unsigned)count_, (unsigned)textSize, (unsigned)postingCount, millis() - startTime);
+    return true;
+}
+
+void SearchIndex::selectAll() {
+    results_.resize(count_);
+    for (size_t i = 0; i < count_; ++i) results_[i] = (uint16_t)i;
+    lastQuery_.clear();
+}
+
+bool SearchIndex::matches(size_t index, const char* needle) const {
+    return strstr(labelAt(index), needle) != nullptr;
+}
+
+const std::vector<uint16_t>& SearchIndex::query(const char* text) {
+    unsigned long startTime = micros();
+
+    std::string needle;
+    for (const char* p = text ? text : ""; *p; ++p) needle += foldCase(*p);
+
+    if (needle == lastQuery_) {
+        // Nothing changed (e.g. a shift/layout key was pressed).
+    } else if (needle.empty() || count_ == 0) {
+        selectAll();
+    } else if (!lastQuery_.empty() && needle.size() > lastQuery_.size() &&
+               needle.compare(0, lastQuery_.size(), lastQuery_) == 0) {
+        // --- Typed ahead: every new match was already a match, so only narrow ---
+        const char* n = needle.c_str();
+        results_.erase(std::remove_if(results_.begin(), results_.end(),
+                                      [this, n](uint16_t id) { return !matches(id, n); }),
+                       results_.end());
+    } else if (needle.size() >= 3) {
+        // --- Fresh query: verify only the rarest trigram's posting list ---
+        uint32_t bestBucket = trigramBucket(needle.c_str());
+        for (size_t j = 1; j + 2 < needle.size(); ++j) {
+            uint32_t b = trigramBucket(needle.c_str() + j);
+            if (bucketStart_[b + 1] - bucketStart_[b] < bucketStart_[bestBucket + 1] - bucketStart_[bestBucket]) {
+                bestBucket = b;
+            }
+        }
+        results_.clear();
+        for (uint32_t p = bucketStart_[bestBucket]; p < bucketStart_[bestBucket + 1]; ++p) {
+            if (matches(postings_[p], needle.c_str())) results_.push_back(postings_[p]);
+        }
+    } else {
+        // --- One or two characters: too short for a trigram, scan every label ---
+        results_.clear();
+        for (size_t i = 0; i < count_; ++i) {
+            if (matches(i, needle.c_str())) results_.push_back((uint16_t)i);
+        }
+    }
+
+    lastQuery_ = needle;
+    lastQueryUs_ = micros() - startTime;
+    return results_;
+}
@@ -0,0 +1,75 @@
+#include "SearchListDataSource.h"
+#include "App.h"
+#include "ListMenu.h"
+#include "Event.h"
+#include "EventDispatcher.h"
+
+SearchListDataSource::SearchListDataSource() : source_(nullptr) {}
+
+bool SearchListDataSource::begin(App* app, IListMenuDataSource* source, const std::string& title) {
+    source_ = source;
+    int count = source->getNumberOfItems(app);
+    if (!index_.build(count, [source](size_t i) { return source->getItemLabel((int)i); })) {
+        source_ = nullptr;
+        app->showPopUp("Error", "Not enough memory to search.", nullptr, "OK", "", true);
+        return false;
+    }
+
+    TextInputMenu& textMenu = app->getTextInputMenu();
+    textMenu.configure("Search " + title,
+        [this](App* cb_app, const char* text) {
+            index_.query(text);
+            EventDispatcher::getInstance().publish(ReplaceMenuEvent(MenuType::SEARCH_RESULTS));
+        });
+    textMenu.setOnChange([this](App* cb_app, const char* text) -> std::string {
+        size_t matches = index_.query(text).size();
+        char hint[24];
+        snprintf(hint, sizeof(hint), "%u match%s", (unsigned)matches, matches == 1 ? "" : "es");
+        return hint;
+    });
+    EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::TEXT_INPUT));
+    return true;
+}
+
+int SearchListDataSource::toSourceIndex(int index) const {
+    const auto& results = index_.results();
+    if (index < 0 || index >= (int)results.size()) return -1;
+    return results[index];
+}
+
+int SearchListDataSource::getNumberOfItems(App* app) {
+    return source_ ? index_.results().size() : 0;
+}
+
+void SearchListDataSource::drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) {
+    int sourceIndex = toSourceIndex(index);
+    if (!source_ || sourceIndex < 0) return;
+    source_->drawItem(app, display, menu, sourceIndex, x, y, w, h, isSelected);
+}
+
+void SearchListDataSource::onItemSelected(App* app, ListMenu* menu, int index) {
+    int sourceIndex = toSourceIndex(index);
+    if (!source_ || sourceIndex < 0) return;
+    source_->onItemSelected(app, menu, sourceIndex);
+}
+
+void SearchListDataSource::onEnter(App* app, ListMenu* menu, bool isForwardNav) {}
+
+void SearchListDataSource::onExit(App* app, ListMenu* menu) {}
+
+bool SearchListDataSource::drawCustomEmptyMessage(App* app, U8G2& display) {
+    const char* msg = "No matches";
+    display.setFont(u8g2_font_6x10_tf);
+    display.drawStr((display.getDisplayWidth() - display.getStrWidth(msg)) / 2, 38, msg);
+    return true;
+}
+
+const MenuItem* SearchListDataSource::getItem(int index) const {
+    int sourceIndex = toSourceIndex(index);
+    return (source_ && sourceIndex >= 0) ? source_->getItem(sourceIndex) : nullptr;
+}
+
+std::string SearchListDataSource::getItemPrefetchPath(int index) const {
+    int sourceIndex = toSourceIndex(index);
+    return (source_ && sourceIndex >= 0) ? source_->getItemPrefetchPath(sourceIndex) : "";
+}
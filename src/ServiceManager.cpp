@@ -1,5 +1,6 @@
 #include "ServiceManager.h"
 #include "App.h"
+#include "PerfStats.h"
 
 ServiceManager::ServiceManager(App* app) : app_(app) {}
 
@@ -16,6 +17,7 @@ uint32_t ServiceManager::getTotalResourceRequirements() const {
 }
 
 void ServiceManager::loop() {
+    PerfStats::Scope perfScope(PerfMetric::SERVICES_US);
     for (auto const& [typeIndex, service] : services_) {
         service->loop();
     }
@@ -8,44 +8,49 @@
 #include "Logger.h"
 #include "BadMsgAttacker.h" // <-- FIX: Include the full definition of the class here.
 
+StationFileListDataSource::StationFileListDataSource() : loader_("StaListLoad") {}
+
 void StationFileListDataSource::setTargetAp(const WifiNetworkInfo& target) {
     targetAp_ = target;
 }
 
 void StationFileListDataSource::onEnter(App* app, ListMenu* menu, bool isForwardNav) {
-    fileNames_.clear();
-    filePaths_.clear();
-    const char* dirPath = SD_ROOT::DATA_CAPTURES_STATION_LISTS;
-    
-    File root = SdCardManager::getInstance().openFileUncached(dirPath);
-    if (!root || !root.isDirectory()) {
-        LOG(LogLevel::WARN, "STA_FILE_DS", "Station list directory not found.");
-        return;
-    }
+    files_.clear();
 
-    File file = root.openNextFile();
-    while(file) {
-        if (!file.isDirectory() && String(file.name()).endsWith(".txt")) {
-            filePaths_.push_back(file.path());
-            fileNames_.push_back(file.name());
+    // --- NEW: Walk the directory on a loader task; entries are picked up in onUpdate ---
+    loader_.start([](AsyncListLoader<FileEntry>& loader) {
+        const char* dirPath = SD_ROOT::DATA_CAPTURES_STATION_LISTS;
+        bool found = SdCardManager::getInstance().forEachDirEntry(dirPath, [&loader, dirPath](const SdCardManager::DirEntry& entry) {
+            if (entry.isDir || !String(entry.name.c_str()).endsWith(".txt")) return true;
+            return loader.push({entry.name, std::string(dirPath) + "/" + entry.name});
+        });
+        if (!found) {
+            LOG(LogLevel::WARN, "STA_FILE_DS", "Station list directory not found.");
         }
-        file.close();
-        file = root.openNextFile();
-    }
-    root.close();
+    });
 }
 
-void StationFileListDataSource::onExit(App* app, ListMenu* menu) {}
+void StationFileListDataSource::onUpdate(App* app, ListMenu* menu) {
+    loader_.drain(files_);
+}
+
+bool StationFileListDataSource::isLoading() const {
+    return loader_.isLoading();
+}
+
+void StationFileListDataSource::onExit(App* app, ListMenu* menu) {
+    loader_.cancel();
+}
 
 int StationFileListDataSource::getNumberOfItems(App* app) {
-    return fileNames_.size();
+    return files_.size();
 }
 
 void StationFileListDataSource::onItemSelected(App* app, ListMenu* menu, int index) {
-    if (index >= filePaths_.size()) return;
+    if (index >= files_.size()) return;
     
     app->getBadMsgAttacker().prepareAttack(BadMsgAttacker::AttackType::FROM_FILE);
-    if (app->getBadMsgAttacker().start(filePaths_[index], targetAp_)) {
+    if (app->getBadMsgAttacker().start(files_[index].path, targetAp_)) {
         EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::BAD_MSG_ACTIVE));
     } else {
         app->showPopUp("Error", "Failed to start attack from file.", nullptr, "OK", "", true);
@@ -53,9 +58,9 @@ void StationFileListDataSource::onItemSelected(App* app, ListMenu* menu, int ind
 }
 
 void StationFileListDataSource::drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) {
-    if (index >= fileNames_.size()) return;
+    if (index >= files_.size()) return;
 
-    const std::string& label = fileNames_[index];
+    const std::string& label = files_[index].name;
     display.setDrawColor(isSelected ? 0 : 1);
     
     char bssidStr[18];
@@ -5,6 +5,7 @@
 #include "EventDispatcher.h"
 #include "UI_Utils.h"
 #include "SdCardManager.h"
+#include "SdWriter.h"
 #include "Logger.h"
 
 StationSniffSaveMenu::StationSniffSaveMenu() : lastClientCount_(0) {}
@@ -44,19 +45,20 @@ void StationSniffSaveMenu::onExit(App* app) {
     char filePath[64];
     snprintf(filePath, sizeof(filePath), "%s/%s.txt", SD_ROOT::DATA_CAPTURES_STATION_LISTS, bssidStr);
 
-    File file = SdCardManager::getInstance().openFileUncached(filePath, FILE_WRITE);
-    if (!file) {
-        LOG(LogLevel::ERROR, "SNIFF_SAVE", "Failed to create station list file: %s", filePath);
-        app->showPopUp("Error", "Could not save file to SD.", nullptr, "OK", "", true);
-        return;
-    }
-
+    std::string content;
+    content.reserve(stations.size() * 19);
     for (const auto& station : stations) {
         char macStr[18];
         sprintf(macStr, "%02X:%02X:%02X:%02X:%02X:%02X", station.mac[0], station.mac[1], station.mac[2], station.mac[3], station.mac[4], station.mac[5]);
-        file.println(macStr);
+        content += macStr;
+        content += "\r\n";
+    }
+    // Written by the SD writer task; only a full queue is reported here.
+    if (!SdWriter::getInstance().write(filePath, content.data(), content.size())) {
+        LOG(LogLevel::ERROR, "SNIFF_SAVE", "Failed to queue station list file: %s", filePath);
+        app->showPopUp("Error", "Could not save file to SD.", nullptr, "OK", "", true);
+        return;
     }
-    file.close();
 
     char successMsg[64];
     snprintf(successMsg, sizeof(successMsg), "Saved %d clients to file.", stations.size());
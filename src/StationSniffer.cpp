@@ -1,6 +1,7 @@
 #include "StationSniffer.h"
 #include "App.h"
 #include "Logger.h"
+#include "PerfStats.h"
 #include <Arduino.h>
 #include <WiFi.h>
 #include "esp_wifi.h"
@@ -50,6 +51,7 @@ void StationSniffer::loop() {
 }
 
 void StationSniffer::packetHandlerCallback(void* buf, wifi_promiscuous_pkt_type_t type) {
+    PerfStats::count(PerfCounter::SNIFFER_PACKETS);
     if (instance_ && (type == WIFI_PKT_MGMT || type == WIFI_PKT_DATA)) {
         instance_->handlePacket(static_cast<wifi_promiscuous_pkt_t*>(buf));
     }
@@ -0,0 +1,355 @@
+#include "StorageBenchmark.h"
+#include "SdCardManager.h"
+#include "SdWriter.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <time.h>
+
+StorageBenchmark& StorageBenchmark::getInstance() {
+    static StorageBenchmark instance;
+    return instance;
+}
+
+StorageBenchmark::StorageBenchmark() :
+    state_(State::IDLE),
+    progress_(0),
+    result_(),
+    error_(""),
+    rng_(0)
+{}
+
+bool StorageBenchmark::begin() {
+    if (state_ == State::RUNNING) return false;
+    if (!SdCardManager::getInstance().isAvailable()) return fail("No SD card");
+
+    state_ = State::RUNNING;
+    progress_ = 0;
+    result_ = Result();
+    error_ = "";
+    rng_ = 0x9E3779B9;
+    return true;
+}
+
+bool StorageBenchmark::start() {
+    if (!begin()) return false;
+    if (xTaskCreatePinnedToCore(taskEntry, "SdBench", TASK_STACK_SIZE, this, TASK_PRIORITY, nullptr, TASK_CORE) != pdPASS) {
+        return fail("Task failed");
+    }
+    return true;
+}
+
+bool StorageBenchmark::runBlocking() {
+    return begin() && finish(run());
+}
+
+void StorageBenchmark::taskEntry(void* param) {
+    StorageBenchmark* self = static_cast<StorageBenchmark*>(param);
+    self->finish(self->run());
+    vTaskDelete(nullptr);
+}
+
+bool StorageBenchmark::finish(bool ok) {
+    if (!ok) return false; // fail() already set the state
+    const Result& r = result_;
+    LOG(LogLevel::INFO, "SD_BENCH", "%s: seq w/r %.2f/%.2f MB/s, rand w/r %.2f/%.2f MB/s, cached/uncached read %.2f/%.2f MB/s",
+        r.backend, r.seqWriteMBps, r.seqReadMBps, r.randWriteMBps, r.randReadMBps, r.cachedReadMBps, r.uncachedReadMBps);
+    LOG(LogLevel::INFO, "SD_BENCH", "Append p50/p95/p99/max %lu/%lu/%lu/%lu us; suggested buffers: read %lu B, write %lu B",
+        (unsigned long)r.appendP50Micros, (unsigned long)r.appendP95Micros, (unsigned long)r.appendP99Micros,
+        (unsigned long)r.appendMaxMicros, (unsigned long)r.readBufferBytes, (unsigned long)r.writeBufferBytes);
+    saveResult();
+    state_ = State::DONE;
+    return true;
+}
+
+bool StorageBenchmark::fail(const char* error) {
+    error_ = error;
+    state_ = State::FAILED;
+    LOG(LogLevel::ERROR, "SD_BENCH", "Benchmark failed: %s", error);
+    return false;
+}
+
+bool StorageBenchmark::run() {
+    strncpy(result_.backend, SdCardManager::getInstance().getBackendName(), sizeof(result_.backend) - 1);
+
+    // Internal RAM first: SPI can DMA from it directly.
+    uint8_t* buffer = (uint8_t*)malloc(CHUNK_SIZE);
+    if (!buffer) buffer = (uint8_t*)ps_malloc(CHUNK_SIZE);
+    if (!buffer) return fail("Out of memory");
+    for (size_t i = 0; i < CHUNK_SIZE; ++i) buffer[i] = (uint8_t)i;
+
+    // The random and sweep passes reuse the sequential file, which is only removed at the end.
+    bool ok = runSequential(buffer) && runRandom(buffer) && runSweep(buffer);
+    char path[48];
+    snprintf(path, sizeof(path), "%s/bench_seq.tmp", SD_ROOT::DATA);
+    SdCardManager::getInstance().deleteFile(path);
+
+    ok = ok && runAppends() && runCacheReads(buffer);
+    free(buffer);
+    return ok;
+}
+
+static float toMBps(size_t bytes, uint32_t micros) {
+    return micros ? (float)bytes / (float)micros : 0.0f; // bytes per microsecond == MB/s
+}
+
+bool StorageBenchmark::runSequential(uint8_t* buffer) {
+    SdCardManager::SdCardManagerAPI& sd = SdCardManager::getInstance();
+    char path[48];
+    snprintf(path, sizeof(path), "%s/bench_seq.tmp", SD_ROOT::DATA);
+
+    // --- Sequential write into a preallocated file ---
+    File file = sd.openFileUncached(path, FILE_WRITE, SEQ_BYTES);
+    if (!file) return fail("Cannot create file");
+    uint32_t start = micros();
+    size_t written = 0;
+    while (written < SEQ_BYTES) {
+        size_t n = file.write(buffer, CHUNK_SIZE);
+        if (n != CHUNK_SIZE) break;
+        written += n;
+        progress_ = (uint8_t)(written * 20 / SEQ_BYTES);
+    }
+    file.flush();
+    uint32_t elapsed = micros() - start;
+    file.close();
+    sd.finishWrite(path);
+    if (written < SEQ_BYTES) return fail("Write failed");
+    result_.seqWriteMBps = toMBps(written, elapsed);
+
+    // --- Sequential read of the same file ---
+    file = sd.openFileUncached(path, FILE_READ);
+    if (!file) return fail("Cannot reopen file");
+    start = micros();
+    size_t readBytes = 0;
+    while (readBytes < SEQ_BYTES) {
+        size_t n = file.read(buffer, CHUNK_SIZE);
+        if (n == 0) break;
+        readBytes += n;
+        progress_ = (uint8_t)(20 + readBytes * 10 / SEQ_BYTES);
+    }
+    elapsed = micros() - start;
+    file.close();
+    if (readBytes < SEQ_BYTES) return fail("Read failed");
+    result_.seqReadMBps = toMBps(readBytes, elapsed);
+    return true;
+}
+
+bool StorageBenchmark::runRandom(uint8_t* buffer) {
+    SdCardManager::SdCardManagerAPI& sd = SdCardManager::getInstance();
+    char path[48];
+    snprintf(path, sizeof(path), "%s/bench_seq.tmp", SD_ROOT::DATA);
+    const uint32_t blocks = SEQ_BYTES / RANDOM_BLOCK;
+    auto nextBlock = [this, blocks]() {
+        rng_ ^= rng_ << 13; // xorshift32
+        rng_ ^= rng_ >> 17;
+        rng_ ^= rng_ << 5;
+        return (uint64_t)(rng_ % blocks) * RANDOM_BLOCK;
+    };
+
+    // --- Random reads: a seek per block, the access pattern of a database or an index lookup ---
+    File file = sd.openFileUncached(path, FILE_READ);
+    if (!file) return fail("Cannot reopen file");
+    uint32_t start = micros();
+    size_t done = 0;
+    for (; done < RANDOM_OPS; ++done) {
+        if (!file.seek(nextBlock()) || file.read(buffer, RANDOM_BLOCK) != RANDOM_BLOCK) break;
+        progress_ = (uint8_t)(30 + (done + 1) * 7 / RANDOM_OPS);
+    }
+    uint32_t elapsed = micros() - start;
+    file.close();
+    if (done < RANDOM_OPS) return fail("Random read failed");
+    result_.randReadMBps = toMBps(RANDOM_OPS * RANDOM_BLOCK, elapsed);
+
+    // --- Random in-place writes, flushed once at the end ---
+    file = sd.openFileUncached(path, "r+");
+    if (!file) return fail("Cannot reopen file");
+    start = micros();
+    for (done = 0; done < RANDOM_OPS; ++done) {
+        if (!file.seek(nextBlock()) || file.write(buffer, RANDOM_BLOCK) != RANDOM_BLOCK) break;
+        progress_ = (uint8_t)(37 + (done + 1) * 8 / RANDOM_OPS);
+    }
+    file.flush();
+    elapsed = micros() - start;
+    file.close();
+    sd.finishWrite(path);
+    if (done < RANDOM_OPS) return fail("Random write failed");
+    result_.randWriteMBps = toMBps(RANDOM_OPS * RANDOM_BLOCK, elapsed);
+    return true;
+}
+
+bool StorageBenchmark::runSweep(uint8_t* buffer) {
+    SdCardManager::SdCardManagerAPI& sd = SdCardManager::getInstance();
+    char path[48];
+    snprintf(path, sizeof(path), "%s/bench_seq.tmp", SD_ROOT::DATA);
+
+    // 512 B up to CHUNK_SIZE. Each size gets a region of its own so no pass re-reads another's sectors.
+    static constexpr size_t SIZES = 6;
+    static_assert((512u << (SIZES - 1)) == CHUNK_SIZE && SIZES * SWEEP_BYTES <= SEQ_BYTES, "Sweep must fit the file");
+    float readMBps[SIZES];
+    float writeMBps[SIZES];
+
+    for (int pass = 0; pass < 2; ++pass) {
+        bool writing = pass == 1;
+        File file = sd.openFileUncached(path, writing ? "r+" : FILE_READ);
+        if (!file) return fail("Cannot reopen file");
+        for (size_t i = 0; i < SIZES; ++i) {
+            size_t size = 512u << i;
+            if (!file.seek(i * SWEEP_BYTES)) break;
+            uint32_t start = micros();
+            size_t moved = 0;
+            while (moved < SWEEP_BYTES) {
+                size_t n = writing ? file.write(buffer, size) : file.read(buffer, size);
+                if (n != size) break;
+                moved += n;
+            }
+            if (writing) file.flush();
+            uint32_t elapsed = micros() - start;
+            (writing ? writeMBps : readMBps)[i] = moved == SWEEP_BYTES ? toMBps(moved, elapsed) : 0.0f;
+            progress_ = (uint8_t)(45 + (pass * SIZES + i + 1) * 30 / (2 * SIZES));
+        }
+        file.close();
+        if (writing) sd.finishWrite(path);
+    }
+
+    // Buffers cost internal RAM, so suggest the smallest one that is nearly as fast as the best.
+    auto suggest = [](const float* mbps) {
+        float best = *std::max_element(mbps, mbps + SIZES);
+        for (size_t i = 0; i < SIZES; ++i) {
+            if (mbps[i] * 100.0f >= best * SUGGEST_PERCENT) return (uint32_t)(512u << i);
+        }
+        return (uint32_t)CHUNK_SIZE;
+    };
+    result_.readBufferBytes = suggest(readMBps);
+    result_.writeBufferBytes = suggest(writeMBps);
+    return true;
+}
+
+bool StorageBenchmark::runAppends() {
+    SdCardManager::SdCardManagerAPI& sd = SdCardManager::getInstance();
+    char path[48];
+    snprintf(path, sizeof(path), "%s/bench_append.tmp", SD_ROOT::DATA);
+
+    uint32_t* latencies = (uint32_t*)malloc(APPEND_COUNT * sizeof(uint32_t));
+    if (!latencies) return fail("Out of memory");
+
+    // Opened the way SdWriter opens a capture stream, then written one flushed record at a time.
+    File file = sd.openFileUncached(path, FILE_WRITE, APPEND_COUNT * APPEND_RECORD_SIZE);
+    if (!file) {
+        free(latencies);
+        return fail("Cannot create file");
+    }
+
+    uint8_t record[APPEND_RECORD_SIZE];
+    memset(record, 'k', sizeof(record));
+    uint64_t total = 0;
+    size_t done = 0;
+    for (; done < APPEND_COUNT; ++done) {
+        uint32_t start = micros();
+        if (file.write(record, sizeof(record)) != sizeof(record)) break;
+        file.flush();
+        latencies[done] = micros() - start;
+        total += latencies[done];
+        progress_ = (uint8_t)(75 + (done + 1) * 15 / APPEND_COUNT);
+    }
+    file.close();
+    sd.finishWrite(path);
+    sd.deleteFile(path);
+    if (done < APPEND_COUNT) {
+        free(latencies);
+        return fail("Append failed");
+    }
+
+    // The tail is what matters for a capture: one slow flush is a burst of dropped frames.
+    std::sort(latencies, latencies + APPEND_COUNT);
+    auto percentile = [latencies](size_t p) { return latencies[std::min(APPEND_COUNT - 1, APPEND_COUNT * p / 100)]; };
+    result_.appendAvgMicros = (uint32_t)(total / APPEND_COUNT);
+    result_.appendP50Micros = percentile(50);
+    result_.appendP95Micros = percentile(95);
+    result_.appendP99Micros = percentile(99);
+    result_.appendMaxMicros = latencies[APPEND_COUNT - 1];
+    free(latencies);
+    return true;
+}
+
+bool StorageBenchmark::runCacheReads(uint8_t* buffer) {
+    SdCardManager::SdCardManagerAPI& sd = SdCardManager::getInstance();
+    char path[48];
+    snprintf(path, sizeof(path), "%s/bench_cache.tmp", SD_ROOT::DATA);
+
+    File file = sd.openFileUncached(path, FILE_WRITE);
+    if (!file) return fail("Cannot create file");
+    size_t written = 0;
+    while (written < CACHE_FILE_BYTES) {
+        size_t n = file.write(buffer, std::min(CHUNK_SIZE, CACHE_FILE_BYTES - written));
+        if (n == 0) break;
+        written += n;
+    }
+    file.close();
+    sd.finishWrite(path); // Cacheable again from here on
+    if (written < CACHE_FILE_BYTES) {
+        sd.deleteFile(path);
+        return fail("Write failed");
+    }
+
+    // --- Through SdCardManager::open(): the first pass admits the file, the timed ones hit PSRAM ---
+    size_t cachedBytes = 0;
+    uint32_t elapsed = 0;
+    for (int pass = 0; pass <= CACHE_READ_PASSES; ++pass) {
+        uint32_t start = micros();
+        auto reader = sd.open(path);
+        size_t bytes = 0;
+        std::string_view slice;
+        while (reader && reader->readSlice(slice)) bytes += slice.size();
+        if (pass == 0) continue;
+        elapsed += micros() - start;
+        cachedBytes += bytes;
+    }
+    result_.cachedReadMBps = toMBps(cachedBytes, elapsed);
+    progress_ = 95;
+
+    // --- The same bytes straight off the card ---
+    size_t uncachedBytes = 0;
+    elapsed = 0;
+    for (int pass = 0; pass < CACHE_READ_PASSES; ++pass) {
+        uint32_t start = micros();
+        file = sd.openFileUncached(path, FILE_READ);
+        size_t n;
+        while (file && (n = file.read(buffer, CHUNK_SIZE)) > 0) uncachedBytes += n;
+        file.close();
+        elapsed += micros() - start;
+    }
+    result_.uncachedReadMBps = toMBps(uncachedBytes, elapsed);
+    sd.deleteFile(path);
+
+    if (cachedBytes < CACHE_READ_PASSES * CACHE_FILE_BYTES || uncachedBytes < CACHE_READ_PASSES * CACHE_FILE_BYTES) {
+        return fail("Read failed");
+    }
+    progress_ = 100;
+    return true;
+}
+
+void StorageBenchmark::saveResult() {
+    char path[48];
+    snprintf(path, sizeof(path), "%s/%s", SD_ROOT::DATA_LOGS, RESULTS_FILENAME);
+    SdWriter& writer = SdWriter::getInstance();
+    if (!SdCardManager::getInstance().exists(path)) {
+        writer.appendLine(path, "time,backend,seq_write_mbps,seq_read_mbps,rand_write_mbps,rand_read_mbps,"
+                                "cached_read_mbps,uncached_read_mbps,append_avg_us,append_p50_us,append_p95_us,"
+                                "append_p99_us,append_max_us,read_buffer,write_buffer");
+    }
+
+    char timestamp[20] = "";
+    time_t now = time(nullptr);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
+
+    const Result& r = result_;
+    char line[256];
+    snprintf(line, sizeof(line), "%s,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+             timestamp, r.backend, r.seqWriteMBps, r.seqReadMBps, r.randWriteMBps, r.randReadMBps,
+             r.cachedReadMBps, r.uncachedReadMBps, (unsigned long)r.appendAvgMicros,
+             (unsigned long)r.appendP50Micros, (unsigned long)r.appendP95Micros, (unsigned long)r.appendP99Micros,
+             (unsigned long)r.appendMaxMicros, (unsigned long)r.readBufferBytes, (unsigned long)r.writeBufferBytes);
+    writer.appendLine(path, line);
+}
@@ -0,0 +1,141 @@
+#include "StorageBenchmarkMenu.h"
+#include "StorageBenchmark.h"
+#include "App.h"
+#include "Event.h"
+#include "EventDispatcher.h"
+#include "UI_Utils.h"
+#include <algorithm>
+
+StorageBenchmarkMenu::StorageBenchmarkMenu() : scrollOffset_(0) {}
+
+void StorageBenchmarkMenu::onEnter(App* app, bool isForwardNav) {
+    EventDispatcher::getInstance().subscribe(EventType::APP_INPUT, this);
+    // A run left going when the menu was closed is simply picked up again.
+    if (isForwardNav && StorageBenchmark::getInstance().getState() != StorageBenchmark::State::RUNNING) {
+        scrollOffset_ = 0;
+        StorageBenchmark::getInstance().start();
+    }
+}
+
+void StorageBenchmarkMenu::onUpdate(App* app) {
+    if (StorageBenchmark::getInstance().getState() == StorageBenchmark::State::RUNNING) {
+        app->requestRedraw(); // Keep the progress bar moving
+    }
+}
+
+void StorageBenchmarkMenu::onExit(App* app) {
+    EventDispatcher::getInstance().unsubscribe(EventType::APP_INPUT, this);
+}
+
+void StorageBenchmarkMenu::handleInput(InputEvent event, App* app) {
+    switch (event) {
+        case InputEvent::BTN_OK_PRESS:
+        case InputEvent::BTN_ENCODER_PRESS:
+            if (StorageBenchmark::getInstance().start()) {
+                scrollOffset_ = 0;
+                app->requestRedraw();
+            }
+            break;
+        case InputEvent::ENCODER_CW:
+        case InputEvent::BTN_DOWN_PRESS:
+            if (scrollOffset_ < RESULT_ROWS - VISIBLE_ROWS) {
+                scrollOffset_++;
+                app->requestRedraw();
+            }
+            break;
+        case InputEvent::ENCODER_CCW:
+        case InputEvent::BTN_UP_PRESS:
+            if (scrollOffset_ > 0) {
+                scrollOffset_--;
+                app->requestRedraw();
+            }
+            break;
+        case InputEvent::BTN_BACK_PRESS:
+            EventDispatcher::getInstance().publish(NavigateBackEvent());
+            break;
+        default:
+            break;
+    }
+}
+
+void StorageBenchmarkMenu::draw(App* app, U8G2& display) {
+    StorageBenchmark& bench = StorageBenchmark::getInstance();
+    const int width = display.getDisplayWidth();
+
+    display.setFont(u8g2_font_6x10_tf);
+
+    switch (bench.getState()) {
+        case StorageBenchmark::State::RUNNING: {
+            const char* msg = "Testing SD card...";
+            display.drawStr((width - display.getStrWidth(msg)) / 2, 30, msg);
+            display.drawFrame(14, 38, 100, 8);
+            display.drawBox(14, 38, bench.getProgress(), 8);
+            return;
+        }
+        case StorageBenchmark::State::FAILED: {
+            const char* msg = bench.getError();
+            display.drawStr((width - display.getStrWidth(msg)) / 2, 34, msg);
+            break;
+        }
+        case StorageBenchmark::State::DONE: {
+            const StorageBenchmark::Result& r = bench.getResult();
+            char line[32];
+            display.setFont(u8g2_font_5x7_tf);
+            display.drawStr((width - display.getStrWidth(r.backend)) / 2, STATUS_BAR_H + 9, r.backend);
+
+            const int labelX = 6;
+            const int valueX = 122;
+            int index = 0;
+            int y = STATUS_BAR_H + 19;
+            auto row = [&](const char* label, const char* value) {
+                if (index >= scrollOffset_ && index < scrollOffset_ + VISIBLE_ROWS) {
+                    display.drawStr(labelX, y, label);
+                    display.drawStr(valueX - display.getStrWidth(value), y, value);
+                    y += 9;
+                }
+                index++;
+            };
+            auto throughput = [&](const char* label, float value) {
+                snprintf(line, sizeof(line), "%.2f MB/s", value);
+                row(label, line);
+            };
+            auto latency = [&](const char* label, uint32_t us) {
+                snprintf(line, sizeof(line), "%.2f ms", us / 1000.0f);
+                row(label, line);
+            };
+            auto bufferSize = [&](const char* label, uint32_t value) {
+                if (value >= 1024) snprintf(line, sizeof(line), "%lu KB", (unsigned long)(value / 1024));
+                else snprintf(line, sizeof(line), "%lu B", (unsigned long)value);
+                row(label, line);
+            };
+            throughput("Seq write", r.seqWriteMBps);
+            throughput("Seq read", r.seqReadMBps);
+            throughput("Rand write", r.randWriteMBps);
+            throughput("Rand read", r.randReadMBps);
+            throughput("Cached read", r.cachedReadMBps);
+            throughput("Uncached read", r.uncachedReadMBps);
+            latency("Append avg", r.appendAvgMicros);
+            latency("Append p50", r.appendP50Micros);
+            latency("Append p95", r.appendP95Micros);
+            latency("Append p99", r.appendP99Micros);
+            latency("Append max", r.appendMaxMicros);
+            bufferSize("Read buffer", r.readBufferBytes);
+            bufferSize("Write buffer", r.writeBufferBytes);
+
+            // Scrollbar
+            const int barTop = STATUS_BAR_H + 12;
+            const int barH = 63 - barTop;
+            const int thumbH = std::max(5, barH * VISIBLE_ROWS / RESULT_ROWS);
+            const int thumbY = barTop + (barH - thumbH) * scrollOffset_ / (RESULT_ROWS - VISIBLE_ROWS);
+            display.drawFrame(126, barTop, 2, barH);
+            display.drawBox(126, thumbY, 2, thumbH);
+            return;
+        }
+        default:
+            break;
+    }
+
+    display.setFont(u8g2_font_5x8_t_cyrillic);
+    const char* instruction = "Press OK to run";
+    display.drawStr((width - display.getStrWidth(instruction)) / 2, 60, instruction);
+}
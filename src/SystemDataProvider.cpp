@@ -42,10 +42,10 @@ void SystemDataProvider::updateData() {
         psramUsage_ = {0, 0, 0};
     }
 
-    // SD Card
+    // SD Card (both figures are kept by SdCardManager; nothing here touches the card)
     if (SdCardManager::getInstance().isAvailable()) {
-        sdCardUsage_.total = SD.cardSize();
-        sdCardUsage_.used = SD.usedBytes();
+        sdCardUsage_.total = SdCardManager::getInstance().getTotalBytes();
+        sdCardUsage_.used = SdCardManager::getInstance().getUsedBytes();
         sdCardUsage_.percentage = (sdCardUsage_.total > 0) ? (uint8_t)((sdCardUsage_.used * 100) / sdCardUsage_.total) : 0;
     } else {
         sdCardUsage_ = {0, 0, 0};
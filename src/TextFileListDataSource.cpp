@@ -0,0 +1,83 @@
+#include "TextFileListDataSource.h"
+#include "App.h"
+#include "SdCardManager.h"
+#include "ListMenu.h"
+#include "UI_Utils.h"
+#include "Event.h"
+#include "EventDispatcher.h"
+#include "Logger.h"
+
+namespace {
+
+    struct TextDir {
+        const char* path;
+        const char* suffix; // "" for any file
+        bool isLog;
+    };
+
+    // Logs first: .klog session logs, and .txt ones from older firmware.
+    constexpr TextDir TEXT_DIRS[] = {
+        {SD_ROOT::DATA_LOGS, "", true},
+        {SD_ROOT::DATA_PROBES, ".txt", false},
+        {SD_ROOT::DATA_CAPTURES_STATION_LISTS, ".txt", false},
+    };
+
+    bool endsWith(const std::string& name, const char* suffix) {
+        size_t len = strlen(suffix);
+        return name.size() >= len && name.compare(name.size() - len, len, suffix) == 0;
+    }
+
+} // namespace
+
+TextFileListDataSource::TextFileListDataSource() : loader_("TextListLoad") {}
+
+void TextFileListDataSource::onEnter(App* app, ListMenu* menu, bool isForwardNav) {
+    files_.clear();
+
+    loader_.start([](AsyncListLoader<FileEntry>& loader) {
+        for (const TextDir& dir : TEXT_DIRS) {
+            bool keepGoing = true;
+            SdCardManager::getInstance().forEachDirEntry(dir.path, [&](const SdCardManager::DirEntry& entry) {
+                if (entry.isDir || !endsWith(entry.name, dir.suffix)) return true;
+                keepGoing = loader.push({entry.name, std::string(dir.path) + "/" + entry.name, dir.isLog});
+                return keepGoing;
+            });
+            if (!keepGoing) return; // Cancelled
+        }
+    });
+}
+
+void TextFileListDataSource::onUpdate(App* app, ListMenu* menu) {
+    loader_.drain(files_);
+}
+
+bool TextFileListDataSource::isLoading() const {
+    return loader_.isLoading();
+}
+
+void TextFileListDataSource::onExit(App* app, ListMenu* menu) {
+    loader_.cancel();
+}
+
+int TextFileListDataSource::getNumberOfItems(App* app) {
+    return files_.size();
+}
+
+void TextFileListDataSource::onItemSelected(App* app, ListMenu* menu, int index) {
+    if (index >= (int)files_.size()) return;
+    app->getTextViewerMenu().setFile(files_[index].path);
+    EventDispatcher::getInstance().publish(NavigateToMenuEvent(MenuType::TEXT_VIEWER));
+}
+
+void TextFileListDataSource::drawItem(App* app, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) {
+    if (index >= (int)files_.size()) return;
+
+    display.setDrawColor(isSelected ? 0 : 1);
+    drawCustomIcon(display, x + 4, y + (h - IconSize::LARGE_HEIGHT) / 2, files_[index].isLog ? IconType::INFO : IconType::SD_CARD);
+
+    int text_x = x + 4 + IconSize::LARGE_WIDTH + 4;
+    int text_y = y + h / 2 + 4;
+    int text_w = w - (text_x - x) - 4;
+
+    menu->updateAndDrawText(display, files_[index].name.c_str(), text_x, text_y, text_w, isSelected);
+}
@@ -7,6 +7,7 @@
 
 TextInputMenu::TextInputMenu() : 
     onSubmit_(nullptr), 
+    onChange_(nullptr),
     maskInput_(false),
     cursorPosition_(0),
     currentLayer_(KeyboardLayer::LOWERCASE),
@@ -20,6 +21,8 @@ TextInputMenu::TextInputMenu() :
 void TextInputMenu::configure(std::string title, OnSubmitCallback callback, bool maskInput, const char* initial_text) {
     title_ = title;
     onSubmit_ = callback;
+    onChange_ = nullptr;
+    hint_.clear();
     maskInput_ = maskInput;
     
     memset(inputBuffer_, 0, sizeof(inputBuffer_));
@@ -29,12 +32,24 @@ void TextInputMenu::configure(std::string title, OnSubmitCallback callback, bool
     cursorPosition_ = strlen(inputBuffer_);
 }
 
+void TextInputMenu::setOnChange(OnChangeCallback callback) {
+    onChange_ = callback;
+    hint_.clear();
+}
+
+void TextInputMenu::notifyChange(App* app) {
+    if (!onChange_) return;
+    hint_ = onChange_(app, inputBuffer_);
+    app->requestRedraw();
+}
+
 void TextInputMenu::onEnter(App* app, bool isForwardNav) {
     EventDispatcher::getInstance().subscribe(EventType::APP_INPUT, this);
     currentLayer_ = KeyboardLayer::LOWERCASE;
     capsLock_ = false;
     focusRow_ = 0;
     focusCol_ = 0;
+    notifyChange(app); // Hint for the initial text
 }
 
 void TextInputMenu::onUpdate(App* app) {}
@@ -43,6 +58,8 @@ void TextInputMenu::onExit(App* app) {
     EventDispatcher::getInstance().unsubscribe(EventType::APP_INPUT, this);
     memset(inputBuffer_, 0, sizeof(inputBuffer_));
     onSubmit_ = nullptr;
+    onChange_ = nullptr;
+    hint_.clear();
 }
 
 void TextInputMenu::handleInput(InputEvent event, App* app) {
@@ -79,6 +96,7 @@ void TextInputMenu::handleInput(InputEvent event, App* app) {
                     }
                 } else {
                     processKeyPress(key.value);
+                    notifyChange(app);
                 }
             }
             break;
@@ -223,6 +241,9 @@ void TextInputMenu::draw(App* app, U8G2& display) {
         }
 
         display.setFont(u8g2_font_5x7_tf);
+        if (!hint_.empty()) {
+            display.drawStr((display.getDisplayWidth() - display.getStrWidth(hint_.c_str())) / 2, 53, hint_.c_str());
+        }
         display.drawStr((display.getDisplayWidth() - display.getStrWidth("Use aux for keyboard"))/2, 62, "Use aux for keyboard");
     }
 }
@@ -0,0 +1,260 @@
+#include "TextPager.h"
+#include "BinaryLog.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+    constexpr size_t KLOG_HEADER_SIZE = sizeof(BinaryLog::FILE_MAGIC) + 1; // Magic and version
+
+    char levelChar(uint8_t level) {
+        static const char LEVELS[] = "DIWE"; // LogLevel order
+        return level < sizeof(LEVELS) - 1 ? LEVELS[level] : '?';
+    }
+
+    // Appends `c` as the display shows it; false once the line is full.
+    bool appendChar(std::string& line, uint8_t c) {
+        if (line.size() >= TextPager::MAX_LINE_CHARS) return false;
+        if (c == '\t') c = ' ';
+        else if (c < 0x20 || c == 0x7F) c = '.';
+        line.push_back((char)c);
+        return true;
+    }
+
+} // namespace
+
+TextPager::TextPager(std::unique_ptr<Source> source) :
+    source_(std::move(source)),
+    size_(0),
+    format_(Format::TEXT),
+    stats_{},
+    scanPos_(0),
+    lines_(0),
+    indexed_(false),
+    lineOpen_(false),
+    scanMillis_(0)
+{}
+
+bool TextPager::open() {
+    if (!source_) return false;
+    size_ = source_->size();
+    chunk_.resize(CHUNK_SIZE);
+
+    uint8_t header[KLOG_HEADER_SIZE];
+    size_t n = read(0, header, sizeof(header));
+    if (size_ > 0 && n == 0) return false;
+    if (n == sizeof(header) && memcmp(header, BinaryLog::FILE_MAGIC, sizeof(BinaryLog::FILE_MAGIC)) == 0 &&
+        header[sizeof(BinaryLog::FILE_MAGIC)] == BinaryLog::FILE_VERSION) {
+        format_ = Format::KLOG;
+        scanPos_ = KLOG_HEADER_SIZE;
+        epochs_.emplace_back(); // Strings defined before any FRAME_SYNC
+    }
+    addCheckpoint(scanPos_);
+    return true;
+}
+
+uint8_t TextPager::getIndexPercent() const {
+    if (indexed_ || size_ == 0) return 100;
+    return (uint8_t)(scanPos_ * 100 / size_);
+}
+
+size_t TextPager::read(uint64_t offset, uint8_t* buf, size_t len) {
+    if (offset >= size_) return 0;
+    if (len > size_ - offset) len = size_ - offset;
+    size_t n = source_->readAt(offset, buf, len);
+    stats_.reads++;
+    stats_.bytesRead += n;
+    return n;
+}
+
+void TextPager::addCheckpoint(uint64_t offset) {
+    uint32_t epoch = epochs_.empty() ? 0 : epochs_.size() - 1;
+    checkpoints_.push_back({offset, scanMillis_, epoch});
+}
+
+size_t TextPager::frameSize(const uint8_t* buf, size_t avail, size_t& headerLen, uint64_t& payloadLen) {
+    if (avail < 2) return 0;
+    size_t varintLen = BinaryLog::getVarint(buf + 1, avail - 1, payloadLen);
+    if (varintLen == 0) return 0;
+    headerLen = 1 + varintLen;
+    if (payloadLen > avail - headerLen) return 0;
+    return headerLen + payloadLen;
+}
+
+// --- Index ---
+
+bool TextPager::indexStep() {
+    if (indexed_ || !source_) return false;
+    size_t n = read(scanPos_, chunk_.data(), chunk_.size());
+    bool more = (n > 0) && (format_ == Format::KLOG ? indexKlogChunk(n) : indexTextChunk(n));
+    if (!more) {
+        if (lineOpen_) lines_++; // A last line with no newline
+        lineOpen_ = false;
+        indexed_ = true;
+    }
+    return more;
+}
+
+uint32_t TextPager::ensureLines(uint32_t lineCount) {
+    while (lines_ < lineCount && indexStep()) {}
+    return lines_;
+}
+
+bool TextPager::indexTextChunk(size_t n) {
+    const uint8_t* buf = chunk_.data();
+    for (size_t i = 0; i < n; ++i) {
+        if (buf[i] != '\n') {
+            lineOpen_ = true;
+            continue;
+        }
+        lineOpen_ = false;
+        if (++lines_ % STRIDE == 0) addCheckpoint(scanPos_ + i + 1);
+    }
+    scanPos_ += n;
+    return true;
+}
+
+bool TextPager::indexKlogChunk(size_t n) {
+    const uint8_t* buf = chunk_.data();
+    bool atEnd = scanPos_ + n >= size_;
+    size_t pos = 0;
+    while (pos < n) {
+        uint8_t type = buf[pos];
+        if (type == 0) return false; // The zeroed, preallocated tail
+        size_t headerLen;
+        uint64_t payloadLen;
+        size_t frameLen = frameSize(buf + pos, n - pos, headerLen, payloadLen);
+        if (frameLen == 0) {
+            // Cut by the chunk: read again from this frame. One that fills a whole chunk, or is
+            // cut by the end of the file, is damage; the log stops there as the decoder's does.
+            if (atEnd || pos == 0) return false;
+            break;
+        }
+        const uint8_t* payload = buf + pos + headerLen;
+
+        if (type == BinaryLog::FRAME_STRING) {
+            uint64_t index;
+            size_t indexLen = BinaryLog::getVarint(payload, payloadLen, index);
+            std::vector<std::string>& strings = epochs_.back();
+            if (indexLen > 0 && index < 0x10000) {
+                if (index >= strings.size()) strings.resize(index + 1);
+                strings[index].assign((const char*)payload + indexLen, payloadLen - indexLen);
+            }
+        } else if (type == BinaryLog::FRAME_SYNC) {
+            epochs_.emplace_back();
+            scanMillis_ = 0;
+        } else if (type == BinaryLog::FRAME_MESSAGE) {
+            if (lines_ > 0 && lines_ % STRIDE == 0) addCheckpoint(scanPos_ + pos);
+            uint64_t delta = 0;
+            if (payloadLen > 1) BinaryLog::getVarint(payload + 1, payloadLen - 1, delta);
+            scanMillis_ += (uint32_t)delta;
+            lines_++;
+        } else {
+            return false; // Unknown frame type
+        }
+        pos += frameLen;
+    }
+    scanPos_ += pos;
+    return true;
+}
+
+// --- Pages ---
+
+size_t TextPager::getLines(uint32_t first, size_t count, std::vector<std::string>& out) {
+    out.clear();
+    if (!source_ || count == 0) return 0;
+    ensureLines(first + count);
+    if (first >= lines_) return 0;
+    if (count > lines_ - first) count = lines_ - first;
+
+    const Checkpoint& from = checkpoints_[first / STRIDE];
+    uint32_t skip = first % STRIDE;
+    return format_ == Format::KLOG ? readKlogLines(from, skip, count, out)
+                                   : readTextLines(from, skip, count, out);
+}
+
+size_t TextPager::readTextLines(const Checkpoint& from, uint32_t skip, size_t count, std::vector<std::string>& out) {
+    uint64_t offset = from.offset;
+    std::string line;
+    while (out.size() < count) {
+        size_t n = read(offset, chunk_.data(), chunk_.size());
+        if (n == 0) break;
+        for (size_t i = 0; i < n && out.size() < count; ++i) {
+            uint8_t c = chunk_[i];
+            if (c == '\n') {
+                if (skip > 0) skip--;
+                else out.push_back(std::move(line));
+                line.clear();
+            } else if (skip == 0 && c != '\r') {
+                appendChar(line, c);
+            }
+        }
+        offset += n;
+    }
+    if (out.size() < count && skip == 0) out.push_back(std::move(line)); // The file ends without a newline
+    return out.size();
+}
+
+size_t TextPager::readKlogLines(const Checkpoint& from, uint32_t skip, size_t count, std::vector<std::string>& out) {
+    uint64_t offset = from.offset;
+    uint32_t millis = from.millis;
+    uint32_t epoch = from.epoch;
+    std::string line;
+    while (out.size() < count) {
+        size_t n = read(offset, chunk_.data(), chunk_.size());
+        size_t pos = 0;
+        while (pos < n && out.size() < count) {
+            size_t headerLen;
+            uint64_t payloadLen;
+            size_t frameLen = frameSize(chunk_.data() + pos, n - pos, headerLen, payloadLen);
+            if (frameLen == 0) break;
+            uint8_t type = chunk_[pos];
+            const uint8_t* payload = chunk_.data() + pos + headerLen;
+            if (type == BinaryLog::FRAME_SYNC) {
+                if (epoch + 1 < epochs_.size()) epoch++;
+                millis = 0;
+            } else if (type == BinaryLog::FRAME_MESSAGE) {
+                if (skip > 0) {
+                    uint64_t delta = 0;
+                    if (payloadLen > 1) BinaryLog::getVarint(payload + 1, payloadLen - 1, delta);
+                    millis += (uint32_t)delta;
+                    skip--;
+                } else {
+                    renderMessage(payload, payloadLen, millis, epoch, line);
+                    out.push_back(std::move(line));
+                }
+            }
+            pos += frameLen;
+        }
+        if (pos == 0) break; // Nothing parseable: only indexed lines are asked for, so the file changed
+        offset += pos;
+    }
+    return out.size();
+}
+
+void TextPager::renderMessage(const uint8_t* payload, size_t len, uint32_t& millis, uint32_t epoch, std::string& out) {
+    uint64_t delta = 0, formatIndex = 0, tagIndex = 0;
+    size_t pos = 1;
+    size_t used;
+    if (len > pos && (used = BinaryLog::getVarint(payload + pos, len - pos, delta))) pos += used;
+    if (len > pos && (used = BinaryLog::getVarint(payload + pos, len - pos, formatIndex))) pos += used;
+    if (len > pos && (used = BinaryLog::getVarint(payload + pos, len - pos, tagIndex))) pos += used;
+    millis += (uint32_t)delta;
+
+    const std::vector<std::string>& strings = epochs_[epoch];
+    char formatFallback[24], tagFallback[24];
+    const char* format = formatFallback;
+    const char* tag = tagFallback;
+    if (formatIndex < strings.size() && !strings[formatIndex].empty()) format = strings[formatIndex].c_str();
+    else snprintf(formatFallback, sizeof(formatFallback), "<format %u>", (unsigned)formatIndex);
+    if (tagIndex < strings.size() && !strings[tagIndex].empty()) tag = strings[tagIndex].c_str();
+    else snprintf(tagFallback, sizeof(tagFallback), "<tag %u>", (unsigned)tagIndex);
+
+    char text[MAX_LINE_CHARS + 1];
+    int prefix = snprintf(text, sizeof(text), "%lu [%c] [%s] ", (unsigned long)millis, levelChar(payload[0]), tag);
+    size_t textLen = (prefix < 0) ? 0 : ((size_t)prefix < sizeof(text) ? (size_t)prefix : sizeof(text) - 1);
+    if (pos <= len) textLen += BinaryLog::render(text + textLen, sizeof(text) - textLen, format, payload + pos, len - pos);
+
+    out.clear();
+    for (size_t i = 0; i < textLen && appendChar(out, (uint8_t)text[i]); ++i) {}
+}
@@ -0,0 +1,242 @@
+#include "TextViewerMenu.h"
+#include "App.h"
+#include "Event.h"
+#include "EventDispatcher.h"
+#include "Logger.h"
+#include "SdCardManager.h"
+#include "UI_Utils.h"
+#include <algorithm>
+
+namespace {
+
+    // TextPager::Source on a File from openFileUncached(): every read goes to the card.
+    class UncachedFileSource : public TextPager::Source {
+    public:
+        explicit UncachedFileSource(File file) : file_(file) {}
+        ~UncachedFileSource() override { file_.close(); }
+
+        size_t readAt(uint64_t offset, uint8_t* buf, size_t len) override {
+            if (!file_.seek(offset)) return 0;
+            return file_.read(buf, len);
+        }
+        uint64_t size() override { return file_.size(); }
+
+    private:
+        File file_;
+    };
+
+} // namespace
+
+TextViewerMenu::TextViewerMenu() :
+    pagerMutex_(xSemaphoreCreateMutex()),
+    indexRunning_(false),
+    indexStopRequested_(false),
+    failed_(false),
+    topLine_(0),
+    column_(0),
+    knownLines_(0),
+    lastPercent_(0)
+{
+    title_[0] = '\0';
+}
+
+void TextViewerMenu::setFile(const std::string& path) {
+    path_ = path;
+    size_t slash = path_.find_last_of('/');
+    snprintf(title_, sizeof(title_), "%s", path_.c_str() + (slash == std::string::npos ? 0 : slash + 1));
+    topLine_ = 0;
+    column_ = 0;
+}
+
+void TextViewerMenu::onEnter(App* app, bool isForwardNav) {
+    EventDispatcher::getInstance().subscribe(EventType::APP_INPUT, this);
+    if (!openPager()) return;
+    showPage(isForwardNav ? 0 : topLine_);
+}
+
+void TextViewerMenu::onUpdate(App* app) {
+    if (!pager_ || lastPercent_ == 100) return;
+    // The footer follows the background index, up to its final line count.
+    xSemaphoreTake(pagerMutex_, portMAX_DELAY);
+    uint8_t percent = pager_->getIndexPercent();
+    knownLines_ = pager_->getLineCount();
+    xSemaphoreGive(pagerMutex_);
+    if (percent != lastPercent_) {
+        lastPercent_ = percent;
+        app->requestRedraw();
+    }
+}
+
+void TextViewerMenu::onExit(App* app) {
+    EventDispatcher::getInstance().unsubscribe(EventType::APP_INPUT, this);
+    closePager();
+}
+
+bool TextViewerMenu::openPager() {
+    closePager();
+    failed_ = true;
+    page_.clear();
+    knownLines_ = 0;
+    lastPercent_ = 0;
+    if (!pagerMutex_ || path_.empty()) return false;
+
+    unsigned long startMs = millis();
+    // Uncached: a multi-megabyte log would otherwise be pulled whole into PSRAM, evicting the cache.
+    File file = SdCardManager::getInstance().openFileUncached(path_.c_str());
+    if (!file || file.isDirectory()) {
+        if (file) file.close();
+        LOG(LogLevel::WARN, "TEXT_VIEW", "Can't open %s", path_.c_str());
+        return false;
+    }
+    pager_.reset(new TextPager(std::unique_ptr<TextPager::Source>(new UncachedFileSource(file))));
+    if (!pager_->open()) {
+        pager_.reset();
+        return false;
+    }
+    failed_ = false;
+
+    indexStopRequested_ = false;
+    indexRunning_ = true;
+    if (xTaskCreatePinnedToCore(indexTaskEntry, "TextIndex", TASK_STACK_SIZE, this, TASK_PRIORITY, nullptr, TASK_CORE) != pdPASS) {
+        indexRunning_ = false; // Pages still index themselves as far as they are scrolled
+        LOG(LogLevel::ERROR, "TEXT_VIEW", "Failed to create index task.");
+    }
+    LOG(LogLevel::DEBUG, "TEXT_VIEW", "Opened %s (%llu bytes) in %lu ms", path_.c_str(),
+        (unsigned long long)file.size(), millis() - startMs);
+    return true;
+}
+
+void TextViewerMenu::closePager() {
+    if (indexRunning_) {
+        indexStopRequested_ = true;
+        while (indexRunning_) vTaskDelay(pdMS_TO_TICKS(1)); // At most one chunk read away
+    }
+    pager_.reset();
+    page_.clear();
+}
+
+void TextViewerMenu::indexTaskEntry(void* param) {
+    TextViewerMenu* self = static_cast<TextViewerMenu*>(param);
+    while (!self->indexStopRequested_) {
+        xSemaphoreTake(self->pagerMutex_, portMAX_DELAY);
+        bool more = self->pager_->indexStep();
+        xSemaphoreGive(self->pagerMutex_);
+        if (!more) break;
+        vTaskDelay(1); // Other SD users (and the page fetches) get the bus between chunks
+    }
+    self->indexRunning_ = false;
+    vTaskDelete(nullptr);
+}
+
+void TextViewerMenu::showPage(int64_t firstLine) {
+    if (!pager_) return;
+    if (firstLine < 0) firstLine = 0;
+
+    xSemaphoreTake(pagerMutex_, portMAX_DELAY);
+    // Past the index, it is extended only as far as this page.
+    uint32_t known = pager_->ensureLines((uint32_t)firstLine + VISIBLE_ROWS);
+    int64_t lastTop = known > (uint32_t)VISIBLE_ROWS ? known - VISIBLE_ROWS : 0;
+    topLine_ = (uint32_t)std::min(firstLine, lastTop);
+    pager_->getLines(topLine_, VISIBLE_ROWS, page_);
+    knownLines_ = pager_->getLineCount();
+    xSemaphoreGive(pagerMutex_);
+}
+
+void TextViewerMenu::scrollColumns(int delta) {
+    size_t widest = 0;
+    for (const std::string& line : page_) widest = std::max(widest, line.size());
+    int lastColumn = std::max(0, (int)widest - VISIBLE_COLUMNS);
+    column_ = std::max(0, std::min(column_ + delta, lastColumn));
+}
+
+void TextViewerMenu::handleInput(InputEvent event, App* app) {
+    switch (event) {
+        case InputEvent::ENCODER_CW:
+        case InputEvent::BTN_DOWN_PRESS:
+            showPage((int64_t)topLine_ + 1);
+            break;
+        case InputEvent::ENCODER_CCW:
+        case InputEvent::BTN_UP_PRESS:
+            showPage((int64_t)topLine_ - 1);
+            break;
+        case InputEvent::BTN_B_PRESS:
+        case InputEvent::BTN_RIGHT_DOWN_PRESS:
+            showPage((int64_t)topLine_ + VISIBLE_ROWS);
+            break;
+        case InputEvent::BTN_A_PRESS:
+        case InputEvent::BTN_RIGHT_UP_PRESS:
+            showPage((int64_t)topLine_ - VISIBLE_ROWS);
+            break;
+        case InputEvent::BTN_RIGHT_PRESS:
+            scrollColumns(COLUMN_STEP);
+            break;
+        case InputEvent::BTN_LEFT_PRESS:
+            scrollColumns(-COLUMN_STEP);
+            break;
+        case InputEvent::BTN_OK_PRESS:
+        case InputEvent::BTN_ENCODER_PRESS:
+            // Top, or the end of what has been indexed so far.
+            showPage(topLine_ > 0 ? 0 : (int64_t)knownLines_);
+            break;
+        case InputEvent::BTN_BACK_PRESS:
+            EventDispatcher::getInstance().publish(NavigateBackEvent());
+            return;
+        default:
+            return;
+    }
+    app->requestRedraw();
+}
+
+void TextViewerMenu::draw(App* app, U8G2& display) {
+    const int width = display.getDisplayWidth();
+    display.setFont(u8g2_font_5x7_tf);
+
+    if (failed_ || !pager_) {
+        const char* msg = "Can't open file";
+        display.drawStr((width - display.getStrWidth(msg)) / 2, 36, msg);
+        return;
+    }
+    if (page_.empty()) {
+        const char* msg = "(empty)";
+        display.drawStr((width - display.getStrWidth(msg)) / 2, 36, msg);
+    }
+
+    char text[VISIBLE_COLUMNS + 1];
+    int y = STATUS_BAR_H + ROW_HEIGHT;
+    for (const std::string& line : page_) {
+        size_t from = std::min(line.size(), (size_t)column_);
+        size_t len = std::min(line.size() - from, (size_t)VISIBLE_COLUMNS);
+        memcpy(text, line.data() + from, len);
+        text[len] = '\0';
+        display.drawStr(1, y, text);
+        y += ROW_HEIGHT;
+    }
+
+    // Footer: position, and how far the index has got
+    const int footerY = 63;
+    display.drawHLine(0, footerY - ROW_HEIGHT, width);
+    char footer[40];
+    uint32_t lastShown = topLine_ + (uint32_t)page_.size();
+    if (indexRunning_) {
+        snprintf(footer, sizeof(footer), "%lu-%lu of %lu+ (%u%%)", (unsigned long)topLine_ + 1, (unsigned long)lastShown,
+                 (unsigned long)knownLines_, (unsigned)lastPercent_);
+    } else {
+        snprintf(footer, sizeof(footer), "%lu-%lu of %lu", (unsigned long)topLine_ + 1, (unsigned long)lastShown,
+                 (unsigned long)knownLines_);
+    }
+    display.drawStr(1, footerY, footer);
+    if (column_ > 0) {
+        snprintf(footer, sizeof(footer), "+%d", column_);
+        display.drawStr(width - 1 - display.getStrWidth(footer), footerY, footer);
+    }
+
+    // Scrollbar over the lines known so far
+    if (knownLines_ > (uint32_t)VISIBLE_ROWS) {
+        const int barTop = STATUS_BAR_H + 1;
+        const int barH = footerY - ROW_HEIGHT - 1 - barTop;
+        const int thumbH = std::max(3, (int)((int64_t)barH * VISIBLE_ROWS / knownLines_));
+        const int thumbY = barTop + (int)((int64_t)(barH - thumbH) * topLine_ / (knownLines_ - VISIBLE_ROWS));
+        display.drawFrame(126, barTop, 2, barH);
+        display.drawBox(126, std::min(thumbY, barTop + barH - thumbH), 2, thumbH);
+    }
+}
@@ -394,7 +394,7 @@ void drawWrappedText(U8G2 &display, const char* text, int x, int y, int w, int h
     int total_text_height = lines.size() * line_height;
     int start_y = y + (h - total_text_height) / 2 + display.getAscent();
 
-    for (size_t i = 0; i < lines.size() && i < max_lines; ++i) {
+    for (size_t i = 0; i < lines.size() && (int)i < max_lines; ++i) {
         int line_width = display.getStrWidth(lines[i].c_str());
         int line_x = x + (w - line_width) / 2;
         display.drawStr(line_x, start_y + (i * line_height), lines[i].c_str());
@@ -6,6 +6,7 @@
 #include "UI_Utils.h"
 #include "Logger.h"
 #include "SdCardManager.h"
+#include "SdWriter.h"
 #include <HIDForge.h> // The main library header for MSC
 
 UsbDriveMenu::UsbDriveMenu() : isEjected(false) {}
@@ -14,6 +15,11 @@ void UsbDriveMenu::onEnter(App* app, bool isForwardNav) {
     EventDispatcher::getInstance().subscribe(EventType::APP_INPUT, this);
     isEjected = false; // Reset the flag on entry
     LOG(LogLevel::INFO, "USB_DRIVE", "Entering USB Mass Storage Mode.");
+    // The host owns the card from here on: flush and close everything we have open, and hold
+    // new writes (logs included) in the queue until we take it back.
+    SdWriter::getInstance().suspend();
+    // Let go of the card entirely; the MSC driver mounts it itself and setup() takes it back on exit.
+    SdCardManager::getInstance().end();
 
     card_ = std::make_unique<SDCardArduino>(Serial, "/sd", static_cast<gpio_num_t>(Pins::SD_CS_PIN));
     
@@ -51,6 +57,9 @@ void UsbDriveMenu::onExit(App* app) {
     Serial.end();
     Serial.begin(115200);
 
+    // The host may have changed anything on the card, so no cached file or listing can be trusted.
+    SdCardManager::getInstance().invalidateAll();
+
     LOG(LogLevel::INFO, "USB_DRIVE", "Re-initializing SD card for firmware use.");
     if (!SdCardManager::getInstance().setup()) {
         LOG(LogLevel::ERROR, "USB_DRIVE", "Failed to re-mount SD Card after USB mode!");
@@ -58,6 +67,7 @@ void UsbDriveMenu::onExit(App* app) {
     }
     
     Logger::getInstance().setup();
+    SdWriter::getInstance().resume();
 }
 
 void UsbDriveMenu::onUpdate(App* app) {}
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <ESPmDNS.h>
 #include "Logger.h"
+#include "SdWriter.h"
 
 // Non-member callback function required by the WiFi event system
 static void WiFiEventCallback(WiFiEvent_t event, WiFiEventInfo_t info);
@@ -297,23 +298,27 @@ void WifiManager::onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
 void WifiManager::loadKnownNetworks() {
     if (networksLoaded_) return;
     knownNetworks_.clear();
-    String content = SdCardManager::getInstance().readFile(SD_ROOT::WIFI_KNOWN_NETWORKS);
-    int currentIndex = 0;
-    while(currentIndex < content.length()) {
-        int ssidEnd = content.indexOf(';', currentIndex);
-        if (ssidEnd == -1) break;
-        int passEnd = content.indexOf(';', ssidEnd + 1);
-        if (passEnd == -1) break;
-        int failEnd = content.indexOf('\n', passEnd + 1);
-        if (failEnd == -1) failEnd = content.length();
-        KnownWifiNetwork net;
-        strncpy(net.ssid, content.substring(currentIndex, ssidEnd).c_str(), sizeof(net.ssid)-1);
-        net.ssid[sizeof(net.ssid)-1] = '\0';
-        strncpy(net.password, content.substring(ssidEnd + 1, passEnd).c_str(), sizeof(net.password)-1);
-        net.password[sizeof(net.password)-1] = '\0';
-        net.failureCount = content.substring(passEnd + 1, failEnd).toInt();
-        knownNetworks_.push_back(net);
-        currentIndex = failEnd + 1;
+    String content;
+    if (SdCardManager::getInstance().readFileAtomic(SD_ROOT::WIFI_KNOWN_NETWORKS, content)) {
+        // Raw (untrimmed) lines: SSIDs and passwords may legitimately start or end with spaces.
+        std::string_view rest(content.c_str(), content.length()), line, ssid, password;
+        while (!rest.empty()) {
+            if (!SdCardManager::splitField(rest, '\n', line)) {
+                line = rest;
+                rest = std::string_view();
+            }
+            if (!SdCardManager::splitField(line, ';', ssid)) break;
+            if (!SdCardManager::splitField(line, ';', password)) break;
+            KnownWifiNetwork net;
+            size_t ssidLen = std::min(ssid.size(), sizeof(net.ssid) - 1);
+            memcpy(net.ssid, ssid.data(), ssidLen);
+            net.ssid[ssidLen] = '\0';
+            size_t passLen = std::min(password.size(), sizeof(net.password) - 1);
+            memcpy(net.password, password.data(), passLen);
+            net.password[passLen] = '\0';
+            net.failureCount = SdCardManager::parseLong(line);
+            knownNetworks_.push_back(net);
+        }
     }
     networksLoaded_ = true;
 }
@@ -326,7 +331,9 @@ void WifiManager::saveKnownNetworks() {
         content += net.password; content += ";";
         content += String(net.failureCount); content += "\n";
     }
-    SdCardManager::getInstance().writeFile(SD_ROOT::WIFI_KNOWN_NETWORKS, content.c_str());
+    // Saved after every connection attempt; the SD writer keeps that off the caller's task,
+    // and the atomic replace means a power cut mid-save can't lose every stored network.
+    SdWriter::getInstance().writeAtomic(SD_ROOT::WIFI_KNOWN_NETWORKS, content.c_str(), content.length());
 }
 
 KnownWifiNetwork* WifiManager::findKnownNetwork(const char* ssid) {
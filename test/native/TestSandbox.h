@@ -0,0 +1,141 @@
+#ifndef NATIVE_TEST_SANDBOX_H
+#define NATIVE_TEST_SANDBOX_H
+
+/**
+ * @brief Mounts SdCardManager on a PosixStorageBackend in a fresh temporary directory,
+ * for the native test suites.
+ *
+ * SdCardManager owns what it mounts and drops it on the next mount. The volume under a
+ * FaultInjectingBackend is only referenced by it, so those are kept for the whole run.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "SdCardManager.h"
+#include "PosixStorageBackend.h"
+#include "FaultInjectingBackend.h"
+
+namespace TestSandbox {
+
+    inline void removeTree(const std::string& path) {
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0) return;
+        if (S_ISDIR(st.st_mode)) {
+            if (DIR* dir = opendir(path.c_str())) {
+                while (struct dirent* entry = readdir(dir)) {
+                    if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+                    removeTree(path + "/" + entry->d_name);
+                }
+                closedir(dir);
+            }
+            rmdir(path.c_str());
+        } else {
+            unlink(path.c_str());
+        }
+    }
+
+    // A new, empty directory under $TMPDIR (or /tmp).
+    inline std::string makeDir(const char* tag) {
+        const char* base = getenv("TMPDIR");
+        std::string pattern = std::string(base && *base ? base : "/tmp") + "/kiva-" + tag + "-XXXXXX";
+        std::vector<char> buffer(pattern.begin(), pattern.end());
+        buffer.push_back('\0');
+        if (!mkdtemp(buffer.data())) return std::string();
+        return std::string(buffer.data());
+    }
+
+    inline std::vector<std::unique_ptr<PosixStorageBackend>>& volumes() {
+        static std::vector<std::unique_ptr<PosixStorageBackend>> all;
+        return all;
+    }
+
+    // Waits for the used-space scan a mount starts, so the next remount can't pull the
+    // backend out from under it.
+    inline bool waitForSpaceScan(uint32_t timeoutMs = 5000) {
+        uint32_t start = millis();
+        while (!SdCardManager::getInstance().isUsedSpaceKnown()) {
+            if (millis() - start > timeoutMs) return false;
+            delay(1);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Mounts a fresh sandbox and drops everything SdCardManager cached from the
+     * last one. Returns the volume (owned by SdCardManager until the next mount), or
+     * nullptr if it could not be mounted.
+     */
+    inline PosixStorageBackend* mount(const char* tag, uint64_t capacityBytes = 1ULL << 30, uint32_t clusterSize = 32 * 1024) {
+        std::string root = makeDir(tag);
+        if (root.empty()) return nullptr;
+        PosixStorageBackend* volume = new PosixStorageBackend(root, capacityBytes, clusterSize);
+        if (!SdCardManager::getInstance().setup(std::unique_ptr<IStorageBackend>(volume))) return nullptr;
+        SdCardManager::getInstance().invalidateAll();
+        waitForSpaceScan();
+        return volume;
+    }
+
+    /**
+     * @brief As mount(), with a FaultInjectingBackend between SdCardManager and the
+     * volume; the faults start disarmed. `volumeOut` receives the volume underneath.
+     */
+    inline FaultInjectingBackend* mountWithFaults(const char* tag, PosixStorageBackend** volumeOut = nullptr) {
+        std::string root = makeDir(tag);
+        if (root.empty()) return nullptr;
+        PosixStorageBackend* volume = new PosixStorageBackend(root);
+        volumes().emplace_back(volume);
+        FaultInjectingBackend* faults = new FaultInjectingBackend(*volume);
+        if (!SdCardManager::getInstance().setup(std::unique_ptr<IStorageBackend>(faults))) return nullptr;
+        SdCardManager::getInstance().invalidateAll();
+        waitForSpaceScan();
+        if (volumeOut) *volumeOut = volume;
+        return faults;
+    }
+
+    // Host path of an SD path inside `volume`, for checking or tampering behind the manager's back.
+    inline std::string hostPath(PosixStorageBackend& volume, const char* sdPath) {
+        return volume.getRootDir() + sdPath;
+    }
+
+    inline bool writeHostFile(const std::string& hostFile, const std::string& contents) {
+        FILE* f = fopen(hostFile.c_str(), "wb");
+        if (!f) return false;
+        bool ok = fwrite(contents.data(), 1, contents.size(), f) == contents.size();
+        return fclose(f) == 0 && ok;
+    }
+
+    inline bool readHostFile(const std::string& hostFile, std::string& contents) {
+        FILE* f = fopen(hostFile.c_str(), "rb");
+        if (!f) return false;
+        contents.clear();
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) contents.append(buffer, n);
+        fclose(f);
+        return true;
+    }
+
+#ifdef NATIVE_PROJECT_DIR
+    // Runs tools/klog_decode.py on a host file, as someone reading a log off the card would.
+    inline bool decodeKlog(const std::string& hostFile, std::string& text) {
+        std::string command = "python3 \"" NATIVE_PROJECT_DIR "/tools/klog_decode.py\" \"" + hostFile + "\"";
+        FILE* pipe = popen(command.c_str(), "r");
+        if (!pipe) return false;
+        text.clear();
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) text.append(buffer, n);
+        return pclose(pipe) == 0;
+    }
+#endif
+
+} // namespace TestSandbox
+
+#endif // NATIVE_TEST_SANDBOX_H
@@ -0,0 +1,45 @@
+#ifndef NATIVE_SHIM_APP_H
+#define NATIVE_SHIM_APP_H
+
+// The App as a menu built for the host sees it: it counts redraw requests, has no other
+// menus to look up, and the menus a list hands off to only record what they were given.
+#include "IMenu.h"
+#include "IListMenuDataSource.h"
+#include <string>
+
+class SearchListDataSource {
+public:
+    void begin(App*, IListMenuDataSource* source, const std::string& title) {
+        this->source = source;
+        this->title = title;
+    }
+
+    IListMenuDataSource* source = nullptr;
+    std::string title;
+};
+
+class TextViewerMenu {
+public:
+    void setFile(const std::string& path) { file = path; }
+
+    std::string file;
+};
+
+class App {
+public:
+    static App& getInstance() {
+        static App instance;
+        return instance;
+    }
+
+    void requestRedraw() { redrawRequests++; }
+    IMenu* getMenu(MenuType) { return nullptr; }
+    SearchListDataSource& getSearchListDataSource() { return searchListDataSource; }
+    TextViewerMenu& getTextViewerMenu() { return textViewerMenu; }
+
+    unsigned long redrawRequests = 0;
+    SearchListDataSource searchListDataSource;
+    TextViewerMenu textViewerMenu;
+};
+
+#endif // NATIVE_SHIM_APP_H
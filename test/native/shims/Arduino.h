@@ -0,0 +1,213 @@
+#ifndef NATIVE_SHIM_ARDUINO_H
+#define NATIVE_SHIM_ARDUINO_H
+
+/**
+ * @brief Host stand-in for the parts of the Arduino core that the storage, logging and
+ * audio modules use, so `pio test -e native` builds them unchanged.
+ *
+ * Header-only: the native env puts test/native/shims ahead of the framework, and only
+ * the modules listed in its build_src_filter are compiled against it. Time is the
+ * host's steady clock; PSRAM is the heap.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+namespace NativeShim {
+    inline std::chrono::steady_clock::time_point bootTime() {
+        static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return start;
+    }
+
+    // Ends the test binary without running static destructors: worker tasks (SdWriter,
+    // the logger's flusher) never return and would see their singletons torn down.
+    [[noreturn]] inline void exitWithoutTeardown(int code) {
+        fflush(stdout);
+        fflush(stderr);
+        _Exit(code);
+    }
+} // namespace NativeShim
+
+// 32 bits wide, as on the device, so wrap-around arithmetic behaves the same.
+inline unsigned long millis() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - NativeShim::bootTime()).count();
+}
+
+inline unsigned long micros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - NativeShim::bootTime()).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+inline void* ps_malloc(size_t size) { return malloc(size); }
+inline void* ps_calloc(size_t count, size_t size) { return calloc(count, size); }
+inline void* ps_realloc(void* ptr, size_t size) { return realloc(ptr, size); }
+inline bool psramFound() { return true; }
+
+class EspClass {
+public:
+    uint32_t getHeapSize() { return 320 * 1024; }
+    uint32_t getFreeHeap() { return 160 * 1024; }
+    uint32_t getPsramSize() { return 8 * 1024 * 1024; }
+    uint32_t getFreePsram() { return 4 * 1024 * 1024; }
+};
+inline EspClass ESP;
+
+/**
+ * @brief Arduino's String over std::string, with the members this tree calls.
+ */
+class String {
+public:
+    String() = default;
+    String(const char* text) : s_(text ? text : "") {}
+    String(const char* text, size_t length) : s_(text ? text : "", text ? length : 0) {}
+    String(const std::string& text) : s_(text) {}
+    String(char c) : s_(1, c) {}
+    String(int value) : s_(std::to_string(value)) {}
+    String(unsigned int value) : s_(std::to_string(value)) {}
+    String(long value) : s_(std::to_string(value)) {}
+    String(unsigned long value) : s_(std::to_string(value)) {}
+    String(long long value) : s_(std::to_string(value)) {}
+    String(unsigned long long value) : s_(std::to_string(value)) {}
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+    bool reserve(unsigned int size) { s_.reserve(size); return true; }
+
+    bool concat(const char* text, unsigned int length) { s_.append(text, length); return true; }
+    bool concat(const String& other) { s_ += other.s_; return true; }
+    bool concat(const char* text) { s_ += text ? text : ""; return true; }
+    bool concat(char c) { s_ += c; return true; }
+
+    String& operator+=(const String& other) { s_ += other.s_; return *this; }
+    String& operator+=(const char* text) { s_ += text ? text : ""; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String& a, const char* b) { return String(a.s_ + (b ? b : "")); }
+    friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b.s_); }
+
+    bool operator==(const String& other) const { return s_ == other.s_; }
+    bool operator==(const char* text) const { return s_ == (text ? text : ""); }
+    bool operator!=(const String& other) const { return s_ != other.s_; }
+    bool operator!=(const char* text) const { return !(*this == text); }
+    bool operator<(const String& other) const { return s_ < other.s_; }
+    bool equals(const String& other) const { return s_ == other.s_; }
+
+    char charAt(unsigned int index) const { return index < s_.size() ? s_[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    bool startsWith(const String& prefix) const { return s_.compare(0, prefix.s_.size(), prefix.s_) == 0; }
+    bool endsWith(const String& suffix) const {
+        return s_.size() >= suffix.s_.size() && s_.compare(s_.size() - suffix.s_.size(), suffix.s_.size(), suffix.s_) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { return toIndex(s_.find(c, from)); }
+    int indexOf(const String& text, unsigned int from = 0) const { return toIndex(s_.find(text.s_, from)); }
+    int lastIndexOf(char c) const { return toIndex(s_.rfind(c)); }
+    String substring(unsigned int from) const { return from <= s_.size() ? String(s_.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        return from <= s_.size() ? String(s_.substr(from, to - from)) : String();
+    }
+    void remove(unsigned int index) { if (index < s_.size()) s_.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < s_.size()) s_.erase(index, count); }
+    void trim() { // In place, as the core's does
+        size_t begin = s_.find_first_not_of(" \t\r\n\f\v");
+        if (begin == std::string::npos) {
+            s_.clear();
+            return;
+        }
+        s_.erase(s_.find_last_not_of(" \t\r\n\f\v") + 1);
+        s_.erase(0, begin);
+    }
+    long toInt() const { return atol(s_.c_str()); }
+    float toFloat() const { return (float)atof(s_.c_str()); }
+
+private:
+    static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string s_;
+};
+
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (n < size && write(buffer[n])) n++;
+        return n;
+    }
+    size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+    virtual void flush() {}
+
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return print(String(value)); }
+    size_t print(unsigned int value) { return print(String(value)); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t println() { return write((const uint8_t*)"\r\n", 2); }
+    template <typename T> size_t println(const T& value) { return print(value) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (len < 0) return 0;
+        return write((const uint8_t*)buffer, (size_t)len < sizeof(buffer) ? (size_t)len : sizeof(buffer) - 1);
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long timeout) { timeout_ = timeout; }
+    // As the core's: one read() per character, each appended to the result.
+    String readStringUntil(char terminator) {
+        String result;
+        int c;
+        while ((c = read()) >= 0 && c != terminator) result += (char)c;
+        return result;
+    }
+
+protected:
+    unsigned long timeout_ = 1000;
+};
+
+// Serial goes to stdout, where the test runner shows it with the results.
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    using Print::write;
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override { fflush(stdout); }
+    explicit operator bool() const { return true; }
+};
+inline HardwareSerial Serial;
+
+#endif // NATIVE_SHIM_ARDUINO_H
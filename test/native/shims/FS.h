@@ -0,0 +1,110 @@
+#ifndef NATIVE_SHIM_FS_H
+#define NATIVE_SHIM_FS_H
+
+/**
+ * @brief Host stand-in for the Arduino core's fs::File, forwarding to an fs::FileImpl
+ * exactly as the core does. SdCardManager supplies the only FileImpl (its
+ * StorageFileImpl over IStorageBackend), so every File a module opens reaches the
+ * backend the test mounted.
+ *
+ * FileImpl is defined here rather than in FSImpl.h so the inline File members can
+ * use it; FSImpl.h only includes this file.
+ */
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+    enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+    class FileImpl;
+    typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+    class FileImpl {
+    public:
+        virtual ~FileImpl() = default;
+        virtual size_t write(const uint8_t* buf, size_t size) = 0;
+        virtual size_t read(uint8_t* buf, size_t size) = 0;
+        virtual void flush() = 0;
+        virtual bool seek(uint32_t pos, SeekMode mode) = 0;
+        virtual size_t position() const = 0;
+        virtual size_t size() const = 0;
+        virtual bool setBufferSize(size_t size) = 0;
+        virtual void close() = 0;
+        virtual time_t getLastWrite() = 0;
+        virtual const char* path() const = 0;
+        virtual const char* name() const = 0;
+        virtual boolean isDirectory(void) = 0;
+        virtual FileImplPtr openNextFile(const char* mode) = 0;
+        virtual boolean seekDir(long position) = 0;
+        virtual String getNextFileName(void) = 0;
+        virtual String getNextFileName(bool* isDir) = 0;
+        virtual void rewindDirectory(void) = 0;
+        virtual operator bool() = 0;
+    };
+
+    class File : public Stream {
+    public:
+        File(FileImplPtr p = FileImplPtr()) : p_(p) {}
+
+        size_t write(uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t* buf, size_t size) override { return p_ ? p_->write(buf, size) : 0; }
+        using Print::write;
+
+        int available() override { return p_ ? (int)(p_->size() - p_->position()) : 0; }
+        int read() override {
+            uint8_t c;
+            return (p_ && p_->read(&c, 1) == 1) ? c : -1;
+        }
+        size_t read(uint8_t* buf, size_t size) { return p_ ? p_->read(buf, size) : 0; }
+        size_t readBytes(char* buffer, size_t length) { return read((uint8_t*)buffer, length); }
+        int peek() override {
+            if (!p_) return -1;
+            size_t pos = p_->position();
+            int c = read();
+            p_->seek(pos, SeekSet);
+            return c;
+        }
+        void flush() override { if (p_) p_->flush(); }
+
+        bool seek(uint32_t pos, SeekMode mode) { return p_ && p_->seek(pos, mode); }
+        bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+        size_t position() const { return p_ ? p_->position() : 0; }
+        size_t size() const { return p_ ? p_->size() : 0; }
+        bool setBufferSize(size_t size) { return p_ && p_->setBufferSize(size); }
+        void close() {
+            if (!p_) return;
+            p_->close();
+            p_ = nullptr;
+        }
+        operator bool() const { return p_ && *p_; }
+
+        time_t getLastWrite() { return p_ ? p_->getLastWrite() : 0; }
+        const char* path() const { return p_ ? p_->path() : nullptr; }
+        const char* name() const { return p_ ? p_->name() : nullptr; }
+
+        boolean isDirectory(void) { return p_ && p_->isDirectory(); }
+        boolean seekDir(long position) { return p_ && p_->seekDir(position); }
+        File openNextFile(const char* mode = FILE_READ) { return p_ ? File(p_->openNextFile(mode)) : File(); }
+        String getNextFileName(void) { return p_ ? p_->getNextFileName() : String(); }
+        String getNextFileName(boolean* isDir) { return p_ ? p_->getNextFileName(isDir) : String(); }
+        void rewindDirectory(void) { if (p_) p_->rewindDirectory(); }
+
+    private:
+        FileImplPtr p_;
+    };
+
+} // namespace fs
+
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif // NATIVE_SHIM_FS_H
@@ -0,0 +1,7 @@
+#ifndef NATIVE_SHIM_FS_IMPL_H
+#define NATIVE_SHIM_FS_IMPL_H
+
+// fs::FileImpl lives in FS.h in the host shims; see there.
+#include "FS.h"
+
+#endif // NATIVE_SHIM_FS_IMPL_H
@@ -0,0 +1,43 @@
+#ifndef NATIVE_SHIM_U8G2LIB_H
+#define NATIVE_SHIM_U8G2LIB_H
+
+// Config.h includes the display library. On the host a U8G2 draws nothing: it keeps the
+// strings drawn since the last clear() so a test can see what a frame would have shown.
+#include <Arduino.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define U8X8_PROGMEM
+
+inline const uint8_t u8g2_font_6x10_tf[] = {0};
+
+class U8G2 {
+public:
+    void clear() { strings.clear(); }
+
+    void setFont(const uint8_t*) {}
+    void setDrawColor(uint8_t) {}
+    void setClipWindow(int, int, int, int) {}
+    void setMaxClipWindow() {}
+
+    int drawStr(int, int, const char* s) {
+        strings.push_back(s);
+        return getStrWidth(s);
+    }
+    void drawBox(int, int, int, int) {}
+    void drawFrame(int, int, int, int) {}
+    void drawRBox(int, int, int, int, int) {}
+    void drawRFrame(int, int, int, int, int) {}
+    void drawLine(int, int, int, int) {}
+    void drawXBM(int, int, int, int, const uint8_t*) {}
+
+    int getDisplayWidth() const { return 128; }
+    int getStrWidth(const char* s) const { return 6 * (int)strlen(s); } // 6x10, the list font
+    int getAscent() const { return 7; }
+    int getDescent() const { return -2; }
+
+    std::vector<std::string> strings;
+};
+
+#endif // NATIVE_SHIM_U8G2LIB_H
@@ -0,0 +1,128 @@
+#ifndef NATIVE_SHIM_DRIVER_I2S_H
+#define NATIVE_SHIM_DRIVER_I2S_H
+
+/**
+ * @brief Host stand-in for the legacy I2S driver calls AudioOutputPDM makes.
+ *
+ * i2s_write() appends to the port's `written` samples at once instead of feeding a
+ * DMA, so a test sees exactly what would have reached the DAC; while the port is
+ * stopped it takes nothing and waits out its timeout, as a full DMA queue would.
+ * Each install records its sample rate and how much had been written before it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+typedef int i2s_port_t;
+typedef int gpio_num_t;
+typedef int i2s_mode_t;
+
+enum { I2S_NUM_0 = 0, I2S_NUM_1 = 1, I2S_NUM_MAX = 2 };
+enum { I2S_MODE_MASTER = 1, I2S_MODE_SLAVE = 2, I2S_MODE_TX = 4, I2S_MODE_RX = 8, I2S_MODE_PDM = 64 };
+enum { I2S_BITS_PER_SAMPLE_16BIT = 16 };
+enum { I2S_CHANNEL_FMT_RIGHT_LEFT = 0 };
+enum { I2S_COMM_FORMAT_STAND_MSB = 2 };
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+#define I2S_PIN_NO_CHANGE (-1)
+
+typedef struct {
+    i2s_mode_t mode;
+    uint32_t sample_rate;
+    int bits_per_sample;
+    int channel_format;
+    int communication_format;
+    int intr_alloc_flags;
+    int dma_buf_count;
+    int dma_buf_len;
+    bool use_apll;
+    bool tx_desc_auto_clear;
+    int fixed_mclk;
+} i2s_config_t;
+
+typedef struct {
+    int bck_io_num;
+    int ws_io_num;
+    int data_out_num;
+    int data_in_num;
+} i2s_pin_config_t;
+
+namespace NativeShim {
+
+    struct I2sRateChange {
+        size_t writtenBefore; // Samples
+        uint32_t sampleRate;
+    };
+
+    struct I2sPort {
+        std::mutex mutex;
+        bool installed = false;
+        bool running = false;
+        uint32_t sampleRate = 0;
+        std::vector<int16_t> written; // Interleaved, as handed to i2s_write()
+        std::vector<I2sRateChange> installs;
+    };
+
+    inline I2sPort& i2sPort(i2s_port_t port) {
+        static I2sPort ports[I2S_NUM_MAX];
+        return ports[port];
+    }
+
+} // namespace NativeShim
+
+inline esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int, void*) {
+    NativeShim::I2sPort& p = NativeShim::i2sPort(port);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    if (p.installed) return ESP_FAIL;
+    p.installed = true;
+    p.running = false;
+    p.sampleRate = config->sample_rate;
+    p.installs.push_back({p.written.size(), p.sampleRate});
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_driver_uninstall(i2s_port_t port) {
+    NativeShim::I2sPort& p = NativeShim::i2sPort(port);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.installed = false;
+    p.running = false;
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_set_pin(i2s_port_t, const i2s_pin_config_t*) { return ESP_OK; }
+
+inline esp_err_t i2s_start(i2s_port_t port) {
+    NativeShim::I2sPort& p = NativeShim::i2sPort(port);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.running = p.installed;
+    return p.installed ? ESP_OK : ESP_FAIL;
+}
+
+inline esp_err_t i2s_stop(i2s_port_t port) {
+    NativeShim::I2sPort& p = NativeShim::i2sPort(port);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.running = false;
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_write(i2s_port_t port, const void* src, size_t size, size_t* bytesWritten, TickType_t ticks) {
+    NativeShim::I2sPort& p = NativeShim::i2sPort(port);
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.running) {
+            const int16_t* samples = static_cast<const int16_t*>(src);
+            p.written.insert(p.written.end(), samples, samples + size / sizeof(int16_t));
+            *bytesWritten = size;
+            return ESP_OK;
+        }
+    }
+    *bytesWritten = 0;
+    vTaskDelay(ticks);
+    return ESP_OK;
+}
+
+#endif // NATIVE_SHIM_DRIVER_I2S_H
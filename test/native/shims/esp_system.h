@@ -0,0 +1,31 @@
+#ifndef NATIVE_SHIM_ESP_SYSTEM_H
+#define NATIVE_SHIM_ESP_SYSTEM_H
+
+#include <stdlib.h>
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef void (*shutdown_handler_t)(void);
+
+namespace NativeShim {
+    inline std::vector<shutdown_handler_t>& shutdownHandlers() {
+        static std::vector<shutdown_handler_t> handlers;
+        return handlers;
+    }
+} // namespace NativeShim
+
+inline esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+    NativeShim::shutdownHandlers().push_back(handler);
+    return ESP_OK;
+}
+
+// Runs the shutdown handlers as the device does, then ends the process.
+[[noreturn]] inline void esp_restart() {
+    for (shutdown_handler_t handler : NativeShim::shutdownHandlers()) handler();
+    _Exit(0);
+}
+
+#endif // NATIVE_SHIM_ESP_SYSTEM_H
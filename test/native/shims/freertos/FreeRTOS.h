@@ -0,0 +1,92 @@
+#ifndef NATIVE_SHIM_FREERTOS_H
+#define NATIVE_SHIM_FREERTOS_H
+
+/**
+ * @brief Host stand-in for the FreeRTOS kernel calls this tree makes, on std::thread.
+ *
+ * One tick is one millisecond. Tasks are detached threads; priorities and cores are
+ * ignored, so tests must not rely on one task pre-empting another. Every blocking
+ * call waits in short slices and checks whether its task was deleted meanwhile, so
+ * vTaskDelete() on another task returns once that task has reached a blocking call
+ * and unwound.
+ */
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configMAX_PRIORITIES 25
+
+namespace NativeShim {
+
+    // Thrown through a task's stack by vTaskDelete(); caught where its thread starts.
+    struct TaskExit {};
+
+    struct Task {
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint32_t notifyValue = 0;
+        std::atomic<bool> deleteRequested{false};
+        std::atomic<bool> finished{false};
+    };
+
+    // The calling thread's task. Threads the shim didn't start (the test's main thread)
+    // get one on first use so they can be notified too.
+    inline Task*& currentTaskSlot() {
+        thread_local Task* task = nullptr;
+        return task;
+    }
+
+    inline Task* currentTask() {
+        Task*& task = currentTaskSlot();
+        if (!task) task = new Task(); // Lives as long as the thread might be named by a handle
+        return task;
+    }
+
+    inline void checkDeleted() {
+        Task* task = currentTaskSlot();
+        if (task && task->deleteRequested) throw TaskExit();
+    }
+
+    /**
+     * @brief Waits on `cv` under `lock` until `ready()` or `ticks` run out, in slices so a
+     * deletion of the calling task is noticed. Returns ready().
+     */
+    template <typename Predicate>
+    bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Predicate ready) {
+        const std::chrono::milliseconds slice(5);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks);
+        while (!ready()) {
+            if (currentTaskSlot() && currentTaskSlot()->deleteRequested) {
+                lock.unlock();
+                throw TaskExit();
+            }
+            if (ticks != portMAX_DELAY) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) return false;
+                cv.wait_for(lock, std::min<std::chrono::steady_clock::duration>(slice, deadline - now));
+            } else {
+                cv.wait_for(lock, slice);
+            }
+        }
+        return true;
+    }
+
+} // namespace NativeShim
+
+#endif // NATIVE_SHIM_FREERTOS_H
@@ -0,0 +1,81 @@
+#ifndef NATIVE_SHIM_FREERTOS_SEMPHR_H
+#define NATIVE_SHIM_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+namespace NativeShim {
+
+    struct Semaphore {
+        std::mutex mutex;
+        std::condition_variable cv;
+        UBaseType_t count;
+        UBaseType_t maxCount;
+        bool recursive = false;
+        Task* holder = nullptr;
+        UBaseType_t depth = 0;
+
+        Semaphore(UBaseType_t maxCount, UBaseType_t initial) : count(initial), maxCount(maxCount) {}
+    };
+
+} // namespace NativeShim
+
+typedef NativeShim::Semaphore* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new NativeShim::Semaphore(1, 1); }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new NativeShim::Semaphore(1, 0); }
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initial) {
+    return new NativeShim::Semaphore(maxCount, initial);
+}
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    SemaphoreHandle_t semaphore = new NativeShim::Semaphore(1, 1);
+    semaphore->recursive = true;
+    return semaphore;
+}
+
+// Left allocated: a task may still be returning from a give when its owner tears down.
+inline void vSemaphoreDelete(SemaphoreHandle_t) {}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    if (!NativeShim::waitFor(semaphore->cv, lock, ticks, [semaphore]() { return semaphore->count > 0; })) return pdFALSE;
+    semaphore->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->maxCount) return pdFALSE;
+    semaphore->count++;
+    semaphore->cv.notify_one();
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    NativeShim::Task* self = NativeShim::currentTask();
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    if (semaphore->holder == self) {
+        semaphore->depth++;
+        return pdTRUE;
+    }
+    if (!NativeShim::waitFor(semaphore->cv, lock, ticks, [semaphore]() { return semaphore->holder == nullptr; })) return pdFALSE;
+    semaphore->holder = self;
+    semaphore->depth = 1;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->holder != NativeShim::currentTask()) return pdFALSE;
+    if (--semaphore->depth == 0) {
+        semaphore->holder = nullptr;
+        semaphore->cv.notify_one();
+    }
+    return pdTRUE;
+}
+
+inline UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    return semaphore->count;
+}
+
+#endif // NATIVE_SHIM_FREERTOS_SEMPHR_H
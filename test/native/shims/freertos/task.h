@@ -0,0 +1,71 @@
+#ifndef NATIVE_SHIM_FREERTOS_TASK_H
+#define NATIVE_SHIM_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+#include <Arduino.h>
+#include <thread>
+
+typedef NativeShim::Task* TaskHandle_t;
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackDepth, void* param,
+                                          UBaseType_t priority, TaskHandle_t* createdTask, BaseType_t coreId) {
+    (void)name; (void)stackDepth; (void)priority; (void)coreId;
+    NativeShim::Task* task = new NativeShim::Task(); // Never freed: a stale handle stays safe to compare
+    if (createdTask) *createdTask = task;
+    std::thread([task, code, param]() {
+        NativeShim::currentTaskSlot() = task;
+        try {
+            code(param);
+        } catch (const NativeShim::TaskExit&) {
+        }
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->finished = true;
+        task->cv.notify_all();
+    }).detach();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth, void* param,
+                              UBaseType_t priority, TaskHandle_t* createdTask) {
+    return xTaskCreatePinnedToCore(code, name, stackDepth, param, priority, createdTask, 0);
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return NativeShim::currentTask(); }
+
+// Deleting the caller unwinds it; deleting another task waits for it to unwind.
+inline void vTaskDelete(TaskHandle_t task) {
+    if (!task || task == NativeShim::currentTaskSlot()) throw NativeShim::TaskExit();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    task->deleteRequested = true;
+    task->cv.notify_all();
+    task->cv.wait(lock, [task]() { return task->finished.load(); });
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+    NativeShim::Task* self = NativeShim::currentTask();
+    std::unique_lock<std::mutex> lock(self->mutex);
+    NativeShim::waitFor(self->cv, lock, ticks, []() { return false; });
+}
+
+inline TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+#define taskYIELD() (NativeShim::checkDeleted(), std::this_thread::yield())
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifyValue++;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticks) {
+    NativeShim::Task* self = NativeShim::currentTask();
+    std::unique_lock<std::mutex> lock(self->mutex);
+    if (!NativeShim::waitFor(self->cv, lock, ticks, [self]() { return self->notifyValue > 0; })) return 0;
+    uint32_t value = self->notifyValue;
+    if (clearCountOnExit) self->notifyValue = 0;
+    else self->notifyValue--;
+    return value;
+}
+
+#endif // NATIVE_SHIM_FREERTOS_TASK_H
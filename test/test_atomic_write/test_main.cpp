@@ -0,0 +1,220 @@
+// Crash tests for SdCardManager::writeFileAtomic() / restoreAtomic(): the power is cut
+// at every step of a replace, the card is remounted, and the reader must get either the
+// old or the new contents, never a mix and never nothing while an intact copy exists.
+
+#include <unity.h>
+#include "TestSandbox.h"
+#include "CrcTrailer.h"
+
+using SdCardManager::getInstance;
+
+static const char* PATH = "/config/music_resume.txt";
+static const std::string OLDEST = "/user/music/a.mp3;1000\n";
+static const std::string OLD = "/user/music/old.mp3;123456\nvolume;40\n";
+static const std::string NEW = "/user/music/new.mp3;654321\nvolume;75\nshuffle;1\n";
+
+static FaultInjectingBackend* faults = nullptr;
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+    faults = nullptr;
+}
+
+static void mountFresh() {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    faults = TestSandbox::mountWithFaults("atomic", &volume);
+    TEST_ASSERT_NOT_NULL(faults);
+}
+
+// What a reboot does: power back, nothing cached, the card mounted again.
+static void remount() {
+    faults->setFaults(FaultInjectingBackend::Faults());
+    getInstance().end();
+    TEST_ASSERT_TRUE(getInstance().setup());
+    getInstance().invalidateAll();
+    TestSandbox::waitForSpaceScan();
+}
+
+static std::string withTrailer(const std::string& payload) {
+    char trailer[CrcTrailer::SIZE];
+    CrcTrailer::format(CrcTrailer::update(0, payload.data(), payload.size()), trailer);
+    return payload + std::string(trailer, CrcTrailer::SIZE);
+}
+
+static void putOnCard(const char* sdPath, const std::string& contents) {
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, sdPath), contents));
+}
+
+static bool onCard(const char* sdPath) {
+    std::string ignored;
+    return TestSandbox::readHostFile(TestSandbox::hostPath(*volume, sdPath), ignored);
+}
+
+static std::string readBack(bool expectFound = true) {
+    String out;
+    bool found = getInstance().readFileAtomic(PATH, out);
+    TEST_ASSERT_EQUAL(expectFound, found);
+    return std::string(out.c_str(), out.length());
+}
+
+// path = OLD with a .bak of OLDEST: the state after two earlier saves.
+static void prepareTwoSaves() {
+    TEST_ASSERT_TRUE(getInstance().writeFileAtomic(PATH, OLDEST.data(), OLDEST.size()));
+    TEST_ASSERT_TRUE(getInstance().writeFileAtomic(PATH, OLD.data(), OLD.size()));
+}
+
+static uint64_t countOps(void (*prepare)()) {
+    mountFresh();
+    prepare();
+    faults->setFaults(FaultInjectingBackend::Faults());
+    TEST_ASSERT_TRUE(getInstance().writeFileAtomic(PATH, NEW.data(), NEW.size()));
+    return faults->getOpsDone();
+}
+
+void test_round_trip_strips_trailer(void) {
+    mountFresh();
+    TEST_ASSERT_TRUE(getInstance().writeFileAtomic(PATH, NEW.data(), NEW.size()));
+    std::string raw;
+    TEST_ASSERT_TRUE(TestSandbox::readHostFile(TestSandbox::hostPath(*volume, PATH), raw));
+    TEST_ASSERT_EQUAL_STRING(withTrailer(NEW).c_str(), raw.c_str());
+    TEST_ASSERT_EQUAL_STRING(NEW.c_str(), readBack().c_str());
+    TEST_ASSERT_FALSE(onCard("/config/music_resume.txt.tmp"));
+}
+
+void test_power_cut_after_every_step(void) {
+    uint64_t total = countOps(prepareTwoSaves);
+    TEST_ASSERT_GREATER_OR_EQUAL(6, total); // open, writes, flush, remove .bak, two renames
+
+    bool sawOld = false, sawNew = false;
+    for (uint64_t cut = 0; cut < total; ++cut) {
+        mountFresh();
+        prepareTwoSaves();
+        FaultInjectingBackend::Faults cutAfter;
+        cutAfter.powerLossAfterOps = cut;
+        faults->setFaults(cutAfter);
+        TEST_ASSERT_FALSE(getInstance().writeFileAtomic(PATH, NEW.data(), NEW.size()));
+        TEST_ASSERT_TRUE(faults->hasLostPower());
+
+        remount();
+        std::string got = readBack();
+        char message[64];
+        snprintf(message, sizeof(message), "cut after %llu of %llu ops", (unsigned long long)cut, (unsigned long long)total);
+        TEST_ASSERT_TRUE_MESSAGE(got == OLD || got == NEW, message);
+        sawOld |= got == OLD;
+        sawNew |= got == NEW;
+        // Recovery is stable, and a later save works normally.
+        TEST_ASSERT_EQUAL_STRING(got.c_str(), readBack().c_str());
+        TEST_ASSERT_TRUE(getInstance().writeFileAtomic(PATH, OLDEST.data(), OLDEST.size()));
+        TEST_ASSERT_EQUAL_STRING(OLDEST.c_str(), readBack().c_str());
+    }
+    // The cut before the .tmp is synced loses the save; the one before the last rename keeps it.
+    TEST_ASSERT_TRUE(sawOld);
+    TEST_ASSERT_TRUE(sawNew);
+}
+
+void test_power_cut_on_first_save(void) {
+    uint64_t total = countOps([]() {});
+    for (uint64_t cut = 0; cut < total; ++cut) {
+        mountFresh();
+        FaultInjectingBackend::Faults cutAfter;
+        cutAfter.powerLossAfterOps = cut;
+        faults->setFaults(cutAfter);
+        TEST_ASSERT_FALSE(getInstance().writeFileAtomic(PATH, NEW.data(), NEW.size()));
+
+        remount();
+        String out;
+        if (getInstance().readFileAtomic(PATH, out)) {
+            TEST_ASSERT_EQUAL_STRING(NEW.c_str(), out.c_str());
+        } else {
+            TEST_ASSERT_EQUAL_UINT(0, out.length()); // Nothing was ever complete: no file, not garbage
+        }
+    }
+}
+
+void test_torn_write_at_every_byte(void) {
+    const size_t total = NEW.size() + CrcTrailer::SIZE;
+    for (size_t cut = 0; cut < total; ++cut) {
+        mountFresh();
+        prepareTwoSaves();
+        FaultInjectingBackend::Faults tear;
+        tear.powerLossAfterBytes = cut;
+        faults->setFaults(tear);
+        TEST_ASSERT_FALSE(getInstance().writeFileAtomic(PATH, NEW.data(), NEW.size()));
+
+        remount();
+        TEST_ASSERT_EQUAL_STRING(OLD.c_str(), readBack().c_str());
+    }
+}
+
+void test_tmp_is_preferred_over_bak(void) {
+    // Cut between retiring the old copy and moving the new one in.
+    mountFresh();
+    putOnCard("/config/music_resume.txt.tmp", withTrailer(NEW));
+    putOnCard("/config/music_resume.txt.bak", withTrailer(OLD));
+    remount();
+    TEST_ASSERT_EQUAL_STRING(NEW.c_str(), readBack().c_str());
+    TEST_ASSERT_FALSE(onCard("/config/music_resume.txt.tmp"));
+}
+
+void test_torn_tmp_falls_back_to_bak(void) {
+    mountFresh();
+    std::string torn = withTrailer(NEW);
+    torn.resize(torn.size() - 5);
+    putOnCard("/config/music_resume.txt.tmp", torn);
+    putOnCard("/config/music_resume.txt.bak", withTrailer(OLD));
+    remount();
+    TEST_ASSERT_EQUAL_STRING(OLD.c_str(), readBack().c_str());
+}
+
+void test_bad_crc_is_restored_from_bak(void) {
+    mountFresh();
+    std::string damaged = withTrailer(NEW);
+    damaged[3] ^= 0x20;
+    putOnCard(PATH, damaged);
+    putOnCard("/config/music_resume.txt.bak", withTrailer(OLD));
+    remount();
+    TEST_ASSERT_EQUAL_STRING(OLD.c_str(), readBack().c_str());
+}
+
+void test_file_without_trailer_is_taken_as_is(void) {
+    mountFresh();
+    putOnCard(PATH, "edited over USB\n");
+    putOnCard("/config/music_resume.txt.bak", withTrailer(OLD));
+    remount();
+    TEST_ASSERT_EQUAL_STRING("edited over USB\n", readBack().c_str());
+
+    putOnCard(PATH, "short"); // Shorter than a trailer
+    getInstance().invalidateAll();
+    TEST_ASSERT_EQUAL_STRING("short", readBack().c_str());
+}
+
+void test_empty_file_is_restored_or_reported(void) {
+    mountFresh();
+    putOnCard(PATH, "");
+    putOnCard("/config/music_resume.txt.bak", withTrailer(OLD));
+    remount();
+    TEST_ASSERT_EQUAL_STRING(OLD.c_str(), readBack().c_str());
+
+    mountFresh();
+    putOnCard(PATH, "");
+    remount();
+    TEST_ASSERT_EQUAL_STRING("", readBack(false).c_str());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_strips_trailer);
+    RUN_TEST(test_power_cut_after_every_step);
+    RUN_TEST(test_power_cut_on_first_save);
+    RUN_TEST(test_torn_write_at_every_byte);
+    RUN_TEST(test_tmp_is_preferred_over_bak);
+    RUN_TEST(test_torn_tmp_falls_back_to_bak);
+    RUN_TEST(test_bad_crc_is_restored_from_bak);
+    RUN_TEST(test_file_without_trailer_is_taken_as_is);
+    RUN_TEST(test_empty_file_is_restored_or_reported);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
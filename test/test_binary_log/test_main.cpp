@@ -0,0 +1,237 @@
+// BinaryLog: render() against snprintf for the formats the firmware uses, a session log
+// written by the real Logger onto a PosixStorageBackend and decoded by
+// tools/klog_decode.py back into the text lines snprintf would have produced, and the
+// per-call cost and size of a binary record against the old formatted line.
+
+#include <unity.h>
+#include <chrono>
+#include <sstream>
+#include <vector>
+#include "TestSandbox.h"
+#include "BinaryLog.h"
+#include "Logger.h"
+
+using namespace BinaryLog;
+
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {}
+
+void tearDown(void) {
+    if (volume) {
+        SdWriter::getInstance().suspend(); // Lets go of the session log before the sandbox goes
+        SdWriter::getInstance().resume();
+        TestSandbox::removeTree(volume->getRootDir());
+    }
+    volume = nullptr;
+}
+
+static const char* SSID = "HomeNet-5G";
+
+template <typename... Args>
+static std::string rendered(const char* format, Args... args) {
+    uint8_t record[192] = {};
+    MessageHeader header = {1, 0, format, "T"};
+    size_t len = encode(record, sizeof(record), header, args...);
+    char out[512] = {};
+    render(out, sizeof(out), format, record + sizeof(header), len - sizeof(header));
+    return out;
+}
+
+template <typename... Args>
+static void expectLikeSnprintf(const char* format, Args... args) {
+    char expected[512];
+    snprintf(expected, sizeof(expected), format, args...);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, rendered(format, args...).c_str(), format);
+}
+
+void test_render_matches_snprintf(void) {
+    expectLikeSnprintf("plain");
+    expectLikeSnprintf("%d %i %u", -5, 7, 42u);
+    expectLikeSnprintf("%5d|%-5d|%05d", 12, -3, 7);
+    expectLikeSnprintf("%x %X %08x %#x", 255u, 0xABCDu, 0x1234u, 0x10u);
+    expectLikeSnprintf("0x%02X", (uint8_t)0x3c);
+    expectLikeSnprintf("%lu %ld %llu %lld", 4000000000ul, -99l, 18446744073709551615ull, -9223372036854775807ll);
+    expectLikeSnprintf("%f %.2f %8.3f %e %g", 3.14159, 2.5f, -1.0, 12345.678, 0.0001);
+    expectLikeSnprintf("%s|%10s|%-10s|%.3s", SSID, SSID, SSID, SSID);
+    expectLikeSnprintf("%c%c", 'O', 'K');
+    expectLikeSnprintf("100%% done %d", 1);
+    expectLikeSnprintf("%zu bytes", (size_t)4096);
+    expectLikeSnprintf("%hhu %hu", (unsigned char)200, (unsigned short)60000);
+    expectLikeSnprintf("Connected to %s (ch %d, rssi %d dBm) in %lu ms", SSID, 6, -61, 1834ul);
+    expectLikeSnprintf("PCF0 State (0x%02X): %s", 0xF7u, "P0=1 P1=1 P2=1 P3=0");
+}
+
+void test_missing_and_cut_arguments(void) {
+    TEST_ASSERT_EQUAL_STRING("a <?> b <?>", rendered("a %d b %s").c_str());
+
+    // Output buffer too small: cut, NUL-terminated, length reported.
+    uint8_t record[192];
+    MessageHeader header = {1, 0, "%s-%s", "T"};
+    size_t len = encode(record, sizeof(record), header, SSID, SSID);
+    char small[8];
+    TEST_ASSERT_EQUAL_size_t(7, render(small, sizeof(small), "%s-%s", record + sizeof(header), len - sizeof(header)));
+    TEST_ASSERT_EQUAL_STRING("HomeNet", small);
+
+    // Record too small: the arguments that fit are kept, the rest print as <?>.
+    std::string big(96, 'x');
+    uint8_t tight[64];
+    MessageHeader three = {1, 0, "%d %s %d", "T"};
+    len = encode(tight, sizeof(tight), three, 7, big.c_str(), 9);
+    char out[256];
+    render(out, sizeof(out), "%d %s %d", tight + sizeof(three), len - sizeof(three));
+    TEST_ASSERT_EQUAL_STRING("7 <?> <?>", out);
+
+    // Long strings are cut at MAX_STRING_ARG.
+    std::string longer(200, 'y');
+    TEST_ASSERT_EQUAL_size_t(MAX_STRING_ARG, rendered("%s", longer.c_str()).size());
+}
+
+void test_varints_round_trip(void) {
+    const uint64_t values[] = {0, 1, 127, 128, 300, 16383, 16384, UINT32_MAX, (uint64_t)UINT32_MAX + 1, UINT64_MAX};
+    for (uint64_t v : values) {
+        uint8_t buffer[MAX_VARINT_SIZE];
+        size_t n = putVarint(buffer, v);
+        uint64_t back;
+        TEST_ASSERT_EQUAL_size_t(n, getVarint(buffer, n, back));
+        TEST_ASSERT_TRUE(back == v);
+        if (n > 1) TEST_ASSERT_EQUAL_size_t(0, getVarint(buffer, n - 1, back)); // Truncated
+    }
+    const int64_t signedValues[] = {0, -1, 1, -64, 63, INT32_MIN, INT64_MIN, INT64_MAX};
+    for (int64_t v : signedValues) TEST_ASSERT_TRUE(unzigzag(zigzag(v)) == v);
+}
+
+// Every line the session log should hold for tag "KLOGTEST", without the millis.
+static std::vector<std::string> logSession(int rounds) {
+    Logger& logger = Logger::getInstance();
+    std::vector<std::string> expected;
+    char line[256];
+    for (int i = 0; i < rounds; ++i) {
+        logger.log(LogLevel::INFO, "KLOGTEST", "Connected to %s (ch %d, rssi %d dBm) in %lu ms", SSID, i % 13 + 1, -40 - i % 50, (unsigned long)(1000 + i));
+        snprintf(line, sizeof(line), "[I] [KLOGTEST] Connected to %s (ch %d, rssi %d dBm) in %lu ms", SSID, i % 13 + 1, -40 - i % 50, (unsigned long)(1000 + i));
+        expected.push_back(line);
+        logger.log(LogLevel::WARN, "KLOGTEST", "  > PCF0 State (0x%02X): %s", (unsigned)(i & 0xFF), "P0=1 P1=0 P2=1");
+        snprintf(line, sizeof(line), "[W] [KLOGTEST]   > PCF0 State (0x%02X): %s", (unsigned)(i & 0xFF), "P0=1 P1=0 P2=1");
+        expected.push_back(line);
+        logger.log(LogLevel::ERROR, "KLOGTEST", "Volume %d%%, pos %.1f s, used %llu of %llu", i % 100, i * 0.5, (unsigned long long)i * 4096, 32000000000ull);
+        snprintf(line, sizeof(line), "[E] [KLOGTEST] Volume %d%%, pos %.1f s, used %llu of %llu", i % 100, i * 0.5, (unsigned long long)i * 4096, 32000000000ull);
+        expected.push_back(line);
+        logger.log(LogLevel::DEBUG, "KLOGTEST", "Frame %u from %02X:%02X:%02X:%02X:%02X:%02X", (unsigned)i, 0xde, 0xad, 0xbe, 0xef, i & 0xff, 0x01);
+        snprintf(line, sizeof(line), "[D] [KLOGTEST] Frame %u from %02X:%02X:%02X:%02X:%02X:%02X", (unsigned)i, 0xde, 0xad, 0xbe, 0xef, i & 0xff, 0x01);
+        expected.push_back(line);
+        if (i % 50 == 49) logger.flush(); // Several batches, like the flusher's passes
+    }
+    logger.flush();
+    return expected;
+}
+
+void test_session_log_decodes_to_the_text_lines(void) {
+    volume = TestSandbox::mount("klog");
+    TEST_ASSERT_NOT_NULL(volume);
+    Logger::getInstance().setup();
+    uint32_t startMillis = millis();
+    std::vector<std::string> expected = logSession(300);
+
+    std::string hostLog = TestSandbox::hostPath(*volume, "/data/logs/system_log_latest.klog");
+    std::string decoded;
+    TEST_ASSERT_TRUE_MESSAGE(TestSandbox::decodeKlog(hostLog, decoded), "klog_decode.py failed");
+
+    std::vector<std::string> got;
+    std::istringstream lines(decoded);
+    std::string line;
+    unsigned long lastMillis = 0;
+    bool sawBoot = false;
+    while (std::getline(lines, line)) {
+        size_t space = line.find(' ');
+        TEST_ASSERT_TRUE(space != std::string::npos);
+        unsigned long at = strtoul(line.c_str(), nullptr, 10);
+        std::string rest = line.substr(space + 1);
+        if (rest == "[I] [LOGGER] --- System Boot ---") sawBoot = true;
+        if (rest.find("[KLOGTEST]") == 4) {
+            // Deltas add back up to the clock (other tasks' lines may land a millisecond out of order).
+            TEST_ASSERT_TRUE(at >= lastMillis && at >= startMillis && at <= millis());
+            lastMillis = at;
+            got.push_back(rest);
+        }
+    }
+    TEST_ASSERT_TRUE(sawBoot);
+    TEST_ASSERT_EQUAL_size_t(expected.size(), got.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), got[i].c_str());
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, Logger::getInstance().getDroppedLines());
+
+    std::string raw;
+    TEST_ASSERT_TRUE(TestSandbox::readHostFile(hostLog, raw));
+    size_t used = raw.find_last_not_of('\0') + 1; // The rest is preallocated
+    size_t text = 0;
+    for (const std::string& e : expected) text += e.size() + 2 + 8; // Plus "\r\n" and the millis
+    char message[128];
+    snprintf(message, sizeof(message), "%u lines: %u bytes as text, %u bytes in the .klog",
+             (unsigned)expected.size(), (unsigned)text, (unsigned)used);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(text / 2, used);
+}
+
+// The text path LOG() took before: the whole line formatted at the call site.
+template <typename... Args>
+static size_t textLine(char* out, const char* tag, const char* format, Args... args) {
+    const size_t room = 256 - 2;
+    int len = snprintf(out, room, "%lu [%c] [%s] ", 123456ul, 'I', tag);
+    int body = snprintf(out + len, room - len, format, args...);
+    if (body > 0) len += body;
+    if ((size_t)len >= room) len = room - 1;
+    out[len++] = '\r';
+    out[len++] = '\n';
+    return len;
+}
+
+template <typename... Args>
+static size_t binaryRecord(uint8_t* out, const char* tag, const char* format, Args... args) {
+    MessageHeader header = {1, 123456, format, tag};
+    return encode(out, 192, header, args...);
+}
+
+void test_benchmark_against_formatting(void) {
+    const int calls = 1000000;
+    volatile size_t sink = 0;
+    char text[256];
+    uint8_t record[192];
+    const char* wifi = "Connected to %s (ch %d, rssi %d dBm) in %lu ms";
+    const char* player = "Volume %d%%, pos %.1f s";
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) sink += textLine(text, "WIFI", wifi, SSID, i & 7, -(i & 63), (unsigned long)i);
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) sink += binaryRecord(record, "WIFI", wifi, SSID, i & 7, -(i & 63), (unsigned long)i);
+    auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) sink += textLine(text, "PLAYER", player, i & 63, i * 0.5);
+    auto t3 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) sink += binaryRecord(record, "PLAYER", player, i & 63, i * 0.5);
+    auto t4 = std::chrono::steady_clock::now();
+    auto nanos = [&](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+        return std::chrono::duration<double, std::nano>(b - a).count() / calls;
+    };
+
+    char message[160];
+    snprintf(message, sizeof(message), "wifi line: text %.0f ns, %u B | binary %.0f ns, %u B", nanos(t0, t1),
+             (unsigned)textLine(text, "WIFI", wifi, SSID, 6, -61, 1834ul), nanos(t1, t2),
+             (unsigned)binaryRecord(record, "WIFI", wifi, SSID, 6, -61, 1834ul));
+    TEST_MESSAGE(message);
+    snprintf(message, sizeof(message), "player line: text %.0f ns, %u B | binary %.0f ns, %u B", nanos(t2, t3),
+             (unsigned)textLine(text, "PLAYER", player, 5, 2.5), nanos(t3, t4),
+             (unsigned)binaryRecord(record, "PLAYER", player, 5, 2.5));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(nanos(t1, t2) < nanos(t0, t1));
+    TEST_ASSERT_TRUE(nanos(t3, t4) < nanos(t2, t3));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_render_matches_snprintf);
+    RUN_TEST(test_missing_and_cut_arguments);
+    RUN_TEST(test_varints_round_trip);
+    RUN_TEST(test_session_log_decodes_to_the_text_lines);
+    RUN_TEST(test_benchmark_against_formatting);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
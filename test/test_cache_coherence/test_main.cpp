@@ -0,0 +1,269 @@
+// SdCardManager's PSRAM file cache against writes: write-through, uncached writers,
+// failed opens and a read racing a write must never leave stale bytes cached. The races
+// are made deterministic by a backend that holds a read until the write has finished.
+
+#include <unity.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "TestSandbox.h"
+
+using SdCardManager::getInstance;
+
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {
+    volume = TestSandbox::mount("coherence");
+    TEST_ASSERT_NOT_NULL(volume);
+}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+}
+
+static SdCardManager::FileCacheStats stats() { return getInstance().getFileCacheStats(); }
+
+void test_second_read_is_a_hit(void) {
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/a.txt", "alpha"));
+    TEST_ASSERT_EQUAL_STRING("alpha", getInstance().readFile("/config/a.txt").c_str());
+    uint32_t hits = stats().hits;
+    TEST_ASSERT_EQUAL_STRING("alpha", getInstance().readFile("/config/a.txt").c_str());
+    TEST_ASSERT_EQUAL_UINT32(hits + 1, stats().hits);
+}
+
+void test_write_through_replaces_cached_copy(void) {
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/a.txt", "alpha"));
+    getInstance().readFile("/config/a.txt");
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/a.txt", "beta"));
+    uint32_t hits = stats().hits;
+    TEST_ASSERT_EQUAL_STRING("beta", getInstance().readFile("/config/a.txt").c_str());
+    TEST_ASSERT_EQUAL_UINT32(hits + 1, stats().hits);
+}
+
+void test_uncached_writer_blocks_caching_until_finished(void) {
+    TEST_ASSERT_TRUE(getInstance().writeFile("/data/stream.txt", "one\n"));
+    getInstance().readFile("/data/stream.txt");
+
+    File out = getInstance().openFileUncached("/data/stream.txt", FILE_APPEND);
+    TEST_ASSERT_TRUE((bool)out);
+    TEST_ASSERT_EQUAL_size_t(1, stats().openWrites);
+    out.print("two\n");
+    out.flush();
+    // Streamed from the card while the writer is open, never cached.
+    size_t entries = stats().entries;
+    TEST_ASSERT_EQUAL_STRING("one\ntwo\n", getInstance().readFile("/data/stream.txt").c_str());
+    TEST_ASSERT_EQUAL_size_t(entries, stats().entries);
+    out.print("three\n");
+    out.close();
+    getInstance().finishWrite("/data/stream.txt");
+
+    TEST_ASSERT_EQUAL_size_t(0, stats().openWrites);
+    TEST_ASSERT_EQUAL_STRING("one\ntwo\nthree\n", getInstance().readFile("/data/stream.txt").c_str());
+    uint32_t hits = stats().hits;
+    getInstance().readFile("/data/stream.txt");
+    TEST_ASSERT_EQUAL_UINT32(hits + 1, stats().hits);
+}
+
+void test_failed_open_does_not_pin_the_path(void) {
+    File out = getInstance().openFileUncached("/nowhere/x.txt", FILE_WRITE);
+    TEST_ASSERT_FALSE((bool)out);
+    TEST_ASSERT_EQUAL_size_t(0, stats().openWrites);
+
+    // Once the file can exist it caches like any other.
+    TEST_ASSERT_TRUE(getInstance().createDir("/nowhere"));
+    TEST_ASSERT_TRUE(getInstance().writeFile("/nowhere/x.txt", "here"));
+    getInstance().readFile("/nowhere/x.txt");
+    uint32_t hits = stats().hits;
+    TEST_ASSERT_EQUAL_STRING("here", getInstance().readFile("/nowhere/x.txt").c_str());
+    TEST_ASSERT_EQUAL_UINT32(hits + 1, stats().hits);
+}
+
+void test_finished_writers_leave_nothing_behind(void) {
+    char path[48];
+    for (int i = 0; i < 500; ++i) {
+        snprintf(path, sizeof(path), "/data/captures/cap_%03d.pcap", i);
+        File out = getInstance().openFileUncached(path, FILE_WRITE);
+        TEST_ASSERT_TRUE((bool)out);
+        out.print("x");
+        out.close();
+        getInstance().finishWrite(path);
+    }
+    TEST_ASSERT_EQUAL_size_t(0, stats().openWrites);
+    // Each is cacheable straight away.
+    getInstance().readFile(path);
+    uint32_t hits = stats().hits;
+    getInstance().readFile(path);
+    TEST_ASSERT_EQUAL_UINT32(hits + 1, stats().hits);
+}
+
+void test_rename_and_delete_drop_cached_copies(void) {
+    TEST_ASSERT_TRUE(getInstance().writeFile("/user/a.txt", "first"));
+    getInstance().readFile("/user/a.txt");
+    TEST_ASSERT_TRUE(getInstance().renameFile("/user/a.txt", "/user/b.txt"));
+    TEST_ASSERT_EQUAL_STRING("", getInstance().readFile("/user/a.txt").c_str());
+    TEST_ASSERT_EQUAL_STRING("first", getInstance().readFile("/user/b.txt").c_str());
+    TEST_ASSERT_TRUE(getInstance().deleteFile("/user/b.txt"));
+    TEST_ASSERT_EQUAL_STRING("", getInstance().readFile("/user/b.txt").c_str());
+}
+
+namespace {
+
+    // Holds the first read of `path` after it has taken its bytes off the card, until
+    // released: the window in which a racing write must stop the bytes being cached.
+    class Gate {
+    public:
+        void arm(const char* path) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            path_ = path;
+            reached_ = released_ = false;
+        }
+        void passing(const char* path) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (path_.empty() || path_ != path) return;
+            path_.clear();
+            reached_ = true;
+            cv_.notify_all();
+            cv_.wait(lock, [this]() { return released_; });
+        }
+        void waitReached() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return reached_; });
+        }
+        void release() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            released_ = true;
+            cv_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::string path_;
+        bool reached_ = false;
+        bool released_ = false;
+    };
+
+    class GatedFile : public IStorageFile {
+    public:
+        GatedFile(std::unique_ptr<IStorageFile> inner, Gate& gate) : inner_(std::move(inner)), gate_(gate) {}
+        size_t read(uint8_t* buf, size_t len) override {
+            size_t n = inner_->read(buf, len);
+            gate_.passing(inner_->path());
+            return n;
+        }
+        size_t write(const uint8_t* buf, size_t len) override { return inner_->write(buf, len); }
+        bool seek(uint64_t pos) override { return inner_->seek(pos); }
+        uint64_t position() const override { return inner_->position(); }
+        uint64_t size() const override { return inner_->size(); }
+        bool flush() override { return inner_->flush(); }
+        void close() override { inner_->close(); }
+        bool isOpen() const override { return inner_->isOpen(); }
+        bool isDirectory() const override { return inner_->isDirectory(); }
+        const char* name() const override { return inner_->name(); }
+        const char* path() const override { return inner_->path(); }
+        time_t lastWrite() override { return inner_->lastWrite(); }
+        std::unique_ptr<IStorageFile> openNext() override { return inner_->openNext(); }
+        void rewind() override { inner_->rewind(); }
+
+    private:
+        std::unique_ptr<IStorageFile> inner_;
+        Gate& gate_;
+    };
+
+    class GatedBackend : public IStorageBackend {
+    public:
+        GatedBackend(IStorageBackend& inner, Gate& gate) : inner_(inner), gate_(gate) {}
+        bool begin() override { return inner_.begin(); }
+        void end() override { inner_.end(); }
+        const char* name() const override { return "GATED"; }
+        bool exists(const char* path) override { return inner_.exists(path); }
+        bool mkdir(const char* path) override { return inner_.mkdir(path); }
+        bool remove(const char* path) override { return inner_.remove(path); }
+        bool rename(const char* pathFrom, const char* pathTo) override { return inner_.rename(pathFrom, pathTo); }
+        std::unique_ptr<IStorageFile> open(const char* path, StorageMode mode) override {
+            auto file = inner_.open(path, mode);
+            return file ? std::make_unique<GatedFile>(std::move(file), gate_) : nullptr;
+        }
+        uint64_t totalBytes() override { return inner_.totalBytes(); }
+        uint64_t usedBytes() override { return inner_.usedBytes(); }
+        uint32_t clusterSize() override { return inner_.clusterSize(); }
+
+    private:
+        IStorageBackend& inner_;
+        Gate& gate_;
+    };
+
+    Gate gate;
+
+    void mountGated() {
+        TestSandbox::removeTree(volume->getRootDir());
+        volume = new PosixStorageBackend(TestSandbox::makeDir("coherence-gated"));
+        TestSandbox::volumes().emplace_back(volume);
+        TEST_ASSERT_TRUE(getInstance().setup(std::unique_ptr<IStorageBackend>(new GatedBackend(*volume, gate))));
+        getInstance().invalidateAll();
+        TestSandbox::waitForSpaceScan();
+    }
+
+    // A read of `path` that has the old bytes in hand while `write` runs to completion.
+    String readAcross(const char* path, const std::function<void()>& write) {
+        gate.arm(path);
+        String seen;
+        std::thread reader([&]() { seen = getInstance().readFile(path); });
+        gate.waitReached();
+        write();
+        gate.release();
+        reader.join();
+        return seen;
+    }
+
+} // namespace
+
+void test_read_racing_a_write_is_not_cached(void) {
+    mountGated();
+    const char* path = "/config/counter.txt";
+    TEST_ASSERT_TRUE(getInstance().writeFile(path, "old"));
+    // Nothing has a write open on the path when the read starts, so it samples the shared stamp.
+    TEST_ASSERT_EQUAL_STRING("old", readAcross(path, [&]() {
+        TEST_ASSERT_TRUE(getInstance().writeFile(path, "new"));
+    }).c_str());
+    TEST_ASSERT_EQUAL_STRING("new", getInstance().readFile(path).c_str());
+}
+
+void test_read_racing_another_files_write_is_still_correct(void) {
+    mountGated();
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/a.txt", "a"));
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/b.txt", "b"));
+    readAcross("/config/a.txt", [&]() { TEST_ASSERT_TRUE(getInstance().writeFile("/config/b.txt", "bb")); });
+    TEST_ASSERT_EQUAL_STRING("a", getInstance().readFile("/config/a.txt").c_str());
+    TEST_ASSERT_EQUAL_STRING("bb", getInstance().readFile("/config/b.txt").c_str());
+}
+
+void test_read_racing_an_uncached_stream_is_not_cached(void) {
+    mountGated();
+    const char* path = "/data/stream.txt";
+    TEST_ASSERT_TRUE(getInstance().writeFile(path, "one\n"));
+    readAcross(path, [&]() {
+        File out = getInstance().openFileUncached(path, FILE_APPEND);
+        out.print("two\n");
+        out.close();
+        getInstance().finishWrite(path);
+    });
+    TEST_ASSERT_EQUAL_STRING("one\ntwo\n", getInstance().readFile(path).c_str());
+    TEST_ASSERT_EQUAL_size_t(0, stats().openWrites);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_second_read_is_a_hit);
+    RUN_TEST(test_write_through_replaces_cached_copy);
+    RUN_TEST(test_uncached_writer_blocks_caching_until_finished);
+    RUN_TEST(test_failed_open_does_not_pin_the_path);
+    RUN_TEST(test_finished_writers_leave_nothing_behind);
+    RUN_TEST(test_rename_and_delete_drop_cached_copies);
+    RUN_TEST(test_read_racing_a_write_is_not_cached);
+    RUN_TEST(test_read_racing_another_files_write_is_still_correct);
+    RUN_TEST(test_read_racing_an_uncached_stream_is_not_cached);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
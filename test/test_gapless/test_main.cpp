@@ -0,0 +1,225 @@
+// AudioSlotMixer track changes through the real AudioOutputPDM, down to what reaches the
+// I2S driver: a pre-rolled track spliced on with no frame lost or inserted, a handoff to
+// another sample rate once the ring has played out, and the output level staying flat
+// through an equal-power crossfade.
+
+#include <unity.h>
+#include <cmath>
+#include <stdlib.h>
+#include <vector>
+#include "AudioSlotMixer.h"
+#include "AudioOutputPDM.h"
+
+void setUp(void) {
+    NativeShim::I2sPort& port = NativeShim::i2sPort(I2S_NUM_0);
+    std::lock_guard<std::mutex> lock(port.mutex);
+    port.written.clear();
+    port.installs.clear();
+}
+
+void tearDown(void) {}
+
+namespace {
+
+    // Hands an Input one frame per ConsumeSample(), as AudioGeneratorMP3 does.
+    struct Generator {
+        AudioSlotMixer::Input* input;
+        std::vector<int16_t> pcm; // Mono, sent to both channels
+        int rate = 44100;
+        size_t pos = 0;
+        bool started = false;
+
+        // Offers up to `most` frames; false once the track is out of frames.
+        bool loop(size_t most = SIZE_MAX) {
+            if (!started) {
+                input->SetRate(rate);
+                started = true;
+            }
+            size_t end = pos + std::min(most, pcm.size() - pos);
+            while (pos < end) {
+                int16_t frame[2] = {pcm[pos], pcm[pos]};
+                if (!input->ConsumeSample(frame)) return true; // Held on to, offered again next time
+                pos++;
+            }
+            return pos < pcm.size();
+        }
+    };
+
+    std::vector<int16_t> ramp(size_t frames, int base) {
+        std::vector<int16_t> out(frames);
+        for (size_t i = 0; i < frames; ++i) out[i] = (int16_t)(base + i % 5000);
+        return out;
+    }
+
+    std::vector<int16_t> noise(size_t frames, unsigned seed) {
+        srand(seed);
+        std::vector<int16_t> out(frames);
+        for (int16_t& s : out) s = (int16_t)(rand() % 16001 - 8000);
+        return out;
+    }
+
+    // Runs the mixer until `input` has been mixed out.
+    void drain(AudioSlotMixer& mixer, AudioOutputPDM& pdm, AudioSlotMixer::Input* input) {
+        while (input->isActive()) {
+            if (!mixer.loop()) pdm.waitForRoom(pdMS_TO_TICKS(10));
+        }
+    }
+
+    // Mono samples that reached the DAC, once `frames` have (the output stage writes both channels).
+    std::vector<int16_t> dacOutput(size_t frames) {
+        NativeShim::I2sPort& port = NativeShim::i2sPort(I2S_NUM_0);
+        uint32_t start = millis();
+        while (millis() - start < 5000) {
+            {
+                std::lock_guard<std::mutex> lock(port.mutex);
+                if (port.written.size() >= 2 * frames) break;
+            }
+            delay(1);
+        }
+        std::lock_guard<std::mutex> lock(port.mutex);
+        std::vector<int16_t> mono;
+        for (size_t i = 0; i + 1 < port.written.size(); i += 2) mono.push_back(port.written[i]);
+        return mono;
+    }
+
+} // namespace
+
+void test_pre_rolled_track_follows_with_no_gap(void) {
+    AudioOutputPDM pdm(1);
+    AudioSlotMixer mixer(&pdm);
+    // Neither length is a whole number of blocks, so the splice lands mid-block.
+    Generator a{mixer.getInput(0), ramp(44100 + 37, 1)};
+    Generator b{mixer.getInput(1), ramp(30000 + 11, 10000)};
+    a.input->begin();
+    b.input->hold();
+    b.input->begin();
+
+    bool aDone = false;
+    for (;;) {
+        if (!aDone && !a.loop()) {
+            a.input->stop();
+            mixer.follow(a.input, b.input);
+            aDone = true;
+        }
+        bool bMore = b.loop(); // Pre-rolls one block while held, then plays on
+        if (!mixer.loop()) pdm.waitForRoom(pdMS_TO_TICKS(10));
+        if (aDone && !bMore) break;
+    }
+    b.input->stop();
+    drain(mixer, pdm, b.input);
+
+    std::vector<int16_t> expected = a.pcm;
+    expected.insert(expected.end(), b.pcm.begin(), b.pcm.end());
+    std::vector<int16_t> out = dacOutput(expected.size());
+    char message[96];
+    snprintf(message, sizeof(message), "%u frames out for %u + %u", (unsigned)out.size(), (unsigned)a.pcm.size(), (unsigned)b.pcm.size());
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_size_t(expected.size(), out.size());
+    for (size_t i = 0; i < expected.size(); ++i) TEST_ASSERT_EQUAL_INT16(expected[i], out[i]);
+    TEST_ASSERT_EQUAL_UINT32(0, a.input->getStartPosition());
+    TEST_ASSERT_EQUAL_UINT32(a.pcm.size(), b.input->getStartPosition());
+}
+
+void test_rate_change_waits_for_the_ring_to_play_out(void) {
+    AudioOutputPDM pdm(1);
+    AudioSlotMixer mixer(&pdm);
+    Generator a{mixer.getInput(0), ramp(1000, 1)};
+    Generator b{mixer.getInput(1), ramp(1000, 10000)};
+    b.rate = 48000;
+    a.input->begin();
+    a.loop();
+    mixer.loop();
+    b.input->hold();
+    b.input->begin();
+    b.loop();
+
+    // The DAC is stopped, so all of the first track is still in the ring when it ends.
+    pdm.stop();
+    while (a.loop()) mixer.loop();
+    a.input->stop();
+    mixer.follow(a.input, b.input);
+    for (int i = 0; i < 20; ++i) {
+        mixer.loop();
+        delay(1);
+    }
+    TEST_ASSERT_FALSE(a.input->isActive());
+    TEST_ASSERT_FALSE(b.input->hasStarted()); // Waiting: switching now would replay the ring at 48 kHz
+    TEST_ASSERT_EQUAL_UINT32(44100, NativeShim::i2sPort(I2S_NUM_0).sampleRate);
+
+    pdm.begin(); // The DAC runs again and plays the ring out
+    while (b.loop()) {
+        if (!mixer.loop()) pdm.waitForRoom(pdMS_TO_TICKS(10));
+    }
+    b.input->stop();
+    drain(mixer, pdm, b.input);
+
+    std::vector<int16_t> out = dacOutput(2000);
+    TEST_ASSERT_EQUAL_size_t(2000, out.size());
+    for (size_t i = 0; i < 1000; ++i) {
+        TEST_ASSERT_EQUAL_INT16(a.pcm[i], out[i]);
+        TEST_ASSERT_EQUAL_INT16(b.pcm[i], out[1000 + i]);
+    }
+    const std::vector<NativeShim::I2sRateChange>& installs = NativeShim::i2sPort(I2S_NUM_0).installs;
+    TEST_ASSERT_EQUAL_size_t(2, installs.size());
+    TEST_ASSERT_EQUAL_UINT32(44100, installs[0].sampleRate);
+    TEST_ASSERT_EQUAL_UINT32(48000, installs[1].sampleRate);
+    TEST_ASSERT_EQUAL_size_t(2 * 1000, installs[1].writtenBefore); // Exactly at the track boundary
+}
+
+void test_crossfade_keeps_the_level(void) {
+    AudioOutputPDM pdm(1);
+    AudioSlotMixer mixer(&pdm);
+    const size_t frames = 44100 * 4, fade = 44100 * 2;
+    Generator a{mixer.getInput(0), noise(frames, 1)};
+    Generator b{mixer.getInput(1), noise(frames, 2)}; // Uncorrelated: powers add
+    a.input->begin();
+    while (a.pos < frames - fade) {
+        a.loop(1000);
+        if (!mixer.loop()) pdm.waitForRoom(pdMS_TO_TICKS(10));
+        if (a.pos > frames - fade - 5000 && !b.input->isActive()) {
+            b.input->hold();
+            b.input->begin();
+            b.loop();
+        }
+    }
+    TEST_ASSERT_TRUE(mixer.crossfade(a.input, b.input, fade));
+    while (b.pos < frames - 1000) {
+        if (!a.loop()) a.input->stop();
+        b.loop();
+        if (!mixer.loop()) pdm.waitForRoom(pdMS_TO_TICKS(10));
+    }
+    TEST_ASSERT_FALSE(mixer.isFading());
+    TEST_ASSERT_FALSE(a.input->isActive()); // Faded out and dropped
+    b.input->stop();
+    drain(mixer, pdm, b.input);
+
+    size_t fadeStart = b.input->getStartPosition();
+    std::vector<int16_t> out = dacOutput(fadeStart + fade);
+    TEST_ASSERT_TRUE(out.size() >= fadeStart + fade);
+    auto rms = [&](size_t from, size_t count) {
+        double power = 0;
+        for (size_t i = from; i < from + count; ++i) power += (double)out[i] * out[i];
+        return std::sqrt(power / count);
+    };
+    double reference = rms(0, 44100); // The first track on its own
+    double low = 1e9, high = 0;
+    const size_t window = 4410; // 100 ms
+    for (size_t s = fadeStart; s + window <= fadeStart + fade; s += window) {
+        double level = rms(s, window);
+        low = std::min(low, level);
+        high = std::max(high, level);
+    }
+    double lowDb = 20 * std::log10(low / reference), highDb = 20 * std::log10(high / reference);
+    char message[96];
+    snprintf(message, sizeof(message), "RMS through a 2 s crossfade: %.2f..%.2f dB of one track", lowDb, highDb);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(lowDb > -0.5 && highDb < 0.5); // A linear fade would dip 3 dB halfway
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pre_rolled_track_follows_with_no_gap);
+    RUN_TEST(test_rate_change_waits_for_the_ring_to_play_out);
+    RUN_TEST(test_crossfade_keeps_the_level);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
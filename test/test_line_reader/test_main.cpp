@@ -0,0 +1,256 @@
+// LineReader's string_view lines against the String-per-line reads they replaced, on a
+// cached (PSRAM) and a streamed (too large to cache) file in a PosixStorageBackend
+// sandbox: the same lines come out, overlong lines arrive in pieces, readInto() fills a
+// caller buffer, and the benchmark counts heap allocations per line (asserted) and
+// reports lines/s (not asserted: wall-clock figures vary with the host's load).
+
+#include <unity.h>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "TestSandbox.h"
+
+using SdCardManager::getInstance;
+
+// Every heap allocation in the process, so a benchmark can count the ones its reads make.
+static std::atomic<uint64_t> allocations{0};
+
+// The array forms too, so every new is paired with a matching delete.
+static void* countedAlloc(size_t size) {
+    allocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static const size_t CACHEABLE_BYTES = 7 * 1024 * 1024 / 8; // SdCardManager's MAX_CACHEABLE_FILE_SIZE
+static const char* CACHED_PATH = "/data/known_networks.csv";
+static const char* STREAMED_PATH = "/data/probes_archive.csv"; // Too large to cache
+static const int CACHED_LINES = 10000;
+static const int STREAMED_LINES = 25000;
+
+static PosixStorageBackend* volume = nullptr;
+static std::vector<std::string> cachedLines, streamedLines; // Trimmed, blank lines left out
+
+// A known-networks style file: CRLF on some lines, stray blanks and padding on others.
+static std::string makeFile(int lines, std::vector<std::string>& expected) {
+    std::string out;
+    expected.clear();
+    char line[96];
+    for (int i = 0; i < lines; ++i) {
+        snprintf(line, sizeof(line), "HomeNetwork_%05d,correct-horse-battery-%05d,%d", i, i * 7, 1700000000 + i);
+        expected.push_back(line);
+        if (i % 97 == 0) out += "  ";
+        out += line;
+        out += (i % 3 == 0) ? "\r\n" : "\n";
+        if (i % 50 == 0) out += " \t\n";
+    }
+    return out;
+}
+
+void setUp(void) {
+    volume = TestSandbox::mount("linereader");
+    TEST_ASSERT_NOT_NULL(volume);
+    TEST_ASSERT_TRUE(getInstance().exists("/data") || getInstance().createDir("/data"));
+    std::string cached = makeFile(CACHED_LINES, cachedLines);
+    std::string streamed = makeFile(STREAMED_LINES, streamedLines);
+    TEST_ASSERT_TRUE(cached.size() < CACHEABLE_BYTES);
+    TEST_ASSERT_TRUE(streamed.size() > CACHEABLE_BYTES);
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, CACHED_PATH), cached));
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, STREAMED_PATH), streamed));
+}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+}
+
+namespace {
+
+    // The loop LineReader::readLine() ran before: a String per line from readStringUntil(), trimmed.
+    String oldReadLine(ICachedFileReader& reader) {
+        while (reader.available()) {
+            String line = reader.readStringUntil('\n');
+            line.trim();
+            if (!line.isEmpty()) return line;
+        }
+        return "";
+    }
+
+    // The same over a streamed file, which went through File::readStringUntil() a byte at a time.
+    String oldReadLine(File& file) {
+        while (file.available()) {
+            String line = file.readStringUntil('\n');
+            line.trim();
+            if (!line.isEmpty()) return line;
+        }
+        return "";
+    }
+
+    struct Run {
+        uint32_t micros;
+        uint64_t allocations;
+        size_t lines;
+        size_t bytes; // Sum of line lengths, so the work cannot be optimised out
+    };
+
+    Run viewLines(const char* path) {
+        Run run{0, 0, 0, 0};
+        uint64_t before = allocations;
+        uint32_t start = micros();
+        SdCardManager::LineReader reader = getInstance().openLineReader(path);
+        std::string_view line;
+        while (reader.readLine(line)) {
+            run.lines++;
+            run.bytes += line.size();
+        }
+        reader.close();
+        run.micros = micros() - start;
+        run.allocations = allocations - before;
+        return run;
+    }
+
+    Run stringLines(const char* path, bool streamed) {
+        Run run{0, 0, 0, 0};
+        uint64_t before = allocations;
+        uint32_t start = micros();
+        if (streamed) {
+            File file = getInstance().openFileUncached(path, FILE_READ);
+            for (String line = oldReadLine(file); !line.isEmpty(); line = oldReadLine(file)) {
+                run.lines++;
+                run.bytes += line.length();
+            }
+            file.close();
+        } else {
+            std::unique_ptr<ICachedFileReader> reader = getInstance().open(path);
+            for (String line = oldReadLine(*reader); !line.isEmpty(); line = oldReadLine(*reader)) {
+                run.lines++;
+                run.bytes += line.length();
+            }
+        }
+        run.micros = micros() - start;
+        run.allocations = allocations - before;
+        return run;
+    }
+
+    void report(const char* what, const Run& oldRun, const Run& newRun) {
+        char line[200];
+        snprintf(line, sizeof(line), "%s, %u lines: String %.0f lines/s, %.2f allocs/line; string_view %.0f lines/s, %lu allocs in all",
+                 what, (unsigned)newRun.lines, oldRun.lines * 1e6 / std::max<uint32_t>(oldRun.micros, 1),
+                 (double)oldRun.allocations / oldRun.lines, newRun.lines * 1e6 / std::max<uint32_t>(newRun.micros, 1),
+                 (unsigned long)newRun.allocations);
+        TEST_MESSAGE(line);
+    }
+
+} // namespace
+
+void test_view_lines_match_the_string_lines(void) {
+    for (const char* path : {CACHED_PATH, STREAMED_PATH}) {
+        const std::vector<std::string>& expected = (path == CACHED_PATH) ? cachedLines : streamedLines;
+        SdCardManager::LineReader reader = getInstance().openLineReader(path);
+        TEST_ASSERT_TRUE(reader.isOpen());
+        std::string_view line;
+        size_t i = 0;
+        while (reader.readLine(line)) {
+            TEST_ASSERT_TRUE(i < expected.size());
+            TEST_ASSERT_TRUE_MESSAGE(line == expected[i], path);
+            i++;
+        }
+        TEST_ASSERT_EQUAL_size_t(expected.size(), i);
+        TEST_ASSERT_FALSE(reader.readLine(line)); // Stays at the end
+        TEST_ASSERT_TRUE(reader.readLine().isEmpty());
+    }
+}
+
+void test_overlong_streamed_lines_arrive_in_pieces(void) {
+    // Past the refill buffer and too large to cache, so it is streamed.
+    std::string longLine(3000, 'x');
+    for (size_t i = 0; i < longLine.size(); i += 100) longLine[i] = 'a' + (i / 100) % 26;
+    std::string contents = longLine + "\nshort\n";
+    contents += std::string(CACHEABLE_BYTES, '\n');
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, "/data/long.txt"), contents));
+
+    std::unique_ptr<ICachedFileReader> reader = getInstance().open("/data/long.txt");
+    TEST_ASSERT_NOT_NULL(reader.get());
+    std::string joined;
+    std::string_view piece;
+    int pieces = 0;
+    while (joined.size() < longLine.size() && reader->readUntil('\n', piece)) {
+        TEST_ASSERT_TRUE(piece.size() > 0);
+        joined.append(piece.data(), piece.size());
+        pieces++;
+    }
+    TEST_ASSERT_EQUAL_INT(3, pieces); // Two full 1 KB buffers, then the rest up to the terminator
+    TEST_ASSERT_TRUE(joined == longLine);
+    TEST_ASSERT_TRUE(reader->readUntil('\n', piece));
+    TEST_ASSERT_TRUE(piece == "short");
+}
+
+void test_read_into_fills_and_terminates_the_buffer(void) {
+    std::string contents;
+    TEST_ASSERT_TRUE(TestSandbox::readHostFile(TestSandbox::hostPath(*volume, CACHED_PATH), contents));
+    std::vector<char> buffer(contents.size() + 1, '#');
+    TEST_ASSERT_EQUAL_size_t(contents.size(), getInstance().readInto(CACHED_PATH, buffer.data(), buffer.size()));
+    TEST_ASSERT_EQUAL_MEMORY(contents.data(), buffer.data(), contents.size());
+    TEST_ASSERT_EQUAL_CHAR('\0', buffer[contents.size()]);
+
+    char small[64];
+    TEST_ASSERT_EQUAL_size_t(sizeof(small) - 1, getInstance().readInto(CACHED_PATH, small, sizeof(small)));
+    TEST_ASSERT_EQUAL_MEMORY(contents.data(), small, sizeof(small) - 1);
+    TEST_ASSERT_EQUAL_CHAR('\0', small[sizeof(small) - 1]);
+
+    TEST_ASSERT_EQUAL_size_t(0, getInstance().readInto("/data/missing.csv", small, sizeof(small)));
+    TEST_ASSERT_EQUAL_CHAR('\0', small[0]);
+}
+
+void test_benchmark_lines_per_second_and_allocations(void) {
+    getInstance().open(CACHED_PATH); // Into the cache, so both readers start from PSRAM
+
+    Run oldCached = stringLines(CACHED_PATH, false);
+    Run newCached = viewLines(CACHED_PATH);
+    Run oldStreamed = stringLines(STREAMED_PATH, true);
+    Run newStreamed = viewLines(STREAMED_PATH);
+    report("Cached", oldCached, newCached);
+    report("Streamed", oldStreamed, newStreamed);
+
+    // Whole files: readFile()'s String against readInto() a buffer the caller already has.
+    std::vector<char> buffer(CACHEABLE_BYTES);
+    uint64_t before = allocations;
+    String text = getInstance().readFile(CACHED_PATH);
+    uint64_t readFileAllocs = allocations - before;
+    before = allocations;
+    size_t copied = getInstance().readInto(CACHED_PATH, buffer.data(), buffer.size());
+    uint64_t readIntoAllocs = allocations - before;
+    char line[160];
+    snprintf(line, sizeof(line), "Whole cached file (%u bytes): readFile %lu allocs, readInto %lu allocs",
+             (unsigned)copied, (unsigned long)readFileAllocs, (unsigned long)readIntoAllocs);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_size_t(CACHED_LINES, newCached.lines);
+    TEST_ASSERT_EQUAL_size_t(oldCached.bytes, newCached.bytes);
+    TEST_ASSERT_EQUAL_size_t(STREAMED_LINES, newStreamed.lines);
+    TEST_ASSERT_EQUAL_size_t(oldStreamed.bytes, newStreamed.bytes);
+    TEST_ASSERT_EQUAL_size_t(text.length(), copied);
+    // A String per line before; now only opening the file (and a streamed one's refill buffer).
+    TEST_ASSERT_TRUE(oldCached.allocations >= CACHED_LINES);
+    TEST_ASSERT_TRUE(oldStreamed.allocations >= STREAMED_LINES);
+    TEST_ASSERT_TRUE(newCached.allocations <= 16);
+    TEST_ASSERT_TRUE(newStreamed.allocations <= 16);
+    TEST_ASSERT_TRUE(readIntoAllocs < readFileAllocs);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_view_lines_match_the_string_lines);
+    RUN_TEST(test_overlong_streamed_lines_arrive_in_pieces);
+    RUN_TEST(test_read_into_fills_and_terminates_the_buffer);
+    RUN_TEST(test_benchmark_lines_per_second_and_allocations);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
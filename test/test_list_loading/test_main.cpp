@@ -0,0 +1,227 @@
+// The real ListMenu and TextFileListDataSource, driven frame by frame over SdCardManager
+// on a FaultInjectingBackend with per-operation latency. The card holds the walk at set
+// points, so what each frame shows is fixed: the loading row first, then the first names
+// while the walk is still going; the cursor stays put while the list grows, and backing
+// out stops the walk. Timings are reported, not asserted.
+
+#include <unity.h>
+#include <algorithm>
+#include "TestSandbox.h"
+#include "App.h"
+#include "ListMenu.h"
+#include "TextFileListDataSource.h"
+
+using SdCardManager::getInstance;
+
+static const int LOG_FILES = 1500;
+static const int PROBE_FILES = 40; // Plus one .csv that the list skips
+static const uint32_t LATENCY_MICROS = 400;
+
+static FaultInjectingBackend* faults = nullptr;
+static PosixStorageBackend* volume = nullptr;
+
+// A slow card whose directory walks stop after `entries` more entries, until the next call.
+static void holdAfter(uint64_t entries) {
+    FaultInjectingBackend::Faults slow;
+    slow.latencyMicros = LATENCY_MICROS;
+    slow.holdAfterEntries = entries;
+    faults->setFaults(slow);
+}
+
+void setUp(void) {
+    faults = TestSandbox::mountWithFaults("listload", &volume);
+    TEST_ASSERT_NOT_NULL(faults);
+    for (const char* dir : {"/data", SD_ROOT::DATA_LOGS, "/data/captures", SD_ROOT::DATA_PROBES}) {
+        TEST_ASSERT_TRUE(getInstance().exists(dir) || getInstance().createDir(dir));
+    }
+    char name[64];
+    for (int i = 0; i < LOG_FILES; ++i) {
+        snprintf(name, sizeof(name), "%s/session_%04d.klog", SD_ROOT::DATA_LOGS, i);
+        TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, name), "log"));
+    }
+    for (int i = 0; i < PROBE_FILES; ++i) {
+        snprintf(name, sizeof(name), "%s/probes_%02d.txt", SD_ROOT::DATA_PROBES, i);
+        TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, name), "ssid"));
+    }
+    snprintf(name, sizeof(name), "%s/probes.csv", SD_ROOT::DATA_PROBES);
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, name), "ssid"));
+    getInstance().invalidateAll(); // Every listing comes off the card
+
+    holdAfter(FaultInjectingBackend::UNLIMITED);
+}
+
+void tearDown(void) {
+    if (faults) faults->setFaults(FaultInjectingBackend::Faults());
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+    faults = nullptr;
+}
+
+namespace {
+
+    struct FrameResult {
+        uint32_t micros;  // onUpdate() plus draw()
+        bool drewItem;    // A file name reached the display
+        bool drewLoading; // So did the loading row
+    };
+
+    // One pass of the main loop for the active menu, as App::loop() runs it.
+    FrameResult frame(ListMenu& menu, App& app, U8G2& display) {
+        display.clear();
+        uint32_t start = micros();
+        menu.onUpdate(&app);
+        menu.draw(&app, display);
+        FrameResult result{(uint32_t)(micros() - start), false, false};
+        for (const std::string& s : display.strings) {
+            if (s.compare(0, 7, "Loading") == 0) result.drewLoading = true;
+            else if (!s.empty()) result.drewItem = true;
+        }
+        return result;
+    }
+
+    // Frames until the list holds `count` items; false if they never arrive.
+    bool framesUntil(ListMenu& menu, App& app, U8G2& display, TextFileListDataSource& source, int count) {
+        uint32_t start = millis();
+        while (source.getNumberOfItems(&app) < count) {
+            if (millis() - start > 10000) return false;
+            frame(menu, app, display);
+            delay(5);
+        }
+        return true;
+    }
+
+    // The path the text viewer would open for the highlighted row.
+    std::string selectedPath(ListMenu& menu, App& app) {
+        app.textViewerMenu.file.clear();
+        menu.handleInput(InputEvent::BTN_OK_PRESS, &app);
+        return app.textViewerMenu.file;
+    }
+
+} // namespace
+
+void test_first_items_are_drawn_long_before_the_walk_ends(void) {
+    App app;
+    U8G2 display;
+    TextFileListDataSource source;
+    ListMenu menu("Logs & Captures", MenuType::TEXT_FILE_LIST, &source);
+
+    holdAfter(0); // The card answers nothing until the first frame is on screen
+    uint32_t start = millis();
+    menu.onEnter(&app, true);
+    uint32_t enterMs = millis() - start;
+    FrameResult first = frame(menu, app, display);
+    TEST_ASSERT_TRUE(first.drewLoading); // Not "No items" while the card is still being read
+    TEST_ASSERT_FALSE(first.drewItem);
+
+    // The first 20 names reach the screen while the walk is pinned behind them.
+    holdAfter(20);
+    TEST_ASSERT_TRUE(framesUntil(menu, app, display, source, 20));
+    FrameResult partial = frame(menu, app, display);
+    TEST_ASSERT_TRUE(partial.drewItem);
+    TEST_ASSERT_TRUE(source.isLoading());
+    TEST_ASSERT_EQUAL_INT(20, source.getNumberOfItems(&app));
+
+    holdAfter(FaultInjectingBackend::UNLIMITED);
+    uint32_t releasedAt = millis();
+    uint32_t slowestFrameMicros = 0, frames = 2;
+    while (millis() - releasedAt < 30000) {
+        FrameResult result = frame(menu, app, display);
+        frames++;
+        slowestFrameMicros = std::max(slowestFrameMicros, result.micros);
+        if (!source.isLoading()) break;
+        delay(16); // ~60 fps
+    }
+    uint32_t fullMs = millis() - releasedAt;
+    menu.onExit(&app);
+    unsigned long redraws = app.redrawRequests;
+
+    // Unheld, for the report: how soon a fresh walk puts names on screen.
+    getInstance().invalidateAll();
+    TextFileListDataSource again;
+    ListMenu menuAgain("Logs & Captures", MenuType::TEXT_FILE_LIST, &again);
+    start = millis();
+    menuAgain.onEnter(&app, true);
+    while (millis() - start < 30000 && !frame(menuAgain, app, display).drewItem) delay(16);
+    uint32_t firstItemsMs = millis() - start;
+    menuAgain.onExit(&app);
+
+    char line[200];
+    snprintf(line, sizeof(line), "%d files at %u us/op: onEnter %lu ms, first items drawn at %lu ms, full list at %lu ms; slowest of %lu frames %lu us",
+             LOG_FILES + PROBE_FILES, (unsigned)LATENCY_MICROS, (unsigned long)enterMs, (unsigned long)firstItemsMs,
+             (unsigned long)fullMs, (unsigned long)frames, (unsigned long)slowestFrameMicros);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_INT(LOG_FILES + PROBE_FILES, source.getNumberOfItems(&app));
+    TEST_ASSERT_FALSE(source.isLoading());
+    TEST_ASSERT_TRUE(redraws >= frames); // Every frame while loading asks for the next
+}
+
+void test_cursor_stays_on_its_item_while_the_list_grows(void) {
+    App app;
+    U8G2 display;
+    TextFileListDataSource source;
+    ListMenu menu("Logs & Captures", MenuType::TEXT_FILE_LIST, &source);
+    holdAfter(5);
+    menu.onEnter(&app, true);
+    TEST_ASSERT_TRUE(framesUntil(menu, app, display, source, 5));
+    TEST_ASSERT_TRUE(source.isLoading());
+    for (int i = 0; i < 3; ++i) menu.handleInput(InputEvent::ENCODER_CW, &app);
+    std::string picked = selectedPath(menu, app);
+    TEST_ASSERT_FALSE(picked.empty());
+    holdAfter(FaultInjectingBackend::UNLIMITED);
+
+    while (source.isLoading()) {
+        frame(menu, app, display);
+        delay(16);
+    }
+    frame(menu, app, display);
+    TEST_ASSERT_EQUAL_INT(3, menu.getSelectedIndex());
+    TEST_ASSERT_EQUAL_STRING(picked.c_str(), selectedPath(menu, app).c_str());
+    menu.onExit(&app);
+}
+
+void test_back_stops_the_walk_and_reentry_lists_each_file_once(void) {
+    App app;
+    U8G2 display;
+    TextFileListDataSource source;
+    ListMenu menu("Logs & Captures", MenuType::TEXT_FILE_LIST, &source);
+    menu.onEnter(&app, true);
+    TEST_ASSERT_TRUE(framesUntil(menu, app, display, source, 50));
+
+    uint32_t start = millis();
+    menu.onExit(&app);
+    uint32_t exitMs = millis() - start;
+    char line[96];
+    snprintf(line, sizeof(line), "onExit stopped the walk in %lu ms", (unsigned long)exitMs);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_FALSE(source.isLoading());
+    int partial = source.getNumberOfItems(&app);
+    TEST_ASSERT_TRUE(partial < LOG_FILES);
+    delay(50);
+    TEST_ASSERT_EQUAL_INT(partial, source.getNumberOfItems(&app)); // Nothing more arrives
+
+    // A cut-short walk is not cached, so the second visit walks the card again from scratch.
+    menu.onEnter(&app, true);
+    while (source.isLoading()) {
+        frame(menu, app, display);
+        delay(16);
+    }
+    TEST_ASSERT_EQUAL_INT(LOG_FILES + PROBE_FILES, source.getNumberOfItems(&app));
+    std::vector<std::string> paths;
+    for (int i = 0; i < LOG_FILES + PROBE_FILES; ++i) {
+        paths.push_back(selectedPath(menu, app));
+        menu.handleInput(InputEvent::ENCODER_CW, &app);
+    }
+    std::sort(paths.begin(), paths.end());
+    TEST_ASSERT_TRUE(std::adjacent_find(paths.begin(), paths.end()) == paths.end());
+    TEST_ASSERT_TRUE(std::none_of(paths.begin(), paths.end(), [](const std::string& p) { return p.find(".csv") != std::string::npos; }));
+    menu.onExit(&app);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_items_are_drawn_long_before_the_walk_ends);
+    RUN_TEST(test_cursor_stays_on_its_item_while_the_list_grows);
+    RUN_TEST(test_back_stops_the_walk_and_reentry_lists_each_file_once);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
@@ -0,0 +1,164 @@
+// SdCardManager's directory listing cache. A listing is cached when a change made on the
+// host, behind the API, does not show up; every change made through the API, and the
+// invalidation after USB mass storage hands the card back, must show up.
+
+#include <unity.h>
+#include <algorithm>
+#include <functional>
+#include "TestSandbox.h"
+
+using SdCardManager::getInstance;
+
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {
+    volume = TestSandbox::mount("listing");
+    TEST_ASSERT_NOT_NULL(volume);
+    TEST_ASSERT_TRUE(getInstance().createDir("/user/dir"));
+    TEST_ASSERT_TRUE(getInstance().writeFile("/user/dir/a.txt", "aa"));
+    TEST_ASSERT_TRUE(getInstance().writeFile("/user/dir/b.txt", "bbb"));
+    TEST_ASSERT_TRUE(getInstance().createDir("/user/dir/sub"));
+    TEST_ASSERT_TRUE(getInstance().writeFile("/user/dir/sub/c.txt", "c"));
+}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+}
+
+// Sorted "name:size" (or "name/") for each entry, or "<none>" if `path` can't be listed.
+static std::string listing(const char* path) {
+    std::vector<SdCardManager::DirEntry> entries;
+    if (!getInstance().listDir(path, entries)) return "<none>";
+    std::vector<std::string> names;
+    for (const SdCardManager::DirEntry& entry : entries) {
+        names.push_back(entry.isDir ? entry.name + "/" : entry.name + ":" + std::to_string(entry.size));
+    }
+    std::sort(names.begin(), names.end());
+    std::string out;
+    for (const std::string& name : names) out += (out.empty() ? "" : " ") + name;
+    return out;
+}
+
+// A file the API knows nothing about: it only shows in a listing read from the card.
+static void addBehindTheApi(const char* sdPath) {
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, sdPath), "zz"));
+}
+
+// True if the next listing of `dirPath` comes from the cache: it misses a file just added
+// behind the API. The probe stays on the card.
+static bool isCached(const char* dirPath) {
+    static int probes = 0;
+    std::string name = "probe" + std::to_string(++probes) + ".txt";
+    addBehindTheApi((std::string(dirPath) + "/" + name).c_str());
+    return listing(dirPath).find(name) == std::string::npos;
+}
+
+void test_second_listing_comes_from_the_cache(void) {
+    TEST_ASSERT_EQUAL_STRING("a.txt:2 b.txt:3 sub/", listing("/user/dir").c_str());
+    addBehindTheApi("/user/dir/hidden.txt");
+    TEST_ASSERT_EQUAL_STRING("a.txt:2 b.txt:3 sub/", listing("/user/dir").c_str());
+    TEST_ASSERT_EQUAL_STRING("a.txt:2 b.txt:3 sub/", listing("/user/dir/").c_str()); // Same key
+}
+
+void test_every_change_through_the_api_invalidates(void) {
+    struct Change {
+        const char* what;
+        std::function<bool()> apply;
+        const char* expect;
+    };
+    const Change changes[] = {
+        {"writeFile", []() { return getInstance().writeFile("/user/dir/a.txt", "aaaa"); }, "a.txt:4 b.txt:3 sub/"},
+        {"new file", []() { return getInstance().writeFile("/user/dir/d.txt", "d"); }, "a.txt:4 b.txt:3 d.txt:1 sub/"},
+        {"rename", []() { return getInstance().renameFile("/user/dir/d.txt", "/user/dir/e.txt"); }, "a.txt:4 b.txt:3 e.txt:1 sub/"},
+        {"delete", []() { return getInstance().deleteFile("/user/dir/e.txt"); }, "a.txt:4 b.txt:3 sub/"},
+        {"mkdir", []() { return getInstance().createDir("/user/dir/new"); }, "a.txt:4 b.txt:3 new/ sub/"},
+        {"uncached stream", []() {
+             File out = getInstance().openFileUncached("/user/dir/log.txt", FILE_WRITE);
+             if (!out) return false;
+             out.print("12345");
+             out.close();
+             getInstance().finishWrite("/user/dir/log.txt");
+             return true;
+         }, "a.txt:4 b.txt:3 log.txt:5 new/ sub/"},
+        {"atomic replace", []() { return getInstance().writeFileAtomic("/user/dir/b.txt", "b", 1); }, nullptr},
+    };
+    for (const Change& change : changes) {
+        listing("/user/dir");
+        TEST_ASSERT_TRUE_MESSAGE(change.apply(), change.what);
+        std::string now = listing("/user/dir");
+        if (change.expect) TEST_ASSERT_EQUAL_STRING_MESSAGE(change.expect, now.c_str(), change.what);
+        else TEST_ASSERT_TRUE_MESSAGE(now.find("b.txt:3 ") == std::string::npos, change.what);
+    }
+}
+
+void test_changes_elsewhere_keep_the_listing(void) {
+    listing("/user/dir");
+    listing("/user/dir/sub");
+    // A file inside sub/ changes sub/'s listing, not its parent's.
+    TEST_ASSERT_TRUE(getInstance().writeFile("/user/dir/sub/c.txt", "cc"));
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/other.txt", "x"));
+    TEST_ASSERT_TRUE(isCached("/user/dir"));
+    TEST_ASSERT_EQUAL_STRING("c.txt:2", listing("/user/dir/sub").c_str());
+    TEST_ASSERT_TRUE(isCached("/user/dir/sub"));
+}
+
+void test_renaming_a_directory_drops_its_subtree(void) {
+    TEST_ASSERT_EQUAL_STRING("c.txt:1", listing("/user/dir/sub").c_str());
+    TEST_ASSERT_TRUE(getInstance().renameFile("/user/dir/sub", "/user/dir/moved"));
+    TEST_ASSERT_EQUAL_STRING("<none>", listing("/user/dir/sub").c_str());
+    TEST_ASSERT_EQUAL_STRING("c.txt:1", listing("/user/dir/moved").c_str());
+    TEST_ASSERT_EQUAL_STRING("a.txt:2 b.txt:3 moved/", listing("/user/dir").c_str());
+}
+
+void test_partial_walk_is_not_cached(void) {
+    int seen = 0;
+    TEST_ASSERT_TRUE(getInstance().forEachDirEntry("/user/dir", [&](const SdCardManager::DirEntry&) {
+        return ++seen < 2;
+    }));
+    TEST_ASSERT_EQUAL(2, seen);
+    TEST_ASSERT_FALSE(isCached("/user/dir"));
+    TEST_ASSERT_TRUE(isCached("/user/dir")); // The full walk just made is
+}
+
+void test_walk_racing_a_change_is_not_cached(void) {
+    bool changed = false;
+    TEST_ASSERT_TRUE(getInstance().forEachDirEntry("/user/dir", [&](const SdCardManager::DirEntry&) {
+        if (!changed) changed = getInstance().writeFile("/user/dir/late.txt", "late");
+        return true;
+    }));
+    TEST_ASSERT_TRUE(changed);
+    // Whether or not the walk saw late.txt, it started before the write and must not be kept.
+    TEST_ASSERT_EQUAL_STRING("a.txt:2 b.txt:3 late.txt:4 sub/", listing("/user/dir").c_str());
+}
+
+void test_usb_handback_invalidates_everything(void) {
+    listing("/user/dir");
+    TEST_ASSERT_EQUAL_STRING("aa", getInstance().readFile("/user/dir/a.txt").c_str());
+
+    // What UsbDriveMenu does: let go of the card, let the host at it, take it back.
+    getInstance().end();
+    TEST_ASSERT_FALSE(getInstance().isAvailable());
+    TEST_ASSERT_EQUAL_STRING("<none>", listing("/user/dir").c_str());
+    addBehindTheApi("/user/dir/from_pc.txt");
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, "/user/dir/a.txt"), "edited"));
+    getInstance().invalidateAll();
+    TEST_ASSERT_TRUE(getInstance().setup());
+    TestSandbox::waitForSpaceScan();
+
+    TEST_ASSERT_EQUAL_STRING("a.txt:6 b.txt:3 from_pc.txt:2 sub/", listing("/user/dir").c_str());
+    TEST_ASSERT_EQUAL_STRING("edited", getInstance().readFile("/user/dir/a.txt").c_str());
+    TEST_ASSERT_TRUE(isCached("/user/dir"));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_second_listing_comes_from_the_cache);
+    RUN_TEST(test_every_change_through_the_api_invalidates);
+    RUN_TEST(test_changes_elsewhere_keep_the_listing);
+    RUN_TEST(test_renaming_a_directory_drops_its_subtree);
+    RUN_TEST(test_partial_walk_is_not_cached);
+    RUN_TEST(test_walk_racing_a_change_is_not_cached);
+    RUN_TEST(test_usb_handback_invalidates_everything);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
@@ -0,0 +1,212 @@
+// LogRing: record framing and wrap-around on one thread, a multi-producer stress run
+// that checks nothing is lost, reordered or torn and that every drop is counted, and the
+// per-call cost of a LOG()-sized push.
+
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LogRing.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+alignas(4) static uint8_t storage[32 * 1024];
+
+static std::vector<std::string> drainAll(LogRing& ring, std::vector<uint8_t>* flags = nullptr) {
+    std::vector<std::string> out;
+    ring.drain([&](const char* data, uint32_t len, uint8_t userFlags) {
+        out.emplace_back(data, len);
+        if (flags) flags->push_back(userFlags);
+        return true;
+    });
+    return out;
+}
+
+void test_records_come_out_whole_and_in_order(void) {
+    LogRing ring;
+    TEST_ASSERT_FALSE(ring.isReady());
+    ring.init(storage, 256);
+    TEST_ASSERT_TRUE(ring.push("one", 3, 1));
+    TEST_ASSERT_TRUE(ring.push("", 0, 0));
+    TEST_ASSERT_TRUE(ring.push("three!", 6, LogRing::MAX_USER_FLAGS));
+    TEST_ASSERT_EQUAL_UINT32(8 + 4 + 12, ring.usedBytes()); // 4-byte header, padded to 4
+
+    std::vector<uint8_t> flags;
+    std::vector<std::string> out = drainAll(ring, &flags);
+    TEST_ASSERT_EQUAL_size_t(3, out.size());
+    TEST_ASSERT_EQUAL_STRING("one", out[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("", out[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("three!", out[2].c_str());
+    TEST_ASSERT_EQUAL_UINT8(1, flags[0]);
+    TEST_ASSERT_EQUAL_UINT8(LogRing::MAX_USER_FLAGS, flags[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.usedBytes());
+}
+
+void test_records_never_straddle_the_end(void) {
+    LogRing ring;
+    ring.init(storage, 64);
+    std::string twenty(20, 'a'); // 24 bytes with its header: every third one needs padding
+    for (int round = 0; round < 20; ++round) {
+        twenty[0] = 'a' + round % 26;
+        TEST_ASSERT_TRUE(ring.push(twenty.data(), twenty.size()));
+        std::vector<std::string> out = drainAll(ring);
+        TEST_ASSERT_EQUAL_size_t(1, out.size()); // Padding records are never handed out
+        TEST_ASSERT_EQUAL_STRING(twenty.c_str(), out[0].c_str());
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ring.takeDropped());
+}
+
+void test_full_ring_and_oversized_records_are_dropped_and_counted(void) {
+    LogRing ring;
+    ring.init(storage, 64);
+    std::string big(40, 'b');
+    TEST_ASSERT_FALSE(ring.push(big.data(), big.size())); // Over half the ring
+    for (int i = 0; i < 5; ++i) TEST_ASSERT_TRUE(ring.push("12345678", 8)); // 12 bytes each
+    TEST_ASSERT_FALSE(ring.push("12345678", 8)); // The 4 left can't take it
+    TEST_ASSERT_EQUAL_UINT32(2, ring.takeDropped());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.takeDropped());
+    TEST_ASSERT_EQUAL_size_t(5, drainAll(ring).size());
+    TEST_ASSERT_TRUE(ring.push("12345678", 8));
+}
+
+void test_refused_record_stays_for_the_next_drain(void) {
+    LogRing ring;
+    ring.init(storage, 128);
+    ring.push("a", 1);
+    ring.push("b", 1);
+    size_t consumed = ring.drain([](const char* data, uint32_t, uint8_t) { return data[0] != 'b'; });
+    TEST_ASSERT_EQUAL_size_t(1, consumed);
+    std::vector<std::string> out = drainAll(ring);
+    TEST_ASSERT_EQUAL_size_t(1, out.size());
+    TEST_ASSERT_EQUAL_STRING("b", out[0].c_str());
+}
+
+namespace {
+
+    // Record i of producer p: "p i" then a filler whose length and bytes follow from (p, i).
+    int makeRecord(char* out, size_t size, int p, int i) {
+        int len = snprintf(out, size, "%d %d ", p, i);
+        int fill = (i * 37 + p * 11) % 100;
+        for (int k = 0; k < fill; ++k) out[len++] = (char)('a' + (p + i + k) % 26);
+        return len;
+    }
+
+    struct StressResult {
+        long received = 0;
+        long dropped = 0;
+        int errors = 0;
+    };
+
+    StressResult stress(uint32_t capacity, int producers, int perProducer, int consumerSleepMicros) {
+        LogRing ring;
+        ring.init(storage, capacity);
+        std::atomic<int> running{producers};
+        StressResult result;
+        std::vector<int> last(producers, -1);
+
+        std::thread consumer([&]() {
+            char expected[160];
+            for (;;) {
+                bool finished = running.load() == 0;
+                ring.drain([&](const char* data, uint32_t len, uint8_t flags) {
+                    int p = -1, i = -1;
+                    if (sscanf(data, "%d %d", &p, &i) != 2 || p < 0 || p >= producers) {
+                        result.errors++;
+                        return true;
+                    }
+                    int expectedLen = makeRecord(expected, sizeof(expected), p, i);
+                    if ((int)len != expectedLen || memcmp(data, expected, len) != 0 || flags != p || i <= last[p]) {
+                        result.errors++;
+                    }
+                    last[p] = i;
+                    result.received++;
+                    return true;
+                });
+                if (finished && ring.usedBytes() == 0) break;
+                if (consumerSleepMicros) std::this_thread::sleep_for(std::chrono::microseconds(consumerSleepMicros));
+            }
+        });
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p]() {
+                char record[160];
+                for (int i = 0; i < perProducer; ++i) {
+                    int len = makeRecord(record, sizeof(record), p, i);
+                    ring.push(record, len, (uint8_t)p);
+                    if (i % 8 == 7) std::this_thread::yield(); // Tasks log in bursts, not flat out
+                }
+                running.fetch_sub(1);
+            });
+        }
+        for (std::thread& t : threads) t.join();
+        consumer.join();
+        result.dropped = ring.takeDropped();
+        return result;
+    }
+
+} // namespace
+
+void test_producers_lose_nothing_they_were_not_told_about(void) {
+    const int producers = 4, perProducer = 50000;
+    StressResult fast = stress(sizeof(storage), producers, perProducer, 0);
+    StressResult slow = stress(4096, producers, perProducer, 500);
+
+    char line[128];
+    snprintf(line, sizeof(line), "32 KB ring, busy consumer: %ld received, %ld dropped", fast.received, fast.dropped);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "4 KB ring, sleepy consumer: %ld received, %ld dropped", slow.received, slow.dropped);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(0, fast.errors);
+    TEST_ASSERT_EQUAL(0, slow.errors);
+    TEST_ASSERT_EQUAL(producers * perProducer, fast.received + fast.dropped);
+    TEST_ASSERT_EQUAL(producers * perProducer, slow.received + slow.dropped);
+    TEST_ASSERT_TRUE(slow.dropped > 0); // The ring did fill, and the drops were all counted
+}
+
+void test_benchmark_push_per_call(void) {
+    LogRing ring;
+    ring.init(storage, sizeof(storage));
+    const int calls = 1000000;
+    char line[128];
+    auto drainIfFull = [&](const char* data, int len) {
+        if (!ring.push(data, len)) {
+            ring.drain([](const char*, uint32_t, uint8_t) { return true; });
+            ring.push(data, len);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        int len = snprintf(line, sizeof(line), "%lu [%c] [%s] value %d", 12345ul, 'I', "AUDIO", i);
+        drainIfFull(line, len);
+    }
+    double formatAndPush = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+
+    int len = snprintf(line, sizeof(line), "%lu [%c] [%s] value %d", 12345ul, 'I', "AUDIO", 42);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) drainIfFull(line, len);
+    double pushOnly = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+
+    char message[128];
+    snprintf(message, sizeof(message), "per call (drain included): snprintf + push %.0f ns, push alone %.0f ns",
+             formatAndPush, pushOnly);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(pushOnly < formatAndPush);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_records_come_out_whole_and_in_order);
+    RUN_TEST(test_records_never_straddle_the_end);
+    RUN_TEST(test_full_ring_and_oversized_records_are_dropped_and_counted);
+    RUN_TEST(test_refused_record_stays_for_the_next_drain);
+    RUN_TEST(test_producers_lose_nothing_they_were_not_told_about);
+    RUN_TEST(test_benchmark_push_per_call);
+    return UNITY_END();
+}
@@ -0,0 +1,193 @@
+// LruCache eviction order and accounting, and a lookup/eviction benchmark with many
+// entries against the map-and-scan scheme the file cache used before it.
+
+#include <unity.h>
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <vector>
+#include "LruCache.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static std::string key(int i) {
+    char buffer[40];
+    snprintf(buffer, sizeof(buffer), "/user/music/album/%05d.mp3", i);
+    return buffer;
+}
+
+void test_evicts_least_recently_used_first(void) {
+    LruCache<int> cache(12);
+    cache.put("a", 1, 4);
+    cache.put("b", 2, 4);
+    cache.put("c", 3, 4);
+    TEST_ASSERT_EQUAL_STRING("a", cache.lruKey()->c_str());
+    TEST_ASSERT_NOT_NULL(cache.get("a")); // a is now the most recent; b is next out
+    cache.put("d", 4, 4);
+    TEST_ASSERT_NULL(cache.peek("b"));
+    TEST_ASSERT_NOT_NULL(cache.peek("a"));
+    TEST_ASSERT_EQUAL_STRING("c", cache.lruKey()->c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, cache.stats().evictions);
+}
+
+void test_peek_does_not_touch(void) {
+    LruCache<int> cache(8);
+    cache.put("a", 1, 4);
+    cache.put("b", 2, 4);
+    TEST_ASSERT_EQUAL(1, *cache.peek("a"));
+    cache.put("c", 3, 4);
+    TEST_ASSERT_NULL(cache.peek("a"));
+    TEST_ASSERT_EQUAL_UINT32(0, cache.stats().hits + cache.stats().misses);
+}
+
+void test_large_entry_evicts_as_many_as_needed(void) {
+    LruCache<int> cache(10);
+    for (int i = 0; i < 5; ++i) cache.put(key(i), i, 2);
+    cache.put("big", 99, 7);
+    TEST_ASSERT_EQUAL_size_t(2, cache.count()); // Only the newest small one fits beside it
+    TEST_ASSERT_NOT_NULL(cache.peek(key(4)));
+    TEST_ASSERT_EQUAL_size_t(9, cache.bytes());
+    TEST_ASSERT_EQUAL_UINT32(4, cache.stats().evictions);
+}
+
+void test_oversized_entry_is_refused_without_evicting(void) {
+    LruCache<int> cache(10);
+    cache.put("a", 1, 5);
+    TEST_ASSERT_NULL(cache.put("huge", 2, 11));
+    TEST_ASSERT_NOT_NULL(cache.peek("a"));
+    TEST_ASSERT_EQUAL_UINT32(0, cache.stats().evictions);
+    TEST_ASSERT_NOT_NULL(cache.put("exact", 3, 10));
+    TEST_ASSERT_EQUAL_size_t(1, cache.count());
+}
+
+void test_replace_updates_size_and_recency(void) {
+    LruCache<int> cache(10);
+    cache.put("a", 1, 4);
+    cache.put("b", 2, 4);
+    cache.put("a", 5, 2);
+    TEST_ASSERT_EQUAL_size_t(2, cache.count());
+    TEST_ASSERT_EQUAL_size_t(6, cache.bytes());
+    TEST_ASSERT_EQUAL(5, *cache.get("a"));
+    TEST_ASSERT_EQUAL_STRING("b", cache.lruKey()->c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, cache.stats().evictions); // Replacing is not evicting
+}
+
+void test_erase_clear_and_stats(void) {
+    LruCache<int> cache(100);
+    for (int i = 0; i < 10; ++i) cache.put(key(i), i, 5);
+    TEST_ASSERT_TRUE(cache.erase(key(0)));
+    TEST_ASSERT_FALSE(cache.erase(key(0)));
+    TEST_ASSERT_EQUAL_STRING(key(1).c_str(), cache.lruKey()->c_str());
+    size_t removed = cache.eraseIf([](const std::string& k) { return k == key(3) || k == key(7) || k == key(0); });
+    TEST_ASSERT_EQUAL_size_t(2, removed);
+    TEST_ASSERT_EQUAL_size_t(7, cache.count());
+    TEST_ASSERT_EQUAL_size_t(35, cache.bytes());
+
+    cache.get(key(5));
+    cache.get("missing");
+    cache.noteBypass();
+    TEST_ASSERT_EQUAL_UINT32(1, cache.stats().hits);
+    TEST_ASSERT_EQUAL_UINT32(1, cache.stats().misses);
+    TEST_ASSERT_EQUAL_UINT32(1, cache.stats().bypasses);
+
+    cache.clear();
+    TEST_ASSERT_EQUAL_size_t(0, cache.count());
+    TEST_ASSERT_EQUAL_size_t(0, cache.bytes());
+    TEST_ASSERT_NULL(cache.lruKey());
+    cache.put("after", 1, 50); // The recency list is usable again
+    TEST_ASSERT_EQUAL_STRING("after", cache.lruKey()->c_str());
+    cache.resetStats();
+    TEST_ASSERT_EQUAL_UINT32(0, cache.stats().hits);
+}
+
+namespace {
+
+    // The file cache before LruCache: a map, and a scan of every entry's last access for each eviction.
+    class ScanLru {
+    public:
+        explicit ScanLru(size_t capacity) : capacity_(capacity) {}
+        int* get(const std::string& k) {
+            auto it = map_.find(k);
+            if (it == map_.end()) return nullptr;
+            it->second.lastAccess = ++clock_;
+            return &it->second.value;
+        }
+        void put(const std::string& k, int value, size_t size) {
+            while (bytes_ + size > capacity_ && !map_.empty()) {
+                auto oldest = map_.begin();
+                for (auto it = map_.begin(); it != map_.end(); ++it) {
+                    if (it->second.lastAccess < oldest->second.lastAccess) oldest = it;
+                }
+                bytes_ -= oldest->second.size;
+                map_.erase(oldest);
+            }
+            map_[k] = Entry{value, size, ++clock_};
+            bytes_ += size;
+        }
+
+    private:
+        struct Entry {
+            int value;
+            size_t size;
+            uint64_t lastAccess;
+        };
+        std::map<std::string, Entry> map_;
+        size_t capacity_;
+        size_t bytes_ = 0;
+        uint64_t clock_ = 0;
+    };
+
+    // A working set of `entries` keys, then `rounds` of three lookups and one new key that evicts.
+    template <typename Cache>
+    double nanosPerOp(Cache& cache, int entries, int rounds) {
+        std::vector<std::string> keys;
+        for (int i = 0; i < entries + rounds; ++i) keys.push_back(key(i));
+        for (int i = 0; i < entries; ++i) cache.put(keys[i], i, 1);
+        long sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (int j = 0; j < 3; ++j) {
+                int* v = cache.get(keys[r + 1 + (r * 7919 + j * 104729) % (entries - 1)]);
+                if (v) sum += *v;
+            }
+            cache.put(keys[entries + r], r, 1);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        TEST_ASSERT_TRUE(sum > 0);
+        return std::chrono::duration<double, std::nano>(elapsed).count() / (rounds * 4);
+    }
+
+} // namespace
+
+void test_benchmark_many_entries(void) {
+    char line[160];
+    double perOp[3];
+    const int sizes[3] = {1000, 10000, 100000};
+    for (int i = 0; i < 3; ++i) {
+        LruCache<int> cache(sizes[i]);
+        perOp[i] = nanosPerOp(cache, sizes[i], 20000);
+        snprintf(line, sizeof(line), "LruCache, %d entries: %.0f ns per lookup/insert", sizes[i], perOp[i]);
+        TEST_MESSAGE(line);
+    }
+    ScanLru scan(sizes[1]);
+    double scanPerOp = nanosPerOp(scan, sizes[1], 2000);
+    snprintf(line, sizeof(line), "map + scan, %d entries: %.0f ns per lookup/insert", sizes[1], scanPerOp);
+    TEST_MESSAGE(line);
+
+    // Flat in the entry count, beyond what hashing longer chains and cache misses add.
+    TEST_ASSERT_TRUE(perOp[2] < perOp[0] * 10);
+    TEST_ASSERT_TRUE(perOp[1] * 20 < scanPerOp);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_evicts_least_recently_used_first);
+    RUN_TEST(test_peek_does_not_touch);
+    RUN_TEST(test_large_entry_evicts_as_many_as_needed);
+    RUN_TEST(test_oversized_entry_is_refused_without_evicting);
+    RUN_TEST(test_replace_updates_size_and_recency);
+    RUN_TEST(test_erase_clear_and_stats);
+    RUN_TEST(test_benchmark_many_entries);
+    return UNITY_END();
+}
@@ -0,0 +1,526 @@
+// Mp3SeekTable on synthetic MPEG streams: header decoding, each way of building the table
+// (Xing TOC, VBRI, CBR, a frame walk), time <-> byte round trips, resyncing on a frame
+// after a seek, the text form kept in the library index, and seek cost on a two hour VBR
+// mix against walking the frame headers.
+
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string.h>
+#include <vector>
+#include "Mp3SeekTable.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+namespace {
+
+    // MPEG1 Layer III bitrates by header index, in kbps.
+    const uint16_t KBPS[15] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320};
+
+    struct MemorySource : Mp3SeekTable::Source {
+        const std::vector<uint8_t>& data;
+        uint64_t bytesRead = 0;
+        uint64_t reads = 0;
+
+        explicit MemorySource(const std::vector<uint8_t>& bytes) : data(bytes) {}
+
+        size_t readAt(uint64_t offset, uint8_t* buf, size_t len) override {
+            reads++;
+            if (offset >= data.size()) return 0;
+            len = std::min<size_t>(len, data.size() - offset);
+            memcpy(buf, data.data() + offset, len);
+            bytesRead += len;
+            return len;
+        }
+        uint64_t size() override { return data.size(); }
+    };
+
+    enum class Header { NONE, XING, INFO, VBRI };
+
+    // A 44.1 kHz MPEG1 Layer III stream with noise for audio and frame offsets to check against.
+    struct Stream {
+        std::vector<uint8_t> bytes;
+        std::vector<uint32_t> frames; // Audio frames only, not the Xing/VBRI one
+        uint32_t headerFrame = 0;
+        bool tagged = false; // The Xing/VBRI frame decodes to silence; a seek to 0 lands on it
+        uint32_t audioEnd = 0;
+
+        double frameMs(size_t i) const { return i * 1152 * 1000.0 / 44100; }
+
+        // The audio frame starting at `offset`, or -1.
+        int64_t frameAt(int64_t offset) const {
+            if (tagged && offset == headerFrame) return 0;
+            auto it = std::lower_bound(frames.begin(), frames.end(), (uint32_t)offset);
+            return (offset >= 0 && it != frames.end() && *it == (uint32_t)offset) ? it - frames.begin() : -1;
+        }
+    };
+
+    // Padded as an encoder does, whenever the slot remainders add up to a byte.
+    void putFrame(std::vector<uint8_t>& out, int bitrateIdx, uint32_t& remainder, std::mt19937& rng, bool straySync) {
+        remainder += 144 * KBPS[bitrateIdx] * 1000 % 44100;
+        int pad = remainder >= 44100 ? 1 : 0;
+        remainder -= pad * 44100;
+        size_t len = 144 * KBPS[bitrateIdx] * 1000 / 44100 + pad;
+        size_t at = out.size();
+        out.resize(at + len);
+        out[at] = 0xFF;
+        out[at + 1] = 0xFB; // MPEG1, Layer III, no CRC
+        out[at + 2] = (uint8_t)((bitrateIdx << 4) | (pad << 1));
+        out[at + 3] = 0x00;
+        for (size_t k = 4; k < len; ++k) out[at + k] = (uint8_t)(rng() % 255); // No 0xFF
+        if (straySync) {
+            out[at + 6] = 0xFF; // A valid-looking header inside the audio data
+            out[at + 7] = 0xFB;
+            out[at + 8] = 0x90;
+        }
+    }
+
+    /**
+     * @param bitrate Header bitrate index of audio frame i.
+     * @param id3Bytes ID3v2 tag size, 0 for none.
+     */
+    template <typename Bitrate>
+    Stream makeStream(uint32_t count, Bitrate bitrate, Header header, size_t id3Bytes = 4096, unsigned seed = 7) {
+        std::mt19937 rng(seed);
+        Stream s;
+        if (id3Bytes) {
+            uint32_t body = (uint32_t)id3Bytes - 10;
+            uint8_t id3[10] = {'I', 'D', '3', 3, 0, 0, (uint8_t)((body >> 21) & 0x7F), (uint8_t)((body >> 14) & 0x7F),
+                               (uint8_t)((body >> 7) & 0x7F), (uint8_t)(body & 0x7F)};
+            s.bytes.assign(id3, id3 + 10);
+            s.bytes.resize(id3Bytes, 0);
+        }
+        s.headerFrame = (uint32_t)s.bytes.size();
+        s.tagged = header != Header::NONE;
+        uint32_t remainder = 0;
+        if (s.tagged) putFrame(s.bytes, 13, remainder, rng, false); // 256 kbps: room for a VBRI table
+        for (uint32_t i = 0; i < count; ++i) {
+            s.frames.push_back((uint32_t)s.bytes.size());
+            int bitrateIdx = bitrate(i, rng);
+            putFrame(s.bytes, bitrateIdx, remainder, rng, rng() % 50 == 0);
+        }
+        s.audioEnd = (uint32_t)s.bytes.size();
+
+        uint8_t* tagFrame = s.bytes.data() + s.headerFrame;
+        auto putBE = [](uint8_t* p, uint32_t v, int n) {
+            for (int k = 0; k < n; ++k) p[k] = (uint8_t)(v >> (8 * (n - 1 - k)));
+        };
+        uint32_t streamBytes = s.audioEnd - s.headerFrame;
+        if (header == Header::XING || header == Header::INFO) {
+            uint8_t* x = tagFrame + 4 + 32; // After stereo MPEG1 side information
+            memset(x, 0, 4 + 4 + 4 + 4 + 100);
+            memcpy(x, header == Header::XING ? "Xing" : "Info", 4);
+            putBE(x + 4, header == Header::XING ? 0x07 : 0x03, 4);
+            putBE(x + 8, count, 4);
+            putBE(x + 12, streamBytes, 4);
+            for (int p = 0; header == Header::XING && p < 100; ++p) {
+                uint32_t frame = s.frames[(uint64_t)p * count / 100];
+                x[16 + p] = (uint8_t)std::min<uint64_t>(255, (uint64_t)(frame - s.headerFrame) * 256 / streamBytes);
+            }
+        } else if (header == Header::VBRI) {
+            const uint16_t framesPerEntry = 100;
+            const uint16_t scale = 2; // 100 frames at 320 kbps overflow 16 bits
+            const uint16_t entries = (uint16_t)((count + framesPerEntry - 1) / framesPerEntry);
+            uint8_t* v = tagFrame + 36;
+            memcpy(v, "VBRI", 4);
+            putBE(v + 4, 1, 2);    // Version
+            putBE(v + 6, 0, 2);    // Delay
+            putBE(v + 8, 80, 2);   // Quality
+            putBE(v + 10, streamBytes, 4);
+            putBE(v + 14, count, 4);
+            putBE(v + 18, entries, 2);
+            putBE(v + 20, scale, 2);
+            putBE(v + 22, 2, 2);   // Bytes per entry
+            putBE(v + 24, framesPerEntry, 2);
+            for (uint32_t e = 0; e < entries; ++e) {
+                // The header frame counts towards the first run.
+                uint32_t from = e == 0 ? s.headerFrame : s.frames[e * framesPerEntry];
+                uint32_t to = (e + 1) * framesPerEntry < count ? s.frames[(e + 1) * framesPerEntry] : s.audioEnd;
+                putBE(v + 26 + 2 * e, (to - from + scale / 2) / scale, 2);
+            }
+        }
+        return s;
+    }
+
+    int constantRate(uint32_t, std::mt19937&) { return 9; } // 128 kbps
+
+    // Bitrate drifting over the track, as a VBR encoder's does between quiet and busy passages.
+    struct Drifting {
+        int current = 9;
+        int operator()(uint32_t, std::mt19937& rng) {
+            if (rng() % 8 == 0) current = std::max(1, std::min(14, current + (int)(rng() % 5) - 2));
+            return current;
+        }
+    };
+
+    // Where seeks every `step` ms land, as the player does them: table lookup, then resync.
+    struct SeekResult {
+        double maxErrorMs = 0;
+        double meanErrorMs = 0;
+        int offFrame = 0;
+    };
+
+    SeekResult seekAll(const Mp3SeekTable& table, MemorySource& source, const Stream& s, uint32_t step) {
+        SeekResult r;
+        int seeks = 0;
+        for (uint32_t ms = 0; ms + 1000 < table.getDurationMs(); ms += step) { // Not into the last frame
+            int64_t frame = s.frameAt(table.findFrame(source, table.byteForMs(ms)));
+            if (frame < 0) {
+                r.offFrame++;
+                continue;
+            }
+            double error = std::fabs(s.frameMs(frame) - ms);
+            r.maxErrorMs = std::max(r.maxErrorMs, error);
+            r.meanErrorMs += error;
+            seeks++;
+        }
+        if (seeks) r.meanErrorMs /= seeks;
+        return r;
+    }
+
+} // namespace
+
+void test_parse_header(void) {
+    Mp3SeekTable::FrameHeader h;
+    const uint8_t mpeg1Layer3[4] = {0xFF, 0xFB, 0x90, 0x00}; // 128 kbps, 44.1 kHz
+    TEST_ASSERT_TRUE(Mp3SeekTable::parseHeader(mpeg1Layer3, h));
+    TEST_ASSERT_EQUAL_UINT32(44100, h.sampleRate);
+    TEST_ASSERT_EQUAL_UINT16(1152, h.samplesPerFrame);
+    TEST_ASSERT_EQUAL_UINT16(128, h.bitrateKbps);
+    TEST_ASSERT_EQUAL_UINT16(417, h.bytes);
+    TEST_ASSERT_EQUAL_UINT8(3, h.version);
+    TEST_ASSERT_EQUAL_UINT8(1, h.layer);
+    TEST_ASSERT_FALSE(h.mono);
+
+    const uint8_t padded[4] = {0xFF, 0xFB, 0x92, 0xC0}; // Padding bit, mono
+    TEST_ASSERT_TRUE(Mp3SeekTable::parseHeader(padded, h));
+    TEST_ASSERT_EQUAL_UINT16(418, h.bytes);
+    TEST_ASSERT_TRUE(h.mono);
+
+    const uint8_t mpeg1At48k[4] = {0xFF, 0xFB, 0xE4, 0x00}; // 320 kbps, 48 kHz
+    TEST_ASSERT_TRUE(Mp3SeekTable::parseHeader(mpeg1At48k, h));
+    TEST_ASSERT_EQUAL_UINT32(48000, h.sampleRate);
+    TEST_ASSERT_EQUAL_UINT16(960, h.bytes);
+
+    const uint8_t mpeg2Layer3[4] = {0xFF, 0xF3, 0x80, 0x00}; // 64 kbps, 22.05 kHz
+    TEST_ASSERT_TRUE(Mp3SeekTable::parseHeader(mpeg2Layer3, h));
+    TEST_ASSERT_EQUAL_UINT32(22050, h.sampleRate);
+    TEST_ASSERT_EQUAL_UINT16(576, h.samplesPerFrame);
+    TEST_ASSERT_EQUAL_UINT16(64, h.bitrateKbps);
+    TEST_ASSERT_EQUAL_UINT16(208, h.bytes);
+
+    const uint8_t mpeg25Layer3[4] = {0xFF, 0xE3, 0x88, 0x00}; // 64 kbps, 8 kHz
+    TEST_ASSERT_TRUE(Mp3SeekTable::parseHeader(mpeg25Layer3, h));
+    TEST_ASSERT_EQUAL_UINT32(8000, h.sampleRate);
+    TEST_ASSERT_EQUAL_UINT16(576, h.samplesPerFrame);
+    TEST_ASSERT_EQUAL_UINT16(576, h.bytes);
+
+    const uint8_t mpeg1Layer2[4] = {0xFF, 0xFD, 0xA0, 0x00}; // 192 kbps
+    TEST_ASSERT_TRUE(Mp3SeekTable::parseHeader(mpeg1Layer2, h));
+    TEST_ASSERT_EQUAL_UINT16(1152, h.samplesPerFrame);
+    TEST_ASSERT_EQUAL_UINT16(192, h.bitrateKbps);
+    TEST_ASSERT_EQUAL_UINT16(626, h.bytes);
+
+    const uint8_t mpeg1Layer1[4] = {0xFF, 0xFF, 0x92, 0x00}; // 288 kbps, padded
+    TEST_ASSERT_TRUE(Mp3SeekTable::parseHeader(mpeg1Layer1, h));
+    TEST_ASSERT_EQUAL_UINT16(384, h.samplesPerFrame);
+    TEST_ASSERT_EQUAL_UINT16(288, h.bitrateKbps);
+    TEST_ASSERT_EQUAL_UINT16((12 * 288000 / 44100 + 1) * 4, h.bytes);
+
+    const uint8_t rejected[][4] = {
+        {0xFE, 0xFB, 0x90, 0x00}, // No sync
+        {0xFF, 0x7B, 0x90, 0x00}, // Sync cut short
+        {0xFF, 0xEB, 0x90, 0x00}, // Reserved version
+        {0xFF, 0xF9, 0x90, 0x00}, // Reserved layer
+        {0xFF, 0xFB, 0x00, 0x00}, // Free format
+        {0xFF, 0xFB, 0xF0, 0x00}, // Bad bitrate
+        {0xFF, 0xFB, 0x9C, 0x00}, // Reserved sample rate
+    };
+    for (const uint8_t* bytes : rejected) TEST_ASSERT_FALSE(Mp3SeekTable::parseHeader(bytes, h));
+}
+
+void test_build_from_xing_toc(void) {
+    Stream s = makeStream(20000, Drifting(), Header::XING); // ~8.7 minutes
+    MemorySource source(s.bytes);
+    Mp3SeekTable table;
+    TEST_ASSERT_TRUE(table.build(source));
+    TEST_ASSERT_EQUAL_CHAR('X', (char)table.getKind());
+    TEST_ASSERT_EQUAL_UINT32(44100, table.getSampleRate());
+    TEST_ASSERT_EQUAL_UINT32(20000, table.getFrameCount());
+    TEST_ASSERT_EQUAL_UINT32(s.headerFrame, table.getDataStart()); // Found past the ID3 tag
+    TEST_ASSERT_EQUAL_UINT32(s.audioEnd, table.getDataEnd());
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(20000 * 1152ull * 1000 / 44100), table.getDurationMs());
+    TEST_ASSERT_TRUE(source.bytesRead < 16 * 1024); // The header is enough
+
+    SeekResult r = seekAll(table, source, s, 1009);
+    TEST_ASSERT_EQUAL_INT(0, r.offFrame);
+    TEST_ASSERT_TRUE(r.maxErrorMs < 8000); // A TOC step is 1/256 of the stream: seconds where the bitrate is low
+
+    Stream info = makeStream(2000, constantRate, Header::INFO);
+    MemorySource infoSource(info.bytes);
+    TEST_ASSERT_TRUE(table.build(infoSource));
+    TEST_ASSERT_EQUAL_CHAR('X', (char)table.getKind());
+    TEST_ASSERT_EQUAL_UINT32(2000, table.getFrameCount());
+    std::string text = table.serialize();
+    TEST_ASSERT_EQUAL_INT(5, std::count(text.begin(), text.end(), ',')); // LAME's CBR tag: no points, linear
+    TEST_ASSERT_EQUAL_INT(0, seekAll(table, infoSource, info, 997).offFrame);
+}
+
+void test_build_from_vbri(void) {
+    Stream s = makeStream(20000, Drifting(), Header::VBRI, 0);
+    MemorySource source(s.bytes);
+    Mp3SeekTable table;
+    TEST_ASSERT_TRUE(table.build(source, false));
+    TEST_ASSERT_EQUAL_CHAR('V', (char)table.getKind());
+    TEST_ASSERT_EQUAL_UINT32(20000, table.getFrameCount());
+    TEST_ASSERT_EQUAL_UINT32(0, table.getDataStart());
+    TEST_ASSERT_EQUAL_UINT32(s.audioEnd, table.getDataEnd());
+
+    SeekResult r = seekAll(table, source, s, 1009);
+    TEST_ASSERT_EQUAL_INT(0, r.offFrame);
+    TEST_ASSERT_TRUE(r.maxErrorMs < 4000); // A point every 10 s, the bitrate taken as even between them
+}
+
+void test_build_cbr_and_walked_vbr(void) {
+    // CBR with an ID3v1 tag at the end.
+    Stream cbr = makeStream(10000, constantRate, Header::NONE);
+    std::vector<uint8_t> id3v1(128, 0);
+    memcpy(id3v1.data(), "TAG", 3);
+    cbr.bytes.insert(cbr.bytes.end(), id3v1.begin(), id3v1.end());
+    MemorySource cbrSource(cbr.bytes);
+    Mp3SeekTable table;
+    TEST_ASSERT_TRUE(table.build(cbrSource));
+    TEST_ASSERT_EQUAL_CHAR('C', (char)table.getKind());
+    TEST_ASSERT_EQUAL_UINT32(cbr.audioEnd, table.getDataEnd());
+    TEST_ASSERT_UINT32_WITHIN(1, 10000, table.getFrameCount()); // From the bitrate
+    TEST_ASSERT_EQUAL_INT(0, seekAll(table, cbrSource, cbr, 997).offFrame);
+
+    // Headerless VBR, with junk after the audio: walked frame by frame.
+    Stream vbr = makeStream(10000, Drifting(), Header::NONE);
+    vbr.bytes.resize(vbr.bytes.size() + 3000, 0x55);
+    MemorySource vbrSource(vbr.bytes);
+    TEST_ASSERT_TRUE(table.build(vbrSource));
+    TEST_ASSERT_EQUAL_CHAR('S', (char)table.getKind());
+    TEST_ASSERT_EQUAL_UINT32(10000, table.getFrameCount()); // Stray sync words inside frames not counted
+    TEST_ASSERT_EQUAL_UINT32(vbr.frames[0], table.getDataStart());
+    TEST_ASSERT_EQUAL_UINT32(vbr.audioEnd, table.getDataEnd());
+    SeekResult walked = seekAll(table, vbrSource, vbr, 997);
+    TEST_ASSERT_EQUAL_INT(0, walked.offFrame);
+    TEST_ASSERT_TRUE(walked.maxErrorMs < 4000);
+
+    // Without the walk it is mapped from the first frame's bitrate.
+    vbrSource.bytesRead = 0;
+    TEST_ASSERT_TRUE(table.build(vbrSource, false));
+    TEST_ASSERT_EQUAL_CHAR('C', (char)table.getKind());
+    TEST_ASSERT_TRUE(vbrSource.bytesRead < 256 * 1024);
+
+    std::vector<uint8_t> noAudio(100000, 0x55);
+    MemorySource noAudioSource(noAudio);
+    TEST_ASSERT_FALSE(table.build(noAudioSource));
+    TEST_ASSERT_FALSE(table.isValid());
+}
+
+void test_byte_and_time_round_trip(void) {
+    Stream xing = makeStream(20000, Drifting(), Header::XING);
+    Stream vbri = makeStream(20000, Drifting(), Header::VBRI);
+    Stream cbr = makeStream(20000, constantRate, Header::NONE);
+    Stream walked = makeStream(20000, Drifting(), Header::NONE);
+    for (Stream* s : {&xing, &vbri, &cbr, &walked}) {
+        MemorySource source(s->bytes);
+        Mp3SeekTable table;
+        TEST_ASSERT_TRUE(table.build(source));
+        uint32_t duration = table.getDurationMs();
+        TEST_ASSERT_EQUAL_UINT32(table.getDataStart(), table.byteForMs(0));
+        TEST_ASSERT_EQUAL_UINT32(table.getDataEnd(), table.byteForMs(duration));
+        TEST_ASSERT_EQUAL_UINT32(0, table.msForByte(table.getDataStart()));
+        TEST_ASSERT_EQUAL_UINT32(duration, table.msForByte(table.getDataEnd()));
+
+        uint32_t lastByte = 0;
+        for (uint32_t ms = 0; ms < duration; ms += 211) {
+            uint32_t byte = table.byteForMs(ms);
+            TEST_ASSERT_TRUE(byte >= lastByte); // Never seeks backwards for a later time
+            lastByte = byte;
+            TEST_ASSERT_UINT32_WITHIN(60, ms, table.msForByte(byte)); // Two 1/65536 steps where the stream is sparsest
+        }
+        // The time shown for where a seek landed is close to where that frame really plays.
+        for (uint32_t ms = 500; ms < duration; ms += 4999) {
+            int64_t at = table.findFrame(source, table.byteForMs(ms));
+            int64_t frame = s->frameAt(at);
+            TEST_ASSERT_TRUE(frame >= 0);
+            TEST_ASSERT_TRUE(std::fabs(s->frameMs(frame) - table.msForByte(at)) < 8000);
+        }
+    }
+}
+
+void test_find_frame_resyncs(void) {
+    Stream s = makeStream(3000, Drifting(), Header::NONE, 0, 11);
+    MemorySource source(s.bytes);
+    Mp3SeekTable table;
+    TEST_ASSERT_TRUE(table.build(source));
+
+    std::mt19937 rng(5);
+    for (int i = 0; i < 2000; ++i) {
+        uint32_t offset = rng() % (s.audioEnd - 1);
+        auto next = std::lower_bound(s.frames.begin(), s.frames.end(), offset);
+        int64_t expected = next == s.frames.end() ? -1 : (int64_t)*next;
+        TEST_ASSERT_EQUAL_INT64(expected, table.findFrame(source, offset)); // Stray sync words skipped
+    }
+    TEST_ASSERT_EQUAL_INT64(s.frames[0], table.findFrame(source, 0));
+
+    // A stretch of junk longer than the resync window: nothing found from inside it.
+    Stream gap = s;
+    uint32_t from = gap.frames[1500];
+    gap.bytes.insert(gap.bytes.begin() + from, Mp3SeekTable::RESYNC_WINDOW + 1000, 0x55);
+    MemorySource gapSource(gap.bytes);
+    TEST_ASSERT_EQUAL_INT64(-1, table.findFrame(gapSource, from + 10));
+    TEST_ASSERT_EQUAL_INT64(from + Mp3SeekTable::RESYNC_WINDOW + 1000,
+                            table.findFrame(gapSource, from + 2000));
+
+    Mp3SeekTable empty;
+    TEST_ASSERT_EQUAL_INT64(-1, empty.findFrame(source, 0));
+}
+
+void test_serialize_and_parse(void) {
+    Stream xing = makeStream(20000, Drifting(), Header::XING);
+    Stream vbri = makeStream(20000, Drifting(), Header::VBRI);
+    Stream cbr = makeStream(20000, constantRate, Header::NONE);
+    Stream walked = makeStream(20000, Drifting(), Header::NONE);
+    for (Stream* s : {&xing, &vbri, &cbr, &walked}) {
+        MemorySource source(s->bytes);
+        Mp3SeekTable built;
+        TEST_ASSERT_TRUE(built.build(source));
+        std::string text = built.serialize();
+        Mp3SeekTable parsed;
+        TEST_ASSERT_TRUE(parsed.parse(text));
+        TEST_ASSERT_EQUAL_STRING(text.c_str(), parsed.serialize().c_str());
+        TEST_ASSERT_EQUAL_CHAR((char)built.getKind(), (char)parsed.getKind());
+        TEST_ASSERT_EQUAL_UINT32(built.getDurationMs(), parsed.getDurationMs());
+        for (uint32_t ms = 0; ms < built.getDurationMs(); ms += 3331) {
+            TEST_ASSERT_EQUAL_UINT32(built.byteForMs(ms), parsed.byteForMs(ms));
+        }
+    }
+
+    Mp3SeekTable table;
+    TEST_ASSERT_TRUE(table.parse("C,44100,1152,1000,0,417000"));
+    TEST_ASSERT_TRUE(table.parse("X,48000,1152,1000,4096,500000,00102030"));
+    TEST_ASSERT_EQUAL_UINT32(24000, table.getDurationMs());
+    TEST_ASSERT_EQUAL_UINT32(4096 + (500000 - 4096) * 0x10 / 256, table.byteForMs(6000)); // Point 1 of 4
+    const char* rejected[] = {
+        "",
+        "Q,44100,1152,1000,0,417000",      // Unknown kind
+        "CC,44100,1152,1000,0,417000",
+        "C,44100,1152,1000,0",             // Field missing
+        "C,0,1152,1000,0,417000",          // No sample rate
+        "C,44100,0,1000,0,417000",
+        "C,44100,2304,1000,0,417000",      // More samples a frame than MPEG has
+        "C,44100,1152,1000,417000,417000", // Empty data range
+        "C,44100,1152,-1,0,417000",
+        "C,44100,1152,99999999999,0,417000",
+        "S,44100,1152,1000,0,417000,012",  // Not whole points
+        "S,44100,1152,1000,0,417000,00zz",
+    };
+    for (const char* text : rejected) {
+        TEST_ASSERT_FALSE_MESSAGE(table.parse(text), text);
+        TEST_ASSERT_FALSE(table.isValid());
+    }
+}
+
+void test_long_vbr_seek_benchmark(void) {
+    // Two hours at a drifting bitrate with a Xing TOC, as a DJ mix would be encoded.
+    const uint32_t frames = (uint32_t)(2 * 3600 * 44100ull / 1152);
+    Stream s = makeStream(frames, Drifting(), Header::XING);
+    MemorySource source(s.bytes);
+
+    Mp3SeekTable fromToc;
+    TEST_ASSERT_TRUE(fromToc.build(source, false));
+    TEST_ASSERT_EQUAL_CHAR('X', (char)fromToc.getKind());
+
+    Mp3SeekTable walked;
+    source.bytesRead = source.reads = 0;
+    auto start = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(walked.build(source)); // Longer than SCAN_ABOVE_MS: walked
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL_CHAR('S', (char)walked.getKind());
+    TEST_ASSERT_EQUAL_UINT32(frames + 1, walked.getFrameCount()); // The Xing frame is a frame too
+    std::string text = walked.serialize();
+    Mp3SeekTable table;
+    TEST_ASSERT_TRUE(table.parse(text)); // As the player gets it back from the library index
+    char message[160];
+    snprintf(message, sizeof(message), "%.1f MB, %u frames: walked in %.0f ms reading %.1f MB, %u points in %u chars",
+             s.bytes.size() / 1e6, (unsigned)frames, buildMs, source.bytesRead / 1e6,
+             (unsigned)(text.size() - text.rfind(',') - 1) / 4, (unsigned)text.size());
+    TEST_MESSAGE(message);
+
+    std::mt19937 rng(9);
+    const int seeks = 200;
+    std::vector<uint32_t> targets(seeks);
+    for (uint32_t& ms : targets) ms = rng() % table.getDurationMs();
+
+    auto measure = [&](const Mp3SeekTable& t, const char* name) {
+        source.bytesRead = source.reads = 0;
+        double maxError = 0, sumError = 0;
+        int offFrame = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t ms : targets) {
+            int64_t frame = s.frameAt(t.findFrame(source, t.byteForMs(ms)));
+            if (frame < 0) {
+                offFrame++;
+                continue;
+            }
+            double error = std::fabs(s.frameMs(frame) - ms);
+            maxError = std::max(maxError, error);
+            sumError += error;
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+        snprintf(message, sizeof(message), "%s: %.2f us and %.0f bytes a seek, landing %.0f ms off on average, %.0f ms at most",
+                 name, us / seeks, (double)source.bytesRead / seeks, sumError / seeks, maxError);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_EQUAL_INT(0, offFrame);
+        TEST_ASSERT_TRUE(source.bytesRead / seeks <= 2 * 1024); // One or two 1 KB resync reads
+        return maxError;
+    };
+    double tocError = measure(fromToc, "Xing TOC");
+    double walkedError = measure(table, "Walked table");
+    TEST_ASSERT_TRUE(walkedError < tocError);
+    TEST_ASSERT_TRUE(walkedError < 5000);
+
+    // What a seek costs without a table: walk the frame headers from the start.
+    const int walks = 20;
+    source.bytesRead = source.reads = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < walks; ++i) {
+        std::vector<uint8_t> chunk(16 * 1024);
+        uint64_t chunkStart = 0, chunkLen = 0, pos = s.frames[0], samples = 0;
+        while (samples * 1000 / 44100 < targets[i]) {
+            if (pos < chunkStart || pos + 4 > chunkStart + chunkLen) {
+                chunkStart = pos;
+                chunkLen = source.readAt(pos, chunk.data(), chunk.size());
+            }
+            Mp3SeekTable::FrameHeader h;
+            TEST_ASSERT_TRUE(Mp3SeekTable::parseHeader(chunk.data() + (pos - chunkStart), h));
+            pos += h.bytes;
+            samples += h.samplesPerFrame;
+        }
+    }
+    double walkUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    snprintf(message, sizeof(message), "Frame walk: %.0f us and %.1f MB a seek", walkUs / walks,
+             source.bytesRead / 1e6 / walks);
+    TEST_MESSAGE(message);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_header);
+    RUN_TEST(test_build_from_xing_toc);
+    RUN_TEST(test_build_from_vbri);
+    RUN_TEST(test_build_cbr_and_walked_vbr);
+    RUN_TEST(test_byte_and_time_round_trip);
+    RUN_TEST(test_find_frame_resyncs);
+    RUN_TEST(test_serialize_and_parse);
+    RUN_TEST(test_long_vbr_seek_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,345 @@
+// MusicDb: what Builder lays out (directory and track ranges, name and duration order,
+// lookups by path), load() turning away damaged files (bad CRC, a truncated pool, every
+// offset and range out of bounds), and the load time of a 5,000-track library read off the
+// card the way MusicLibraryManager does, against the per-directory text index it replaced
+// (reported, not asserted).
+
+#include <unity.h>
+#include <chrono>
+#include <stdlib.h>
+#include <vector>
+#include "TestSandbox.h"
+#include "CrcTrailer.h"
+#include "MusicDb.h"
+
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+}
+
+namespace {
+
+    std::shared_ptr<const uint8_t> copyOf(const std::vector<uint8_t>& bytes) {
+        uint8_t* buffer = (uint8_t*)malloc(bytes.size() ? bytes.size() : 1);
+        memcpy(buffer, bytes.data(), bytes.size());
+        return std::shared_ptr<const uint8_t>(buffer, free);
+    }
+
+    bool loads(const std::vector<uint8_t>& bytes, size_t size) {
+        MusicDb db;
+        bool ok = db.load(copyOf(bytes), size);
+        TEST_ASSERT_EQUAL(ok, db.isLoaded());
+        return ok;
+    }
+
+    bool loads(const std::vector<uint8_t>& bytes) { return loads(bytes, bytes.size()); }
+
+    MusicDb::Header headerOf(const std::vector<uint8_t>& bytes) {
+        MusicDb::Header header;
+        memcpy(&header, bytes.data(), sizeof(header));
+        return header;
+    }
+
+    // The file with its CRC recomputed, so only the structural checks can turn it away.
+    std::vector<uint8_t> resealed(std::vector<uint8_t> bytes) {
+        MusicDb::Header header = headerOf(bytes);
+        size_t end = sizeof(header) + header.trackCount * sizeof(MusicDb::TrackRecord) +
+                     header.dirCount * sizeof(MusicDb::DirRecord) + header.trackCount * sizeof(uint16_t) + header.poolSize;
+        header.crc = CrcTrailer::updateLarge(0, bytes.data() + sizeof(header), std::min(end, bytes.size()) - sizeof(header));
+        memcpy(bytes.data(), &header, sizeof(header));
+        return bytes;
+    }
+
+    MusicDb::TrackRecord* trackAt(std::vector<uint8_t>& bytes, size_t id) {
+        return reinterpret_cast<MusicDb::TrackRecord*>(bytes.data() + sizeof(MusicDb::Header)) + id;
+    }
+
+    MusicDb::DirRecord* dirAt(std::vector<uint8_t>& bytes, size_t id) {
+        MusicDb::Header header = headerOf(bytes);
+        return reinterpret_cast<MusicDb::DirRecord*>(bytes.data() + sizeof(header) +
+                                                     header.trackCount * sizeof(MusicDb::TrackRecord)) + id;
+    }
+
+    uint16_t* durationOrderAt(std::vector<uint8_t>& bytes, size_t id) {
+        MusicDb::Header header = headerOf(bytes);
+        return reinterpret_cast<uint16_t*>(reinterpret_cast<uint8_t*>(dirAt(bytes, header.dirCount))) + id;
+    }
+
+    // /music with two albums (one holding a disc folder) and a loose track, all added out of order.
+    std::vector<uint8_t> smallLibrary() {
+        MusicDb::Builder builder;
+        MusicDb::DirId root = builder.addDir("/music", MusicDb::NO_DIR);
+        MusicDb::DirId zeta = builder.addDir("/music/Zeta", root);
+        MusicDb::DirId alpha = builder.addDir("/music/Alpha", root);
+        MusicDb::DirId disc = builder.addDir("/music/Alpha/Disc 2", alpha);
+        builder.addDir("/music/Lost/Orphan", 99); // Its parent was never added
+        builder.addTrack(zeta, "b.mp3", 3000, "C,44100,1152,100,0,41700", 41700, 1700000000);
+        builder.addTrack(zeta, "a.mp3", 1000, "C,44100,1152,100,0,41700", 41700, 1700000001);
+        builder.addTrack(alpha, "c.mp3", 2000, "", 5, 0);
+        builder.addTrack(alpha, "a.mp3", 2000, "", 6, 0); // Same duration: name order kept
+        builder.addTrack(alpha, "b.mp3", 500, "", 7, 0);
+        builder.addTrack(disc, "x.mp3", 9000, "", 8, 0);
+        builder.addTrack(root, "loose.mp3", 100, "", 9, 0);
+        builder.addTrack(4, "orphan.mp3", 100, "", 10, 0);
+        return builder.finish();
+    }
+
+} // namespace
+
+void test_builder_layout_and_lookups(void) {
+    std::vector<uint8_t> bytes = smallLibrary();
+    MusicDb db;
+    TEST_ASSERT_TRUE(db.load(copyOf(bytes), bytes.size()));
+    TEST_ASSERT_EQUAL_size_t(4, db.getDirCount()); // The orphan and its track are dropped
+    TEST_ASSERT_EQUAL_size_t(7, db.getTrackCount());
+
+    // Breadth-first, children by name.
+    TEST_ASSERT_EQUAL_STRING("music", db.getDirName(MusicDb::ROOT));
+    TEST_ASSERT_EQUAL_size_t(2, db.getChildDirCount(MusicDb::ROOT));
+    MusicDb::DirId alpha = db.getChildDir(MusicDb::ROOT, 0), zeta = db.getChildDir(MusicDb::ROOT, 1);
+    TEST_ASSERT_EQUAL_STRING("Alpha", db.getDirName(alpha));
+    TEST_ASSERT_EQUAL_STRING("/music/Zeta", db.getDirPath(zeta));
+    TEST_ASSERT_EQUAL_size_t(1, db.getChildDirCount(alpha));
+    TEST_ASSERT_EQUAL_STRING("Disc 2", db.getDirName(db.getChildDir(alpha, 0)));
+    TEST_ASSERT_EQUAL_size_t(0, db.getChildDirCount(zeta));
+
+    // Tracks by name within a directory, and by duration with name order breaking ties.
+    const char* byName[] = {"a.mp3", "b.mp3", "c.mp3"};
+    const char* byDuration[] = {"b.mp3", "a.mp3", "c.mp3"};
+    TEST_ASSERT_EQUAL_size_t(3, db.getDirTrackCount(alpha));
+    for (size_t i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL_STRING(byName[i], db.getTrackName(db.getDirTrack(alpha, i)));
+        TEST_ASSERT_EQUAL_STRING(byDuration[i], db.getTrackName(db.getDirTrack(alpha, i, MusicDb::Order::DURATION)));
+        TEST_ASSERT_EQUAL(alpha, db.getTrackDir(db.getDirTrack(alpha, i)));
+    }
+    MusicDb::TrackId zetaA = db.getDirTrack(zeta, 0);
+    TEST_ASSERT_EQUAL_STRING("/music/Zeta/a.mp3", db.getTrackPath(zetaA).c_str());
+    TEST_ASSERT_EQUAL_UINT32(1000, db.getTrackDurationMs(zetaA));
+    TEST_ASSERT_EQUAL_UINT32(41700, db.getTrackFileSize(zetaA));
+    TEST_ASSERT_EQUAL_UINT32(1700000001, db.getTrackLastWrite(zetaA));
+    TEST_ASSERT_EQUAL_STRING("C,44100,1152,100,0,41700", db.getTrackSeekTable(zetaA));
+    TEST_ASSERT_EQUAL_STRING("", db.getTrackSeekTable(db.getDirTrack(alpha, 0)));
+    // Stored once: both Zeta tracks point at the same seek table.
+    TEST_ASSERT_EQUAL_PTR(db.getTrackSeekTable(zetaA), db.getTrackSeekTable(db.getDirTrack(zeta, 1)));
+
+    MusicDb::DirId dir;
+    TEST_ASSERT_TRUE(db.findDir("/music", dir));
+    TEST_ASSERT_EQUAL(MusicDb::ROOT, dir);
+    TEST_ASSERT_TRUE(db.findDir("/music/Alpha/Disc 2/", dir));
+    TEST_ASSERT_EQUAL(db.getChildDir(alpha, 0), dir);
+    TEST_ASSERT_FALSE(db.findDir("/music/Beta", dir));
+    TEST_ASSERT_FALSE(db.findDir("/other", dir));
+    TEST_ASSERT_FALSE(db.findDir("/music/Lost", dir));
+    MusicDb::TrackId track;
+    TEST_ASSERT_TRUE(db.findTrack("/music/Alpha/Disc 2/x.mp3", track));
+    TEST_ASSERT_EQUAL_UINT32(9000, db.getTrackDurationMs(track));
+    TEST_ASSERT_TRUE(db.findTrack("/music/loose.mp3", track));
+    TEST_ASSERT_FALSE(db.findTrack("/music/Alpha/d.mp3", track));
+    TEST_ASSERT_FALSE(db.findTrack("/music/Lost/Orphan/orphan.mp3", track));
+
+    // A copy shares the buffer and outlives the original.
+    MusicDb copy = db;
+    db.clear();
+    TEST_ASSERT_FALSE(db.isLoaded());
+    TEST_ASSERT_TRUE(copy.findTrack("/music/Zeta/b.mp3", track));
+    TEST_ASSERT_EQUAL_UINT32(3000, copy.getTrackDurationMs(track));
+
+    MusicDb::Builder empty;
+    TEST_ASSERT_EQUAL_size_t(0, empty.finish().size()); // Not even a root
+}
+
+void test_load_rejects_damaged_files(void) {
+    const std::vector<uint8_t> good = smallLibrary();
+    const MusicDb::Header header = headerOf(good);
+    TEST_ASSERT_TRUE(loads(good));
+    TEST_ASSERT_TRUE(loads(resealed(good)));
+
+    // Bytes after the pool (the atomic write's CRC trailer) are not part of it.
+    std::vector<uint8_t> trailer = good;
+    trailer.insert(trailer.end(), {'\n', '#', 'c', 'r', 'c'});
+    TEST_ASSERT_TRUE(loads(trailer));
+
+    // Bad CRC: any flipped bit after the header, in records, order or pool.
+    for (size_t at = sizeof(MusicDb::Header); at < good.size(); at += 7) {
+        std::vector<uint8_t> bytes = good;
+        bytes[at] ^= 0x10;
+        TEST_ASSERT_FALSE(loads(bytes));
+    }
+    std::vector<uint8_t> bytes = good;
+    bytes[offsetof(MusicDb::Header, crc)] ^= 1;
+    TEST_ASSERT_FALSE(loads(bytes));
+
+    // Truncated: the pool (or anything before it) cut short, even by a byte.
+    for (size_t size = 0; size < good.size(); size += (size < sizeof(MusicDb::Header) + 64 ? 1 : 13)) {
+        TEST_ASSERT_FALSE(loads(good, size));
+    }
+    TEST_ASSERT_FALSE(loads(good, good.size() - 1));
+    bytes = good;
+    MusicDb::Header longer = header;
+    longer.poolSize += 1; // The header promises more pool than the file has
+    memcpy(bytes.data(), &longer, sizeof(longer));
+    TEST_ASSERT_FALSE(loads(resealed(bytes)));
+    TEST_ASSERT_FALSE(loads(std::vector<uint8_t>()));
+
+    // The header itself.
+    auto withHeader = [&good](void (*change)(MusicDb::Header&)) {
+        std::vector<uint8_t> changed = good;
+        MusicDb::Header h = headerOf(changed);
+        change(h);
+        memcpy(changed.data(), &h, sizeof(h));
+        return resealed(changed);
+    };
+    TEST_ASSERT_FALSE(loads(withHeader([](MusicDb::Header& h) { h.magic[3] = 'X'; })));
+    TEST_ASSERT_FALSE(loads(withHeader([](MusicDb::Header& h) { h.version = MusicDb::FORMAT_VERSION - 1; })));
+    TEST_ASSERT_FALSE(loads(withHeader([](MusicDb::Header& h) { h.headerSize = 40; })));
+    TEST_ASSERT_FALSE(loads(withHeader([](MusicDb::Header& h) { h.dirCount = 0; })));
+    TEST_ASSERT_FALSE(loads(withHeader([](MusicDb::Header& h) { h.trackCount = MusicDb::MAX_TRACKS + 1; })));
+    TEST_ASSERT_FALSE(loads(withHeader([](MusicDb::Header& h) { h.poolSize = 0; })));
+
+    // Offsets and ranges, each with a CRC that matches.
+    auto rejects = [&good](const char* what, void (*change)(std::vector<uint8_t>&)) {
+        std::vector<uint8_t> changed = good;
+        change(changed);
+        TEST_ASSERT_FALSE_MESSAGE(loads(resealed(changed)), what);
+    };
+    rejects("track name past the pool", [](std::vector<uint8_t>& b) { trackAt(b, 0)->name = headerOf(b).poolSize; });
+    rejects("seek table past the pool", [](std::vector<uint8_t>& b) { trackAt(b, 3)->seekTable = 0xFFFFFFFF; });
+    rejects("track in no directory", [](std::vector<uint8_t>& b) { trackAt(b, 2)->dir = (MusicDb::DirId)headerOf(b).dirCount; });
+    rejects("track outside its directory's range", [](std::vector<uint8_t>& b) { trackAt(b, 0)->dir = 2; });
+    rejects("directory name past the pool", [](std::vector<uint8_t>& b) { dirAt(b, 1)->name = headerOf(b).poolSize + 100; });
+    rejects("directory path past the pool", [](std::vector<uint8_t>& b) { dirAt(b, 0)->path = headerOf(b).poolSize; });
+    rejects("root with a parent", [](std::vector<uint8_t>& b) { dirAt(b, 0)->parent = 1; });
+    rejects("parent after its child", [](std::vector<uint8_t>& b) { dirAt(b, 1)->parent = 3; });
+    rejects("child range past the end", [](std::vector<uint8_t>& b) { dirAt(b, 0)->childCount = 4; });
+    rejects("child range before the parent", [](std::vector<uint8_t>& b) { dirAt(b, 1)->firstChild = 0; });
+    rejects("track range past the end", [](std::vector<uint8_t>& b) { dirAt(b, 3)->trackCount = 100; });
+    rejects("track range overflowing", [](std::vector<uint8_t>& b) { dirAt(b, 3)->firstTrack = 0xFFFFFFFF; });
+    rejects("duration order past the end", [](std::vector<uint8_t>& b) { *durationOrderAt(b, 0) = (uint16_t)headerOf(b).trackCount; });
+    rejects("duration order across directories", [](std::vector<uint8_t>& b) {
+        std::swap(*durationOrderAt(b, 0), *durationOrderAt(b, headerOf(b).trackCount - 1));
+    });
+    rejects("pool not starting with \"\"", [](std::vector<uint8_t>& b) {
+        b[b.size() - headerOf(b).poolSize] = 'x';
+    });
+    rejects("last string not terminated", [](std::vector<uint8_t>& b) {
+        if (!b.empty()) b.back() = 'x';
+    });
+
+    // A failed load leaves nothing behind.
+    MusicDb db;
+    TEST_ASSERT_TRUE(db.load(copyOf(good), good.size()));
+    TEST_ASSERT_FALSE(db.load(copyOf(good), good.size() - 1));
+    TEST_ASSERT_FALSE(db.isLoaded());
+    TEST_ASSERT_EQUAL_size_t(0, db.getTrackCount());
+    TEST_ASSERT_FALSE(db.load(nullptr, 0));
+}
+
+void test_load_time_5000_tracks(void) {
+    volume = TestSandbox::mount("music_db");
+    TEST_ASSERT_NOT_NULL(volume);
+    SdCardManager::SdCardManagerAPI& sd = SdCardManager::getInstance();
+    TEST_ASSERT_TRUE(sd.exists("/data") || sd.createDir("/data"));
+    TEST_ASSERT_TRUE(sd.createDir("/music"));
+
+    // 250 albums of 20 tracks, each with a Xing seek table as the indexer stores it.
+    const int albums = 250, perAlbum = 20;
+    srand(1);
+    std::string seekTable = "X,44100,1152,9000,417,8000000,";
+    for (int i = 0; i < 100; ++i) {
+        char point[3];
+        snprintf(point, sizeof(point), "%02x", i * 2);
+        seekTable += point;
+    }
+    MusicDb::Builder builder;
+    MusicDb::DirId root = builder.addDir("/music", MusicDb::NO_DIR);
+    std::vector<std::string> albumPaths;
+    for (int a = 0; a < albums; ++a) {
+        char name[32];
+        snprintf(name, sizeof(name), "/music/Album %03d", a);
+        albumPaths.push_back(name);
+        TEST_ASSERT_TRUE(sd.createDir(name));
+        MusicDb::DirId dir = builder.addDir(name, root);
+        std::string index; // The per-directory _index.txt the database replaced
+        for (int t = 0; t < perAlbum; ++t) {
+            char track[64];
+            snprintf(track, sizeof(track), "%02d - Some Song Title %d.mp3", t, rand() % 1000);
+            uint32_t durationMs = 60000 + rand() % 300000;
+            std::string table = seekTable;
+            table[table.size() - 1 - rand() % 150] = (char)('0' + rand() % 10); // Each track its own
+            builder.addTrack(dir, track, durationMs, table, 5000000, 1700000000);
+            index += std::string("T;") + track + ";" + name + "/" + track + ";" + std::to_string(durationMs / 1000) + ";" + table + "\n";
+        }
+        TEST_ASSERT_TRUE(sd.writeFileAtomic((albumPaths.back() + "/_index.txt").c_str(), index.data(), index.size()));
+    }
+    std::vector<uint8_t> file = builder.finish();
+    TEST_ASSERT_EQUAL_size_t(albums * perAlbum, builder.getTrackCount());
+    const char* path = "/data/music_library.kdb";
+    TEST_ASSERT_TRUE(sd.writeFileAtomic(path, (const char*)file.data(), file.size()));
+
+    // As MusicLibraryManager::loadDb(): one read into a buffer, then load() in place.
+    const int rounds = 20;
+    MusicDb db;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        File in = sd.openFileUncached(path, FILE_READ);
+        TEST_ASSERT_TRUE((bool)in);
+        size_t size = in.size();
+        uint8_t* buffer = (uint8_t*)malloc(size);
+        std::shared_ptr<const uint8_t> data(buffer, free);
+        TEST_ASSERT_EQUAL_size_t(size, in.read(buffer, size));
+        in.close();
+        TEST_ASSERT_TRUE(db.load(std::move(data), size));
+    }
+    double binaryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / rounds;
+    TEST_ASSERT_EQUAL_size_t(albums * perAlbum, db.getTrackCount());
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) db.load(copyOf(file), file.size());
+    double checkMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    // The text index: a line reader per directory, each entry split into strings.
+    struct Entry {
+        std::string name, path;
+        uint32_t durationS;
+    };
+    start = std::chrono::steady_clock::now();
+    size_t entries = 0;
+    for (int r = 0; r < rounds; ++r) {
+        sd.invalidateAll(); // As at boot: nothing cached yet
+        std::vector<Entry> all;
+        for (const std::string& album : albumPaths) {
+            SdCardManager::LineReader reader = sd.openLineReader((album + "/_index.txt").c_str());
+            std::string_view line, rest, type, name, trackPath, duration;
+            while (reader.readLine(line)) {
+                rest = line;
+                if (!SdCardManager::splitField(rest, ';', type) || type != "T" || !SdCardManager::splitField(rest, ';', name) ||
+                    !SdCardManager::splitField(rest, ';', trackPath) || !SdCardManager::splitField(rest, ';', duration)) {
+                    continue;
+                }
+                all.push_back({std::string(name), std::string(trackPath), (uint32_t)atoi(std::string(duration).c_str())});
+            }
+        }
+        entries = all.size();
+    }
+    double textMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / rounds;
+    TEST_ASSERT_EQUAL_size_t(albums * perAlbum, entries);
+
+    char message[192];
+    snprintf(message, sizeof(message),
+             "5000 tracks: %u byte database read and loaded in %.2f ms (%.2f ms of it checking); "
+             "250 text indexes opened, read and parsed in %.2f ms",
+             (unsigned)file.size(), binaryMs, checkMs, textMs);
+    TEST_MESSAGE(message);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_builder_layout_and_lookups);
+    RUN_TEST(test_load_rejects_damaged_files);
+    RUN_TEST(test_load_time_5000_tracks);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
@@ -0,0 +1,367 @@
+// MusicLibraryScan over a synthetic 5,000-file tree behind its Source interface: a first
+// scan reads every track, a rescan of an unchanged tree reads none, files changed by size
+// or modification time are read again, removals are counted and dropped, the result is
+// byte for byte what a scan from scratch gives, and the old text indexes are found.
+
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <string.h>
+#include "MusicLibraryScan.h"
+#include "Mp3SeekTable.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+namespace {
+
+    const std::string ROOT = "/user/music";
+    const uint32_t FRAME_BYTES = 417; // CBR MPEG1 Layer III, 128 kbps at 44.1 kHz
+
+    struct FakeFile {
+        uint32_t size;
+        uint32_t lastWrite;
+    };
+
+    // The card: subdirectories and files per directory path.
+    struct Tree {
+        std::map<std::string, std::vector<std::string>> dirs;
+        std::map<std::string, std::map<std::string, FakeFile>> files;
+
+        FakeFile& file(const std::string& path) {
+            size_t slash = path.rfind('/');
+            return files[path.substr(0, slash)][path.substr(slash + 1)];
+        }
+        void removeDir(const std::string& parent, const std::string& name) {
+            std::vector<std::string>& children = dirs[parent];
+            children.erase(std::find(children.begin(), children.end(), name));
+            dirs.erase(parent + "/" + name);
+            files.erase(parent + "/" + name);
+        }
+    };
+
+    struct StreamSource : Mp3SeekTable::Source {
+        const std::vector<uint8_t>& data;
+        explicit StreamSource(const std::vector<uint8_t>& bytes) : data(bytes) {}
+        size_t readAt(uint64_t offset, uint8_t* buf, size_t len) override {
+            if (offset >= data.size()) return 0;
+            len = (size_t)std::min<uint64_t>(len, data.size() - offset);
+            memcpy(buf, data.data() + offset, len);
+            return len;
+        }
+        uint64_t size() override { return data.size(); }
+    };
+
+    // Lists the tree; a track is read as a CBR stream of its size through Mp3SeekTable, as on the device.
+    struct TreeSource : MusicLibraryScan::Source {
+        Tree& tree;
+        std::vector<std::string> reads;
+        std::map<uint32_t, std::vector<uint8_t>> streams; // By frame count
+
+        explicit TreeSource(Tree& t) : tree(t) {}
+
+        bool listDir(const std::string& path, std::vector<MusicLibraryScan::Entry>& out) override {
+            out.clear();
+            if (!tree.dirs.count(path)) return false;
+            for (const std::string& dir : tree.dirs[path]) out.push_back({dir, 0, 0, true});
+            for (const auto& file : tree.files[path]) out.push_back({file.first, file.second.size, file.second.lastWrite, false});
+            return true;
+        }
+
+        bool readTrack(const std::string& path, uint32_t& durationMs, std::string& seekTable) override {
+            reads.push_back(path);
+            uint32_t frames = tree.file(path).size / FRAME_BYTES;
+            std::vector<uint8_t>& stream = streams[frames];
+            if (stream.empty()) {
+                stream.resize((size_t)frames * FRAME_BYTES);
+                for (size_t i = 0; i < frames; ++i) {
+                    uint8_t* frame = &stream[i * FRAME_BYTES];
+                    frame[0] = 0xFF;
+                    frame[1] = 0xFB;
+                    frame[2] = 0x90;
+                    for (uint32_t k = 4; k < FRAME_BYTES; ++k) frame[k] = (uint8_t)(i * 31 + k);
+                }
+            }
+            StreamSource source(stream);
+            Mp3SeekTable table;
+            if (!table.build(source)) return false;
+            durationMs = table.getDurationMs();
+            seekTable = table.serialize();
+            return true;
+        }
+    };
+
+    /**
+     * 5,000 tracks: 200 albums of 24 (every tenth with the last four in a Bonus folder, and
+     * each with a cover that isn't a track) and 200 singles in the root.
+     */
+    Tree makeTree() {
+        std::mt19937 rng(7);
+        Tree tree;
+        tree.dirs[ROOT] = {};
+        for (int a = 0; a < 200; ++a) {
+            char album[32];
+            snprintf(album, sizeof(album), "Album %03d", a);
+            std::string albumPath = ROOT + "/" + album;
+            tree.dirs[ROOT].push_back(album);
+            tree.dirs[albumPath] = {};
+            std::string dir = albumPath;
+            for (int i = 0; i < 24; ++i) {
+                if (a % 10 == 0 && i == 20) {
+                    dir = albumPath + "/Bonus";
+                    tree.dirs[albumPath].push_back("Bonus");
+                    tree.dirs[dir] = {};
+                }
+                char track[48];
+                snprintf(track, sizeof(track), "%02d Track %d.mp3", i, (int)(rng() % 1000));
+                tree.files[dir][track] = {(uint32_t)(FRAME_BYTES * (200 + rng() % 600)), (uint32_t)(1600000000 + rng() % 10000000)};
+            }
+            tree.files[albumPath]["cover.jpg"] = {12345, 1};
+        }
+        for (int i = 0; i < 200; ++i) {
+            char single[32];
+            snprintf(single, sizeof(single), "Single %03d.mp3", i);
+            tree.files[ROOT][single] = {FRAME_BYTES * 300, 1700000000};
+        }
+        return tree;
+    }
+
+    std::vector<std::string> trackPaths(Tree& tree) {
+        std::vector<std::string> paths;
+        for (const auto& dir : tree.files) {
+            for (const auto& file : dir.second) {
+                if (file.first.size() > 4 && file.first.compare(file.first.size() - 4, 4, ".mp3") == 0) {
+                    paths.push_back(dir.first + "/" + file.first);
+                }
+            }
+        }
+        return paths;
+    }
+
+    MusicDb load(const std::vector<uint8_t>& bytes) {
+        std::shared_ptr<uint8_t> buffer(new uint8_t[bytes.size()], std::default_delete<uint8_t[]>());
+        memcpy(buffer.get(), bytes.data(), bytes.size());
+        MusicDb db;
+        TEST_ASSERT_TRUE(db.load(buffer, bytes.size()));
+        return db;
+    }
+
+    struct Run {
+        std::vector<uint8_t> bytes;
+        MusicLibraryScan::Stats stats;
+        std::vector<std::string> reads;
+        double ms;
+    };
+
+    // Steps a scan to the end, checking the progress it reports on the way.
+    Run scan(Tree& tree, const MusicDb& previous) {
+        TreeSource source(tree);
+        auto start = std::chrono::steady_clock::now();
+        MusicLibraryScan scan(source, previous, ROOT);
+        uint8_t last = 0;
+        while (scan.step()) {
+            TEST_ASSERT_TRUE(scan.getPercent() >= last);
+            TEST_ASSERT_TRUE(scan.getPercent() < 100);
+            last = scan.getPercent();
+        }
+        Run run{scan.finish(), scan.getStats(), source.reads, 0};
+        run.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        TEST_ASSERT_EQUAL_UINT8(100, scan.getPercent());
+        return run;
+    }
+
+} // namespace
+
+void test_first_scan_reads_every_track(void) {
+    Tree tree = makeTree();
+    Run full = scan(tree, MusicDb());
+    TEST_ASSERT_EQUAL_size_t(221, full.stats.dirs); // Root, 200 albums, 20 Bonus folders
+    TEST_ASSERT_EQUAL_size_t(5000, full.stats.added);
+    TEST_ASSERT_EQUAL_size_t(0, full.stats.kept + full.stats.changed + full.stats.removed + full.stats.skipped);
+    TEST_ASSERT_EQUAL_size_t(5000, full.reads.size());
+
+    MusicDb db = load(full.bytes);
+    TEST_ASSERT_EQUAL_size_t(5000, db.getTrackCount());
+    MusicDb::TrackId id;
+    TEST_ASSERT_TRUE(db.findTrack(ROOT + "/Single 007.mp3", id));
+    TEST_ASSERT_UINT32_WITHIN(80, 300 * 1152 * 1000 / 44100, db.getTrackDurationMs(id)); // CBR: from the bitrate
+    TEST_ASSERT_EQUAL_UINT32(FRAME_BYTES * 300, db.getTrackFileSize(id));
+    TEST_ASSERT_EQUAL_UINT32(1700000000, db.getTrackLastWrite(id));
+    Mp3SeekTable table;
+    TEST_ASSERT_TRUE(table.parse(db.getTrackSeekTable(id)));
+    TEST_ASSERT_EQUAL_CHAR('C', (char)table.getKind());
+    MusicDb::DirId dir;
+    TEST_ASSERT_TRUE(db.findDir(ROOT + "/Album 030/Bonus", dir));
+    TEST_ASSERT_EQUAL_size_t(4, db.getDirTrackCount(dir));
+    TEST_ASSERT_FALSE(db.findTrack(ROOT + "/Album 030/cover.jpg", id)); // Not a track
+}
+
+void test_unchanged_tree_is_kept(void) {
+    Tree tree = makeTree();
+    Run full = scan(tree, MusicDb());
+    MusicDb db = load(full.bytes);
+    Run again = scan(tree, db);
+    TEST_ASSERT_EQUAL_size_t(0, again.reads.size());
+    TEST_ASSERT_EQUAL_size_t(5000, again.stats.kept);
+    TEST_ASSERT_EQUAL_size_t(0, again.stats.added + again.stats.changed + again.stats.removed);
+    TEST_ASSERT_TRUE(again.bytes == full.bytes);
+
+    char message[128];
+    snprintf(message, sizeof(message), "5000 tracks: first scan %.1f ms with 5000 reads, unchanged rescan %.1f ms with none",
+             full.ms, again.ms);
+    TEST_MESSAGE(message);
+}
+
+void test_changed_size_or_time_is_read_again(void) {
+    Tree tree = makeTree();
+    MusicDb db = load(scan(tree, MusicDb()).bytes);
+    std::vector<std::string> paths = trackPaths(tree);
+    std::shuffle(paths.begin(), paths.end(), std::mt19937(3));
+
+    std::vector<std::string> resized(paths.begin(), paths.begin() + 40);
+    std::vector<std::string> touched(paths.begin() + 40, paths.begin() + 70);
+    for (const std::string& path : resized) tree.file(path).size += FRAME_BYTES * 7;
+    for (const std::string& path : touched) tree.file(path).lastWrite += 2; // FAT's 2 s resolution
+
+    Run run = scan(tree, db);
+    TEST_ASSERT_EQUAL_size_t(70, run.stats.changed);
+    TEST_ASSERT_EQUAL_size_t(4930, run.stats.kept);
+    TEST_ASSERT_EQUAL_size_t(0, run.stats.added + run.stats.removed);
+    std::vector<std::string> expected = resized;
+    expected.insert(expected.end(), touched.begin(), touched.end());
+    std::sort(expected.begin(), expected.end());
+    std::sort(run.reads.begin(), run.reads.end());
+    TEST_ASSERT_TRUE(expected == run.reads); // Those and nothing else
+
+    MusicDb after = load(run.bytes);
+    for (const std::string& path : resized) {
+        MusicDb::TrackId before, now;
+        TEST_ASSERT_TRUE(db.findTrack(path, before));
+        TEST_ASSERT_TRUE(after.findTrack(path, now));
+        TEST_ASSERT_EQUAL_UINT32(tree.file(path).size, after.getTrackFileSize(now));
+        TEST_ASSERT_INT_WITHIN(30, 7 * 1152 * 1000 / 44100, (int)(after.getTrackDurationMs(now) - db.getTrackDurationMs(before)));
+    }
+
+    // With no time on record only the size tells.
+    Tree untimed = makeTree();
+    for (auto& dir : untimed.files) {
+        for (auto& file : dir.second) file.second.lastWrite = 0;
+    }
+    MusicDb untimedDb = load(scan(untimed, MusicDb()).bytes);
+    untimed.file(paths[0]).size += FRAME_BYTES;
+    Run untimedRun = scan(untimed, untimedDb);
+    TEST_ASSERT_EQUAL_size_t(1, untimedRun.reads.size());
+    TEST_ASSERT_EQUAL_STRING(paths[0].c_str(), untimedRun.reads[0].c_str());
+}
+
+void test_removals_are_counted(void) {
+    Tree tree = makeTree();
+    MusicDb db = load(scan(tree, MusicDb()).bytes);
+    std::vector<std::string> paths = trackPaths(tree);
+    std::shuffle(paths.begin(), paths.end(), std::mt19937(5));
+
+    // 35 loose deletions outside Album 005, which goes as a whole; 25 new files and a new album.
+    std::vector<std::string> gone;
+    for (const std::string& path : paths) {
+        if (gone.size() == 35) break;
+        if (path.compare(0, ROOT.size() + 10, ROOT + "/Album 005") == 0) continue;
+        size_t slash = path.rfind('/');
+        tree.files[path.substr(0, slash)].erase(path.substr(slash + 1));
+        gone.push_back(path);
+    }
+    const size_t deleted = gone.size();
+    size_t albumTracks = tree.files[ROOT + "/Album 005"].size() - 1; // Less the cover
+    tree.removeDir(ROOT, "Album 005");
+    for (int i = 0; i < 25; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "New %02d.mp3", i);
+        tree.files[ROOT + "/Album " + std::to_string(110 + i)][name] = {FRAME_BYTES * 250, 1800000000};
+    }
+    tree.dirs[ROOT].push_back("Zz New Album");
+    tree.dirs[ROOT + "/Zz New Album"] = {};
+    for (int i = 0; i < 10; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "%02d.mp3", i);
+        tree.files[ROOT + "/Zz New Album"][name] = {FRAME_BYTES * 400, 1800000001};
+    }
+
+    Run run = scan(tree, db);
+    TEST_ASSERT_EQUAL_size_t(deleted + albumTracks, run.stats.removed);
+    TEST_ASSERT_EQUAL_size_t(35, run.stats.added);
+    TEST_ASSERT_EQUAL_size_t(35, run.reads.size());
+    TEST_ASSERT_EQUAL_size_t(5000 - deleted - albumTracks, run.stats.kept);
+    TEST_ASSERT_EQUAL_size_t(221, run.stats.dirs); // One album gone, one new
+
+    MusicDb after = load(run.bytes);
+    TEST_ASSERT_EQUAL_size_t(5000 - deleted - albumTracks + 35, after.getTrackCount());
+    MusicDb::TrackId id;
+    MusicDb::DirId dir;
+    TEST_ASSERT_FALSE(after.findDir(ROOT + "/Album 005", dir));
+    for (const std::string& path : gone) TEST_ASSERT_FALSE(after.findTrack(path, id));
+    TEST_ASSERT_TRUE(after.findTrack(ROOT + "/Zz New Album/03.mp3", id));
+    TEST_ASSERT_UINT32_WITHIN(80, 400 * 1152 * 1000 / 44100, after.getTrackDurationMs(id));
+
+    // The same database a scan from nothing would have written.
+    Run scratch = scan(tree, MusicDb());
+    TEST_ASSERT_TRUE(scratch.bytes == run.bytes);
+    char message[160];
+    snprintf(message, sizeof(message), "Incremental scan %.1f ms with %u reads, against %.1f ms with %u from scratch",
+             run.ms, (unsigned)run.reads.size(), scratch.ms, (unsigned)scratch.reads.size());
+    TEST_MESSAGE(message);
+}
+
+void test_unreadable_directories(void) {
+    Tree tree = makeTree();
+    MusicDb db = load(scan(tree, MusicDb()).bytes);
+
+    // A folder that can't be listed is left out with everything under it; the rest are kept.
+    Tree broken = tree;
+    broken.dirs.erase(ROOT + "/Album 020");
+    Run run = scan(broken, db);
+    TEST_ASSERT_EQUAL_size_t(0, run.reads.size());
+    TEST_ASSERT_EQUAL_size_t(5000 - 24, run.stats.kept);
+    TEST_ASSERT_EQUAL_size_t(24, run.stats.removed);
+
+    // No root, nothing to write: the caller keeps the database it has.
+    Tree empty;
+    TreeSource source(empty);
+    MusicLibraryScan scan(source, db, ROOT);
+    while (scan.step()) {}
+    TEST_ASSERT_EQUAL_size_t(0, scan.finish().size());
+}
+
+void test_legacy_indexes_are_found_and_left_out(void) {
+    Tree tree = makeTree();
+    std::vector<uint8_t> clean = scan(tree, MusicDb()).bytes;
+
+    // What the text-format library left behind: one index per folder it had synced.
+    std::vector<std::string> expected;
+    for (const std::string& dir : {ROOT, ROOT + "/Album 000", ROOT + "/Album 000/Bonus", ROOT + "/Album 199"}) {
+        tree.files[dir][MusicLibraryScan::LEGACY_INDEX_NAME] = {4096, 1650000000};
+        expected.push_back(dir + "/" + MusicLibraryScan::LEGACY_INDEX_NAME);
+    }
+    TreeSource source(tree);
+    MusicLibraryScan scan(source, MusicDb(), ROOT);
+    while (scan.step()) {}
+    TEST_ASSERT_TRUE(scan.finish() == clean); // Never tracks, and nothing else changes
+
+    std::vector<std::string> found = scan.getLegacyIndexes();
+    std::sort(found.begin(), found.end());
+    std::sort(expected.begin(), expected.end());
+    TEST_ASSERT_TRUE(found == expected);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_scan_reads_every_track);
+    RUN_TEST(test_unchanged_tree_is_kept);
+    RUN_TEST(test_changed_size_or_time_is_read_again);
+    RUN_TEST(test_removals_are_counted);
+    RUN_TEST(test_unreadable_directories);
+    RUN_TEST(test_legacy_indexes_are_found_and_left_out);
+    return UNITY_END();
+}
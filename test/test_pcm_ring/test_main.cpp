@@ -0,0 +1,289 @@
+// PcmRing and PcmOutputStage: all-or-nothing writes, wrap-around and discard; the
+// output stage's stereo blocks, partial sink writes and underrun/fill accounting; and a
+// decoder thread with SD stalls feeding a FileSink paced like the I2S DMA, for the ring
+// sizes the firmware has used, plus the unpaced throughput into a file.
+
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "TestSandbox.h"
+#include "PcmRing.h"
+#include "PcmOutputStage.h"
+
+static std::string dir;
+
+void setUp(void) {
+    dir = TestSandbox::makeDir("pcm");
+    TEST_ASSERT_FALSE(dir.empty());
+}
+
+void tearDown(void) {
+    TestSandbox::removeTree(dir);
+}
+
+static std::vector<int16_t> ramp(int16_t from, size_t count) {
+    std::vector<int16_t> out(count);
+    for (size_t i = 0; i < count; ++i) out[i] = (int16_t)(from + i);
+    return out;
+}
+
+// --- PcmRing ---
+
+void test_ring_writes_all_or_nothing_and_wraps(void) {
+    int16_t storage[16];
+    PcmRing ring;
+    TEST_ASSERT_FALSE(ring.isReady());
+    ring.init(storage, 16);
+    TEST_ASSERT_TRUE(ring.write(ramp(0, 10).data(), 10));
+    TEST_ASSERT_FALSE(ring.write(ramp(10, 7).data(), 7)); // 6 free: none of it goes in
+    TEST_ASSERT_EQUAL_UINT32(10, ring.available());
+
+    int16_t out[16];
+    TEST_ASSERT_EQUAL_UINT32(8, ring.read(out, 8));
+    TEST_ASSERT_EQUAL_INT16(7, out[7]);
+    TEST_ASSERT_TRUE(ring.write(ramp(10, 12).data(), 12)); // Across the end of the storage
+    TEST_ASSERT_EQUAL_UINT32(2, ring.space());
+    TEST_ASSERT_EQUAL_UINT32(14, ring.read(out, 16));
+    for (int i = 0; i < 14; ++i) TEST_ASSERT_EQUAL_INT16(8 + i, out[i]);
+    TEST_ASSERT_EQUAL_UINT32(22, ring.writePosition());
+    TEST_ASSERT_EQUAL_UINT32(22, ring.readPosition());
+}
+
+void test_discard_skips_only_what_was_written_before_it(void) {
+    int16_t storage[64];
+    PcmRing ring;
+    ring.init(storage, 64);
+    ring.write(ramp(0, 40).data(), 40); // The rest of the skipped track
+    ring.discard();
+    TEST_ASSERT_EQUAL_UINT32(40, ring.readPosition()); // Counted as played
+    ring.write(ramp(1000, 5).data(), 5); // The next track
+    int16_t out[64];
+    TEST_ASSERT_EQUAL_UINT32(5, ring.read(out, 64));
+    TEST_ASSERT_EQUAL_INT16(1000, out[0]);
+    TEST_ASSERT_EQUAL_UINT32(64, ring.space());
+}
+
+// --- PcmOutputStage ---
+
+namespace {
+
+    // Takes at most `limit` frames per call; keeps everything it took.
+    class RecordingSink : public PcmOutputStage::Sink {
+    public:
+        explicit RecordingSink(size_t limit) : limit_(limit) {}
+        size_t write(const int16_t* frames, size_t frameCount) override {
+            size_t n = frameCount < limit_ ? frameCount : limit_;
+            taken.insert(taken.end(), frames, frames + 2 * n);
+            return n;
+        }
+        std::vector<int16_t> taken;
+
+    private:
+        size_t limit_;
+    };
+
+} // namespace
+
+void test_stage_sends_stereo_blocks_and_finishes_partial_writes(void) {
+    int16_t storage[1024];
+    PcmRing ring;
+    ring.init(storage, 1024);
+    std::vector<int16_t> mono = ramp(-300, 600);
+    ring.write(mono.data(), mono.size());
+
+    RecordingSink sink(100);
+    PcmOutputStage stage(ring, sink);
+    size_t sent = 0, calls = 0;
+    while (size_t n = stage.pump()) {
+        TEST_ASSERT_LESS_OR_EQUAL(100, n);
+        sent += n;
+        calls++;
+    }
+    TEST_ASSERT_EQUAL_size_t(600, sent);
+    TEST_ASSERT_EQUAL_size_t(7, calls); // 256 + 256 + 88 frames, each in pieces of at most 100
+    TEST_ASSERT_EQUAL_size_t(1200, sink.taken.size());
+    for (size_t i = 0; i < mono.size(); ++i) {
+        TEST_ASSERT_EQUAL_INT16(mono[i], sink.taken[2 * i]);
+        TEST_ASSERT_EQUAL_INT16(mono[i], sink.taken[2 * i + 1]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(600, stage.getStats().framesOut);
+}
+
+void test_underruns_and_fill_only_count_while_streaming(void) {
+    int16_t storage[1024];
+    PcmRing ring;
+    ring.init(storage, 1024);
+    RecordingSink sink(1024);
+    PcmOutputStage stage(ring, sink);
+    std::vector<int16_t> block = ramp(0, 256);
+
+    // Dry before playback starts and between tracks: silence nobody hears as a gap.
+    TEST_ASSERT_EQUAL_size_t(0, stage.pump());
+    ring.write(block.data(), 256);
+    stage.pump();
+    TEST_ASSERT_EQUAL_UINT32(0, stage.getStats().underruns);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, stage.getStats().minFill);
+
+    stage.setStreaming(true);
+    ring.write(block.data(), 256);
+    ring.write(block.data(), 256);
+    stage.pump();
+    stage.pump();
+    TEST_ASSERT_EQUAL_size_t(0, stage.pump()); // Ran dry mid-track...
+    TEST_ASSERT_EQUAL_UINT32(0, stage.getStats().underruns);
+    ring.write(block.data(), 256);
+    stage.pump(); // ...and the gap ends: one underrun
+    TEST_ASSERT_EQUAL_UINT32(1, stage.getStats().underruns);
+    TEST_ASSERT_EQUAL_UINT32(0, stage.getStats().minFill);
+    TEST_ASSERT_EQUAL_UINT32(512, stage.getStats().maxFill);
+
+    stage.setStreaming(false); // Paused while dry: resuming is not an underrun
+    stage.pump();
+    ring.write(block.data(), 256);
+    stage.setStreaming(true);
+    stage.pump();
+    TEST_ASSERT_EQUAL_UINT32(1, stage.getStats().underruns);
+    stage.resetStats();
+    TEST_ASSERT_EQUAL_UINT32(0, stage.getStats().framesOut);
+}
+
+// --- Pipeline ---
+
+namespace {
+
+    const double RATE = 44100;
+
+    // A FileSink that takes as long as the DMA would to play what it is given.
+    class PacedFileSink : public PcmOutputStage::FileSink {
+    public:
+        explicit PacedFileSink(FILE* file) : FileSink(file), next_(std::chrono::steady_clock::now()) {}
+        size_t write(const int16_t* frames, size_t frameCount) override {
+            next_ += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(frameCount / RATE));
+            std::this_thread::sleep_until(next_);
+            return FileSink::write(frames, frameCount);
+        }
+
+    private:
+        std::chrono::steady_clock::time_point next_;
+    };
+
+    struct PipelineResult {
+        PcmOutputStage::Stats stats;
+        uint64_t samplesOut;
+        double seconds;
+        bool intact;
+    };
+
+    int16_t sample(uint64_t i) { return (int16_t)(8000 * sin(i * 2 * M_PI * 440 / RATE)); }
+
+    /**
+     * A decoder thread making 1152-sample MP3 frames at 8x real time, with a 250 ms SD
+     * stall every 2 s and a 120 ms slot-mutex hold every 3.3 s when paced, staged into
+     * the ring 64 samples at a time and retried when full, as AudioOutputPDM does.
+     */
+    PipelineResult runPipeline(const std::string& path, uint32_t capacity, double audioSeconds, bool paced) {
+        std::vector<int16_t> storage(capacity);
+        PcmRing ring;
+        ring.init(storage.data(), capacity);
+        FILE* file = fopen(path.c_str(), "wb");
+        TEST_ASSERT_NOT_NULL(file);
+        PcmOutputStage::FileSink fileSink(file);
+        PacedFileSink pacedSink(file);
+        PcmOutputStage stage(ring, paced ? (PcmOutputStage::Sink&)pacedSink : (PcmOutputStage::Sink&)fileSink);
+
+        std::atomic<bool> done{false};
+        const uint64_t total = (uint64_t)(audioSeconds * RATE) / 1152 * 1152;
+        auto start = std::chrono::steady_clock::now();
+        std::thread decoder([&]() {
+            int16_t frame[1152];
+            uint64_t made = 0, nextStall = 88200, nextHold = 145530;
+            while (made < total) {
+                for (int i = 0; i < 1152; ++i) frame[i] = sample(made + i);
+                if (paced) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(1152 * 1000000 / 44100 / 8));
+                    if (made >= nextStall) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+                        nextStall += 88200;
+                    }
+                    if (made >= nextHold) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(120));
+                        nextHold += 145530;
+                    }
+                }
+                for (int offset = 0; offset < 1152; offset += 64) {
+                    while (!ring.write(frame + offset, 64)) std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+                made += 1152;
+                if (made == 1152 * 20) stage.setStreaming(true); // Playback starts once primed
+            }
+            stage.setStreaming(false); // The track ends, as MusicPlayer does
+            done = true;
+        });
+
+        PipelineResult result = {};
+        while (!done || ring.available()) {
+            size_t n = stage.pump();
+            result.samplesOut += n;
+            if (n == 0) std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+        decoder.join();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fclose(file);
+        result.stats = stage.getStats();
+
+        // Nothing lost, duplicated or reordered on the way, left and right alike.
+        std::string raw;
+        TEST_ASSERT_TRUE(TestSandbox::readHostFile(path, raw));
+        const int16_t* frames = (const int16_t*)raw.data();
+        result.intact = raw.size() == total * 4;
+        for (uint64_t i = 0; result.intact && i < total; ++i) {
+            result.intact = frames[2 * i] == sample(i) && frames[2 * i + 1] == sample(i);
+        }
+        return result;
+    }
+
+} // namespace
+
+void test_ring_rides_out_sd_stalls(void) {
+    const uint32_t sizes[3] = {512, 4096, 32768}; // The old single buffer, RING_FALLBACK_SAMPLES, RING_SAMPLES
+    PipelineResult results[3];
+    char message[160];
+    for (int i = 0; i < 3; ++i) {
+        results[i] = runPipeline(dir + "/paced.raw", sizes[i], 6, true);
+        const PcmOutputStage::Stats& s = results[i].stats;
+        snprintf(message, sizeof(message), "ring %5u samples (%3.0f ms): %u underruns, fill %u..%u samples, %.1f s of audio in %.1f s",
+                 (unsigned)sizes[i], sizes[i] * 1000.0 / RATE, (unsigned)s.underruns, (unsigned)(s.minFill == UINT32_MAX ? 0 : s.minFill),
+                 (unsigned)s.maxFill, results[i].samplesOut / RATE, results[i].seconds);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_TRUE(results[i].intact);
+    }
+    TEST_ASSERT_TRUE(results[0].stats.underruns > 0); // A 12 ms buffer can't cover a 250 ms stall
+    TEST_ASSERT_TRUE(results[1].stats.underruns <= results[0].stats.underruns);
+    TEST_ASSERT_EQUAL_UINT32(0, results[2].stats.underruns);
+    TEST_ASSERT_TRUE(results[2].stats.minFill > 0 && results[2].stats.minFill != UINT32_MAX);
+    TEST_ASSERT_TRUE(results[2].stats.maxFill > 16384); // 8x real time keeps it topped up
+}
+
+void test_benchmark_unpaced_throughput(void) {
+    PipelineResult result = runPipeline(dir + "/unpaced.raw", 32768, 30, false);
+    TEST_ASSERT_TRUE(result.intact);
+    char message[128];
+    snprintf(message, sizeof(message), "unpaced, ring + stage into a file: %.1f Msamples/s (%.0fx real time at 44.1 kHz)",
+             result.samplesOut / result.seconds / 1e6, result.samplesOut / result.seconds / RATE);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(result.samplesOut / result.seconds > 10 * RATE);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_writes_all_or_nothing_and_wraps);
+    RUN_TEST(test_discard_skips_only_what_was_written_before_it);
+    RUN_TEST(test_stage_sends_stereo_blocks_and_finishes_partial_writes);
+    RUN_TEST(test_underruns_and_fill_only_count_while_streaming);
+    RUN_TEST(test_ring_rides_out_sd_stalls);
+    RUN_TEST(test_benchmark_unpaced_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,140 @@
+// RollingWindow's min/avg/max and last() as the window fills, wraps and is reset, and
+// PerfStats: nothing is collected while the HUD is off, and tick() turns the counters
+// into per-second rates.
+
+#include <unity.h>
+#include "PerfStats.h"
+
+void setUp(void) {}
+
+void tearDown(void) {
+    PerfStats::getInstance().setHudMode(PerfHudMode::OFF);
+}
+
+void test_window_tracks_min_avg_max_and_last(void) {
+    RollingWindow<4> window;
+    TEST_ASSERT_TRUE(window.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, window.min());
+    TEST_ASSERT_EQUAL_UINT32(0, window.avg());
+    TEST_ASSERT_EQUAL_UINT32(0, window.max());
+    TEST_ASSERT_EQUAL_UINT32(0, window.last());
+
+    window.add(30);
+    window.add(10);
+    window.add(20);
+    TEST_ASSERT_EQUAL_size_t(3, window.count());
+    TEST_ASSERT_EQUAL_UINT32(10, window.min());
+    TEST_ASSERT_EQUAL_UINT32(20, window.avg());
+    TEST_ASSERT_EQUAL_UINT32(30, window.max());
+    TEST_ASSERT_EQUAL_UINT32(20, window.last());
+}
+
+void test_window_drops_the_oldest_samples_across_the_wrap(void) {
+    RollingWindow<4> window;
+    for (uint32_t v : {100, 1, 2, 3}) window.add(v);
+    TEST_ASSERT_EQUAL_UINT32(100, window.max());
+    TEST_ASSERT_EQUAL_UINT32(26, window.avg()); // 106 / 4
+
+    window.add(4); // Pushes out the 100
+    TEST_ASSERT_EQUAL_size_t(4, window.count());
+    TEST_ASSERT_EQUAL_UINT32(1, window.min());
+    TEST_ASSERT_EQUAL_UINT32(4, window.max());
+    TEST_ASSERT_EQUAL_UINT32(2, window.avg()); // 10 / 4
+    TEST_ASSERT_EQUAL_UINT32(4, window.last());
+
+    // Once more around: only the last four survive, and last() follows the head.
+    for (uint32_t v : {50, 60, 70, 80, 90, 5}) window.add(v);
+    TEST_ASSERT_EQUAL_UINT32(5, window.min());
+    TEST_ASSERT_EQUAL_UINT32(90, window.max());
+    TEST_ASSERT_EQUAL_UINT32(61, window.avg()); // 245 / 4
+    TEST_ASSERT_EQUAL_UINT32(5, window.last());
+}
+
+void test_window_reset_starts_over(void) {
+    RollingWindow<3> window;
+    for (uint32_t v : {7, 8, 9, 10}) window.add(v);
+    window.reset();
+    TEST_ASSERT_TRUE(window.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, window.max());
+    TEST_ASSERT_EQUAL_UINT32(0, window.last());
+
+    // Stale slots from before the reset take no part in the new figures.
+    window.add(2);
+    TEST_ASSERT_EQUAL_size_t(1, window.count());
+    TEST_ASSERT_EQUAL_UINT32(2, window.min());
+    TEST_ASSERT_EQUAL_UINT32(2, window.avg());
+    TEST_ASSERT_EQUAL_UINT32(2, window.max());
+}
+
+void test_nothing_is_collected_while_the_hud_is_off(void) {
+    PerfStats& stats = PerfStats::getInstance();
+    stats.setHudMode(PerfHudMode::MAIN);
+    TEST_ASSERT_TRUE(PerfStats::isEnabled());
+    PerfStats::count(PerfCounter::FRAMES, 5);
+    stats.record(PerfMetric::LOOP_US, 1200);
+    { PerfStats::Scope scope(PerfMetric::SERVICES_US); }
+
+    // Turning the HUD off keeps what was collected, but adds nothing more.
+    stats.setHudMode(PerfHudMode::OFF);
+    TEST_ASSERT_FALSE(PerfStats::isEnabled());
+    PerfStats::count(PerfCounter::FRAMES, 100);
+    PerfStats::count(PerfCounter::SD_READ_BYTES, 4096);
+    stats.record(PerfMetric::LOOP_US, 9999);
+    { PerfStats::Scope scope(PerfMetric::SERVICES_US); }
+    stats.tick();
+
+    TEST_ASSERT_EQUAL_UINT32(5, stats.pending(PerfCounter::FRAMES));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.pending(PerfCounter::SD_READ_BYTES));
+    TEST_ASSERT_EQUAL_size_t(1, stats.get(PerfMetric::LOOP_US).count());
+    TEST_ASSERT_EQUAL_UINT32(1200, stats.get(PerfMetric::LOOP_US).last());
+    TEST_ASSERT_EQUAL_size_t(1, stats.get(PerfMetric::SERVICES_US).count());
+    TEST_ASSERT_TRUE(stats.get(PerfMetric::FPS).empty());
+
+    // Turning it back on starts from a clean slate.
+    stats.setHudMode(PerfHudMode::AUX);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.pending(PerfCounter::FRAMES));
+    TEST_ASSERT_TRUE(stats.get(PerfMetric::LOOP_US).empty());
+}
+
+void test_tick_rolls_counters_into_per_second_rates(void) {
+    const uint32_t FRAMES = 600, READ_BYTES = 3000000, PACKETS = 0;
+    PerfStats& stats = PerfStats::getInstance();
+    unsigned long enabledAt = millis();
+    stats.setHudMode(PerfHudMode::MAIN);
+    PerfStats::count(PerfCounter::FRAMES, FRAMES);
+    PerfStats::count(PerfCounter::SD_READ_BYTES, READ_BYTES);
+    stats.tick(); // Under a second in: too soon to roll
+    TEST_ASSERT_TRUE(stats.get(PerfMetric::FPS).empty());
+    TEST_ASSERT_EQUAL_UINT32(FRAMES, stats.pending(PerfCounter::FRAMES));
+
+    delay(1200);
+    stats.tick();
+    unsigned long longest = millis() - enabledAt; // The roll interval is between 1200 ms and this
+
+    // Each rate is the count scaled by however long the interval really was.
+    TEST_ASSERT_EQUAL_size_t(1, stats.get(PerfMetric::FPS).count());
+    uint32_t fps = stats.get(PerfMetric::FPS).last();
+    TEST_ASSERT_TRUE(fps <= FRAMES * 1000 / 1200);
+    TEST_ASSERT_TRUE(fps >= FRAMES * 1000 / longest);
+    uint32_t readBps = stats.get(PerfMetric::SD_READ_BPS).last();
+    TEST_ASSERT_TRUE(readBps <= (uint64_t)READ_BYTES * 1000 / 1200);
+    TEST_ASSERT_TRUE(readBps >= (uint64_t)READ_BYTES * 1000 / longest);
+    TEST_ASSERT_EQUAL_UINT32(PACKETS, stats.get(PerfMetric::SNIFFER_PPS).last());
+    TEST_ASSERT_EQUAL_size_t(1, stats.get(PerfMetric::SNIFFER_PPS).count()); // Zero is a sample too
+
+    // The counters start again from zero, and heap/PSRAM were sampled alongside.
+    TEST_ASSERT_EQUAL_UINT32(0, stats.pending(PerfCounter::FRAMES));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.pending(PerfCounter::SD_READ_BYTES));
+    TEST_ASSERT_EQUAL_UINT32(ESP.getFreeHeap(), stats.get(PerfMetric::FREE_HEAP).last());
+    TEST_ASSERT_EQUAL_UINT32(ESP.getFreePsram(), stats.get(PerfMetric::FREE_PSRAM).last());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_window_tracks_min_avg_max_and_last);
+    RUN_TEST(test_window_drops_the_oldest_samples_across_the_wrap);
+    RUN_TEST(test_window_reset_starts_over);
+    RUN_TEST(test_nothing_is_collected_while_the_hud_is_off);
+    RUN_TEST(test_tick_rolls_counters_into_per_second_rates);
+    return UNITY_END();
+}
@@ -0,0 +1,172 @@
+// Prefetcher behind the real ListMenu: a user scrolls to "Logs & Captures", reads it for
+// a moment and presses OK, and the log list (ListMenu over TextFileListDataSource) is
+// timed until it is complete, with and without the item's prefetch path, over
+// SdCardManager on a FaultInjectingBackend with per-operation latency.
+
+#include <unity.h>
+#include "TestSandbox.h"
+#include "App.h"
+#include "ListMenu.h"
+#include "Prefetcher.h"
+#include "TextFileListDataSource.h"
+
+using SdCardManager::getInstance;
+
+static const int LOG_FILES = 1000;
+static const uint32_t LATENCY_MICROS = 400;
+static const uint32_t READ_MS = 800; // How long the user looks at the item before pressing OK
+
+static FaultInjectingBackend* faults = nullptr;
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {
+    faults = TestSandbox::mountWithFaults("prefetch", &volume);
+    TEST_ASSERT_NOT_NULL(faults);
+    for (const char* dir : {"/data", SD_ROOT::DATA_LOGS}) {
+        TEST_ASSERT_TRUE(getInstance().exists(dir) || getInstance().createDir(dir));
+    }
+    char name[64];
+    for (int i = 0; i < LOG_FILES; ++i) {
+        snprintf(name, sizeof(name), "%s/session_%04d.klog", SD_ROOT::DATA_LOGS, i);
+        TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, name), "log"));
+    }
+
+    FaultInjectingBackend::Faults slow;
+    slow.latencyMicros = LATENCY_MICROS;
+    faults->setFaults(slow);
+}
+
+void tearDown(void) {
+    Prefetcher::getInstance().cancel();
+    if (faults) faults->setFaults(FaultInjectingBackend::Faults());
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+    faults = nullptr;
+}
+
+namespace {
+
+    // A main menu as a ListMenu sees one; the second row leads to the logs.
+    class MainMenuSource : public IListMenuDataSource {
+    public:
+        explicit MainMenuSource(bool prefetchLogs) {
+            items_.push_back({"Settings", IconType::SETTINGS, MenuType::SETTINGS_GRID});
+            items_.push_back({"Logs & Captures", IconType::INFO, MenuType::TEXT_FILE_LIST});
+            items_.push_back({"About", IconType::INFO, MenuType::INFO_MENU});
+            if (prefetchLogs) items_[1].prefetchPath = SD_ROOT::DATA_LOGS;
+        }
+
+        int getNumberOfItems(App*) override { return items_.size(); }
+        void drawItem(App*, U8G2& display, ListMenu* menu, int index, int x, int y, int w, int h, bool isSelected) override {
+            menu->updateAndDrawText(display, items_[index].label, x + 4, y + h / 2 + 4, w - 8, isSelected);
+        }
+        void onItemSelected(App*, ListMenu*, int index) override { selected = index; }
+        void onEnter(App*, ListMenu*, bool) override { selected = -1; }
+        void onExit(App*, ListMenu*) override {}
+        const MenuItem* getItem(int index) const override { return &items_[index]; }
+
+        int selected = -1;
+
+    private:
+        std::vector<MenuItem> items_;
+    };
+
+    // Frames of `menu` for `ms`, as App::loop() runs them.
+    void runFrames(ListMenu& menu, App& app, U8G2& display, uint32_t ms) {
+        uint32_t start = millis();
+        do {
+            display.clear();
+            menu.onUpdate(&app);
+            menu.draw(&app, display);
+            delay(16);
+        } while (millis() - start < ms);
+    }
+
+    /**
+     * From the main menu to a complete log list: the cursor makes each of `moves` (+1 down,
+     * -1 up) and rests for the matching entry of `stops`, then OK opens the logs. Returns
+     * the milliseconds from OK until the log list has every file.
+     */
+    uint32_t openLogs(bool prefetchLogs, const std::vector<uint32_t>& stops, const std::vector<int>& moves) {
+        getInstance().invalidateAll(); // Nothing left over from the last journey
+        App app;
+        U8G2 display;
+        MainMenuSource mainSource(prefetchLogs);
+        ListMenu mainMenu("Main Menu", MenuType::MAIN, &mainSource);
+        TextFileListDataSource logSource;
+        ListMenu logMenu("Logs & Captures", MenuType::TEXT_FILE_LIST, &logSource);
+
+        mainMenu.onEnter(&app, true);
+        runFrames(mainMenu, app, display, 100);
+        for (size_t i = 0; i < stops.size(); ++i) {
+            mainMenu.handleInput(moves[i] > 0 ? InputEvent::ENCODER_CW : InputEvent::ENCODER_CCW, &app);
+            runFrames(mainMenu, app, display, stops[i]);
+        }
+        mainMenu.handleInput(InputEvent::BTN_OK_PRESS, &app);
+        TEST_ASSERT_EQUAL_INT(1, mainSource.selected);
+
+        uint32_t start = millis();
+        mainMenu.onExit(&app);
+        logMenu.onEnter(&app, true);
+        while (logSource.isLoading()) {
+            display.clear();
+            logMenu.onUpdate(&app);
+            logMenu.draw(&app, display);
+            delay(1);
+        }
+        logMenu.onUpdate(&app);
+        uint32_t elapsed = millis() - start;
+        TEST_ASSERT_EQUAL_INT(LOG_FILES, logSource.getNumberOfItems(&app));
+        logMenu.onExit(&app);
+        return elapsed;
+    }
+
+} // namespace
+
+void test_hovering_the_item_hides_the_listing_behind_the_dwell(void) {
+    uint32_t without = openLogs(false, {READ_MS}, {1});
+    uint32_t with = openLogs(true, {READ_MS}, {1});
+    // Over "Logs" for a blink on the way to "About", back up and straight in: nothing was warmed.
+    uint32_t passedOver = openLogs(true, {50, READ_MS, 0}, {1, 1, -1});
+
+    char line[200];
+    snprintf(line, sizeof(line), "%d logs at %u us/op, OK after %lu ms on the item: %lu ms without prefetch, %lu ms with it, %lu ms after passing over it",
+             LOG_FILES, (unsigned)LATENCY_MICROS, (unsigned long)READ_MS, (unsigned long)without, (unsigned long)with,
+             (unsigned long)passedOver);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_TRUE(without >= LOG_FILES * LATENCY_MICROS / 1000); // Every entry came off the card
+    TEST_ASSERT_TRUE(with * 10 < without);                         // ... or all of them from PSRAM
+    TEST_ASSERT_TRUE(passedOver * 2 > without);                    // A passing cursor warms nothing
+}
+
+void test_leaving_before_the_dwell_cancels_the_prefetch(void) {
+    getInstance().invalidateAll();
+    App app;
+    U8G2 display;
+    MainMenuSource mainSource(true);
+    ListMenu mainMenu("Main Menu", MenuType::MAIN, &mainSource);
+    mainMenu.onEnter(&app, true);
+    runFrames(mainMenu, app, display, 50);
+    mainMenu.handleInput(InputEvent::ENCODER_CW, &app);
+    runFrames(mainMenu, app, display, 50);
+    mainMenu.onExit(&app); // Back out while the dwell is still running
+
+    delay(500);
+    // The listing was never walked: timing it now still pays for every entry.
+    uint32_t start = millis();
+    size_t entries = 0;
+    TEST_ASSERT_TRUE(getInstance().forEachDirEntry(SD_ROOT::DATA_LOGS, [&](const SdCardManager::DirEntry&) {
+        entries++;
+        return true;
+    }));
+    TEST_ASSERT_EQUAL_size_t(LOG_FILES, entries);
+    TEST_ASSERT_TRUE(millis() - start >= LOG_FILES * LATENCY_MICROS / 1000);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hovering_the_item_hides_the_listing_behind_the_dwell);
+    RUN_TEST(test_leaving_before_the_dwell_cancels_the_prefetch);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
@@ -0,0 +1,146 @@
+// ReadAheadStream over SdCardManager on a FaultInjectingBackend: content checks for
+// sequential and random access, a failing seek, and the benchmark against plain File
+// reads on a card with per-operation latency.
+
+#include <unity.h>
+#include "TestSandbox.h"
+#include "ReadAheadStream.h"
+
+using SdCardManager::getInstance;
+
+static const char* PATH = "/user/music/track.mp3";
+static const size_t FILE_BYTES = 512 * 1024;
+
+static FaultInjectingBackend* faults = nullptr;
+static PosixStorageBackend* volume = nullptr;
+static std::string contents;
+
+void setUp(void) {
+    faults = TestSandbox::mountWithFaults("readahead", &volume);
+    TEST_ASSERT_NOT_NULL(faults);
+    if (contents.empty()) {
+        uint32_t x = 0x12345678;
+        contents.resize(FILE_BYTES);
+        for (size_t i = 0; i < FILE_BYTES; ++i) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            contents[i] = (char)x;
+        }
+    }
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, PATH), contents));
+}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+    faults = nullptr;
+}
+
+void test_sequential_read_matches_file(void) {
+    ReadAheadStream stream;
+    TEST_ASSERT_TRUE(stream.open(PATH));
+    TEST_ASSERT_EQUAL_UINT32(FILE_BYTES, stream.size());
+    std::string out(FILE_BYTES, '\0');
+    size_t done = 0;
+    while (done < FILE_BYTES) {
+        size_t n = stream.read((uint8_t*)&out[done], std::min<size_t>(1500, FILE_BYTES - done));
+        if (n == 0) break;
+        done += n;
+    }
+    TEST_ASSERT_EQUAL_size_t(FILE_BYTES, done);
+    TEST_ASSERT_TRUE(out == contents);
+    uint8_t extra;
+    TEST_ASSERT_EQUAL_size_t(0, stream.read(&extra, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, stream.getStats().restarts);
+}
+
+void test_random_seeks_match_file(void) {
+    ReadAheadStream stream;
+    TEST_ASSERT_TRUE(stream.open(PATH, 4096, 4));
+    uint32_t x = 99;
+    uint8_t buf[3000];
+    for (int i = 0; i < 200; ++i) {
+        x = x * 1103515245 + 12345;
+        uint32_t pos = (x >> 8) % FILE_BYTES;
+        size_t want = std::min<size_t>(sizeof(buf), FILE_BYTES - pos);
+        TEST_ASSERT_TRUE(stream.seek(pos));
+        TEST_ASSERT_EQUAL_size_t(want, stream.read(buf, want));
+        TEST_ASSERT_EQUAL_MEMORY(contents.data() + pos, buf, want);
+        TEST_ASSERT_EQUAL_UINT32(pos + want, stream.position());
+    }
+    TEST_ASSERT_GREATER_THAN(0, stream.getStats().restarts);
+}
+
+void test_failed_seek_ends_the_stream_instead_of_reading_elsewhere(void) {
+    ReadAheadStream stream;
+    TEST_ASSERT_TRUE(stream.open(PATH, 4096, 2));
+    uint8_t buf[4096];
+    TEST_ASSERT_EQUAL_size_t(sizeof(buf), stream.read(buf, sizeof(buf)));
+
+    FaultInjectingBackend::Faults badSeeks;
+    badSeeks.failSeeks = true;
+    faults->setFaults(badSeeks);
+    const uint32_t far = 300 * 1024;
+    TEST_ASSERT_TRUE(stream.seek(far));
+    size_t n = stream.read(buf, sizeof(buf));
+    // Whatever arrives must be the bytes at `far`; with the filler's seek failing, nothing does.
+    TEST_ASSERT_EQUAL_size_t(0, n);
+    TEST_ASSERT_EQUAL_size_t(0, stream.read(buf, sizeof(buf)));
+}
+
+// A decoder's consumption: 2 KB per frame, with the CPU busy between reads.
+static uint32_t decodeWith(size_t (*readChunk)(void*, uint8_t*, size_t), void* source, uint32_t decodeMicros, size_t& bytes) {
+    uint8_t chunk[2048];
+    uint32_t start = micros();
+    bytes = 0;
+    size_t n;
+    while ((n = readChunk(source, chunk, sizeof(chunk))) > 0) {
+        bytes += n;
+        delayMicroseconds(decodeMicros);
+    }
+    return micros() - start;
+}
+
+void test_benchmark_against_direct_reads(void) {
+    const uint32_t LATENCY_MICROS = 1000; // Per card operation, like a slow SPI transaction
+    const uint32_t DECODE_MICROS = 400;
+    FaultInjectingBackend::Faults slow;
+    slow.latencyMicros = LATENCY_MICROS;
+    faults->setFaults(slow);
+
+    File direct = getInstance().openFileUncached(PATH, FILE_READ);
+    TEST_ASSERT_TRUE((bool)direct);
+    size_t directBytes;
+    uint32_t directMicros = decodeWith([](void* f, uint8_t* b, size_t n) { return static_cast<File*>(f)->read(b, n); },
+                                       &direct, DECODE_MICROS, directBytes);
+    direct.close();
+
+    ReadAheadStream stream;
+    TEST_ASSERT_TRUE(stream.open(PATH));
+    size_t aheadBytes;
+    uint32_t aheadMicros = decodeWith([](void* s, uint8_t* b, size_t n) { return static_cast<ReadAheadStream*>(s)->read(b, n); },
+                                      &stream, DECODE_MICROS, aheadBytes);
+    ReadAheadStream::Stats stats = stream.getStats();
+
+    char line[200];
+    snprintf(line, sizeof(line), "%u KB, %u us/op card latency: direct %lu ms, read-ahead %lu ms (%lu stalls, %lu us max)",
+             (unsigned)(FILE_BYTES / 1024), (unsigned)LATENCY_MICROS, (unsigned long)(directMicros / 1000),
+             (unsigned long)(aheadMicros / 1000), (unsigned long)stats.stalls, (unsigned long)stats.maxStallMicros);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_size_t(FILE_BYTES, directBytes);
+    TEST_ASSERT_EQUAL_size_t(FILE_BYTES, aheadBytes);
+    // Card time hides behind decoding: well under the direct run, which pays for both.
+    TEST_ASSERT_LESS_THAN(directMicros * 3 / 4, aheadMicros);
+    TEST_ASSERT_LESS_THAN(FILE_BYTES / 2048 / 4, stats.stalls);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sequential_read_matches_file);
+    RUN_TEST(test_random_seeks_match_file);
+    RUN_TEST(test_failed_seek_ends_the_stream_instead_of_reading_elsewhere);
+    RUN_TEST(test_benchmark_against_direct_reads);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
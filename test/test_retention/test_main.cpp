@@ -0,0 +1,286 @@
+// RetentionEngine through BackendStorage on a PosixStorageBackend sandbox, with
+// modification times set on the host files: what is deleted and in which order, what
+// is rolled into which month, and what is left alone when a step fails or is stopped.
+
+#include <unity.h>
+#include <stdlib.h>
+#include <time.h>
+#include <utime.h>
+#include "TestSandbox.h"
+#include "RetentionEngine.h"
+
+static const char* DIR_PATH = "/data/captures";
+static const time_t UNDATED = 1000; // Written while the clock was unset
+
+static std::unique_ptr<PosixStorageBackend> volume;
+
+// Noon UTC on the given day of 2026 (or December 2025 for month 0).
+static time_t stamp(int month, int day) {
+    struct tm tm = {};
+    tm.tm_year = month ? 126 : 125;
+    tm.tm_mon = month ? month - 1 : 11;
+    tm.tm_mday = day;
+    tm.tm_hour = 12;
+    return timegm(&tm);
+}
+
+void setUp(void) {
+    volume.reset(new PosixStorageBackend(TestSandbox::makeDir("retention")));
+    TEST_ASSERT_TRUE(volume->begin());
+    TEST_ASSERT_TRUE(volume->mkdir("/data"));
+    TEST_ASSERT_TRUE(volume->mkdir(DIR_PATH));
+}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume.reset();
+}
+
+namespace {
+
+    std::string at(const std::string& name) { return std::string(DIR_PATH) + "/" + name; }
+
+    void putFile(const std::string& sdPath, size_t size, time_t lastWrite) {
+        std::string host = TestSandbox::hostPath(*volume, sdPath.c_str());
+        TEST_ASSERT_TRUE(TestSandbox::writeHostFile(host, std::string(size, 'p')));
+        struct utimbuf times = {lastWrite, lastWrite};
+        TEST_ASSERT_EQUAL_INT(0, utime(host.c_str(), &times));
+    }
+
+    void putDir(const std::string& sdPath) { TEST_ASSERT_TRUE(volume->mkdir(sdPath.c_str())); }
+
+    bool exists(const std::string& sdPath) { return volume->exists(sdPath.c_str()); }
+
+    RetentionPolicy policy() {
+        RetentionPolicy p = {DIR_PATH, "cap_", ".pcap", 0, 0, 0, 0};
+        return p;
+    }
+
+    RetentionEngine::Report apply(const RetentionPolicy& p, bool expected = true,
+                                  const std::function<bool()>& shouldStop = nullptr) {
+        RetentionEngine::BackendStorage storage(*volume);
+        RetentionEngine engine(storage);
+        RetentionEngine::Report report = {};
+        TEST_ASSERT_EQUAL(expected, engine.apply(p, report, shouldStop));
+        return report;
+    }
+
+} // namespace
+
+void test_count_budget_deletes_the_oldest_first(void) {
+    putDir(at("2025-12"));
+    putFile(at("2025-12/cap_old.pcap"), 10, stamp(0, 20)); // Already rolled, still counted
+    putFile(at("cap_b.pcap"), 10, stamp(3, 2));
+    putFile(at("cap_a.pcap"), 10, stamp(3, 3));
+    putFile(at("cap_z.pcap"), 10, UNDATED); // An unknown time counts as older than any real one
+    putFile(at("cap_c.pcap"), 10, stamp(3, 4));
+    putFile(at("cap_d.pcap"), 10, stamp(3, 5));
+    putFile(at("notes.txt"), 10, UNDATED); // Outside the policy
+
+    RetentionPolicy p = policy();
+    p.maxFiles = 3;
+    RetentionEngine::Report report = apply(p);
+
+    TEST_ASSERT_EQUAL_UINT32(3, report.deleted);
+    TEST_ASSERT_EQUAL_UINT64(30, report.freedBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, report.failed);
+    TEST_ASSERT_FALSE(exists(at("cap_z.pcap")));
+    TEST_ASSERT_FALSE(exists(at("2025-12/cap_old.pcap")));
+    TEST_ASSERT_FALSE(exists(at("cap_b.pcap")));
+    for (const char* kept : {"cap_a.pcap", "cap_c.pcap", "cap_d.pcap", "notes.txt"}) TEST_ASSERT_TRUE_MESSAGE(exists(at(kept)), kept);
+
+    // Within budget now, so a second pass does nothing.
+    report = apply(p);
+    TEST_ASSERT_EQUAL_UINT32(0, report.deleted);
+}
+
+void test_byte_budget_deletes_the_oldest_until_it_fits(void) {
+    putFile(at("cap_1.pcap"), 400, stamp(3, 1));
+    putFile(at("cap_2.pcap"), 100, stamp(3, 2));
+    putFile(at("cap_3b.pcap"), 300, stamp(3, 3)); // Same time: by name
+    putFile(at("cap_3a.pcap"), 200, stamp(3, 3));
+    putFile(at("cap_4.pcap"), 500, stamp(3, 4));
+
+    RetentionPolicy p = policy();
+    p.maxBytes = 1000; // 1500 in all
+    RetentionEngine::Report report = apply(p);
+
+    // 400 and 100 bring it to exactly 1000; nothing newer goes.
+    TEST_ASSERT_EQUAL_UINT32(2, report.deleted);
+    TEST_ASSERT_EQUAL_UINT64(500, report.freedBytes);
+    TEST_ASSERT_FALSE(exists(at("cap_1.pcap")));
+    TEST_ASSERT_FALSE(exists(at("cap_2.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_3a.pcap")));
+
+    p.maxBytes = 800;
+    report = apply(p);
+    TEST_ASSERT_EQUAL_UINT32(1, report.deleted);
+    TEST_ASSERT_FALSE(exists(at("cap_3a.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_3b.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_4.pcap")));
+}
+
+void test_keep_newest_survives_any_budget(void) {
+    for (int day = 1; day <= 5; ++day) {
+        char name[32];
+        snprintf(name, sizeof(name), "cap_%d.pcap", day);
+        putFile(at(name), 100, stamp(3, day));
+    }
+    RetentionPolicy p = policy();
+    p.maxFiles = 1;
+    p.maxBytes = 1;
+    p.keepNewest = 3;
+    RetentionEngine::Report report = apply(p);
+
+    TEST_ASSERT_EQUAL_UINT32(2, report.deleted);
+    TEST_ASSERT_FALSE(exists(at("cap_1.pcap")));
+    TEST_ASSERT_FALSE(exists(at("cap_2.pcap")));
+    for (const char* kept : {"cap_3.pcap", "cap_4.pcap", "cap_5.pcap"}) TEST_ASSERT_TRUE_MESSAGE(exists(at(kept)), kept);
+}
+
+void test_flat_files_roll_into_month_and_undated_buckets(void) {
+    putFile(at("cap_jan15.pcap"), 10, stamp(1, 15));
+    putFile(at("cap_jan20.pcap"), 10, stamp(1, 20));
+    putFile(at("cap_feb.pcap"), 10, stamp(2, 10));
+    putFile(at("cap_nodate.pcap"), 10, UNDATED);
+    putFile(at("cap_mar4.pcap"), 10, stamp(3, 4));
+    putFile(at("cap_mar5.pcap"), 10, stamp(3, 5));
+
+    RetentionPolicy p = policy();
+    p.flatFiles = 2;
+    RetentionEngine::Report report = apply(p);
+
+    TEST_ASSERT_EQUAL_UINT32(4, report.moved);
+    TEST_ASSERT_EQUAL_UINT32(0, report.deleted);
+    TEST_ASSERT_EQUAL_UINT32(0, report.failed);
+    TEST_ASSERT_TRUE(exists(at("undated/cap_nodate.pcap")));
+    TEST_ASSERT_TRUE(exists(at("2026-01/cap_jan15.pcap")));
+    TEST_ASSERT_TRUE(exists(at("2026-01/cap_jan20.pcap")));
+    TEST_ASSERT_TRUE(exists(at("2026-02/cap_feb.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_mar4.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_mar5.pcap")));
+    TEST_ASSERT_FALSE(exists(at("cap_jan15.pcap")));
+
+    // Rolled files still count against the budgets, oldest first.
+    p.maxFiles = 4;
+    report = apply(p);
+    TEST_ASSERT_EQUAL_UINT32(2, report.deleted);
+    TEST_ASSERT_EQUAL_UINT32(0, report.moved);
+    TEST_ASSERT_FALSE(exists(at("undated/cap_nodate.pcap")));
+    TEST_ASSERT_FALSE(exists(at("2026-01/cap_jan15.pcap")));
+    TEST_ASSERT_TRUE(exists(at("2026-01/cap_jan20.pcap")));
+}
+
+void test_a_move_onto_an_existing_name_fails_and_leaves_both(void) {
+    putDir(at("2026-01"));
+    putFile(at("2026-01/cap_a.pcap"), 7, stamp(1, 31)); // Rolled by an earlier pass
+    putFile(at("cap_a.pcap"), 3, stamp(1, 15));
+    putFile(at("cap_b.pcap"), 3, stamp(1, 16));
+    putFile(at("cap_c.pcap"), 3, stamp(3, 5));
+
+    RetentionPolicy p = policy();
+    p.flatFiles = 1;
+    p.keepNewest = 1; // cap_c stays flat
+    RetentionEngine::Report report = apply(p);
+
+    TEST_ASSERT_EQUAL_UINT32(1, report.failed);
+    TEST_ASSERT_EQUAL_UINT32(1, report.moved);
+    TEST_ASSERT_TRUE(exists(at("cap_a.pcap"))); // Left where it was
+    TEST_ASSERT_TRUE(exists(at("2026-01/cap_b.pcap")));
+    std::string rolled;
+    TEST_ASSERT_TRUE(TestSandbox::readHostFile(TestSandbox::hostPath(*volume, at("2026-01/cap_a.pcap").c_str()), rolled));
+    TEST_ASSERT_EQUAL_size_t(7, rolled.size()); // Not overwritten
+}
+
+void test_should_stop_abandons_the_pass_between_operations(void) {
+    for (int day = 1; day <= 8; ++day) {
+        char name[32];
+        snprintf(name, sizeof(name), "cap_%d.pcap", day);
+        putFile(at(name), 10, stamp(3, day));
+    }
+    RetentionPolicy p = policy();
+    p.maxFiles = 3;
+    int polls = 0;
+    RetentionEngine::Report report = apply(p, false, [&polls]() { return ++polls > 2; });
+
+    TEST_ASSERT_EQUAL_INT(3, polls);
+    TEST_ASSERT_EQUAL_UINT32(2, report.deleted);
+    TEST_ASSERT_FALSE(exists(at("cap_2.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_3.pcap")));
+
+    // The next pass picks up where it stopped.
+    report = apply(p);
+    TEST_ASSERT_EQUAL_UINT32(3, report.deleted);
+    TEST_ASSERT_FALSE(exists(at("cap_5.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_6.pcap")));
+
+    // Stopping during the roll leaves the rest flat.
+    p.maxFiles = 0;
+    p.flatFiles = 1;
+    polls = 0;
+    report = apply(p, false, [&polls]() { return ++polls > 1; });
+    TEST_ASSERT_EQUAL_UINT32(1, report.moved);
+    TEST_ASSERT_TRUE(exists(at("2026-03/cap_6.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_7.pcap")));
+}
+
+void test_a_missing_directory_is_reported_and_nothing_happens(void) {
+    RetentionPolicy p = policy();
+    p.dir = "/data/nothing_here";
+    p.maxFiles = 1;
+    RetentionEngine::Report report = apply(p, false);
+    TEST_ASSERT_EQUAL_UINT32(0, report.deleted + report.moved + report.failed);
+
+    // A file where the directory should be is no better.
+    putFile("/data/not_a_dir", 10, stamp(3, 1));
+    p.dir = "/data/not_a_dir";
+    apply(p, false);
+    TEST_ASSERT_TRUE(exists("/data/not_a_dir"));
+}
+
+void test_subdirectories_that_are_not_buckets_are_left_alone(void) {
+    TEST_ASSERT_TRUE(RetentionEngine::isBucketName("2026-10"));
+    TEST_ASSERT_TRUE(RetentionEngine::isBucketName("undated"));
+    for (const char* name : {"2026-1", "2026_10", "26-10-01", "2026-100", "abcd-ef", "Undated", "archive", ""}) {
+        TEST_ASSERT_FALSE_MESSAGE(RetentionEngine::isBucketName(name), name);
+    }
+
+    for (const char* dir : {"archive", "2026-1", "2026_01"}) {
+        putDir(at(dir));
+        putFile(at(std::string(dir) + "/cap_kept.pcap"), 10, UNDATED);
+    }
+    putDir(at("2026-02"));
+    putDir(at("2026-02/2026-01")); // Buckets are one level deep
+    putFile(at("2026-02/2026-01/cap_nested.pcap"), 10, UNDATED);
+    putFile(at("cap_1.pcap"), 10, stamp(3, 1));
+    putFile(at("cap_2.pcap"), 10, stamp(3, 2));
+
+    RetentionPolicy p = policy();
+    p.maxFiles = 1;
+    p.flatFiles = 1;
+    RetentionEngine::Report report = apply(p);
+
+    TEST_ASSERT_EQUAL_UINT32(1, report.deleted);
+    TEST_ASSERT_EQUAL_UINT32(0, report.moved);
+    TEST_ASSERT_FALSE(exists(at("cap_1.pcap")));
+    TEST_ASSERT_TRUE(exists(at("cap_2.pcap")));
+    for (const char* dir : {"archive", "2026-1", "2026_01"}) {
+        TEST_ASSERT_TRUE_MESSAGE(exists(at(std::string(dir) + "/cap_kept.pcap")), dir);
+    }
+    TEST_ASSERT_TRUE(exists(at("2026-02/2026-01/cap_nested.pcap")));
+}
+
+int main(int, char**) {
+    setenv("TZ", "UTC", 1); // Month buckets follow the local calendar
+    tzset();
+    UNITY_BEGIN();
+    RUN_TEST(test_count_budget_deletes_the_oldest_first);
+    RUN_TEST(test_byte_budget_deletes_the_oldest_until_it_fits);
+    RUN_TEST(test_keep_newest_survives_any_budget);
+    RUN_TEST(test_flat_files_roll_into_month_and_undated_buckets);
+    RUN_TEST(test_a_move_onto_an_existing_name_fails_and_leaves_both);
+    RUN_TEST(test_should_stop_abandons_the_pass_between_operations);
+    RUN_TEST(test_a_missing_directory_is_reported_and_nothing_happens);
+    RUN_TEST(test_subdirectories_that_are_not_buckets_are_left_alone);
+    return UNITY_END();
+}
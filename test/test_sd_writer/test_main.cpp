@@ -0,0 +1,203 @@
+// WriteCoalescer's merging and budgets, and SdWriter draining it onto SdCardManager
+// mounted on a FaultInjectingBackend: one card write per file for a burst of appends,
+// producers waiting for room, and sync()/release() as durability barriers.
+
+#include <unity.h>
+#include "TestSandbox.h"
+#include "SdWriter.h"
+#include "WriteCoalescer.h"
+
+using SdCardManager::getInstance;
+
+static FaultInjectingBackend* faults = nullptr;
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {
+    faults = TestSandbox::mountWithFaults("sdwriter", &volume);
+    TEST_ASSERT_NOT_NULL(faults);
+}
+
+void tearDown(void) {
+    // Hand every open file back before the next test remounts.
+    SdWriter::getInstance().suspend();
+    SdWriter::getInstance().resume();
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+    faults = nullptr;
+}
+
+static std::string onHost(const char* sdPath) {
+    std::string contents;
+    if (!TestSandbox::readHostFile(TestSandbox::hostPath(*volume, sdPath), contents)) return "<missing>";
+    return contents;
+}
+
+// --- WriteCoalescer ---
+
+void test_appends_merge_per_file_in_first_queued_order(void) {
+    WriteCoalescer queue(100, 4);
+    TEST_ASSERT_TRUE(queue.append("/b", "1", 1));
+    TEST_ASSERT_TRUE(queue.append("/a", "hello", 5));
+    TEST_ASSERT_TRUE(queue.append("/b", "2", 1));
+    TEST_ASSERT_TRUE(queue.append("/a", "!", 1, "\r\n", 2));
+    TEST_ASSERT_EQUAL_size_t(2, queue.pendingFiles());
+    TEST_ASSERT_EQUAL_size_t(10, queue.pendingBytes());
+
+    std::vector<WriteCoalescer::Batch> out;
+    queue.takeAll(out);
+    TEST_ASSERT_EQUAL_size_t(2, out.size());
+    TEST_ASSERT_EQUAL_STRING("/b", out[0].path.c_str());
+    TEST_ASSERT_EQUAL_STRING("12", out[0].data.c_str());
+    TEST_ASSERT_EQUAL_STRING("hello!\r\n", out[1].data.c_str());
+    TEST_ASSERT_FALSE(out[1].truncate);
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_EQUAL_size_t(0, queue.pendingBytes());
+}
+
+void test_budgets_refuse_whole_writes(void) {
+    WriteCoalescer queue(10, 2);
+    TEST_ASSERT_TRUE(queue.append("/a", "12345", 5));
+    TEST_ASSERT_TRUE(queue.append("/b", "1", 1));
+    TEST_ASSERT_FALSE(queue.append("/c", "1", 1)); // File budget
+    TEST_ASSERT_FALSE(queue.append("/a", "1234", 4, "5", 1)); // Byte budget: neither half goes in
+    TEST_ASSERT_EQUAL_size_t(6, queue.pendingBytes());
+    TEST_ASSERT_TRUE(queue.append("/a", "1234", 4));
+    TEST_ASSERT_EQUAL_size_t(10, queue.pendingBytes());
+}
+
+void test_replace_supersedes_pending_appends(void) {
+    WriteCoalescer queue(10, 4);
+    TEST_ASSERT_TRUE(queue.append("/a", "old data", 8));
+    // Fits only because the appends it replaces are given back.
+    TEST_ASSERT_TRUE(queue.replace("/a", "new", 3, 4096, false));
+    TEST_ASSERT_EQUAL_size_t(3, queue.pendingBytes());
+    TEST_ASSERT_TRUE(queue.append("/a", "+", 1));
+    TEST_ASSERT_FALSE(queue.replace("/a", "far too long", 12)); // Refused: the pending bytes stay
+
+    std::vector<WriteCoalescer::Batch> out;
+    queue.takeAll(out);
+    TEST_ASSERT_EQUAL_size_t(1, out.size());
+    TEST_ASSERT_EQUAL_STRING("new+", out[0].data.c_str());
+    TEST_ASSERT_TRUE(out[0].truncate);
+    TEST_ASSERT_EQUAL_size_t(4096, out[0].reserve);
+    TEST_ASSERT_FALSE(out[0].atomic);
+}
+
+// --- SdWriter ---
+
+void test_burst_of_appends_reaches_the_card_as_few_writes(void) {
+    SdWriter& writer = SdWriter::getInstance();
+    const char* path = "/data/logs/burst.log";
+    std::string expected;
+    char line[32];
+
+    // Held while the burst is queued, so what reaches the card is purely the coalesced form.
+    writer.suspend();
+    faults->setFaults(FaultInjectingBackend::Faults());
+    for (int i = 0; i < 200; ++i) {
+        snprintf(line, sizeof(line), "event %d", i);
+        TEST_ASSERT_TRUE(writer.appendLine(path, line));
+        expected += std::string(line) + "\r\n";
+    }
+    writer.resume();
+    TEST_ASSERT_TRUE(writer.release(path));
+
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), onHost(path).c_str());
+    char message[64];
+    snprintf(message, sizeof(message), "%llu card mutations for 200 appends", (unsigned long long)faults->getOpsDone());
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL(4, faults->getOpsDone()); // Open, one write, flush
+}
+
+void test_write_replaces_what_was_queued_before_it(void) {
+    SdWriter& writer = SdWriter::getInstance();
+    const char* path = "/config/state.txt";
+    TEST_ASSERT_TRUE(getInstance().writeFile(path, "on card"));
+    writer.suspend();
+    TEST_ASSERT_TRUE(writer.append(path, "lost", 4));
+    TEST_ASSERT_TRUE(writer.write(path, "fresh"));
+    TEST_ASSERT_TRUE(writer.append(path, "+tail", 5));
+    writer.resume();
+    TEST_ASSERT_TRUE(writer.release(path));
+    TEST_ASSERT_EQUAL_STRING("fresh+tail", onHost(path).c_str());
+    TEST_ASSERT_EQUAL_STRING("fresh+tail", getInstance().readFile(path).c_str());
+}
+
+void test_write_atomic_goes_through_the_crash_safe_path(void) {
+    SdWriter& writer = SdWriter::getInstance();
+    const char* path = "/config/atomic.txt";
+    TEST_ASSERT_TRUE(writer.writeAtomic(path, "v1", 2));
+    TEST_ASSERT_TRUE(writer.sync());
+    String out;
+    TEST_ASSERT_TRUE(getInstance().readFileAtomic(path, out));
+    TEST_ASSERT_EQUAL_STRING("v1", out.c_str());
+    TEST_ASSERT_TRUE(onHost(path).size() > 2); // CRC trailer on the card
+}
+
+void test_sync_waits_for_the_flush(void) {
+    SdWriter& writer = SdWriter::getInstance();
+    const char* path = "/data/slow.bin";
+    FaultInjectingBackend::Faults slow;
+    slow.latencyMicros = 100 * 1000; // Open, write and flush: ~300 ms before the bytes are durable
+    faults->setFaults(slow);
+
+    TEST_ASSERT_TRUE(writer.append(path, "abc", 3));
+    TEST_ASSERT_FALSE(writer.sync(50)); // Not there yet
+    TEST_ASSERT_TRUE(writer.sync());
+    TEST_ASSERT_EQUAL_STRING("abc", onHost(path).c_str());
+
+    // Everything queued is durable now, so the next sync has nothing to wait for.
+    faults->setFaults(FaultInjectingBackend::Faults());
+    uint32_t start = millis();
+    TEST_ASSERT_TRUE(writer.sync());
+    TEST_ASSERT_LESS_THAN(100, millis() - start);
+}
+
+void test_release_hands_the_file_back_to_the_cache(void) {
+    SdWriter& writer = SdWriter::getInstance();
+    const char* path = "/data/released.txt";
+    TEST_ASSERT_TRUE(writer.append(path, "x", 1));
+    TEST_ASSERT_TRUE(writer.sync());
+    TEST_ASSERT_EQUAL_size_t(1, getInstance().getFileCacheStats().openWrites); // Still held open
+    TEST_ASSERT_TRUE(writer.release(path));
+    TEST_ASSERT_EQUAL_size_t(0, getInstance().getFileCacheStats().openWrites);
+    TEST_ASSERT_TRUE(getInstance().renameFile(path, "/data/renamed.txt"));
+    TEST_ASSERT_EQUAL_STRING("x", getInstance().readFile("/data/renamed.txt").c_str());
+}
+
+void test_full_queue_waits_for_room_then_drops(void) {
+    SdWriter& writer = SdWriter::getInstance();
+    const char* path = "/data/flood.bin";
+    std::string chunk(4096, 'f');
+
+    // A draining worker: the producer waits out the full queue instead of dropping.
+    uint32_t dropped = writer.getDroppedWrites();
+    for (int i = 0; i < 64; ++i) TEST_ASSERT_TRUE(writer.append(path, chunk.data(), chunk.size()));
+    TEST_ASSERT_TRUE(writer.release(path));
+    TEST_ASSERT_EQUAL_UINT32(dropped, writer.getDroppedWrites());
+    TEST_ASSERT_EQUAL_size_t(64 * chunk.size(), onHost(path).size());
+
+    // A held one: the queue fills, the rest are refused and counted, and the held part survives.
+    writer.suspend();
+    int accepted = 0;
+    for (int i = 0; i < 16; ++i) accepted += writer.append("/data/held.bin", chunk.data(), chunk.size()) ? 1 : 0;
+    TEST_ASSERT_EQUAL(8, accepted); // 32 KB of pending bytes
+    TEST_ASSERT_EQUAL_UINT32(dropped + 8, writer.getDroppedWrites());
+    writer.resume();
+    TEST_ASSERT_TRUE(writer.release("/data/held.bin"));
+    TEST_ASSERT_EQUAL_size_t(8 * chunk.size(), onHost("/data/held.bin").size());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_appends_merge_per_file_in_first_queued_order);
+    RUN_TEST(test_budgets_refuse_whole_writes);
+    RUN_TEST(test_replace_supersedes_pending_appends);
+    RUN_TEST(test_burst_of_appends_reaches_the_card_as_few_writes);
+    RUN_TEST(test_write_replaces_what_was_queued_before_it);
+    RUN_TEST(test_write_atomic_goes_through_the_crash_safe_path);
+    RUN_TEST(test_sync_waits_for_the_flush);
+    RUN_TEST(test_release_hands_the_file_back_to_the_cache);
+    RUN_TEST(test_full_queue_waits_for_room_then_drops);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
@@ -0,0 +1,216 @@
+// SearchIndex against a brute-force lowercase strstr() over the same labels: one- and
+// two-character scans, trigram lookups (repeated trigrams, bucket collisions), each
+// keystroke narrowing the last result, edits that are not extensions, and rebuilds;
+// then the per-keystroke cost over 10,000 track names, reported against the one-frame
+// budget (and checked against it only in a build with ENABLE_BENCHMARK_BUDGETS).
+
+#include <unity.h>
+#include <algorithm>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "SearchIndex.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+namespace {
+
+    std::string lower(std::string s) {
+        for (char& c : s) {
+            if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        }
+        return s;
+    }
+
+    std::vector<uint16_t> bruteForce(const std::vector<std::string>& labels, const std::string& text) {
+        std::string needle = lower(text);
+        std::vector<uint16_t> out;
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (lower(labels[i]).find(needle) != std::string::npos) out.push_back((uint16_t)i);
+        }
+        return out;
+    }
+
+    void build(SearchIndex& index, const std::vector<std::string>& labels) {
+        TEST_ASSERT_TRUE(index.build(labels.size(), [&](size_t i) { return labels[i]; }));
+        TEST_ASSERT_EQUAL_size_t(labels.size(), index.size());
+    }
+
+    void expectQuery(SearchIndex& index, const std::vector<std::string>& labels, const char* text) {
+        std::vector<uint16_t> expected = bruteForce(labels, text);
+        const std::vector<uint16_t>& got = index.query(text);
+        TEST_ASSERT_EQUAL_size_t_MESSAGE(expected.size(), got.size(), text);
+        for (size_t i = 0; i < expected.size(); ++i) TEST_ASSERT_EQUAL_UINT16_MESSAGE(expected[i], got[i], text);
+    }
+
+    // Track names like a music library's: a few thousand distinct words would be unrealistic,
+    // so titles reuse a small vocabulary and differ by their numbers.
+    std::vector<std::string> trackNames(size_t count) {
+        static const char* const words[] = {
+            "Love", "Night", "Dream", "Fire", "Heart", "Blue", "Rain", "Summer", "Light", "Shadow",
+            "Road", "River", "Gold", "Star", "Home", "Wild", "Echo", "Ocean", "City", "Storm",
+        };
+        static const char* const artists[] = {
+            "The Midnight", "Daft Punk", "Radiohead", "Massive Attack", "Boards of Canada",
+            "Aphex Twin", "Portishead", "Air", "Moby", "Bonobo", "Tycho", "Caribou",
+        };
+        const size_t wordCount = sizeof(words) / sizeof(words[0]);
+        uint32_t x = 12345;
+        auto next = [&x]() {
+            x = x * 1103515245 + 12345;
+            return x >> 8;
+        };
+        std::vector<std::string> out;
+        char name[96];
+        for (size_t i = 0; i < count; ++i) {
+            snprintf(name, sizeof(name), "%s - %s %s %s (%u).mp3", artists[next() % 12], words[next() % wordCount],
+                     words[next() % wordCount], words[next() % wordCount], (unsigned)(i % 997));
+            out.push_back(name);
+        }
+        return out;
+    }
+
+} // namespace
+
+void test_matches_substrings_regardless_of_case(void) {
+    std::vector<std::string> labels = {"Bohemian Rhapsody", "HOME", "homeward bound", "Ohm", "", "x",
+                                       "Another One Bites the Dust", "dust in the wind", "The Wind"};
+    SearchIndex index;
+    build(index, labels);
+    for (const char* q : {"", "h", "O", "om", "HOM", "home", "ohm", "the", "THE WIND", "dust", "st in t",
+                          "zzz", "x", "xy", "Bohemian Rhapsody!", "rhapsody"}) {
+        expectQuery(index, labels, q);
+    }
+}
+
+void test_repeated_trigrams_list_an_item_once(void) {
+    std::vector<std::string> labels = {"aaaaaaaa", "abcabcabcabc", "aaa", "bca", "zzzz", "abab abab abab"};
+    SearchIndex index;
+    build(index, labels);
+    for (const char* q : {"aaa", "aaaa", "abc", "bca", "cab", "zzz", "aba", "bab", "ab a"}) {
+        const std::vector<uint16_t>& got = index.query(q);
+        TEST_ASSERT_TRUE_MESSAGE(std::adjacent_find(got.begin(), got.end(), std::greater_equal<uint16_t>()) == got.end(), q);
+        expectQuery(index, labels, q);
+    }
+}
+
+void test_bucket_collisions_are_verified(void) {
+    // Every trigram of a 4,000-label set lands in one of 4,096 buckets, so many share one;
+    // a query must only return labels that really contain it.
+    std::vector<std::string> labels;
+    char name[16];
+    for (int i = 0; i < 4000; ++i) {
+        snprintf(name, sizeof(name), "%c%c%c%04d", 'a' + i % 26, 'a' + (i / 26) % 26, 'a' + (i / 676) % 26, i);
+        labels.push_back(name);
+    }
+    SearchIndex index;
+    build(index, labels);
+    for (const char* q : {"abc", "zzz", "qrs", "0001", "999", "baa", "aab", "a00", "123"}) {
+        expectQuery(index, labels, q);
+    }
+}
+
+void test_each_keystroke_narrows_the_previous_matches(void) {
+    std::vector<std::string> labels = trackNames(2000);
+    SearchIndex index;
+    build(index, labels);
+    // Typing, one character at a time, then backspacing and editing mid-word.
+    for (const char* q : {"r", "ri", "riv", "rive", "river", "river ", "river g", "river go",
+                          "river g", "river", "rivet", "night", "nights", "ni", "", "AIR - ", "air - l"}) {
+        expectQuery(index, labels, q);
+    }
+    // Narrowing never brings back a label the previous query had dropped.
+    std::vector<uint16_t> before = index.query("storm");
+    const std::vector<uint16_t>& after = index.query("storm s");
+    TEST_ASSERT_TRUE(std::includes(before.begin(), before.end(), after.begin(), after.end()));
+}
+
+void test_rebuild_and_clear_replace_the_labels(void) {
+    SearchIndex index;
+    build(index, {"alpha", "beta", "gamma"});
+    TEST_ASSERT_EQUAL_size_t(1, index.query("alp").size());
+    std::vector<std::string> second = {"delta", "alphabet", "epsilon", "alpine"};
+    build(index, second);
+    expectQuery(index, second, "alp");
+    expectQuery(index, second, "");
+    index.clear();
+    TEST_ASSERT_EQUAL_size_t(0, index.size());
+    TEST_ASSERT_EQUAL_size_t(0, index.query("alp").size());
+    TEST_ASSERT_EQUAL_size_t(0, index.query("").size());
+}
+
+void test_benchmark_10000_items_within_one_frame(void) {
+    std::vector<std::string> labels = trackNames(10000);
+    SearchIndex index;
+    uint32_t start = micros();
+    build(index, labels);
+    uint32_t buildMicros = micros() - start;
+
+    // What a user types, one character at a time, starting from an empty query each time.
+    const char* const typed[] = {"massive attack", "summer rain", "(42)", "ocean", "tycho - wild", "echo echo", "blue"};
+    uint32_t worst = 0, total = 0, keystrokes = 0;
+    const char* worstQuery = "";
+    std::string worstText;
+    for (const char* text : typed) {
+        index.query("");
+        std::string q;
+        for (const char* p = text; *p; ++p) {
+            q += *p;
+            index.query(q.c_str());
+            uint32_t us = index.getLastQueryMicros();
+            total += us;
+            keystrokes++;
+            if (us > worst) {
+                worst = us;
+                worstQuery = text;
+                worstText = q;
+            }
+        }
+        expectQuery(index, labels, text);
+    }
+
+    // The same keystrokes as a strstr() over every (already lowercased) label.
+    std::vector<std::string> lowered;
+    for (const std::string& label : labels) lowered.push_back(lower(label));
+    uint32_t scanStart = micros();
+    size_t scanned = 0;
+    for (const char* text : typed) {
+        std::string q;
+        for (const char* p = text; *p; ++p) {
+            q += *p;
+            std::string needle = lower(q);
+            for (const std::string& label : lowered) {
+                if (strstr(label.c_str(), needle.c_str())) scanned++;
+            }
+        }
+    }
+    uint32_t scanMicros = micros() - scanStart;
+
+    char line[200];
+    snprintf(line, sizeof(line), "10000 labels indexed in %lu ms; %lu keystrokes: %lu us average, %lu us worst (\"%s\" of \"%s\")",
+             (unsigned long)(buildMicros / 1000), (unsigned long)keystrokes, (unsigned long)(total / keystrokes),
+             (unsigned long)worst, worstText.c_str(), worstQuery);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "Scanning every label per keystroke instead: %lu us average (%u matches)",
+             (unsigned long)(scanMicros / keystrokes), (unsigned)scanned);
+    TEST_MESSAGE(line);
+
+#ifdef ENABLE_BENCHMARK_BUDGETS
+    // Wall-clock budgets: only meaningful on an otherwise idle host.
+    const uint32_t FRAME_MICROS = 1000000 / 60;
+    TEST_ASSERT_TRUE(worst * 20 < FRAME_MICROS); // Headroom for the S3 being far slower than the host
+    TEST_ASSERT_TRUE(total < scanMicros);
+#endif
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_substrings_regardless_of_case);
+    RUN_TEST(test_repeated_trigrams_list_an_item_once);
+    RUN_TEST(test_bucket_collisions_are_verified);
+    RUN_TEST(test_each_keystroke_narrows_the_previous_matches);
+    RUN_TEST(test_rebuild_and_clear_replace_the_labels);
+    RUN_TEST(test_benchmark_10000_items_within_one_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+// SpaceAccounting's arithmetic, and SdCardManager keeping it in step with a
+// PosixStorageBackend, whose usedBytes() walk rounds to clusters the same way FAT does:
+// after every write, truncate, remove and mkdir made through the API the running total
+// must equal a fresh scan, and a rescan must pick up changes made behind its back.
+
+#include <unity.h>
+#include "TestSandbox.h"
+#include "SpaceAccounting.h"
+
+using SdCardManager::getInstance;
+
+static const uint32_t CLUSTER = 4096;
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+}
+
+// --- SpaceAccounting ---
+
+void test_sizes_round_up_to_clusters(void) {
+    SpaceAccounting space;
+    space.reset(1 << 20, CLUSTER);
+    space.finishScan(0);
+    space.resize(0, 1);
+    TEST_ASSERT_EQUAL_UINT64(CLUSTER, space.usedBytes());
+    space.resize(1, CLUSTER); // Still one cluster
+    TEST_ASSERT_EQUAL_UINT64(CLUSTER, space.usedBytes());
+    space.resize(CLUSTER, CLUSTER + 1);
+    TEST_ASSERT_EQUAL_UINT64(2 * CLUSTER, space.usedBytes());
+    space.resize(CLUSTER + 1, 0);
+    TEST_ASSERT_EQUAL_UINT64(0, space.usedBytes());
+    space.addDirectory();
+    TEST_ASSERT_EQUAL_UINT64(CLUSTER, space.usedBytes());
+}
+
+void test_unknown_until_scanned_and_no_change_lost(void) {
+    SpaceAccounting space;
+    space.reset(1 << 20, 0); // Sectors assumed
+    space.resize(0, 1000); // Before any scan: 2 sectors
+    TEST_ASSERT_FALSE(space.isKnown());
+    TEST_ASSERT_EQUAL_UINT64(0, space.usedBytes());
+
+    space.beginScan(); // Restarts the pending delta: the scan will see that file
+    space.resize(0, 512); // Lands while the scan walks
+    TEST_ASSERT_TRUE(space.isScanning());
+    space.finishScan(10 * 512);
+    TEST_ASSERT_TRUE(space.isKnown());
+    TEST_ASSERT_FALSE(space.isScanning());
+    TEST_ASSERT_EQUAL_UINT64(11 * 512, space.usedBytes());
+
+    // A rescan of a volume already known keeps reporting, and settles on its own result.
+    space.beginScan();
+    space.resize(512, 0);
+    TEST_ASSERT_EQUAL_UINT64(10 * 512, space.usedBytes());
+    space.finishScan(20 * 512);
+    TEST_ASSERT_EQUAL_UINT64(19 * 512, space.usedBytes());
+}
+
+void test_clamped_to_the_volume(void) {
+    SpaceAccounting space;
+    space.reset(8 * CLUSTER, CLUSTER);
+    space.finishScan(CLUSTER);
+    space.resize(2 * CLUSTER, 0); // More freed than known: a stale total, not a wrap-around
+    TEST_ASSERT_EQUAL_UINT64(0, space.usedBytes());
+    space.resize(0, 100 * CLUSTER);
+    TEST_ASSERT_EQUAL_UINT64(8 * CLUSTER, space.usedBytes());
+    space.reset(4 * CLUSTER, CLUSTER);
+    TEST_ASSERT_FALSE(space.isKnown());
+    TEST_ASSERT_EQUAL_UINT64(4 * CLUSTER, space.totalBytes());
+}
+
+// --- Through SdCardManager ---
+
+static void mountSandbox() {
+    volume = TestSandbox::mount("space", 64ULL << 20, CLUSTER);
+    TEST_ASSERT_NOT_NULL(volume);
+    TEST_ASSERT_TRUE(getInstance().isUsedSpaceKnown());
+}
+
+static void expectInStep(const char* after) {
+    char message[96];
+    snprintf(message, sizeof(message), "after %s", after);
+    TEST_ASSERT_EQUAL_UINT64_MESSAGE(volume->usedBytes(), getInstance().getUsedBytes(), message);
+}
+
+void test_mount_scan_matches_the_volume(void) {
+    mountSandbox();
+    TEST_ASSERT_EQUAL_UINT64(64ULL << 20, getInstance().getTotalBytes());
+    TEST_ASSERT_TRUE(getInstance().getUsedBytes() > 0); // The standard directories
+    expectInStep("mount");
+}
+
+void test_every_change_is_accounted(void) {
+    mountSandbox();
+    std::string text(10000, 't');
+
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/a.txt", text.c_str()));
+    expectInStep("new file");
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/a.txt", "short"));
+    expectInStep("truncating rewrite");
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/a.txt", (text + text).c_str()));
+    expectInStep("growing rewrite");
+
+    File out = getInstance().openFileUncached("/data/stream.bin", FILE_WRITE);
+    TEST_ASSERT_TRUE((bool)out);
+    for (int i = 0; i < 50; ++i) {
+        out.write((const uint8_t*)text.data(), 1000);
+        if (i % 10 == 9) {
+            out.flush();
+            expectInStep("stream write");
+        }
+    }
+    out.close();
+    getInstance().finishWrite("/data/stream.bin");
+    expectInStep("stream close");
+
+    out = getInstance().openFileUncached("/data/stream.bin", FILE_APPEND);
+    out.write((const uint8_t*)text.data(), 5000);
+    out.close();
+    getInstance().finishWrite("/data/stream.bin");
+    expectInStep("append");
+
+    out = getInstance().openFileUncached("/data/capture.pcap", FILE_WRITE, 256 * 1024);
+    TEST_ASSERT_TRUE((bool)out);
+    out.write((const uint8_t*)text.data(), 3000);
+    out.close();
+    getInstance().finishWrite("/data/capture.pcap");
+    expectInStep("preallocated stream");
+
+    TEST_ASSERT_TRUE(getInstance().writeFileAtomic("/config/state.txt", text.data(), 7000));
+    TEST_ASSERT_TRUE(getInstance().writeFileAtomic("/config/state.txt", text.data(), 100));
+    expectInStep("atomic replaces");
+
+    TEST_ASSERT_TRUE(getInstance().createDir("/user/new_dir"));
+    TEST_ASSERT_TRUE(getInstance().createDir("/user/new_dir/inner"));
+    expectInStep("mkdir");
+    TEST_ASSERT_TRUE(getInstance().renameFile("/data/stream.bin", "/user/new_dir/moved.bin"));
+    expectInStep("rename");
+    TEST_ASSERT_TRUE(getInstance().deleteFile("/user/new_dir/moved.bin"));
+    TEST_ASSERT_TRUE(getInstance().deleteFile("/config/a.txt"));
+    expectInStep("remove");
+}
+
+void test_rescan_picks_up_changes_behind_the_api(void) {
+    mountSandbox();
+    uint64_t before = getInstance().getUsedBytes();
+    std::string big(100 * 1000, 'u');
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, "/user/from_pc.bin"), big));
+    TEST_ASSERT_EQUAL_UINT64(before, getInstance().getUsedBytes()); // Nothing told it
+
+    getInstance().rescanUsedSpace();
+    uint32_t start = millis();
+    while (getInstance().getUsedBytes() != volume->usedBytes() && millis() - start < 5000) delay(1);
+    expectInStep("rescan");
+    TEST_ASSERT_EQUAL_UINT64(before + 25 * CLUSTER, getInstance().getUsedBytes());
+
+    // A remount starts over with a scan of its own.
+    getInstance().end();
+    TEST_ASSERT_EQUAL_UINT64(0, getInstance().getUsedBytes());
+    TEST_ASSERT_TRUE(getInstance().setup());
+    TEST_ASSERT_TRUE(TestSandbox::waitForSpaceScan());
+    expectInStep("remount");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sizes_round_up_to_clusters);
+    RUN_TEST(test_unknown_until_scanned_and_no_change_lost);
+    RUN_TEST(test_clamped_to_the_volume);
+    RUN_TEST(test_mount_scan_matches_the_volume);
+    RUN_TEST(test_every_change_is_accounted);
+    RUN_TEST(test_rescan_picks_up_changes_behind_the_api);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
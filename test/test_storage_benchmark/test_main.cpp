@@ -0,0 +1,98 @@
+// StorageBenchmark::runBlocking() against SdCardManager on a PosixStorageBackend: the
+// native baseline for the numbers the device reports. Only the backend underneath and
+// the shims differ from a run on the card.
+
+#include <unity.h>
+#include "TestSandbox.h"
+#include "StorageBenchmark.h"
+#include "SdWriter.h"
+#include "Config.h"
+
+using SdCardManager::getInstance;
+
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+}
+
+static void report(const StorageBenchmark::Result& r) {
+    char line[256];
+    snprintf(line, sizeof(line), "%s: seq w/r %.1f/%.1f MB/s, rand w/r %.1f/%.1f MB/s, cached/uncached %.1f/%.1f MB/s",
+             r.backend, r.seqWriteMBps, r.seqReadMBps, r.randWriteMBps, r.randReadMBps, r.cachedReadMBps,
+             r.uncachedReadMBps);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "append p50/p95/p99/max %lu/%lu/%lu/%lu us; buffers read %lu B, write %lu B",
+             (unsigned long)r.appendP50Micros, (unsigned long)r.appendP95Micros, (unsigned long)r.appendP99Micros,
+             (unsigned long)r.appendMaxMicros, (unsigned long)r.readBufferBytes, (unsigned long)r.writeBufferBytes);
+    TEST_MESSAGE(line);
+}
+
+void test_suite_runs_on_posix_backend(void) {
+    volume = TestSandbox::mount("bench");
+    TEST_ASSERT_NOT_NULL(volume);
+    StorageBenchmark& bench = StorageBenchmark::getInstance();
+
+    TEST_ASSERT_TRUE_MESSAGE(bench.runBlocking(), bench.getError());
+    TEST_ASSERT_TRUE(bench.getState() == StorageBenchmark::State::DONE);
+    TEST_ASSERT_EQUAL_UINT8(100, bench.getProgress());
+
+    const StorageBenchmark::Result& r = bench.getResult();
+    report(r);
+    TEST_ASSERT_EQUAL_STRING("POSIX", r.backend);
+    TEST_ASSERT_TRUE(r.seqWriteMBps > 0 && r.seqReadMBps > 0);
+    TEST_ASSERT_TRUE(r.randWriteMBps > 0 && r.randReadMBps > 0);
+    TEST_ASSERT_TRUE(r.cachedReadMBps > 0 && r.uncachedReadMBps > 0);
+    TEST_ASSERT_LESS_OR_EQUAL(r.appendP95Micros, r.appendP50Micros);
+    TEST_ASSERT_LESS_OR_EQUAL(r.appendP99Micros, r.appendP95Micros);
+    TEST_ASSERT_LESS_OR_EQUAL(r.appendMaxMicros, r.appendP99Micros);
+    TEST_ASSERT_TRUE(r.readBufferBytes >= 512 && r.readBufferBytes <= 16 * 1024);
+    TEST_ASSERT_TRUE(r.writeBufferBytes >= 512 && r.writeBufferBytes <= 16 * 1024);
+
+    // Scratch files are gone; the run is on record.
+    TEST_ASSERT_FALSE(getInstance().exists("/data/bench_seq.tmp"));
+    TEST_ASSERT_FALSE(getInstance().exists("/data/bench_append.tmp"));
+    TEST_ASSERT_FALSE(getInstance().exists("/data/bench_cache.tmp"));
+    TEST_ASSERT_TRUE(SdWriter::getInstance().release("/data/logs/sd_bench.csv"));
+    String csv = getInstance().readFile("/data/logs/sd_bench.csv");
+    TEST_ASSERT_TRUE(csv.startsWith("time,backend,"));
+    TEST_ASSERT_TRUE(csv.indexOf(",POSIX,") > 0);
+}
+
+void test_latency_shows_in_append_percentiles(void) {
+    FaultInjectingBackend* faults = TestSandbox::mountWithFaults("bench-slow", &volume);
+    TEST_ASSERT_NOT_NULL(faults);
+    FaultInjectingBackend::Faults slow;
+    slow.latencyMicros = 200;
+    faults->setFaults(slow);
+
+    StorageBenchmark& bench = StorageBenchmark::getInstance();
+    TEST_ASSERT_TRUE_MESSAGE(bench.runBlocking(), bench.getError());
+    report(bench.getResult());
+    // A write and a flush per record, each delayed.
+    TEST_ASSERT_GREATER_OR_EQUAL(400, bench.getResult().appendP50Micros);
+}
+
+void test_full_card_fails_the_run(void) {
+    FaultInjectingBackend* faults = TestSandbox::mountWithFaults("bench-full", &volume);
+    TEST_ASSERT_NOT_NULL(faults);
+    FaultInjectingBackend::Faults full;
+    full.spaceLeftBytes = 1024 * 1024;
+    faults->setFaults(full);
+
+    StorageBenchmark& bench = StorageBenchmark::getInstance();
+    TEST_ASSERT_FALSE(bench.runBlocking());
+    TEST_ASSERT_TRUE(bench.getState() == StorageBenchmark::State::FAILED);
+    TEST_ASSERT_EQUAL_STRING("Write failed", bench.getError());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_suite_runs_on_posix_backend);
+    RUN_TEST(test_latency_shows_in_append_percentiles);
+    RUN_TEST(test_full_card_fails_the_run);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
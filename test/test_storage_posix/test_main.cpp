@@ -0,0 +1,125 @@
+// SdCardManager mounted on a PosixStorageBackend sandbox: the same calls the firmware
+// makes, checked against the files they leave on the host.
+
+#include <unity.h>
+#include "TestSandbox.h"
+#include "Config.h"
+
+using SdCardManager::getInstance;
+
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {
+    volume = TestSandbox::mount("posix");
+    TEST_ASSERT_NOT_NULL(volume);
+}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+}
+
+static std::string onHost(const char* sdPath) {
+    std::string contents;
+    if (!TestSandbox::readHostFile(TestSandbox::hostPath(*volume, sdPath), contents)) return "<missing>";
+    return contents;
+}
+
+void test_mount_creates_standard_dirs(void) {
+    TEST_ASSERT_TRUE(getInstance().isAvailable());
+    TEST_ASSERT_EQUAL_STRING("POSIX", getInstance().getBackendName());
+    TEST_ASSERT_TRUE(getInstance().exists(SD_ROOT::DATA_LOGS));
+    TEST_ASSERT_TRUE(getInstance().exists(SD_ROOT::USER_MUSIC));
+    TEST_ASSERT_FALSE(getInstance().exists("/data/nothing_here"));
+}
+
+void test_write_and_read_file(void) {
+    TEST_ASSERT_TRUE(getInstance().writeFile("/config/test.txt", "hello card"));
+    TEST_ASSERT_EQUAL_STRING("hello card", onHost("/config/test.txt").c_str());
+    TEST_ASSERT_EQUAL_STRING("hello card", getInstance().readFile("/config/test.txt").c_str());
+
+    char buffer[6];
+    TEST_ASSERT_EQUAL_UINT(5, getInstance().readInto("/config/test.txt", buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_STRING("hello", buffer);
+}
+
+void test_uncached_stream_round_trip(void) {
+    File out = getInstance().openFileUncached("/data/stream.bin", FILE_WRITE);
+    TEST_ASSERT_TRUE((bool)out);
+    for (int i = 0; i < 1000; ++i) out.printf("line %d\n", i);
+    out.close();
+    getInstance().finishWrite("/data/stream.bin");
+
+    File in = getInstance().openFileUncached("/data/stream.bin", FILE_READ);
+    TEST_ASSERT_TRUE((bool)in);
+    TEST_ASSERT_EQUAL_size_t(onHost("/data/stream.bin").size(), in.size());
+    TEST_ASSERT_TRUE(in.seek(in.size() - 9));
+    char tail[10] = {0};
+    TEST_ASSERT_EQUAL_size_t(9, in.read((uint8_t*)tail, 9));
+    TEST_ASSERT_EQUAL_STRING("line 999\n", tail);
+    in.close();
+
+    File append = getInstance().openFileUncached("/data/stream.bin", FILE_APPEND);
+    append.print("end");
+    append.close();
+    getInstance().finishWrite("/data/stream.bin");
+    std::string all = onHost("/data/stream.bin");
+    TEST_ASSERT_EQUAL_STRING("end", all.substr(all.size() - 3).c_str());
+}
+
+void test_line_reader(void) {
+    TEST_ASSERT_TRUE(getInstance().writeFile("/user/lines.txt", "first\r\n\n  second  \nthird"));
+    SdCardManager::LineReader reader = getInstance().openLineReader("/user/lines.txt");
+    TEST_ASSERT_TRUE(reader.isOpen());
+    std::string_view line;
+    TEST_ASSERT_TRUE(reader.readLine(line));
+    TEST_ASSERT_EQUAL_STRING("first", std::string(line).c_str());
+    TEST_ASSERT_TRUE(reader.readLine(line));
+    TEST_ASSERT_EQUAL_STRING("second", std::string(line).c_str());
+    TEST_ASSERT_TRUE(reader.readLine(line));
+    TEST_ASSERT_EQUAL_STRING("third", std::string(line).c_str());
+    TEST_ASSERT_FALSE(reader.readLine(line));
+}
+
+void test_listing_rename_and_delete(void) {
+    TEST_ASSERT_TRUE(getInstance().createDir("/user/list"));
+    TEST_ASSERT_TRUE(getInstance().writeFile("/user/list/a.txt", "aa"));
+    TEST_ASSERT_TRUE(getInstance().createDir("/user/list/sub"));
+
+    std::vector<SdCardManager::DirEntry> entries;
+    TEST_ASSERT_TRUE(getInstance().listDir("/user/list", entries));
+    TEST_ASSERT_EQUAL_size_t(2, entries.size());
+    for (const SdCardManager::DirEntry& entry : entries) {
+        if (entry.name == "a.txt") {
+            TEST_ASSERT_FALSE(entry.isDir);
+            TEST_ASSERT_EQUAL_size_t(2, entry.size);
+        } else {
+            TEST_ASSERT_EQUAL_STRING("sub", entry.name.c_str());
+            TEST_ASSERT_TRUE(entry.isDir);
+        }
+    }
+
+    TEST_ASSERT_TRUE(getInstance().renameFile("/user/list/a.txt", "/user/list/b.txt"));
+    TEST_ASSERT_EQUAL_STRING("aa", onHost("/user/list/b.txt").c_str());
+    TEST_ASSERT_EQUAL_STRING("<missing>", onHost("/user/list/a.txt").c_str());
+    TEST_ASSERT_TRUE(getInstance().deleteFile("/user/list/b.txt"));
+    TEST_ASSERT_FALSE(getInstance().exists("/user/list/b.txt"));
+    TEST_ASSERT_FALSE(getInstance().readFile("/user/list/b.txt").length() > 0);
+}
+
+void test_paths_outside_the_sandbox_are_refused(void) {
+    TEST_ASSERT_FALSE(getInstance().writeFile("/../escape.txt", "x"));
+    TEST_ASSERT_FALSE(getInstance().exists("/config/../../etc"));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_mount_creates_standard_dirs);
+    RUN_TEST(test_write_and_read_file);
+    RUN_TEST(test_uncached_stream_round_trip);
+    RUN_TEST(test_line_reader);
+    RUN_TEST(test_listing_rename_and_delete);
+    RUN_TEST(test_paths_outside_the_sandbox_are_refused);
+    // SdCardManager's scan task and the logger's flusher outlive main().
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
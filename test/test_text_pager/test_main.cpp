@@ -0,0 +1,306 @@
+// TextPager on a PosixStorageBackend: pages of a 5 MB text file and of a 5 MB .klog read
+// through the checkpoint index at random, against the lines the file holds and against
+// what tools/klog_decode.py prints; the index growing only as far as a page needs; and
+// the time and bytes read for the first page, the whole index and a random page.
+
+#include <unity.h>
+#include <chrono>
+#include <sstream>
+#include <vector>
+#include "TestSandbox.h"
+#include "BinaryLog.h"
+#include "TextPager.h"
+
+static const size_t FILE_BYTES = 5 * 1024 * 1024;
+static PosixStorageBackend* volume = nullptr;
+
+void setUp(void) {
+    volume = TestSandbox::mount("pager");
+    TEST_ASSERT_NOT_NULL(volume);
+}
+
+void tearDown(void) {
+    if (volume) TestSandbox::removeTree(volume->getRootDir());
+    volume = nullptr;
+}
+
+static std::unique_ptr<TextPager> openPager(const char* path) {
+    std::unique_ptr<IStorageFile> file = volume->open(path, StorageMode::READ);
+    TEST_ASSERT_NOT_NULL(file.get());
+    std::unique_ptr<TextPager> pager(new TextPager(
+        std::unique_ptr<TextPager::Source>(new TextPager::StorageFileSource(std::move(file)))));
+    TEST_ASSERT_TRUE(pager->open());
+    return pager;
+}
+
+// A line as the pager shows it: '\r' dropped, tabs as spaces, other control bytes as '.', cut.
+static std::string displayed(const std::string& line) {
+    std::string out;
+    for (char ch : line) {
+        uint8_t c = (uint8_t)ch;
+        if (c == '\r') continue;
+        if (out.size() >= TextPager::MAX_LINE_CHARS) break;
+        if (c == '\t') c = ' ';
+        else if (c < 0x20 || c == 0x7F) c = '.';
+        out.push_back((char)c);
+    }
+    return out;
+}
+
+static uint32_t nextRandom(uint32_t& x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// --- Text ---
+
+// ~5 MB of log-like lines: empty ones, CRLF, tabs, stray control bytes, a few far too long,
+// and a last line with no newline. Returns the lines as written.
+static std::vector<std::string> writeTextFile(const char* path) {
+    std::vector<std::string> lines;
+    std::string contents;
+    uint32_t x = 0xC0FFEE;
+    char line[512];
+    while (contents.size() < FILE_BYTES) {
+        uint32_t r = nextRandom(x);
+        size_t n = lines.size();
+        int len = snprintf(line, sizeof(line), "%lu [I] [WIFI]\tScan %u found %u networks", (unsigned long)(n * 7), (unsigned)n, r % 40);
+        if (r % 97 == 0) len = 0;
+        else if (r % 89 == 0) len += snprintf(line + len, sizeof(line) - len, " bell\a esc\x1b");
+        else if (r % 211 == 0) {
+            memset(line + len, 'L', 300);
+            len += 300;
+        } else {
+            memset(line + len, '.', r % 24);
+            len += r % 24;
+        }
+        lines.emplace_back(line, len);
+        contents.append(line, len);
+        contents += (r % 5 == 0) ? "\r\n" : "\n";
+    }
+    lines.emplace_back("tail without a newline");
+    contents += lines.back();
+    TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, path), contents));
+    return lines;
+}
+
+void test_text_pages_match_the_file(void) {
+    std::vector<std::string> lines = writeTextFile("/data/logs/big.txt");
+    std::unique_ptr<TextPager> pager = openPager("/data/logs/big.txt");
+    TEST_ASSERT_EQUAL(TextPager::Format::TEXT, pager->getFormat());
+
+    while (pager->indexStep()) {}
+    TEST_ASSERT_TRUE(pager->isIndexed());
+    TEST_ASSERT_EQUAL_UINT32(lines.size(), pager->getLineCount());
+
+    // Random pages, and pages on either side of the first thousand checkpoints.
+    std::vector<std::string> page;
+    uint32_t x = 42;
+    for (int i = 0; i < 3000; ++i) {
+        uint32_t first = nextRandom(x) % lines.size();
+        if (i % 3 == 1) first = (i / 3) * TextPager::STRIDE;
+        else if (i % 3 == 2) first = (i / 3 + 1) * TextPager::STRIDE - 3; // Runs over into the next one
+        if (first >= lines.size()) first = lines.size() - 1;
+        size_t got = pager->getLines(first, 7, page);
+        TEST_ASSERT_EQUAL_size_t(std::min<size_t>(7, lines.size() - first), got);
+        for (size_t k = 0; k < got; ++k) {
+            TEST_ASSERT_EQUAL_STRING(displayed(lines[first + k]).c_str(), page[k].c_str());
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(1, pager->getLines(lines.size() - 1, 5, page));
+    TEST_ASSERT_EQUAL_STRING("tail without a newline", page[0].c_str());
+    TEST_ASSERT_EQUAL_size_t(0, pager->getLines(lines.size(), 5, page));
+}
+
+void test_index_grows_only_as_far_as_a_page_needs(void) {
+    std::vector<std::string> lines = writeTextFile("/data/logs/big.txt");
+    std::unique_ptr<TextPager> pager = openPager("/data/logs/big.txt");
+    TEST_ASSERT_EQUAL_UINT32(0, pager->getLineCount());
+
+    std::vector<std::string> page;
+    TEST_ASSERT_EQUAL_size_t(5, pager->getLines(20000, 5, page));
+    TEST_ASSERT_EQUAL_STRING(displayed(lines[20000]).c_str(), page[0].c_str());
+    TEST_ASSERT_FALSE(pager->isIndexed());
+    TEST_ASSERT_TRUE(pager->getLineCount() >= 20005);
+    TEST_ASSERT_TRUE(pager->getLineCount() < 20005 + TextPager::CHUNK_SIZE); // Within one chunk of it
+    TEST_ASSERT_LESS_THAN(50, pager->getIndexPercent());
+
+    // Pages behind the index front don't move it.
+    uint32_t known = pager->getLineCount();
+    TEST_ASSERT_EQUAL_size_t(5, pager->getLines(10, 5, page));
+    TEST_ASSERT_EQUAL_STRING(displayed(lines[10]).c_str(), page[0].c_str());
+    TEST_ASSERT_EQUAL_UINT32(known, pager->getLineCount());
+}
+
+// --- .klog ---
+
+namespace {
+
+    // Writes .klog frames the way Logger's flusher lays them out.
+    class KlogWriter {
+    public:
+        KlogWriter() {
+            file_.append(BinaryLog::FILE_MAGIC, sizeof(BinaryLog::FILE_MAGIC));
+            file_.push_back((char)BinaryLog::FILE_VERSION);
+        }
+
+        void sync() {
+            frame(BinaryLog::FRAME_SYNC, nullptr, 0);
+            strings_.clear();
+            lastMillis_ = 0;
+        }
+
+        template <typename... Args>
+        void message(uint8_t level, uint32_t millis, const char* tag, const char* format, Args... args) {
+            uint8_t record[256];
+            BinaryLog::MessageHeader header = {level, millis, format, tag};
+            size_t len = BinaryLog::encode(record, sizeof(record), header, args...);
+            uint8_t payload[300];
+            size_t pos = 0;
+            payload[pos++] = level;
+            pos += BinaryLog::putVarint(payload + pos, millis - lastMillis_);
+            pos += BinaryLog::putVarint(payload + pos, stringIndex(format));
+            pos += BinaryLog::putVarint(payload + pos, stringIndex(tag));
+            memcpy(payload + pos, record + sizeof(header), len - sizeof(header));
+            frame(BinaryLog::FRAME_MESSAGE, payload, pos + len - sizeof(header));
+            lastMillis_ = millis;
+        }
+
+        size_t size() const { return file_.size(); }
+        const std::string& bytes() const { return file_; }
+
+    private:
+        uint32_t stringIndex(const char* s) {
+            for (size_t i = 0; i < strings_.size(); ++i) {
+                if (strings_[i] == s) return i;
+            }
+            uint8_t payload[300];
+            size_t n = BinaryLog::putVarint(payload, strings_.size());
+            memcpy(payload + n, s, strlen(s));
+            frame(BinaryLog::FRAME_STRING, payload, n + strlen(s));
+            strings_.push_back(s);
+            return strings_.size() - 1;
+        }
+
+        void frame(BinaryLog::FrameType type, const uint8_t* payload, size_t len) {
+            uint8_t header[BinaryLog::MAX_FRAME_HEADER_SIZE];
+            file_.append((const char*)header, BinaryLog::putFrameHeader(header, type, len));
+            file_.append((const char*)payload, len);
+        }
+
+        std::string file_;
+        std::vector<std::string> strings_;
+        uint32_t lastMillis_ = 0;
+    };
+
+    // ~5 MB: three boots (so three string tables), the preallocated zero tail after them.
+    void writeKlogFile(const char* path) {
+        KlogWriter klog;
+        std::string longArg(90, 'x');
+        uint32_t x = 7, millis = 0;
+        for (uint32_t n = 0; klog.size() < FILE_BYTES - 64 * 1024; ++n) {
+            if (n > 0 && n % 30000 == 0) {
+                klog.sync();
+                millis = 0;
+            }
+            uint32_t r = nextRandom(x);
+            millis += r % 300;
+            switch (r % 5) {
+                case 0: klog.message(1, millis, "WIFI", "Connected to %s (ch %d, rssi %d dBm) in %lu ms", "HomeNet-5G", (int)(r % 13 + 1), -(int)(r % 60) - 30, (unsigned long)n); break;
+                case 1: klog.message(2, millis, "PCF", "  > PCF0 State (0x%02X): %s", (unsigned)(r & 0xFF), "P0=1\tP1=0"); break;
+                case 2: klog.message(3, millis, "PLAYER", "Volume %d%%, pos %.1f s, used %llu", (int)(r % 100), n * 0.5, (unsigned long long)n * 4096); break;
+                case 3: klog.message(0, millis, "SNIFF", "Frame %u from %02X:%02X:%02X:%02X:%02X:%02X", n, 0xde, 0xad, 0xbe, 0xef, r & 0xFF, 1); break;
+                default: klog.message(1, millis, "APP", "%s %s", longArg.c_str(), longArg.c_str()); break; // Cut at MAX_LINE_CHARS
+            }
+        }
+        std::string contents = klog.bytes() + std::string(64 * 1024, '\0');
+        TEST_ASSERT_TRUE(TestSandbox::writeHostFile(TestSandbox::hostPath(*volume, path), contents));
+    }
+
+} // namespace
+
+void test_klog_pages_match_klog_decode(void) {
+    const char* path = "/data/logs/system_log_latest.klog";
+    writeKlogFile(path);
+    std::string decoded;
+    TEST_ASSERT_TRUE_MESSAGE(TestSandbox::decodeKlog(TestSandbox::hostPath(*volume, path), decoded), "klog_decode.py failed");
+    std::vector<std::string> expected;
+    std::istringstream stream(decoded);
+    std::string line;
+    while (std::getline(stream, line)) expected.push_back(displayed(line));
+
+    std::unique_ptr<TextPager> pager = openPager(path);
+    TEST_ASSERT_EQUAL(TextPager::Format::KLOG, pager->getFormat());
+    std::vector<std::string> page;
+    pager->getLines(0, expected.size() + 10, page); // One pass over the whole file
+    TEST_ASSERT_TRUE(pager->isIndexed());
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), pager->getLineCount());
+    TEST_ASSERT_EQUAL_size_t(expected.size(), page.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), page[i].c_str());
+    }
+
+    // Random pages start from a checkpoint's clock and string table, across the syncs too.
+    uint32_t x = 99;
+    for (int i = 0; i < 2000; ++i) {
+        uint32_t first = nextRandom(x) % expected.size();
+        size_t got = pager->getLines(first, 5, page);
+        TEST_ASSERT_EQUAL_size_t(std::min<size_t>(5, expected.size() - first), got);
+        for (size_t k = 0; k < got; ++k) {
+            TEST_ASSERT_EQUAL_STRING(expected[first + k].c_str(), page[k].c_str());
+        }
+    }
+}
+
+// --- Benchmark ---
+
+static double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchmark(const char* label, const char* path) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<TextPager> pager = openPager(path);
+    std::vector<std::string> page;
+    pager->getLines(0, 5, page);
+    double firstPage = millisSince(start);
+    uint64_t firstBytes = pager->getStats().bytesRead;
+
+    start = std::chrono::steady_clock::now();
+    while (pager->indexStep()) {}
+    double fullIndex = millisSince(start);
+
+    uint32_t x = 5;
+    const int pages = 1000;
+    uint64_t before = pager->getStats().bytesRead;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < pages; ++i) pager->getLines(nextRandom(x) % pager->getLineCount(), 5, page);
+    double perPage = millisSince(start) / pages;
+    uint64_t bytesPerPage = (pager->getStats().bytesRead - before) / pages;
+
+    char message[200];
+    snprintf(message, sizeof(message), "%s, %u lines: first page %.2f ms, %u B read | full index %.0f ms | random page %.3f ms, %u B read",
+             label, (unsigned)pager->getLineCount(), firstPage, (unsigned)firstBytes, fullIndex, perPage, (unsigned)bytesPerPage);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_OR_EQUAL(3 * TextPager::CHUNK_SIZE, firstBytes); // Header, one index chunk, the page
+    TEST_ASSERT_LESS_OR_EQUAL(2 * TextPager::CHUNK_SIZE, bytesPerPage); // From the nearest checkpoint
+    TEST_ASSERT_TRUE(firstPage < 100);
+}
+
+void test_benchmark_5mb_files(void) {
+    writeTextFile("/data/logs/big.txt");
+    writeKlogFile("/data/logs/system_log_latest.klog");
+    benchmark("text", "/data/logs/big.txt");
+    benchmark(".klog", "/data/logs/system_log_latest.klog");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_text_pages_match_the_file);
+    RUN_TEST(test_index_grows_only_as_far_as_a_page_needs);
+    RUN_TEST(test_klog_pages_match_klog_decode);
+    RUN_TEST(test_benchmark_5mb_files);
+    NativeShim::exitWithoutTeardown(UNITY_END());
+}
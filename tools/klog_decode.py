@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Decode KIVA binary session logs (.klog) back into text.
+
+Usage: klog_decode.py system_log_latest.klog [more.klog ...]  > log.txt
+
+Prints one line per message in the firmware's text format:
+    <millis> [I] [TAG] message
+The file format is described in include/BinaryLog.h. Only the standard library is used.
+"""
+
+import re
+import struct
+import sys
+
+MAGIC = b"KLOG"
+VERSION = 1
+FRAME_STRING = 1
+FRAME_MESSAGE = 2
+FRAME_SYNC = 3
+
+ARG_I32, ARG_I64, ARG_U32, ARG_U64, ARG_F32, ARG_F64, ARG_STR, ARG_PTR = range(1, 9)
+SIGNED = (ARG_I32, ARG_I64)
+VARINTS = (ARG_I32, ARG_I64, ARG_U32, ARG_U64, ARG_PTR)
+FLOATS = {ARG_F32: "<f", ARG_F64: "<d"}
+
+LEVELS = "DIWE"
+
+# Same subset as BinaryLog::render(): flags, width and precision kept, length modifiers dropped.
+SPEC = re.compile(r"%(%|[-+ #0-9.]*)(?:hh|h|ll|l|L|q|j|z|t)?([diuxXocfFeEgGaAsp])?")
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while pos < len(data):
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+    raise IndexError("truncated varint")
+
+
+def parse_args(data):
+    args = []
+    pos = 0
+    try:
+        while pos < len(data):
+            kind = data[pos]
+            pos += 1
+            if kind in VARINTS:
+                value, pos = read_varint(data, pos)
+                if kind in SIGNED:
+                    value = (value >> 1) ^ -(value & 1)
+                args.append((kind, value))
+            elif kind in FLOATS:
+                fmt = FLOATS[kind]
+                args.append((kind, struct.unpack_from(fmt, data, pos)[0]))
+                pos += struct.calcsize(fmt)
+            elif kind == ARG_STR:
+                n = data[pos]
+                args.append((kind, data[pos + 1:pos + 1 + n].decode("utf-8", "replace")))
+                pos += 1 + n
+            else:
+                break
+    except (IndexError, struct.error):
+        pass  # A cut record: the missing arguments print as <?>
+    return args
+
+
+def render(fmt, args):
+    args = iter(args)
+
+    def convert(match):
+        flags, conv = match.group(1), match.group(2)
+        if flags == "%":
+            return "%"
+        if conv is None:
+            return match.group(0)
+        kind, value = next(args, (None, None))
+        if kind is None:
+            return "<?>"
+        is_int = kind in VARINTS
+        if conv in "di" and is_int:
+            return ("%" + flags + "d") % value
+        if conv in "uxXo" and is_int:
+            if kind == ARG_I32:
+                value &= 0xFFFFFFFF
+            elif value < 0:
+                value &= 0xFFFFFFFFFFFFFFFF
+            return ("%" + flags + ("d" if conv == "u" else conv)) % value
+        if conv == "c" and is_int:
+            return ("%" + flags + "c") % chr(value & 0xFF)
+        if conv in "fFeEgGaA" and kind in FLOATS:
+            if conv in "aA":
+                return float(value).hex()
+            return ("%" + flags + conv) % value
+        if conv == "s" and kind == ARG_STR:
+            return ("%" + flags + "s") % value
+        if conv == "p" and is_int:
+            return "0x%x" % (value & 0xFFFFFFFFFFFFFFFF)
+        return "<?>"
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode(path, out):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != MAGIC:
+        raise ValueError("%s: not a .klog file" % path)
+    if data[4] != VERSION:
+        raise ValueError("%s: unsupported version %d" % (path, data[4]))
+
+    strings = {}
+    millis = 0
+    pos = 5
+    while pos < len(data):
+        kind = data[pos]
+        if kind == 0:
+            break  # Preallocated space that was never written
+        try:
+            length, start = read_varint(data, pos + 1)
+        except IndexError:
+            length, start = 1, len(data) + 1
+        payload = data[start:start + length]
+        if len(payload) < length:
+            print("%s: truncated frame at the end" % path, file=sys.stderr)
+            break
+        offset, pos = pos, start + length
+
+        if kind == FRAME_SYNC:
+            strings = {}
+            millis = 0
+        elif kind == FRAME_STRING:
+            index, text_start = read_varint(payload, 0)
+            strings[index] = payload[text_start:].decode("utf-8", "replace")
+        elif kind == FRAME_MESSAGE:
+            level = payload[0]
+            delta, p = read_varint(payload, 1)
+            fmt_index, p = read_varint(payload, p)
+            tag_index, p = read_varint(payload, p)
+            millis = (millis + delta) & 0xFFFFFFFF
+            fmt = strings.get(fmt_index, "<format %d>" % fmt_index)
+            tag = strings.get(tag_index, "<tag %d>" % tag_index)
+            level_char = LEVELS[level] if level < len(LEVELS) else "?"
+            out.write("%u [%s] [%s] %s\n" % (millis, level_char, tag, render(fmt, parse_args(payload[p:]))))
+        else:
+            print("%s: unknown frame type %d at offset %d, stopping" % (path, kind, offset), file=sys.stderr)
+            break
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    for path in argv[1:]:
+        decode(path, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))